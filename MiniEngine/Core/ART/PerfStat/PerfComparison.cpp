@@ -0,0 +1,443 @@
+// Built without the precompiled header so it has no dependency on Windows
+#include "PerfComparison.h"
+
+#include "document.h"
+#include "prettywriter.h"
+#include "stringbuffer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace ART;
+using namespace std;
+
+namespace {
+
+	bool readFile(const char* path, string& contents, string& error) {
+		ifstream file(path, ios::binary);
+		if (!file) {
+			error = string("Unable to open file: ") + path;
+			return false;
+		}
+
+		file.seekg(0, ios::end);
+		contents.resize((size_t)file.tellg());
+		file.seekg(0, ios::beg);
+		file.read(&contents[0], contents.size());
+		return true;
+	}
+
+	bool hasExtension(const char* path, const char* ext) {
+		size_t pathLen = strlen(path);
+		size_t extLen = strlen(ext);
+		if (pathLen < extLen)
+			return false;
+
+		const char* suffix = path + pathLen - extLen;
+		for (size_t i = 0; i < extLen; ++i) {
+			if (tolower((unsigned char)suffix[i]) != tolower((unsigned char)ext[i]))
+				return false;
+		}
+		return true;
+	}
+
+	// Linear interpolation between the closest ranks
+	float percentile(const vector<float>& sorted, float p) {
+		float pos = p * (sorted.size() - 1);
+		size_t lo = (size_t)pos;
+		size_t hi = min(lo + 1, sorted.size() - 1);
+		return sorted[lo] + (sorted[hi] - sorted[lo]) * (pos - lo);
+	}
+
+	template<class TWriter>
+	void writeStats(TWriter& writer, const CounterStats& stats) {
+		writer.StartObject();
+		writer.Key("count");	writer.Uint(stats.Count);
+		writer.Key("mean");		writer.Double(stats.Mean);
+		writer.Key("median");	writer.Double(stats.Median);
+		writer.Key("p5");		writer.Double(stats.P5);
+		writer.Key("p95");		writer.Double(stats.P95);
+		writer.Key("p99");		writer.Double(stats.P99);
+		writer.Key("mad");		writer.Double(stats.MAD);
+		writer.Key("min");		writer.Double(stats.Min);
+		writer.Key("max");		writer.Double(stats.Max);
+		writer.EndObject();
+	}
+
+	template<class TWriter>
+	void writeStringArray(TWriter& writer, const vector<string>& strings) {
+		writer.StartArray();
+		for (auto& str : strings)
+			writer.String(str.c_str());
+		writer.EndArray();
+	}
+
+	template<class TNode>
+	void gatherProfileNode(const TNode& node, map<string, float>& frame) {
+		string name;
+		if (node.HasMember("Name") && node["Name"].IsString())
+			name = node["Name"].GetString();
+
+		// the root scope has no name and is not reported (see NestedTimingTree::fillPerfDataRecursive)
+		if (!name.empty() && node.HasMember("GPUTime") && node["GPUTime"].IsNumber())
+			frame[name] = node["GPUTime"].GetFloat();
+
+		if (node.HasMember("PipelineQueries") && node["PipelineQueries"].IsArray()) {
+			for (auto& query : node["PipelineQueries"].GetArray()) {
+				if (query.HasMember("Name") && query.HasMember("PSInvocations"))
+					frame[name + "." + query["Name"].GetString() + ".PSInvocations"] = (float)query["PSInvocations"].GetUint64();
+			}
+		}
+
+		if (node.HasMember("SubEvents") && node["SubEvents"].IsArray()) {
+			for (auto& child : node["SubEvents"].GetArray())
+				gatherProfileNode(child, frame);
+		}
+	}
+
+}
+
+vector<float>& PerfCapture::getSeries(const string& counter) {
+	return _counters[counter];
+}
+
+void PerfCapture::AddSample(const string& counter, float value) {
+	getSeries(counter).push_back(value);
+}
+
+bool PerfCapture::LoadReportCsv(const char* path, uint32_t skipFrames, string& error) {
+	string contents;
+	if (!readFile(path, contents, error))
+		return false;
+
+	// The report is transposed, so a 100k frame capture has rows of a megabyte.  Parse the values in
+	// place instead of splitting the rows into strings.
+	const char* cursor = contents.c_str();
+	const char* fileEnd = cursor + contents.size();
+	uint32_t lineNumber = 0;
+
+	while (cursor < fileEnd) {
+		const char* lineEnd = (const char*)memchr(cursor, '\n', fileEnd - cursor);
+		if (lineEnd == nullptr)
+			lineEnd = fileEnd;
+		++lineNumber;
+
+		const char* nameEnd = (const char*)memchr(cursor, ',', lineEnd - cursor);
+		if (nameEnd == nullptr) {
+			// blank lines are fine, anything else isn't a report
+			while (cursor < lineEnd && isspace((unsigned char)*cursor))
+				++cursor;
+			if (cursor != lineEnd) {
+				error = string(path) + ": line " + to_string(lineNumber) + " has no values";
+				return false;
+			}
+			cursor = lineEnd + 1;
+			continue;
+		}
+
+		vector<float>& series = getSeries(string(cursor, nameEnd));
+		uint32_t frame = 0;
+
+		cursor = nameEnd + 1;
+		while (cursor < lineEnd) {
+			while (cursor < lineEnd && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r'))
+				++cursor;
+
+			// every value is followed by a comma, so the last field of a row is empty
+			if (cursor == lineEnd)
+				break;
+			if (*cursor == ',') {
+				++cursor;
+				continue;
+			}
+
+			char* valueEnd;
+			float value = strtof(cursor, &valueEnd);
+			if (valueEnd == cursor) {
+				error = string(path) + ": bad value on line " + to_string(lineNumber);
+				return false;
+			}
+			cursor = valueEnd;
+
+			// -1 marks frames recorded before the counter first appeared
+			if (frame++ >= skipFrames && value >= 0.0f)
+				series.push_back(value);
+		}
+
+		cursor = lineEnd + 1;
+	}
+
+	_sources.push_back(path);
+	return true;
+}
+
+bool PerfCapture::LoadProfileJson(const char* path, string& error) {
+	string contents;
+	if (!readFile(path, contents, error))
+		return false;
+
+	rapidjson::Document doc;
+	doc.Parse(contents.c_str());
+	if (doc.HasParseError() || !doc.IsObject()) {
+		error = string(path) + ": not a profile dump";
+		return false;
+	}
+
+	// A scope name that occurs twice in the tree keeps its last value, as in perfreport.csv
+	map<string, float> frame;
+	gatherProfileNode(doc, frame);
+
+	for (auto& ctr : frame)
+		AddSample(ctr.first, ctr.second);
+
+	_sources.push_back(path);
+	return true;
+}
+
+bool PerfCapture::Load(const char* path, uint32_t skipFrames, string& error) {
+	if (hasExtension(path, ".json"))
+		return LoadProfileJson(path, error);
+
+	return LoadReportCsv(path, skipFrames, error);
+}
+
+CounterStats ART::ComputeCounterStats(vector<float>& samples) {
+	CounterStats stats = {};
+	if (samples.empty())
+		return stats;
+
+	sort(samples.begin(), samples.end());
+
+	double sum = 0.0;
+	for (float value : samples)
+		sum += value;
+
+	stats.Count = (uint32_t)samples.size();
+	stats.Mean = (float)(sum / samples.size());
+	stats.Median = percentile(samples, 0.5f);
+	stats.P5 = percentile(samples, 0.05f);
+	stats.P95 = percentile(samples, 0.95f);
+	stats.P99 = percentile(samples, 0.99f);
+	stats.Min = samples.front();
+	stats.Max = samples.back();
+
+	vector<float> deviations(samples.size());
+	for (size_t i = 0; i < samples.size(); ++i)
+		deviations[i] = fabs(samples[i] - stats.Median);
+	sort(deviations.begin(), deviations.end());
+	stats.MAD = percentile(deviations, 0.5f);
+
+	return stats;
+}
+
+MannWhitneyResult ART::MannWhitneyTest(const vector<float>& a, const vector<float>& b) {
+	MannWhitneyResult result = { 0.0, 0.0, 1.0, 0.5 };
+
+	const double n1 = (double)a.size();
+	const double n2 = (double)b.size();
+	if (a.empty() || b.empty())
+		return result;
+
+	// Walk both sorted samples as one, giving each run of equal values its average rank
+	double rankSumA = 0.0;
+	double tieTerm = 0.0;
+	size_t i = 0, j = 0;
+	double rank = 1.0;
+
+	while (i < a.size() || j < b.size()) {
+		float value = (j == b.size() || (i < a.size() && a[i] <= b[j])) ? a[i] : b[j];
+
+		size_t countA = 0, countB = 0;
+		while (i < a.size() && a[i] == value) { ++i; ++countA; }
+		while (j < b.size() && b[j] == value) { ++j; ++countB; }
+
+		double t = (double)(countA + countB);
+		rankSumA += countA * (rank + (t - 1.0) * 0.5);
+		tieTerm += t * t * t - t;
+		rank += t;
+	}
+
+	const double n = n1 + n2;
+	result.U = rankSumA - n1 * (n1 + 1.0) * 0.5;
+	result.Superiority = 1.0 - result.U / (n1 * n2);
+
+	double variance = n1 * n2 / 12.0 * ((n + 1.0) - tieTerm / (n * (n - 1.0)));
+	if (variance <= 0.0)
+		return result;
+
+	// continuity correction toward the mean
+	double diff = result.U - n1 * n2 * 0.5;
+	diff = diff > 0.0 ? max(diff - 0.5, 0.0) : min(diff + 0.5, 0.0);
+
+	result.Z = diff / sqrt(variance);
+	result.PValue = erfc(fabs(result.Z) / sqrt(2.0));
+
+	return result;
+}
+
+const char* ART::GetVerdictName(PerfVerdict verdict) {
+	switch (verdict) {
+	case PerfVerdict::Unchanged:	return "unchanged";
+	case PerfVerdict::Improved:		return "improved";
+	case PerfVerdict::Regressed:	return "regressed";
+	case PerfVerdict::Inconclusive:	return "inconclusive";
+	case PerfVerdict::Added:		return "added";
+	case PerfVerdict::Removed:		return "removed";
+	}
+	return "";
+}
+
+void PerfComparison::Compare(const PerfCapture& baseline, const PerfCapture& candidate, const PerfCompareOptions& options) {
+	_results.clear();
+	_baselineSources = baseline.GetSources();
+	_candidateSources = candidate.GetSources();
+	_options = options;
+
+	auto& baseCounters = baseline.GetCounters();
+	auto& candCounters = candidate.GetCounters();
+
+	// both maps are ordered by name, so merge them
+	auto baseIt = baseCounters.begin();
+	auto candIt = candCounters.begin();
+	while (baseIt != baseCounters.end() || candIt != candCounters.end()) {
+		bool inBase = baseIt != baseCounters.end() && (candIt == candCounters.end() || baseIt->first <= candIt->first);
+		bool inCand = candIt != candCounters.end() && (baseIt == baseCounters.end() || candIt->first <= baseIt->first);
+		const string& name = inBase ? baseIt->first : candIt->first;
+
+		bool selected = options.Filter.empty();
+		for (auto& filter : options.Filter)
+			selected |= name.find(filter) != string::npos;
+
+		if (selected) {
+			vector<float> baseSamples = inBase ? baseIt->second : vector<float>();
+			vector<float> candSamples = inCand ? candIt->second : vector<float>();
+
+			CounterComparison cmp = {};
+			cmp.Name = name;
+			cmp.Baseline = ComputeCounterStats(baseSamples);
+			cmp.Candidate = ComputeCounterStats(candSamples);
+			cmp.Test = MannWhitneyTest(baseSamples, candSamples);
+			cmp.MedianDelta = cmp.Candidate.Median - cmp.Baseline.Median;
+			cmp.RelativeDelta = cmp.Baseline.Median != 0.0f ? cmp.MedianDelta / fabs(cmp.Baseline.Median) : 0.0f;
+
+			if (cmp.Baseline.Count == 0)
+				cmp.Verdict = PerfVerdict::Added;
+			else if (cmp.Candidate.Count == 0)
+				cmp.Verdict = PerfVerdict::Removed;
+			else if (cmp.Baseline.Count < options.MinSamples || cmp.Candidate.Count < options.MinSamples)
+				cmp.Verdict = PerfVerdict::Inconclusive;
+			else {
+				// With thousands of frames even a negligible shift is significant, so the change must
+				// also be large enough to matter.  A zero baseline has no meaningful relative change.
+				bool significant = cmp.Test.PValue < options.Alpha;
+				bool large = fabs(cmp.MedianDelta) >= options.AbsoluteThreshold &&
+					(cmp.Baseline.Median == 0.0f || fabs(cmp.RelativeDelta) >= options.RelativeThreshold);
+
+				bool higherIsBetter = find(options.HigherIsBetter.begin(), options.HigherIsBetter.end(), name) != options.HigherIsBetter.end();
+				bool worse = higherIsBetter ? cmp.MedianDelta < 0.0f : cmp.MedianDelta > 0.0f;
+
+				if (significant && large)
+					cmp.Verdict = worse ? PerfVerdict::Regressed : PerfVerdict::Improved;
+				else
+					cmp.Verdict = PerfVerdict::Unchanged;
+			}
+
+			_results.push_back(cmp);
+		}
+
+		if (inBase) ++baseIt;
+		if (inCand) ++candIt;
+	}
+}
+
+uint32_t PerfComparison::GetCount(PerfVerdict verdict) const {
+	uint32_t count = 0;
+	for (auto& cmp : _results)
+		count += cmp.Verdict == verdict ? 1 : 0;
+	return count;
+}
+
+void PerfComparison::WriteText(ostream& out) const {
+	char line[512];
+
+	snprintf(line, sizeof(line), "%-40s %-12s %10s %10s %8s %10s %10s %10s\n",
+		"Counter", "Verdict", "Base med", "Cand med", "Delta", "p-value", "Base p95", "Cand p95");
+	out << line;
+
+	for (auto& cmp : _results) {
+		snprintf(line, sizeof(line), "%-40.40s %-12s %10.4f %10.4f %+7.1f%% %10.2e %10.4f %10.4f\n",
+			cmp.Name.c_str(), GetVerdictName(cmp.Verdict), cmp.Baseline.Median, cmp.Candidate.Median,
+			cmp.RelativeDelta * 100.0f, cmp.Test.PValue, cmp.Baseline.P95, cmp.Candidate.P95);
+		out << line;
+	}
+
+	out << endl << GetCount(PerfVerdict::Regressed) << " regressed, " << GetCount(PerfVerdict::Improved) << " improved, "
+		<< GetCount(PerfVerdict::Unchanged) << " unchanged, " << GetCount(PerfVerdict::Inconclusive) << " inconclusive, "
+		<< GetCount(PerfVerdict::Added) << " added, " << GetCount(PerfVerdict::Removed) << " removed" << endl;
+}
+
+void PerfComparison::WriteCsv(ostream& out) const {
+	out << "counter,verdict,base_count,base_median,base_mad,base_p5,base_p95,base_p99,"
+		"cand_count,cand_median,cand_mad,cand_p5,cand_p95,cand_p99,median_delta,relative_delta,p_value,superiority" << endl;
+
+	for (auto& cmp : _results) {
+		const CounterStats& b = cmp.Baseline;
+		const CounterStats& c = cmp.Candidate;
+		out << "\"" << cmp.Name << "\"," << GetVerdictName(cmp.Verdict) << ","
+			<< b.Count << "," << b.Median << "," << b.MAD << "," << b.P5 << "," << b.P95 << "," << b.P99 << ","
+			<< c.Count << "," << c.Median << "," << c.MAD << "," << c.P5 << "," << c.P95 << "," << c.P99 << ","
+			<< cmp.MedianDelta << "," << cmp.RelativeDelta << "," << cmp.Test.PValue << "," << cmp.Test.Superiority << endl;
+	}
+}
+
+void PerfComparison::WriteJson(ostream& out) const {
+	rapidjson::StringBuffer buf;
+	rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buf);
+
+	writer.StartObject();
+
+	writer.Key("baseline");
+	writeStringArray(writer, _baselineSources);
+	writer.Key("candidate");
+	writeStringArray(writer, _candidateSources);
+
+	writer.Key("options");
+	writer.StartObject();
+	writer.Key("relativeThreshold");	writer.Double(_options.RelativeThreshold);
+	writer.Key("absoluteThreshold");	writer.Double(_options.AbsoluteThreshold);
+	writer.Key("alpha");				writer.Double(_options.Alpha);
+	writer.Key("minSamples");			writer.Uint(_options.MinSamples);
+	writer.Key("higherIsBetter");		writeStringArray(writer, _options.HigherIsBetter);
+	writer.EndObject();
+
+	writer.Key("regressed");	writer.Uint(GetCount(PerfVerdict::Regressed));
+	writer.Key("improved");		writer.Uint(GetCount(PerfVerdict::Improved));
+
+	writer.Key("counters");
+	writer.StartArray();
+	for (auto& cmp : _results) {
+		writer.StartObject();
+		writer.Key("name");				writer.String(cmp.Name.c_str());
+		writer.Key("verdict");			writer.String(GetVerdictName(cmp.Verdict));
+		writer.Key("baseline");			writeStats(writer, cmp.Baseline);
+		writer.Key("candidate");		writeStats(writer, cmp.Candidate);
+		writer.Key("medianDelta");		writer.Double(cmp.MedianDelta);
+		writer.Key("relativeDelta");	writer.Double(cmp.RelativeDelta);
+		writer.Key("u");				writer.Double(cmp.Test.U);
+		writer.Key("z");				writer.Double(cmp.Test.Z);
+		writer.Key("pValue");			writer.Double(cmp.Test.PValue);
+		writer.Key("superiority");		writer.Double(cmp.Test.Superiority);
+		writer.EndObject();
+	}
+	writer.EndArray();
+
+	writer.EndObject();
+
+	out << buf.GetString() << endl;
+}
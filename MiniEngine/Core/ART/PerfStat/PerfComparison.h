@@ -0,0 +1,131 @@
+#pragma once
+
+#include "../CommonDefs.h"
+
+#include <cstdint>
+#include <vector>
+#include <map>
+#include <string>
+#include <iosfwd>
+
+namespace ART {
+
+	// All samples of a set of runs, one series per counter.  Counters are aligned by name, so several
+	// runs of the same build can be pooled into one capture.
+	class PerfCapture {
+	public:
+
+		// perfreport.csv as written by PerfCounterReport:  one row per counter, one column per frame.
+		// The first SkipFrames frames of the file are dropped (FrameSequencer records its warm-up frames).
+		bool LoadReportCsv(const char* path, uint32_t skipFrames, std::string& error);
+
+		// *_profile.json as written by EngineProfiling::WriteLastFrameToJson.  Each file is one frame.
+		bool LoadProfileJson(const char* path, std::string& error);
+
+		// Picks the loader by file extension
+		bool Load(const char* path, uint32_t skipFrames, std::string& error);
+
+		void AddSample(const std::string& counter, float value);
+
+		const std::map<std::string, std::vector<float>>& GetCounters() const {
+			return _counters;
+		}
+
+		const std::vector<std::string>& GetSources() const {
+			return _sources;
+		}
+
+	protected:
+		std::vector<float>& getSeries(const std::string& counter);
+
+		std::map<std::string, std::vector<float>>	_counters;
+		std::vector<std::string>					_sources;
+	};
+
+	struct CounterStats {
+		uint32_t	Count;
+		float		Mean;
+		float		Median;
+		float		P5;
+		float		P95;
+		float		P99;
+		float		MAD;		// median absolute deviation from the median, unscaled
+		float		Min;
+		float		Max;
+	};
+
+	// Sorts the samples in place
+	CounterStats ComputeCounterStats(std::vector<float>& samples);
+
+	struct MannWhitneyResult {
+		double		U;				// U statistic of the first sample
+		double		Z;				// normal approximation with tie correction
+		double		PValue;			// two sided
+		double		Superiority;	// probability that a value of the second sample exceeds one of the first
+	};
+
+	// Both inputs must be sorted
+	MannWhitneyResult MannWhitneyTest(const std::vector<float>& a, const std::vector<float>& b);
+
+	struct PerfCompareOptions {
+		PerfCompareOptions() :
+			RelativeThreshold(0.05f),
+			AbsoluteThreshold(0.01f),
+			Alpha(0.001),
+			MinSamples(8)
+		{
+			HigherIsBetter.push_back("Resolution Scale");
+		}
+
+		float						RelativeThreshold;	// minimum change of the median, relative to the baseline
+		float						AbsoluteThreshold;	// minimum change of the median, in counter units
+		double						Alpha;				// significance level of the rank test
+		uint32_t					MinSamples;			// fewer samples on either side are never flagged
+		std::vector<std::string>	HigherIsBetter;		// counters that regress when they go down
+		std::vector<std::string>	Filter;				// substrings; if any are given, other counters are skipped
+	};
+
+	enum class PerfVerdict {
+		Unchanged,
+		Improved,
+		Regressed,
+		Inconclusive,	// not enough samples
+		Added,			// only in the candidate
+		Removed			// only in the baseline
+	};
+
+	const char* GetVerdictName(PerfVerdict verdict);
+
+	struct CounterComparison {
+		std::string			Name;
+		PerfVerdict			Verdict;
+		CounterStats		Baseline;
+		CounterStats		Candidate;
+		float				MedianDelta;		// candidate - baseline
+		float				RelativeDelta;		// MedianDelta / baseline median
+		MannWhitneyResult	Test;
+	};
+
+	class PerfComparison {
+	public:
+
+		void Compare(const PerfCapture& baseline, const PerfCapture& candidate, const PerfCompareOptions& options);
+
+		const std::vector<CounterComparison>& GetResults() const {
+			return _results;
+		}
+
+		uint32_t GetCount(PerfVerdict verdict) const;
+
+		void WriteText(std::ostream& out) const;
+		void WriteCsv(std::ostream& out) const;
+		void WriteJson(std::ostream& out) const;
+
+	protected:
+		std::vector<CounterComparison>	_results;
+		std::vector<std::string>		_baselineSources;
+		std::vector<std::string>		_candidateSources;
+		PerfCompareOptions				_options;
+	};
+
+}
@@ -5,6 +5,8 @@
 #include "PixelBuffer.h"
 #include "GraphicsCore.h"
 #include "EngineProfiling.h"
+#include "TraceCapture.h"
+#include "GpuCounterManager.h"
 
 #include "document.h"
 #include "writer.h"
@@ -42,11 +44,17 @@ void FrameSequencer::BeginCapture(const FrameSequence& sequence) {
 
 	_ctrReport.SetReportFileName((capturePath / filesystem::path("perfreport.csv")).generic_string().c_str());
 	_ctrReport.BeginCapture();
+
+	// timeline of the whole sequence, next to the counter report
+	TraceCapture::Begin((capturePath / filesystem::path("trace.json")).generic_string(), GpuCounterManager::GetClockCalibration());
 }
 
 void FrameSequencer::EndCapture() {
 	_isCapturing = false;
 	_ctrReport.EndCaptureAndSaveReport();
+
+	// the trace is written a few frames later, once the GPU timers of the last frames are read back
+	TraceCapture::End();
 }
 
 void FrameSequencer::CaptureOne(const char*) {
@@ -110,10 +110,21 @@ void ColorBuffer::CreateFromSwapChain( const std::wstring& Name, ID3D12Resource*
     //m_UAVHandle[0] = Graphics::AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
     //Graphics::g_Device->CreateUnorderedAccessView(m_pResource.Get(), nullptr, nullptr, m_UAVHandle[0]);
 
-    m_RTVHandle = Graphics::AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+    if (m_RTVHandle.ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
+        m_RTVHandle = Graphics::AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
     Graphics::g_Device->CreateRenderTargetView(m_pResource.Get(), nullptr, m_RTVHandle);
 }
 
+void ColorBuffer::Destroy(void)
+{
+    Graphics::FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_RTV, m_RTVHandle);
+    Graphics::FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_SRVHandle);
+    for (uint32_t i = 0; i < _countof(m_UAVHandle); ++i)
+        Graphics::FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_UAVHandle[i]);
+
+    PixelBuffer::Destroy();
+}
+
 void ColorBuffer::Create(const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t NumMips,
     DXGI_FORMAT Format, D3D12_GPU_VIRTUAL_ADDRESS VidMem)
 {
@@ -29,6 +29,9 @@ public:
         std::memset(m_UAVHandle, 0xFF, sizeof(m_UAVHandle));
     }
 
+    // Releases the resource and its views
+    virtual void Destroy(void) override;
+
     // Create a color buffer from a swap chain buffer.  Unordered access is restricted.
     void CreateFromSwapChain( const std::wstring& Name, ID3D12Resource* BaseResource );
 
@@ -64,6 +67,7 @@ public:
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetSRV(void) const { return m_SRVHandle; }
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetRTV(void) const { return m_RTVHandle; }
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetUAV(void) const { return m_UAVHandle[0]; }
+    const D3D12_CPU_DESCRIPTOR_HANDLE& GetMipUAV(uint32_t MipLevel) const { ASSERT(MipLevel <= m_NumMipMaps); return m_UAVHandle[MipLevel]; }
 
     void SetClearColor( Color ClearColor ) { m_ClearColor = ClearColor; }
 
@@ -14,9 +14,13 @@
 #include "pch.h"
 #include "CommandAllocatorPool.h"
 
+static_assert(D3D12_COMMAND_LIST_TYPE_COPY < CommandAllocatorRecycler<ID3D12CommandAllocator>::kNumCacheSlots,
+    "Every queue type with a thread cache needs a slot");
+
 CommandAllocatorPool::CommandAllocatorPool(D3D12_COMMAND_LIST_TYPE Type) :
     m_cCommandListType(Type),
-    m_Device(nullptr)
+    m_Device(nullptr),
+    m_Recycler((uint32_t)Type)
 {
 }
 
@@ -32,47 +36,30 @@ void CommandAllocatorPool::Create(DX12_DEVICE * pDevice)
 
 void CommandAllocatorPool::Shutdown()
 {
-    for (size_t i = 0; i < m_AllocatorPool.size(); ++i)
-        m_AllocatorPool[i]->Release();
-
-    m_AllocatorPool.clear();
+    m_Recycler.Shutdown([]( ID3D12CommandAllocator* Allocator ) { Allocator->Release(); });
 }
 
 ID3D12CommandAllocator * CommandAllocatorPool::RequestAllocator(uint64_t CompletedFenceValue)
 {
-    std::lock_guard<std::mutex> LockGuard(m_AllocatorMutex);
-
-    ID3D12CommandAllocator* pAllocator = nullptr;
-
-    if (!m_ReadyAllocators.empty())
+    bool Reused;
+    ID3D12CommandAllocator* pAllocator = m_Recycler.Request(CompletedFenceValue, Reused, [this]( size_t Index )
     {
-        std::pair<uint64_t, ID3D12CommandAllocator*>& AllocatorPair = m_ReadyAllocators.front();
-
-        if (AllocatorPair.first <= CompletedFenceValue)
-        {
-            pAllocator = AllocatorPair.second;
-            ASSERT_SUCCEEDED(pAllocator->Reset());
-            m_ReadyAllocators.pop();
-        }
-    }
-
-    // If no allocator's were ready to be reused, create a new one
-    if (pAllocator == nullptr)
-    {
-        ASSERT_SUCCEEDED(m_Device->CreateCommandAllocator(m_cCommandListType, MY_IID_PPV_ARGS(&pAllocator)));
+        // If no allocators were ready to be reused, create a new one
+        ID3D12CommandAllocator* pNewAllocator = nullptr;
+        ASSERT_SUCCEEDED(m_Device->CreateCommandAllocator(m_cCommandListType, MY_IID_PPV_ARGS(&pNewAllocator)));
         wchar_t AllocatorName[32];
-        swprintf(AllocatorName, 32, L"CommandAllocator %zu", m_AllocatorPool.size());
-        pAllocator->SetName(AllocatorName);
-        m_AllocatorPool.push_back(pAllocator);
-    }
+        swprintf(AllocatorName, 32, L"CommandAllocator %zu", Index);
+        pNewAllocator->SetName(AllocatorName);
+        return pNewAllocator;
+    });
+
+    if (Reused)
+        ASSERT_SUCCEEDED(pAllocator->Reset());
 
     return pAllocator;
 }
 
 void CommandAllocatorPool::DiscardAllocator(uint64_t FenceValue, ID3D12CommandAllocator * Allocator)
 {
-    std::lock_guard<std::mutex> LockGuard(m_AllocatorMutex);
-
-    // That fence value indicates we are free to reset the allocator
-    m_ReadyAllocators.push(std::make_pair(FenceValue, Allocator));
+    m_Recycler.Discard(FenceValue, Allocator);
 }
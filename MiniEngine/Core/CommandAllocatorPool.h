@@ -13,11 +13,10 @@
 
 #pragma once
 
-#include <vector>
-#include <queue>
-#include <mutex>
+#include "CommandAllocatorRecycler.h"
 #include <stdint.h>
 
+// Creates, resets and releases the allocators that a CommandAllocatorRecycler hands out and takes back
 class CommandAllocatorPool
 {
 public:
@@ -30,13 +29,18 @@ public:
     ID3D12CommandAllocator* RequestAllocator(uint64_t CompletedFenceValue);
     void DiscardAllocator(uint64_t FenceValue, ID3D12CommandAllocator* Allocator);
 
-    inline size_t Size() { return m_AllocatorPool.size(); }
+    inline size_t Size() { return m_Recycler.Size(); }
+
+    typedef CommandAllocatorRecycler<ID3D12CommandAllocator>::Stats Stats;
+
+    Stats GetStats( void ) const { return m_Recycler.GetStats(); }
 
 private:
     const D3D12_COMMAND_LIST_TYPE m_cCommandListType;
 
     DX12_DEVICE* m_Device;
-    std::vector<ID3D12CommandAllocator*> m_AllocatorPool;
-    std::queue<std::pair<uint64_t, ID3D12CommandAllocator*>> m_ReadyAllocators;
-    std::mutex m_AllocatorMutex;
+
+    // One thread cache slot per queue type:  direct, bundle, compute and copy.  Video queues always take the
+    // pool's lock.
+    CommandAllocatorRecycler<ID3D12CommandAllocator> m_Recycler;
 };
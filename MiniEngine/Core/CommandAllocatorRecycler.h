@@ -0,0 +1,247 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  The bookkeeping behind CommandAllocatorPool, over any allocator type.  Discarded allocators
+// are ordered by the fence value that frees them, so a request reuses any allocator the GPU is done with
+// rather than only the oldest one.  Each thread also keeps the last few allocators it discarded, so a thread
+// that repeatedly begins and finishes contexts recycles its own allocators without taking the pool's lock.
+// The class never touches a device; creating, resetting and releasing allocators is left to the caller.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+template <typename TAllocator, typename TMutex = std::mutex>
+class CommandAllocatorRecycler
+{
+public:
+
+    // Requests and discards through a recycler with a cache slot below kNumCacheSlots go through the calling
+    // thread's cache for that slot first.  Recyclers sharing a slot share the cache, first come first served.
+    static const uint32_t kNumCacheSlots = 4;
+    static const uint32_t kNoCacheSlot = ~0u;
+
+    // A thread rarely has more than a couple of contexts in flight per queue, so a few allocators are enough
+    static const uint32_t kThreadCacheSize = 4;
+
+    // Cumulative since construction
+    struct Stats
+    {
+        uint32_t PoolSize;          // Allocators created and not yet released
+        uint64_t Created;
+        uint64_t Reused;
+        uint64_t ThreadCacheHits;   // Reuses that did not take the pool's lock
+    };
+
+    explicit CommandAllocatorRecycler( uint32_t CacheSlot ) :
+        m_CacheSlot(CacheSlot),
+        m_NumAllocators(0),
+        m_NumCreated(0),
+        m_NumReused(0),
+        m_NumThreadCacheHits(0)
+    {
+    }
+
+    // The owner releases the allocators with Shutdown() first.  This only stops thread caches from returning
+    // allocators to a recycler that is gone.
+    ~CommandAllocatorRecycler()
+    {
+        std::lock_guard<TMutex> LockGuard(m_AllocatorMutex);
+        ++sm_Generation;
+    }
+
+    // Returns an allocator whose fence value has completed and sets Reused, or else returns the one Create()
+    // makes.  Create(Index) runs under the pool's lock and is passed the number of allocators made before it.
+    // A reused allocator still has to be reset.
+    template <typename CreateFn>
+    TAllocator* Request( uint64_t CompletedFenceValue, bool& Reused, CreateFn Create )
+    {
+        TAllocator* Allocator = nullptr;
+        Reused = true;
+
+        // Allocators this thread discarded need no lock
+        ThreadCache* Cache = GetThreadCache();
+        if (Cache != nullptr)
+        {
+            for (uint32_t i = 0; i < Cache->Count; ++i)
+            {
+                if (Cache->Entries[i].FenceValue <= CompletedFenceValue)
+                {
+                    Allocator = Cache->Entries[i].Allocator;
+                    Cache->Entries[i] = Cache->Entries[--Cache->Count];
+                    m_NumThreadCacheHits.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                }
+            }
+        }
+
+        if (Allocator == nullptr)
+        {
+            std::lock_guard<TMutex> LockGuard(m_AllocatorMutex);
+
+            // The earliest fence is on top, so if any allocator is free this one is
+            if (!m_ReadyAllocators.empty() && m_ReadyAllocators.top().FenceValue <= CompletedFenceValue)
+            {
+                Allocator = m_ReadyAllocators.top().Allocator;
+                m_ReadyAllocators.pop();
+            }
+            else
+            {
+                // If no allocators were ready to be reused, create a new one
+                Allocator = Create(m_AllocatorPool.size());
+                m_AllocatorPool.push_back(Allocator);
+
+                m_NumAllocators.store((uint32_t)m_AllocatorPool.size(), std::memory_order_relaxed);
+                m_NumCreated.fetch_add(1, std::memory_order_relaxed);
+                Reused = false;
+                return Allocator;
+            }
+        }
+
+        m_NumReused.fetch_add(1, std::memory_order_relaxed);
+        return Allocator;
+    }
+
+    void Discard( uint64_t FenceValue, TAllocator* Allocator )
+    {
+        // That fence value indicates we are free to reset the allocator
+        RetiredAllocator Retired = { FenceValue, Allocator };
+
+        ThreadCache* Cache = GetThreadCache();
+        if (Cache != nullptr && Cache->Count < kThreadCacheSize)
+        {
+            Cache->Entries[Cache->Count++] = Retired;
+            return;
+        }
+
+        std::lock_guard<TMutex> LockGuard(m_AllocatorMutex);
+        m_ReadyAllocators.push(Retired);
+    }
+
+    // Calls Release() on every allocator created and forgets them all, including those in thread caches
+    template <typename ReleaseFn>
+    void Shutdown( ReleaseFn Release )
+    {
+        std::lock_guard<TMutex> LockGuard(m_AllocatorMutex);
+
+        for (size_t i = 0; i < m_AllocatorPool.size(); ++i)
+            Release(m_AllocatorPool[i]);
+
+        m_AllocatorPool.clear();
+        m_ReadyAllocators = decltype(m_ReadyAllocators)();
+        m_NumAllocators = 0;
+
+        // Thread caches notice this and drop what they hold
+        ++sm_Generation;
+    }
+
+    size_t Size( void ) const { return m_NumAllocators.load(std::memory_order_relaxed); }
+
+    Stats GetStats( void ) const
+    {
+        Stats Result;
+        Result.PoolSize = m_NumAllocators.load(std::memory_order_relaxed);
+        Result.Created = m_NumCreated.load(std::memory_order_relaxed);
+        Result.Reused = m_NumReused.load(std::memory_order_relaxed);
+        Result.ThreadCacheHits = m_NumThreadCacheHits.load(std::memory_order_relaxed);
+        return Result;
+    }
+
+private:
+
+    struct RetiredAllocator
+    {
+        uint64_t FenceValue;
+        TAllocator* Allocator;
+
+        bool operator>( const RetiredAllocator& Rhs ) const { return FenceValue > Rhs.FenceValue; }
+    };
+
+    // Whatever is left when the thread exits goes back to the pool
+    struct ThreadCache
+    {
+        ThreadCache() : Owner(nullptr), Generation(0), Count(0) {}
+        ~ThreadCache()
+        {
+            if (Owner != nullptr)
+                Owner->ReturnThreadCache(*this);
+        }
+
+        CommandAllocatorRecycler* Owner;
+        uint32_t Generation;
+        uint32_t Count;
+        RetiredAllocator Entries[kThreadCacheSize];
+    };
+
+    ThreadCache* GetThreadCache( void )
+    {
+        if (m_CacheSlot >= kNumCacheSlots)
+            return nullptr;
+
+        ThreadCache& Cache = sm_ThreadCaches[m_CacheSlot];
+
+        const uint32_t Generation = sm_Generation.load(std::memory_order_acquire);
+        if (Cache.Owner == nullptr || Cache.Generation != Generation)
+        {
+            Cache.Owner = this;
+            Cache.Generation = Generation;
+            Cache.Count = 0;
+        }
+
+        return Cache.Owner == this ? &Cache : nullptr;
+    }
+
+    void ReturnThreadCache( ThreadCache& Cache )
+    {
+        // Once the pool has been shut down it may be gone, so don't even take its lock
+        if (Cache.Generation != sm_Generation.load(std::memory_order_acquire))
+            return;
+
+        std::lock_guard<TMutex> LockGuard(m_AllocatorMutex);
+
+        // Shutdown() bumps the generation under this lock, so check again in case it ran since.  Its allocators
+        // have been released.
+        if (Cache.Generation != sm_Generation.load(std::memory_order_relaxed))
+        {
+            Cache.Count = 0;
+            return;
+        }
+
+        for (uint32_t i = 0; i < Cache.Count; ++i)
+            m_ReadyAllocators.push(Cache.Entries[i]);
+        Cache.Count = 0;
+    }
+
+    const uint32_t m_CacheSlot;
+
+    std::vector<TAllocator*> m_AllocatorPool;
+    std::priority_queue<RetiredAllocator, std::vector<RetiredAllocator>, std::greater<RetiredAllocator>> m_ReadyAllocators;
+    TMutex m_AllocatorMutex;
+
+    std::atomic<uint32_t> m_NumAllocators;
+    std::atomic<uint64_t> m_NumCreated;
+    std::atomic<uint64_t> m_NumReused;
+    std::atomic<uint64_t> m_NumThreadCacheHits;
+
+    // Bumped by Shutdown() so that thread caches drop allocators that were released
+    static std::atomic<uint32_t> sm_Generation;
+
+    static thread_local ThreadCache sm_ThreadCaches[kNumCacheSlots];
+};
+
+template <typename TAllocator, typename TMutex>
+std::atomic<uint32_t> CommandAllocatorRecycler<TAllocator, TMutex>::sm_Generation(1);
+
+template <typename TAllocator, typename TMutex>
+thread_local typename CommandAllocatorRecycler<TAllocator, TMutex>::ThreadCache
+    CommandAllocatorRecycler<TAllocator, TMutex>::sm_ThreadCaches[CommandAllocatorRecycler<TAllocator, TMutex>::kNumCacheSlots];
@@ -96,6 +96,8 @@ ComputeContext& ComputeContext::Begin(const std::wstring& ID, bool Async)
 
 uint64_t CommandContext::Flush(bool WaitForCompletion)
 {
+    ASSERT(m_ParentContext == nullptr && m_Workers.empty(), "Worker contexts are submitted by JoinWorkers");
+
     FlushResourceBarriers();
 
     ASSERT(m_CurrentAllocator != nullptr);
@@ -130,6 +132,7 @@ uint64_t CommandContext::Flush(bool WaitForCompletion)
 uint64_t CommandContext::Finish( bool WaitForCompletion )
 {
     ASSERT(m_Type == D3D12_COMMAND_LIST_TYPE_DIRECT || m_Type == D3D12_COMMAND_LIST_TYPE_COMPUTE);
+    ASSERT(m_ParentContext == nullptr && m_Workers.empty(), "Worker contexts are submitted by JoinWorkers");
 
     FlushResourceBarriers();
 
@@ -173,7 +176,10 @@ CommandContext::CommandContext(D3D12_COMMAND_LIST_TYPE Type) :
     m_CurGraphicsPipelineState = nullptr;
     m_CurComputeRootSignature = nullptr;
     m_CurComputePipelineState = nullptr;
-    m_NumBarriersToFlush = 0;
+    m_ResourceBarrierBuffer.Reserve(16);
+    m_NumBarriersFlushed = 0;
+    m_ParentContext = nullptr;
+    ClearGraphicsState();
 }
 
 CommandContext::~CommandContext( void )
@@ -199,11 +205,178 @@ void CommandContext::Reset( void )
     m_CurGraphicsPipelineState = nullptr;
     m_CurComputeRootSignature = nullptr;
     m_CurComputePipelineState = nullptr;
-    m_NumBarriersToFlush = 0;
+    m_ResourceBarrierBuffer.Clear();
+    ClearGraphicsState();
 
     BindDescriptorHeaps();
 }
 
+void CommandContext::ClearGraphicsState( void )
+{
+    m_GraphicsRootSignature = nullptr;
+    m_NumRenderTargets = 0;
+    m_DepthStencil.ptr = 0;
+    ZeroMemory(&m_Viewport, sizeof(m_Viewport));
+    ZeroMemory(&m_Scissor, sizeof(m_Scissor));
+    m_Topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+    for (uint32_t i = 0; i < kMaxRootViews; ++i)
+        m_GraphicsRootViewTypes[i] = kRootViewNone;
+}
+
+CommandContext& CommandContext::ForkWorker( void )
+{
+    ASSERT(m_Type == D3D12_COMMAND_LIST_TYPE_DIRECT && m_ParentContext == nullptr);
+    ASSERT(m_Workers.size() < kMaxWorkerContexts);
+
+    CommandContext* Worker = g_ContextManager.AllocateContext(m_Type);
+    Worker->SetID(L"");
+    Worker->m_ParentContext = this;
+    Worker->ApplyGraphicsState(*this);
+    m_Workers.push_back(Worker);
+    return *Worker;
+}
+
+uint64_t CommandContext::JoinWorkers( bool WaitForCompletion )
+{
+    ASSERT(m_ParentContext == nullptr);
+
+    FlushResourceBarriers();
+
+    ID3D12CommandList* Lists[1 + kMaxWorkerContexts];
+    UINT NumLists = 0;
+    Lists[NumLists++] = m_CommandList;
+    for (CommandContext* Worker : m_Workers)
+    {
+        Worker->FlushResourceBarriers();
+        Lists[NumLists++] = Worker->m_CommandList;
+    }
+
+    CommandQueue& Queue = g_CommandManager.GetQueue(m_Type);
+    uint64_t FenceValue = Queue.ExecuteCommandLists(NumLists, Lists);
+
+    // Workers are released exactly as Finish() would release them
+    for (CommandContext* Worker : m_Workers)
+    {
+        Queue.DiscardAllocator(FenceValue, Worker->m_CurrentAllocator);
+        Worker->m_CurrentAllocator = nullptr;
+
+        Worker->m_CpuLinearAllocator.CleanupUsedPages(FenceValue);
+        Worker->m_GpuLinearAllocator.CleanupUsedPages(FenceValue);
+        Worker->m_DynamicViewDescriptorHeap.CleanupUsedHeaps(FenceValue);
+        Worker->m_DynamicSamplerDescriptorHeap.CleanupUsedHeaps(FenceValue);
+
+        Worker->m_ParentContext = nullptr;
+        g_ContextManager.FreeContext(Worker);
+    }
+    m_Workers.clear();
+
+    if (WaitForCompletion)
+        g_CommandManager.WaitForFence(FenceValue);
+
+    // Like Flush(), keep recording into the same allocator, but also restore everything the workers inherited
+    // since this context carries on where the last worker stopped
+    m_CommandList->Reset(m_CurrentAllocator, nullptr);
+    ApplyGraphicsState(*this);
+
+    return FenceValue;
+}
+
+void CommandContext::ApplyGraphicsState( const CommandContext& Source )
+{
+    if (&Source != this)
+    {
+        for (UINT i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
+            m_CurrentDescriptorHeaps[i] = Source.m_CurrentDescriptorHeaps[i];
+
+        m_CurGraphicsRootSignature = Source.m_CurGraphicsRootSignature;
+        m_CurGraphicsPipelineState = Source.m_CurGraphicsPipelineState;
+        m_GraphicsRootSignature = Source.m_GraphicsRootSignature;
+        m_NumRenderTargets = Source.m_NumRenderTargets;
+        for (UINT i = 0; i < Source.m_NumRenderTargets; ++i)
+            m_RenderTargets[i] = Source.m_RenderTargets[i];
+        m_DepthStencil = Source.m_DepthStencil;
+        m_Viewport = Source.m_Viewport;
+        m_Scissor = Source.m_Scissor;
+        m_Topology = Source.m_Topology;
+
+        uint32_t StaticTables = 0;
+        for (uint32_t i = 0; i < kMaxRootViews; ++i)
+        {
+            m_GraphicsRootViewTypes[i] = Source.m_GraphicsRootViewTypes[i];
+            m_GraphicsRootViews[i] = Source.m_GraphicsRootViews[i];
+            if (m_GraphicsRootViewTypes[i] == kRootViewTable)
+                StaticTables |= (1 << i);
+        }
+
+        // Each worker copies the staged descriptors into its own dynamic heap on its first draw
+        if (m_GraphicsRootSignature != nullptr)
+        {
+            m_DynamicViewDescriptorHeap.ParseGraphicsRootSignature(*m_GraphicsRootSignature);
+            m_DynamicSamplerDescriptorHeap.ParseGraphicsRootSignature(*m_GraphicsRootSignature);
+            m_DynamicViewDescriptorHeap.InheritGraphicsDescriptorHandles(Source.m_DynamicViewDescriptorHeap, StaticTables);
+            m_DynamicSamplerDescriptorHeap.InheritGraphicsDescriptorHandles(Source.m_DynamicSamplerDescriptorHeap, StaticTables);
+        }
+    }
+    else
+    {
+        // The tables committed before the reset are no longer bound
+        m_DynamicViewDescriptorHeap.UnbindAllValid();
+        m_DynamicSamplerDescriptorHeap.UnbindAllValid();
+
+        if (m_CurComputeRootSignature)
+            m_CommandList->SetComputeRootSignature(m_CurComputeRootSignature);
+    }
+
+    BindDescriptorHeaps();
+
+    if (m_CurGraphicsRootSignature != nullptr)
+    {
+        m_CommandList->SetGraphicsRootSignature(m_CurGraphicsRootSignature);
+
+        for (UINT i = 0; i < kMaxRootViews; ++i)
+        {
+            switch (m_GraphicsRootViewTypes[i])
+            {
+            case kRootViewCBV: m_CommandList->SetGraphicsRootConstantBufferView(i, m_GraphicsRootViews[i]); break;
+            case kRootViewSRV: m_CommandList->SetGraphicsRootShaderResourceView(i, m_GraphicsRootViews[i]); break;
+            case kRootViewUAV: m_CommandList->SetGraphicsRootUnorderedAccessView(i, m_GraphicsRootViews[i]); break;
+            case kRootViewTable:
+                {
+                    D3D12_GPU_DESCRIPTOR_HANDLE FirstHandle;
+                    FirstHandle.ptr = m_GraphicsRootViews[i];
+                    m_CommandList->SetGraphicsRootDescriptorTable(i, FirstHandle);
+                }
+                break;
+            }
+        }
+    }
+
+    if (m_CurGraphicsPipelineState != nullptr)
+        m_CommandList->SetPipelineState(m_CurGraphicsPipelineState);
+    else if (m_CurComputePipelineState != nullptr)
+        m_CommandList->SetPipelineState(m_CurComputePipelineState);
+
+    if (m_NumRenderTargets > 0 || m_DepthStencil.ptr != 0)
+        m_CommandList->OMSetRenderTargets(m_NumRenderTargets, m_RenderTargets, FALSE, m_DepthStencil.ptr != 0 ? &m_DepthStencil : nullptr);
+    if (m_Viewport.Width > 0.0f)
+        m_CommandList->RSSetViewports(1, &m_Viewport);
+    if (m_Scissor.right > m_Scissor.left)
+        m_CommandList->RSSetScissorRects(1, &m_Scissor);
+    if (m_Topology != D3D_PRIMITIVE_TOPOLOGY_UNDEFINED)
+        m_CommandList->IASetPrimitiveTopology(m_Topology);
+}
+
+void GraphicsContext::ForkWorkers( uint32_t NumWorkers, GraphicsContext* Workers[] )
+{
+    ASSERT(m_Workers.empty(), "Join the previous workers first");
+
+    // Anything the workers draw must come after the barriers recorded so far
+    FlushResourceBarriers();
+
+    for (uint32_t i = 0; i < NumWorkers; ++i)
+        Workers[i] = &ForkWorker().GetGraphicsContext();
+}
+
 void CommandContext::BindDescriptorHeaps( void )
 {
     UINT NonNullHeaps = 0;
@@ -222,11 +395,23 @@ void CommandContext::BindDescriptorHeaps( void )
 void GraphicsContext::SetRenderTargets( UINT NumRTVs, const D3D12_CPU_DESCRIPTOR_HANDLE RTVs[], D3D12_CPU_DESCRIPTOR_HANDLE DSV )
 {
     m_CommandList->OMSetRenderTargets( NumRTVs, RTVs, FALSE, &DSV );
+
+    ASSERT(NumRTVs <= D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT);
+    m_NumRenderTargets = NumRTVs;
+    for (UINT i = 0; i < NumRTVs; ++i)
+        m_RenderTargets[i] = RTVs[i];
+    m_DepthStencil = DSV;
 }
 
 void GraphicsContext::SetRenderTargets(UINT NumRTVs, const D3D12_CPU_DESCRIPTOR_HANDLE RTVs[])
 {
     m_CommandList->OMSetRenderTargets(NumRTVs, RTVs, FALSE, nullptr);
+
+    ASSERT(NumRTVs <= D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT);
+    m_NumRenderTargets = NumRTVs;
+    for (UINT i = 0; i < NumRTVs; ++i)
+        m_RenderTargets[i] = RTVs[i];
+    m_DepthStencil.ptr = 0;
 }
 
 void GraphicsContext::BeginQuery(ID3D12QueryHeap* QueryHeap, D3D12_QUERY_TYPE Type, UINT HeapIndex)
@@ -246,6 +431,8 @@ void GraphicsContext::ResolveQueryData(ID3D12QueryHeap* QueryHeap, D3D12_QUERY_T
 
 void GraphicsContext::ClearUAV( GpuBuffer& Target )
 {
+    FlushResourceBarriers();
+
     // After binding a UAV, we can get a GPU handle that is required to clear it as a UAV (because it essentially runs
     // a shader to set all of the values).
     D3D12_GPU_DESCRIPTOR_HANDLE GpuVisibleHandle = m_DynamicViewDescriptorHeap.UploadDirect(Target.GetUAV());
@@ -255,6 +442,8 @@ void GraphicsContext::ClearUAV( GpuBuffer& Target )
 
 void ComputeContext::ClearUAV( GpuBuffer& Target )
 {
+    FlushResourceBarriers();
+
     // After binding a UAV, we can get a GPU handle that is required to clear it as a UAV (because it essentially runs
     // a shader to set all of the values).
     D3D12_GPU_DESCRIPTOR_HANDLE GpuVisibleHandle = m_DynamicViewDescriptorHeap.UploadDirect(Target.GetUAV());
@@ -264,6 +453,8 @@ void ComputeContext::ClearUAV( GpuBuffer& Target )
 
 void GraphicsContext::ClearUAV( ColorBuffer& Target )
 {
+    FlushResourceBarriers();
+
     // After binding a UAV, we can get a GPU handle that is required to clear it as a UAV (because it essentially runs
     // a shader to set all of the values).
     D3D12_GPU_DESCRIPTOR_HANDLE GpuVisibleHandle = m_DynamicViewDescriptorHeap.UploadDirect(Target.GetUAV());
@@ -276,6 +467,8 @@ void GraphicsContext::ClearUAV( ColorBuffer& Target )
 
 void ComputeContext::ClearUAV( ColorBuffer& Target )
 {
+    FlushResourceBarriers();
+
     // After binding a UAV, we can get a GPU handle that is required to clear it as a UAV (because it essentially runs
     // a shader to set all of the values).
     D3D12_GPU_DESCRIPTOR_HANDLE GpuVisibleHandle = m_DynamicViewDescriptorHeap.UploadDirect(Target.GetUAV());
@@ -288,21 +481,31 @@ void ComputeContext::ClearUAV( ColorBuffer& Target )
 
 void GraphicsContext::ClearColor( ColorBuffer& Target )
 {
+    FlushResourceBarriers();
     m_CommandList->ClearRenderTargetView(Target.GetRTV(), Target.GetClearColor().GetPtr(), 0, nullptr);
 }
 
 void GraphicsContext::ClearDepth( DepthBuffer& Target )
 {
+    FlushResourceBarriers();
     m_CommandList->ClearDepthStencilView(Target.GetDSV(), D3D12_CLEAR_FLAG_DEPTH, Target.GetClearDepth(), Target.GetClearStencil(), 0, nullptr );
 }
 
+void GraphicsContext::ClearDepth( DepthBuffer& Target, uint32_t ArraySlice )
+{
+    FlushResourceBarriers();
+    m_CommandList->ClearDepthStencilView(Target.GetSliceDSV(ArraySlice), D3D12_CLEAR_FLAG_DEPTH, Target.GetClearDepth(), Target.GetClearStencil(), 0, nullptr );
+}
+
 void GraphicsContext::ClearStencil( DepthBuffer& Target )
 {
+    FlushResourceBarriers();
     m_CommandList->ClearDepthStencilView(Target.GetDSV(), D3D12_CLEAR_FLAG_STENCIL, Target.GetClearDepth(), Target.GetClearStencil(), 0, nullptr);
 }
 
 void GraphicsContext::ClearDepthAndStencil( DepthBuffer& Target )
 {
+    FlushResourceBarriers();
     m_CommandList->ClearDepthStencilView(Target.GetDSV(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, Target.GetClearDepth(), Target.GetClearStencil(), 0, nullptr);
 }
 
@@ -311,11 +514,14 @@ void GraphicsContext::SetViewportAndScissor( const D3D12_VIEWPORT& vp, const D3D
     ASSERT(rect.left < rect.right && rect.top < rect.bottom);
     m_CommandList->RSSetViewports( 1, &vp );
     m_CommandList->RSSetScissorRects( 1, &rect );
+    m_Viewport = vp;
+    m_Scissor = rect;
 }
 
 void GraphicsContext::SetViewport( const D3D12_VIEWPORT& vp )
 {
     m_CommandList->RSSetViewports( 1, &vp );
+    m_Viewport = vp;
 }
 
 void GraphicsContext::SetViewport( FLOAT x, FLOAT y, FLOAT w, FLOAT h, FLOAT minDepth, FLOAT maxDepth )
@@ -328,89 +534,46 @@ void GraphicsContext::SetViewport( FLOAT x, FLOAT y, FLOAT w, FLOAT h, FLOAT min
     vp.TopLeftX = x;
     vp.TopLeftY = y;
     m_CommandList->RSSetViewports( 1, &vp );
+    m_Viewport = vp;
 }
 
 void GraphicsContext::SetScissor( const D3D12_RECT& rect )
 {
     ASSERT(rect.left < rect.right && rect.top < rect.bottom);
     m_CommandList->RSSetScissorRects( 1, &rect );
+    m_Scissor = rect;
 }
 
 void CommandContext::TransitionResource(GpuResource& Resource, D3D12_RESOURCE_STATES NewState, bool FlushImmediate)
 {
-    D3D12_RESOURCE_STATES OldState = Resource.m_UsageState;
+    // Resource states are shared by every context, and worker lists execute in an order the workers don't know
+    ASSERT(m_ParentContext == nullptr, "Transition resources on the parent context before forking workers");
 
     if (m_Type == D3D12_COMMAND_LIST_TYPE_COMPUTE)
     {
-        ASSERT((OldState & VALID_COMPUTE_QUEUE_RESOURCE_STATES) == OldState);
+        ASSERT((Resource.m_UsageState & VALID_COMPUTE_QUEUE_RESOURCE_STATES) == Resource.m_UsageState);
         ASSERT((NewState & VALID_COMPUTE_QUEUE_RESOURCE_STATES) == NewState);
     }
 
-    if (OldState != NewState)
-    {
-        ASSERT(m_NumBarriersToFlush < 16, "Exceeded arbitrary limit on buffered barriers");
-        D3D12_RESOURCE_BARRIER& BarrierDesc = m_ResourceBarrierBuffer[m_NumBarriersToFlush++];
-
-        BarrierDesc.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-        BarrierDesc.Transition.pResource = Resource.GetResource();
-        BarrierDesc.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-        BarrierDesc.Transition.StateBefore = OldState;
-        BarrierDesc.Transition.StateAfter = NewState;
-
-        // Check to see if we already started the transition
-        if (NewState == Resource.m_TransitioningState)
-        {
-            BarrierDesc.Flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
-            Resource.m_TransitioningState = (D3D12_RESOURCE_STATES)-1;
-        }
-        else
-            BarrierDesc.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-
-        Resource.m_UsageState = NewState;
-    }
-    else if (NewState == D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
-        InsertUAVBarrier(Resource, FlushImmediate);
+    m_ResourceBarrierBuffer.Transition(Resource.GetResource(), Resource.m_UsageState, Resource.m_TransitioningState, NewState);
 
-    if (FlushImmediate || m_NumBarriersToFlush == 16)
+    if (FlushImmediate)
         FlushResourceBarriers();
 }
 
 void CommandContext::BeginResourceTransition(GpuResource& Resource, D3D12_RESOURCE_STATES NewState, bool FlushImmediate)
 {
-    // If it's already transitioning, finish that transition
-    if (Resource.m_TransitioningState != (D3D12_RESOURCE_STATES)-1)
-        TransitionResource(Resource, Resource.m_TransitioningState);
-
-    D3D12_RESOURCE_STATES OldState = Resource.m_UsageState;
-
-    if (OldState != NewState)
-    {
-        ASSERT(m_NumBarriersToFlush < 16, "Exceeded arbitrary limit on buffered barriers");
-        D3D12_RESOURCE_BARRIER& BarrierDesc = m_ResourceBarrierBuffer[m_NumBarriersToFlush++];
-
-        BarrierDesc.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-        BarrierDesc.Transition.pResource = Resource.GetResource();
-        BarrierDesc.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-        BarrierDesc.Transition.StateBefore = OldState;
-        BarrierDesc.Transition.StateAfter = NewState;
-
-        BarrierDesc.Flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+    ASSERT(m_ParentContext == nullptr, "Transition resources on the parent context before forking workers");
 
-        Resource.m_TransitioningState = NewState;
-    }
+    m_ResourceBarrierBuffer.BeginTransition(Resource.GetResource(), Resource.m_UsageState, Resource.m_TransitioningState, NewState);
 
-    if (FlushImmediate || m_NumBarriersToFlush == 16)
+    if (FlushImmediate)
         FlushResourceBarriers();
 }
 
 void CommandContext::InsertUAVBarrier(GpuResource& Resource, bool FlushImmediate)
 {
-    ASSERT(m_NumBarriersToFlush < 16, "Exceeded arbitrary limit on buffered barriers");
-    D3D12_RESOURCE_BARRIER& BarrierDesc = m_ResourceBarrierBuffer[m_NumBarriersToFlush++];
-
-    BarrierDesc.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
-    BarrierDesc.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-    BarrierDesc.UAV.pResource = Resource.GetResource();
+    m_ResourceBarrierBuffer.InsertUAVBarrier(Resource.GetResource());
 
     if (FlushImmediate)
         FlushResourceBarriers();
@@ -418,13 +581,12 @@ void CommandContext::InsertUAVBarrier(GpuResource& Resource, bool FlushImmediate
 
 void CommandContext::InsertAliasBarrier(GpuResource& Before, GpuResource& After, bool FlushImmediate)
 {
-    ASSERT(m_NumBarriersToFlush < 16, "Exceeded arbitrary limit on buffered barriers");
-    D3D12_RESOURCE_BARRIER& BarrierDesc = m_ResourceBarrierBuffer[m_NumBarriersToFlush++];
-
+    D3D12_RESOURCE_BARRIER BarrierDesc = {};
     BarrierDesc.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
     BarrierDesc.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
     BarrierDesc.Aliasing.pResourceBefore = Before.GetResource();
     BarrierDesc.Aliasing.pResourceAfter = After.GetResource();
+    m_ResourceBarrierBuffer.Push(BarrierDesc);
 
     if (FlushImmediate)
         FlushResourceBarriers();
@@ -482,6 +644,23 @@ void CommandContext::CopySubresource(GpuResource& Dest, UINT DestSubIndex, GpuRe
     m_CommandList->CopyTextureRegion(&DestLocation, 0, 0, 0, &SrcLocation, nullptr);
 }
 
+void CommandContext::CopySubresourceToBuffer(GpuResource& Dest, const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& DestFootprint, GpuResource& Src, UINT SrcSubIndex)
+{
+    FlushResourceBarriers();
+
+    D3D12_TEXTURE_COPY_LOCATION DestLocation = {};
+    DestLocation.pResource = Dest.GetResource();
+    DestLocation.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+    DestLocation.PlacedFootprint = DestFootprint;
+
+    D3D12_TEXTURE_COPY_LOCATION SrcLocation = {};
+    SrcLocation.pResource = Src.GetResource();
+    SrcLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+    SrcLocation.SubresourceIndex = SrcSubIndex;
+
+    m_CommandList->CopyTextureRegion(&DestLocation, 0, 0, 0, &SrcLocation, nullptr);
+}
+
 void CommandContext::ResolveSubresource(GpuResource& Dest, UINT DestSubIndex, GpuResource& Src, UINT SrcSubIndex, DXGI_FORMAT Format)
 {
 	FlushResourceBarriers();
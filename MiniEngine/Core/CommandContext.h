@@ -25,6 +25,7 @@
 #include "DynamicDescriptorHeap.h"
 #include "LinearAllocator.h"
 #include "CommandSignature.h"
+#include "ResourceBarrierQueue.h"
 #include "GraphicsCore.h"
 #include <vector>
 
@@ -122,6 +123,8 @@ public:
     void CopyBuffer( GpuResource& Dest, GpuResource& Src );
     void CopyBufferRegion( GpuResource& Dest, size_t DestOffset, GpuResource& Src, size_t SrcOffset, size_t NumBytes );
     void CopySubresource(GpuResource& Dest, UINT DestSubIndex, GpuResource& Src, UINT SrcSubIndex);
+    // Copies a texture subresource into a buffer, laid out as GetCopyableFootprints describes
+    void CopySubresourceToBuffer(GpuResource& Dest, const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& DestFootprint, GpuResource& Src, UINT SrcSubIndex);
 	void ResolveSubresource(GpuResource& Dest, UINT DestSubIndex, GpuResource& Src, UINT SrcSubIndex, DXGI_FORMAT Format);
     void CopyCounter(GpuResource& Dest, size_t DestOffset, StructuredBuffer& Src);
     void ResetCounter(StructuredBuffer& Buf, uint32_t Value = 0);
@@ -145,6 +148,9 @@ public:
     void InsertAliasBarrier(GpuResource& Before, GpuResource& After, bool FlushImmediate = false);
     inline void FlushResourceBarriers(void);
 
+    // Running total of barriers this context has submitted; profiling scopes report the difference
+    uint64_t GetNumBarriersFlushed(void) const { return m_NumBarriersFlushed; }
+
     void InsertTimeStamp( ID3D12QueryHeap* pQueryHeap, uint32_t QueryIdx );
     void ResolveTimeStamps( ID3D12Resource* pReadbackHeap, ID3D12QueryHeap* pQueryHeap, uint32_t NumQueries );
 	
@@ -161,10 +167,30 @@ public:
 
     void SetPredication(ID3D12Resource* Buffer, UINT64 BufferOffset, D3D12_PREDICATION_OP Op);
 
+    // Most worker contexts one context can fork at a time
+    static const uint32_t kMaxWorkerContexts = 16;
+
 protected:
 
     void BindDescriptorHeaps( void );
 
+    // Worker contexts, see GraphicsContext::ForkWorkers
+    CommandContext& ForkWorker( void );
+    uint64_t JoinWorkers( bool WaitForCompletion );
+    void ApplyGraphicsState( const CommandContext& Source );
+    void ClearGraphicsState( void );
+
+    // Root parameters bound with a GPU address rather than through the dynamic descriptor heaps
+    enum RootViewType : uint8_t { kRootViewNone, kRootViewCBV, kRootViewSRV, kRootViewUAV, kRootViewTable };
+    static const uint32_t kMaxRootViews = 16;
+
+    void SetGraphicsRootView( UINT RootIndex, RootViewType Type, UINT64 Address )
+    {
+        ASSERT(RootIndex < kMaxRootViews);
+        m_GraphicsRootViewTypes[RootIndex] = Type;
+        m_GraphicsRootViews[RootIndex] = Address;
+    }
+
     CommandListManager* m_OwningManager;
     DX12_GRAPHICSCOMMANDLIST* m_CommandList;
     ID3D12CommandAllocator* m_CurrentAllocator;
@@ -174,11 +200,90 @@ protected:
     ID3D12RootSignature* m_CurComputeRootSignature;
     ID3D12PipelineState* m_CurComputePipelineState;
 
+    // Graphics state that is not in the pipeline state object, kept so that worker contexts can start from it.
+    // Root constants, vertex and index buffers, stencil ref and blend factor are not kept.
+    const RootSignature* m_GraphicsRootSignature;
+    UINT m_NumRenderTargets;
+    D3D12_CPU_DESCRIPTOR_HANDLE m_RenderTargets[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
+    D3D12_CPU_DESCRIPTOR_HANDLE m_DepthStencil;     // ptr is 0 when there is none
+    D3D12_VIEWPORT m_Viewport;                      // Width is 0 until one is set
+    D3D12_RECT m_Scissor;                           // Empty until one is set
+    D3D12_PRIMITIVE_TOPOLOGY m_Topology;
+    RootViewType m_GraphicsRootViewTypes[kMaxRootViews];
+    UINT64 m_GraphicsRootViews[kMaxRootViews];     // GPU virtual address, or the table's first GPU descriptor
+
+    std::vector<CommandContext*> m_Workers;
+    CommandContext* m_ParentContext;
+
     DynamicDescriptorHeap m_DynamicViewDescriptorHeap;		// HEAP_TYPE_CBV_SRV_UAV
     DynamicDescriptorHeap m_DynamicSamplerDescriptorHeap;	// HEAP_TYPE_SAMPLER
 
-    D3D12_RESOURCE_BARRIER m_ResourceBarrierBuffer[16];
-    UINT m_NumBarriersToFlush;
+    // Describes D3D12_RESOURCE_BARRIER to the barrier queue
+    struct BarrierTraits
+    {
+        typedef D3D12_RESOURCE_BARRIER Barrier;
+        typedef ID3D12Resource* ResourceId;
+        typedef D3D12_RESOURCE_STATES State;
+        typedef D3D12_RESOURCE_BARRIER_FLAGS Flags;
+
+        static const Flags kFlagNone = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+        static const Flags kFlagBeginOnly = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+        static const Flags kFlagEndOnly = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+
+        static State InvalidState( void ) { return (D3D12_RESOURCE_STATES)-1; }
+        static State UnorderedAccessState( void ) { return D3D12_RESOURCE_STATE_UNORDERED_ACCESS; }
+
+        static Barrier MakeTransition( ResourceId Resource, State Before, State After, Flags BarrierFlags )
+        {
+            D3D12_RESOURCE_BARRIER BarrierDesc = {};
+            BarrierDesc.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+            BarrierDesc.Flags = BarrierFlags;
+            BarrierDesc.Transition.pResource = Resource;
+            BarrierDesc.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+            BarrierDesc.Transition.StateBefore = Before;
+            BarrierDesc.Transition.StateAfter = After;
+            return BarrierDesc;
+        }
+
+        static Barrier MakeUAV( ResourceId Resource )
+        {
+            D3D12_RESOURCE_BARRIER BarrierDesc = {};
+            BarrierDesc.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+            BarrierDesc.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+            BarrierDesc.UAV.pResource = Resource;
+            return BarrierDesc;
+        }
+
+        static Flags& GetFlags( Barrier& BarrierDesc ) { return BarrierDesc.Flags; }
+        static State& StateBefore( Barrier& BarrierDesc ) { return BarrierDesc.Transition.StateBefore; }
+        static State& StateAfter( Barrier& BarrierDesc ) { return BarrierDesc.Transition.StateAfter; }
+
+        // A UAV or aliasing barrier that touches the resource orders work against the transition, as does one
+        // that names no resource
+        static BarrierQueue::PendingMatch Match( const Barrier& BarrierDesc, ResourceId Resource )
+        {
+            switch (BarrierDesc.Type)
+            {
+            case D3D12_RESOURCE_BARRIER_TYPE_TRANSITION:
+                if (BarrierDesc.Transition.pResource != Resource)
+                    return BarrierQueue::kUnrelated;
+                return BarrierDesc.Transition.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES ?
+                    BarrierQueue::kTransition : BarrierQueue::kBlocked;
+
+            case D3D12_RESOURCE_BARRIER_TYPE_UAV:
+                return BarrierDesc.UAV.pResource == Resource || BarrierDesc.UAV.pResource == nullptr ?
+                    BarrierQueue::kBlocked : BarrierQueue::kUnrelated;
+
+            default:
+                return BarrierDesc.Aliasing.pResourceBefore == Resource || BarrierDesc.Aliasing.pResourceAfter == Resource ||
+                    BarrierDesc.Aliasing.pResourceBefore == nullptr || BarrierDesc.Aliasing.pResourceAfter == nullptr ?
+                    BarrierQueue::kBlocked : BarrierQueue::kUnrelated;
+            }
+        }
+    };
+
+    ResourceBarrierQueue<BarrierTraits> m_ResourceBarrierBuffer;
+    uint64_t m_NumBarriersFlushed;
 
     ID3D12DescriptorHeap* m_CurrentDescriptorHeaps[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
 
@@ -204,6 +309,7 @@ public:
     void ClearUAV( ColorBuffer& Target );
     void ClearColor( ColorBuffer& Target );
     void ClearDepth( DepthBuffer& Target );
+    void ClearDepth( DepthBuffer& Target, uint32_t ArraySlice );
     void ClearStencil( DepthBuffer& Target );
     void ClearDepthAndStencil( DepthBuffer& Target );
 
@@ -213,6 +319,17 @@ public:
 
     void SetRootSignature( const RootSignature& RootSig );
 
+    // Splits recording across worker contexts that may each be recorded on a different thread.  Every worker
+    // starts with this context's render targets, viewport, scissor, topology, root signature, pipeline state,
+    // root views and staged descriptor tables.  Pending barriers are flushed here; workers may not transition
+    // resources, and nothing may be recorded on this context until the workers are joined.
+    void ForkWorkers( uint32_t NumWorkers, GraphicsContext* Workers[] );
+
+    // Submits what this context recorded before the fork, then each worker's commands in index order, so the
+    // result matches recording everything serially.  The workers are released and this context continues on a
+    // reset command list with its state restored.
+    uint64_t JoinWorkers( bool WaitForCompletion = false ) { return CommandContext::JoinWorkers(WaitForCompletion); }
+
     void SetRenderTargets(UINT NumRTVs, const D3D12_CPU_DESCRIPTOR_HANDLE RTVs[]);
     void SetRenderTargets(UINT NumRTVs, const D3D12_CPU_DESCRIPTOR_HANDLE RTVs[], D3D12_CPU_DESCRIPTOR_HANDLE DSV);
     void SetRenderTarget(D3D12_CPU_DESCRIPTOR_HANDLE RTV ) { SetRenderTargets(1, &RTV); }
@@ -230,6 +347,9 @@ public:
     void SetPrimitiveTopology( D3D12_PRIMITIVE_TOPOLOGY Topology );
 
     void SetPipelineState( const GraphicsPSO& PSO );
+    // Compute work recorded through GetComputeContext() replaces the pipeline state.  This rebinds the last
+    // graphics pipeline state so drawing can continue.
+    void RestorePipelineState( void );
     void SetConstantArray( UINT RootIndex, UINT NumConstants, const void* pConstants );
     void SetConstant( UINT RootIndex, DWParam Val, UINT Offset = 0 );
     void SetConstants( UINT RootIndex, DWParam X );
@@ -237,6 +357,7 @@ public:
     void SetConstants( UINT RootIndex, DWParam X, DWParam Y, DWParam Z );
     void SetConstants( UINT RootIndex, DWParam X, DWParam Y, DWParam Z, DWParam W );
     void SetConstantBuffer( UINT RootIndex, D3D12_GPU_VIRTUAL_ADDRESS CBV );
+    void SetShaderResourceView( UINT RootIndex, D3D12_GPU_VIRTUAL_ADDRESS SRV );
     void SetDynamicConstantBufferView( UINT RootIndex, size_t BufferSize, const void* BufferData );
     void SetBufferSRV( UINT RootIndex, const GpuBuffer& SRV, UINT64 Offset = 0);
     void SetBufferUAV( UINT RootIndex, const GpuBuffer& UAV, UINT64 Offset = 0);
@@ -288,6 +409,7 @@ public:
     void SetConstants( UINT RootIndex, DWParam X, DWParam Y, DWParam Z );
     void SetConstants( UINT RootIndex, DWParam X, DWParam Y, DWParam Z, DWParam W );
     void SetConstantBuffer( UINT RootIndex, D3D12_GPU_VIRTUAL_ADDRESS CBV );
+    void SetShaderResourceView( UINT RootIndex, D3D12_GPU_VIRTUAL_ADDRESS SRV );
     void SetDynamicConstantBufferView( UINT RootIndex, size_t BufferSize, const void* BufferData );
     void SetDynamicSRV( UINT RootIndex, size_t BufferSize, const void* BufferData ); 
     void SetBufferSRV( UINT RootIndex, const GpuBuffer& SRV, UINT64 Offset = 0);
@@ -312,10 +434,11 @@ private:
 
 inline void CommandContext::FlushResourceBarriers( void )
 {
-    if (m_NumBarriersToFlush > 0)
+    if (!m_ResourceBarrierBuffer.Empty())
     {
-        m_CommandList->ResourceBarrier(m_NumBarriersToFlush, m_ResourceBarrierBuffer);
-        m_NumBarriersToFlush = 0;
+        m_CommandList->ResourceBarrier(m_ResourceBarrierBuffer.Size(), m_ResourceBarrierBuffer.Data());
+        m_NumBarriersFlushed += m_ResourceBarrierBuffer.Size();
+        m_ResourceBarrierBuffer.Clear();
     }
 }
 
@@ -325,6 +448,11 @@ inline void GraphicsContext::SetRootSignature( const RootSignature& RootSig )
         return;
 
     m_CommandList->SetGraphicsRootSignature(m_CurGraphicsRootSignature = RootSig.GetSignature());
+    m_GraphicsRootSignature = &RootSig;
+
+    // Changing the root signature invalidates all root arguments
+    for (uint32_t i = 0; i < kMaxRootViews; ++i)
+        m_GraphicsRootViewTypes[i] = kRootViewNone;
 
     m_DynamicViewDescriptorHeap.ParseGraphicsRootSignature(RootSig);
     m_DynamicSamplerDescriptorHeap.ParseGraphicsRootSignature(RootSig);
@@ -351,6 +479,12 @@ inline void GraphicsContext::SetPipelineState( const GraphicsPSO& PSO )
     m_CurGraphicsPipelineState = PipelineState;
 }
 
+inline void GraphicsContext::RestorePipelineState( void )
+{
+    if (m_CurGraphicsPipelineState != nullptr)
+        m_CommandList->SetPipelineState(m_CurGraphicsPipelineState);
+}
+
 inline void ComputeContext::SetPipelineState( const ComputePSO& PSO )
 {
     ID3D12PipelineState* PipelineState = PSO.GetPipelineStateObject();
@@ -385,6 +519,7 @@ inline void GraphicsContext::SetBlendFactor( Color BlendFactor )
 inline void GraphicsContext::SetPrimitiveTopology( D3D12_PRIMITIVE_TOPOLOGY Topology )
 {
     m_CommandList->IASetPrimitiveTopology(Topology);
+    m_Topology = Topology;
 }
 
 inline void ComputeContext::SetConstantArray( UINT RootEntry, UINT NumConstants, const void* pConstants )
@@ -467,6 +602,18 @@ inline void ComputeContext::SetConstantBuffer( UINT RootIndex, D3D12_GPU_VIRTUAL
 inline void GraphicsContext::SetConstantBuffer( UINT RootIndex, D3D12_GPU_VIRTUAL_ADDRESS CBV )
 {
     m_CommandList->SetGraphicsRootConstantBufferView(RootIndex, CBV);
+    SetGraphicsRootView(RootIndex, kRootViewCBV, CBV);
+}
+
+inline void ComputeContext::SetShaderResourceView( UINT RootIndex, D3D12_GPU_VIRTUAL_ADDRESS SRV )
+{
+    m_CommandList->SetComputeRootShaderResourceView(RootIndex, SRV);
+}
+
+inline void GraphicsContext::SetShaderResourceView( UINT RootIndex, D3D12_GPU_VIRTUAL_ADDRESS SRV )
+{
+    m_CommandList->SetGraphicsRootShaderResourceView(RootIndex, SRV);
+    SetGraphicsRootView(RootIndex, kRootViewSRV, SRV);
 }
 
 inline void GraphicsContext::SetDynamicConstantBufferView( UINT RootIndex, size_t BufferSize, const void* BufferData )
@@ -476,6 +623,7 @@ inline void GraphicsContext::SetDynamicConstantBufferView( UINT RootIndex, size_
     //SIMDMemCopy(cb.DataPtr, BufferData, Math::AlignUp(BufferSize, 16) >> 4);
     memcpy(cb.DataPtr, BufferData, BufferSize);
     m_CommandList->SetGraphicsRootConstantBufferView(RootIndex, cb.GpuAddress);
+    SetGraphicsRootView(RootIndex, kRootViewCBV, cb.GpuAddress);
 }
 
 inline void ComputeContext::SetDynamicConstantBufferView( UINT RootIndex, size_t BufferSize, const void* BufferData )
@@ -527,6 +675,7 @@ inline void GraphicsContext::SetDynamicSRV(UINT RootIndex, size_t BufferSize, co
     DynAlloc cb = m_CpuLinearAllocator.Allocate(BufferSize);
     SIMDMemCopy(cb.DataPtr, BufferData, Math::AlignUp(BufferSize, 16) >> 4);
     m_CommandList->SetGraphicsRootShaderResourceView(RootIndex, cb.GpuAddress);
+    SetGraphicsRootView(RootIndex, kRootViewSRV, cb.GpuAddress);
 }
 
 inline void ComputeContext::SetDynamicSRV(UINT RootIndex, size_t BufferSize, const void* BufferData)
@@ -541,6 +690,7 @@ inline void GraphicsContext::SetBufferSRV( UINT RootIndex, const GpuBuffer& SRV,
 {
     ASSERT((SRV.m_UsageState & (D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE)) != 0);
     m_CommandList->SetGraphicsRootShaderResourceView(RootIndex, SRV.GetGpuVirtualAddress() + Offset);
+    SetGraphicsRootView(RootIndex, kRootViewSRV, SRV.GetGpuVirtualAddress() + Offset);
 }
 
 inline void ComputeContext::SetBufferSRV( UINT RootIndex, const GpuBuffer& SRV, UINT64 Offset)
@@ -553,6 +703,7 @@ inline void GraphicsContext::SetBufferUAV( UINT RootIndex, const GpuBuffer& UAV,
 {
     ASSERT((UAV.m_UsageState & D3D12_RESOURCE_STATE_UNORDERED_ACCESS) != 0);
     m_CommandList->SetGraphicsRootUnorderedAccessView(RootIndex, UAV.GetGpuVirtualAddress() + Offset);
+    SetGraphicsRootView(RootIndex, kRootViewUAV, UAV.GetGpuVirtualAddress() + Offset);
 }
 
 inline void ComputeContext::SetBufferUAV( UINT RootIndex, const GpuBuffer& UAV, UINT64 Offset)
@@ -617,6 +768,7 @@ inline void CommandContext::SetDescriptorHeaps( UINT HeapCount, D3D12_DESCRIPTOR
 
 inline void CommandContext::SetPredication(ID3D12Resource* Buffer, UINT64 BufferOffset, D3D12_PREDICATION_OP Op)
 {
+    FlushResourceBarriers();
     m_CommandList->SetPredication(Buffer, BufferOffset, Op);
 }
 
@@ -633,6 +785,7 @@ inline void ComputeContext::SetDynamicDescriptor( UINT RootIndex, UINT Offset, D
 inline void GraphicsContext::SetDynamicDescriptors( UINT RootIndex, UINT Offset, UINT Count, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[] )
 {
     m_DynamicViewDescriptorHeap.SetGraphicsDescriptorHandles(RootIndex, Offset, Count, Handles);
+    m_GraphicsRootViewTypes[RootIndex] = kRootViewNone;
 }
 
 inline void ComputeContext::SetDynamicDescriptors( UINT RootIndex, UINT Offset, UINT Count, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[] )
@@ -648,6 +801,7 @@ inline void GraphicsContext::SetDynamicSampler( UINT RootIndex, UINT Offset, D3D
 inline void GraphicsContext::SetDynamicSamplers( UINT RootIndex, UINT Offset, UINT Count, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[] )
 {
     m_DynamicSamplerDescriptorHeap.SetGraphicsDescriptorHandles(RootIndex, Offset, Count, Handles);
+    m_GraphicsRootViewTypes[RootIndex] = kRootViewNone;
 }
 
 inline void ComputeContext::SetDynamicSampler( UINT RootIndex, UINT Offset, D3D12_CPU_DESCRIPTOR_HANDLE Handle )
@@ -663,6 +817,7 @@ inline void ComputeContext::SetDynamicSamplers( UINT RootIndex, UINT Offset, UIN
 inline void GraphicsContext::SetDescriptorTable( UINT RootIndex, D3D12_GPU_DESCRIPTOR_HANDLE FirstHandle )
 {
     m_CommandList->SetGraphicsRootDescriptorTable( RootIndex, FirstHandle );
+    SetGraphicsRootView(RootIndex, kRootViewTable, FirstHandle.ptr);
 }
 
 inline void ComputeContext::SetDescriptorTable( UINT RootIndex, D3D12_GPU_DESCRIPTOR_HANDLE FirstHandle )
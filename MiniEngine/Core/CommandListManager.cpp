@@ -131,6 +131,21 @@ uint64_t CommandQueue::ExecuteCommandList( ID3D12CommandList* List )
     return m_NextFenceValue++;
 }
 
+uint64_t CommandQueue::ExecuteCommandLists( UINT Count, ID3D12CommandList* const* Lists )
+{
+    std::lock_guard<std::mutex> LockGuard(m_FenceMutex);
+
+    for (UINT i = 0; i < Count; ++i)
+        ASSERT_SUCCEEDED(((DX12_GRAPHICSCOMMANDLIST*)Lists[i])->Close());
+
+    // One call keeps the lists back to back on the GPU, in the order given
+    m_CommandQueue->ExecuteCommandLists(Count, Lists);
+
+    m_CommandQueue->Signal(m_pFence, m_NextFenceValue);
+
+    return m_NextFenceValue++;
+}
+
 uint64_t CommandQueue::IncrementFence(void)
 {
     std::lock_guard<std::mutex> LockGuard(m_FenceMutex);
@@ -47,9 +47,13 @@ public:
 
     uint64_t GetNextFenceValue() { return m_NextFenceValue; }
 
+    CommandAllocatorPool::Stats GetAllocatorStats() const { return m_AllocatorPool.GetStats(); }
+
 private:
 
     uint64_t ExecuteCommandList(ID3D12CommandList* List);
+    // Closes and submits the lists in order under a single fence value
+    uint64_t ExecuteCommandLists(UINT Count, ID3D12CommandList* const* Lists);
     ID3D12CommandAllocator* RequestAllocator(void);
     void DiscardAllocator(uint64_t FenceValueForReset, ID3D12CommandAllocator* Allocator);
 
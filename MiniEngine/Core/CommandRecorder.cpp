@@ -0,0 +1,610 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Built without the precompiled header so it has no dependency on Windows
+#include "CommandRecorder.h"
+#include <cassert>
+#include <ostream>
+
+using DescriptorCache::BitScanForward32;
+
+namespace
+{
+    // Matches LinearAllocator's default alignment and CPU page size
+    const size_t kUploadAlignment = 256;
+    const size_t kUploadPageSize = 0x200000;
+
+    const char* const kOpcodeNames[CommandRecorder::kOpcodeCount] =
+    {
+        "SetGraphicsRootSignature",
+        "SetComputeRootSignature",
+        "SetPipelineState",
+        "SetDescriptorHeap",
+        "SetGraphicsRootConstants",
+        "SetComputeRootConstants",
+        "SetGraphicsRootCBV",
+        "SetComputeRootCBV",
+        "SetGraphicsRootDescriptorTable",
+        "SetComputeRootDescriptorTable",
+        "ResourceBarrier",
+        "SetRenderTargets",
+        "SetViewport",
+        "SetScissor",
+        "SetPrimitiveTopology",
+        "SetIndexBuffer",
+        "SetVertexBuffers",
+        "ClearRenderTarget",
+        "ClearDepthStencil",
+        "DrawInstanced",
+        "DrawIndexedInstanced",
+        "Dispatch",
+        "ExecuteIndirect",
+    };
+}
+
+const char* CommandRecorder::GetOpcodeName( Opcode Op )
+{
+    return Op < kOpcodeCount ? kOpcodeNames[Op] : "Unknown";
+}
+
+CommandRecorder::CommandRecorder()
+{
+    m_Stream.reserve(64 * 1024);
+    m_UploadBuffer.resize(kUploadPageSize);
+    m_HeapDescriptors.resize(kNumDescriptorsPerHeap);
+    Reset();
+}
+
+void CommandRecorder::Reset( void )
+{
+    m_Stream.clear();
+    memset(&m_Counters, 0, sizeof(m_Counters));
+
+    m_CurGraphicsRootSignature = 0;
+    m_CurComputeRootSignature = 0;
+    m_CurPipelineState = 0;
+    m_ResourceBarrierBuffer.Clear();
+    m_ResourceBarrierBuffer.ResetCounters();
+
+    m_HeapOffset = kNumDescriptorsPerHeap;
+    m_HeapBound = false;
+    m_GraphicsHandleCache.ClearCache();
+    m_ComputeHandleCache.ClearCache();
+
+    m_GraphicsRootParams.Clear();
+    m_ComputeRootParams.Clear();
+
+    m_GraphicsRootLayout = RootLayout();
+    m_GraphicsRootCBVBitMap = 0;
+    m_NumRenderTargets = 0;
+    m_DepthStencil = 0;
+    memset(m_Viewport, 0, sizeof(m_Viewport));
+    memset(m_Scissor, 0, sizeof(m_Scissor));
+    m_Topology = 0;
+
+    m_UploadOffset = 0;
+}
+
+// Each command is a header word, the opcode in the low byte and the argument count above it, followed
+// by its arguments
+void CommandRecorder::BeginCommand( Opcode Op, uint32_t NumArgs )
+{
+    Write((uint32_t)Op | NumArgs << 8);
+    ++m_Counters.Commands;
+}
+
+bool CommandRecorder::Reader::Next( Command& Cmd )
+{
+    if (m_Cur >= m_End)
+        return false;
+
+    Cmd.Op = (Opcode)(*m_Cur & 0xFF);
+    Cmd.NumArgs = *m_Cur >> 8;
+    Cmd.Args = m_Cur + 1;
+    m_Cur += 1 + Cmd.NumArgs;
+    return true;
+}
+
+void CommandRecorder::Dump( std::ostream& Out ) const
+{
+    Reader Stream(*this);
+    Command Cmd;
+    while (Stream.Next(Cmd))
+    {
+        Out << GetOpcodeName(Cmd.Op);
+        for (uint32_t i = 0; i < Cmd.NumArgs; ++i)
+            Out << (i == 0 ? " " : ", ") << Cmd.Args[i];
+        Out << '\n';
+    }
+}
+
+//
+// Barriers
+//
+
+void CommandRecorder::UpdateBarrierCounters( void )
+{
+    m_Counters.MergedTransitions = m_ResourceBarrierBuffer.GetMergedTransitions();
+    m_Counters.RedundantTransitions = m_ResourceBarrierBuffer.GetRedundantTransitions();
+}
+
+void CommandRecorder::FlushResourceBarriers( void )
+{
+    if (m_ResourceBarrierBuffer.Empty())
+        return;
+
+    uint32_t NumBarriers = m_ResourceBarrierBuffer.Size();
+
+    BeginCommand(kResourceBarrier, 1 + NumBarriers * 5);
+    Write(NumBarriers);
+    for (const Barrier& Desc : m_ResourceBarrierBuffer.GetBarriers())
+    {
+        Write(Desc.Type | Desc.Flags << 8);
+        Write64(Desc.Id);
+        Write(Desc.Before);
+        Write(Desc.After);
+    }
+
+    m_Counters.Barriers += NumBarriers;
+    ++m_Counters.BarrierBatches;
+    m_ResourceBarrierBuffer.Clear();
+}
+
+void CommandRecorder::TransitionResource( Resource& Res, uint32_t NewState, bool FlushImmediate )
+{
+    m_ResourceBarrierBuffer.Transition(Res.Id, Res.UsageState, Res.TransitioningState, NewState);
+    UpdateBarrierCounters();
+
+    if (FlushImmediate)
+        FlushResourceBarriers();
+}
+
+void CommandRecorder::BeginResourceTransition( Resource& Res, uint32_t NewState, bool FlushImmediate )
+{
+    m_ResourceBarrierBuffer.BeginTransition(Res.Id, Res.UsageState, Res.TransitioningState, NewState);
+    UpdateBarrierCounters();
+
+    if (FlushImmediate)
+        FlushResourceBarriers();
+}
+
+void CommandRecorder::InsertUAVBarrier( Resource& Res, bool FlushImmediate )
+{
+    m_ResourceBarrierBuffer.InsertUAVBarrier(Res.Id);
+
+    if (FlushImmediate)
+        FlushResourceBarriers();
+}
+
+//
+// Descriptor tables, staged and committed the way DynamicDescriptorHeap does it
+//
+
+void CommandRecorder::CommitRootDescriptorTables( bool Compute )
+{
+    HandleCache& Cache = Compute ? m_ComputeHandleCache : m_GraphicsHandleCache;
+    if (Cache.m_StaleRootParamsBitMap == 0)
+        return;
+
+    uint32_t NeededSize = Cache.ComputeStagedSize();
+    if (m_HeapOffset + NeededSize > kNumDescriptorsPerHeap)
+    {
+        // Retire the heap.  Everything bound so far must be copied again into the new one.
+        m_HeapOffset = 0;
+        m_HeapBound = false;
+        m_GraphicsHandleCache.UnbindAllValid();
+        m_ComputeHandleCache.UnbindAllValid();
+        NeededSize = Cache.ComputeStagedSize();
+    }
+
+    if (!m_HeapBound)
+    {
+        BeginCommand(kSetDescriptorHeap, 1);
+        Write(m_Counters.DescriptorHeapChanges++);
+        m_HeapBound = true;
+    }
+
+    RootParameterCache& RootParams = Compute ? m_ComputeRootParams : m_GraphicsRootParams;
+
+    // CopyDescriptors takes at most this many source ranges, one per descriptor
+    static const uint32_t kMaxDescriptorsPerCopy = 16;
+    uint32_t NumSrcDescriptorRanges = 0;
+
+    uint32_t StaleParams = Cache.m_StaleRootParamsBitMap;
+    Cache.m_StaleRootParamsBitMap = 0;
+
+    uint32_t RootIndex;
+    while (BitScanForward32(RootIndex, StaleParams))
+    {
+        StaleParams ^= (1 << RootIndex);
+
+        const HandleCache::DescriptorTableCache& Table = Cache.m_RootDescriptorTable[RootIndex];
+        uint32_t SetHandles = Table.AssignedHandlesBitMap;
+        uint32_t TableSize = Cache.GetStagedTableSize(RootIndex);
+        uint32_t GpuOffset = m_HeapOffset;
+        m_HeapOffset += TableSize;
+
+        for (uint32_t i = 0; i < TableSize; ++i)
+            m_HeapDescriptors[GpuOffset + i] = (SetHandles >> i & 1) != 0 ? Table.TableStart[i] : 0;
+
+        // Each run of assigned handles is one destination range with one source range per descriptor
+        while (SetHandles != 0)
+        {
+            uint32_t Skip;
+            BitScanForward32(Skip, SetHandles);
+            SetHandles >>= Skip;
+
+            uint32_t DescriptorCount = 0;
+            BitScanForward32(DescriptorCount, ~SetHandles);
+            if (SetHandles == 0xFFFFFFFF)
+                DescriptorCount = 32;
+            SetHandles = DescriptorCount < 32 ? SetHandles >> DescriptorCount : 0;
+
+            if (NumSrcDescriptorRanges + DescriptorCount > kMaxDescriptorsPerCopy)
+            {
+                ++m_Counters.DescriptorCopyCalls;
+                NumSrcDescriptorRanges = 0;
+            }
+            NumSrcDescriptorRanges += DescriptorCount;
+            m_Counters.DescriptorCopies += DescriptorCount;
+        }
+
+        BeginCommand(Compute ? kSetComputeRootDescriptorTable : kSetGraphicsRootDescriptorTable, 2);
+        Write(RootIndex);
+        Write(GpuOffset);
+        ++m_Counters.RootParameterChanges;
+
+        // Every commit allocates a new table, so tables are never redundant
+        RootParams.Update(RootIndex, nullptr, 0);
+    }
+
+    ++m_Counters.DescriptorCopyCalls;
+}
+
+void CommandRecorder::SetDynamicDescriptors( uint32_t RootIndex, uint32_t Offset, uint32_t Count, const ObjectId Handles[] )
+{
+    m_GraphicsHandleCache.StageDescriptorHandles(RootIndex, Offset, Count, Handles);
+}
+
+void CommandRecorder::SetComputeDynamicDescriptors( uint32_t RootIndex, uint32_t Offset, uint32_t Count, const ObjectId Handles[] )
+{
+    m_ComputeHandleCache.StageDescriptorHandles(RootIndex, Offset, Count, Handles);
+}
+
+//
+// Root signatures, pipelines, and root parameters
+//
+
+bool CommandRecorder::RootParameterCache::Update( uint32_t RootIndex, const void* Data, size_t Size )
+{
+    // FNV-1a, with zero reserved for "unknown"
+    uint64_t Hash = 0xcbf29ce484222325ull;
+    const uint8_t* Bytes = (const uint8_t*)Data;
+    for (size_t i = 0; i < Size; ++i)
+        Hash = (Hash ^ Bytes[i]) * 0x100000001b3ull;
+    Hash = Size == 0 ? 0 : Hash | 1;
+
+    bool Redundant = Hash != 0 && m_Hash[RootIndex] == Hash;
+    m_Hash[RootIndex] = Hash;
+    return Redundant;
+}
+
+void CommandRecorder::SetRootSignature( const RootLayout& RootSig )
+{
+    if (RootSig.Id == m_CurGraphicsRootSignature)
+    {
+        ++m_Counters.RedundantStateChanges;
+        return;
+    }
+
+    BeginCommand(kSetGraphicsRootSignature, 2);
+    Write64(m_CurGraphicsRootSignature = RootSig.Id);
+    ++m_Counters.RootSignatureChanges;
+
+    m_GraphicsRootLayout = RootSig;
+    m_GraphicsRootCBVBitMap = 0;
+
+    m_GraphicsHandleCache.ParseRootSignature(RootSig.NumParameters, RootSig.DescriptorTableBitMap, RootSig.DescriptorTableSize);
+    m_GraphicsRootParams.Clear();
+}
+
+void CommandRecorder::SetComputeRootSignature( const RootLayout& RootSig )
+{
+    if (RootSig.Id == m_CurComputeRootSignature)
+    {
+        ++m_Counters.RedundantStateChanges;
+        return;
+    }
+
+    BeginCommand(kSetComputeRootSignature, 2);
+    Write64(m_CurComputeRootSignature = RootSig.Id);
+    ++m_Counters.RootSignatureChanges;
+
+    m_ComputeHandleCache.ParseRootSignature(RootSig.NumParameters, RootSig.DescriptorTableBitMap, RootSig.DescriptorTableSize);
+    m_ComputeRootParams.Clear();
+}
+
+void CommandRecorder::SetPipelineState( ObjectId PSO )
+{
+    if (PSO == m_CurPipelineState)
+    {
+        ++m_Counters.RedundantStateChanges;
+        return;
+    }
+
+    BeginCommand(kSetPipelineState, 2);
+    Write64(m_CurPipelineState = PSO);
+    ++m_Counters.PipelineChanges;
+}
+
+void CommandRecorder::SetRootConstants( bool Compute, uint32_t RootIndex, uint32_t NumConstants, const void* pConstants )
+{
+    BeginCommand(Compute ? kSetComputeRootConstants : kSetGraphicsRootConstants, 1 + NumConstants);
+    Write(RootIndex);
+    size_t Start = m_Stream.size();
+    m_Stream.resize(Start + NumConstants);
+    memcpy(m_Stream.data() + Start, pConstants, NumConstants * sizeof(uint32_t));
+
+    ++m_Counters.RootParameterChanges;
+    RootParameterCache& RootParams = Compute ? m_ComputeRootParams : m_GraphicsRootParams;
+    if (RootParams.Update(RootIndex, pConstants, NumConstants * sizeof(uint32_t)))
+        ++m_Counters.RedundantRootParameters;
+}
+
+void CommandRecorder::SetRootCBV( bool Compute, uint32_t RootIndex, uint64_t GpuAddress )
+{
+    BeginCommand(Compute ? kSetComputeRootCBV : kSetGraphicsRootCBV, 3);
+    Write(RootIndex);
+    Write64(GpuAddress);
+
+    if (!Compute)
+    {
+        m_GraphicsRootCBVBitMap |= 1 << RootIndex;
+        m_GraphicsRootCBVs[RootIndex] = GpuAddress;
+    }
+
+    ++m_Counters.RootParameterChanges;
+    RootParameterCache& RootParams = Compute ? m_ComputeRootParams : m_GraphicsRootParams;
+    if (RootParams.Update(RootIndex, &GpuAddress, sizeof(GpuAddress)))
+        ++m_Counters.RedundantRootParameters;
+}
+
+uint64_t CommandRecorder::AllocateUpload( size_t BufferSize, const void* BufferData )
+{
+    size_t AlignedSize = (BufferSize + kUploadAlignment - 1) & ~(kUploadAlignment - 1);
+    assert(AlignedSize <= kUploadPageSize);
+
+    if (m_UploadOffset + AlignedSize > kUploadPageSize)
+        m_UploadOffset = 0;
+
+    uint8_t* Data = m_UploadBuffer.data() + m_UploadOffset;
+    memcpy(Data, BufferData, BufferSize);
+    m_UploadOffset += AlignedSize;
+    m_Counters.UploadBytes += AlignedSize;
+    return (uint64_t)(uintptr_t)Data;
+}
+
+void CommandRecorder::SetConstantArray( uint32_t RootIndex, uint32_t NumConstants, const void* pConstants )
+{
+    SetRootConstants(false, RootIndex, NumConstants, pConstants);
+}
+
+void CommandRecorder::SetComputeConstantArray( uint32_t RootIndex, uint32_t NumConstants, const void* pConstants )
+{
+    SetRootConstants(true, RootIndex, NumConstants, pConstants);
+}
+
+void CommandRecorder::SetConstantBuffer( uint32_t RootIndex, uint64_t GpuAddress )
+{
+    SetRootCBV(false, RootIndex, GpuAddress);
+}
+
+void CommandRecorder::SetDynamicConstantBufferView( uint32_t RootIndex, size_t BufferSize, const void* BufferData )
+{
+    SetRootCBV(false, RootIndex, AllocateUpload(BufferSize, BufferData));
+}
+
+void CommandRecorder::SetComputeDynamicConstantBufferView( uint32_t RootIndex, size_t BufferSize, const void* BufferData )
+{
+    SetRootCBV(true, RootIndex, AllocateUpload(BufferSize, BufferData));
+}
+
+//
+// Output merger and input assembler state
+//
+
+void CommandRecorder::SetRenderTargets( uint32_t NumRTVs, const ObjectId RTVs[], ObjectId DSV )
+{
+    assert(NumRTVs <= 8);
+    BeginCommand(kSetRenderTargets, 3 + NumRTVs * 2);
+    Write(NumRTVs);
+    for (uint32_t i = 0; i < NumRTVs; ++i)
+        Write64(m_RenderTargets[i] = RTVs[i]);
+    Write64(m_DepthStencil = DSV);
+    m_NumRenderTargets = NumRTVs;
+}
+
+void CommandRecorder::SetViewport( float x, float y, float w, float h, float minDepth, float maxDepth )
+{
+    BeginCommand(kSetViewport, 6);
+    WriteFloat(x);
+    WriteFloat(y);
+    WriteFloat(w);
+    WriteFloat(h);
+    WriteFloat(minDepth);
+    WriteFloat(maxDepth);
+
+    const float Viewport[6] = { x, y, w, h, minDepth, maxDepth };
+    memcpy(m_Viewport, Viewport, sizeof(m_Viewport));
+}
+
+void CommandRecorder::SetScissor( uint32_t left, uint32_t top, uint32_t right, uint32_t bottom )
+{
+    BeginCommand(kSetScissor, 4);
+    Write(left);
+    Write(top);
+    Write(right);
+    Write(bottom);
+
+    const uint32_t Scissor[4] = { left, top, right, bottom };
+    memcpy(m_Scissor, Scissor, sizeof(m_Scissor));
+}
+
+void CommandRecorder::SetViewportAndScissor( uint32_t x, uint32_t y, uint32_t w, uint32_t h )
+{
+    SetViewport((float)x, (float)y, (float)w, (float)h);
+    SetScissor(x, y, x + w, y + h);
+}
+
+void CommandRecorder::SetPrimitiveTopology( uint32_t Topology )
+{
+    BeginCommand(kSetPrimitiveTopology, 1);
+    Write(m_Topology = Topology);
+}
+
+void CommandRecorder::SetIndexBuffer( ObjectId IndexBuffer )
+{
+    BeginCommand(kSetIndexBuffer, 2);
+    Write64(IndexBuffer);
+}
+
+void CommandRecorder::SetVertexBuffers( uint32_t StartSlot, uint32_t Count, const ObjectId VertexBuffers[] )
+{
+    BeginCommand(kSetVertexBuffers, 2 + Count * 2);
+    Write(StartSlot);
+    Write(Count);
+    for (uint32_t i = 0; i < Count; ++i)
+        Write64(VertexBuffers[i]);
+}
+
+void CommandRecorder::ClearColor( Resource& Target )
+{
+    FlushResourceBarriers();
+    BeginCommand(kClearRenderTarget, 2);
+    Write64(Target.Id);
+}
+
+void CommandRecorder::ClearDepth( Resource& Target )
+{
+    FlushResourceBarriers();
+    BeginCommand(kClearDepthStencil, 2);
+    Write64(Target.Id);
+}
+
+//
+// Work
+//
+
+void CommandRecorder::DrawInstanced( uint32_t VertexCountPerInstance, uint32_t InstanceCount,
+    uint32_t StartVertexLocation, uint32_t StartInstanceLocation )
+{
+    FlushResourceBarriers();
+    CommitRootDescriptorTables(false);
+
+    BeginCommand(kDrawInstanced, 4);
+    Write(VertexCountPerInstance);
+    Write(InstanceCount);
+    Write(StartVertexLocation);
+    Write(StartInstanceLocation);
+
+    ++m_Counters.Draws;
+    m_Counters.Primitives += (uint64_t)VertexCountPerInstance * InstanceCount;
+}
+
+void CommandRecorder::DrawIndexedInstanced( uint32_t IndexCountPerInstance, uint32_t InstanceCount, uint32_t StartIndexLocation,
+    int32_t BaseVertexLocation, uint32_t StartInstanceLocation )
+{
+    FlushResourceBarriers();
+    CommitRootDescriptorTables(false);
+
+    BeginCommand(kDrawIndexedInstanced, 5);
+    Write(IndexCountPerInstance);
+    Write(InstanceCount);
+    Write(StartIndexLocation);
+    Write((uint32_t)BaseVertexLocation);
+    Write(StartInstanceLocation);
+
+    ++m_Counters.Draws;
+    m_Counters.Primitives += (uint64_t)IndexCountPerInstance * InstanceCount;
+}
+
+void CommandRecorder::ExecuteIndirect( ObjectId CommandSignature, Resource& ArgumentBuffer, uint64_t ArgumentStartOffset, uint32_t MaxCommands )
+{
+    FlushResourceBarriers();
+    CommitRootDescriptorTables(false);
+
+    BeginCommand(kExecuteIndirect, 7);
+    Write64(CommandSignature);
+    Write64(ArgumentBuffer.Id);
+    Write64(ArgumentStartOffset);
+    Write(MaxCommands);
+
+    ++m_Counters.Draws;
+}
+
+void CommandRecorder::Dispatch( uint32_t GroupCountX, uint32_t GroupCountY, uint32_t GroupCountZ )
+{
+    FlushResourceBarriers();
+    CommitRootDescriptorTables(true);
+
+    BeginCommand(kDispatch, 3);
+    Write(GroupCountX);
+    Write(GroupCountY);
+    Write(GroupCountZ);
+
+    ++m_Counters.Dispatches;
+}
+
+//
+// Worker recorders
+//
+
+void CommandRecorder::ForkWorkers( uint32_t NumWorkers, CommandRecorder* Workers[] )
+{
+    // Anything the workers draw must come after the barriers recorded so far
+    FlushResourceBarriers();
+
+    for (uint32_t i = 0; i < NumWorkers; ++i)
+        Workers[i]->ApplyGraphicsState(*this);
+}
+
+void CommandRecorder::ApplyGraphicsState( const CommandRecorder& Source )
+{
+    assert(&Source != this);
+    Reset();
+
+    if (Source.m_CurGraphicsRootSignature != 0)
+    {
+        SetRootSignature(Source.m_GraphicsRootLayout);
+
+        uint32_t RootCBVs = Source.m_GraphicsRootCBVBitMap;
+        uint32_t RootIndex;
+        while (BitScanForward32(RootIndex, RootCBVs))
+        {
+            RootCBVs ^= (1 << RootIndex);
+            SetRootCBV(false, RootIndex, Source.m_GraphicsRootCBVs[RootIndex]);
+        }
+
+        // The staged descriptors are copied into this recorder's own heap on its first draw
+        m_GraphicsHandleCache.CopyStagedHandles(Source.m_GraphicsHandleCache, 0);
+    }
+
+    if (Source.m_CurPipelineState != 0)
+        SetPipelineState(Source.m_CurPipelineState);
+
+    if (Source.m_NumRenderTargets > 0 || Source.m_DepthStencil != 0)
+        SetRenderTargets(Source.m_NumRenderTargets, Source.m_RenderTargets, Source.m_DepthStencil);
+    if (Source.m_Viewport[2] > 0.0f)
+        SetViewport(Source.m_Viewport[0], Source.m_Viewport[1], Source.m_Viewport[2], Source.m_Viewport[3],
+            Source.m_Viewport[4], Source.m_Viewport[5]);
+    if (Source.m_Scissor[2] > Source.m_Scissor[0])
+        SetScissor(Source.m_Scissor[0], Source.m_Scissor[1], Source.m_Scissor[2], Source.m_Scissor[3]);
+    if (Source.m_Topology != 0)
+        SetPrimitiveTopology(Source.m_Topology);
+}
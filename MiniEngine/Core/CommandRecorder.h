@@ -0,0 +1,350 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  A command context that needs no device.  It takes the same calls as GraphicsContext
+// and ComputeContext, runs the same CPU-side bookkeeping (redundant state filtering, batched resource
+// transitions, and DynamicDescriptorHeap's staging of descriptor tables), and encodes what would reach
+// the command list into a compact stream of 32-bit words.  Draws, barriers, descriptor copies, and
+// root parameter changes are counted as they are recorded.
+//
+// Only the identity of root signatures, pipeline states, resources, and descriptors matters, so they
+// are passed as opaque 64-bit ids.  The recorder doesn't include any Windows or D3D12 headers and
+// builds on any platform, which makes it usable from benchmarks and tests without a GPU.
+//
+
+#pragma once
+
+#include "DescriptorHandleCache.h"
+#include "ResourceBarrierQueue.h"
+
+#include <cstdint>
+#include <cstring>
+#include <iosfwd>
+#include <vector>
+
+class CommandRecorder
+{
+public:
+
+    typedef uint64_t ObjectId;
+
+    // Values of D3D12_RESOURCE_STATES that the recorder treats specially
+    enum : uint32_t
+    {
+        kStateCommon = 0x0,
+        kStateUnorderedAccess = 0x8,
+        kStateInvalid = 0xFFFFFFFF
+    };
+
+    // What a root signature looks like to the descriptor cache:  which parameters are descriptor tables,
+    // and how many descriptors each one holds.  RootSignature keeps the same fields.
+    struct RootLayout
+    {
+        RootLayout() : Id(0), NumParameters(0), DescriptorTableBitMap(0)
+        {
+            memset(DescriptorTableSize, 0, sizeof(DescriptorTableSize));
+        }
+
+        void SetDescriptorTable( uint32_t RootIndex, uint32_t TableSize )
+        {
+            DescriptorTableBitMap |= 1 << RootIndex;
+            DescriptorTableSize[RootIndex] = TableSize;
+            if (RootIndex >= NumParameters)
+                NumParameters = RootIndex + 1;
+        }
+
+        ObjectId Id;
+        uint32_t NumParameters;
+        uint32_t DescriptorTableBitMap;
+        uint32_t DescriptorTableSize[16];
+    };
+
+    // Plays the part of GpuResource, which owns its usage state
+    struct Resource
+    {
+        Resource( ObjectId id = 0, uint32_t State = kStateCommon ) :
+            Id(id), UsageState(State), TransitioningState(kStateInvalid) {}
+
+        ObjectId Id;
+        uint32_t UsageState;
+        uint32_t TransitioningState;
+    };
+
+    enum Opcode : uint8_t
+    {
+        kSetGraphicsRootSignature,
+        kSetComputeRootSignature,
+        kSetPipelineState,
+        kSetDescriptorHeap,
+        kSetGraphicsRootConstants,
+        kSetComputeRootConstants,
+        kSetGraphicsRootCBV,
+        kSetComputeRootCBV,
+        kSetGraphicsRootDescriptorTable,
+        kSetComputeRootDescriptorTable,
+        kResourceBarrier,
+        kSetRenderTargets,
+        kSetViewport,
+        kSetScissor,
+        kSetPrimitiveTopology,
+        kSetIndexBuffer,
+        kSetVertexBuffers,
+        kClearRenderTarget,
+        kClearDepthStencil,
+        kDrawInstanced,
+        kDrawIndexedInstanced,
+        kDispatch,
+        kExecuteIndirect,
+        kOpcodeCount
+    };
+
+    static const char* GetOpcodeName( Opcode Op );
+
+    struct Counters
+    {
+        uint32_t Commands;
+        uint32_t Draws;
+        uint32_t Dispatches;
+        uint64_t Primitives;            // Index or vertex count times instance count
+        uint32_t Barriers;              // Individual barriers
+        uint32_t BarrierBatches;        // ResourceBarrier calls
+        uint32_t RedundantTransitions;  // Transitions to the state a resource is already in
+        uint32_t MergedTransitions;     // Transitions folded into one still waiting to be flushed
+        uint32_t DescriptorCopies;      // Descriptors copied into the shader visible heap
+        uint32_t DescriptorCopyCalls;   // CopyDescriptors calls
+        uint32_t DescriptorHeapChanges;
+        uint32_t RootSignatureChanges;
+        uint32_t PipelineChanges;
+        uint32_t RedundantStateChanges; // Root signatures and pipelines filtered out as already bound
+        uint32_t RootParameterChanges;  // Constants, CBVs, and descriptor tables set on the command list
+        uint32_t RedundantRootParameters; // Of those, how many repeated the value already bound
+        uint64_t UploadBytes;           // Dynamic constant data, after alignment
+    };
+
+    CommandRecorder();
+
+    // Clears the stream, counters, and bound state.  Memory is kept for the next frame.
+    void Reset( void );
+
+    const Counters& GetCounters( void ) const { return m_Counters; }
+    const std::vector<uint32_t>& GetStream( void ) const { return m_Stream; }
+    size_t GetStreamBytes( void ) const { return m_Stream.size() * sizeof(uint32_t); }
+
+    // Prints one line per recorded command
+    void Dump( std::ostream& Out ) const;
+
+    // The descriptor the last committed tables copied to Offset of the shader visible heap
+    ObjectId GetHeapDescriptor( uint32_t Offset ) const { return m_HeapDescriptors[Offset]; }
+
+    // Dynamic constant buffers are bound by the address of their copy in the upload ring, so the data
+    // behind a recorded CBV can be read back until the ring wraps
+    static const void* GetUploadData( uint64_t GpuAddress ) { return (const void*)(uintptr_t)GpuAddress; }
+
+    // Walks the encoded stream
+    struct Command
+    {
+        Opcode Op;
+        uint32_t NumArgs;
+        const uint32_t* Args;
+    };
+
+    class Reader
+    {
+    public:
+        Reader( const CommandRecorder& Recorder ) : m_Cur(Recorder.m_Stream.data()), m_End(m_Cur + Recorder.m_Stream.size()) {}
+        bool Next( Command& Cmd );
+
+    private:
+        const uint32_t* m_Cur;
+        const uint32_t* m_End;
+    };
+
+    //
+    // CommandContext
+    //
+
+    void TransitionResource( Resource& Res, uint32_t NewState, bool FlushImmediate = false );
+    void BeginResourceTransition( Resource& Res, uint32_t NewState, bool FlushImmediate = false );
+    void InsertUAVBarrier( Resource& Res, bool FlushImmediate = false );
+    void FlushResourceBarriers( void );
+
+    //
+    // GraphicsContext
+    //
+
+    void SetRootSignature( const RootLayout& RootSig );
+    void SetPipelineState( ObjectId PSO );
+
+    void SetConstantArray( uint32_t RootIndex, uint32_t NumConstants, const void* pConstants );
+    void SetConstants( uint32_t RootIndex, uint32_t X ) { SetConstantArray(RootIndex, 1, &X); }
+    void SetConstants( uint32_t RootIndex, uint32_t X, uint32_t Y ) { uint32_t V[] = { X, Y }; SetConstantArray(RootIndex, 2, V); }
+    void SetConstants( uint32_t RootIndex, uint32_t X, uint32_t Y, uint32_t Z ) { uint32_t V[] = { X, Y, Z }; SetConstantArray(RootIndex, 3, V); }
+    void SetConstants( uint32_t RootIndex, uint32_t X, uint32_t Y, uint32_t Z, uint32_t W ) { uint32_t V[] = { X, Y, Z, W }; SetConstantArray(RootIndex, 4, V); }
+    void SetConstantBuffer( uint32_t RootIndex, uint64_t GpuAddress );
+    void SetDynamicConstantBufferView( uint32_t RootIndex, size_t BufferSize, const void* BufferData );
+
+    void SetDynamicDescriptors( uint32_t RootIndex, uint32_t Offset, uint32_t Count, const ObjectId Handles[] );
+    void SetDynamicDescriptor( uint32_t RootIndex, uint32_t Offset, ObjectId Handle ) { SetDynamicDescriptors(RootIndex, Offset, 1, &Handle); }
+
+    // Accepts D3D12_CPU_DESCRIPTOR_HANDLE or anything else that wraps a 64-bit value
+    template <typename THandle>
+    void SetDynamicDescriptors( uint32_t RootIndex, uint32_t Offset, uint32_t Count, const THandle Handles[] )
+    {
+        static_assert(sizeof(THandle) == sizeof(ObjectId), "Descriptor handles must be 64 bits");
+        SetDynamicDescriptors(RootIndex, Offset, Count, reinterpret_cast<const ObjectId*>(Handles));
+    }
+
+    void SetRenderTargets( uint32_t NumRTVs, const ObjectId RTVs[], ObjectId DSV = 0 );
+    void SetViewport( float x, float y, float w, float h, float minDepth = 0.0f, float maxDepth = 1.0f );
+    void SetScissor( uint32_t left, uint32_t top, uint32_t right, uint32_t bottom );
+    void SetViewportAndScissor( uint32_t x, uint32_t y, uint32_t w, uint32_t h );
+    void SetPrimitiveTopology( uint32_t Topology );
+    void SetIndexBuffer( ObjectId IndexBuffer );
+    void SetVertexBuffers( uint32_t StartSlot, uint32_t Count, const ObjectId VertexBuffers[] );
+
+    void ClearColor( Resource& Target );
+    void ClearDepth( Resource& Target );
+
+    void Draw( uint32_t VertexCount, uint32_t VertexStartOffset = 0 ) { DrawInstanced(VertexCount, 1, VertexStartOffset, 0); }
+    void DrawIndexed( uint32_t IndexCount, uint32_t StartIndexLocation = 0, int32_t BaseVertexLocation = 0 ) { DrawIndexedInstanced(IndexCount, 1, StartIndexLocation, BaseVertexLocation, 0); }
+    void DrawInstanced( uint32_t VertexCountPerInstance, uint32_t InstanceCount, uint32_t StartVertexLocation = 0, uint32_t StartInstanceLocation = 0 );
+    void DrawIndexedInstanced( uint32_t IndexCountPerInstance, uint32_t InstanceCount, uint32_t StartIndexLocation,
+        int32_t BaseVertexLocation, uint32_t StartInstanceLocation );
+    void ExecuteIndirect( ObjectId CommandSignature, Resource& ArgumentBuffer, uint64_t ArgumentStartOffset = 0, uint32_t MaxCommands = 1 );
+
+    // Starts each worker the way GraphicsContext::ForkWorkers does:  pending barriers are flushed here, and
+    // every worker is reset and given this recorder's root signature, pipeline state, root CBVs, staged
+    // descriptor tables, render targets, viewport, scissor and topology.  This stream followed by each
+    // worker's in index order is what JoinWorkers would submit.
+    void ForkWorkers( uint32_t NumWorkers, CommandRecorder* Workers[] );
+
+    //
+    // ComputeContext
+    //
+
+    void SetComputeRootSignature( const RootLayout& RootSig );
+    void SetComputeConstantArray( uint32_t RootIndex, uint32_t NumConstants, const void* pConstants );
+    void SetComputeDynamicConstantBufferView( uint32_t RootIndex, size_t BufferSize, const void* BufferData );
+    void SetComputeDynamicDescriptors( uint32_t RootIndex, uint32_t Offset, uint32_t Count, const ObjectId Handles[] );
+    void Dispatch( uint32_t GroupCountX = 1, uint32_t GroupCountY = 1, uint32_t GroupCountZ = 1 );
+
+private:
+
+    CommandRecorder( const CommandRecorder& ) = delete;
+    CommandRecorder& operator=( const CommandRecorder& ) = delete;
+
+    // DynamicDescriptorHeap's handle cache, holding ids rather than CPU descriptor handles
+    typedef DescriptorHandleCache<ObjectId> HandleCache;
+
+    // Last value set on each root parameter, to spot redundant sets
+    struct RootParameterCache
+    {
+        void Clear( void ) { memset(m_Hash, 0, sizeof(m_Hash)); }
+        bool Update( uint32_t RootIndex, const void* Data, size_t Size );
+
+        uint64_t m_Hash[16];
+    };
+
+    void BeginCommand( Opcode Op, uint32_t NumArgs );
+    void Write( uint32_t Word ) { m_Stream.push_back(Word); }
+    void Write64( uint64_t Value ) { Write((uint32_t)Value); Write((uint32_t)(Value >> 32)); }
+    void WriteFloat( float Value ) { uint32_t Word; memcpy(&Word, &Value, sizeof(Word)); Write(Word); }
+
+    // Barriers are queued and merged by the same ResourceBarrierQueue as CommandContext's until the next
+    // flush.  Type and Flags hold D3D12_RESOURCE_BARRIER_TYPE and D3D12_RESOURCE_BARRIER_FLAGS values.
+    struct Barrier
+    {
+        uint32_t Type;
+        uint32_t Flags;
+        ObjectId Id;
+        uint32_t Before;
+        uint32_t After;
+    };
+
+    struct BarrierTraits
+    {
+        enum : uint32_t { kTypeTransition = 0, kTypeUAV = 2 };
+
+        typedef CommandRecorder::Barrier Barrier;
+        typedef ObjectId ResourceId;
+        typedef uint32_t State;
+        typedef uint32_t Flags;
+
+        static const Flags kFlagNone = 0;
+        static const Flags kFlagBeginOnly = 1;
+        static const Flags kFlagEndOnly = 2;
+
+        static State InvalidState( void ) { return kStateInvalid; }
+        static State UnorderedAccessState( void ) { return kStateUnorderedAccess; }
+
+        static Barrier MakeTransition( ObjectId Id, State Before, State After, Flags BarrierFlags )
+        {
+            Barrier Desc = { kTypeTransition, BarrierFlags, Id, Before, After };
+            return Desc;
+        }
+
+        static Barrier MakeUAV( ObjectId Id )
+        {
+            Barrier Desc = { kTypeUAV, kFlagNone, Id, 0, 0 };
+            return Desc;
+        }
+
+        static Flags& GetFlags( Barrier& Desc ) { return Desc.Flags; }
+        static State& StateBefore( Barrier& Desc ) { return Desc.Before; }
+        static State& StateAfter( Barrier& Desc ) { return Desc.After; }
+
+        static BarrierQueue::PendingMatch Match( const Barrier& Desc, ObjectId Id )
+        {
+            if (Desc.Id != Id)
+                return BarrierQueue::kUnrelated;
+            return Desc.Type == kTypeTransition ? BarrierQueue::kTransition : BarrierQueue::kBlocked;
+        }
+    };
+
+    void UpdateBarrierCounters( void );
+    void SetRootConstants( bool Compute, uint32_t RootIndex, uint32_t NumConstants, const void* pConstants );
+    void SetRootCBV( bool Compute, uint32_t RootIndex, uint64_t GpuAddress );
+    uint64_t AllocateUpload( size_t BufferSize, const void* BufferData );
+    void CommitRootDescriptorTables( bool Compute );
+    void ApplyGraphicsState( const CommandRecorder& Source );
+
+    std::vector<uint32_t> m_Stream;
+    Counters m_Counters;
+
+    ObjectId m_CurGraphicsRootSignature;
+    ObjectId m_CurComputeRootSignature;
+    ObjectId m_CurPipelineState;
+
+    ResourceBarrierQueue<BarrierTraits> m_ResourceBarrierBuffer;
+
+    // The shader visible heap holds DynamicDescriptorHeap::kNumDescriptorsPerHeap descriptors
+    static const uint32_t kNumDescriptorsPerHeap = 1024;
+    uint32_t m_HeapOffset;
+    bool m_HeapBound;
+    std::vector<ObjectId> m_HeapDescriptors;
+    HandleCache m_GraphicsHandleCache;
+    HandleCache m_ComputeHandleCache;
+
+    RootParameterCache m_GraphicsRootParams;
+    RootParameterCache m_ComputeRootParams;
+
+    // The graphics state a worker inherits, as CommandContext keeps it.  Root constants aren't inherited.
+    RootLayout m_GraphicsRootLayout;
+    uint32_t m_GraphicsRootCBVBitMap;
+    uint64_t m_GraphicsRootCBVs[16];
+    uint32_t m_NumRenderTargets;
+    ObjectId m_RenderTargets[8];
+    ObjectId m_DepthStencil;
+    float m_Viewport[6];
+    uint32_t m_Scissor[4];
+    uint32_t m_Topology;
+
+    // Dynamic constants are copied into a ring the size of a LinearAllocator CPU page
+    std::vector<uint8_t> m_UploadBuffer;
+    size_t m_UploadOffset;
+};
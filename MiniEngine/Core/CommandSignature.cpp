@@ -18,7 +18,7 @@
 
 using namespace Graphics;
 
-void CommandSignature::Finalize( const RootSignature* RootSignature )
+void CommandSignature::Finalize( const RootSignature* RootSignature, UINT PaddedByteStride )
 {
     if (m_Finalized)
         return;
@@ -58,6 +58,12 @@ void CommandSignature::Finalize( const RootSignature* RootSignature )
         }
     }
 
+    if (PaddedByteStride != 0)
+    {
+        ASSERT(PaddedByteStride >= ByteStride && PaddedByteStride % 4 == 0);
+        ByteStride = PaddedByteStride;
+    }
+
     D3D12_COMMAND_SIGNATURE_DESC CommandSignatureDesc;
     CommandSignatureDesc.ByteStride = ByteStride;
     CommandSignatureDesc.NumArgumentDescs = m_NumParameters;
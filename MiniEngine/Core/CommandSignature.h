@@ -124,7 +124,8 @@ public:
         return m_ParamArray.get()[EntryIndex];
     }
 
-    void Finalize( const RootSignature* RootSignature = nullptr );
+    // A ByteStride of 0 packs the arguments; a larger one leaves padding at the end of each command
+    void Finalize( const RootSignature* RootSignature = nullptr, UINT ByteStride = 0 );
 
     ID3D12CommandSignature* GetSignature() const { return m_Signature.Get(); }
 
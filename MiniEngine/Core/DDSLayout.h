@@ -0,0 +1,85 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//--------------------------------------------------------------------------------------
+//
+// Device-independent DDS parsing.  ParseDDSLayout() validates the headers of a DDS file
+// image and produces a compact plan describing where every subresource lives inside
+// that image.  Nothing is copied and no Direct3D device is required, so the plan can
+// be built straight from a memory-mapped file and used to decide which subresources
+// to upload (e.g. mip tails first, or skipping top mips under memory pressure).
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <d3d12.h>
+#include <vector>
+
+#include "dds.h"
+#include "DDSTextureLoader.h"
+
+// Location and pitch of one subresource relative to the start of the DDS file image
+struct DDSSubresourceLayout
+{
+    uint32_t Offset;
+    uint32_t RowPitch;
+    uint32_t SlicePitch;
+    uint16_t Width;
+    uint16_t Height;
+    uint16_t Depth;
+};
+
+struct DDSTextureLayout
+{
+    D3D12_RESOURCE_DIMENSION Dimension;
+    DXGI_FORMAT Format;
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t Depth;
+    uint32_t MipCount;
+    uint32_t ArraySize;     // Number of array slices; (NumCubes * 6) for cube maps
+    bool IsCubeMap;
+    DDS_ALPHA_MODE AlphaMode;
+
+    // Subresources are stored in file order:  all mips of item 0, then all mips of item 1, ...
+    // This matches D3D12 subresource indexing (Mip + Item * MipCount).
+    std::vector<DDSSubresourceLayout> Subresources;
+
+    const DDSSubresourceLayout& GetSubresource( uint32_t Item, uint32_t Mip ) const
+    {
+        return Subresources[Item * MipCount + Mip];
+    }
+
+    // Number of top mips that exceed maxsize in any dimension (0 when maxsize is 0)
+    uint32_t ComputeSkipMips( size_t maxsize ) const;
+
+    // Bytes of texel data occupied by all subresources when the top SkipMips are dropped
+    size_t GetDataSize( uint32_t SkipMips = 0 ) const;
+};
+
+// Validates the DDS magic, headers, format and dimension limits, and that the file image is large
+// enough to hold every subresource.  Returns the same HRESULTs as CreateDDSTextureFromMemory().
+HRESULT ParseDDSLayout( _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+                        _In_ size_t ddsDataSize,
+                        _Out_ DDSTextureLayout& layout );
+
+// Resolves the plan against the file image, dropping the top SkipMips of every array item.  The output
+// array must hold (MipCount - SkipMips) * ArraySize entries and points directly into ddsData.
+void FillDDSSubresourceData( _In_ const DDSTextureLayout& layout,
+                             _In_ const uint8_t* ddsData,
+                             _In_ uint32_t SkipMips,
+                             _Out_ D3D12_SUBRESOURCE_DATA* initData );
+
+void GetSurfaceInfo( _In_ size_t width,
+                     _In_ size_t height,
+                     _In_ DXGI_FORMAT fmt,
+                     _Out_opt_ size_t* outNumBytes,
+                     _Out_opt_ size_t* outRowBytes,
+                     _Out_opt_ size_t* outNumRows );
+
+DXGI_FORMAT GetDXGIFormat( const DirectX::DDS_PIXELFORMAT& ddpf );
@@ -55,4 +55,16 @@ HRESULT __cdecl CreateDDSTextureFromFile( _In_ DX12_DEVICE* d3dDevice,
                                             _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
                                             );
 
+// Creates a texture from a layout produced by ParseDDSLayout(), dropping the top skipMips of every
+// array item.  ddsData must be the same file image (e.g. a mapped view) the layout was parsed from.
+struct DDSTextureLayout;
+HRESULT __cdecl CreateDDSTextureFromLayout( _In_ DX12_DEVICE* d3dDevice,
+                                            _In_ const DDSTextureLayout& layout,
+                                            _In_ const uint8_t* ddsData,
+                                            _In_ uint32_t skipMips,
+                                            _In_ bool forceSRGB,
+                                            _Outptr_opt_ ID3D12Resource** texture,
+                                            _In_ D3D12_CPU_DESCRIPTOR_HANDLE textureView
+                                            );
+
 size_t BitsPerPixel(_In_ DXGI_FORMAT fmt);
@@ -40,6 +40,37 @@ void DepthBuffer::Create( const std::wstring& Name, uint32_t Width, uint32_t Hei
     CreateDerivedViews(Graphics::g_Device, Format);
 }
 
+void DepthBuffer::CreateArray( const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t ArrayCount, DXGI_FORMAT Format )
+{
+    D3D12_RESOURCE_DESC ResourceDesc = DescribeTex2D(Width, Height, ArrayCount, 1, Format, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
+
+    D3D12_CLEAR_VALUE ClearValue = {};
+    ClearValue.Format = Format;
+    CreateTextureResource(Graphics::g_Device, Name, ResourceDesc, ClearValue);
+    CreateDerivedViews(Graphics::g_Device, Format);
+}
+
+void DepthBuffer::Destroy( void )
+{
+    // Without a stencil format the read-only stencil views alias the depth views
+    if (m_hDSV[2].ptr == m_hDSV[0].ptr)
+    {
+        m_hDSV[2].ptr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN;
+        m_hDSV[3].ptr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN;
+    }
+
+    for (uint32_t i = 0; i < 4; ++i)
+        Graphics::FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_DSV, m_hDSV[i]);
+    for (D3D12_CPU_DESCRIPTOR_HANDLE& SliceDSV : m_hSliceDSV)
+        Graphics::FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_DSV, SliceDSV);
+    m_hSliceDSV.clear();
+
+    Graphics::FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_hDepthSRV);
+    Graphics::FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_hStencilSRV);
+
+    PixelBuffer::Destroy();
+}
+
 void DepthBuffer::Create( const std::wstring& Name, uint32_t Width, uint32_t Height, DXGI_FORMAT Format, EsramAllocator& )
 {
     Create(Name, Width, Height, Format);
@@ -63,10 +94,18 @@ void DepthBuffer::RecreatePlaced( uint32_t Width, uint32_t Height, uint32_t Samp
 void DepthBuffer::CreateDerivedViews( DX12_DEVICE* Device, DXGI_FORMAT Format )
 {
     ID3D12Resource* Resource = m_pResource.Get();
+    const uint32_t ArrayCount = Resource->GetDesc().DepthOrArraySize;
 
     D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc;
     dsvDesc.Format = GetDSVFormat(Format);
-    if (Resource->GetDesc().SampleDesc.Count == 1)
+    if (ArrayCount > 1)
+    {
+        dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2DARRAY;
+        dsvDesc.Texture2DArray.MipSlice = 0;
+        dsvDesc.Texture2DArray.FirstArraySlice = 0;
+        dsvDesc.Texture2DArray.ArraySize = ArrayCount;
+    }
+    else if (Resource->GetDesc().SampleDesc.Count == 1)
     {
         dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
         dsvDesc.Texture2D.MipSlice = 0;
@@ -88,6 +127,21 @@ void DepthBuffer::CreateDerivedViews( DX12_DEVICE* Device, DXGI_FORMAT Format )
     dsvDesc.Flags = D3D12_DSV_FLAG_READ_ONLY_DEPTH;
     Device->CreateDepthStencilView(Resource, &dsvDesc, m_hDSV[1]);
 
+    if (ArrayCount > 1)
+    {
+        while (m_hSliceDSV.size() < ArrayCount)
+            m_hSliceDSV.push_back(Graphics::AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_DSV));
+
+        D3D12_DEPTH_STENCIL_VIEW_DESC sliceDesc = dsvDesc;
+        sliceDesc.Flags = D3D12_DSV_FLAG_NONE;
+        sliceDesc.Texture2DArray.ArraySize = 1;
+        for (uint32_t Slice = 0; Slice < ArrayCount; ++Slice)
+        {
+            sliceDesc.Texture2DArray.FirstArraySlice = Slice;
+            Device->CreateDepthStencilView(Resource, &sliceDesc, m_hSliceDSV[Slice]);
+        }
+    }
+
     DXGI_FORMAT stencilReadFormat = GetStencilFormat(Format);
     if (stencilReadFormat != DXGI_FORMAT_UNKNOWN)
     {
@@ -115,7 +169,14 @@ void DepthBuffer::CreateDerivedViews( DX12_DEVICE* Device, DXGI_FORMAT Format )
     // Create the shader resource view
     D3D12_SHADER_RESOURCE_VIEW_DESC SRVDesc = {};
     SRVDesc.Format = GetDepthFormat(Format);
-    if (dsvDesc.ViewDimension == D3D12_DSV_DIMENSION_TEXTURE2D)
+    if (dsvDesc.ViewDimension == D3D12_DSV_DIMENSION_TEXTURE2DARRAY)
+    {
+        SRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+        SRVDesc.Texture2DArray.MipLevels = 1;
+        SRVDesc.Texture2DArray.FirstArraySlice = 0;
+        SRVDesc.Texture2DArray.ArraySize = ArrayCount;
+    }
+    else if (dsvDesc.ViewDimension == D3D12_DSV_DIMENSION_TEXTURE2D)
     {
         SRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
         SRVDesc.Texture2D.MipLevels = 1;
@@ -50,9 +50,16 @@ public:
     void CreatePlaced( const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t NumSamples,
         DXGI_FORMAT Format, ID3D12Heap *Heap, UINT64 HeapOffset );
 
+    // Create an array of depth buffers.  GetDSV() and the SRVs cover every slice, and GetSliceDSV()
+    // renders to one slice at a time.
+    void CreateArray( const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t ArrayCount, DXGI_FORMAT Format );
+
     void RecreatePlaced( uint32_t Width, uint32_t Height, uint32_t NumSamples, DXGI_FORMAT Format,
         ID3D12Heap *Heap, UINT64 HeapOffset );
 
+    // Releases the resource and its views
+    virtual void Destroy(void) override;
+
     // Get pre-created CPU-visible descriptor handles
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetDSV() const { return m_hDSV[0]; }
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetDSV_DepthReadOnly() const { return m_hDSV[1]; }
@@ -60,6 +67,7 @@ public:
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetDSV_ReadOnly() const { return m_hDSV[3]; }
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetDepthSRV() const { return m_hDepthSRV; }
     const D3D12_CPU_DESCRIPTOR_HANDLE& GetStencilSRV() const { return m_hStencilSRV; }
+    const D3D12_CPU_DESCRIPTOR_HANDLE& GetSliceDSV( uint32_t ArraySlice ) const { return m_hSliceDSV[ArraySlice]; }
 
     float GetClearDepth() const { return m_ClearDepth; }
     uint8_t GetClearStencil() const { return m_ClearStencil; }
@@ -76,4 +84,5 @@ private:
     D3D12_CPU_DESCRIPTOR_HANDLE m_hDSV[4];
     D3D12_CPU_DESCRIPTOR_HANDLE m_hDepthSRV;
     D3D12_CPU_DESCRIPTOR_HANDLE m_hStencilSRV;
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> m_hSliceDSV;
 };
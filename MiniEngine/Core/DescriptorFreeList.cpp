@@ -0,0 +1,181 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Built without the precompiled header so it has no dependency on Windows
+#include "DescriptorFreeList.h"
+#include <cassert>
+
+DescriptorFreeList::DescriptorFreeList()
+    : m_CurrentHandle(kInvalidHandle), m_CurrentOffset(0), m_RemainingInHeap(0), m_DescriptorSize(0), m_NumHeaps(0),
+    m_LiveDescriptors(0), m_FreeDescriptors(0), m_RetiredDescriptors(0)
+{
+}
+
+uint32_t DescriptorFreeList::SizeClass( uint32_t Count )
+{
+    assert(Count > 0 && Count <= kMaxCount);
+
+    uint32_t Class = 0;
+    while (ClassCount(Class) < Count)
+        ++Class;
+    return Class;
+}
+
+void DescriptorFreeList::PushFree( uint64_t Handle, uint32_t SizeClass )
+{
+    m_FreeDescriptors += ClassCount(SizeClass);
+
+    auto Heap = m_Heaps.upper_bound(Handle);
+    assert(Heap != m_Heaps.begin() && "Range is not in any heap");
+    --Heap;
+    const uint64_t HeapBase = Heap->first;
+    const uint32_t HeapSize = Heap->second;
+
+    while (SizeClass + 1 < kNumSizeClasses)
+    {
+        const uint32_t Offset = (uint32_t)((Handle - HeapBase) / m_DescriptorSize);
+        const uint32_t BuddyOffset = Offset ^ ClassCount(SizeClass);
+        if (BuddyOffset + ClassCount(SizeClass) > HeapSize)
+            break;
+
+        const uint64_t Buddy = HeapBase + (uint64_t)BuddyOffset * m_DescriptorSize;
+        if (m_FreeLists[SizeClass].erase(Buddy) == 0)
+            break;
+
+        if (Buddy < Handle)
+            Handle = Buddy;
+        ++SizeClass;
+    }
+
+    m_FreeLists[SizeClass].insert(Handle);
+}
+
+void DescriptorFreeList::ReleaseHeapSpace( uint32_t Count )
+{
+    assert(Count <= m_RemainingInHeap);
+
+    while (Count > 0)
+    {
+        // The largest range that fits and is aligned to its size
+        uint32_t Class = kNumSizeClasses - 1;
+        while (ClassCount(Class) > Count || (m_CurrentOffset & (ClassCount(Class) - 1)) != 0)
+            --Class;
+
+        PushFree(m_CurrentHandle, Class);
+        m_CurrentHandle += (uint64_t)ClassCount(Class) * m_DescriptorSize;
+        m_CurrentOffset += ClassCount(Class);
+        m_RemainingInHeap -= ClassCount(Class);
+        Count -= ClassCount(Class);
+    }
+}
+
+void DescriptorFreeList::AddHeap( uint64_t BaseHandle, uint32_t NumDescriptors )
+{
+    assert(m_DescriptorSize != 0);
+
+    // The tail of the old heap goes to the free lists so that it is not wasted
+    ReleaseHeapSpace(m_RemainingInHeap);
+
+    m_Heaps[BaseHandle] = NumDescriptors;
+    m_CurrentHandle = BaseHandle;
+    m_CurrentOffset = 0;
+    m_RemainingInHeap = NumDescriptors;
+    ++m_NumHeaps;
+}
+
+uint64_t DescriptorFreeList::Allocate( uint32_t Count )
+{
+    const uint32_t Class = SizeClass(Count);
+
+    // Reuse a free range, splitting the smallest larger one if this class has run dry.  The unused
+    // halves go back to the lists below.
+    for (uint32_t Source = Class; Source < kNumSizeClasses; ++Source)
+    {
+        std::set<uint64_t>& List = m_FreeLists[Source];
+        if (List.empty())
+            continue;
+
+        uint64_t Handle = *List.begin();
+        List.erase(List.begin());
+        m_FreeDescriptors -= ClassCount(Source);
+
+        // The upper halves' buddies are the lower halves, which are in use, so they won't merge
+        while (Source > Class)
+        {
+            --Source;
+            m_FreeLists[Source].insert(Handle + (uint64_t)ClassCount(Source) * m_DescriptorSize);
+            m_FreeDescriptors += ClassCount(Source);
+        }
+
+        m_LiveDescriptors += ClassCount(Class);
+        return Handle;
+    }
+
+    // Carve from the current heap, skipping to the next offset aligned to the class size
+    const uint32_t Padding = (ClassCount(Class) - (m_CurrentOffset & (ClassCount(Class) - 1))) & (ClassCount(Class) - 1);
+    if (m_RemainingInHeap < Padding + ClassCount(Class))
+        return kInvalidHandle;
+
+    ReleaseHeapSpace(Padding);
+
+    uint64_t Handle = m_CurrentHandle;
+    m_CurrentHandle += (uint64_t)ClassCount(Class) * m_DescriptorSize;
+    m_CurrentOffset += ClassCount(Class);
+    m_RemainingInHeap -= ClassCount(Class);
+    m_LiveDescriptors += ClassCount(Class);
+    return Handle;
+}
+
+void DescriptorFreeList::Free( uint64_t Handle, uint32_t Count, uint64_t FenceValue )
+{
+    assert(Handle != kInvalidHandle);
+
+    const uint32_t Class = SizeClass(Count);
+    assert(m_LiveDescriptors >= ClassCount(Class) && "Freeing more descriptors than were allocated");
+    m_LiveDescriptors -= ClassCount(Class);
+
+    if (FenceValue == 0)
+    {
+        PushFree(Handle, Class);
+        return;
+    }
+
+    assert(m_Retired.empty() || m_Retired.back().FenceValue <= FenceValue);
+
+    RetiredRange Range = { FenceValue, Handle, Class };
+    m_Retired.push_back(Range);
+    m_RetiredDescriptors += ClassCount(Class);
+}
+
+void DescriptorFreeList::ReclaimRetired( uint64_t FenceValue )
+{
+    while (!m_Retired.empty() && m_Retired.front().FenceValue <= FenceValue)
+    {
+        const RetiredRange& Range = m_Retired.front();
+        PushFree(Range.Handle, Range.SizeClass);
+        m_RetiredDescriptors -= ClassCount(Range.SizeClass);
+        m_Retired.pop_front();
+    }
+}
+
+void DescriptorFreeList::Reset( void )
+{
+    for (uint32_t Class = 0; Class < kNumSizeClasses; ++Class)
+        m_FreeLists[Class].clear();
+    m_Retired.clear();
+    m_Heaps.clear();
+
+    m_CurrentHandle = kInvalidHandle;
+    m_CurrentOffset = 0;
+    m_RemainingInHeap = 0;
+    m_NumHeaps = 0;
+    m_LiveDescriptors = 0;
+    m_FreeDescriptors = 0;
+    m_RetiredDescriptors = 0;
+}
@@ -0,0 +1,98 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Bookkeeping for recycling CPU descriptor ranges.  Ranges are rounded up to a power-of-two
+// size class (1 to 256 descriptors) and come from that class's free list, from splitting a larger free
+// range, or from the unused tail of the current heap.  Every range is aligned to its size within its heap,
+// so a range that returns to the free lists is merged with its free buddy into the next larger class, and
+// splitting does not fragment the heaps for good.  Freed ranges are retired with a fence value and only
+// return to the free lists once the owner reports that fence as complete.  Handles are plain integers
+// spaced DescriptorSize apart, so the class never touches a device; the DescriptorAllocator supplies the
+// heaps and the fence values.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <set>
+
+class DescriptorFreeList
+{
+public:
+
+    static const uint32_t kNumSizeClasses = 9;
+    static const uint32_t kMaxCount = 1u << (kNumSizeClasses - 1);
+    static const uint64_t kInvalidHandle = ~0ull;
+
+    DescriptorFreeList();
+
+    // Handles are byte addresses, with consecutive descriptors DescriptorSize bytes apart
+    void SetDescriptorSize( uint32_t DescriptorSize ) { m_DescriptorSize = DescriptorSize; }
+    uint32_t GetDescriptorSize( void ) const { return m_DescriptorSize; }
+
+    // Starts carving ranges out of a new heap.  Whatever is left of the previous heap goes to the free lists.
+    void AddHeap( uint64_t BaseHandle, uint32_t NumDescriptors );
+
+    // Returns kInvalidHandle when the request cannot be met without a new heap.
+    uint64_t Allocate( uint32_t Count );
+
+    // Count must match the allocation.  A fence value of 0 makes the range reusable immediately;
+    // otherwise fence values must not decrease from one call to the next.
+    void Free( uint64_t Handle, uint32_t Count, uint64_t FenceValue );
+
+    bool HasRetired( void ) const { return !m_Retired.empty(); }
+    uint64_t GetOldestRetiredFence( void ) const { return m_Retired.front().FenceValue; }
+
+    // Moves every range retired at or before FenceValue back to the free lists
+    void ReclaimRetired( uint64_t FenceValue );
+
+    // Forgets all heaps and ranges
+    void Reset( void );
+
+    static uint32_t SizeClass( uint32_t Count );
+    static uint32_t ClassCount( uint32_t SizeClass ) { return 1u << SizeClass; }
+
+    uint32_t GetHeapCount( void ) const { return m_NumHeaps; }
+    uint64_t GetLiveDescriptors( void ) const { return m_LiveDescriptors; }
+    uint64_t GetFreeDescriptors( void ) const { return m_FreeDescriptors; }
+    uint64_t GetRetiredDescriptors( void ) const { return m_RetiredDescriptors; }
+    uint32_t GetFreeRangeCount( uint32_t SizeClass ) const { return (uint32_t)m_FreeLists[SizeClass].size(); }
+
+private:
+
+    struct RetiredRange
+    {
+        uint64_t FenceValue;
+        uint64_t Handle;
+        uint32_t SizeClass;
+    };
+
+    // Returns a range to its free list, merged with its buddy as long as that is free too
+    void PushFree( uint64_t Handle, uint32_t SizeClass );
+
+    // Moves the next Count descriptors of the current heap to the free lists, in aligned ranges
+    void ReleaseHeapSpace( uint32_t Count );
+
+    // Sorted so that allocations reuse the lowest addresses first
+    std::set<uint64_t> m_FreeLists[kNumSizeClasses];
+    std::deque<RetiredRange> m_Retired;
+
+    // The base handle and descriptor count of each heap, to find a range's buddy
+    std::map<uint64_t, uint32_t> m_Heaps;
+
+    uint64_t m_CurrentHandle;
+    uint32_t m_CurrentOffset;       // Of m_CurrentHandle in the current heap, in descriptors
+    uint32_t m_RemainingInHeap;
+    uint32_t m_DescriptorSize;
+    uint32_t m_NumHeaps;
+
+    uint64_t m_LiveDescriptors;
+    uint64_t m_FreeDescriptors;
+    uint64_t m_RetiredDescriptors;
+};
@@ -0,0 +1,198 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  The CPU descriptor handles staged for the descriptor tables of one root signature, and
+// which tables have changed since they were last committed.  DynamicDescriptorHeap caches
+// D3D12_CPU_DESCRIPTOR_HANDLEs in it; CommandRecorder caches opaque ids.  Committing the stale tables
+// is left to the owner.
+//
+// Built without any Windows headers so the cache can be tested on any platform.
+//
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace DescriptorCache
+{
+    // Finds the lowest set bit.  Returns false if there is none.
+    inline bool BitScanForward32( uint32_t& Index, uint32_t Mask )
+    {
+        if (Mask == 0)
+            return false;
+#ifdef _MSC_VER
+        unsigned long Result;
+        _BitScanForward(&Result, Mask);
+        Index = Result;
+#else
+        Index = (uint32_t)__builtin_ctz(Mask);
+#endif
+        return true;
+    }
+
+    // The index of the highest set bit of a non-zero mask
+    inline uint32_t HighestBit32( uint32_t Mask )
+    {
+        assert(Mask != 0);
+#ifdef _MSC_VER
+        unsigned long Result;
+        _BitScanReverse(&Result, Mask);
+        return Result;
+#else
+        return 31 - (uint32_t)__builtin_clz(Mask);
+#endif
+    }
+}
+
+template <typename THandle>
+struct DescriptorHandleCache
+{
+    static const uint32_t kMaxNumDescriptors = 256;
+    static const uint32_t kMaxNumDescriptorTables = 16;
+
+    // Describes a descriptor table entry:  a region of the handle cache and which handles have been set
+    struct DescriptorTableCache
+    {
+        DescriptorTableCache() : AssignedHandlesBitMap(0), TableStart(nullptr), TableSize(0) {}
+        uint32_t AssignedHandlesBitMap;
+        THandle* TableStart;
+        uint32_t TableSize;
+    };
+
+    DescriptorHandleCache()
+    {
+        ClearCache();
+    }
+
+    void ClearCache( void )
+    {
+        m_RootDescriptorTablesBitMap = 0;
+        m_StaleRootParamsBitMap = 0;
+        m_MaxCachedDescriptors = 0;
+    }
+
+    // Deduce cache layout needed to support the descriptor tables of a root signature.  TableBitMap has a
+    // bit set for each root parameter that is a table of the cached descriptor type.
+    void ParseRootSignature( uint32_t NumParameters, uint32_t TableBitMap, const uint32_t TableSizes[] )
+    {
+        assert(NumParameters <= kMaxNumDescriptorTables && "Maybe we need to support something greater");
+        (void)NumParameters;
+
+        m_StaleRootParamsBitMap = 0;
+        m_RootDescriptorTablesBitMap = TableBitMap;
+
+        uint32_t CurrentOffset = 0;
+        uint32_t TableParams = m_RootDescriptorTablesBitMap;
+        uint32_t RootIndex;
+        while (DescriptorCache::BitScanForward32(RootIndex, TableParams))
+        {
+            TableParams ^= (1 << RootIndex);
+
+            uint32_t TableSize = TableSizes[RootIndex];
+            assert(TableSize > 0 && TableSize <= 32);
+
+            DescriptorTableCache& RootDescriptorTable = m_RootDescriptorTable[RootIndex];
+            RootDescriptorTable.AssignedHandlesBitMap = 0;
+            RootDescriptorTable.TableStart = m_HandleCache + CurrentOffset;
+            RootDescriptorTable.TableSize = TableSize;
+
+            CurrentOffset += TableSize;
+        }
+
+        m_MaxCachedDescriptors = CurrentOffset;
+
+        assert(m_MaxCachedDescriptors <= kMaxNumDescriptors && "Exceeded user-supplied maximum cache size");
+    }
+
+    // Copy multiple handles into the cache area reserved for the specified root parameter
+    void StageDescriptorHandles( uint32_t RootIndex, uint32_t Offset, uint32_t NumHandles, const THandle Handles[] )
+    {
+        assert(((1 << RootIndex) & m_RootDescriptorTablesBitMap) != 0 && "Root parameter is not a descriptor table of this type");
+        assert(Offset + NumHandles <= m_RootDescriptorTable[RootIndex].TableSize);
+
+        DescriptorTableCache& TableCache = m_RootDescriptorTable[RootIndex];
+        THandle* CopyDest = TableCache.TableStart + Offset;
+        for (uint32_t i = 0; i < NumHandles; ++i)
+            CopyDest[i] = Handles[i];
+        TableCache.AssignedHandlesBitMap |= (uint32_t)(((1ull << NumHandles) - 1) << Offset);
+        m_StaleRootParamsBitMap |= (1 << RootIndex);
+    }
+
+    // Stages the handles of another cache, except for the root parameters in ExcludedRootParams.  Both must
+    // have parsed the same root signature.
+    void CopyStagedHandles( const DescriptorHandleCache& Source, uint32_t ExcludedRootParams )
+    {
+        assert(m_RootDescriptorTablesBitMap == Source.m_RootDescriptorTablesBitMap && "Caches were parsed from different root signatures");
+
+        uint32_t TableParams = m_RootDescriptorTablesBitMap & ~ExcludedRootParams;
+        uint32_t RootIndex;
+        while (DescriptorCache::BitScanForward32(RootIndex, TableParams))
+        {
+            TableParams ^= (1 << RootIndex);
+
+            const DescriptorTableCache& SourceTable = Source.m_RootDescriptorTable[RootIndex];
+            DescriptorTableCache& TableCache = m_RootDescriptorTable[RootIndex];
+            assert(TableCache.TableSize == SourceTable.TableSize);
+
+            for (uint32_t i = 0; i < TableCache.TableSize; ++i)
+                TableCache.TableStart[i] = SourceTable.TableStart[i];
+            TableCache.AssignedHandlesBitMap = SourceTable.AssignedHandlesBitMap;
+
+            if (TableCache.AssignedHandlesBitMap != 0)
+                m_StaleRootParamsBitMap |= (1 << RootIndex);
+        }
+    }
+
+    // Mark all descriptors in the cache as stale and in need of re-uploading
+    void UnbindAllValid( void )
+    {
+        m_StaleRootParamsBitMap = 0;
+
+        uint32_t TableParams = m_RootDescriptorTablesBitMap;
+        uint32_t RootIndex;
+        while (DescriptorCache::BitScanForward32(RootIndex, TableParams))
+        {
+            TableParams ^= (1 << RootIndex);
+            if (m_RootDescriptorTable[RootIndex].AssignedHandlesBitMap != 0)
+                m_StaleRootParamsBitMap |= (1 << RootIndex);
+        }
+    }
+
+    // The descriptors a stale table needs in the shader visible heap:  up to its last assigned handle
+    uint32_t GetStagedTableSize( uint32_t RootIndex ) const
+    {
+        assert(m_RootDescriptorTable[RootIndex].AssignedHandlesBitMap != 0 && "Root entry marked as stale but has no stale descriptors");
+        return DescriptorCache::HighestBit32(m_RootDescriptorTable[RootIndex].AssignedHandlesBitMap) + 1;
+    }
+
+    // Sum the maximum assigned offsets of stale descriptor tables to determine total needed space
+    uint32_t ComputeStagedSize( void ) const
+    {
+        uint32_t NeededSpace = 0;
+        uint32_t StaleParams = m_StaleRootParamsBitMap;
+        uint32_t RootIndex;
+        while (DescriptorCache::BitScanForward32(RootIndex, StaleParams))
+        {
+            StaleParams ^= (1 << RootIndex);
+            NeededSpace += GetStagedTableSize(RootIndex);
+        }
+        return NeededSpace;
+    }
+
+    uint32_t m_RootDescriptorTablesBitMap;
+    uint32_t m_StaleRootParamsBitMap;
+    uint32_t m_MaxCachedDescriptors;
+
+    DescriptorTableCache m_RootDescriptorTable[kMaxNumDescriptorTables];
+    THandle m_HandleCache[kMaxNumDescriptors];
+};
@@ -23,10 +23,36 @@ using namespace Graphics;
 //
 std::mutex DescriptorAllocator::sm_AllocationMutex;
 std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> DescriptorAllocator::sm_DescriptorHeapPool;
+uint32_t DescriptorAllocator::sm_Generation = 1;
+
+// Single descriptors are by far the most common request, so each thread keeps a few of them per heap type and
+// only takes the allocator's lock to refill.  Whatever is left when the thread exits goes back to the allocator.
+struct DescriptorAllocator::ThreadCache
+{
+    static const uint32_t kSize = 16;
+
+    ThreadCache() : Owner(nullptr), Generation(0), Count(0) {}
+    ~ThreadCache()
+    {
+        if (Owner != nullptr)
+            Owner->ReturnThreadCache(*this);
+    }
+
+    DescriptorAllocator* Owner;
+    uint32_t Generation;
+    uint32_t Count;
+    D3D12_CPU_DESCRIPTOR_HANDLE Handles[kSize];
+};
+
+thread_local DescriptorAllocator::ThreadCache DescriptorAllocator::sm_ThreadCaches[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
 
 void DescriptorAllocator::DestroyAll(void)
 {
+    std::lock_guard<std::mutex> LockGuard(sm_AllocationMutex);
     sm_DescriptorHeapPool.clear();
+
+    // Allocators and thread caches notice this and drop their handles
+    ++sm_Generation;
 }
 
 ID3D12DescriptorHeap* DescriptorAllocator::RequestNewHeap(D3D12_DESCRIPTOR_HEAP_TYPE Type)
@@ -47,22 +73,87 @@ ID3D12DescriptorHeap* DescriptorAllocator::RequestNewHeap(D3D12_DESCRIPTOR_HEAP_
 
 D3D12_CPU_DESCRIPTOR_HANDLE DescriptorAllocator::Allocate( uint32_t Count )
 {
-    if (m_CurrentHeap == nullptr || m_RemainingFreeHandles < Count)
+    if (Count == 1)
     {
-        m_CurrentHeap = RequestNewHeap(m_Type);
-        m_CurrentHandle = m_CurrentHeap->GetCPUDescriptorHandleForHeapStart();
-        m_RemainingFreeHandles = sm_NumDescriptorsPerHeap;
+        ThreadCache& Cache = sm_ThreadCaches[m_Type];
+        if (Cache.Owner == nullptr || Cache.Generation != sm_Generation)
+        {
+            Cache.Owner = this;
+            Cache.Generation = sm_Generation;
+            Cache.Count = 0;
+        }
+
+        if (Cache.Owner == this)
+        {
+            if (Cache.Count == 0)
+                RefillThreadCache(Cache);
+            return Cache.Handles[--Cache.Count];
+        }
+    }
+
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+    return AllocateLocked(Count);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorAllocator::AllocateLocked( uint32_t Count )
+{
+    ASSERT(Count > 0 && Count <= sm_NumDescriptorsPerHeap);
 
-        if (m_DescriptorSize == 0)
-            m_DescriptorSize = Graphics::g_Device->GetDescriptorHandleIncrementSize(m_Type);
+    if (m_Generation != sm_Generation)
+    {
+        m_FreeList.Reset();
+        m_Generation = sm_Generation;
     }
 
-    D3D12_CPU_DESCRIPTOR_HANDLE ret = m_CurrentHandle;
-    m_CurrentHandle.ptr += Count * m_DescriptorSize;
-    m_RemainingFreeHandles -= Count;
+    if (m_FreeList.GetDescriptorSize() == 0)
+        m_FreeList.SetDescriptorSize(Graphics::g_Device->GetDescriptorHandleIncrementSize(m_Type));
+
+    while (m_FreeList.HasRetired() && g_CommandManager.IsFenceComplete(m_FreeList.GetOldestRetiredFence()))
+        m_FreeList.ReclaimRetired(m_FreeList.GetOldestRetiredFence());
+
+    uint64_t Handle = m_FreeList.Allocate(Count);
+    if (Handle == DescriptorFreeList::kInvalidHandle)
+    {
+        ID3D12DescriptorHeap* Heap = RequestNewHeap(m_Type);
+        m_FreeList.AddHeap(Heap->GetCPUDescriptorHandleForHeapStart().ptr, sm_NumDescriptorsPerHeap);
+        Handle = m_FreeList.Allocate(Count);
+    }
+
+    D3D12_CPU_DESCRIPTOR_HANDLE ret;
+    ret.ptr = (SIZE_T)Handle;
     return ret;
 }
 
+void DescriptorAllocator::RefillThreadCache( ThreadCache& Cache )
+{
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+
+    while (Cache.Count < ThreadCache::kSize)
+        Cache.Handles[Cache.Count++] = AllocateLocked(1);
+}
+
+void DescriptorAllocator::ReturnThreadCache( ThreadCache& Cache )
+{
+    if (Cache.Generation != sm_Generation || m_Generation != sm_Generation)
+        return;
+
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+
+    // The handles were never handed out, so they can be reused right away
+    while (Cache.Count > 0)
+        m_FreeList.Free(Cache.Handles[--Cache.Count].ptr, 1, 0);
+}
+
+void DescriptorAllocator::Free( D3D12_CPU_DESCRIPTOR_HANDLE Handle, uint32_t Count )
+{
+    // Resources destroyed after DestroyAll() (including global ones at exit) have nothing to give back
+    if (Handle.ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN || Handle.ptr == 0 || m_Generation != sm_Generation)
+        return;
+
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+    m_FreeList.Free(Handle.ptr, Count, g_CommandManager.GetGraphicsQueue().GetNextFenceValue());
+}
+
 //
 // UserDescriptorHeap implementation
 //
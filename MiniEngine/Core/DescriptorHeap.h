@@ -17,32 +17,46 @@
 #include <vector>
 #include <queue>
 #include <string>
+#include "DescriptorFreeList.h"
 
 
 // This is an unbounded resource descriptor allocator.  It is intended to provide space for CPU-visible resource descriptors
 // as resources are created.  For those that need to be made shader-visible, they will need to be copied to a UserDescriptorHeap
-// or a DynamicDescriptorHeap.
+// or a DynamicDescriptorHeap.  Freed ranges are recycled once the GPU has caught up with the frame that freed them, and
+// single descriptors are handed out from small per-thread caches without taking the allocator's lock.  The caches are
+// kept per heap type, so only one allocator of each type benefits from them.
 class DescriptorAllocator
 {
 public:
-    DescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE Type) : m_Type(Type), m_CurrentHeap(nullptr) {}
+    DescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE Type) : m_Type(Type), m_Generation(0) {}
 
     D3D12_CPU_DESCRIPTOR_HANDLE Allocate( uint32_t Count );
 
+    // Count must match the allocation.  The range is reused after the next graphics fence completes, so views that
+    // are still staged in a command context stay valid.
+    void Free( D3D12_CPU_DESCRIPTOR_HANDLE Handle, uint32_t Count );
+
     static void DestroyAll(void);
 
 protected:
 
-    static const uint32_t sm_NumDescriptorsPerHeap = 256;
+    struct ThreadCache;
+
+    D3D12_CPU_DESCRIPTOR_HANDLE AllocateLocked( uint32_t Count );
+    void RefillThreadCache( ThreadCache& Cache );
+    void ReturnThreadCache( ThreadCache& Cache );
+
+    static const uint32_t sm_NumDescriptorsPerHeap = DescriptorFreeList::kMaxCount;
     static std::mutex sm_AllocationMutex;
     static std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> sm_DescriptorHeapPool;
+    static uint32_t sm_Generation;
+    static thread_local ThreadCache sm_ThreadCaches[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
     static ID3D12DescriptorHeap* RequestNewHeap( D3D12_DESCRIPTOR_HEAP_TYPE Type );
 
     D3D12_DESCRIPTOR_HEAP_TYPE m_Type;
-    ID3D12DescriptorHeap* m_CurrentHeap;
-    D3D12_CPU_DESCRIPTOR_HANDLE m_CurrentHandle;
-    uint32_t m_DescriptorSize;
-    uint32_t m_RemainingFreeHandles;
+    std::mutex m_Mutex;
+    DescriptorFreeList m_FreeList;
+    uint32_t m_Generation;  // Matches sm_Generation while m_FreeList refers to live heaps
 };
 
 
@@ -124,57 +124,23 @@ inline ID3D12DescriptorHeap* DynamicDescriptorHeap::GetHeapPointer()
     return m_CurrentHeapPtr;
 }
 
-uint32_t DynamicDescriptorHeap::DescriptorHandleCache::ComputeStagedSize()
-{
-    // Sum the maximum assigned offsets of stale descriptor tables to determine total needed space.
-    uint32_t NeededSpace = 0;
-    uint32_t RootIndex;
-    uint32_t StaleParams = m_StaleRootParamsBitMap;
-    while (_BitScanForward((unsigned long*)&RootIndex, StaleParams))
-    {
-        StaleParams ^= (1 << RootIndex);
-
-        uint32_t MaxSetHandle;
-        ASSERT(TRUE == _BitScanReverse((unsigned long*)&MaxSetHandle, m_RootDescriptorTable[RootIndex].AssignedHandlesBitMap),
-            "Root entry marked as stale but has no stale descriptors");
-
-        NeededSpace += MaxSetHandle + 1;
-    }
-    return NeededSpace;
-}
-
-void DynamicDescriptorHeap::DescriptorHandleCache::CopyAndBindStaleTables(
-    D3D12_DESCRIPTOR_HEAP_TYPE Type, uint32_t DescriptorSize,
-    DescriptorHandle DestHandleStart, DX12_GRAPHICSCOMMANDLIST* CmdList,
+void DynamicDescriptorHeap::CopyAndBindStagedTables( HandleCache& Cache, DX12_GRAPHICSCOMMANDLIST* CmdList,
     void (STDMETHODCALLTYPE DX12_GRAPHICSCOMMANDLIST::*SetFunc)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE))
 {
-    uint32_t StaleParamCount = 0;
-    uint32_t TableSize[DescriptorHandleCache::kMaxNumDescriptorTables];
-    uint32_t RootIndices[DescriptorHandleCache::kMaxNumDescriptorTables];
-    uint32_t NeededSpace = 0;
-    uint32_t RootIndex;
-
-    // Sum the maximum assigned offsets of stale descriptor tables to determine total needed space.
-    uint32_t StaleParams = m_StaleRootParamsBitMap;
-    while (_BitScanForward((unsigned long*)&RootIndex, StaleParams))
+    uint32_t NeededSize = Cache.ComputeStagedSize();
+    if (!HasSpace(NeededSize))
     {
-        RootIndices[StaleParamCount] = RootIndex;
-        StaleParams ^= (1 << RootIndex);
-
-        uint32_t MaxSetHandle;
-        ASSERT(TRUE == _BitScanReverse((unsigned long*)&MaxSetHandle, m_RootDescriptorTable[RootIndex].AssignedHandlesBitMap),
-            "Root entry marked as stale but has no stale descriptors");
-
-        NeededSpace += MaxSetHandle + 1;
-        TableSize[StaleParamCount] = MaxSetHandle + 1;
-
-        ++StaleParamCount;
+        RetireCurrentHeap();
+        UnbindAllValid();
+        NeededSize = Cache.ComputeStagedSize();
     }
 
-    ASSERT(StaleParamCount <= DescriptorHandleCache::kMaxNumDescriptorTables,
-        "We're only equipped to handle so many descriptor tables");
+    // This can trigger the creation of a new heap
+    m_OwningContext.SetDescriptorHeap(m_DescriptorType, GetHeapPointer());
+    DescriptorHandle DestHandleStart = Allocate(NeededSize);
 
-    m_StaleRootParamsBitMap = 0;
+    uint32_t StaleParams = Cache.m_StaleRootParamsBitMap;
+    Cache.m_StaleRootParamsBitMap = 0;
 
     static const uint32_t kMaxDescriptorsPerCopy = 16;
     UINT NumDestDescriptorRanges = 0;
@@ -185,17 +151,18 @@ void DynamicDescriptorHeap::DescriptorHandleCache::CopyAndBindStaleTables(
     D3D12_CPU_DESCRIPTOR_HANDLE pSrcDescriptorRangeStarts[kMaxDescriptorsPerCopy];
     UINT pSrcDescriptorRangeSizes[kMaxDescriptorsPerCopy];
 
-    for (uint32_t i = 0; i < StaleParamCount; ++i)
+    uint32_t RootIndex;
+    while (DescriptorCache::BitScanForward32(RootIndex, StaleParams))
     {
-        RootIndex = RootIndices[i];
+        StaleParams ^= (1 << RootIndex);
         (CmdList->*SetFunc)(RootIndex, DestHandleStart.GetGpuHandle());
 
-        DescriptorTableCache& RootDescTable = m_RootDescriptorTable[RootIndex];
+        HandleCache::DescriptorTableCache& RootDescTable = Cache.m_RootDescriptorTable[RootIndex];
 
         D3D12_CPU_DESCRIPTOR_HANDLE* SrcHandles = RootDescTable.TableStart;
         uint64_t SetHandles = (uint64_t)RootDescTable.AssignedHandlesBitMap;
         D3D12_CPU_DESCRIPTOR_HANDLE CurDest = DestHandleStart.GetCpuHandle();
-        DestHandleStart += TableSize[i] * DescriptorSize;
+        DestHandleStart += Cache.GetStagedTableSize(RootIndex) * m_DescriptorSize;
 
         unsigned long SkipCount;
         while (_BitScanForward64(&SkipCount, SetHandles))
@@ -203,7 +170,7 @@ void DynamicDescriptorHeap::DescriptorHandleCache::CopyAndBindStaleTables(
             // Skip over unset descriptor handles
             SetHandles >>= SkipCount;
             SrcHandles += SkipCount;
-            CurDest.ptr += SkipCount * DescriptorSize;
+            CurDest.ptr += SkipCount * m_DescriptorSize;
 
             unsigned long DescriptorCount;
             _BitScanForward64(&DescriptorCount, ~SetHandles);
@@ -215,7 +182,7 @@ void DynamicDescriptorHeap::DescriptorHandleCache::CopyAndBindStaleTables(
                 g_Device->CopyDescriptors(
                     NumDestDescriptorRanges, pDestDescriptorRangeStarts, pDestDescriptorRangeSizes,
                     NumSrcDescriptorRanges, pSrcDescriptorRangeStarts, pSrcDescriptorRangeSizes,
-                    Type);
+                    m_DescriptorType);
 
                 NumSrcDescriptorRanges = 0;
                 NumDestDescriptorRanges = 0;
@@ -236,30 +203,14 @@ void DynamicDescriptorHeap::DescriptorHandleCache::CopyAndBindStaleTables(
 
             // Move the destination pointer forward by the number of descriptors we will copy
             SrcHandles += DescriptorCount;
-            CurDest.ptr += DescriptorCount * DescriptorSize;
+            CurDest.ptr += DescriptorCount * m_DescriptorSize;
         }
     }
 
     g_Device->CopyDescriptors(
         NumDestDescriptorRanges, pDestDescriptorRangeStarts, pDestDescriptorRangeSizes,
         NumSrcDescriptorRanges, pSrcDescriptorRangeStarts, pSrcDescriptorRangeSizes,
-        Type);
-}
-    
-void DynamicDescriptorHeap::CopyAndBindStagedTables( DescriptorHandleCache& HandleCache, DX12_GRAPHICSCOMMANDLIST* CmdList,
-    void (STDMETHODCALLTYPE DX12_GRAPHICSCOMMANDLIST::*SetFunc)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE))
-{
-    uint32_t NeededSize = HandleCache.ComputeStagedSize();
-    if (!HasSpace(NeededSize))
-    {
-        RetireCurrentHeap();
-        UnbindAllValid();
-        NeededSize = HandleCache.ComputeStagedSize();
-    }
-
-    // This can trigger the creation of a new heap
-    m_OwningContext.SetDescriptorHeap(m_DescriptorType, GetHeapPointer());
-    HandleCache.CopyAndBindStaleTables(m_DescriptorType, m_DescriptorSize, Allocate(NeededSize), CmdList, SetFunc);
+        m_DescriptorType);
 }
 
 void DynamicDescriptorHeap::UnbindAllValid( void )
@@ -285,62 +236,3 @@ D3D12_GPU_DESCRIPTOR_HANDLE DynamicDescriptorHeap::UploadDirect( D3D12_CPU_DESCR
 
     return DestHandle.GetGpuHandle();
 }
-
-void DynamicDescriptorHeap::DescriptorHandleCache::UnbindAllValid()
-{
-    m_StaleRootParamsBitMap = 0;
-
-    unsigned long TableParams = m_RootDescriptorTablesBitMap;
-    unsigned long RootIndex;
-    while (_BitScanForward(&RootIndex, TableParams))
-    {
-        TableParams ^= (1 << RootIndex);
-        if (m_RootDescriptorTable[RootIndex].AssignedHandlesBitMap != 0)
-            m_StaleRootParamsBitMap |= (1 << RootIndex);
-    }
-}
-
-void DynamicDescriptorHeap::DescriptorHandleCache::StageDescriptorHandles( UINT RootIndex, UINT Offset, UINT NumHandles, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[] )
-{
-    ASSERT(((1 << RootIndex) & m_RootDescriptorTablesBitMap) != 0, "Root parameter is not a CBV_SRV_UAV descriptor table");
-    ASSERT(Offset + NumHandles <= m_RootDescriptorTable[RootIndex].TableSize);
-
-    DescriptorTableCache& TableCache = m_RootDescriptorTable[RootIndex];
-    D3D12_CPU_DESCRIPTOR_HANDLE* CopyDest = TableCache.TableStart + Offset;
-    for (UINT i = 0; i < NumHandles; ++i)
-        CopyDest[i] = Handles[i];
-    TableCache.AssignedHandlesBitMap |= ((1 << NumHandles) - 1) << Offset;
-    m_StaleRootParamsBitMap |= (1 << RootIndex);
-}
-
-void DynamicDescriptorHeap::DescriptorHandleCache::ParseRootSignature( D3D12_DESCRIPTOR_HEAP_TYPE Type, const RootSignature& RootSig )
-{
-    UINT CurrentOffset = 0;
-
-    ASSERT(RootSig.m_NumParameters <= 16, "Maybe we need to support something greater");
-
-    m_StaleRootParamsBitMap = 0;
-    m_RootDescriptorTablesBitMap = (Type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ?
-        RootSig.m_SamplerTableBitMap : RootSig.m_DescriptorTableBitMap);
-
-    unsigned long TableParams = m_RootDescriptorTablesBitMap;
-    unsigned long RootIndex;
-    while (_BitScanForward(&RootIndex, TableParams))
-    {
-        TableParams ^= (1 << RootIndex);
-
-        UINT TableSize = RootSig.m_DescriptorTableSize[RootIndex];
-        ASSERT(TableSize > 0);
-
-        DescriptorTableCache& RootDescriptorTable = m_RootDescriptorTable[RootIndex];
-        RootDescriptorTable.AssignedHandlesBitMap = 0;
-        RootDescriptorTable.TableStart = m_HandleCache + CurrentOffset;
-        RootDescriptorTable.TableSize = TableSize;
-
-        CurrentOffset += TableSize;
-    }
-
-    m_MaxCachedDescriptors = CurrentOffset;
-
-    ASSERT(m_MaxCachedDescriptors <= kMaxNumDescriptors, "Exceeded user-supplied maximum cache size");
-}
@@ -15,6 +15,7 @@
 
 #include "DescriptorHeap.h"
 #include "RootSignature.h"
+#include "DescriptorHandleCache.h"
 #include <vector>
 #include <queue>
 
@@ -57,12 +58,12 @@ public:
     // Deduce cache layout needed to support the descriptor tables needed by the root signature.
     void ParseGraphicsRootSignature( const RootSignature& RootSig )
     {
-        m_GraphicsHandleCache.ParseRootSignature(m_DescriptorType, RootSig);
+        ParseRootSignature(m_GraphicsHandleCache, RootSig);
     }
 
     void ParseComputeRootSignature( const RootSignature& RootSig )
     {
-        m_ComputeHandleCache.ParseRootSignature(m_DescriptorType, RootSig);
+        ParseRootSignature(m_ComputeHandleCache, RootSig);
     }
 
     // Upload any new descriptors in the cache to the shader-visible heap.
@@ -78,6 +79,17 @@ public:
             CopyAndBindStagedTables(m_ComputeHandleCache, CmdList, &DX12_GRAPHICSCOMMANDLIST::SetComputeRootDescriptorTable);
     }
 
+    // Stages the handles another heap has cached for its graphics tables, except for the root parameters in
+    // ExcludedRootParams.  Both must have parsed the same root signature.  Used to start worker contexts with
+    // their parent's tables; the descriptors are copied into this heap at the next commit.
+    void InheritGraphicsDescriptorHandles( const DynamicDescriptorHeap& Source, uint32_t ExcludedRootParams = 0 )
+    {
+        m_GraphicsHandleCache.CopyStagedHandles(Source.m_GraphicsHandleCache, ExcludedRootParams);
+    }
+
+    // Mark all descriptors in the cache as stale and in need of re-uploading.
+    void UnbindAllValid( void );
+
 private:
 
     // Static members
@@ -100,49 +112,16 @@ private:
     DescriptorHandle m_FirstDescriptor;
     std::vector<ID3D12DescriptorHeap*> m_RetiredHeaps;
 
-    // Describes a descriptor table entry:  a region of the handle cache and which handles have been set
-    struct DescriptorTableCache
-    {
-        DescriptorTableCache() : AssignedHandlesBitMap(0) {}
-        uint32_t AssignedHandlesBitMap;
-        D3D12_CPU_DESCRIPTOR_HANDLE* TableStart;
-        uint32_t TableSize;
-    };
-
-    struct DescriptorHandleCache
-    {
-        DescriptorHandleCache()
-        {
-            ClearCache();
-        }
-
-        void ClearCache()
-        {
-            m_RootDescriptorTablesBitMap = 0;
-            m_MaxCachedDescriptors = 0;
-        }
+    typedef ::DescriptorHandleCache<D3D12_CPU_DESCRIPTOR_HANDLE> HandleCache;
 
-        uint32_t m_RootDescriptorTablesBitMap;
-        uint32_t m_StaleRootParamsBitMap;
-        uint32_t m_MaxCachedDescriptors;
+    HandleCache m_GraphicsHandleCache;
+    HandleCache m_ComputeHandleCache;
 
-        static const uint32_t kMaxNumDescriptors = 256;
-        static const uint32_t kMaxNumDescriptorTables = 16;
-
-        uint32_t ComputeStagedSize();
-        void CopyAndBindStaleTables( D3D12_DESCRIPTOR_HEAP_TYPE Type, uint32_t DescriptorSize, DescriptorHandle DestHandleStart, DX12_GRAPHICSCOMMANDLIST* CmdList,
-            void (STDMETHODCALLTYPE DX12_GRAPHICSCOMMANDLIST::*SetFunc)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE));
-
-        DescriptorTableCache m_RootDescriptorTable[kMaxNumDescriptorTables];
-        D3D12_CPU_DESCRIPTOR_HANDLE m_HandleCache[kMaxNumDescriptors];
-
-        void UnbindAllValid();
-        void StageDescriptorHandles( UINT RootIndex, UINT Offset, UINT NumHandles, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[] );
-        void ParseRootSignature( D3D12_DESCRIPTOR_HEAP_TYPE Type, const RootSignature& RootSig );
-    };
-
-    DescriptorHandleCache m_GraphicsHandleCache;
-    DescriptorHandleCache m_ComputeHandleCache;
+    void ParseRootSignature( HandleCache& Cache, const RootSignature& RootSig )
+    {
+        Cache.ParseRootSignature(RootSig.m_NumParameters, m_DescriptorType == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ?
+            RootSig.m_SamplerTableBitMap : RootSig.m_DescriptorTableBitMap, RootSig.m_DescriptorTableSize);
+    }
 
     bool HasSpace( uint32_t Count )
     {
@@ -160,10 +139,7 @@ private:
         return ret;
     }
 
-    void CopyAndBindStagedTables( DescriptorHandleCache& HandleCache, DX12_GRAPHICSCOMMANDLIST* CmdList,
+    void CopyAndBindStagedTables( HandleCache& Cache, DX12_GRAPHICSCOMMANDLIST* CmdList,
         void (STDMETHODCALLTYPE DX12_GRAPHICSCOMMANDLIST::*SetFunc)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE) );
 
-    // Mark all descriptors in the cache as stale and in need of re-uploading.
-    void UnbindAllValid( void );
-
 };
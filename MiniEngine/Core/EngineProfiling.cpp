@@ -20,6 +20,9 @@
 #include "GameInput.h"
 #include "GpuCounterManager.h"
 #include "CommandContext.h"
+#include "TraceCapture.h"
+#include "FramePacer.h"
+#include "JobSystem.h"
 #include <vector>
 #include <unordered_map>
 #include <array>
@@ -32,6 +35,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <ctime>
 
 using namespace Graphics;
 using namespace GraphRenderer;
@@ -192,6 +196,11 @@ public:
         return GpuCounterManager::GetTime(m_TimerIndex);
     }
 
+    bool GetTimeStamps(uint64_t& Start, uint64_t& Stop)
+    {
+        return GpuCounterManager::GetTimeStamps(m_TimerIndex, Start, Stop);
+    }
+
     uint32_t GetTimerIndex(void)
     {
         return m_TimerIndex;
@@ -231,7 +240,8 @@ class NestedTimingTree
 {
 public:
     NestedTimingTree( const wstring& name, NestedTimingTree* parent = nullptr )
-        : m_Name(name), m_Parent(parent), m_IsExpanded(false), m_IsGraphed(false), m_GraphHandle(PERF_GRAPH_ERROR) {}
+        : m_Name(name), m_Parent(parent), m_StartBarriers(0), m_Barriers(0), m_LastBarriers(0),
+        m_IsExpanded(false), m_IsGraphed(false), m_GraphHandle(PERF_GRAPH_ERROR) {}
 
     NestedTimingTree* GetChild( const wstring& name )
     {
@@ -320,10 +330,12 @@ public:
     void StartTiming( CommandContext* Context )
     {
         m_StartTick = SystemTime::GetCurrentTick();
+        TraceCapture::BeginCpuScope(m_Name);
         if (Context == nullptr)
             return;
 
         m_GpuTimer.Start(*Context);
+        m_StartBarriers = Context->GetNumBarriersFlushed();
 
         Context->PIXBeginEvent(m_Name.c_str());
     }
@@ -331,10 +343,12 @@ public:
     void StopTiming( CommandContext* Context )
     {
         m_EndTick = SystemTime::GetCurrentTick();
+        TraceCapture::EndCpuScope(m_Name);
         if (Context == nullptr)
             return;
 
         m_GpuTimer.Stop(*Context);
+        m_Barriers += (uint32_t)(Context->GetNumBarriersFlushed() - m_StartBarriers);
 
         Context->PIXEndEvent();
     }
@@ -386,6 +400,11 @@ public:
         }
         m_CpuTime.RecordStat(FrameIndex, 1000.0f * (float)SystemTime::TimeBetweenTicks(m_StartTick, m_EndTick));
         m_GpuTime.RecordStat(FrameIndex, 1000.0f * m_GpuTimer.GetTime());
+        m_LastBarriers = m_Barriers;
+
+        uint64_t StartTimeStamp, StopTimeStamp;
+        if (TraceCapture::IsCapturing() && m_GpuTimer.GetTimeStamps(StartTimeStamp, StopTimeStamp))
+            TraceCapture::AddGpuRange(m_Name, StartTimeStamp, StopTimeStamp);
 
 		// get pipeline statistics for all counters
 		for (size_t iQuery = 0; iQuery < m_PipelineQueries.size(); iQuery++) {
@@ -397,6 +416,7 @@ public:
 
         m_StartTick = 0;
         m_EndTick = 0;
+        m_Barriers = 0;
     }
 
     void SumInclusiveTimes(float& cpuTime, float& gpuTime)
@@ -426,6 +446,8 @@ public:
         s_FrameDelta.RecordStat(FrameIndex, GpuCounterManager::GetTime(0));
         GpuCounterManager::EndReadBack();
 
+        TraceCapture::NextFrame(FrameIndex);
+
         float TotalCpuTime, TotalGpuTime;
         sm_RootScope.SumInclusiveTimes(TotalCpuTime, TotalGpuTime);
         s_TotalCpuTime.RecordStat(FrameIndex, TotalCpuTime);
@@ -486,6 +508,9 @@ private:
 			writer.Key("GPUTime");
 			writer.Double(m_GpuTime.GetLast());
 
+			writer.Key("Barriers");
+			writer.Uint(m_LastBarriers);
+
 			if (m_PipelineQueries.size() > 0) {
 				writer.Key("PipelineQueries");
 				writer.StartArray();
@@ -524,8 +549,12 @@ private:
 		
         report.StoreCounterValue("Resolution Scale", g_ResolutionScale);
         
-        if(m_Name.length() > 0)
+        if(m_Name.length() > 0) {
 			report.StoreCounterValue(std::string(m_Name.begin(), m_Name.end()).c_str(), m_GpuTime.GetLast());
+
+			std::wstring ctrName = m_Name + L".Barriers";
+			report.StoreCounterValue(std::string(ctrName.begin(), ctrName.end()).c_str(), (float)m_LastBarriers);
+		}
 		
 		if (m_LastPipelineQueryData.size() > 0) {
 			for (auto& query : m_PipelineQueryLUT) {
@@ -551,6 +580,9 @@ private:
     unordered_map<wstring, NestedTimingTree*> m_LUT;
     int64_t m_StartTick;
     int64_t m_EndTick;
+    uint64_t m_StartBarriers;   // Context's flushed barrier total when the scope opened
+    uint32_t m_Barriers;        // Barriers flushed inside the scope so far this frame
+    uint32_t m_LastBarriers;
     StatHistory m_CpuTime;
     StatHistory m_GpuTime;
     bool m_IsExpanded;
@@ -584,7 +616,56 @@ namespace EngineProfiling
     BoolVar DrawFrameRate("Display Frame Rate", true);
     BoolVar DrawProfiler("Display Profiler", false);
     BoolVar DrawPerfGraph("Display Performance Graph", false);
+    BoolVar DrawFramePacing("Display Frame Pacing", false);
+    BoolVar DrawJobStats("Display Job System", false);
+    BoolVar DrawAllocatorStats("Display Command Allocators", false);
     //const bool DrawPerfGraph = false;
+
+    // Setting "Record" writes a trace of the next few frames to the working directory
+    BoolVar RecordTrace("Trace Capture/Record", false);
+    IntVar TraceFrameCount("Trace Capture/Frames", 120, 1, 3600, 30);
+
+    // The scheduler's counters are cumulative; these hold the last frame's share, and the peak queue depth
+    // reached during the last frame
+    JobScheduler::WorkerStats s_TotalJobStats = {};
+    JobScheduler::WorkerStats s_FrameJobStats = {};
+
+    void UpdateJobStats( void )
+    {
+        JobScheduler::WorkerStats Total = g_JobScheduler.GetTotalStats();
+        s_FrameJobStats.JobsRun = Total.JobsRun - s_TotalJobStats.JobsRun;
+        s_FrameJobStats.JobsStolen = Total.JobsStolen - s_TotalJobStats.JobsStolen;
+        s_FrameJobStats.FailedSteals = Total.FailedSteals - s_TotalJobStats.FailedSteals;
+        s_FrameJobStats.Splits = Total.Splits - s_TotalJobStats.Splits;
+        s_FrameJobStats.Sleeps = Total.Sleeps - s_TotalJobStats.Sleeps;
+        s_FrameJobStats.BusyNanoseconds = Total.BusyNanoseconds - s_TotalJobStats.BusyNanoseconds;
+        s_FrameJobStats.PeakQueueDepth = g_JobScheduler.ResetFramePeakQueueDepth();
+        s_TotalJobStats = Total;
+    }
+
+    // Summed over the three queues.  PoolSize is current, the rest are last frame's share.
+    CommandAllocatorPool::Stats s_TotalAllocatorStats = {};
+    CommandAllocatorPool::Stats s_FrameAllocatorStats = {};
+
+    void UpdateAllocatorStats( void )
+    {
+        CommandAllocatorPool::Stats Total = {};
+        CommandQueue* Queues[] = { &g_CommandManager.GetGraphicsQueue(), &g_CommandManager.GetComputeQueue(), &g_CommandManager.GetCopyQueue() };
+        for (CommandQueue* Queue : Queues)
+        {
+            CommandAllocatorPool::Stats Stats = Queue->GetAllocatorStats();
+            Total.PoolSize += Stats.PoolSize;
+            Total.Created += Stats.Created;
+            Total.Reused += Stats.Reused;
+            Total.ThreadCacheHits += Stats.ThreadCacheHits;
+        }
+
+        s_FrameAllocatorStats.PoolSize = Total.PoolSize;
+        s_FrameAllocatorStats.Created = Total.Created - s_TotalAllocatorStats.Created;
+        s_FrameAllocatorStats.Reused = Total.Reused - s_TotalAllocatorStats.Reused;
+        s_FrameAllocatorStats.ThreadCacheHits = Total.ThreadCacheHits - s_TotalAllocatorStats.ThreadCacheHits;
+        s_TotalAllocatorStats = Total;
+    }
     
     void Update( void )
     {
@@ -593,7 +674,20 @@ namespace EngineProfiling
         {
             Paused = !Paused;
         }
+
+        if (RecordTrace)
+        {
+            RecordTrace = false;
+
+            char FileName[64];
+            time_t Now = time(nullptr);
+            strftime(FileName, sizeof(FileName), "Trace-%Y-%m-%d-%H-%M-%S.json", localtime(&Now));
+            TraceCapture::Begin(FileName, GpuCounterManager::GetClockCalibration(), (uint32_t)TraceFrameCount);
+        }
+
         NestedTimingTree::UpdateTimes();
+        UpdateJobStats();
+        UpdateAllocatorStats();
     }
 
     void BeginBlock(const wstring& name, CommandContext* Context)
@@ -630,6 +724,32 @@ namespace EngineProfiling
 
         Text.DrawFormattedString( "CPU %7.3f ms, GPU %7.3f ms, %3u Hz, DRR Scale: %.2f\n",
             cpuTime, gpuTime, (uint32_t)(frameRate + 0.5f), Graphics::g_ResolutionScale);
+
+        if (DrawFramePacing)
+        {
+            FramePacer::PacingStats Stats = Graphics::GetFramePacer().ComputeStats();
+            Text.DrawFormattedString( "Frame %6.2f +/- %5.2f ms (max %6.2f), jitter %5.2f ms, %u stutters, "
+                "latency %6.2f ms (max %6.2f), limiter %5.2f ms\n",
+                Stats.AvgFrameTime * 1000.0f, Stats.FrameTimeStdDev * 1000.0f, Stats.MaxFrameTime * 1000.0f,
+                Stats.AvgJitter * 1000.0f, Stats.Stutters, Stats.AvgLatency * 1000.0f, Stats.MaxLatency * 1000.0f,
+                Stats.AvgLimiterWait * 1000.0f);
+        }
+
+        if (DrawJobStats)
+        {
+            Text.DrawFormattedString( "Jobs %5u on %u threads, %4u stolen, %4u failed steals, %3u sleeps, "
+                "busy %6.2f ms, peak queue %u\n",
+                (uint32_t)s_FrameJobStats.JobsRun, g_JobScheduler.GetThreadCount(), (uint32_t)s_FrameJobStats.JobsStolen,
+                (uint32_t)s_FrameJobStats.FailedSteals, (uint32_t)s_FrameJobStats.Sleeps,
+                s_FrameJobStats.BusyNanoseconds * 1e-6f, s_FrameJobStats.PeakQueueDepth);
+        }
+
+        if (DrawAllocatorStats)
+        {
+            Text.DrawFormattedString( "Command allocators %4u, %3u created, %4u reused (%4u from thread caches)\n",
+                s_FrameAllocatorStats.PoolSize, (uint32_t)s_FrameAllocatorStats.Created,
+                (uint32_t)s_FrameAllocatorStats.Reused, (uint32_t)s_FrameAllocatorStats.ThreadCacheHits);
+        }
     }
 
     void DisplayPerfGraph( GraphicsContext& Context )
@@ -652,7 +772,7 @@ namespace EngineProfiling
             Text.DrawString("Engine Profiling");
             Text.SetColor(Color(0.8f, 0.8f, 0.8f));
             Text.SetTextSize(20.0f);
-            Text.DrawString("           CPU    GPU");
+            Text.DrawString("           CPU    GPU  Barriers");
             Text.SetTextSize(24.0f);
             Text.NewLine();
             Text.SetTextSize(20.0f);
@@ -661,6 +781,7 @@ namespace EngineProfiling
             NestedTimingTree::Display( Text, x );
         }
 
+        Text.Flush();
         Text.GetCommandContext().SetScissor(0, 0, g_DisplayWidth, g_DisplayHeight);
     }
 
@@ -682,6 +803,20 @@ namespace EngineProfiling
 
 	void FillPerfDataForLastFrame(ART::PerfCounterReport& report) {
 		NestedTimingTree::FillPerfData(report);
+
+		const FramePacer::FrameTiming& Frame = Graphics::GetFramePacer().GetLastFrame();
+		report.StoreCounterValue("Frame Pacing.Frame Time", Frame.FrameTime * 1000.0f);
+		report.StoreCounterValue("Frame Pacing.Latency", Frame.Latency * 1000.0f);
+		report.StoreCounterValue("Frame Pacing.Limiter Wait", Frame.LimiterWait * 1000.0f);
+		report.StoreCounterValue("Frame Pacing.Timestep", Frame.Timestep * 1000.0f);
+
+		report.StoreCounterValue("Job System.Jobs", (float)s_FrameJobStats.JobsRun);
+		report.StoreCounterValue("Job System.Stolen", (float)s_FrameJobStats.JobsStolen);
+		report.StoreCounterValue("Job System.Sleeps", (float)s_FrameJobStats.Sleeps);
+		report.StoreCounterValue("Job System.Busy", s_FrameJobStats.BusyNanoseconds * 1e-6f);
+
+		report.StoreCounterValue("Command Allocators.Pool Size", (float)s_FrameAllocatorStats.PoolSize);
+		report.StoreCounterValue("Command Allocators.Created", (float)s_FrameAllocatorStats.Created);
 	}
 
     float GetFrameGPUTime( void )
@@ -786,7 +921,7 @@ void NestedTimingTree::DisplayNode( TextContext& Text, float leftMargin, float i
 
         Text.DrawString(m_Name.c_str());
         Text.SetCursorX(leftMargin + 300.0f);
-        Text.DrawFormattedString("%6.3f %6.3f   ", m_CpuTime.GetAvg(), m_GpuTime.GetAvg());
+        Text.DrawFormattedString("%6.3f %6.3f %5u   ", m_CpuTime.GetAvg(), m_GpuTime.GetAvg(), m_LastBarriers);
 
         if (IsGraphed())
         {
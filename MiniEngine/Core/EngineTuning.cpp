@@ -19,6 +19,8 @@
 #include "GraphicsCore.h"
 #include "CommandContext.h"
 #include "GraphRenderer.h"
+#include "TuningSnapshot.h"
+#include <unordered_map>
 
 using namespace std;
 using namespace Math;
@@ -45,6 +47,33 @@ namespace EngineTuning
     bool sm_IsVisible = false;
 }
 
+// Not open to the public.  Flat table of registered variables indexed by ID, plus a path hash index.
+class VariableRegistry
+{
+public:
+    static void Add( const string& path, EngineVar& var )
+    {
+        uint64_t Hash = EngineTuning::HashPath(path);
+        ASSERT(sm_Lookup.find(Hash) == sm_Lookup.end(), "Engine variable path registered twice: %s", path.c_str());
+
+        var.m_Id = (uint32_t)sm_Variables.size();
+        sm_Variables.push_back(&var);
+        sm_Paths.push_back(path);
+        sm_Hashes.push_back(Hash);
+        sm_Lookup.emplace(Hash, var.m_Id);
+    }
+
+    static vector<EngineVar*> sm_Variables;
+    static vector<string> sm_Paths;
+    static vector<uint64_t> sm_Hashes;
+    static unordered_map<uint64_t, uint32_t> sm_Lookup;
+};
+
+vector<EngineVar*> VariableRegistry::sm_Variables;
+vector<string> VariableRegistry::sm_Paths;
+vector<uint64_t> VariableRegistry::sm_Hashes;
+unordered_map<uint64_t, uint32_t> VariableRegistry::sm_Lookup;
+
 // Not open to the public.  Groups are auto-created when a tweaker's path includes the group name.
 class VariableGroup : public EngineVar
 {
@@ -257,11 +286,11 @@ EngineVar* VariableGroup::PrevVariable( EngineVar* curVar )
 //=====================================================================================================================
 // EngineVar implementations
 
-EngineVar::EngineVar( void ) : m_GroupPtr(nullptr)
+EngineVar::EngineVar( void ) : m_GroupPtr(nullptr), m_Id(EngineTuning::kInvalidVarId)
 {
 }
 
-EngineVar::EngineVar( const std::string& path ) : m_GroupPtr(nullptr)
+EngineVar::EngineVar( const std::string& path ) : m_GroupPtr(nullptr), m_Id(EngineTuning::kInvalidVarId)
 {
     EngineTuning::RegisterVariable(path, *this);
 }
@@ -324,6 +353,17 @@ void BoolVar::SetValue(FILE* file, const std::string& setting)
         0 == _stricmp(valstr, "true") );
 }
 
+bool BoolVar::GetRawValue( uint32_t& bits ) const
+{
+    bits = m_Flag ? 1 : 0;
+    return true;
+}
+
+void BoolVar::SetRawValue( uint32_t bits )
+{
+    m_Flag = bits != 0;
+}
+
 NumVar::NumVar( const std::string& path, float val, float minVal, float maxVal, float stepSize )
     : EngineVar(path)
 {
@@ -356,6 +396,20 @@ void NumVar::SetValue(FILE* file, const std::string& setting)
         *this = valueRead; 
 }
 
+// ExpVar stores its exponent in m_Value, so it round trips through these as well
+bool NumVar::GetRawValue( uint32_t& bits ) const
+{
+    memcpy(&bits, &m_Value, sizeof(bits));
+    return true;
+}
+
+void NumVar::SetRawValue( uint32_t bits )
+{
+    float val;
+    memcpy(&val, &bits, sizeof(val));
+    m_Value = Clamp(val);
+}
+
 #if _MSC_VER < 1800
 __forceinline float log2( float x ) { return log(x) / log(2.0f); }
 __forceinline float exp2( float x ) { return pow(2.0f, x); }
@@ -430,6 +484,16 @@ void IntVar::SetValue(FILE* file, const std::string& setting)
         *this = valueRead;
 }
 
+bool IntVar::GetRawValue( uint32_t& bits ) const
+{
+    bits = (uint32_t)m_Value;
+    return true;
+}
+
+void IntVar::SetRawValue( uint32_t bits )
+{
+    m_Value = Clamp((int32_t)bits);
+}
 
 EnumVar::EnumVar( const std::string& path, int32_t initialVal, int32_t listLength, const char** listLabels )
     : EngineVar(path)
@@ -473,6 +537,17 @@ void EnumVar::SetValue(FILE* file, const std::string& setting)
 
 }
 
+bool EnumVar::GetRawValue( uint32_t& bits ) const
+{
+    bits = (uint32_t)m_Value;
+    return true;
+}
+
+void EnumVar::SetRawValue( uint32_t bits )
+{
+    m_Value = Clamp((int32_t)bits);
+}
+
 CallbackTrigger::CallbackTrigger( const std::string& path, std::function<void (void*)> callback, void* args )
     : EngineVar(path)
 {
@@ -597,6 +672,44 @@ void StartLoad(void*)
 std::function<void(void*)> StartLoadFunc = StartLoad;
 static CallbackTrigger Load("Load Settings", StartLoadFunc, nullptr); 
 
+void StartSaveSnapshot(void*)
+{
+    vector<uint8_t> blob;
+    EngineTuning::SaveSnapshot(blob);
+
+    FILE* snapshotFile;
+    fopen_s(&snapshotFile, "engineTuning.bin", "wb");
+    if (snapshotFile != nullptr)
+    {
+        fwrite(blob.data(), 1, blob.size(), snapshotFile);
+        fclose(snapshotFile);
+    }
+}
+static CallbackTrigger SaveSnap("Save Snapshot", StartSaveSnapshot, nullptr);
+
+void StartLoadSnapshot(void*)
+{
+    FILE* snapshotFile;
+    fopen_s(&snapshotFile, "engineTuning.bin", "rb");
+    if (snapshotFile != nullptr)
+    {
+        vector<uint8_t> blob;
+        fseek(snapshotFile, 0, SEEK_END);
+        long fileSize = ftell(snapshotFile);
+        fseek(snapshotFile, 0, SEEK_SET);
+        if (fileSize > 0)
+        {
+            blob.resize((size_t)fileSize);
+            blob.resize(fread(blob.data(), 1, blob.size(), snapshotFile));
+        }
+        fclose(snapshotFile);
+
+        if (!EngineTuning::RestoreSnapshot(blob.data(), blob.size()))
+            Utility::Print("Ignoring malformed engineTuning.bin\n");
+    }
+}
+static CallbackTrigger LoadSnap("Load Snapshot", StartLoadSnapshot, nullptr);
+
 
 void EngineTuning::Display( GraphicsContext& Context, float x, float y, float w, float h )
 {
@@ -612,6 +725,7 @@ void EngineTuning::Display( GraphicsContext& Context, float x, float y, float w,
     if (!sm_IsVisible)
     {
         EngineProfiling::Display(Text, x, y, w, h);
+        Text.End();
         return;
     }
 
@@ -621,6 +735,8 @@ void EngineTuning::Display( GraphicsContext& Context, float x, float y, float w,
     float hScale = g_DisplayWidth / 1920.0f;
     float vScale = g_DisplayHeight / 1080.0f;
 
+    // The frame rate is drawn outside the scissor rectangle
+    Text.Flush();
     Context.SetScissor((uint32_t)Floor(x * hScale), (uint32_t)Floor(y * vScale), 
         (uint32_t)Ceiling((x + w) * hScale), (uint32_t)Ceiling((y + h) * vScale));
 
@@ -630,10 +746,10 @@ void EngineTuning::Display( GraphicsContext& Context, float x, float y, float w,
     Text.SetTextSize(20.0f);
 
     VariableGroup::sm_RootGroup.Display( Text, x, sm_SelectedVariable );
-    
-    EngineProfiling::DisplayPerfGraph(Context);
 
     Text.End();
+
+    EngineProfiling::DisplayPerfGraph(Context);
     Context.SetScissor(0, 0, g_DisplayWidth, g_DisplayHeight);
 }
 
@@ -679,6 +795,7 @@ void EngineTuning::AddToVariableGraph( const string& path, EngineVar& var )
     }
 
     group->AddChild(leafName, var);
+    VariableRegistry::Add(path, var);
 }
 
 void EngineTuning::RegisterVariable( const std::string& path, EngineVar& var )
@@ -699,3 +816,67 @@ bool EngineTuning::IsFocused( void )
 {
     return sm_IsVisible;
 }
+
+uint64_t EngineTuning::HashPath( const std::string& path )
+{
+    return TuningSnapshot::HashPath(path);
+}
+
+uint32_t EngineTuning::GetVariableCount( void )
+{
+    return (uint32_t)VariableRegistry::sm_Variables.size();
+}
+
+EngineVar* EngineTuning::GetVariable( uint32_t id )
+{
+    ASSERT(id < GetVariableCount());
+    return VariableRegistry::sm_Variables[id];
+}
+
+const std::string& EngineTuning::GetVariablePath( uint32_t id )
+{
+    ASSERT(id < GetVariableCount());
+    return VariableRegistry::sm_Paths[id];
+}
+
+uint32_t EngineTuning::FindVariableId( uint64_t pathHash )
+{
+    auto iter = VariableRegistry::sm_Lookup.find(pathHash);
+    return iter == VariableRegistry::sm_Lookup.end() ? kInvalidVarId : iter->second;
+}
+
+void EngineTuning::SaveSnapshot( std::vector<uint8_t>& blob )
+{
+    // Entries follow registration order
+    const uint32_t NumVars = GetVariableCount();
+    vector<TuningSnapshot::Entry> Entries;
+    Entries.reserve(NumVars);
+
+    for (uint32_t i = 0; i < NumVars; ++i)
+    {
+        uint32_t Bits;
+        if (VariableRegistry::sm_Variables[i]->GetRawValue(Bits))
+            Entries.push_back({ VariableRegistry::sm_Hashes[i], Bits, 0 });
+    }
+
+    TuningSnapshot::Write(Entries.data(), (uint32_t)Entries.size(), blob);
+}
+
+bool EngineTuning::RestoreSnapshot( const void* data, size_t size )
+{
+    uint32_t Count;
+    const TuningSnapshot::Entry* Entries = TuningSnapshot::Read(data, size, Count);
+    if (Entries == nullptr)
+        return false;
+
+    // Variables added since the snapshot was taken keep their current values, and entries for
+    // variables that no longer exist are skipped.
+    for (uint32_t i = 0; i < Count; ++i)
+    {
+        uint32_t Id = FindVariableId(Entries[i].PathHash);
+        if (Id != kInvalidVarId)
+            VariableRegistry::sm_Variables[Id]->SetRawValue(Entries[i].Value);
+    }
+
+    return true;
+}
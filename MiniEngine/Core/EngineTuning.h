@@ -18,8 +18,10 @@
 #include <float.h>
 #include <map>
 #include <set>
+#include <vector>
 
 class VariableGroup;
+class VariableRegistry;
 class TextContext;
 
 class EngineVar
@@ -36,16 +38,27 @@ public:
     virtual std::string ToString( void ) const { return ""; }
     virtual void SetValue( FILE* file, const std::string& setting) = 0; //set value read from file
 
+    // The complete state of the variable packed into 32 bits, for binary snapshots.  Variables without
+    // state (groups and triggers) return false and are left out of snapshots.
+    virtual bool GetRawValue( uint32_t& ) const { return false; }
+    virtual void SetRawValue( uint32_t ) {}
+
     EngineVar* NextVar( void );
     EngineVar* PrevVar( void );
 
+    // Index into the variable registry, assigned in registration order.  Invalid until
+    // EngineTuning::Initialize() has registered the variable.
+    uint32_t GetId( void ) const { return m_Id; }
+
 protected:
     EngineVar( void );
     EngineVar( const std::string& path );
 
 private:
     friend class VariableGroup;
+    friend class VariableRegistry;
     VariableGroup* m_GroupPtr;
+    uint32_t m_Id;
 };
 
 class BoolVar : public EngineVar
@@ -62,6 +75,8 @@ public:
     virtual void DisplayValue( TextContext& Text ) const override;
     virtual std::string ToString( void ) const override;
     virtual void SetValue( FILE* file, const std::string& setting) override;
+    virtual bool GetRawValue( uint32_t& bits ) const override;
+    virtual void SetRawValue( uint32_t bits ) override;
 
 private:
     bool m_Flag;
@@ -80,6 +95,8 @@ public:
     virtual void DisplayValue( TextContext& Text ) const override;
     virtual std::string ToString( void ) const override;
     virtual void SetValue( FILE* file, const std::string& setting)  override;
+    virtual bool GetRawValue( uint32_t& bits ) const override;
+    virtual void SetRawValue( uint32_t bits ) override;
 
 protected:
     float Clamp( float val ) { return val > m_MaxValue ? m_MaxValue : val < m_MinValue ? m_MinValue : val; }
@@ -116,6 +133,8 @@ public:
     virtual void DisplayValue( TextContext& Text ) const override;
     virtual std::string ToString( void ) const override;
     virtual void SetValue( FILE* file, const std::string& setting ) override;
+    virtual bool GetRawValue( uint32_t& bits ) const override;
+    virtual void SetRawValue( uint32_t bits ) override;
 
 protected:
     int32_t Clamp( int32_t val ) { return val > m_MaxValue ? m_MaxValue : val < m_MinValue ? m_MinValue : val; }
@@ -139,6 +158,8 @@ public:
     virtual void DisplayValue( TextContext& Text ) const override;
     virtual std::string ToString( void ) const override;
     virtual void SetValue( FILE* file, const std::string& setting ) override;
+    virtual bool GetRawValue( uint32_t& bits ) const override;
+    virtual void SetRawValue( uint32_t bits ) override;
 
     void SetListLength(int32_t listLength) { m_EnumLength = listLength; m_Value = Clamp(m_Value); }
 
@@ -175,4 +196,28 @@ namespace EngineTuning
     void Display( GraphicsContext& Context, float x, float y, float w, float h );
     bool IsFocused( void );
 
+    // Flat registry of every variable, for lookups by ID or by hashed path.  IDs follow registration
+    // order, so they are stable for a given build but should not be persisted; use path hashes for that.
+    const uint32_t kInvalidVarId = 0xFFFFFFFF;
+
+    uint64_t HashPath( const std::string& path );
+    uint32_t GetVariableCount( void );
+    EngineVar* GetVariable( uint32_t id );
+    const std::string& GetVariablePath( uint32_t id );
+    uint32_t FindVariableId( uint64_t pathHash );
+    inline uint32_t FindVariableId( const std::string& path ) { return FindVariableId(HashPath(path)); }
+
+    template <typename T>
+    T* FindVariable( const std::string& path )
+    {
+        uint32_t id = FindVariableId(path);
+        return id == kInvalidVarId ? nullptr : dynamic_cast<T*>(GetVariable(id));
+    }
+
+    // Captures the value of every stateful variable into a compact binary blob keyed by path hash.
+    // Restoring applies each entry whose path is still registered and returns false if the blob is
+    // malformed.  Meant for saving settings per captured frame and replaying them in automated runs.
+    void SaveSnapshot( std::vector<uint8_t>& blob );
+    bool RestoreSnapshot( const void* data, size_t size );
+
 } // namespace EngineTuning
@@ -0,0 +1,207 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Built without the precompiled header so it has no dependency on Windows
+#include "FramePacer.h"
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>    // YieldProcessor
+#elif defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>  // _mm_pause
+#endif
+
+using namespace std;
+
+namespace
+{
+    // Never trust a sleep to land closer than this to the deadline, nor spin for longer than this
+    const double kMinSleepMargin = 0.0005;
+    const double kMaxSleepMargin = 0.020;
+
+    // Weight of the newest frame time in the smoothed timestep
+    const double kSmoothing = 0.1;
+
+    // Fraction of the accumulated drift between simulated and wall-clock time paid back each frame
+    const double kDriftCorrection = 0.1;
+
+    // Used for the first frame, before there is a previous one to measure against
+    const float kDefaultTimestep = 1.0f / 60.0f;
+
+    // Tells the core it is spinning, which saves power and frees the pipeline for a hyperthreaded sibling
+    inline void SpinPause( void )
+    {
+#ifdef _WIN32
+        YieldProcessor();
+#elif defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#endif
+    }
+}
+
+FramePacer::FramePacer( Clock& TimeSource )
+    : m_Clock(TimeSource), m_SecondsPerTick(0.0), m_TargetFrameTime(0.0f), m_MaxTimestep(0.25f), m_Smoothing(true),
+    m_FrameStartTick(0), m_PresentTick(0), m_SleepMargin(0.002),
+    m_Timestep(kDefaultTimestep), m_SmoothedFrameTime(0.0), m_WallTime(0.0), m_SimulatedTime(0.0), m_NumFrames(0)
+{
+    m_LastFrame.FrameTime = 0.0f;
+    m_LastFrame.Latency = 0.0f;
+    m_LastFrame.LimiterWait = 0.0f;
+    m_LastFrame.Timestep = kDefaultTimestep;
+}
+
+void FramePacer::MarkPresent( void )
+{
+    m_PresentTick = m_Clock.GetCurrentTick();
+}
+
+void FramePacer::WaitUntil( int64_t Deadline )
+{
+    int64_t Now = m_Clock.GetCurrentTick();
+    double Remaining = (Deadline - Now) * m_SecondsPerTick;
+
+    // Sleep while the deadline is further away than the OS might oversleep, and learn how late it actually
+    // wakes us.  Oversleeping raises the margin at once; it decays slowly when the OS is punctual.
+    if (Remaining > m_SleepMargin)
+    {
+        double Requested = Remaining - m_SleepMargin;
+        m_Clock.Sleep(Requested);
+
+        int64_t Woke = m_Clock.GetCurrentTick();
+        double Overshoot = (Woke - Now) * m_SecondsPerTick - Requested;
+        if (Overshoot > m_SleepMargin)
+            m_SleepMargin = Overshoot * 1.25;
+        else
+            m_SleepMargin = m_SleepMargin * 0.99 + max(Overshoot, 0.0) * 1.25 * 0.01;
+        m_SleepMargin = min(max(m_SleepMargin, kMinSleepMargin), kMaxSleepMargin);
+    }
+
+    while (m_Clock.GetCurrentTick() < Deadline)
+        SpinPause();
+}
+
+void FramePacer::BeginFrame( void )
+{
+    if (m_SecondsPerTick == 0.0)
+        m_SecondsPerTick = m_Clock.GetSecondsPerTick();
+
+    const bool FirstFrame = m_FrameStartTick == 0;
+
+    int64_t WaitStart = m_Clock.GetCurrentTick();
+    if (!FirstFrame && m_TargetFrameTime > 0.0f)
+        WaitUntil(m_FrameStartTick + (int64_t)(m_TargetFrameTime / m_SecondsPerTick));
+
+    int64_t StartTick = m_Clock.GetCurrentTick();
+    double Wait = (StartTick - WaitStart) * m_SecondsPerTick;
+
+    if (FirstFrame)
+    {
+        m_FrameStartTick = StartTick;
+        return;
+    }
+
+    // Record the frame that just ended, including the wait that closed it out
+    double FrameTime = (StartTick - m_FrameStartTick) * m_SecondsPerTick;
+    double Latency = m_PresentTick > m_FrameStartTick ? (m_PresentTick - m_FrameStartTick) * m_SecondsPerTick : 0.0;
+
+    m_LastFrame.FrameTime = (float)FrameTime;
+    m_LastFrame.Latency = (float)Latency;
+    m_LastFrame.LimiterWait = (float)Wait;
+    m_LastFrame.Timestep = m_Timestep;
+
+    uint32_t Slot = m_NumFrames % kHistorySize;
+    m_FrameTimes[Slot] = (float)FrameTime;
+    m_Latencies[Slot] = (float)Latency;
+    m_Waits[Slot] = (float)Wait;
+    ++m_NumFrames;
+
+    m_FrameStartTick = StartTick;
+
+    if (!m_Smoothing)
+    {
+        m_Timestep = (float)min(FrameTime, (double)m_MaxTimestep);
+        return;
+    }
+
+    // A hitch resets the smoothing instead of being fed into it or paid back over the following frames.
+    // The next frame starts the smoothing over from its own frame time.
+    if (FrameTime > m_MaxTimestep)
+    {
+        m_Timestep = m_MaxTimestep;
+        m_SmoothedFrameTime = 0.0;
+        m_WallTime = m_SimulatedTime = 0.0;
+        return;
+    }
+
+    if (m_SmoothedFrameTime == 0.0)
+        m_SmoothedFrameTime = FrameTime;
+    else
+        m_SmoothedFrameTime += (FrameTime - m_SmoothedFrameTime) * kSmoothing;
+
+    // When the limiter keeps up, the ideal step is exactly the target
+    double Step = m_SmoothedFrameTime;
+    if (m_TargetFrameTime > 0.0f && FrameTime < m_TargetFrameTime * 1.1)
+        Step = m_TargetFrameTime;
+
+    // Steer simulated time back toward wall-clock time so that the smoothing never drifts
+    m_WallTime += FrameTime;
+    Step += (m_WallTime - m_SimulatedTime - Step) * kDriftCorrection;
+    Step = min(max(Step, m_SmoothedFrameTime * 0.5), (double)m_MaxTimestep);
+    m_SimulatedTime += Step;
+
+    m_Timestep = (float)Step;
+}
+
+FramePacer::PacingStats FramePacer::ComputeStats( void ) const
+{
+    PacingStats Stats = {};
+
+    uint32_t Count = min(m_NumFrames, (uint32_t)kHistorySize);
+    Stats.NumFrames = Count;
+    if (Count == 0)
+        return Stats;
+
+    // Oldest first, so that consecutive differences are in frame order
+    const uint32_t First = m_NumFrames - Count;
+
+    double SumFrameTime = 0.0, SumSquares = 0.0, SumJitter = 0.0, SumLatency = 0.0, SumWait = 0.0;
+    for (uint32_t i = 0; i < Count; ++i)
+    {
+        uint32_t Slot = (First + i) % kHistorySize;
+        float FrameTime = m_FrameTimes[Slot];
+
+        SumFrameTime += FrameTime;
+        SumSquares += (double)FrameTime * FrameTime;
+        SumLatency += m_Latencies[Slot];
+        SumWait += m_Waits[Slot];
+        Stats.MaxFrameTime = max(Stats.MaxFrameTime, FrameTime);
+        Stats.MaxLatency = max(Stats.MaxLatency, m_Latencies[Slot]);
+
+        if (i > 0)
+            SumJitter += fabs(FrameTime - m_FrameTimes[(First + i - 1) % kHistorySize]);
+    }
+
+    double Avg = SumFrameTime / Count;
+    Stats.AvgFrameTime = (float)Avg;
+    Stats.FrameTimeStdDev = (float)sqrt(max(SumSquares / Count - Avg * Avg, 0.0));
+    Stats.AvgJitter = Count > 1 ? (float)(SumJitter / (Count - 1)) : 0.0f;
+    Stats.AvgLatency = (float)(SumLatency / Count);
+    Stats.AvgLimiterWait = (float)(SumWait / Count);
+
+    for (uint32_t i = 0; i < Count; ++i)
+    {
+        if (m_FrameTimes[(First + i) % kHistorySize] > Avg * 1.5)
+            ++Stats.Stutters;
+    }
+
+    return Stats;
+}
@@ -0,0 +1,110 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Frame pacing.  An optional limiter holds each frame back until the target frame time has
+// passed since the previous one began, sleeping while the deadline is far away and spinning for the last
+// stretch.  The sleep margin adapts to how late the OS wakes us.  The simulation timestep is smoothed so
+// that present jitter does not show up as uneven motion, while any drift from wall-clock time is paid back
+// gradually.  Each frame also records CPU-start-to-present latency and the present-to-present interval.
+// All timing goes through an injected Clock, so the class can be driven without a window or a device.
+
+#pragma once
+
+#include <cstdint>
+
+class FramePacer
+{
+public:
+
+    class Clock
+    {
+    public:
+        virtual ~Clock() {}
+        virtual int64_t GetCurrentTick( void ) = 0;
+        virtual double GetSecondsPerTick( void ) = 0;
+
+        // Allowed to wake up late
+        virtual void Sleep( double Seconds ) = 0;
+    };
+
+    // Timings of the most recently completed frame, in seconds
+    struct FrameTiming
+    {
+        float FrameTime;        // Between the starts of this frame and the previous one
+        float Latency;          // From the start of CPU work to the present call
+        float LimiterWait;      // Part of FrameTime spent in the limiter
+        float Timestep;         // Simulation step handed to the frame
+    };
+
+    // Summary over the last kHistorySize frames, in seconds
+    struct PacingStats
+    {
+        float AvgFrameTime;
+        float FrameTimeStdDev;
+        float MaxFrameTime;
+        float AvgJitter;        // Mean difference between consecutive frame times
+        float AvgLatency;
+        float MaxLatency;
+        float AvgLimiterWait;
+        uint32_t Stutters;      // Frames that took more than 1.5x the average
+        uint32_t NumFrames;
+    };
+
+    enum { kHistorySize = 128 };
+
+    explicit FramePacer( Clock& TimeSource );
+
+    // A target of 0 disables the limiter
+    void SetTargetFrameTime( float Seconds ) { m_TargetFrameTime = Seconds; }
+    float GetTargetFrameTime( void ) const { return m_TargetFrameTime; }
+
+    void EnableSmoothing( bool Enable ) { m_Smoothing = Enable; }
+
+    // Steps longer than this are treated as hitches (loading, breakpoints) and not paid back
+    void SetMaxTimestep( float Seconds ) { m_MaxTimestep = Seconds; }
+
+    // Call just before handing the frame to the swap chain
+    void MarkPresent( void );
+
+    // Call after presenting.  Waits out the rest of the target frame time if the limiter is on, then starts
+    // timing the next frame and computes its timestep.
+    void BeginFrame( void );
+
+    float GetTimestep( void ) const { return m_Timestep; }
+    const FrameTiming& GetLastFrame( void ) const { return m_LastFrame; }
+    PacingStats ComputeStats( void ) const;
+
+    float GetSleepMargin( void ) const { return (float)m_SleepMargin; }
+
+private:
+
+    void WaitUntil( int64_t Deadline );
+
+    Clock& m_Clock;
+    double m_SecondsPerTick;
+
+    float m_TargetFrameTime;
+    float m_MaxTimestep;
+    bool m_Smoothing;
+
+    int64_t m_FrameStartTick;
+    int64_t m_PresentTick;
+    double m_SleepMargin;
+
+    float m_Timestep;
+    double m_SmoothedFrameTime;
+    double m_WallTime;
+    double m_SimulatedTime;
+
+    FrameTiming m_LastFrame;
+
+    float m_FrameTimes[kHistorySize];
+    float m_Latencies[kHistorySize];
+    float m_Waits[kHistorySize];
+    uint32_t m_NumFrames;
+};
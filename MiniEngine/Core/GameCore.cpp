@@ -15,10 +15,13 @@
 #include "GameCore.h"
 #include "GraphicsCore.h"
 #include "SystemTime.h"
+#include "JobSystem.h"
 #include "GameInput.h"
 #include "BufferManager.h"
 #include "CommandContext.h"
 #include "PostEffects.h"
+#include "TextureManager.h"
+#include "TraceCapture.h"
 
 #include "ART/GUI/GUICore.h"
 
@@ -49,6 +52,7 @@ namespace GameCore
     {
         Graphics::Initialize();
         SystemTime::Initialize();
+        g_JobScheduler.Initialize();
         GameInput::Initialize();
         EngineTuning::Initialize();
 
@@ -59,7 +63,9 @@ namespace GameCore
     {
         game.Cleanup();
 
+        TraceCapture::Flush();
         GameInput::Shutdown();
+        g_JobScheduler.Shutdown();
     }
 
     bool UpdateApplication( IGameApp& game )
@@ -75,6 +81,8 @@ namespace GameCore
 #endif
 
         EngineTuning::Update(DeltaTime);
+
+        TextureManager::Update();
         
         game.Update(DeltaTime);
         game.RenderScene();
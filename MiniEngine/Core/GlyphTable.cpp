@@ -0,0 +1,106 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Built without the precompiled header so it has no dependency on Windows
+#include "GlyphTable.h"
+
+#include <algorithm>
+
+using namespace std;
+
+void TextRenderer::GlyphTable::Build( const uint16_t* Characters, const Glyph* Glyphs, uint16_t NumGlyphs, uint16_t FontHeight )
+{
+    m_FontHeight = FontHeight;
+
+    uint32_t DenseSize = 0;
+    for (uint16_t i = 0; i < NumGlyphs; ++i)
+    {
+        if (Characters[i] < kDenseGlyphRange)
+            DenseSize = max(DenseSize, (uint32_t)Characters[i] + 1);
+    }
+
+    m_Glyphs.assign(Glyphs, Glyphs + NumGlyphs);
+    m_DenseGlyphIndex.assign(DenseSize, 0);
+    m_SparseGlyphIndex.clear();
+
+    for (uint16_t i = 0; i < NumGlyphs; ++i)
+    {
+        if (Characters[i] < kDenseGlyphRange)
+            m_DenseGlyphIndex[Characters[i]] = (uint16_t)(i + 1);
+        else
+            m_SparseGlyphIndex.push_back(make_pair(Characters[i], (uint16_t)(i + 1)));
+    }
+
+    sort(m_SparseGlyphIndex.begin(), m_SparseGlyphIndex.end());
+}
+
+uint32_t TextRenderer::GlyphTable::FindSparseGlyph( uint32_t ch ) const
+{
+    if (ch > 0xFFFF)
+        return 0;
+
+    auto it = lower_bound(m_SparseGlyphIndex.begin(), m_SparseGlyphIndex.end(), make_pair((uint16_t)ch, (uint16_t)0));
+    return it != m_SparseGlyphIndex.end() && it->first == ch ? it->second : 0;
+}
+
+uint32_t TextRenderer::GlyphLayout::FillVertexBuffer( TextVert* verts, const char* str, size_t stride, size_t slen )
+{
+    uint32_t charsDrawn = 0;
+
+    const float UVtoPixel = TextSize / Glyphs->GetHeight();
+
+    float curX = TextPosX;
+    float curY = TextPosY;
+
+    const uint16_t texelHeight = Glyphs->GetHeight();
+
+    const char* iter = str;
+    for (size_t i = 0; i < slen; ++i)
+    {
+        uint32_t wc = stride == 1 ? (uint8_t)*iter : stride == 2 ? *(const uint16_t*)iter : *(const uint32_t*)iter;
+        iter += stride;
+
+        // Terminate on null character (this really shouldn't happen with string or wstring)
+        if (wc == 0)
+            break;
+
+        // Handle newlines by inserting a carriage return and line feed
+        if (wc == '\n')
+        {
+            curX = LeftMargin;
+            curY += LineHeight;
+            continue;
+        }
+
+        const GlyphTable::Glyph* gi = Glyphs->GetGlyph(wc);
+
+        // Ignore missing characters
+        if (nullptr == gi)
+            continue;
+
+        verts->X = curX + (float)gi->bearing * UVtoPixel;
+        verts->Y = curY;
+        verts->U = gi->x;
+        verts->V = gi->y;
+        verts->W = gi->w;
+        verts->H = texelHeight;
+        verts->Size = TextSize;
+        verts->Color = Color;
+        ++verts;
+
+        // Advance the cursor position
+        curX += (float)gi->advance * UVtoPixel;
+        ++charsDrawn;
+    }
+
+    TextPosX = curX;
+    TextPosY = curY;
+
+    return charsDrawn;
+}
@@ -0,0 +1,98 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  The glyphs of an SDF font and the layout of text into glyph vertices.  Kept apart from
+// TextRenderer, which needs the device for the font texture, so text can be laid out headless and tested.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace TextRenderer
+{
+    class GlyphTable
+    {
+    public:
+
+        // Each character has an XY start offset, a width, and they all share the same height
+        struct Glyph
+        {
+            uint16_t x, y, w;
+            int16_t bearing;
+            uint16_t advance;
+        };
+
+        GlyphTable() : m_FontHeight(0) {}
+
+        // Characters are the UTF-16 code units of the font file, one per glyph.  FontHeight is the texel
+        // height of every glyph in 12.4 fixed point.
+        void Build( const uint16_t* Characters, const Glyph* Glyphs, uint16_t NumGlyphs, uint16_t FontHeight );
+
+        // Returns nullptr for characters missing from the font
+        const Glyph* GetGlyph( uint32_t ch ) const
+        {
+            uint32_t index = 0;
+            if (ch < m_DenseGlyphIndex.size())
+                index = m_DenseGlyphIndex[ch];
+            else if (ch >= kDenseGlyphRange)
+                index = FindSparseGlyph(ch);
+            return index == 0 ? nullptr : &m_Glyphs[index - 1];
+        }
+
+        // Get the texel height of the font in 12.4 fixed point
+        uint16_t GetHeight( void ) const { return m_FontHeight; }
+
+        uint32_t GetNumGlyphs( void ) const { return (uint32_t)m_Glyphs.size(); }
+        uint32_t GetDenseTableSize( void ) const { return (uint32_t)m_DenseGlyphIndex.size(); }
+        uint32_t GetSparseTableSize( void ) const { return (uint32_t)m_SparseGlyphIndex.size(); }
+
+        // Characters below kDenseGlyphRange index the glyph array directly; the rest, which are rare in
+        // the fonts we ship, are found by binary search.  Indices are one-based so that zero means missing.
+        static const uint32_t kDenseGlyphRange = 0x3000;
+
+    private:
+
+        uint32_t FindSparseGlyph( uint32_t ch ) const;
+
+        uint16_t m_FontHeight;
+        std::vector<Glyph> m_Glyphs;
+        std::vector<uint16_t> m_DenseGlyphIndex;
+        std::vector< std::pair<uint16_t, uint16_t> > m_SparseGlyphIndex;
+    };
+
+    // One glyph in the text vertex stream.  Color and size travel with every glyph so that strings drawn
+    // with different settings still share a single draw.
+    struct TextVert
+    {
+        float X, Y;				// Upper-left glyph position in screen space
+        uint16_t U, V, W, H;	// Upper-left glyph UV and the width in texture space
+        float Size;				// Height of the text in screen space
+        uint32_t Color;			// R8G8B8A8
+    };
+
+    // The cursor and style that turn characters into glyph vertices
+    struct GlyphLayout
+    {
+        const GlyphTable* Glyphs;
+        float TextSize;
+        float LeftMargin;
+        float TextPosX;
+        float TextPosY;
+        float LineHeight;
+        uint32_t Color;
+
+        // Writes one vertex per visible character and advances the cursor.  Stride is the size of a
+        // character:  1 for char strings, 2 or 4 for wchar_t strings.  Newlines return to the left margin;
+        // characters missing from the font are skipped.  Returns the number of vertices written.
+        uint32_t FillVertexBuffer( TextVert* verts, const char* str, size_t stride, size_t slen );
+    };
+}
@@ -92,6 +92,13 @@ void GpuBuffer::Create(const std::wstring& name, uint32_t NumElements, uint32_t
     Create(name, NumElements, ElementSize, initialData);
 }
 
+void GpuBuffer::Destroy(void)
+{
+    FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_SRV);
+    FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_UAV);
+    GpuResource::Destroy();
+}
+
 D3D12_CPU_DESCRIPTOR_HANDLE GpuBuffer::CreateConstantBufferView(uint32_t Offset, uint32_t Size) const
 {
     ASSERT(Offset + Size <= m_BufferSize);
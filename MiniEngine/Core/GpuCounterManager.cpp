@@ -191,6 +191,31 @@ float GpuCounterManager::GetTime(uint32_t TimerIdx)
     return static_cast<float>(sm_GpuTickDelta * (TimeStamp2 - TimeStamp1));
 }
 
+bool GpuCounterManager::GetTimeStamps(uint32_t TimerIdx, uint64_t& Start, uint64_t& Stop)
+{
+    ASSERT(sm_TimeStampBuffer != nullptr, "Time stamp readback buffer is not mapped");
+    ASSERT(TimerIdx < sm_NumTimers, "Invalid GPU timer index");
+
+    Start = sm_TimeStampBuffer[TimerIdx * 2];
+    Stop = sm_TimeStampBuffer[TimerIdx * 2 + 1];
+
+    return Start >= sm_ValidTimeStart && Stop <= sm_ValidTimeEnd && Stop > Start;
+}
+
+double GpuCounterManager::GetTickDelta(void)
+{
+    return sm_GpuTickDelta;
+}
+
+TraceCapture::ClockCalibration GpuCounterManager::GetClockCalibration(void)
+{
+    uint64_t GpuTimeStamp, CpuTick;
+    ASSERT_SUCCEEDED(Graphics::g_CommandManager.GetCommandQueue()->GetClockCalibration(&GpuTimeStamp, &CpuTick));
+
+    TraceCapture::ClockCalibration Clock = { GpuTimeStamp, (int64_t)CpuTick, sm_GpuTickDelta };
+    return Clock;
+}
+
 void GpuCounterManager::GetPipelineStatistics(uint32_t QueryIdx, D3D12_QUERY_DATA_PIPELINE_STATISTICS& stats) {
 	ASSERT(sm_PipelineQueryDataBuffer != nullptr, "Pipeline query readback buffer is not mapped");
 	ASSERT(QueryIdx < sm_NumPipelineQueries, "Invalid pipeline query index");
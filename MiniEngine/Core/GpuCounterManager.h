@@ -14,6 +14,7 @@
 #pragma once
 
 #include "GameCore.h"
+#include "TraceCapture.h"
 
 class CommandContext;
 
@@ -42,5 +43,14 @@ namespace GpuCounterManager
 
     // Returns the time in milliseconds between start and stop queries
     float GetTime(uint32_t TimerIdx);
+
+    // Returns the raw start and stop time stamps, or false if they don't belong to the last resolved frame
+    bool GetTimeStamps(uint32_t TimerIdx, uint64_t& Start, uint64_t& Stop);
+
+    // Seconds per GPU time stamp tick
+    double GetTickDelta(void);
+
+    // Pairs a time stamp of the graphics queue with the CPU tick taken at the same moment
+    TraceCapture::ClockCalibration GetClockCalibration(void);
 	void GetPipelineStatistics(uint32_t QueryIdx, D3D12_QUERY_DATA_PIPELINE_STATISTICS& stats);
 }
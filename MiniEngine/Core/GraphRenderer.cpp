@@ -452,6 +452,7 @@ void GraphRenderer::RenderGraphs(GraphicsContext& Context, GraphType Type)
         XMFLOAT2 textSpace = XMFLOAT2(45.0f, 5.0f);
         DrawGraphHeaders(Text, (viewport.TopLeftX),  blankSpace, 0.0f, (viewport.Height + blankSpace), ProfileGraphs.GetMin(), 
             ProfileGraphs.GetMax(), ProfileGraphs.GetPresetMax(), false, PROFILE_DEBUG_VAR_COUNT, graphTitles);
+        Text.Flush();
         
         Context.SetRootSignature(s_RootSignature);
         Context.TransitionResource(g_OverlayBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
@@ -488,6 +489,7 @@ void GraphRenderer::RenderGraphs(GraphicsContext& Context, GraphType Type)
         std::string graphTitles[] = { "CPU - GPU      " };
         DrawGraphHeaders( Text, (viewport.TopLeftX), blankSpace,  (viewport.TopLeftY - blankSpace - textSpace.y), (viewport.Height + blankSpace), 
                                         GlobalGraphs.GetMinAbs(), GlobalGraphs.GetMaxAbs(), GlobalGraphs.GetPresetMax(), true, 1, graphTitles);
+        Text.Flush();
 
         Context.SetRootSignature(s_RootSignature);
         Context.TransitionResource(g_OverlayBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
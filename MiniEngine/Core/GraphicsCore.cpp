@@ -24,6 +24,7 @@
 #include "TextRenderer.h"
 #include "ColorBuffer.h"
 #include "SystemTime.h"
+#include "FramePacer.h"
 #include "SamplerManager.h"
 #include "DescriptorHeap.h"
 #include "CommandContext.h"
@@ -45,6 +46,9 @@
 
 #if !WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
     #include <agile.h>
+#else
+    #include <timeapi.h>	// For the frame limiter's timer resolution
+    #pragma comment(lib, "winmm.lib")
 #endif
 
 #if defined(NTDDI_WIN10_RS2) && (NTDDI_VERSION >= NTDDI_WIN10_RS2)
@@ -99,15 +103,48 @@ namespace GameCore
 
 namespace
 {
+    // Sleep() is only as precise as the OS timer.  The pacer measures how late it wakes up and spins for the rest.
+    class SystemPacingClock : public FramePacer::Clock
+    {
+    public:
+        SystemPacingClock() : m_FineTimer(false) {}
+
+        virtual int64_t GetCurrentTick( void ) override { return SystemTime::GetCurrentTick(); }
+        virtual double GetSecondsPerTick( void ) override { return SystemTime::TicksToSeconds(1); }
+        virtual void Sleep( double Seconds ) override { ::Sleep((DWORD)(Seconds * 1000.0)); }
+
+        // At the default 15.6 ms timer period a sleep can overshoot by most of a 60 Hz frame, leaving the
+        // pacer to spin it out.  While the limiter is on, raise the period to 1 ms; restore it when it's off.
+        void EnableFineTimer( bool Enable )
+        {
+            if (Enable == m_FineTimer)
+                return;
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+            if (Enable)
+                timeBeginPeriod(1);
+            else
+                timeEndPeriod(1);
+#endif
+            m_FineTimer = Enable;
+        }
+
+    private:
+        bool m_FineTimer;
+    };
+
     float s_FrameTime = 0.0f;
 	float s_OfflineTimeStep = 0.0f;
     uint64_t s_FrameIndex = 0;
-    int64_t s_FrameStartTick = 0;
+    SystemPacingClock s_PacingClock;
+    FramePacer s_FramePacer(s_PacingClock);
 
     // DRR: TODO
     BoolVar s_EnableVSync("Timing/VSync", false /*true*/);
     BoolVar s_LimitTo30Hz("Timing/Limit To 30Hz", false);
     BoolVar s_DropRandomFrames("Timing/Drop Random Frames", false);
+    BoolVar s_EnableFrameLimiter("Timing/Frame Limiter", false);
+    IntVar s_TargetFrameRate("Timing/Target Frame Rate", 60, 20, 240, 5);
+    BoolVar s_SmoothTimestep("Timing/Smooth Timestep", true);
 }
 
 namespace Graphics
@@ -205,10 +242,10 @@ namespace Graphics
 
     DescriptorAllocator g_DescriptorAllocator[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES] =
     {
-        D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
-        D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER,
-        D3D12_DESCRIPTOR_HEAP_TYPE_RTV,
-        D3D12_DESCRIPTOR_HEAP_TYPE_DSV,
+        { D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV },
+        { D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER },
+        { D3D12_DESCRIPTOR_HEAP_TYPE_RTV },
+        { D3D12_DESCRIPTOR_HEAP_TYPE_DSV },
     };
 
     RootSignature s_PresentRS;
@@ -629,6 +666,7 @@ void Graphics::Terminate( void )
 
 void Graphics::Shutdown( void )
 {
+    s_PacingClock.EnableFineTimer(false);
     CommandContext::DestroyAllContexts();
     g_CommandManager.Shutdown();
     GpuCounterManager::Shutdown();
@@ -833,6 +871,7 @@ void Graphics::Present(void)
 
     UINT PresentInterval = s_EnableVSync ? std::min(4, (int)Round(s_FrameTime * 60.0f)) : 0;
 
+    s_FramePacer.MarkPresent();
     s_SwapChain1->Present(PresentInterval, 0);
 
     // Test robustness to handle spikes in CPU time
@@ -842,7 +881,10 @@ void Graphics::Present(void)
     //		BusyLoopSleep(0.010);
     //}
 
-    int64_t CurrentTick = SystemTime::GetCurrentTick();
+    s_PacingClock.EnableFineTimer(s_EnableFrameLimiter);
+    s_FramePacer.SetTargetFrameTime(s_EnableFrameLimiter ? 1.0f / (float)(int32_t)s_TargetFrameRate : 0.0f);
+    s_FramePacer.EnableSmoothing(s_SmoothTimestep);
+    s_FramePacer.BeginFrame();
 
     if (s_EnableVSync)
     {
@@ -852,20 +894,17 @@ void Graphics::Present(void)
         s_FrameTime = (s_LimitTo30Hz ? 2.0f : 1.0f) / 60.0f;
         if (s_DropRandomFrames)
         {
-            if (std::rand() % 50 == 0)
+            if (Math::g_RNG.NextInt(49) == 0)
                 s_FrameTime += (1.0f / 60.0f);
         }
     }
     else
     {
-        // When running free, keep the most recent total frame time as the time step for
-        // the next frame simulation.  This is not super-accurate, but assuming a frame
-        // time varies smoothly, it should be close enough.
-        s_FrameTime = (float)SystemTime::TimeBetweenTicks(s_FrameStartTick, CurrentTick);
+        // When running free, the pacer smooths recent frame times into the time step for the
+        // next frame simulation, so that present jitter does not turn into uneven motion.
+        s_FrameTime = s_FramePacer.GetTimestep();
     }
 
-    s_FrameStartTick = CurrentTick;
-
     ++s_FrameIndex;
     TemporalEffects::Update((uint32_t)s_FrameIndex);
 
@@ -905,6 +944,11 @@ float Graphics::GetFrameRate(void)
     return s_FrameTime == 0.0f ? 0.0f : 1.0f / s_FrameTime;
 }
 
+const FramePacer& Graphics::GetFramePacer(void)
+{
+    return s_FramePacer;
+}
+
 void Graphics::SetOfflineTimestep(float spf) {
 	s_OfflineTimeStep = spf;
 }
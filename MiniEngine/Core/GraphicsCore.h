@@ -29,6 +29,7 @@ class CommandContext;
 class CommandListManager;
 class CommandSignature;
 class ContextManager;
+class FramePacer;
 
 namespace Graphics
 {
@@ -68,6 +69,9 @@ namespace Graphics
     // The total number of frames per second
     float GetFrameRate(void);
 
+    // Per-frame pacing and latency measurements, and the limiter that evens out frame delivery
+    const FramePacer& GetFramePacer(void);
+
 	// if greater  than zero, the app will update the time with a constant rate
 	// if zero, it will render interactively, based on the system time
 	// The meaning of the time is "seconds per frame"
@@ -87,6 +91,13 @@ namespace Graphics
         return g_DescriptorAllocator[Type].Allocate(Count);
     }
 
+    // Hands the range back for reuse once the GPU is done with the current frame, and marks the handle unallocated
+    inline void FreeDescriptor( D3D12_DESCRIPTOR_HEAP_TYPE Type, D3D12_CPU_DESCRIPTOR_HANDLE& Handle, UINT Count = 1 )
+    {
+        g_DescriptorAllocator[Type].Free(Handle, Count);
+        Handle.ptr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN;
+    }
+
     extern bool g_IntelIsGPU;
     extern RootSignature g_GenerateMipsRS;
     extern ComputePSO g_GenerateMipsLinearPSO[4];
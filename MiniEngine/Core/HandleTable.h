@@ -0,0 +1,134 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  A table of objects addressed by generational handles.  A handle packs a slot index with
+// the slot's generation, which is bumped whenever the slot is freed, so a handle to a removed object
+// stays invalid even after its slot is reused.  Values are stored densely for iteration, and removal
+// swaps the last value into the hole, so inserts and removes are O(1).  Iteration order is not stable
+// across removals.  The table is not thread safe.
+//
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+template <typename T>
+class HandleTable
+{
+public:
+
+    typedef uint32_t Handle;
+    static const Handle kInvalidHandle = 0xFFFFFFFF;
+
+    // 20 bits of slot index leaves 12 bits of generation, so a slot must be reused 4096 times before
+    // a stale handle to it can alias a live one.
+    enum { kIndexBits = 20, kMaxSlots = (1 << kIndexBits) - 1 };
+
+    Handle Insert( T&& Value )
+    {
+        uint32_t Slot;
+        if (m_FreeSlots.empty())
+        {
+            assert(m_Slots.size() < kMaxSlots && "Handle table is full");
+            Slot = (uint32_t)m_Slots.size();
+            m_Slots.push_back({ 0, 0 });
+        }
+        else
+        {
+            Slot = m_FreeSlots.back();
+            m_FreeSlots.pop_back();
+        }
+
+        m_Slots[Slot].DenseIndex = (uint32_t)m_Values.size();
+        m_Values.push_back(std::move(Value));
+        m_DenseToSlot.push_back(Slot);
+
+        return MakeHandle(Slot, m_Slots[Slot].Generation);
+    }
+
+    bool IsValid( Handle H ) const
+    {
+        uint32_t Slot = H & kMaxSlots;
+        return H != kInvalidHandle && Slot < m_Slots.size() && m_Slots[Slot].Generation == (H >> kIndexBits)
+            && m_Slots[Slot].DenseIndex != kFreeSlot;
+    }
+
+    T* Get( Handle H )
+    {
+        return IsValid(H) ? &m_Values[m_Slots[H & kMaxSlots].DenseIndex] : nullptr;
+    }
+
+    // Returns false if the handle was already stale
+    bool Remove( Handle H )
+    {
+        if (!IsValid(H))
+            return false;
+
+        RemoveAt(m_Slots[H & kMaxSlots].DenseIndex);
+        return true;
+    }
+
+    void Clear( void )
+    {
+        while (!m_Values.empty())
+            RemoveAt((uint32_t)m_Values.size() - 1);
+    }
+
+    // Dense access for iteration
+    uint32_t GetCount( void ) const { return (uint32_t)m_Values.size(); }
+    T& operator[]( uint32_t DenseIndex ) { return m_Values[DenseIndex]; }
+    const T& operator[]( uint32_t DenseIndex ) const { return m_Values[DenseIndex]; }
+    Handle GetHandle( uint32_t DenseIndex ) const
+    {
+        uint32_t Slot = m_DenseToSlot[DenseIndex];
+        return MakeHandle(Slot, m_Slots[Slot].Generation);
+    }
+
+private:
+
+    static const uint32_t kFreeSlot = 0xFFFFFFFF;
+
+    struct SlotEntry
+    {
+        uint32_t Generation;
+        uint32_t DenseIndex;
+    };
+
+    static Handle MakeHandle( uint32_t Slot, uint32_t Generation )
+    {
+        return Generation << kIndexBits | Slot;
+    }
+
+    void RemoveAt( uint32_t DenseIndex )
+    {
+        uint32_t Slot = m_DenseToSlot[DenseIndex];
+        uint32_t Last = (uint32_t)m_Values.size() - 1;
+        if (DenseIndex != Last)
+        {
+            m_Values[DenseIndex] = std::move(m_Values[Last]);
+            m_DenseToSlot[DenseIndex] = m_DenseToSlot[Last];
+            m_Slots[m_DenseToSlot[DenseIndex]].DenseIndex = DenseIndex;
+        }
+        m_Values.pop_back();
+        m_DenseToSlot.pop_back();
+
+        // Slot kMaxSlots is never allocated, so no generation can produce kInvalidHandle
+        SlotEntry& Entry = m_Slots[Slot];
+        Entry.Generation = (Entry.Generation + 1) & ((1 << (32 - kIndexBits)) - 1);
+        Entry.DenseIndex = kFreeSlot;
+        m_FreeSlots.push_back(Slot);
+    }
+
+    std::vector<T> m_Values;
+    std::vector<uint32_t> m_DenseToSlot;
+    std::vector<SlotEntry> m_Slots;
+    std::vector<uint32_t> m_FreeSlots;
+};
@@ -0,0 +1,552 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Built without the precompiled header so it has no dependency on Windows
+#include "JobSystem.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+JobScheduler g_JobScheduler;
+
+namespace
+{
+    // Threads that do not belong to the scheduler
+    const uint32_t kExternalThread = 0xFFFFFFFF;
+
+    // Idle passes over the queues before a worker goes to sleep
+    const uint32_t kSpinCount = 64;
+
+    // Keeps the deque indices written by the owner and by thieves on separate cache lines
+    const size_t kCacheLineSize = 64;
+
+    struct ThreadBinding
+    {
+        const JobScheduler* Scheduler;
+        uint32_t Index;
+    };
+
+    thread_local ThreadBinding s_ThreadBinding = { nullptr, kExternalThread };
+
+    inline uint64_t GetNanoseconds( void )
+    {
+        return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    struct AtomicStats
+    {
+        atomic<uint64_t> JobsRun;
+        atomic<uint64_t> JobsStolen;
+        atomic<uint64_t> FailedSteals;
+        atomic<uint64_t> Splits;
+        atomic<uint64_t> Sleeps;
+        atomic<uint64_t> BusyNanoseconds;
+        atomic<uint32_t> PeakQueueDepth;
+        atomic<uint32_t> FramePeakQueueDepth;
+
+        AtomicStats() { Reset(); }
+
+        void Reset( void )
+        {
+            JobsRun = 0;
+            JobsStolen = 0;
+            FailedSteals = 0;
+            Splits = 0;
+            Sleeps = 0;
+            BusyNanoseconds = 0;
+            PeakQueueDepth = 0;
+            FramePeakQueueDepth = 0;
+        }
+
+        static void Add( atomic<uint64_t>& Counter, uint64_t Value )
+        {
+            Counter.fetch_add(Value, memory_order_relaxed);
+        }
+
+        JobScheduler::WorkerStats Load( void ) const
+        {
+            JobScheduler::WorkerStats Result;
+            Result.JobsRun = JobsRun.load(memory_order_relaxed);
+            Result.JobsStolen = JobsStolen.load(memory_order_relaxed);
+            Result.FailedSteals = FailedSteals.load(memory_order_relaxed);
+            Result.Splits = Splits.load(memory_order_relaxed);
+            Result.Sleeps = Sleeps.load(memory_order_relaxed);
+            Result.BusyNanoseconds = BusyNanoseconds.load(memory_order_relaxed);
+            Result.PeakQueueDepth = PeakQueueDepth.load(memory_order_relaxed);
+            return Result;
+        }
+    };
+}
+
+// A fixed-size Chase-Lev deque, in the formulation of Le, Pop, Cohen, and Zappa Nardelli (2013).  Jobs are
+// copied in and out field by field through relaxed atomics; a thief's copy only counts once its CAS on
+// m_Top succeeds.
+struct JobScheduler::Worker
+{
+    struct Slot
+    {
+        atomic<JobEntry> Entry;
+        atomic<void*> Context;
+        atomic<uint32_t> Begin;
+        atomic<uint32_t> End;
+        atomic<uint32_t> Grain;
+        atomic<JobCounter*> Counter;
+
+        void Store( const Job& Value )
+        {
+            Entry.store(Value.Entry, memory_order_relaxed);
+            Context.store(Value.Context, memory_order_relaxed);
+            Begin.store(Value.Begin, memory_order_relaxed);
+            End.store(Value.End, memory_order_relaxed);
+            Grain.store(Value.Grain, memory_order_relaxed);
+            Counter.store(Value.Counter, memory_order_relaxed);
+        }
+
+        void Load( Job& Value ) const
+        {
+            Value.Entry = Entry.load(memory_order_relaxed);
+            Value.Context = Context.load(memory_order_relaxed);
+            Value.Begin = Begin.load(memory_order_relaxed);
+            Value.End = End.load(memory_order_relaxed);
+            Value.Grain = Grain.load(memory_order_relaxed);
+            Value.Counter = Counter.load(memory_order_relaxed);
+        }
+    };
+
+    atomic<int64_t> m_Top;
+    char m_Pad0[kCacheLineSize];
+    atomic<int64_t> m_Bottom;
+    char m_Pad1[kCacheLineSize];
+
+    Slot m_Slots[kQueueCapacity];
+
+    // Owner only
+    thread m_Thread;
+    uint32_t m_RandomState;
+
+    AtomicStats m_Stats;
+
+    Worker() : m_Top(0), m_Bottom(0), m_RandomState(1) {}
+
+    // Owner only.  Fails when the deque is full.
+    bool Push( const Job& Value, uint32_t& Depth )
+    {
+        int64_t b = m_Bottom.load(memory_order_relaxed);
+        int64_t t = m_Top.load(memory_order_acquire);
+        if (b - t >= (int64_t)kQueueCapacity)
+            return false;
+
+        m_Slots[b & (kQueueCapacity - 1)].Store(Value);
+        atomic_thread_fence(memory_order_release);
+        m_Bottom.store(b + 1, memory_order_relaxed);
+
+        Depth = (uint32_t)(b + 1 - t);
+        return true;
+    }
+
+    // Owner only.  Takes the most recently pushed job.
+    bool Pop( Job& Value )
+    {
+        int64_t b = m_Bottom.load(memory_order_relaxed) - 1;
+        m_Bottom.store(b, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        int64_t t = m_Top.load(memory_order_relaxed);
+
+        if (t > b)
+        {
+            m_Bottom.store(b + 1, memory_order_relaxed);
+            return false;
+        }
+
+        m_Slots[b & (kQueueCapacity - 1)].Load(Value);
+        if (t == b)
+        {
+            // The last job.  Race the thieves for it.
+            bool Won = m_Top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+            m_Bottom.store(b + 1, memory_order_relaxed);
+            return Won;
+        }
+        return true;
+    }
+
+    // Any thread.  Takes the oldest job.
+    bool Steal( Job& Value )
+    {
+        int64_t t = m_Top.load(memory_order_acquire);
+        atomic_thread_fence(memory_order_seq_cst);
+        int64_t b = m_Bottom.load(memory_order_acquire);
+
+        if (t >= b)
+            return false;
+
+        m_Slots[t & (kQueueCapacity - 1)].Load(Value);
+        return m_Top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+    }
+
+    bool IsEmpty( void ) const
+    {
+        return m_Top.load(memory_order_acquire) >= m_Bottom.load(memory_order_acquire);
+    }
+
+    uint32_t NextRandom( void )
+    {
+        // xorshift32
+        uint32_t x = m_RandomState;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        m_RandomState = x;
+        return x;
+    }
+};
+
+struct JobScheduler::SharedState
+{
+    // Jobs submitted from threads that own no deque
+    mutex QueueMutex;
+    deque<Job> Queue;
+    atomic<uint32_t> QueueSize;
+
+    // Incremented before a job becomes visible in any queue and decremented when it is taken.  Sleeping
+    // workers wait for it to become positive.
+    atomic<int32_t> QueuedJobs;
+    atomic<uint32_t> SleepingWorkers;
+    atomic<bool> Quit;
+    mutex SleepMutex;
+    condition_variable WakeUp;
+
+    // Jobs run by threads that own no deque
+    AtomicStats ExternalStats;
+
+    SharedState() : QueueSize(0), QueuedJobs(0), SleepingWorkers(0), Quit(false) {}
+};
+
+static_assert((JobScheduler::kQueueCapacity & (JobScheduler::kQueueCapacity - 1)) == 0,
+    "Queue capacity must be a power of two");
+
+JobScheduler::JobScheduler() : m_Workers(nullptr), m_NumThreads(0), m_Shared(nullptr)
+{
+}
+
+JobScheduler::~JobScheduler()
+{
+    Shutdown();
+}
+
+void JobScheduler::Initialize( uint32_t NumThreads )
+{
+    assert(m_Workers == nullptr);
+
+    if (NumThreads == 0)
+        NumThreads = max(1u, thread::hardware_concurrency());
+    NumThreads = min<uint32_t>(NumThreads, kMaxThreads);
+
+    m_Shared = new SharedState;
+    m_Workers = new Worker[NumThreads];
+    m_NumThreads = NumThreads;
+
+    for (uint32_t i = 0; i < NumThreads; ++i)
+        m_Workers[i].m_RandomState = 0x9E3779B9u * (i + 1);
+
+    s_ThreadBinding.Scheduler = this;
+    s_ThreadBinding.Index = 0;
+
+    for (uint32_t i = 1; i < NumThreads; ++i)
+        m_Workers[i].m_Thread = thread(&JobScheduler::WorkerMain, this, i);
+}
+
+void JobScheduler::Shutdown( void )
+{
+    if (m_Workers == nullptr)
+        return;
+
+    {
+        lock_guard<mutex> Lock(m_Shared->SleepMutex);
+        m_Shared->Quit.store(true);
+    }
+    m_Shared->WakeUp.notify_all();
+
+    for (uint32_t i = 1; i < m_NumThreads; ++i)
+        m_Workers[i].m_Thread.join();
+
+    // Everything submitted must have been waited on
+    assert(m_Shared->QueuedJobs.load() == 0);
+
+    if (s_ThreadBinding.Scheduler == this)
+    {
+        s_ThreadBinding.Scheduler = nullptr;
+        s_ThreadBinding.Index = kExternalThread;
+    }
+
+    delete[] m_Workers;
+    delete m_Shared;
+    m_Workers = nullptr;
+    m_Shared = nullptr;
+    m_NumThreads = 0;
+}
+
+uint32_t JobScheduler::GetThreadIndex( void ) const
+{
+    return s_ThreadBinding.Scheduler == this ? s_ThreadBinding.Index : kExternalThread;
+}
+
+void JobScheduler::Submit( JobCounter& Counter, JobEntry Entry, void* Context, uint32_t Begin, uint32_t End,
+    uint32_t Grain )
+{
+    if (Begin >= End)
+        return;
+
+    Job NewJob = { Entry, Context, Begin, End, max(Grain, 1u), &Counter };
+    Counter.m_Pending.fetch_add(1, memory_order_relaxed);
+
+    const uint32_t ThreadIndex = m_Workers != nullptr ? GetThreadIndex() : kExternalThread;
+
+    // Not running, or this thread's deque is full
+    if (m_Workers == nullptr || !Push(ThreadIndex, NewJob))
+        Execute(ThreadIndex, NewJob);
+}
+
+bool JobScheduler::Push( uint32_t ThreadIndex, const Job& NewJob )
+{
+    SharedState& Shared = *m_Shared;
+    Shared.QueuedJobs.fetch_add(1);
+
+    if (ThreadIndex == kExternalThread)
+    {
+        lock_guard<mutex> Lock(Shared.QueueMutex);
+        Shared.Queue.push_back(NewJob);
+        Shared.QueueSize.fetch_add(1);
+    }
+    else
+    {
+        Worker& Owner = m_Workers[ThreadIndex];
+        uint32_t Depth;
+        if (!Owner.Push(NewJob, Depth))
+        {
+            Shared.QueuedJobs.fetch_sub(1);
+            return false;
+        }
+
+        if (Depth > Owner.m_Stats.PeakQueueDepth.load(memory_order_relaxed))
+            Owner.m_Stats.PeakQueueDepth.store(Depth, memory_order_relaxed);
+        if (Depth > Owner.m_Stats.FramePeakQueueDepth.load(memory_order_relaxed))
+            Owner.m_Stats.FramePeakQueueDepth.store(Depth, memory_order_relaxed);
+    }
+
+    if (Shared.SleepingWorkers.load() > 0)
+    {
+        lock_guard<mutex> Lock(Shared.SleepMutex);
+        Shared.WakeUp.notify_one();
+    }
+    return true;
+}
+
+bool JobScheduler::TakeJob( uint32_t ThreadIndex, Job& Result )
+{
+    SharedState& Shared = *m_Shared;
+    AtomicStats& Stats = ThreadIndex == kExternalThread ? Shared.ExternalStats : m_Workers[ThreadIndex].m_Stats;
+
+    if (ThreadIndex != kExternalThread && m_Workers[ThreadIndex].Pop(Result))
+    {
+        Shared.QueuedJobs.fetch_sub(1);
+        return true;
+    }
+
+    // Only take the lock when there is something to take
+    if (Shared.QueueSize.load() > 0)
+    {
+        lock_guard<mutex> Lock(Shared.QueueMutex);
+        if (!Shared.Queue.empty())
+        {
+            Result = Shared.Queue.front();
+            Shared.Queue.pop_front();
+            Shared.QueueSize.fetch_sub(1);
+            Shared.QueuedJobs.fetch_sub(1);
+            return true;
+        }
+    }
+
+    if (m_NumThreads < 2 && ThreadIndex != kExternalThread)
+        return false;
+
+    // Visit every other deque once, starting from a random one
+    uint32_t Start;
+    if (ThreadIndex != kExternalThread)
+        Start = m_Workers[ThreadIndex].NextRandom();
+    else
+        Start = (uint32_t)GetNanoseconds();
+
+    for (uint32_t i = 0; i < m_NumThreads; ++i)
+    {
+        const uint32_t Victim = (Start + i) % m_NumThreads;
+        if (Victim == ThreadIndex || m_Workers[Victim].IsEmpty())
+            continue;
+
+        if (m_Workers[Victim].Steal(Result))
+        {
+            Shared.QueuedJobs.fetch_sub(1);
+            AtomicStats::Add(Stats.JobsStolen, 1);
+            return true;
+        }
+        AtomicStats::Add(Stats.FailedSteals, 1);
+    }
+
+    return false;
+}
+
+void JobScheduler::Execute( uint32_t ThreadIndex, Job& Current )
+{
+    JobCounter* Counter = Current.Counter;
+
+    if (m_Workers == nullptr)
+    {
+        Current.Entry(Current.Context, Current.Begin, Current.End);
+        Counter->m_Pending.fetch_sub(1, memory_order_release);
+        return;
+    }
+
+    AtomicStats& Stats = ThreadIndex == kExternalThread ? m_Shared->ExternalStats : m_Workers[ThreadIndex].m_Stats;
+
+    // Give away the upper half until what is left fits in one grain.  The owner pops the smallest halves
+    // back first, so it walks the range in order while thieves take the big pieces from the other end.
+    while (Current.End - Current.Begin > Current.Grain)
+    {
+        const uint64_t Half = (Current.End - Current.Begin) / 2;
+        const uint32_t Mid = Current.Begin + (uint32_t)((Half + Current.Grain - 1) / Current.Grain * Current.Grain);
+
+        Job Upper = Current;
+        Upper.Begin = Mid;
+
+        Counter->m_Pending.fetch_add(1, memory_order_relaxed);
+        if (!Push(ThreadIndex, Upper))
+        {
+            Counter->m_Pending.fetch_sub(1, memory_order_relaxed);
+            break;
+        }
+
+        Current.End = Mid;
+        AtomicStats::Add(Stats.Splits, 1);
+    }
+
+    const uint64_t StartTime = GetNanoseconds();
+    Current.Entry(Current.Context, Current.Begin, Current.End);
+    AtomicStats::Add(Stats.BusyNanoseconds, GetNanoseconds() - StartTime);
+    AtomicStats::Add(Stats.JobsRun, 1);
+
+    // The waiter may destroy the counter as soon as it reaches zero
+    Counter->m_Pending.fetch_sub(1, memory_order_release);
+}
+
+void JobScheduler::Wait( JobCounter& Counter )
+{
+    if (m_Workers == nullptr)
+    {
+        assert(Counter.IsDone());
+        return;
+    }
+
+    const uint32_t ThreadIndex = GetThreadIndex();
+
+    while (!Counter.IsDone())
+    {
+        Job Next;
+        if (TakeJob(ThreadIndex, Next))
+            Execute(ThreadIndex, Next);
+        else
+            this_thread::yield();
+    }
+}
+
+void JobScheduler::WorkerMain( uint32_t ThreadIndex )
+{
+    s_ThreadBinding.Scheduler = this;
+    s_ThreadBinding.Index = ThreadIndex;
+
+    SharedState& Shared = *m_Shared;
+    Worker& Self = m_Workers[ThreadIndex];
+    uint32_t IdlePasses = 0;
+
+    for (;;)
+    {
+        Job Next;
+        if (TakeJob(ThreadIndex, Next))
+        {
+            Execute(ThreadIndex, Next);
+            IdlePasses = 0;
+            continue;
+        }
+
+        if (Shared.Quit.load(memory_order_relaxed))
+            break;
+
+        if (++IdlePasses < kSpinCount)
+        {
+            this_thread::yield();
+            continue;
+        }
+
+        // Push increments QueuedJobs before checking SleepingWorkers, and this increments SleepingWorkers
+        // before checking QueuedJobs, so one of the two always sees the other
+        unique_lock<mutex> Lock(Shared.SleepMutex);
+        Shared.SleepingWorkers.fetch_add(1);
+        Shared.WakeUp.wait(Lock, [&Shared]() { return Shared.QueuedJobs.load() > 0 || Shared.Quit.load(); });
+        Shared.SleepingWorkers.fetch_sub(1);
+
+        AtomicStats::Add(Self.m_Stats.Sleeps, 1);
+        IdlePasses = 0;
+    }
+
+    s_ThreadBinding.Scheduler = nullptr;
+    s_ThreadBinding.Index = kExternalThread;
+}
+
+JobScheduler::WorkerStats JobScheduler::GetWorkerStats( uint32_t ThreadIndex ) const
+{
+    assert(ThreadIndex < m_NumThreads);
+    return m_Workers[ThreadIndex].m_Stats.Load();
+}
+
+JobScheduler::WorkerStats JobScheduler::GetTotalStats( void ) const
+{
+    WorkerStats Total = {};
+    if (m_Workers == nullptr)
+        return Total;
+
+    for (uint32_t i = 0; i <= m_NumThreads; ++i)
+    {
+        WorkerStats Stats = i < m_NumThreads ? m_Workers[i].m_Stats.Load() : m_Shared->ExternalStats.Load();
+        Total.JobsRun += Stats.JobsRun;
+        Total.JobsStolen += Stats.JobsStolen;
+        Total.FailedSteals += Stats.FailedSteals;
+        Total.Splits += Stats.Splits;
+        Total.Sleeps += Stats.Sleeps;
+        Total.BusyNanoseconds += Stats.BusyNanoseconds;
+        Total.PeakQueueDepth = max(Total.PeakQueueDepth, Stats.PeakQueueDepth);
+    }
+    return Total;
+}
+
+uint32_t JobScheduler::ResetFramePeakQueueDepth( void )
+{
+    if (m_Workers == nullptr)
+        return 0;
+
+    // Only the owning thread raises its peak, so a push racing the exchange is at worst counted next frame
+    uint32_t Peak = 0;
+    for (uint32_t i = 0; i < m_NumThreads; ++i)
+        Peak = max(Peak, m_Workers[i].m_Stats.FramePeakQueueDepth.exchange(0, memory_order_relaxed));
+    return Peak;
+}
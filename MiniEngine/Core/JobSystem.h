@@ -0,0 +1,162 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  A work-stealing job scheduler for engine-side CPU work.  Each thread of the scheduler
+// owns a deque of jobs.  It pushes and pops jobs at one end, and idle threads steal from the other end of
+// a random victim's deque.  Other threads submit through a shared, locked queue.
+//
+// A job is a function pointer, a context pointer, and an index range.  A range longer than the job's
+// grain is split in half each time it is about to run, and the upper half is pushed back as a new job, so
+// ParallelFor needs no up-front partitioning and thieves take the largest pieces.
+//
+// Completion is tracked with JobCounters.  Waiting on a counter runs other jobs until the counter reaches
+// zero, so a job may wait on the jobs it submitted; this is how dependencies are expressed.  Nothing is
+// allocated per job and only the standard library is used, so the scheduler builds on any platform.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+class JobCounter
+{
+public:
+    JobCounter() : m_Pending(0) {}
+
+    bool IsDone( void ) const { return m_Pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobScheduler;
+
+    JobCounter( const JobCounter& ) = delete;
+    JobCounter& operator=( const JobCounter& ) = delete;
+
+    std::atomic<uint32_t> m_Pending;
+};
+
+class JobScheduler
+{
+public:
+
+    // Runs the job for Begin <= i < End
+    typedef void (*JobEntry)( void* Context, uint32_t Begin, uint32_t End );
+
+    // Cumulative since Initialize
+    struct WorkerStats
+    {
+        uint64_t JobsRun;
+        uint64_t JobsStolen;
+        uint64_t FailedSteals;     // Victims whose deques were empty or lost to another thief
+        uint64_t Splits;
+        uint64_t Sleeps;
+        uint64_t BusyNanoseconds;  // Inside job entry points, including jobs run while a job waits
+        uint32_t PeakQueueDepth;
+    };
+
+    enum { kMaxThreads = 64, kQueueCapacity = 4096 };
+
+    JobScheduler();
+    ~JobScheduler();
+
+    // The calling thread becomes thread 0 and runs jobs only while it waits.  NumThreads - 1 worker
+    // threads are started; 0 means one thread per hardware thread.  Before Initialize and after Shutdown,
+    // jobs run immediately on the submitting thread.
+    void Initialize( uint32_t NumThreads = 0 );
+    void Shutdown( void );
+
+    uint32_t GetThreadCount( void ) const { return m_NumThreads; }
+
+    // Counter is incremented now and decremented when the whole range has run
+    void Submit( JobCounter& Counter, JobEntry Entry, void* Context, uint32_t Begin = 0, uint32_t End = 1,
+        uint32_t Grain = 1 );
+
+    // Runs jobs from any queue until Counter reaches zero
+    void Wait( JobCounter& Counter );
+
+    // Function() must stay alive until Counter is waited on
+    template <typename TFunction>
+    void Submit( JobCounter& Counter, TFunction& Function )
+    {
+        Submit(Counter, &InvokeFunction<TFunction>, &Function);
+    }
+
+    // Calls Body(i) for Begin <= i < End and returns when all calls are done.  Runs of Grain consecutive
+    // indices are never split across threads.
+    template <typename TBody>
+    void ParallelFor( uint32_t Begin, uint32_t End, uint32_t Grain, const TBody& Body )
+    {
+        if (Begin >= End)
+            return;
+
+        JobCounter Counter;
+        Submit(Counter, &InvokeRange<TBody>, (void*)&Body, Begin, End, Grain);
+        Wait(Counter);
+    }
+
+    template <typename TBody>
+    void ParallelFor( uint32_t Begin, uint32_t End, const TBody& Body )
+    {
+        ParallelFor(Begin, End, 1, Body);
+    }
+
+    WorkerStats GetWorkerStats( uint32_t ThreadIndex ) const;
+
+    // Sum over all threads, with the largest PeakQueueDepth
+    WorkerStats GetTotalStats( void ) const;
+
+    // The largest queue depth reached on any thread since the previous call, for per-frame reporting.
+    // WorkerStats::PeakQueueDepth is not affected.
+    uint32_t ResetFramePeakQueueDepth( void );
+
+private:
+
+    struct Job
+    {
+        JobEntry Entry;
+        void* Context;
+        uint32_t Begin;
+        uint32_t End;
+        uint32_t Grain;
+        JobCounter* Counter;
+    };
+
+    struct Worker;
+
+    template <typename TFunction>
+    static void InvokeFunction( void* Context, uint32_t, uint32_t )
+    {
+        (*(TFunction*)Context)();
+    }
+
+    template <typename TBody>
+    static void InvokeRange( void* Context, uint32_t Begin, uint32_t End )
+    {
+        const TBody& Body = *(const TBody*)Context;
+        for (uint32_t i = Begin; i < End; ++i)
+            Body(i);
+    }
+
+    JobScheduler( const JobScheduler& ) = delete;
+    JobScheduler& operator=( const JobScheduler& ) = delete;
+
+    uint32_t GetThreadIndex( void ) const;
+    bool Push( uint32_t ThreadIndex, const Job& NewJob );
+    bool TakeJob( uint32_t ThreadIndex, Job& Result );
+    void Execute( uint32_t ThreadIndex, Job& Current );
+    void WorkerMain( uint32_t ThreadIndex );
+
+    Worker* m_Workers;
+    uint32_t m_NumThreads;
+
+    struct SharedState;
+    SharedState* m_Shared;
+};
+
+// Started by GameCore for the application's lifetime
+extern JobScheduler g_JobScheduler;
@@ -49,7 +49,8 @@ namespace Math
 
     inline Vector3 BoundingSphere::GetCenter( void ) const
     {
-        return Vector3(m_repr);
+        // Not Vector3(Vector4), which would divide the center by the radius in W
+        return Vector3(XMVECTOR(m_repr));
     }
 
     inline Scalar BoundingSphere::GetRadius( void ) const
@@ -0,0 +1,171 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Registers of floats for the wide math in VectorWide.h.  FloatX4 uses SSE.  When the
+// compiler targets AVX (/arch:AVX or higher defines __AVX__), FloatX8 is available too, and FloatXN names
+// the widest type.  Define MATH_WIDE_NO_AVX to stay on four lanes.  Comparisons return lane masks (all bits
+// set where true) in the same float type, like XMVectorLess.
+//
+// Only the intrinsics headers are included, not DirectXMath, so code that works on plain float arrays can
+// use these without Windows.
+//
+
+#pragma once
+
+#include <immintrin.h>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef INLINE
+#ifdef _MSC_VER
+#define INLINE __forceinline    // As in Common.h
+#else
+#define INLINE inline __attribute__((always_inline))
+#endif
+#endif
+
+#if defined(__AVX__) && !defined(MATH_WIDE_NO_AVX)
+#define MATH_WIDE_AVX 1
+#endif
+
+namespace Math
+{
+    class FloatX4
+    {
+    public:
+        enum { kLanes = 4 };
+
+        INLINE FloatX4() {}
+        INLINE FloatX4( __m128 v ) : m_v(v) {}
+        INLINE explicit FloatX4( float s ) : m_v(_mm_set1_ps(s)) {}
+
+        INLINE operator __m128() const { return m_v; }
+
+        static INLINE FloatX4 Load( const float* p ) { return _mm_loadu_ps(p); }
+        INLINE void Store( float* p ) const { _mm_storeu_ps(p, m_v); }
+
+        // Four floats spaced Stride bytes apart
+        static INLINE FloatX4 Gather( const float* p, size_t Stride )
+        {
+            const char* b = (const char*)p;
+            return _mm_setr_ps(*(const float*)b, *(const float*)(b + Stride), *(const float*)(b + 2 * Stride),
+                *(const float*)(b + 3 * Stride));
+        }
+
+        INLINE FloatX4 operator- () const { return _mm_xor_ps(m_v, _mm_set1_ps(-0.0f)); }
+        INLINE FloatX4 operator+ ( FloatX4 b ) const { return _mm_add_ps(m_v, b); }
+        INLINE FloatX4 operator- ( FloatX4 b ) const { return _mm_sub_ps(m_v, b); }
+        INLINE FloatX4 operator* ( FloatX4 b ) const { return _mm_mul_ps(m_v, b); }
+        INLINE FloatX4 operator/ ( FloatX4 b ) const { return _mm_div_ps(m_v, b); }
+        INLINE FloatX4& operator+= ( FloatX4 b ) { m_v = _mm_add_ps(m_v, b); return *this; }
+        INLINE FloatX4& operator*= ( FloatX4 b ) { m_v = _mm_mul_ps(m_v, b); return *this; }
+
+        INLINE FloatX4 operator< ( FloatX4 b ) const { return _mm_cmplt_ps(m_v, b); }
+        INLINE FloatX4 operator<= ( FloatX4 b ) const { return _mm_cmple_ps(m_v, b); }
+        INLINE FloatX4 operator> ( FloatX4 b ) const { return _mm_cmpgt_ps(m_v, b); }
+        INLINE FloatX4 operator>= ( FloatX4 b ) const { return _mm_cmpge_ps(m_v, b); }
+        INLINE FloatX4 operator& ( FloatX4 b ) const { return _mm_and_ps(m_v, b); }
+        INLINE FloatX4 operator| ( FloatX4 b ) const { return _mm_or_ps(m_v, b); }
+
+        // One bit per lane, lane 0 in bit 0
+        INLINE uint32_t GetMask( void ) const { return (uint32_t)_mm_movemask_ps(m_v); }
+
+        INLINE float ReduceMin( void ) const
+        {
+            __m128 v = _mm_min_ps(m_v, _mm_shuffle_ps(m_v, m_v, _MM_SHUFFLE(1, 0, 3, 2)));
+            v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_cvtss_f32(v);
+        }
+
+        INLINE float ReduceMax( void ) const
+        {
+            __m128 v = _mm_max_ps(m_v, _mm_shuffle_ps(m_v, m_v, _MM_SHUFFLE(1, 0, 3, 2)));
+            v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_cvtss_f32(v);
+        }
+
+        INLINE friend FloatX4 Min( FloatX4 a, FloatX4 b ) { return _mm_min_ps(a, b); }
+        INLINE friend FloatX4 Max( FloatX4 a, FloatX4 b ) { return _mm_max_ps(a, b); }
+        INLINE friend FloatX4 Abs( FloatX4 a ) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+        // Lanes of b where Mask is set, otherwise lanes of a
+        INLINE friend FloatX4 Select( FloatX4 a, FloatX4 b, FloatX4 Mask ) { return _mm_or_ps(_mm_andnot_ps(Mask, a), _mm_and_ps(Mask, b)); }
+
+    private:
+        __m128 m_v;
+    };
+
+#ifdef MATH_WIDE_AVX
+
+    class FloatX8
+    {
+    public:
+        enum { kLanes = 8 };
+
+        INLINE FloatX8() {}
+        INLINE FloatX8( __m256 v ) : m_v(v) {}
+        INLINE explicit FloatX8( float s ) : m_v(_mm256_set1_ps(s)) {}
+
+        INLINE operator __m256() const { return m_v; }
+
+        static INLINE FloatX8 Load( const float* p ) { return _mm256_loadu_ps(p); }
+        INLINE void Store( float* p ) const { _mm256_storeu_ps(p, m_v); }
+
+        static INLINE FloatX8 Gather( const float* p, size_t Stride )
+        {
+            const char* b = (const char*)p;
+            return _mm256_setr_ps(*(const float*)b, *(const float*)(b + Stride), *(const float*)(b + 2 * Stride),
+                *(const float*)(b + 3 * Stride), *(const float*)(b + 4 * Stride), *(const float*)(b + 5 * Stride),
+                *(const float*)(b + 6 * Stride), *(const float*)(b + 7 * Stride));
+        }
+
+        INLINE FloatX8 operator- () const { return _mm256_xor_ps(m_v, _mm256_set1_ps(-0.0f)); }
+        INLINE FloatX8 operator+ ( FloatX8 b ) const { return _mm256_add_ps(m_v, b); }
+        INLINE FloatX8 operator- ( FloatX8 b ) const { return _mm256_sub_ps(m_v, b); }
+        INLINE FloatX8 operator* ( FloatX8 b ) const { return _mm256_mul_ps(m_v, b); }
+        INLINE FloatX8 operator/ ( FloatX8 b ) const { return _mm256_div_ps(m_v, b); }
+        INLINE FloatX8& operator+= ( FloatX8 b ) { m_v = _mm256_add_ps(m_v, b); return *this; }
+        INLINE FloatX8& operator*= ( FloatX8 b ) { m_v = _mm256_mul_ps(m_v, b); return *this; }
+
+        INLINE FloatX8 operator< ( FloatX8 b ) const { return _mm256_cmp_ps(m_v, b, _CMP_LT_OQ); }
+        INLINE FloatX8 operator<= ( FloatX8 b ) const { return _mm256_cmp_ps(m_v, b, _CMP_LE_OQ); }
+        INLINE FloatX8 operator> ( FloatX8 b ) const { return _mm256_cmp_ps(m_v, b, _CMP_GT_OQ); }
+        INLINE FloatX8 operator>= ( FloatX8 b ) const { return _mm256_cmp_ps(m_v, b, _CMP_GE_OQ); }
+        INLINE FloatX8 operator& ( FloatX8 b ) const { return _mm256_and_ps(m_v, b); }
+        INLINE FloatX8 operator| ( FloatX8 b ) const { return _mm256_or_ps(m_v, b); }
+
+        INLINE uint32_t GetMask( void ) const { return (uint32_t)_mm256_movemask_ps(m_v); }
+
+        INLINE float ReduceMin( void ) const
+        {
+            return FloatX4(_mm_min_ps(_mm256_castps256_ps128(m_v), _mm256_extractf128_ps(m_v, 1))).ReduceMin();
+        }
+
+        INLINE float ReduceMax( void ) const
+        {
+            return FloatX4(_mm_max_ps(_mm256_castps256_ps128(m_v), _mm256_extractf128_ps(m_v, 1))).ReduceMax();
+        }
+
+        INLINE friend FloatX8 Min( FloatX8 a, FloatX8 b ) { return _mm256_min_ps(a, b); }
+        INLINE friend FloatX8 Max( FloatX8 a, FloatX8 b ) { return _mm256_max_ps(a, b); }
+        INLINE friend FloatX8 Abs( FloatX8 a ) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+        INLINE friend FloatX8 Select( FloatX8 a, FloatX8 b, FloatX8 Mask ) { return _mm256_blendv_ps(a, b, Mask); }
+
+    private:
+        __m256 m_v;
+    };
+
+    typedef FloatX8 FloatXN;
+
+#else
+
+    typedef FloatX4 FloatXN;
+
+#endif
+
+} // namespace Math
@@ -11,10 +11,167 @@
 // Author:  James Stanard 
 //
 
-#include "pch.h"
+// Built without the precompiled header so it has no dependency on Windows
 #include "Random.h"
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+
+using namespace Math;
+
+namespace
+{
+    const uint32_t kPhiloxM0 = 0xD2511F53;
+    const uint32_t kPhiloxM1 = 0xCD9E8D57;
+    const uint32_t kPhiloxW0 = 0x9E3779B9;
+    const uint32_t kPhiloxW1 = 0xBB67AE85;
+    const uint32_t kPhiloxRounds = 10;
+
+    inline void Philox4x32( uint64_t Counter, uint64_t Stream, const uint32_t Key[2], uint32_t Out[4] )
+    {
+        uint32_t C0 = (uint32_t)Counter, C1 = (uint32_t)(Counter >> 32);
+        uint32_t C2 = (uint32_t)Stream, C3 = (uint32_t)(Stream >> 32);
+        uint32_t K0 = Key[0], K1 = Key[1];
+
+        for (uint32_t Round = 0; Round < kPhiloxRounds; ++Round)
+        {
+            uint64_t P0 = (uint64_t)kPhiloxM0 * C0;
+            uint64_t P1 = (uint64_t)kPhiloxM1 * C2;
+            C0 = (uint32_t)(P1 >> 32) ^ C1 ^ K0;
+            C1 = (uint32_t)P1;
+            C2 = (uint32_t)(P0 >> 32) ^ C3 ^ K1;
+            C3 = (uint32_t)P0;
+            K0 += kPhiloxW0;
+            K1 += kPhiloxW1;
+        }
+
+        Out[0] = C0;
+        Out[1] = C1;
+        Out[2] = C2;
+        Out[3] = C3;
+    }
+
+    // Full 32x32 -> 64-bit products of all four lanes, split into low and high halves
+    inline void MulHiLo( __m128i A, __m128i M, __m128i& Lo, __m128i& Hi )
+    {
+        const __m128i kLowMask = _mm_set1_epi64x(0xFFFFFFFF);
+        __m128i Even = _mm_mul_epu32(A, M);
+        __m128i Odd = _mm_mul_epu32(_mm_srli_epi64(A, 32), M);
+        Lo = _mm_or_si128(_mm_and_si128(Even, kLowMask), _mm_slli_epi64(Odd, 32));
+        Hi = _mm_or_si128(_mm_srli_epi64(Even, 32), _mm_andnot_si128(kLowMask, Odd));
+    }
+
+    // Four consecutive counters at once, one per SIMD lane, written out in sequence order
+    void Philox4x32x4( uint64_t Counter, uint64_t Stream, const uint32_t Key[2], uint32_t* Out )
+    {
+        __m128i C0 = _mm_setr_epi32((int)(uint32_t)Counter, (int)(uint32_t)(Counter + 1),
+            (int)(uint32_t)(Counter + 2), (int)(uint32_t)(Counter + 3));
+        __m128i C1 = _mm_setr_epi32((int)(uint32_t)(Counter >> 32), (int)(uint32_t)((Counter + 1) >> 32),
+            (int)(uint32_t)((Counter + 2) >> 32), (int)(uint32_t)((Counter + 3) >> 32));
+        __m128i C2 = _mm_set1_epi32((int)(uint32_t)Stream);
+        __m128i C3 = _mm_set1_epi32((int)(uint32_t)(Stream >> 32));
+        __m128i K0 = _mm_set1_epi32((int)Key[0]);
+        __m128i K1 = _mm_set1_epi32((int)Key[1]);
+
+        const __m128i M0 = _mm_set1_epi32((int)kPhiloxM0);
+        const __m128i M1 = _mm_set1_epi32((int)kPhiloxM1);
+        const __m128i W0 = _mm_set1_epi32((int)kPhiloxW0);
+        const __m128i W1 = _mm_set1_epi32((int)kPhiloxW1);
+
+        for (uint32_t Round = 0; Round < kPhiloxRounds; ++Round)
+        {
+            __m128i Lo0, Hi0, Lo1, Hi1;
+            MulHiLo(C0, M0, Lo0, Hi0);
+            MulHiLo(C2, M1, Lo1, Hi1);
+            C0 = _mm_xor_si128(_mm_xor_si128(Hi1, C1), K0);
+            C1 = Lo1;
+            C2 = _mm_xor_si128(_mm_xor_si128(Hi0, C3), K1);
+            C3 = Lo0;
+            K0 = _mm_add_epi32(K0, W0);
+            K1 = _mm_add_epi32(K1, W1);
+        }
+
+        // Transpose from one word per register to one counter per register
+        __m128 R0 = _mm_castsi128_ps(C0), R1 = _mm_castsi128_ps(C1);
+        __m128 R2 = _mm_castsi128_ps(C2), R3 = _mm_castsi128_ps(C3);
+        _MM_TRANSPOSE4_PS(R0, R1, R2, R3);
+        _mm_storeu_si128((__m128i*)Out + 0, _mm_castps_si128(R0));
+        _mm_storeu_si128((__m128i*)Out + 1, _mm_castps_si128(R1));
+        _mm_storeu_si128((__m128i*)Out + 2, _mm_castps_si128(R2));
+        _mm_storeu_si128((__m128i*)Out + 3, _mm_castps_si128(R3));
+    }
+}
 
 namespace Math
 {
     RandomNumberGenerator g_RNG;
 }
+
+void RandomNumberGenerator::Refill( void )
+{
+    Philox4x32(m_Counter++, m_Stream, m_Key, m_Buffer);
+    m_BufferPos = 0;
+}
+
+float RandomNumberGenerator::NextGaussian( void )
+{
+    if (m_HasSpareGaussian)
+    {
+        m_HasSpareGaussian = false;
+        return m_SpareGaussian;
+    }
+
+    float X, Y, S;
+    do
+    {
+        X = NextFloat(-1.0f, 1.0f);
+        Y = NextFloat(-1.0f, 1.0f);
+        S = X * X + Y * Y;
+    } while (S >= 1.0f || S == 0.0f);
+
+    S = sqrtf(-2.0f * logf(S) / S);
+    m_SpareGaussian = Y * S;
+    m_HasSpareGaussian = true;
+    return X * S;
+}
+
+void RandomNumberGenerator::Fill( uint32_t* Dest, size_t Count )
+{
+    // Drain what is left of the current block so the sequence lines up with NextUint()
+    while (Count > 0 && m_BufferPos < 4)
+    {
+        *Dest++ = m_Buffer[m_BufferPos++];
+        --Count;
+    }
+
+    for (; Count >= 16; Count -= 16, Dest += 16, m_Counter += 4)
+        Philox4x32x4(m_Counter, m_Stream, m_Key, Dest);
+
+    while (Count-- > 0)
+        *Dest++ = NextUint();
+}
+
+void RandomNumberGenerator::Fill( float* Dest, size_t Count, float MinVal, float MaxVal )
+{
+    // Generate the raw bits in place, then convert them with the same arithmetic as NextFloat()
+    Fill((uint32_t*)Dest, Count);
+
+    const __m128 Scale = _mm_set1_ps(1.0f / 16777216.0f);
+    const __m128 Range = _mm_set1_ps(MaxVal - MinVal);
+    const __m128 Bias = _mm_set1_ps(MinVal);
+
+    size_t i = 0;
+    for (; i + 4 <= Count; i += 4)
+    {
+        __m128i Bits = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(Dest + i)), 8);
+        __m128 Unit = _mm_mul_ps(_mm_cvtepi32_ps(Bits), Scale);
+        _mm_storeu_ps(Dest + i, _mm_add_ps(Bias, _mm_mul_ps(Unit, Range)));
+    }
+
+    for (; i < Count; ++i)
+    {
+        uint32_t Bits;
+        memcpy(&Bits, Dest + i, sizeof(Bits));
+        Dest[i] = MinVal + ToUnitFloat(Bits) * (MaxVal - MinVal);
+    }
+}
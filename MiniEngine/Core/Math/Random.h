@@ -13,54 +13,109 @@
 
 #pragma once
 
-#include "Common.h"
-#include <random>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
 
 namespace Math
 {
+    // Counter-based generator (Philox4x32-10).  Every 128-bit counter, made of a 64-bit position and a
+    // 64-bit stream ID, is mapped through a keyed bijection to four 32-bit outputs.  A given seed and
+    // stream therefore produce the same sequence on every platform, distinct streams never overlap, and
+    // bulk fills can generate several counters at once with SIMD.
     class RandomNumberGenerator
     {
     public:
-        RandomNumberGenerator() : m_gen(m_rd())
+        RandomNumberGenerator( uint64_t Seed = 0, uint64_t Stream = 0 )
         {
+            SetSeed(Seed, Stream);
+        }
+
+        // Restarts the sequence from the beginning of the given stream
+        void SetSeed( uint64_t Seed, uint64_t Stream = 0 )
+        {
+            m_Key[0] = (uint32_t)Seed;
+            m_Key[1] = (uint32_t)(Seed >> 32);
+            m_Stream = Stream;
+            m_Counter = 0;
+            m_BufferPos = 4;
+            m_HasSpareGaussian = false;
+        }
+
+        // Jumps directly to the Nth value of the current stream
+        void Seek( uint64_t Position )
+        {
+            m_Counter = Position / 4;
+            m_BufferPos = 4;
+            m_HasSpareGaussian = false;
+            if (Position % 4 != 0)
+            {
+                Refill();
+                m_BufferPos = (uint32_t)(Position % 4);
+            }
+        }
+
+        uint32_t NextUint( void )
+        {
+            if (m_BufferPos == 4)
+                Refill();
+            return m_Buffer[m_BufferPos++];
         }
 
         // Default int range is [MIN_INT, MAX_INT].  Max value is included.
         int32_t NextInt( void )
         {
-            return std::uniform_int_distribution<int32_t>(0x80000000, 0x7FFFFFFF)(m_gen);
+            return (int32_t)NextUint();
         }
 
         int32_t NextInt( int32_t MaxVal )
         {
-            return std::uniform_int_distribution<int32_t>(0, MaxVal)(m_gen);
+            return NextInt(0, MaxVal);
         }
 
         int32_t NextInt( int32_t MinVal, int32_t MaxVal )
         {
-            return std::uniform_int_distribution<int32_t>(MinVal, MaxVal)(m_gen);
+            assert(MinVal <= MaxVal && "Empty range");
+            // Scale 32 random bits onto the range with a multiply instead of a modulo
+            uint64_t Range = (uint64_t)((int64_t)MaxVal - MinVal + 1);
+            return (int32_t)(MinVal + (int64_t)((NextUint() * Range) >> 32));
         }
 
         // Default float range is [0.0f, 1.0f).  Max value is excluded.
         float NextFloat( float MaxVal = 1.0f )
         {
-            return std::uniform_real_distribution<float>(0.0f, MaxVal)(m_gen);
+            return NextFloat(0.0f, MaxVal);
         }
 
         float NextFloat( float MinVal, float MaxVal )
         {
-            return std::uniform_real_distribution<float>(MinVal, MaxVal)(m_gen);
+            return MinVal + ToUnitFloat(NextUint()) * (MaxVal - MinVal);
         }
 
-        void SetSeed( UINT s )
+        // Standard normal distribution (polar Box-Muller).  Values are generated in pairs.
+        float NextGaussian( void );
+
+        // Bulk generation.  The output is identical to calling NextUint() or NextFloat() Count times.
+        void Fill( uint32_t* Dest, size_t Count );
+        void Fill( float* Dest, size_t Count, float MinVal = 0.0f, float MaxVal = 1.0f );
+
+        // Uses the top 24 bits so every result is exactly representable
+        static float ToUnitFloat( uint32_t Bits )
         {
-            m_gen.seed(s);
+            return (float)(Bits >> 8) * (1.0f / 16777216.0f);
         }
 
     private:
 
-        std::random_device m_rd;
-        std::minstd_rand m_gen;
+        void Refill( void );
+
+        uint32_t m_Key[2];
+        uint64_t m_Stream;
+        uint64_t m_Counter;     // Index of the next block of four outputs
+        uint32_t m_Buffer[4];
+        uint32_t m_BufferPos;
+        bool m_HasSpareGaussian;
+        float m_SpareGaussian;
     };
 
     extern RandomNumberGenerator g_RNG;
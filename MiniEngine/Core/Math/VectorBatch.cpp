@@ -0,0 +1,165 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "VectorBatch.h"
+#include "Frustum.h"
+#include <cfloat>
+
+using namespace Math;
+
+void Vector3Stream::Resize( uint32_t Count )
+{
+    const uint32_t Padded = (Count + kAlignment - 1) / kAlignment * kAlignment;
+
+    // Clear the old padding, which becomes real elements when growing
+    for (uint32_t i = m_Count; i < (uint32_t)m_X.size(); ++i)
+        m_X[i] = m_Y[i] = m_Z[i] = 0.0f;
+
+    m_X.resize(Padded, 0.0f);
+    m_Y.resize(Padded, 0.0f);
+    m_Z.resize(Padded, 0.0f);
+    m_Count = Count;
+}
+
+void Math::TransformPoints( const Matrix4& Xform, const Vector3Stream& In, Vector3Stream& Out )
+{
+    if (&Out != &In)
+        Out.Resize(In.Size());
+
+    const Matrix4Wide<FloatXN> M(Xform);
+    for (uint32_t i = 0; i < In.PaddedSize(); i += FloatXN::kLanes)
+        Out.StoreWide(i, M.TransformPoint(In.LoadWide(i)));
+}
+
+void Math::TransformBounds( const Matrix4& Xform, const Vector3Stream& MinIn, const Vector3Stream& MaxIn,
+    Vector3Stream& MinOut, Vector3Stream& MaxOut )
+{
+    ASSERT(MinIn.Size() == MaxIn.Size());
+
+    if (&MinOut != &MinIn)
+        MinOut.Resize(MinIn.Size());
+    if (&MaxOut != &MaxIn)
+        MaxOut.Resize(MaxIn.Size());
+
+    const Matrix4Wide<FloatXN> M(Xform);
+    for (uint32_t i = 0; i < MinIn.PaddedSize(); i += FloatXN::kLanes)
+    {
+        Vector3xN BoxMin, BoxMax;
+        M.TransformBounds(MinIn.LoadWide(i), MaxIn.LoadWide(i), BoxMin, BoxMax);
+        MinOut.StoreWide(i, BoxMin);
+        MaxOut.StoreWide(i, BoxMax);
+    }
+}
+
+uint32_t Math::IntersectBoundingBoxes( const Frustum& ViewFrustum, const Vector3Stream& MinBound,
+    const Vector3Stream& MaxBound, uint8_t* Visible )
+{
+    ASSERT(MinBound.Size() == MaxBound.Size());
+
+    const PlaneWide<FloatXN> Planes[6] =
+    {
+        PlaneWide<FloatXN>(ViewFrustum.GetFrustumPlane(Frustum::kNearPlane)),
+        PlaneWide<FloatXN>(ViewFrustum.GetFrustumPlane(Frustum::kFarPlane)),
+        PlaneWide<FloatXN>(ViewFrustum.GetFrustumPlane(Frustum::kLeftPlane)),
+        PlaneWide<FloatXN>(ViewFrustum.GetFrustumPlane(Frustum::kRightPlane)),
+        PlaneWide<FloatXN>(ViewFrustum.GetFrustumPlane(Frustum::kTopPlane)),
+        PlaneWide<FloatXN>(ViewFrustum.GetFrustumPlane(Frustum::kBottomPlane)),
+    };
+
+    const uint32_t Count = MinBound.Size();
+    uint32_t NumVisible = 0;
+
+    for (uint32_t i = 0; i < Count; i += FloatXN::kLanes)
+    {
+        const Vector3xN BoxMin = MinBound.LoadWide(i);
+        const Vector3xN BoxMax = MaxBound.LoadWide(i);
+
+        FloatXN Outside = Planes[0].BoxOutside(BoxMin, BoxMax);
+        for (int p = 1; p < 6; ++p)
+            Outside = Outside | Planes[p].BoxOutside(BoxMin, BoxMax);
+
+        const uint32_t OutsideMask = Outside.GetMask();
+        const uint32_t Last = i + FloatXN::kLanes < Count ? i + FloatXN::kLanes : Count;
+        for (uint32_t j = i; j < Last; ++j)
+        {
+            Visible[j] = ((OutsideMask >> (j - i)) & 1) ^ 1;
+            NumVisible += Visible[j];
+        }
+    }
+
+    return NumVisible;
+}
+
+void Math::ComputeBounds( const Vector3Stream& Points, Vector3& MinBound, Vector3& MaxBound )
+{
+    const uint32_t Count = Points.Size();
+    if (Count == 0)
+    {
+        MinBound = MaxBound = Vector3(kZero);
+        return;
+    }
+
+    // Padding is zero, which would pull the bounds toward the origin, so the last block repeats the last
+    // point instead
+    const uint32_t FullBlocks = Count / FloatXN::kLanes * FloatXN::kLanes;
+
+    Vector3xN BlockMin(FloatXN(FLT_MAX), FloatXN(FLT_MAX), FloatXN(FLT_MAX));
+    Vector3xN BlockMax = -BlockMin;
+
+    for (uint32_t i = 0; i < FullBlocks; i += FloatXN::kLanes)
+    {
+        Vector3xN p = Points.LoadWide(i);
+        BlockMin = Min(BlockMin, p);
+        BlockMax = Max(BlockMax, p);
+    }
+
+    MinBound = BlockMin.ReduceMin();
+    MaxBound = BlockMax.ReduceMax();
+
+    for (uint32_t i = FullBlocks; i < Count; ++i)
+    {
+        MinBound = Min(MinBound, Points.Get(i));
+        MaxBound = Max(MaxBound, Points.Get(i));
+    }
+}
+
+void Math::ComputeBounds( const float* Positions, size_t Stride, uint32_t Count, Vector3& MinBound, Vector3& MaxBound )
+{
+    if (Count == 0)
+    {
+        MinBound = MaxBound = Vector3(kZero);
+        return;
+    }
+
+    const uint32_t FullBlocks = Count / FloatXN::kLanes * FloatXN::kLanes;
+    const size_t BlockStride = Stride * FloatXN::kLanes;
+
+    Vector3xN BlockMin(FloatXN(FLT_MAX), FloatXN(FLT_MAX), FloatXN(FLT_MAX));
+    Vector3xN BlockMax = -BlockMin;
+
+    const char* p = (const char*)Positions;
+    for (uint32_t i = 0; i < FullBlocks; i += FloatXN::kLanes, p += BlockStride)
+    {
+        Vector3xN v = Vector3xN::Gather((const float*)p, Stride);
+        BlockMin = Min(BlockMin, v);
+        BlockMax = Max(BlockMax, v);
+    }
+
+    MinBound = BlockMin.ReduceMin();
+    MaxBound = BlockMax.ReduceMax();
+
+    for (uint32_t i = FullBlocks; i < Count; ++i, p += Stride)
+    {
+        const float* v = (const float*)p;
+        Vector3 Position(v[0], v[1], v[2]);
+        MinBound = Min(MinBound, Position);
+        MaxBound = Max(MaxBound, Position);
+    }
+}
@@ -0,0 +1,84 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Bulk operations on arrays of points and boxes, written with the wide types in
+// VectorWide.h.  Vector3Stream stores its vectors structure-of-arrays and pads the count to a whole
+// number of FloatXN, so the loops never need a scalar tail.
+//
+
+#pragma once
+
+#include "VectorWide.h"
+#include <vector>
+
+namespace Math
+{
+    class Frustum;
+
+    class Vector3Stream
+    {
+    public:
+        enum { kAlignment = FloatXN::kLanes };
+
+        Vector3Stream() : m_Count(0) {}
+        explicit Vector3Stream( uint32_t Count ) : m_Count(0) { Resize(Count); }
+
+        // New and padding elements are zero
+        void Resize( uint32_t Count );
+
+        uint32_t Size( void ) const { return m_Count; }
+
+        // Size rounded up to a multiple of kAlignment
+        uint32_t PaddedSize( void ) const { return (uint32_t)m_X.size(); }
+
+        float* X( void ) { return m_X.data(); }
+        float* Y( void ) { return m_Y.data(); }
+        float* Z( void ) { return m_Z.data(); }
+        const float* X( void ) const { return m_X.data(); }
+        const float* Y( void ) const { return m_Y.data(); }
+        const float* Z( void ) const { return m_Z.data(); }
+
+        void Set( uint32_t Index, Vector3 v )
+        {
+            m_X[Index] = v.GetX();
+            m_Y[Index] = v.GetY();
+            m_Z[Index] = v.GetZ();
+        }
+
+        Vector3 Get( uint32_t Index ) const { return Vector3(m_X[Index], m_Y[Index], m_Z[Index]); }
+
+        // Index must be a multiple of kAlignment
+        Vector3xN LoadWide( uint32_t Index ) const { return Vector3xN::Load(&m_X[Index], &m_Y[Index], &m_Z[Index]); }
+        void StoreWide( uint32_t Index, const Vector3xN& v ) { v.Store(&m_X[Index], &m_Y[Index], &m_Z[Index]); }
+
+    private:
+        std::vector<float> m_X;
+        std::vector<float> m_Y;
+        std::vector<float> m_Z;
+        uint32_t m_Count;
+    };
+
+    // Out may be In.  Out is resized to match.
+    void TransformPoints( const Matrix4& Xform, const Vector3Stream& In, Vector3Stream& Out );
+
+    // Refits each box around its transformed corners.  Xform must be affine.
+    void TransformBounds( const Matrix4& Xform, const Vector3Stream& MinIn, const Vector3Stream& MaxIn,
+        Vector3Stream& MinOut, Vector3Stream& MaxOut );
+
+    // Writes 1 for each box that intersects the frustum, 0 otherwise, with the same test as
+    // Frustum::IntersectBoundingBox.  Returns the number of intersecting boxes.
+    uint32_t IntersectBoundingBoxes( const Frustum& ViewFrustum, const Vector3Stream& MinBound,
+        const Vector3Stream& MaxBound, uint8_t* Visible );
+
+    // Bounds of the points.  Both are zero when the stream is empty.
+    void ComputeBounds( const Vector3Stream& Points, Vector3& MinBound, Vector3& MaxBound );
+
+    // Bounds of Count interleaved positions spaced Stride bytes apart, such as a vertex buffer's
+    void ComputeBounds( const float* Positions, size_t Stride, uint32_t Count, Vector3& MinBound, Vector3& MaxBound );
+
+} // namespace Math
@@ -0,0 +1,160 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  "Wide" structure-of-arrays companions to the Math classes.  A Vector3 spends a whole
+// register on one vector and leaves a lane idle; a Vector3x4 holds four vectors as three registers of x's,
+// y's and z's, so every lane does useful work and there are no shuffles.  FloatX4 and Vector3x4 use SSE.
+// When the compiler targets AVX (/arch:AVX or higher defines __AVX__), FloatX8 and Vector3x8 are available
+// too, and FloatXN and Vector3xN name the widest type.  Define MATH_WIDE_NO_AVX to stay on four lanes.
+//
+// Comparisons return lane masks (all bits set where true) in the same float type, like XMVectorLess.
+// Matrix4Wide and PlaneWide broadcast one transform or plane across the lanes so that a batch of points or
+// boxes can be tested against it.  See VectorBatch.h for loops over whole arrays.  The float registers
+// themselves are in FloatWide.h, which needs no DirectXMath.
+//
+
+#pragma once
+
+#include "VectorMath.h"
+#include "BoundingPlane.h"
+#include "FloatWide.h"
+
+namespace Math
+{
+    // TFloat lanes of 3-vectors
+    template <typename TFloat>
+    class Vector3Wide
+    {
+    public:
+        enum { kLanes = TFloat::kLanes };
+
+        INLINE Vector3Wide() {}
+        INLINE Vector3Wide( TFloat X, TFloat Y, TFloat Z ) : x(X), y(Y), z(Z) {}
+
+        // The same vector in every lane
+        INLINE explicit Vector3Wide( Vector3 v ) : x((float)v.GetX()), y((float)v.GetY()), z((float)v.GetZ()) {}
+
+        static INLINE Vector3Wide Load( const float* X, const float* Y, const float* Z )
+        {
+            return Vector3Wide(TFloat::Load(X), TFloat::Load(Y), TFloat::Load(Z));
+        }
+
+        INLINE void Store( float* X, float* Y, float* Z ) const
+        {
+            x.Store(X);
+            y.Store(Y);
+            z.Store(Z);
+        }
+
+        // kLanes interleaved positions Stride bytes apart, such as the positions in a vertex buffer
+        static INLINE Vector3Wide Gather( const float* Position, size_t Stride )
+        {
+            return Vector3Wide(TFloat::Gather(Position, Stride), TFloat::Gather(Position + 1, Stride),
+                TFloat::Gather(Position + 2, Stride));
+        }
+
+        INLINE Vector3Wide operator- () const { return Vector3Wide(-x, -y, -z); }
+        INLINE Vector3Wide operator+ ( const Vector3Wide& b ) const { return Vector3Wide(x + b.x, y + b.y, z + b.z); }
+        INLINE Vector3Wide operator- ( const Vector3Wide& b ) const { return Vector3Wide(x - b.x, y - b.y, z - b.z); }
+        INLINE Vector3Wide operator* ( const Vector3Wide& b ) const { return Vector3Wide(x * b.x, y * b.y, z * b.z); }
+        INLINE Vector3Wide operator* ( TFloat s ) const { return Vector3Wide(x * s, y * s, z * s); }
+
+        INLINE friend TFloat Dot( const Vector3Wide& a, const Vector3Wide& b ) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+        INLINE friend Vector3Wide Min( const Vector3Wide& a, const Vector3Wide& b ) { return Vector3Wide(Min(a.x, b.x), Min(a.y, b.y), Min(a.z, b.z)); }
+        INLINE friend Vector3Wide Max( const Vector3Wide& a, const Vector3Wide& b ) { return Vector3Wide(Max(a.x, b.x), Max(a.y, b.y), Max(a.z, b.z)); }
+        INLINE friend Vector3Wide Abs( const Vector3Wide& a ) { return Vector3Wide(Abs(a.x), Abs(a.y), Abs(a.z)); }
+
+        // Component-wise minimum and maximum across the lanes
+        INLINE Vector3 ReduceMin( void ) const { return Vector3(x.ReduceMin(), y.ReduceMin(), z.ReduceMin()); }
+        INLINE Vector3 ReduceMax( void ) const { return Vector3(x.ReduceMax(), y.ReduceMax(), z.ReduceMax()); }
+
+        TFloat x, y, z;
+    };
+
+    typedef Vector3Wide<FloatX4> Vector3x4;
+#ifdef MATH_WIDE_AVX
+    typedef Vector3Wide<FloatX8> Vector3x8;
+#endif
+    typedef Vector3Wide<FloatXN> Vector3xN;
+
+    // One affine Matrix4 broadcast across the lanes.  The fourth row is assumed to be (0, 0, 0, 1), so
+    // projections must go through Matrix4 itself.
+    template <typename TFloat>
+    class Matrix4Wide
+    {
+    public:
+        INLINE explicit Matrix4Wide( const Matrix4& m )
+        {
+            Vector3 Basis[4] = { Vector3(m.GetX()), Vector3(m.GetY()), Vector3(m.GetZ()), Vector3(m.GetW()) };
+            for (int i = 0; i < 4; ++i)
+                m_Basis[i] = Vector3Wide<TFloat>(Basis[i]);
+        }
+
+        INLINE Vector3Wide<TFloat> TransformPoint( const Vector3Wide<TFloat>& p ) const
+        {
+            return m_Basis[0] * p.x + m_Basis[1] * p.y + m_Basis[2] * p.z + m_Basis[3];
+        }
+
+        INLINE Vector3Wide<TFloat> TransformDirection( const Vector3Wide<TFloat>& d ) const
+        {
+            return m_Basis[0] * d.x + m_Basis[1] * d.y + m_Basis[2] * d.z;
+        }
+
+        // Smallest boxes enclosing the transformed boxes, fit around their centers and extents
+        INLINE void TransformBounds( const Vector3Wide<TFloat>& MinBound, const Vector3Wide<TFloat>& MaxBound,
+            Vector3Wide<TFloat>& OutMin, Vector3Wide<TFloat>& OutMax ) const
+        {
+            const TFloat Half(0.5f);
+            Vector3Wide<TFloat> Center = TransformPoint((MinBound + MaxBound) * Half);
+            Vector3Wide<TFloat> Extent = (MaxBound - MinBound) * Half;
+            Extent = Abs(m_Basis[0]) * Extent.x + Abs(m_Basis[1]) * Extent.y + Abs(m_Basis[2]) * Extent.z;
+            OutMin = Center - Extent;
+            OutMax = Center + Extent;
+        }
+
+    private:
+        Vector3Wide<TFloat> m_Basis[4];
+    };
+
+    // One plane broadcast across the lanes
+    template <typename TFloat>
+    class PlaneWide
+    {
+    public:
+        INLINE explicit PlaneWide( BoundingPlane Plane )
+        {
+            // Not Vector3(Vector4), which divides by the plane's distance
+            Vector4 p = Plane;
+            m_Normal = Vector3Wide<TFloat>(Plane.GetNormal());
+            m_Distance = TFloat((float)p.GetW());
+            m_PositiveX = (float)p.GetX() > 0.0f;
+            m_PositiveY = (float)p.GetY() > 0.0f;
+            m_PositiveZ = (float)p.GetZ() > 0.0f;
+        }
+
+        INLINE TFloat DistanceFromPoint( const Vector3Wide<TFloat>& Point ) const
+        {
+            return Dot(Point, m_Normal) + m_Distance;
+        }
+
+        // Lanes whose box lies entirely on the negative side.  Only the corner furthest along the normal
+        // needs testing, and which corner that is does not vary across the lanes.
+        INLINE TFloat BoxOutside( const Vector3Wide<TFloat>& MinBound, const Vector3Wide<TFloat>& MaxBound ) const
+        {
+            Vector3Wide<TFloat> Corner(m_PositiveX ? MaxBound.x : MinBound.x, m_PositiveY ? MaxBound.y : MinBound.y,
+                m_PositiveZ ? MaxBound.z : MinBound.z);
+            return DistanceFromPoint(Corner) < TFloat(0.0f);
+        }
+
+    private:
+        Vector3Wide<TFloat> m_Normal;
+        TFloat m_Distance;
+        bool m_PositiveX, m_PositiveY, m_PositiveZ;
+    };
+
+} // namespace Math
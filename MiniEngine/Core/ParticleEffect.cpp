@@ -39,25 +39,28 @@ ParticleEffect::ParticleEffect(ParticleEffectProperties& effectProperties)
     m_EffectProperties = effectProperties;
 }
 
-inline static Color RandColor( Color c0, Color c1 )
+// Maps uniform [0, 1) samples onto the spawn ranges
+inline static float RandLerp( const float*& u, float MinVal, float MaxVal )
 {
-    // We might want to find min and max of each channel rather than assuming c0 <= c1
-    return Color(
-        s_RNG.NextFloat( c0.R(), c1.R()),
-        s_RNG.NextFloat( c0.G(), c1.G()),
-        s_RNG.NextFloat( c0.B(), c1.B()),
-        s_RNG.NextFloat( c0.A(), c1.A())
-        );
+    return MinVal + *u++ * (MaxVal - MinVal);
 }
 
-inline static XMFLOAT3 RandSpread( const XMFLOAT3& s )
+inline static Color RandColor( const float*& u, Color c0, Color c1 )
 {
     // We might want to find min and max of each channel rather than assuming c0 <= c1
-    return XMFLOAT3(
-        s_RNG.NextFloat(-s.x, s.x),
-        s_RNG.NextFloat(-s.y, s.y), 
-        s_RNG.NextFloat(-s.z, s.z)
-        );
+    float r = RandLerp(u, c0.R(), c1.R());
+    float g = RandLerp(u, c0.G(), c1.G());
+    float b = RandLerp(u, c0.B(), c1.B());
+    float a = RandLerp(u, c0.A(), c1.A());
+    return Color(r, g, b, a);
+}
+
+inline static XMFLOAT3 RandSpread( const float*& u, const XMFLOAT3& s )
+{
+    float x = RandLerp(u, -s.x, s.x);
+    float y = RandLerp(u, -s.y, s.y);
+    float z = RandLerp(u, -s.z, s.z);
+    return XMFLOAT3(x, y, z);
 }
 
 void ParticleEffect::LoadDeviceResources(DX12_DEVICE* device)
@@ -67,30 +70,39 @@ void ParticleEffect::LoadDeviceResources(DX12_DEVICE* device)
     m_OriginalEffectProperties = m_EffectProperties; //In case we want to reset
     
     //Fill particle spawn data buffer
-    ParticleSpawnData* pSpawnData = (ParticleSpawnData*)_malloca(m_EffectProperties.EmitProperties.MaxParticles * sizeof(ParticleSpawnData));
-    
-    for (UINT i = 0; i < m_EffectProperties.EmitProperties.MaxParticles; i++)
+    const UINT MaxParticles = m_EffectProperties.EmitProperties.MaxParticles;
+    ParticleSpawnData* pSpawnData = (ParticleSpawnData*)_malloca(MaxParticles * sizeof(ParticleSpawnData));
+
+    // Generate every uniform sample up front in one batch, then map them onto the spawn ranges
+    const UINT kSamplesPerParticle = 20;
+    float* pSamples = (float*)_malloca(MaxParticles * kSamplesPerParticle * sizeof(float));
+    s_RNG.Fill(pSamples, MaxParticles * kSamplesPerParticle);
+    const float* u = pSamples;
+
+    for (UINT i = 0; i < MaxParticles; i++)
     {
         ParticleSpawnData& SpawnData = pSpawnData[i];
-        SpawnData.AgeRate = 1.0f / s_RNG.NextFloat( m_EffectProperties.LifeMinMax.x, m_EffectProperties.LifeMinMax.y );
-        float horizontalAngle = s_RNG.NextFloat(XM_2PI);
-        float horizontalVelocity = s_RNG.NextFloat( m_EffectProperties.Velocity.GetX(), m_EffectProperties.Velocity.GetY() );
+        SpawnData.AgeRate = 1.0f / RandLerp( u, m_EffectProperties.LifeMinMax.x, m_EffectProperties.LifeMinMax.y );
+        float horizontalAngle = RandLerp( u, 0.0f, XM_2PI );
+        float horizontalVelocity = RandLerp( u, m_EffectProperties.Velocity.GetX(), m_EffectProperties.Velocity.GetY() );
         SpawnData.Velocity.x = horizontalVelocity * cos(horizontalAngle);
-        SpawnData.Velocity.y = s_RNG.NextFloat( m_EffectProperties.Velocity.GetZ(), m_EffectProperties.Velocity.GetW() );
+        SpawnData.Velocity.y = RandLerp( u, m_EffectProperties.Velocity.GetZ(), m_EffectProperties.Velocity.GetW() );
         SpawnData.Velocity.z = horizontalVelocity * sin(horizontalAngle);
 
-        SpawnData.SpreadOffset = RandSpread(m_EffectProperties.Spread ) ;
+        SpawnData.SpreadOffset = RandSpread( u, m_EffectProperties.Spread );
 
-        SpawnData.StartSize = s_RNG.NextFloat( m_EffectProperties.Size.GetX(), m_EffectProperties.Size.GetY() );
-        SpawnData.EndSize = s_RNG.NextFloat( m_EffectProperties.Size.GetZ(), m_EffectProperties.Size.GetW() );
-        SpawnData.StartColor = RandColor( m_EffectProperties.MinStartColor, m_EffectProperties.MaxStartColor );
-        SpawnData.EndColor = RandColor( m_EffectProperties.MinEndColor, m_EffectProperties.MaxEndColor );
-        SpawnData.Mass = s_RNG.NextFloat( m_EffectProperties.MassMinMax.x, m_EffectProperties.MassMinMax.y );
-        SpawnData.RotationSpeed = s_RNG.NextFloat(); //todo
-        SpawnData.Random = s_RNG.NextFloat();
+        SpawnData.StartSize = RandLerp( u, m_EffectProperties.Size.GetX(), m_EffectProperties.Size.GetY() );
+        SpawnData.EndSize = RandLerp( u, m_EffectProperties.Size.GetZ(), m_EffectProperties.Size.GetW() );
+        SpawnData.StartColor = RandColor( u, m_EffectProperties.MinStartColor, m_EffectProperties.MaxStartColor );
+        SpawnData.EndColor = RandColor( u, m_EffectProperties.MinEndColor, m_EffectProperties.MaxEndColor );
+        SpawnData.Mass = RandLerp( u, m_EffectProperties.MassMinMax.x, m_EffectProperties.MassMinMax.y );
+        SpawnData.RotationSpeed = *u++; //todo
+        SpawnData.Random = *u++;
     }
-    
-    m_RandomStateBuffer.Create(L"ParticleSystem::SpawnDataBuffer", m_EffectProperties.EmitProperties.MaxParticles, sizeof(ParticleSpawnData), pSpawnData);
+    ASSERT(u == pSamples + MaxParticles * kSamplesPerParticle);
+    _freea(pSamples);
+
+    m_RandomStateBuffer.Create(L"ParticleSystem::SpawnDataBuffer", MaxParticles, sizeof(ParticleSpawnData), pSpawnData);
     _freea(pSpawnData);
 
     m_StateBuffers[0].Create(L"ParticleSystem::Buffer0", m_EffectProperties.EmitProperties.MaxParticles, sizeof(ParticleMotion));
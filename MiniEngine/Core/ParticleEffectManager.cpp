@@ -25,6 +25,7 @@
 #include "ParticleEffect.h"
 #include "ParticleEffectProperties.h"
 #include "TextureManager.h"
+#include "HandleTable.h"
 #include <mutex>
 
 #include "CompiledShaders/ParticleSpawnCS.h"
@@ -154,7 +155,22 @@ namespace
     std::vector<std::wstring> TextureNameArray;
 
     std::vector<std::unique_ptr<ParticleEffect>> ParticleEffectsPool;
-    std::vector<ParticleEffect*> ParticleEffectsActive;
+    std::mutex TextureListMutex;
+
+    // An instance either shares a preloaded effect from the pool or owns a one-off effect
+    struct ActiveEffect
+    {
+        ParticleEffect* Effect;
+        std::unique_ptr<ParticleEffect> Owned;
+    };
+    HandleTable<ActiveEffect> ParticleEffectsActive;
+    std::mutex ActiveEffectsMutex;
+
+    // Expired effects are collected during Update() and removed together afterward
+    std::vector<EffectHandle> RetiredEffects;
+
+    // Retired one-off effects whose buffers may still be in use by the GPU, tagged with a fence value
+    std::vector<std::pair<uint64_t, std::unique_ptr<ParticleEffect>>> DeferredDeletes;
 
     static bool s_InitComplete = false; 
     UINT TotalElapsedFrames;
@@ -173,6 +189,29 @@ namespace
         CompContext.Dispatch( 1, 1, 1 );
     }
 
+    void RetireExpiredEffects(void)
+    {
+        CommandQueue& Queue = g_CommandManager.GetGraphicsQueue();
+        uint64_t FenceValue = Queue.GetNextFenceValue();
+
+        for (EffectHandle Handle : RetiredEffects)
+        {
+            ActiveEffect* Retired = ParticleEffectsActive.Get(Handle);
+            if (Retired != nullptr && Retired->Owned)
+                DeferredDeletes.emplace_back(FenceValue, std::move(Retired->Owned));
+            ParticleEffectsActive.Remove(Handle);
+        }
+        RetiredEffects.clear();
+
+        size_t Kept = 0;
+        for (size_t i = 0; i < DeferredDeletes.size(); ++i)
+        {
+            if (!Queue.IsFenceComplete(DeferredDeletes[i].first))
+                DeferredDeletes[Kept++] = std::move(DeferredDeletes[i]);
+        }
+        DeferredDeletes.resize(Kept);
+    }
+
     void MaintainTextureList(ParticleEffectProperties& effectProperties)
     {
         std::wstring name = effectProperties.TexturePath;
@@ -583,56 +622,51 @@ EffectHandle ParticleEffects::PreLoadEffectResources( ParticleEffectProperties&
     if (!s_InitComplete)
         return EFFECTS_ERROR;
 
-    static std::mutex s_TextureMutex;
-    s_TextureMutex.lock();
-    MaintainTextureList(effectProperties);
-    ParticleEffectsPool.emplace_back(new ParticleEffect(effectProperties));
-    s_TextureMutex.unlock();
+    EffectHandle index;
+    {
+        std::lock_guard<std::mutex> LockGuard(TextureListMutex);
+        MaintainTextureList(effectProperties);
+        ParticleEffectsPool.emplace_back(new ParticleEffect(effectProperties));
+        index = (EffectHandle)ParticleEffectsPool.size() - 1;
+    }
 
-    EffectHandle index = (EffectHandle)ParticleEffectsPool.size() - 1;
     ParticleEffectsPool[index]->LoadDeviceResources(Graphics::g_Device);
     return index;
 }
 
-//Returns index into Active
+//Returns a handle to the active instance
 EffectHandle ParticleEffects::InstantiateEffect( EffectHandle effectHandle )
 {
-    if (!s_InitComplete || effectHandle >= ParticleEffectsPool.size() || effectHandle < 0)
+    if (!s_InitComplete || effectHandle >= ParticleEffectsPool.size())
         return EFFECTS_ERROR;
     
     ParticleEffect* effect = ParticleEffectsPool[effectHandle].get();
-    if (effect != NULL)
-    {
-        static std::mutex s_InstantiateEffectFromPoolMutex;
-        s_InstantiateEffectFromPoolMutex.lock();
-        ParticleEffectsActive.push_back(effect);
-        s_InstantiateEffectFromPoolMutex.unlock();
-    }
-    else
+    if (effect == NULL)
         return EFFECTS_ERROR;
 
-    EffectHandle index = (EffectHandle)ParticleEffectsActive.size() - 1;
-    return index;
-    
+    std::lock_guard<std::mutex> LockGuard(ActiveEffectsMutex);
+    return ParticleEffectsActive.Insert({ effect, nullptr });
 }
 
-//Returns index into Active
+//Returns a handle to the active instance.  The effect is destroyed once it expires.
 EffectHandle ParticleEffects::InstantiateEffect( ParticleEffectProperties& effectProperties )
 {
     if (!s_InitComplete)
         return EFFECTS_ERROR;
 
-    static std::mutex s_InstantiateNewEffectMutex;
-    s_InstantiateNewEffectMutex.lock();
-    MaintainTextureList(effectProperties);
-    ParticleEffect* newEffect = new ParticleEffect(effectProperties);
-    ParticleEffectsPool.emplace_back(newEffect);
-    ParticleEffectsActive.push_back(newEffect);
-    s_InstantiateNewEffectMutex.unlock();
-
-    EffectHandle index = (EffectHandle)ParticleEffectsActive.size() - 1;
-    ParticleEffectsActive[index]->LoadDeviceResources(Graphics::g_Device);
-    return index;	
+    std::unique_ptr<ParticleEffect> newEffect;
+    {
+        std::lock_guard<std::mutex> LockGuard(TextureListMutex);
+        MaintainTextureList(effectProperties);
+        newEffect.reset(new ParticleEffect(effectProperties));
+    }
+
+    // Load before publishing so Update() never sees an effect without buffers
+    newEffect->LoadDeviceResources(Graphics::g_Device);
+
+    ParticleEffect* effect = newEffect.get();
+    std::lock_guard<std::mutex> LockGuard(ActiveEffectsMutex);
+    return ParticleEffectsActive.Insert({ effect, std::move(newEffect) });
 }
 
 //---------------------------------------------------------------------
@@ -643,7 +677,7 @@ EffectHandle ParticleEffects::InstantiateEffect( ParticleEffectProperties& effec
 
 void ParticleEffects::Update(ComputeContext& Context, float timeDelta )
 {
-    if (!Enable || !s_InitComplete || ParticleEffectsActive.size() == 0)
+    if (!Enable || !s_InitComplete || ParticleEffectsActive.GetCount() == 0)
         return;
 
     ScopedTimer _prof(L"Particle Update", Context);
@@ -656,7 +690,8 @@ void ParticleEffects::Update(ComputeContext& Context, float timeDelta )
 
     Context.ResetCounter(SpriteVertexBuffer);
 
-    if (ParticleEffectsActive.size() == 0)
+    std::lock_guard<std::mutex> LockGuard(ActiveEffectsMutex);
+    if (ParticleEffectsActive.GetCount() == 0)
         return;
 
     Context.SetRootSignature(RootSig);
@@ -664,22 +699,17 @@ void ParticleEffects::Update(ComputeContext& Context, float timeDelta )
     Context.TransitionResource(SpriteVertexBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     Context.SetDynamicDescriptor(3, 0, SpriteVertexBuffer.GetUAV());
 
-    for (UINT i = 0; i < ParticleEffectsActive.size(); ++i)
+    for (uint32_t i = 0; i < ParticleEffectsActive.GetCount(); ++i)
     {	
-        ParticleEffectsActive[i]->Update(Context, timeDelta);
+        ParticleEffect* effect = ParticleEffectsActive[i].Effect;
+        effect->Update(Context, timeDelta);
 
-        if (ParticleEffectsActive[i]->GetLifetime() <= ParticleEffectsActive[i]->GetElapsedTime())
-        {
-            //Erase from vector
-            auto iter = ParticleEffectsActive.begin() + i;
-            static std::mutex s_EraseEffectMutex;
-            s_EraseEffectMutex.lock();
-            ParticleEffectsActive.erase(iter);
-            s_EraseEffectMutex.unlock();
-        }
+        if (effect->GetLifetime() <= effect->GetElapsedTime())
+            RetiredEffects.push_back(ParticleEffectsActive.GetHandle(i));
     }
 
     SetFinalBuffers(Context);
+    RetireExpiredEffects();
 }
 
 
@@ -691,7 +721,7 @@ void ParticleEffects::Update(ComputeContext& Context, float timeDelta )
 
 void ParticleEffects::Render( CommandContext& Context, const Camera& Camera, ColorBuffer& ColorTarget, DepthBuffer& DepthTarget, ColorBuffer& LinearDepth)
 {
-    if (!Enable || !s_InitComplete || ParticleEffectsActive.size() == 0)
+    if (!Enable || !s_InitComplete || ParticleEffectsActive.GetCount() == 0)
         return;
 
     uint32_t Width = (uint32_t)ColorTarget.GetWidth();
@@ -768,24 +798,32 @@ void ParticleEffects::Render( CommandContext& Context, const Camera& Camera, Col
 
 void ParticleEffects::ClearAll()
 {
-    ParticleEffectsActive.clear();
+    std::lock_guard<std::mutex> LockGuard(ActiveEffectsMutex);
+    ParticleEffectsActive.Clear();
+    RetiredEffects.clear();
+    DeferredDeletes.clear();
     ParticleEffectsPool.clear();
     TextureNameArray.clear();
 }
 
 void ParticleEffects::ResetEffect(EffectHandle EffectID)
 {
-    if (!s_InitComplete || ParticleEffectsActive.size() == 0 || PauseSim || EffectID >= ParticleEffectsActive.size())
+    if (!s_InitComplete || PauseSim)
         return;
     
-    ParticleEffectsActive[EffectID]->Reset();
+    std::lock_guard<std::mutex> LockGuard(ActiveEffectsMutex);
+    ActiveEffect* Instance = ParticleEffectsActive.Get(EffectID);
+    if (Instance != nullptr)
+        Instance->Effect->Reset();
 }
 
 
 float ParticleEffects::GetCurrentLife(EffectHandle EffectID)
 {
-    if (!s_InitComplete || ParticleEffectsActive.size() == 0 || PauseSim || EffectID >= ParticleEffectsActive.size())
+    if (!s_InitComplete || PauseSim)
         return -1.0;
     
-    return ParticleEffectsActive[EffectID]->GetElapsedTime();
+    std::lock_guard<std::mutex> LockGuard(ActiveEffectsMutex);
+    const ActiveEffect* Instance = ParticleEffectsActive.Get(EffectID);
+    return Instance != nullptr ? Instance->Effect->GetElapsedTime() : -1.0f;
 }
@@ -0,0 +1,210 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  The resource barriers a command context has queued but not yet submitted, and the rules
+// for folding new transitions into them.  CommandContext queues D3D12_RESOURCE_BARRIERs and CommandRecorder
+// queues its own device-free barriers; the Traits parameter describes the barrier type:
+//
+//     typedef ... Barrier;        // The queued element
+//     typedef ... ResourceId;     // What identifies a resource
+//     typedef ... State;          // A resource state
+//     typedef ... Flags;          // A barrier's split flags
+//     static const Flags kFlagNone, kFlagBeginOnly, kFlagEndOnly;
+//     static State InvalidState( void );           // TransitioningState when no transition was begun
+//     static State UnorderedAccessState( void );
+//     static Barrier MakeTransition( ResourceId Id, State Before, State After, Flags Flags );
+//     static Barrier MakeUAV( ResourceId Id );
+//     static Flags& GetFlags( Barrier& B );
+//     static State& StateBefore( Barrier& B );
+//     static State& StateAfter( Barrier& B );
+//     static PendingMatch Match( const Barrier& B, ResourceId Id );
+//
+// Built without any Windows headers so the queue can be tested on any platform.
+//
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace BarrierQueue
+{
+    // How a queued barrier relates to a resource that is about to transition
+    enum PendingMatch
+    {
+        kUnrelated,         // Doesn't touch the resource; keep looking further back
+        kTransition,        // A whole-resource transition that may be rewritten
+        kBlocked            // Orders work against the resource, so nothing before it may be rewritten
+    };
+}
+
+template <typename Traits>
+class ResourceBarrierQueue
+{
+public:
+
+    typedef typename Traits::Barrier Barrier;
+    typedef typename Traits::ResourceId ResourceId;
+    typedef typename Traits::State State;
+
+    ResourceBarrierQueue() : m_MergedTransitions(0), m_RedundantTransitions(0) {}
+
+    bool Empty( void ) const { return m_Barriers.empty(); }
+    uint32_t Size( void ) const { return (uint32_t)m_Barriers.size(); }
+    const Barrier* Data( void ) const { return m_Barriers.data(); }
+    const std::vector<Barrier>& GetBarriers( void ) const { return m_Barriers; }
+
+    void Reserve( size_t Count ) { m_Barriers.reserve(Count); }
+    void Clear( void ) { m_Barriers.clear(); }
+
+    // Transitions folded into one still waiting to be flushed, and transitions to the state a resource was
+    // already in, since the last ResetCounters()
+    uint32_t GetMergedTransitions( void ) const { return m_MergedTransitions; }
+    uint32_t GetRedundantTransitions( void ) const { return m_RedundantTransitions; }
+    void ResetCounters( void ) { m_MergedTransitions = m_RedundantTransitions = 0; }
+
+    void Push( const Barrier& Desc ) { m_Barriers.push_back(Desc); }
+
+    // UsageState and TransitioningState belong to the resource, as GpuResource keeps them
+    void Transition( ResourceId Id, State& UsageState, State& TransitioningState, State NewState );
+    void BeginTransition( ResourceId Id, State& UsageState, State& TransitioningState, State NewState );
+    void InsertUAVBarrier( ResourceId Id ) { Push(Traits::MakeUAV(Id)); }
+
+private:
+
+    Barrier* FindPendingTransition( ResourceId Id );
+    void Erase( Barrier* Desc ) { m_Barriers.erase(m_Barriers.begin() + (Desc - m_Barriers.data())); }
+
+    std::vector<Barrier> m_Barriers;
+    uint32_t m_MergedTransitions;
+    uint32_t m_RedundantTransitions;
+};
+
+template <typename Traits>
+typename ResourceBarrierQueue<Traits>::Barrier* ResourceBarrierQueue<Traits>::FindPendingTransition( ResourceId Id )
+{
+    // Walk back to the most recent queued transition of this resource
+    for (auto iter = m_Barriers.rbegin(); iter != m_Barriers.rend(); ++iter)
+    {
+        switch (Traits::Match(*iter, Id))
+        {
+        case BarrierQueue::kTransition:
+            return &*iter;
+        case BarrierQueue::kBlocked:
+            return nullptr;
+        default:
+            break;
+        }
+    }
+    return nullptr;
+}
+
+template <typename Traits>
+void ResourceBarrierQueue<Traits>::Transition( ResourceId Id, State& UsageState, State& TransitioningState, State NewState )
+{
+    State OldState = UsageState;
+
+    // A begun transition is dealt with first, even when the resource goes back to the state it began from
+    if (TransitioningState != Traits::InvalidState())
+    {
+        Barrier* Pending = FindPendingTransition(Id);
+        if (Pending != nullptr && Traits::GetFlags(*Pending) == Traits::kFlagBeginOnly)
+        {
+            // The split transition never reached the command list, so there is nothing to overlap with.
+            // Issue it as one ordinary transition straight to the state we want now, or cancel it if that
+            // is where it began.
+            assert(Traits::StateBefore(*Pending) == OldState);
+            if (OldState == NewState)
+                Erase(Pending);
+            else
+            {
+                Traits::GetFlags(*Pending) = Traits::kFlagNone;
+                Traits::StateAfter(*Pending) = NewState;
+            }
+            TransitioningState = Traits::InvalidState();
+            UsageState = NewState;
+            ++m_MergedTransitions;
+            return;
+        }
+
+        // The beginning was flushed, so the transition has to be ended before the resource can move
+        // anywhere else
+        Push(Traits::MakeTransition(Id, OldState, TransitioningState, Traits::kFlagEndOnly));
+        OldState = UsageState = TransitioningState;
+        TransitioningState = Traits::InvalidState();
+
+        if (OldState != NewState)
+            Push(Traits::MakeTransition(Id, OldState, NewState, Traits::kFlagNone));
+        UsageState = NewState;
+        return;
+    }
+
+    if (OldState == NewState)
+    {
+        if (NewState == Traits::UnorderedAccessState())
+            InsertUAVBarrier(Id);
+        else
+            ++m_RedundantTransitions;
+        return;
+    }
+
+    Barrier* Pending = FindPendingTransition(Id);
+    if (Pending != nullptr && Traits::GetFlags(*Pending) == Traits::kFlagNone)
+    {
+        // Nothing has used the intermediate state yet, so A->B followed by B->C is just A->C.  When
+        // that brings the resource back where it started, the barrier goes away entirely.
+        assert(Traits::StateAfter(*Pending) == OldState);
+        Traits::StateAfter(*Pending) = NewState;
+        if (Traits::StateBefore(*Pending) == NewState)
+            Erase(Pending);
+        ++m_MergedTransitions;
+    }
+    else
+        Push(Traits::MakeTransition(Id, OldState, NewState, Traits::kFlagNone));
+
+    UsageState = NewState;
+}
+
+template <typename Traits>
+void ResourceBarrierQueue<Traits>::BeginTransition( ResourceId Id, State& UsageState, State& TransitioningState, State NewState )
+{
+    // If it's already transitioning, finish that transition
+    if (TransitioningState != Traits::InvalidState())
+        Transition(Id, UsageState, TransitioningState, TransitioningState);
+
+    if (UsageState == NewState)
+        return;
+
+    Barrier* Pending = FindPendingTransition(Id);
+
+    if (Pending != nullptr && Traits::GetFlags(*Pending) == Traits::kFlagNone)
+    {
+        // The resource is never used in the state we just queued, so begin from where it really is
+        assert(Traits::StateAfter(*Pending) == UsageState);
+        ++m_MergedTransitions;
+        if (Traits::StateBefore(*Pending) == NewState)
+        {
+            Erase(Pending);
+            UsageState = NewState;
+        }
+        else
+        {
+            Traits::GetFlags(*Pending) = Traits::kFlagBeginOnly;
+            Traits::StateAfter(*Pending) = NewState;
+            UsageState = Traits::StateBefore(*Pending);
+            TransitioningState = NewState;
+        }
+    }
+    else
+    {
+        Push(Traits::MakeTransition(Id, UsageState, NewState, Traits::kFlagBeginOnly));
+        TransitioningState = NewState;
+    }
+}
@@ -16,10 +16,8 @@
 #include "EsramAllocator.h"
 #include "CommandContext.h"
 
-void ShadowBuffer::Create( const std::wstring& Name, uint32_t Width, uint32_t Height, D3D12_GPU_VIRTUAL_ADDRESS VidMemPtr )
+void ShadowBuffer::InitViewport( uint32_t Width, uint32_t Height )
 {
-    DepthBuffer::Create( Name, Width, Height, DXGI_FORMAT_D16_UNORM, VidMemPtr );
-
     m_Viewport.TopLeftX = 0.0f;
     m_Viewport.TopLeftY = 0.0f;
     m_Viewport.Width = (float)Width;
@@ -34,22 +32,22 @@ void ShadowBuffer::Create( const std::wstring& Name, uint32_t Width, uint32_t He
     m_Scissor.bottom = (LONG)Height - 2;
 }
 
+void ShadowBuffer::Create( const std::wstring& Name, uint32_t Width, uint32_t Height, D3D12_GPU_VIRTUAL_ADDRESS VidMemPtr )
+{
+    DepthBuffer::Create( Name, Width, Height, DXGI_FORMAT_D16_UNORM, VidMemPtr );
+    InitViewport( Width, Height );
+}
+
 void ShadowBuffer::Create( const std::wstring& Name, uint32_t Width, uint32_t Height, EsramAllocator& Allocator )
 {
     DepthBuffer::Create( Name, Width, Height, DXGI_FORMAT_D16_UNORM, Allocator );
+    InitViewport( Width, Height );
+}
 
-    m_Viewport.TopLeftX = 0.0f;
-    m_Viewport.TopLeftY = 0.0f;
-    m_Viewport.Width = (float)Width;
-    m_Viewport.Height = (float)Height;
-    m_Viewport.MinDepth = 0.0f;
-    m_Viewport.MaxDepth = 1.0f;
-
-    // Prevent drawing to the boundary pixels so that we don't have to worry about shadows stretching
-    m_Scissor.left = 1;
-    m_Scissor.top = 1;
-    m_Scissor.right = (LONG)Width - 2;
-    m_Scissor.bottom = (LONG)Height - 2;
+void ShadowBuffer::CreateArray( const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t ArrayCount )
+{
+    DepthBuffer::CreateArray( Name, Width, Height, ArrayCount, DXGI_FORMAT_D16_UNORM );
+    InitViewport( Width, Height );
 }
 
 void ShadowBuffer::BeginRendering( GraphicsContext& Context )
@@ -60,6 +58,14 @@ void ShadowBuffer::BeginRendering( GraphicsContext& Context )
     Context.SetViewportAndScissor(m_Viewport, m_Scissor);
 }
 
+void ShadowBuffer::BeginRendering( GraphicsContext& Context, uint32_t ArraySlice )
+{
+    Context.TransitionResource(*this, D3D12_RESOURCE_STATE_DEPTH_WRITE, true);
+    Context.ClearDepth(*this, ArraySlice);
+    Context.SetDepthStencilTarget(GetSliceDSV(ArraySlice));
+    Context.SetViewportAndScissor(m_Viewport, m_Scissor);
+}
+
 void ShadowBuffer::EndRendering( GraphicsContext& Context )
 {
     Context.TransitionResource(*this, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
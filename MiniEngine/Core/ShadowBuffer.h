@@ -28,12 +28,21 @@ public:
         D3D12_GPU_VIRTUAL_ADDRESS VidMemPtr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN );
     void Create( const std::wstring& Name, uint32_t Width, uint32_t Height, EsramAllocator& Allocator );
 
+    // An array of shadow maps that are rendered one slice at a time and sampled as a Texture2DArray
+    void CreateArray( const std::wstring& Name, uint32_t Width, uint32_t Height, uint32_t ArrayCount );
+
     D3D12_CPU_DESCRIPTOR_HANDLE GetSRV() const { return GetDepthSRV(); }
 
     void BeginRendering( GraphicsContext& context );
     void EndRendering( GraphicsContext& context );
 
+    // Clears and binds one slice of an array.  The whole array transitions to DEPTH_WRITE, so finish
+    // every slice update before calling EndRendering().
+    void BeginRendering( GraphicsContext& context, uint32_t ArraySlice );
+
 private:
+    void InitViewport( uint32_t Width, uint32_t Height );
+
     D3D12_VIEWPORT m_Viewport;
     D3D12_RECT m_Scissor;
 };
@@ -21,6 +21,7 @@ void GameCore::ShadowCamera::UpdateMatrix(
     uint32_t BufferWidth, uint32_t BufferHeight, uint32_t BufferPrecision )
 {
     SetLookDirection( LightDirection, Vector3(kZUnitVector) );
+    m_ShadowBounds = ShadowBounds;
 
     // Converts world units to texel units so we can quantize the camera position to whole texel units
     Vector3 RcpDimensions = Recip(ShadowBounds);
@@ -46,3 +47,67 @@ void GameCore::ShadowCamera::UpdateMatrix(
     // Transform from clip space to texture space
     m_ShadowMatrix =  Matrix4( AffineTransform( Matrix3::MakeScale( 0.5f, -0.5f, 1.0f ), Vector3(0.5f, 0.5f, 0.0f) ) ) * m_ViewProjMatrix;
 }
+
+void GameCore::ShadowCamera::UpdateCascade(
+    Vector3 LightDirection, const BoundingSphere& Receivers, Vector3 CasterMin, Vector3 CasterMax,
+    uint32_t BufferWidth, uint32_t BufferHeight, uint32_t BufferPrecision )
+{
+    // Round the radius up to a 1/16th unit so float noise from camera motion never rescales the texels
+    float Radius = ceilf((float)Receivers.GetRadius() * 16.0f) / 16.0f;
+    Vector3 Center = Receivers.GetCenter();
+
+    // Distances along the light direction.  The nearest point of the caster box is found by taking the
+    // smaller of each axis' contribution.
+    float CenterDist = Dot(Center, LightDirection);
+    float CasterDist = Dot(Min(CasterMin * LightDirection, CasterMax * LightDirection), Vector3(kIdentity));
+    float FarDist = CenterDist + Radius;
+    float NearDist = Min(CasterDist, CenterDist - Radius);
+
+    UpdateMatrix( LightDirection, Center + LightDirection * Radius,
+        Vector3(2.0f * Radius, 2.0f * Radius, FarDist - NearDist), BufferWidth, BufferHeight, BufferPrecision );
+}
+
+bool GameCore::ShadowCamera::IntersectBoundingBox( Vector3 MinBound, Vector3 MaxBound ) const
+{
+    Vector3 BoxCenter = (MinBound + MaxBound) * 0.5f;
+    Vector3 BoxExtent = (MaxBound - MinBound) * 0.5f;
+
+    // Project the box onto the light's right and up axes and compare against the buffer's footprint
+    Vector3 Offset = BoxCenter - GetPosition();
+    float ExtentX = Dot(Abs(GetRightVec()), BoxExtent);
+    float ExtentY = Dot(Abs(GetUpVec()), BoxExtent);
+
+    return Abs((float)Dot(Offset, GetRightVec())) <= (float)m_ShadowBounds.GetX() * 0.5f + ExtentX
+        && Abs((float)Dot(Offset, GetUpVec())) <= (float)m_ShadowBounds.GetY() * 0.5f + ExtentY;
+}
+
+void GameCore::ComputeCascadeSplits( float NearClip, float FarClip, uint32_t NumCascades, float Lambda, float* Splits )
+{
+    ASSERT(NumCascades > 0 && NearClip > 0.0f && FarClip > NearClip);
+
+    const float Ratio = FarClip / NearClip;
+
+    Splits[0] = NearClip;
+    for (uint32_t i = 1; i < NumCascades; ++i)
+    {
+        float t = (float)i / NumCascades;
+        float LogSplit = NearClip * powf(Ratio, t);
+        float UniformSplit = NearClip + (FarClip - NearClip) * t;
+        Splits[i] = Lambda * LogSplit + (1.0f - Lambda) * UniformSplit;
+    }
+    Splits[NumCascades] = FarClip;
+}
+
+BoundingSphere GameCore::ComputeFrustumSliceSphere( Vector3 Position, Vector3 Forward,
+    float TanHalfFovX, float TanHalfFovY, float NearDist, float FarDist )
+{
+    // A corner at distance z lies k*z off the view axis.  The center is placed on the axis where the near
+    // and far corners are equidistant, unless that falls past the far plane, as it does for wide slices.
+    float KSq = TanHalfFovX * TanHalfFovX + TanHalfFovY * TanHalfFovY;
+    float CenterDist = Min(0.5f * (FarDist + NearDist) * (1.0f + KSq), FarDist);
+
+    float FarOffset = FarDist - CenterDist;
+    float Radius = sqrtf(FarOffset * FarOffset + KSq * FarDist * FarDist);
+
+    return BoundingSphere(Position + Forward * CenterDist, Radius);
+}
@@ -34,12 +34,40 @@ namespace GameCore
             uint32_t BufferPrecision	// Bit depth of shadow buffer--usually 16 or 24
             );
 
+        // Fits the shadow volume to one cascade:  the receiver sphere sets the width, height, and far plane,
+        // and the near plane is pulled back toward the light far enough to include every caster in the box.
+        // The sphere radius is rounded up so that texel size does not change as the camera turns.
+        void UpdateCascade(
+            Vector3 LightDirection,		// Direction parallel to light, in direction of travel
+            const BoundingSphere& Receivers,	// Bounds of the view frustum slice covered by this cascade
+            Vector3 CasterMin,			// World space bounds of all shadow casters
+            Vector3 CasterMax,
+            uint32_t BufferWidth,
+            uint32_t BufferHeight,
+            uint32_t BufferPrecision
+            );
+
         // Used to transform world space to texture space for shadow sampling
         const Matrix4& GetShadowMatrix() const { return m_ShadowMatrix; }
 
+        // Conservative test of whether a caster's box covers any texels of the shadow buffer.  Depth is not
+        // tested because the volume already extends toward the light past every caster.
+        bool IntersectBoundingBox( Vector3 MinBound, Vector3 MaxBound ) const;
+
     private:
 
         Matrix4 m_ShadowMatrix;
+        Vector3 m_ShadowBounds;
     };
 
+    // Distances along the view direction that divide [NearClip, FarClip] into NumCascades slices.  Lambda
+    // blends between uniform (0) and logarithmic (1) spacing.  Splits receives NumCascades + 1 values.
+    void ComputeCascadeSplits( float NearClip, float FarClip, uint32_t NumCascades, float Lambda, float* Splits );
+
+    // Smallest sphere enclosing the slice of a symmetric perspective frustum between two view distances.
+    // TanHalfFovX and TanHalfFovY are the reciprocals of the projection matrix's x and y scales.  The
+    // radius depends only on the distances and field of view, never on the camera's orientation.
+    BoundingSphere ComputeFrustumSliceSphere( Vector3 Position, Vector3 Forward,
+        float TanHalfFovX, float TanHalfFovY, float NearDist, float FarDist );
+
 }
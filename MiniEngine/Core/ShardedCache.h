@@ -0,0 +1,119 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  A map from file path to heap-allocated entry, split into shards that each have their own
+// lock.  A path is hashed once per lookup and only the shard owning the hash is locked, so threads loading
+// different files rarely contend.  Entries are never moved, so pointers to them stay valid until erased.
+// The class never touches a device; the TextureManager keeps its textures in one.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+template <typename T, size_t ShardCount = 32>
+class ShardedCache
+{
+public:
+
+    static_assert((ShardCount & (ShardCount - 1)) == 0, "Shard count must be a power of two");
+
+    // 64-bit FNV-1a
+    static size_t HashKey( const std::wstring& Key )
+    {
+        uint64_t Hash = 14695981039346656037ull;
+        for (wchar_t Char : Key)
+            Hash = (Hash ^ (uint64_t)Char) * 1099511628211ull;
+        return (size_t)Hash;
+    }
+
+    // Paths that differ only in their last characters differ mostly in the high bits of the hash, so the
+    // bits are mixed (the MurmurHash3 finalizer) before the low ones select the shard.
+    static size_t ShardIndex( size_t Hash )
+    {
+        uint64_t Mixed = Hash;
+        Mixed ^= Mixed >> 33;
+        Mixed *= 0xff51afd7ed558ccdull;
+        Mixed ^= Mixed >> 33;
+        Mixed *= 0xc4ceb9fe1a85ec53ull;
+        Mixed ^= Mixed >> 33;
+        return (size_t)Mixed & (ShardCount - 1);
+    }
+
+    // Returns the entry for Key and false, or a new entry made by Create() and true.  Create() runs under
+    // the shard's lock, so it should only construct the entry and leave loading it to the caller.
+    template <typename CreateFn>
+    std::pair<T*, bool> FindOrCreate( const std::wstring& Key, size_t KeyHash, CreateFn Create )
+    {
+        Shard& S = m_Shards[ShardIndex(KeyHash)];
+        std::lock_guard<std::mutex> Guard(S.Mutex);
+
+        auto Range = S.Entries.equal_range(KeyHash);
+        for (auto Iter = Range.first; Iter != Range.second; ++Iter)
+        {
+            if (Iter->second.Key == Key)
+                return std::make_pair(Iter->second.Value.get(), false);
+        }
+
+        T* NewEntry = Create();
+        S.Entries.emplace(KeyHash, Entry{ Key, std::unique_ptr<T>(NewEntry) });
+        return std::make_pair(NewEntry, true);
+    }
+
+    // Deletes the entry
+    void Erase( const T* Value, size_t KeyHash )
+    {
+        Shard& S = m_Shards[ShardIndex(KeyHash)];
+        std::lock_guard<std::mutex> Guard(S.Mutex);
+
+        auto Range = S.Entries.equal_range(KeyHash);
+        for (auto Iter = Range.first; Iter != Range.second; ++Iter)
+        {
+            if (Iter->second.Value.get() == Value)
+            {
+                S.Entries.erase(Iter);
+                return;
+            }
+        }
+    }
+
+    void Clear( void )
+    {
+        for (Shard& S : m_Shards)
+        {
+            std::lock_guard<std::mutex> Guard(S.Mutex);
+            S.Entries.clear();
+        }
+    }
+
+    size_t GetShardSize( size_t Index )
+    {
+        std::lock_guard<std::mutex> Guard(m_Shards[Index].Mutex);
+        return m_Shards[Index].Entries.size();
+    }
+
+private:
+
+    struct Entry
+    {
+        std::wstring Key;
+        std::unique_ptr<T> Value;
+    };
+
+    struct Shard
+    {
+        std::mutex Mutex;
+        std::unordered_multimap<size_t, Entry> Entries;
+    };
+
+    Shard m_Shards[ShardCount];
+};
@@ -25,11 +25,11 @@
 #include "CompiledShaders/TextAntialiasPS.h"
 #include "CompiledShaders/TextShadowPS.h"
 #include "Fonts/consola24.h"
+#include <algorithm>
 #include <map>
 #include <string>
 #include <cstdio>
 #include <memory>
-#include <malloc.h>
 
 using namespace Graphics;
 using namespace Math;
@@ -37,7 +37,7 @@ using namespace std;
 
 namespace TextRenderer
 {
-    class Font
+    class Font : public GlyphTable
     {
     public:
         Font()
@@ -46,18 +46,12 @@ namespace TextRenderer
             m_NormalizeYCoord = 0.0f;
             m_FontLineSpacing = 0.0f;
             m_AntialiasRange = 0.0f;
-            m_FontHeight = 0;
             m_BorderSize = 0;
             m_TextureWidth = 0;
             m_TextureHeight = 0;
         }
 
-        ~Font()
-        {
-            m_Dictionary.clear();
-        }
-
-        void LoadFromBinary( const wchar_t* fontName, const uint8_t* pBinary, const size_t binarySize )
+        void LoadFromBinary( const wchar_t* fontName, const uint8_t* pBinary, const size_t binarySize, bool CreateTexture = true )
         {
             (fontName);
 
@@ -81,7 +75,6 @@ namespace TextRenderer
             FontHeader* header = (FontHeader*)pBinary;
             m_NormalizeXCoord = 1.0f / (header->textureWidth * 16);
             m_NormalizeYCoord = 1.0f / (header->textureHeight * 16);
-            m_FontHeight = header->fontHeight;
             m_FontLineSpacing = (float)header->advanceY / (float)header->fontHeight;
             m_BorderSize = header->borderSize * 16;
             m_AntialiasRange = (float)header->searchDist / header->fontHeight;
@@ -89,19 +82,21 @@ namespace TextRenderer
             uint16_t textureHeight = header->textureHeight;
             uint16_t NumGlyphs = header->numGlyphs;
 
-            const wchar_t* wcharList = (wchar_t*)(pBinary + sizeof(FontHeader));
+            const uint16_t* wcharList = (uint16_t*)(pBinary + sizeof(FontHeader));
             const Glyph* glyphData = (Glyph*)(wcharList + NumGlyphs);
             const void* texelData = glyphData + NumGlyphs;
 
-            for (uint16_t i = 0; i < NumGlyphs; ++i)
-                m_Dictionary[wcharList[i]] = glyphData[i];
+            Build( wcharList, glyphData, NumGlyphs, header->fontHeight );
 
-            m_Texture.Create( textureWidth, textureHeight, DXGI_FORMAT_R8_SNORM, texelData );
+            m_TextureWidth = textureWidth;
+            m_TextureHeight = textureHeight;
+            if (CreateTexture)
+                m_Texture.Create( textureWidth, textureHeight, DXGI_FORMAT_R8_SNORM, texelData );
 
             DEBUGPRINT( "Loaded SDF font:  %ls (ver. %d.%d)", fontName, header->majorVersion, header->minorVersion);
         }
 
-        bool Load( const wstring& fileName )
+        bool Load( const wstring& fileName, bool CreateTexture = true )
         {
             Utility::ByteArray ba = Utility::ReadFileSync( fileName );
 
@@ -111,28 +106,11 @@ namespace TextRenderer
                 return false;
             }
 
-            LoadFromBinary( fileName.c_str(), ba->data(), ba->size() );
+            LoadFromBinary( fileName.c_str(), ba->data(), ba->size(), CreateTexture );
 
             return true;
         }
 
-        // Each character has an XY start offset, a width, and they all share the same height
-        struct Glyph
-        {
-            uint16_t x, y, w;
-            int16_t bearing;
-            uint16_t advance;
-        };
-
-        const Glyph* GetGlyph( wchar_t ch ) const
-        {
-            auto it = m_Dictionary.find( ch );
-            return it == m_Dictionary.end() ? nullptr : &it->second;
-        }
-
-        // Get the texel height of the font in 12.4 fixed point
-        uint16_t GetHeight( void ) const { return m_FontHeight; }
-
         // Get the size of the border in 12.4 fixed point
         uint16_t GetBorderSize( void ) const { return m_BorderSize; }
 
@@ -149,36 +127,22 @@ namespace TextRenderer
         // in screen space (according to the specified font size.)
         // The pixel alpha should range from 0 to 1 over the height range 0.5 +/- 0.5 * aaRange.
         float GetAntialiasRange( float size ) const { return Max( 1.0f, size * m_AntialiasRange ); }
+        float GetAntialiasScale( void ) const { return m_AntialiasRange; }
 
     private:
+
         float m_NormalizeXCoord;
         float m_NormalizeYCoord;
         float m_FontLineSpacing;
         float m_AntialiasRange;
-        uint16_t m_FontHeight;
         uint16_t m_BorderSize;
         uint16_t m_TextureWidth;
         uint16_t m_TextureHeight;
         Texture m_Texture;
-        map<wchar_t, Glyph> m_Dictionary;
     };
 
     map< wstring, unique_ptr<Font> > LoadedFonts;
-
-    const Font* GetOrLoadFont(const wstring& filename)
-    {
-        auto fontIter = LoadedFonts.find( filename );
-        if (fontIter != LoadedFonts.end())
-            return fontIter->second.get();
-
-        Font* newFont = new Font();
-        if (filename == L"default")
-            newFont->LoadFromBinary(L"default", g_pconsola24, sizeof(g_pconsola24));
-        else
-            newFont->Load(L"Fonts/" + filename + L".fnt");
-        LoadedFonts[filename].reset(newFont);
-        return newFont;
-    }
+    map< wstring, unique_ptr<Font> > LoadedFontTables;	// Fonts loaded without a texture
 
     RootSignature s_RootSignature;
     GraphicsPSO s_TextPSO[2];	// 0: R8G8B8A8_UNORM   1: R11G11B10_FLOAT
@@ -187,6 +151,28 @@ namespace TextRenderer
 
 } // namespace TextRenderer
 
+const TextRenderer::Font* TextRenderer::GetOrLoadFont( const wstring& filename, bool CreateTexture )
+{
+    auto& Fonts = CreateTexture ? LoadedFonts : LoadedFontTables;
+
+    auto fontIter = Fonts.find( filename );
+    if (fontIter != Fonts.end())
+        return fontIter->second.get();
+
+    Font* newFont = new Font();
+    if (filename == L"default")
+        newFont->LoadFromBinary(L"default", g_pconsola24, sizeof(g_pconsola24), CreateTexture);
+    else
+        newFont->Load(L"Fonts/" + filename + L".fnt", CreateTexture);
+    Fonts[filename].reset(newFont);
+    return newFont;
+}
+
+const TextRenderer::GlyphTable& TextRenderer::GetGlyphTable( const Font& font )
+{
+    return font;
+}
+
 void TextRenderer::Initialize( void )
 {
     s_RootSignature.Reset(3, 1);
@@ -200,7 +186,9 @@ void TextRenderer::Initialize( void )
     D3D12_INPUT_ELEMENT_DESC vertElem[] =
     {
         { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT     , 0, 0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R16G16B16A16_UINT, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 }
+        { "TEXCOORD", 0, DXGI_FORMAT_R16G16B16A16_UINT, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "TEXCOORD", 1, DXGI_FORMAT_R32_FLOAT        , 0, 16, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "COLOR"   , 0, DXGI_FORMAT_R8G8B8A8_UNORM   , 0, 20, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 }
     };
 
     s_TextPSO[0].SetRootSignature(s_RootSignature);
@@ -230,6 +218,7 @@ void TextRenderer::Initialize( void )
 void TextRenderer::Shutdown( void )
 {
     LoadedFonts.clear();
+    LoadedFontTables.clear();
 }
 
 TextContext::TextContext( GraphicsContext& CmdContext, float ViewWidth, float ViewHeight )
@@ -237,6 +226,10 @@ TextContext::TextContext( GraphicsContext& CmdContext, float ViewWidth, float Vi
 {
     m_HDR = FALSE;
     m_CurrentFont = nullptr;
+    m_Layout.Glyphs = nullptr;
+    m_Layout.TextSize = 0.0f;
+    m_Layout.LineHeight = 0.0f;
+    m_NumBatchedGlyphs = 0;
     m_ViewWidth = ViewWidth;
     m_ViewHeight = ViewHeight;
 
@@ -254,15 +247,23 @@ TextContext::TextContext( GraphicsContext& CmdContext, float ViewWidth, float Vi
     ResetSettings();
 }
 
+TextContext::~TextContext()
+{
+    // Text drawn after the last End() still belongs on screen
+    Flush();
+}
+
 void TextContext::ResetSettings( void )
 {
+    Flush();
+
     m_EnableShadow = true;
     ResetCursor(0.0f, 0.0f);
     m_ShadowOffsetX = 0.05f;
     m_ShadowOffsetY = 0.05f;
     m_PSParams.ShadowHardness = 0.5f;
     m_PSParams.ShadowOpacity = 1.0f;
-    m_PSParams.TextColor = Color(1.0f, 1.0f, 1.0f, 1.0f);
+    m_Layout.Color = Color(1.0f, 1.0f, 1.0f, 1.0f).R8G8B8A8();
 
     m_VSConstantBufferIsStale = true;
     m_PSConstantBufferIsStale = true;
@@ -271,20 +272,20 @@ void TextContext::ResetSettings( void )
     SetFont( L"default", 24.0f );
 }
 
-void  TextContext::SetLeftMargin( float x ) { m_LeftMargin = x; }
-void  TextContext::SetCursorX( float x ) { m_TextPosX = x; }
-void  TextContext::SetCursorY( float y ) { m_TextPosY = y; }
-void  TextContext::NewLine( void ) { m_TextPosX = m_LeftMargin; m_TextPosY += m_LineHeight; }
-float TextContext::GetLeftMargin( void ) { return m_LeftMargin; }
-float TextContext::GetCursorX( void ) { return m_TextPosX; }
-float TextContext::GetCursorY( void ) { return m_TextPosY; }
+void  TextContext::SetLeftMargin( float x ) { m_Layout.LeftMargin = x; }
+void  TextContext::SetCursorX( float x ) { m_Layout.TextPosX = x; }
+void  TextContext::SetCursorY( float y ) { m_Layout.TextPosY = y; }
+void  TextContext::NewLine( void ) { m_Layout.TextPosX = m_Layout.LeftMargin; m_Layout.TextPosY += m_Layout.LineHeight; }
+float TextContext::GetLeftMargin( void ) { return m_Layout.LeftMargin; }
+float TextContext::GetCursorX( void ) { return m_Layout.TextPosX; }
+float TextContext::GetCursorY( void ) { return m_Layout.TextPosY; }
 
 
 void TextContext::ResetCursor(float x, float y)
 {
-    m_LeftMargin = x;
-    m_TextPosX = x;
-    m_TextPosY = y;
+    m_Layout.LeftMargin = x;
+    m_Layout.TextPosX = x;
+    m_Layout.TextPosY = y;
 }
 
 void TextContext::EnableDropShadow(bool enable)
@@ -292,6 +293,8 @@ void TextContext::EnableDropShadow(bool enable)
     if (m_EnableShadow == enable)
         return;
 
+    Flush();
+
     m_EnableShadow = enable;
 
     m_Context.SetPipelineState( m_EnableShadow ? TextRenderer::s_ShadowPSO[m_HDR] : TextRenderer::s_TextPSO[m_HDR] );
@@ -299,6 +302,8 @@ void TextContext::EnableDropShadow(bool enable)
 
 void TextContext::SetShadowOffset(float xPercent, float yPercent)
 {
+    Flush();
+
     m_ShadowOffsetX = xPercent;
     m_ShadowOffsetY = yPercent;
     m_PSParams.ShadowOffsetX = m_CurrentFont->GetHeight() * m_ShadowOffsetX * m_VSParams.NormalizeX;
@@ -308,6 +313,8 @@ void TextContext::SetShadowOffset(float xPercent, float yPercent)
 
 void TextContext::SetShadowParams(float opacity, float width)
 {
+    Flush();
+
     m_PSParams.ShadowHardness = 1.0f / width;
     m_PSParams.ShadowOpacity = opacity;
     m_PSConstantBufferIsStale = true;
@@ -315,13 +322,12 @@ void TextContext::SetShadowParams(float opacity, float width)
 
 void TextContext::SetColor( Color c )
 {
-    m_PSParams.TextColor = c;
-    m_PSConstantBufferIsStale = true;
+    m_Layout.Color = c.R8G8B8A8();
 }
 
 float TextContext::GetVerticalSpacing( void )
 {
-    return m_LineHeight;
+    return m_Layout.LineHeight;
 }
 
 void TextContext::Begin( bool EnableHDR )
@@ -347,22 +353,25 @@ void TextContext::SetFont( const wstring& fontName, float size )
         return;
     }
 
+    // Glyphs already gathered refer to the old font's texture
+    Flush();
+
     m_CurrentFont = NextFont;
+    m_Layout.Glyphs = NextFont;
 
     // Check to see if a new size was specified
     if (size > 0.0f)
-        m_VSParams.TextSize = size;
+        m_Layout.TextSize = size;
 
     // Update constants directly tied to the font or the font size
-    m_LineHeight = NextFont->GetVerticalSpacing( m_VSParams.TextSize );
-    m_VSParams.NormalizeX = m_CurrentFont->GetXNormalizationFactor();
-    m_VSParams.NormalizeY = m_CurrentFont->GetYNormalizationFactor();
-    m_VSParams.Scale = m_VSParams.TextSize / m_CurrentFont->GetHeight();
-    m_VSParams.DstBorder = m_CurrentFont->GetBorderSize() * m_VSParams.Scale;
-    m_VSParams.SrcBorder = m_CurrentFont->GetBorderSize();
-    m_PSParams.ShadowOffsetX = m_CurrentFont->GetHeight() * m_ShadowOffsetX * m_VSParams.NormalizeX;
-    m_PSParams.ShadowOffsetY = m_CurrentFont->GetHeight() * m_ShadowOffsetY * m_VSParams.NormalizeY;
-    m_PSParams.HeightRange = m_CurrentFont->GetAntialiasRange( m_VSParams.TextSize );
+    m_Layout.LineHeight = NextFont->GetVerticalSpacing( m_Layout.TextSize );
+    m_VSParams.NormalizeX = NextFont->GetXNormalizationFactor();
+    m_VSParams.NormalizeY = NextFont->GetYNormalizationFactor();
+    m_VSParams.InvFontHeight = 1.0f / NextFont->GetHeight();
+    m_VSParams.AntialiasRange = NextFont->GetAntialiasScale();
+    m_VSParams.SrcBorder = NextFont->GetBorderSize();
+    m_PSParams.ShadowOffsetX = NextFont->GetHeight() * m_ShadowOffsetX * m_VSParams.NormalizeX;
+    m_PSParams.ShadowOffsetY = NextFont->GetHeight() * m_ShadowOffsetY * m_VSParams.NormalizeY;
     m_VSConstantBufferIsStale = true;
     m_PSConstantBufferIsStale = true;
     m_TextureIsStale = true;
@@ -370,26 +379,22 @@ void TextContext::SetFont( const wstring& fontName, float size )
 
 void TextContext::SetTextSize( float size )
 {
-    if (m_VSParams.TextSize == size)
+    if (m_Layout.TextSize == size)
         return;
 
-    m_VSParams.TextSize = size;
-    m_VSConstantBufferIsStale = true;
+    // The size is stored with each glyph, so there are no constants to update
+    m_Layout.TextSize = size;
 
     if (m_CurrentFont != nullptr)
-    {
-        m_PSParams.HeightRange = m_CurrentFont->GetAntialiasRange( m_VSParams.TextSize );
-        m_VSParams.Scale = m_VSParams.TextSize / m_CurrentFont->GetHeight();
-        m_VSParams.DstBorder = m_CurrentFont->GetBorderSize() * m_VSParams.Scale;
-        m_PSConstantBufferIsStale = true;
-        m_LineHeight = m_CurrentFont->GetVerticalSpacing( size );
-    }
+        m_Layout.LineHeight = m_CurrentFont->GetVerticalSpacing( size );
     else
-        m_LineHeight = 0.0f;
+        m_Layout.LineHeight = 0.0f;
 }
 
 void TextContext::SetViewSize( float ViewWidth, float ViewHeight )
 {
+    Flush();
+
     m_ViewWidth = ViewWidth;
     m_ViewHeight = ViewHeight;
 
@@ -405,6 +410,8 @@ void TextContext::SetViewSize( float ViewWidth, float ViewHeight )
 
 void TextContext::End( void )
 {
+    Flush();
+
     m_VSConstantBufferIsStale = true;
     m_PSConstantBufferIsStale = true;
     m_TextureIsStale = true;
@@ -434,92 +441,38 @@ void TextContext::SetRenderState( void )
 }
 
 // These are made with templates to handle char and wchar_t simultaneously.
-UINT TextContext::FillVertexBuffer( TextVert volatile* verts, const char* str, size_t stride, size_t slen )
+TextRenderer::TextVert* TextContext::ReserveGlyphs( size_t Count )
 {
-    UINT charsDrawn = 0;
+    // SetDynamicVB copies whole 16-byte blocks, so keep a spare vertex past the end for it to read
+    size_t Needed = m_NumBatchedGlyphs + Count + 1;
+    if (Needed > m_Batch.size())
+        m_Batch.resize(std::max(Needed, m_Batch.size() * 2));
 
-    const float UVtoPixel = m_VSParams.Scale;
-
-    float curX = m_TextPosX;
-    float curY = m_TextPosY;
-
-    const uint16_t texelHeight = m_CurrentFont->GetHeight();
-
-    const char* iter = str;
-    for (size_t i = 0; i < slen; ++i)
-    {
-        wchar_t wc = (stride == 2 ? *(wchar_t*)iter : *iter);
-        iter += stride;
-
-        // Terminate on null character (this really shouldn't happen with string or wstring)
-        if (wc == L'\0')
-            break;
-
-        // Handle newlines by inserting a carriage return and line feed
-        if (wc == L'\n')
-        {
-            curX = m_LeftMargin;
-            curY += m_LineHeight;
-            continue;
-        }
-
-        const TextRenderer::Font::Glyph* gi = m_CurrentFont->GetGlyph(wc);
-
-        // Ignore missing characters
-        if (nullptr == gi)
-            continue;
-
-        verts->X = curX + (float)gi->bearing * UVtoPixel;
-        verts->Y = curY;
-        verts->U = gi->x;
-        verts->V = gi->y;
-        verts->W = gi->w;
-        verts->H = texelHeight;
-        ++verts;
+    return m_Batch.data() + m_NumBatchedGlyphs;
+}
 
-        // Advance the cursor position
-        curX += (float)gi->advance * UVtoPixel;
-        ++charsDrawn;
-    }
+void TextContext::Flush( void )
+{
+    if (m_NumBatchedGlyphs == 0)
+        return;
 
-    m_TextPosX = curX;
-    m_TextPosY = curY;
+    SetRenderState();
 
-    return charsDrawn;
+    m_Context.SetDynamicVB(0, m_NumBatchedGlyphs, sizeof(TextRenderer::TextVert), m_Batch.data());
+    m_Context.DrawInstanced( 4, (UINT)m_NumBatchedGlyphs );
+    m_NumBatchedGlyphs = 0;
 }
 
 void TextContext::DrawString( const std::wstring& str )
 {
-    SetRenderState();
-
-    void* stackMem = _malloca((str.size() + 1) * 16);
-    TextVert* vbPtr = Math::AlignUp((TextVert*)stackMem, 16);
-    UINT primCount = FillVertexBuffer(vbPtr, (char*)str.c_str(), 2, str.size());
-
-    if (primCount > 0)
-    {
-        m_Context.SetDynamicVB(0, primCount, sizeof(TextVert), vbPtr);
-        m_Context.DrawInstanced( 4, primCount );
-    }
-
-    _freea(stackMem);
+    TextRenderer::TextVert* vbPtr = ReserveGlyphs(str.size());
+    m_NumBatchedGlyphs += m_Layout.FillVertexBuffer(vbPtr, (char*)str.c_str(), sizeof(wchar_t), str.size());
 }
 
 void TextContext::DrawString( const std::string& str )
 {
-    SetRenderState();
-
-    void* stackMem = _malloca((str.size() + 1) * 16);
-    TextVert* vbPtr = Math::AlignUp((TextVert*)stackMem, 16);
-    UINT primCount = FillVertexBuffer(vbPtr, (char*)str.c_str(), 1, str.size());
-
-    if (primCount > 0)
-    {
-        m_Context.SetDynamicVB(0, primCount, sizeof(TextVert), vbPtr);
-        m_Context.DrawInstanced( 4, primCount );
-    }
-
-    _freea(stackMem);
+    TextRenderer::TextVert* vbPtr = ReserveGlyphs(str.size());
+    m_NumBatchedGlyphs += m_Layout.FillVertexBuffer(vbPtr, (char*)str.c_str(), 1, str.size());
 }
 
 void TextContext::DrawFormattedString( const wchar_t* format, ... )
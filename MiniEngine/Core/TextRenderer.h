@@ -15,7 +15,9 @@
 
 #include "Color.h"
 #include "Math/Vector.h"
+#include "GlyphTable.h"
 #include <string>
+#include <vector>
 
 class Color;
 class GraphicsContext;
@@ -31,12 +33,20 @@ namespace TextRenderer
     void Shutdown( void );
 
     class Font;
+
+    // Find a font by name, loading it from the Fonts folder on first use.  A font loaded without its
+    // texture can lay out text but not draw it, which is all a headless tool needs.
+    const Font* GetOrLoadFont( const std::wstring& fontName, bool CreateTexture = true );
+
+    // The glyphs of a font, for laying out text with a GlyphLayout
+    const GlyphTable& GetGlyphTable( const Font& font );
 }
 
 class TextContext
 {
 public:
     TextContext( GraphicsContext& CmdContext, float CanvasWidth = 1920.0f, float CanvasHeight = 1080.0f );
+    ~TextContext();
 
     GraphicsContext& GetCommandContext() const { return m_Context; }
 
@@ -86,10 +96,15 @@ public:
     // Rendering commands
     //
 
-    // Begin and end drawing commands
+    // Begin and end drawing commands.  Strings are gathered into one vertex stream and drawn together
+    // when End() or Flush() is called, or when a font, shadow, or view change requires it.
     void Begin( bool EnableHDR = false );
     void End( void );
 
+    // Draw the text gathered so far.  Call this before drawing anything else with the command context
+    // or changing its viewport or scissor.
+    void Flush( void );
+
     // Draw a string
     void DrawString( const std::wstring& str );
     void DrawString( const std::string& str );
@@ -104,45 +119,33 @@ private:
     __declspec(align(16)) struct VertexShaderParams
     {
         Math::Vector4 ViewportTransform;
-        float NormalizeX, NormalizeY, TextSize;
-        float Scale, DstBorder;
+        float NormalizeX, NormalizeY;
+        float InvFontHeight;		// Text size to texel scale
+        float AntialiasRange;		// Distance field range per unit of text size
         uint32_t SrcBorder;
     };
 
     __declspec(align(16)) struct PixelShaderParams
     {
-        Color TextColor;
         float ShadowOffsetX, ShadowOffsetY;
         float ShadowHardness;		// More than 1 will cause aliasing
         float ShadowOpacity;		// Should make less opaque when making softer
-        float HeightRange;
     };
 
     void SetRenderState(void);
-
-    // 16 Byte structure to represent an entire glyph in the text vertex buffer
-    __declspec(align(16)) struct TextVert
-    {
-        float X, Y;				// Upper-left glyph position in screen space
-        uint16_t U, V, W, H;	// Upper-left glyph UV and the width in texture space
-    };
-
-    UINT FillVertexBuffer( TextVert volatile* verts, const char* str, size_t stride, size_t slen );
-    void DrawStringInternal( const std::string& str );
-    void DrawStringInternal( const std::wstring& str );
+    TextRenderer::TextVert* ReserveGlyphs( size_t Count );
 
     GraphicsContext& m_Context;
     const TextRenderer::Font* m_CurrentFont;
+    TextRenderer::GlyphLayout m_Layout;
+    std::vector<TextRenderer::TextVert> m_Batch;	// Glyphs waiting for the next Flush()
+    size_t m_NumBatchedGlyphs;
     VertexShaderParams m_VSParams;
     PixelShaderParams m_PSParams;
     bool m_VSConstantBufferIsStale;	// Tracks when the CB needs updating
     bool m_PSConstantBufferIsStale;	// Tracks when the CB needs updating
     bool m_TextureIsStale;
     bool m_EnableShadow;
-    float m_LeftMargin;
-    float m_TextPosX;
-    float m_TextPosY;
-    float m_LineHeight;
     float m_ViewWidth;				// Width of the drawable area
     float m_ViewHeight;				// Height of the drawable area
     float m_ShadowOffsetX;			// Percentage of the font's TextSize should the shadow be offset
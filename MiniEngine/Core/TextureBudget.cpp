@@ -0,0 +1,147 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Built without the precompiled header so it has no dependency on Windows
+#include "TextureBudget.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+TextureBudget::TextureBudget()
+    : m_BudgetBytes(0), m_ResidentBytes(0), m_FullBytes(0), m_MaxChangesPerFrame(8)
+{
+}
+
+TextureBudget::Handle TextureBudget::Register( const uint64_t* MipBytes, uint32_t MipCount, uint32_t MinResidentMips )
+{
+    assert(MipCount > 0 && MipCount <= kMaxMips && "Unsupported mip count");
+
+    Handle NewHandle;
+    if (m_FreeList.empty())
+    {
+        NewHandle = (Handle)m_Entries.size();
+        m_Entries.emplace_back();
+    }
+    else
+    {
+        NewHandle = m_FreeList.back();
+        m_FreeList.pop_back();
+    }
+
+    Entry& E = m_Entries[NewHandle];
+    for (uint32_t i = 0; i < MipCount; ++i)
+        E.MipBytes[i] = MipBytes[i];
+    E.MipCount = MipCount;
+    E.MaxSkipMips = MipCount > MinResidentMips ? MipCount - MinResidentMips : 0;
+    E.SkipMips = 0;
+    E.LastUsedFrame = 0;
+    E.InUse = true;
+
+    uint64_t Bytes = BytesForSkip(E, 0);
+    m_ResidentBytes += Bytes;
+    m_FullBytes += Bytes;
+
+    return NewHandle;
+}
+
+void TextureBudget::Unregister( Handle Texture )
+{
+    if (Texture == kInvalidHandle)
+        return;
+
+    Entry& E = m_Entries[Texture];
+    assert(E.InUse && "Texture is not registered");
+
+    m_ResidentBytes -= BytesForSkip(E, E.SkipMips);
+    m_FullBytes -= BytesForSkip(E, 0);
+    E.InUse = false;
+
+    m_FreeList.push_back(Texture);
+}
+
+void TextureBudget::MarkUsed( Handle Texture, uint64_t Frame )
+{
+    if (Texture != kInvalidHandle && m_Entries[Texture].LastUsedFrame < Frame)
+        m_Entries[Texture].LastUsedFrame = Frame;
+}
+
+uint64_t TextureBudget::BytesForSkip( const Entry& E, uint32_t SkipMips ) const
+{
+    uint64_t Bytes = 0;
+    for (uint32_t i = SkipMips; i < E.MipCount; ++i)
+        Bytes += E.MipBytes[i];
+    return Bytes;
+}
+
+uint64_t TextureBudget::GetResidentBytes( Handle Texture ) const
+{
+    const Entry& E = m_Entries[Texture];
+    return BytesForSkip(E, E.SkipMips);
+}
+
+void TextureBudget::Update( vector<Change>& Changes )
+{
+    uint32_t ChangesLeft = m_MaxChangesPerFrame == 0 ? 0xFFFFFFFF : m_MaxChangesPerFrame;
+
+    m_SortScratch.clear();
+    for (Handle i = 0; i < (Handle)m_Entries.size(); ++i)
+    {
+        if (m_Entries[i].InUse)
+            m_SortScratch.push_back(i);
+    }
+
+    // Least recently used first
+    sort(m_SortScratch.begin(), m_SortScratch.end(), [this]( Handle A, Handle B )
+    {
+        return m_Entries[A].LastUsedFrame < m_Entries[B].LastUsedFrame;
+    });
+
+    if (m_BudgetBytes > 0 && m_ResidentBytes > m_BudgetBytes)
+    {
+        // Over budget:  drop as many top mips as needed from the stalest textures
+        for (auto Iter = m_SortScratch.begin(); Iter != m_SortScratch.end() && ChangesLeft > 0; ++Iter)
+        {
+            if (m_ResidentBytes <= m_BudgetBytes)
+                break;
+
+            Entry& E = m_Entries[*Iter];
+            uint32_t NewSkip = E.SkipMips;
+            uint64_t Resident = m_ResidentBytes;
+            while (NewSkip < E.MaxSkipMips && Resident > m_BudgetBytes)
+                Resident -= E.MipBytes[NewSkip++];
+
+            if (NewSkip != E.SkipMips)
+            {
+                m_ResidentBytes = Resident;
+                E.SkipMips = NewSkip;
+                Changes.push_back({ *Iter, NewSkip });
+                --ChangesLeft;
+            }
+        }
+    }
+    else
+    {
+        // Within budget:  restore the most recently used textures as far as the budget allows
+        for (auto Iter = m_SortScratch.rbegin(); Iter != m_SortScratch.rend() && ChangesLeft > 0; ++Iter)
+        {
+            Entry& E = m_Entries[*Iter];
+            uint32_t NewSkip = E.SkipMips;
+            while (NewSkip > 0 && (m_BudgetBytes == 0 || m_ResidentBytes + E.MipBytes[NewSkip - 1] <= m_BudgetBytes))
+                m_ResidentBytes += E.MipBytes[--NewSkip];
+
+            if (NewSkip != E.SkipMips)
+            {
+                E.SkipMips = NewSkip;
+                Changes.push_back({ *Iter, NewSkip });
+                --ChangesLeft;
+            }
+        }
+    }
+}
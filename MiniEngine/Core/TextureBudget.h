@@ -0,0 +1,83 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Bookkeeping for keeping texture memory within a budget.  Each registered texture reports
+// the size of its mip levels and the frame it was last referenced on.  Once per frame, Update() decides
+// how many top mips each texture should drop (least recently used first) or restore (most recently used
+// first) so that the resident total stays within the budget.  The class never touches a device; the
+// TextureManager applies the decisions by recreating the affected textures.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class TextureBudget
+{
+public:
+
+    typedef uint32_t Handle;
+    static const Handle kInvalidHandle = 0xFFFFFFFF;
+
+    struct Change
+    {
+        Handle Texture;
+        uint32_t SkipMips;
+    };
+
+    TextureBudget();
+
+    // MipBytes[i] is the size of mip i summed over all array slices.  The last MinResidentMips levels
+    // (the mip tail) are never dropped.
+    Handle Register( const uint64_t* MipBytes, uint32_t MipCount, uint32_t MinResidentMips = 1 );
+    void Unregister( Handle Texture );
+
+    void MarkUsed( Handle Texture, uint64_t Frame );
+
+    // A budget of 0 means unlimited, in which case every texture is restored to full resolution.
+    void SetBudget( uint64_t BudgetBytes ) { m_BudgetBytes = BudgetBytes; }
+    uint64_t GetBudget( void ) const { return m_BudgetBytes; }
+
+    // Limits how many textures change per frame, since every change means a texture upload
+    void SetMaxChangesPerFrame( uint32_t MaxChanges ) { m_MaxChangesPerFrame = MaxChanges; }
+
+    // Appends the textures whose resident mip count should change this frame.  The returned SkipMips
+    // are already committed to the accounting.
+    void Update( std::vector<Change>& Changes );
+
+    uint32_t GetSkipMips( Handle Texture ) const { return m_Entries[Texture].SkipMips; }
+    uint64_t GetResidentBytes( Handle Texture ) const;
+    uint64_t GetTotalResidentBytes( void ) const { return m_ResidentBytes; }
+    uint64_t GetTotalFullBytes( void ) const { return m_FullBytes; }
+    uint32_t GetTextureCount( void ) const { return (uint32_t)(m_Entries.size() - m_FreeList.size()); }
+
+private:
+
+    enum { kMaxMips = 16 };
+
+    struct Entry
+    {
+        uint64_t MipBytes[kMaxMips];
+        uint32_t MipCount;
+        uint32_t MaxSkipMips;
+        uint32_t SkipMips;
+        uint64_t LastUsedFrame;
+        bool InUse;
+    };
+
+    uint64_t BytesForSkip( const Entry& E, uint32_t SkipMips ) const;
+
+    std::vector<Entry> m_Entries;
+    std::vector<Handle> m_FreeList;
+    std::vector<Handle> m_SortScratch;
+
+    uint64_t m_BudgetBytes;
+    uint64_t m_ResidentBytes;
+    uint64_t m_FullBytes;
+    uint32_t m_MaxChangesPerFrame;
+};
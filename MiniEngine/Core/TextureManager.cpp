@@ -16,10 +16,12 @@
 #include "TextureManager.h"
 #include "FileUtility.h"
 #include "DDSTextureLoader.h"
+#include "DDSLayout.h"
 #include "GraphicsCore.h"
 #include "CommandContext.h"
-#include <map>
-#include <thread>
+#include "CommandListManager.h"
+#include "ShardedCache.h"
+#include <queue>
 
 #include <iostream>
 
@@ -154,9 +156,50 @@ void Texture::CreatePIXImageFromMemory( const void* memBuffer, size_t fileSize )
 namespace TextureManager
 {
     wstring s_RootPath = L"";
-    map< wstring, unique_ptr<ManagedTexture> > s_TextureCache;
 	bool s_reportError = false;
 
+    // Loader threads only lock the shard owning the path they look up
+    ShardedCache<ManagedTexture> s_TextureCache;
+
+    // A budget of 0 keeps every texture at full resolution
+    IntVar MemoryBudgetMB("Graphics/Textures/Memory Budget (MB)", 0, 0, 16384, 64);
+    IntVar MaxResidencyChanges("Graphics/Textures/Max Changes Per Frame", 8, 1, 64, 1);
+
+    // A texture recreated by ManagedTexture::SetSkipMips() on a loader thread, waiting for Update()
+    struct CompletedReload
+    {
+        ManagedTexture* Texture;
+        TextureBudget::Handle BudgetHandle;
+        uint32_t Serial;
+        Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+        D3D12_CPU_DESCRIPTOR_HANDLE SRV;
+    };
+
+    // Guards s_Budget, s_BudgetedTextures (indexed by budget handle), s_CompletedReloads and
+    // s_RetiredResources, which loader threads reach as well as the main thread
+    mutex s_BudgetMutex;
+    TextureBudget s_Budget;
+    vector<ManagedTexture*> s_BudgetedTextures;
+    vector<CompletedReload> s_CompletedReloads;
+
+    // Replaced texture resources may still be referenced by in-flight command lists
+    queue< pair<uint64_t, Microsoft::WRL::ComPtr<ID3D12Resource> > > s_RetiredResources;
+
+    // Only touched by Update() on the main thread
+    vector<TextureBudget::Change> s_BudgetChanges;
+    vector<ManagedTexture*> s_ChangedTextures;
+    vector<CompletedReload> s_AppliedReloads;
+    uint32_t s_NextReloadSerial = 0;
+
+    void RetireResource( Microsoft::WRL::ComPtr<ID3D12Resource>& Resource )
+    {
+        if (Resource == nullptr)
+            return;
+
+        lock_guard<mutex> Guard(s_BudgetMutex);
+        s_RetiredResources.emplace(g_CommandManager.GetGraphicsQueue().GetNextFenceValue(), move(Resource));
+    }
+
     void Initialize( const std::wstring& TextureLibRoot )
     {
         s_RootPath = TextureLibRoot;
@@ -164,29 +207,103 @@ namespace TextureManager
 
     void Shutdown( void )
     {
-        s_TextureCache.clear();
+        s_TextureCache.Clear();
+        lock_guard<mutex> Guard(s_BudgetMutex);
+        s_BudgetedTextures.clear();
+        s_Budget = TextureBudget();
+        s_CompletedReloads.clear();
+        s_RetiredResources = decltype(s_RetiredResources)();
     }
 
 	void ReportLoadErrors(bool enable) {
 		s_reportError = enable;
 	}
 
+    void Update( void )
+    {
+        s_BudgetChanges.clear();
+        s_ChangedTextures.clear();
+        s_AppliedReloads.clear();
+        {
+            lock_guard<mutex> Guard(s_BudgetMutex);
+
+            while (!s_RetiredResources.empty() && g_CommandManager.IsFenceComplete(s_RetiredResources.front().first))
+                s_RetiredResources.pop();
+
+            // Textures are only unloaded on the main thread, so these stay valid after the lock is released
+            s_AppliedReloads.swap(s_CompletedReloads);
+            for (CompletedReload& Reload : s_AppliedReloads)
+            {
+                if (Reload.BudgetHandle >= s_BudgetedTextures.size() || s_BudgetedTextures[Reload.BudgetHandle] != Reload.Texture)
+                    Reload.Texture = nullptr;
+            }
+
+            // Draws only record the frame on the texture, so hand it to the budget here
+            for (size_t Handle = 0; Handle < s_BudgetedTextures.size(); ++Handle)
+            {
+                if (s_BudgetedTextures[Handle] != nullptr)
+                    s_Budget.MarkUsed((TextureBudget::Handle)Handle, s_BudgetedTextures[Handle]->GetLastUsedFrame());
+            }
+
+            s_Budget.SetBudget((uint64_t)(int32_t)MemoryBudgetMB << 20);
+            s_Budget.SetMaxChangesPerFrame((uint32_t)(int32_t)MaxResidencyChanges);
+            s_Budget.Update(s_BudgetChanges);
+
+            for (auto& Change : s_BudgetChanges)
+                s_ChangedTextures.push_back(s_BudgetedTextures[Change.Texture]);
+        }
+
+        // Reloads of unloaded or since re-requested textures are dropped
+        for (CompletedReload& Reload : s_AppliedReloads)
+        {
+            if (Reload.Texture == nullptr || !Reload.Texture->FinishReload(Reload.Serial, Reload.Resource, Reload.SRV))
+            {
+                RetireResource(Reload.Resource);
+                Graphics::FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, Reload.SRV);
+            }
+        }
+
+        for (size_t i = 0; i < s_BudgetChanges.size(); ++i)
+            s_ChangedTextures[i]->SetSkipMips(s_BudgetChanges[i].SkipMips);
+    }
+
+    void EraseTexture( const ManagedTexture* Tex, size_t KeyHash )
+    {
+        s_TextureCache.Erase(Tex, KeyHash);
+    }
+
+    // If it's found, it has already been loaded or the load process has begun, and the caller must wait
+    // for the load signal before reading it.  Otherwise the caller must read the file and signal it.
     pair<ManagedTexture*, bool> FindOrLoadTexture( const wstring& fileName )
     {
-        static mutex s_Mutex;
-        lock_guard<mutex> Guard(s_Mutex);
+        const size_t KeyHash = s_TextureCache.HashKey(fileName);
+        return s_TextureCache.FindOrCreate(fileName, KeyHash,
+            [&]() { return new ManagedTexture(fileName, KeyHash); });
+    }
 
-        auto iter = s_TextureCache.find(fileName);
+    bool LoadDDSInto( ManagedTexture& Tex, const wstring& fileName, bool sRGB )
+    {
+        Utility::ByteArray ba = Utility::ReadFileSync( s_RootPath + fileName );
+        if (ba->size() == 0 || !Tex.CreateBudgetedDDSFromMemory( ba->data(), ba->size(), sRGB ))
+            return false;
 
-        // If it's found, it has already been loaded or the load process has begun
-        if (iter != s_TextureCache.end())
-            return make_pair(iter->second.get(), false);
+        Tex.GetResource()->SetName(fileName.c_str());
+        return true;
+    }
 
-        ManagedTexture* NewTexture = new ManagedTexture(fileName);
-        s_TextureCache[fileName].reset( NewTexture );
+    bool LoadTGAInto( ManagedTexture& Tex, const wstring& fileName, bool sRGB )
+    {
+        Utility::ByteArray ba = Utility::ReadFileSync( s_RootPath + fileName );
+        if (ba->size() == 0)
+        {
+            if (s_reportError)
+                std::wcout << L"Failed to load asset: " << s_RootPath << fileName << std::endl;
+            return false;
+        }
 
-        // This was the first time it was requested, so indicate that the caller must read the file
-        return make_pair(NewTexture, true);
+        Tex.CreateTGAFromMemory( ba->data(), ba->size(), sRGB );
+        Tex.GetResource()->SetName(fileName.c_str());
+        return true;
     }
 
     const Texture& GetBlackTex2D(void)
@@ -204,6 +321,7 @@ namespace TextureManager
 
         uint32_t BlackPixel = 0;
         ManTex->Create(1, 1, DXGI_FORMAT_R8G8B8A8_UNORM, &BlackPixel);
+        ManTex->SignalLoaded();
         return *ManTex;
     }
 
@@ -222,6 +340,7 @@ namespace TextureManager
 
         uint32_t WhitePixel = 0xFFFFFFFFul;
         ManTex->Create(1, 1, DXGI_FORMAT_R8G8B8A8_UNORM, &WhitePixel);
+        ManTex->SignalLoaded();
         return *ManTex;
     }
 
@@ -240,25 +359,28 @@ namespace TextureManager
 
         uint32_t MagentaPixel = 0x00FF00FF;
         ManTex->Create(1, 1, DXGI_FORMAT_R8G8B8A8_UNORM, &MagentaPixel);
+        ManTex->SignalLoaded();
         return *ManTex;
     }
 
 } // namespace TextureManager
 
-void ManagedTexture::WaitForLoad( void ) const
-{
-    volatile D3D12_CPU_DESCRIPTOR_HANDLE& VolHandle = (volatile D3D12_CPU_DESCRIPTOR_HANDLE&)m_hCpuDescriptorHandle;
-    volatile bool& VolValid = (volatile bool&)m_IsValid;
-    while (VolHandle.ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN && VolValid)
-        this_thread::yield();
-}
-
 void ManagedTexture::SetToInvalidTexture( void )
 {
+    // The magenta texture's descriptor is shared, so give back any we allocated ourselves
+    if (m_IsValid)
+        Graphics::FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_hCpuDescriptorHandle);
+
     m_hCpuDescriptorHandle = TextureManager::GetMagentaTex2D().GetSRV();
     m_IsValid = false;
 }
 
+void ManagedTexture::SetToFallbackTexture( const ManagedTexture& Fallback )
+{
+    SetToInvalidTexture();
+    m_hCpuDescriptorHandle = Fallback.GetSRV();
+}
+
 const ManagedTexture* TextureManager::LoadFromFile( const std::wstring& fileName, bool sRGB )
 {
     std::wstring CatPath = fileName;
@@ -286,12 +408,10 @@ const ManagedTexture* TextureManager::LoadDDSFromFile( const std::wstring& fileN
         return ManTex;
     }
 
-    Utility::ByteArray ba = Utility::ReadFileSync( s_RootPath + fileName );
-    if (ba->size() == 0 || !ManTex->CreateDDSFromMemory( ba->data(), ba->size(), sRGB ))
+    if (!LoadDDSInto(*ManTex, fileName, sRGB))
         ManTex->SetToInvalidTexture();
-    else
-        ManTex->GetResource()->SetName(fileName.c_str());
 
+    ManTex->SignalLoaded();
     return ManTex;
 }
 
@@ -307,18 +427,35 @@ const ManagedTexture* TextureManager::LoadTGAFromFile( const std::wstring& fileN
         ManTex->WaitForLoad();
         return ManTex;
     }
-	
-	Utility::ByteArray ba = Utility::ReadFileSync(s_RootPath + fileName);
-    if (ba->size() > 0)
+
+    if (!LoadTGAInto(*ManTex, fileName, sRGB))
+        ManTex->SetToInvalidTexture();
+
+    ManTex->SignalLoaded();
+    return ManTex;
+}
+
+const ManagedTexture* TextureManager::LoadFromFileAsync( const std::wstring& fileName, bool sRGB )
+{
+    // Shares the cache entry with LoadDDSFromFile() so synchronous and asynchronous requests for the
+    // same texture never load it twice.
+    const std::wstring DDSName = fileName + L".dds";
+    auto ManagedTex = FindOrLoadTexture(DDSName);
+
+    ManagedTexture* ManTex = ManagedTex.first;
+    if (!ManagedTex.second)
+        return ManTex;
+
+    // Like LoadFromFile(), a missing DDS leaves an invalid DDS entry and the TGA is cached under its own
+    // name.  The DDS entry displays the TGA's descriptor, so the returned texture still shows it.
+    const std::wstring TGAName = fileName + L".tga";
+    concurrency::create_task( [ManTex, DDSName, TGAName, sRGB]()
     {
-        ManTex->CreateTGAFromMemory( ba->data(), ba->size(), sRGB );
-        ManTex->GetResource()->SetName(fileName.c_str());
-    }
-	else {
-		if(s_reportError)
-			std::wcout << L"Failed to load asset: " << s_RootPath << fileName << std::endl;
-		ManTex->SetToInvalidTexture();
-	}
+        if (!LoadDDSInto(*ManTex, DDSName, sRGB))
+            ManTex->SetToFallbackTexture(*LoadTGAFromFile(TGAName, sRGB));
+
+        ManTex->SignalLoaded();
+    });
 
     return ManTex;
 }
@@ -346,5 +483,128 @@ const ManagedTexture* TextureManager::LoadPIXImageFromFile( const std::wstring&
     else
         ManTex->SetToInvalidTexture();
 
+    ManTex->SignalLoaded();
     return ManTex;
 }
+
+bool ManagedTexture::CreateBudgetedDDSFromMemory( const void* memBuffer, size_t fileSize, bool sRGB )
+{
+    DDSTextureLayout Layout;
+    if (FAILED(ParseDDSLayout((const uint8_t*)memBuffer, fileSize, Layout)))
+        return false;
+
+    if (m_hCpuDescriptorHandle.ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
+        m_hCpuDescriptorHandle = AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    HRESULT hr = CreateDDSTextureFromLayout( Graphics::g_Device, Layout, (const uint8_t*)memBuffer, 0, sRGB,
+        &m_pResource, m_hCpuDescriptorHandle );
+    if (FAILED(hr))
+        return false;
+
+    m_sRGB = sRGB;
+
+    // Textures without a mip chain have nothing to drop.  The budget counts file bytes per mip, which
+    // slightly underestimates the placement-aligned size on the GPU.
+    if (Layout.MipCount > 1)
+    {
+        uint64_t MipBytes[D3D12_REQ_MIP_LEVELS] = {};
+        for (uint32_t Item = 0; Item < Layout.ArraySize; ++Item)
+        {
+            for (uint32_t Mip = 0; Mip < Layout.MipCount; ++Mip)
+            {
+                const DDSSubresourceLayout& Sub = Layout.GetSubresource(Item, Mip);
+                MipBytes[Mip] += (uint64_t)Sub.SlicePitch * Sub.Depth;
+            }
+        }
+
+        lock_guard<mutex> Guard(TextureManager::s_BudgetMutex);
+        m_BudgetHandle = TextureManager::s_Budget.Register(MipBytes, Layout.MipCount);
+        if (m_BudgetHandle >= TextureManager::s_BudgetedTextures.size())
+            TextureManager::s_BudgetedTextures.resize(m_BudgetHandle + 1);
+        TextureManager::s_BudgetedTextures[m_BudgetHandle] = this;
+        MarkUsed();
+    }
+
+    return true;
+}
+
+void ManagedTexture::SetSkipMips( uint32_t SkipMips )
+{
+    using namespace TextureManager;
+
+    // Reading the file and uploading the mips happens on the loader threads, like LoadFromFileAsync().
+    // The task only uses its own copies, so the texture may be unloaded before it finishes.
+    m_ReloadSerial = ++s_NextReloadSerial;
+    CompletedReload Reload = { this, m_BudgetHandle, m_ReloadSerial };
+    const wstring FileName = m_MapKey;
+    const bool sRGB = m_sRGB;
+
+    concurrency::create_task( [Reload, FileName, sRGB, SkipMips]() mutable
+    {
+        Utility::ByteArray ba = Utility::ReadFileSync( s_RootPath + FileName );
+
+        DDSTextureLayout Layout;
+        if (ba->size() == 0 || FAILED(ParseDDSLayout(ba->data(), ba->size(), Layout)))
+            return;
+
+        Reload.SRV = AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        HRESULT hr = CreateDDSTextureFromLayout( Graphics::g_Device, Layout, ba->data(), SkipMips, sRGB,
+            &Reload.Resource, Reload.SRV );
+        if (FAILED(hr))
+        {
+            Graphics::FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, Reload.SRV);
+            return;
+        }
+
+        Reload.Resource->SetName(FileName.c_str());
+
+        lock_guard<mutex> Guard(s_BudgetMutex);
+        s_CompletedReloads.push_back(move(Reload));
+    });
+}
+
+bool ManagedTexture::FinishReload( uint32_t Serial, Microsoft::WRL::ComPtr<ID3D12Resource>& Resource, D3D12_CPU_DESCRIPTOR_HANDLE SRV )
+{
+    if (Serial != m_ReloadSerial)
+        return false;
+
+    // The new SRV is copied over the old descriptor, so every copy of the handle sees the new resource
+    Graphics::g_Device->CopyDescriptorsSimple(1, m_hCpuDescriptorHandle, SRV, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    Graphics::FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, SRV);
+
+    TextureManager::RetireResource(m_pResource);
+    m_pResource = move(Resource);
+    return true;
+}
+
+void ManagedTexture::MarkUsed( void ) const
+{
+    if (m_BudgetHandle == TextureBudget::kInvalidHandle)
+        return;
+
+    // Most draws of a frame find the frame already stored, so skip the write and keep the line shared
+    const uint32_t Frame = (uint32_t)Graphics::GetFrameCount();
+    if (m_LastUsedFrame.load(std::memory_order_relaxed) != Frame)
+        m_LastUsedFrame.store(Frame, std::memory_order_relaxed);
+}
+
+void ManagedTexture::Unload( void )
+{
+    // A loader thread may still be writing it
+    WaitForLoad();
+
+    if (m_BudgetHandle != TextureBudget::kInvalidHandle)
+    {
+        lock_guard<mutex> Guard(TextureManager::s_BudgetMutex);
+        TextureManager::s_Budget.Unregister(m_BudgetHandle);
+        TextureManager::s_BudgetedTextures[m_BudgetHandle] = nullptr;
+        m_BudgetHandle = TextureBudget::kInvalidHandle;
+    }
+
+    TextureManager::RetireResource(m_pResource);
+    if (m_IsValid)
+        Graphics::FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_hCpuDescriptorHandle);
+
+    // Deletes this texture
+    TextureManager::EraseTexture(this, m_KeyHash);
+}
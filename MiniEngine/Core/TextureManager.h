@@ -17,6 +17,9 @@
 #include "pch.h"
 #include "GpuResource.h"
 #include "Utility.h"
+#include "TextureBudget.h"
+#include <atomic>
+#include <future>
 
 class Texture : public GpuResource
 {
@@ -56,19 +59,59 @@ protected:
 class ManagedTexture : public Texture
 {
 public:
-    ManagedTexture( const std::wstring& FileName ) : m_MapKey(FileName), m_IsValid(true) {}
+    ManagedTexture( const std::wstring& FileName, size_t KeyHash )
+        : m_MapKey(FileName), m_KeyHash(KeyHash), m_IsValid(true), m_sRGB(false),
+        m_BudgetHandle(TextureBudget::kInvalidHandle), m_ReloadSerial(0), m_LastUsedFrame(0),
+        m_LoadedFuture(m_LoadedPromise.get_future().share()) {}
 
     void operator= ( const Texture& Texture );
 
-    void WaitForLoad(void) const;
+    // Blocks (without spinning) until the thread that requested the load calls SignalLoaded()
+    void WaitForLoad(void) const { m_LoadedFuture.wait(); }
+    bool IsLoaded(void) const { return m_LoadedFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+    void SignalLoaded(void) { m_LoadedPromise.set_value(); }
+
     void Unload(void);
 
     void SetToInvalidTexture(void);
-    bool IsValid(void) const { return m_IsValid; }
+
+    // Marks the texture invalid, but displays Fallback (which stays in the cache under its own name) instead
+    // of the magenta texture
+    void SetToFallbackTexture( const ManagedTexture& Fallback );
+
+    // Whether the file loaded.  Waits for the load, so callers of LoadFromFileAsync() that must not block
+    // should check IsLoaded() first.
+    bool IsValid(void) const { WaitForLoad(); return m_IsValid; }
+
+    const std::wstring& GetFileName(void) const { return m_MapKey; }
+
+    // Like CreateDDSFromMemory(), but registers the texture with the memory budget so that its top mips
+    // can later be dropped and restored by reloading the file.
+    bool CreateBudgetedDDSFromMemory( const void* memBuffer, size_t fileSize, bool sRGB );
+
+    // Starts recreating the texture from its file without the top SkipMips levels on a worker thread.
+    // TextureManager::Update() swaps the new resource in once it is ready.
+    void SetSkipMips( uint32_t SkipMips );
+
+    // Swaps in a resource created by SetSkipMips(), unless a later SetSkipMips() superseded it.  Returns
+    // false when the caller still owns Resource and SRV.
+    bool FinishReload( uint32_t Serial, Microsoft::WRL::ComPtr<ID3D12Resource>& Resource, D3D12_CPU_DESCRIPTOR_HANDLE SRV );
+
+    // Records that the texture is referenced this frame so the memory budget keeps it resident.  Lock-free,
+    // so draws on any thread can call it; TextureManager::Update() hands the frame on to the budget.
+    void MarkUsed(void) const;
+    uint32_t GetLastUsedFrame(void) const { return m_LastUsedFrame.load(std::memory_order_relaxed); }
 
 private:
     std::wstring m_MapKey;		// For deleting from the map later
+    size_t m_KeyHash;
     bool m_IsValid;
+    bool m_sRGB;
+    TextureBudget::Handle m_BudgetHandle;   // Only DDS textures with mips participate in the budget
+    uint32_t m_ReloadSerial;                // The most recent SetSkipMips() request
+    mutable std::atomic<uint32_t> m_LastUsedFrame;
+    std::promise<void> m_LoadedPromise;
+    std::shared_future<void> m_LoadedFuture;
 };
 
 namespace TextureManager
@@ -77,16 +120,29 @@ namespace TextureManager
     void Shutdown(void);
 	void ReportLoadErrors(bool enable);
 
+    // Drops or restores top mips of budgeted textures and releases retired resources.  Call once per frame.
+    void Update(void);
+
     const ManagedTexture* LoadFromFile( const std::wstring& fileName, bool sRGB = false );
     const ManagedTexture* LoadDDSFromFile( const std::wstring& fileName, bool sRGB = false );
     const ManagedTexture* LoadTGAFromFile( const std::wstring& fileName, bool sRGB = false );
     const ManagedTexture* LoadPIXImageFromFile( const std::wstring& fileName );
 
+    // Returns immediately.  The DDS (or TGA fallback) is loaded on a worker thread; use IsLoaded() to poll
+    // or WaitForLoad() to block, and don't read the texture before it is loaded.  The result is shared with
+    // LoadFromFile() requests for the same name.
+    const ManagedTexture* LoadFromFileAsync( const std::wstring& fileName, bool sRGB = false );
+
     inline const ManagedTexture* LoadFromFile( const std::string& fileName, bool sRGB = false )
     {
         return LoadFromFile(MakeWStr(fileName), sRGB);
     }
 
+    inline const ManagedTexture* LoadFromFileAsync( const std::string& fileName, bool sRGB = false )
+    {
+        return LoadFromFileAsync(MakeWStr(fileName), sRGB);
+    }
+
     inline const ManagedTexture* LoadDDSFromFile( const std::string& fileName, bool sRGB = false )
     {
         return LoadDDSFromFile(MakeWStr(fileName), sRGB);
@@ -0,0 +1,327 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "TraceCapture.h"
+#include "SystemTime.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+
+#include "writer.h"
+#include "stringbuffer.h"
+
+#include <iostream>
+#include <fstream>
+
+namespace
+{
+    // Readback of GPU timers trails the CPU by a frame or two, so an automatic capture keeps taking
+    // GPU ranges for a few frames after the last CPU frame.
+    const uint32_t kGpuLatencyFrames = 3;
+
+    // About 150 MB of events.  Whatever comes after is dropped and the trace is marked truncated.
+    const size_t kMaxEvents = 1 << 22;
+
+    // Thread id of the GPU track.  Windows never hands out thread id 0.
+    const uint32_t kGpuThreadId = 0;
+
+    struct Event
+    {
+        double Time;            // Microseconds since the capture started
+        double Duration;        // Complete events only
+        uint32_t NameId;        // Frame index for frame markers
+        uint32_t ThreadId;
+        char Phase;             // 'B', 'E', 'X', or 'i' as in the trace event format
+    };
+
+    struct ScopeName
+    {
+        std::string Name;
+        uint64_t LastGpuStart;
+    };
+
+    // Everything WriteTrace() needs, handed over from the live capture so the file is written without
+    // holding the mutex
+    struct FinishedTrace
+    {
+        std::string Path;
+        std::vector<Event> Events;
+        std::vector<ScopeName> Names;
+        uint32_t FramesRecorded;
+        bool Truncated;
+    };
+
+    std::atomic<bool> s_Capturing(false);
+    bool s_RecordCpu = false;
+    bool s_Truncated = false;
+    uint32_t s_FramesLeft = 0;
+    uint32_t s_FramesRecorded = 0;
+    std::string s_Path;
+
+    int64_t s_BaseTick = 0;
+    double s_GpuBaseTime = 0.0;
+    uint64_t s_GpuBaseTimeStamp = 0;
+    double s_GpuTickDelta = 0.0;
+
+    std::mutex s_Mutex;
+    std::vector<Event> s_Events;
+    std::vector<ScopeName> s_Names;
+    std::unordered_map<const std::wstring*, uint32_t> s_NameLUT;
+
+    uint32_t GetNameId( const std::wstring& Name )
+    {
+        auto Iter = s_NameLUT.find(&Name);
+        if (Iter != s_NameLUT.end())
+            return Iter->second;
+
+        uint32_t Id = (uint32_t)s_Names.size();
+        s_Names.push_back({ std::string(Name.begin(), Name.end()), 0ull });
+        s_NameLUT[&Name] = Id;
+        return Id;
+    }
+
+    double CpuTime( void )
+    {
+        return SystemTime::TimeBetweenTicks(s_BaseTick, SystemTime::GetCurrentTick()) * 1000000.0;
+    }
+
+    void AddEvent( const Event& E )
+    {
+        if (s_Events.size() < kMaxEvents)
+            s_Events.push_back(E);
+        else
+            s_Truncated = true;
+    }
+
+    template <typename TWriter>
+    void WriteMetadata( TWriter& Writer, const char* Name, uint32_t ThreadId, const char* Value )
+    {
+        Writer.StartObject();
+        Writer.Key("name"); Writer.String(Name);
+        Writer.Key("ph"); Writer.String("M");
+        Writer.Key("pid"); Writer.Uint(1);
+        Writer.Key("tid"); Writer.Uint(ThreadId);
+        Writer.Key("args");
+        Writer.StartObject();
+        Writer.Key("name"); Writer.String(Value);
+        Writer.EndObject();
+        Writer.EndObject();
+    }
+
+    void WriteTrace( const FinishedTrace& Trace )
+    {
+        rapidjson::StringBuffer Buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> Writer(Buffer);
+
+        Writer.StartObject();
+        Writer.Key("traceEvents");
+        Writer.StartArray();
+
+        WriteMetadata(Writer, "process_name", kGpuThreadId, "MiniEngine");
+        WriteMetadata(Writer, "thread_name", kGpuThreadId, "GPU");
+
+        char FrameName[32];
+        for (const Event& E : Trace.Events)
+        {
+            Writer.StartObject();
+            Writer.Key("name");
+            if (E.Phase == 'i')
+            {
+                sprintf_s(FrameName, "Frame %u", E.NameId);
+                Writer.String(FrameName);
+                Writer.Key("s"); Writer.String("g");
+            }
+            else
+            {
+                Writer.String(Trace.Names[E.NameId].Name.c_str());
+                Writer.Key("cat"); Writer.String(E.ThreadId == kGpuThreadId ? "gpu" : "cpu");
+            }
+            char Phase[2] = { E.Phase, '\0' };
+            Writer.Key("ph"); Writer.String(Phase);
+            Writer.Key("ts"); Writer.Double(E.Time);
+            if (E.Phase == 'X')
+            {
+                Writer.Key("dur"); Writer.Double(E.Duration);
+            }
+            Writer.Key("pid"); Writer.Uint(1);
+            Writer.Key("tid"); Writer.Uint(E.ThreadId);
+            Writer.EndObject();
+        }
+
+        Writer.EndArray();
+        Writer.Key("displayTimeUnit"); Writer.String("ms");
+        Writer.Key("otherData");
+        Writer.StartObject();
+        Writer.Key("frames"); Writer.Uint(Trace.FramesRecorded);
+        Writer.Key("truncated"); Writer.Bool(Trace.Truncated);
+        Writer.EndObject();
+        Writer.EndObject();
+
+        std::ofstream File(Trace.Path.c_str());
+        if (!File)
+        {
+            std::cout << "Unable to write file: " << Trace.Path.c_str() << std::endl;
+            return;
+        }
+
+        File << Buffer.GetString();
+    }
+
+    // Called with the mutex held.  Moves the capture into Trace, to be written once the mutex is released,
+    // so the profiler hooks on other threads don't stall while the JSON is built and saved.
+    void Finish( FinishedTrace& Trace )
+    {
+        s_Capturing = false;
+        s_RecordCpu = false;
+
+        Trace.Path = s_Path;
+        Trace.Events.swap(s_Events);
+        Trace.Names.swap(s_Names);
+        Trace.FramesRecorded = s_FramesRecorded;
+        Trace.Truncated = s_Truncated;
+
+        // The swaps left the live capture's arrays empty
+        s_NameLUT.clear();
+    }
+}
+
+void TraceCapture::Begin( const std::string& Path, const ClockCalibration& Clock, uint32_t FrameCount )
+{
+    FinishedTrace Previous;
+    std::unique_lock<std::mutex> Lock(s_Mutex);
+
+    if (s_Capturing)
+        Finish(Previous);
+
+    s_Path = Path;
+    s_FramesLeft = FrameCount;
+    s_FramesRecorded = 0;
+    s_Truncated = false;
+
+    // GPU ranges are placed on the CPU time line through the calibration pair
+    s_BaseTick = SystemTime::GetCurrentTick();
+    s_GpuBaseTime = SystemTime::TimeBetweenTicks(s_BaseTick, Clock.CpuTick);
+    s_GpuBaseTimeStamp = Clock.GpuTimeStamp;
+    s_GpuTickDelta = Clock.GpuTickDelta;
+
+    s_RecordCpu = true;
+    s_Capturing = true;
+    Lock.unlock();
+
+    if (!Previous.Path.empty())
+        WriteTrace(Previous);
+}
+
+void TraceCapture::End( void )
+{
+    std::lock_guard<std::mutex> Guard(s_Mutex);
+
+    // Take GPU ranges until the last recorded frames' timers have been read back, as a capture with a
+    // frame count does
+    if (s_RecordCpu)
+    {
+        s_RecordCpu = false;
+        s_FramesLeft = kGpuLatencyFrames;
+    }
+}
+
+void TraceCapture::Flush( void )
+{
+    FinishedTrace Trace;
+    {
+        std::lock_guard<std::mutex> Guard(s_Mutex);
+        if (!s_Capturing)
+            return;
+        Finish(Trace);
+    }
+    WriteTrace(Trace);
+}
+
+bool TraceCapture::IsCapturing( void )
+{
+    return s_Capturing;
+}
+
+void TraceCapture::BeginCpuScope( const std::wstring& Name )
+{
+    if (!s_Capturing)
+        return;
+
+    std::lock_guard<std::mutex> Guard(s_Mutex);
+
+    if (s_RecordCpu)
+        AddEvent({ CpuTime(), 0.0, GetNameId(Name), (uint32_t)GetCurrentThreadId(), 'B' });
+}
+
+void TraceCapture::EndCpuScope( const std::wstring& Name )
+{
+    if (!s_Capturing)
+        return;
+
+    std::lock_guard<std::mutex> Guard(s_Mutex);
+
+    if (s_RecordCpu)
+        AddEvent({ CpuTime(), 0.0, GetNameId(Name), (uint32_t)GetCurrentThreadId(), 'E' });
+}
+
+void TraceCapture::AddGpuRange( const std::wstring& Name, uint64_t StartTimeStamp, uint64_t StopTimeStamp )
+{
+    if (!s_Capturing)
+        return;
+
+    std::lock_guard<std::mutex> Guard(s_Mutex);
+
+    // Timers whose scope didn't run since the last readback still hold their old time stamps
+    uint32_t NameId = GetNameId(Name);
+    if (s_Names[NameId].LastGpuStart == StartTimeStamp)
+        return;
+    s_Names[NameId].LastGpuStart = StartTimeStamp;
+
+    double Start = s_GpuBaseTime + (int64_t)(StartTimeStamp - s_GpuBaseTimeStamp) * s_GpuTickDelta;
+    double Duration = (StopTimeStamp - StartTimeStamp) * s_GpuTickDelta;
+
+    // Work submitted before the capture started
+    if (Start < 0.0)
+        return;
+
+    AddEvent({ Start * 1000000.0, Duration * 1000000.0, NameId, kGpuThreadId, 'X' });
+}
+
+void TraceCapture::NextFrame( uint64_t FrameIndex )
+{
+    if (!s_Capturing)
+        return;
+
+    FinishedTrace Trace;
+    {
+        std::lock_guard<std::mutex> Guard(s_Mutex);
+
+        if (s_RecordCpu)
+        {
+            AddEvent({ CpuTime(), 0.0, (uint32_t)FrameIndex, (uint32_t)GetCurrentThreadId(), 'i' });
+            ++s_FramesRecorded;
+        }
+
+        // Captures without a frame count run until End()
+        if (s_FramesLeft == 0 || --s_FramesLeft != 0)
+            return;
+
+        if (s_RecordCpu)
+        {
+            s_RecordCpu = false;
+            s_FramesLeft = kGpuLatencyFrames;
+            return;
+        }
+
+        Finish(Trace);
+    }
+    WriteTrace(Trace);
+}
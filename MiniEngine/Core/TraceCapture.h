@@ -0,0 +1,53 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Records profiler scopes into a timeline that chrome://tracing and Perfetto can open.
+// While a capture is running, every CPU scope is logged with its thread and begin/end ticks, and every
+// resolved GPU timer is logged as a range on a separate "GPU" track.  GPU time stamps are mapped onto
+// the CPU clock with the queue's clock calibration, so both tracks share one time line.  Nothing is
+// recorded, and each hook costs one branch, when no capture is running.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace TraceCapture
+{
+    // A GPU time stamp and the CPU tick (SystemTime::GetCurrentTick) read at the same moment, and the
+    // length of a GPU tick in seconds.  GpuCounterManager::GetClockCalibration() reads the graphics queue's.
+    struct ClockCalibration
+    {
+        uint64_t GpuTimeStamp;
+        int64_t CpuTick;
+        double GpuTickDelta;
+    };
+
+    // Starts recording.  The trace is written to Path after FrameCount frames, or after End() is called
+    // if FrameCount is 0.  A capture already in progress is written out first.
+    void Begin( const std::string& Path, const ClockCalibration& Clock, uint32_t FrameCount = 0 );
+
+    // Stops recording CPU scopes.  GPU ranges are taken for a few more frames, until the timers of the
+    // last recorded frames have been read back, and then the trace is written.
+    void End( void );
+
+    // Writes the trace at once, without the GPU ranges that are still in flight.  Used at shutdown.
+    void Flush( void );
+
+    // True until the trace is written, including the frames spent waiting for GPU ranges
+    bool IsCapturing( void );
+
+    // Profiler hooks.  Scope names must outlive the capture.
+    void BeginCpuScope( const std::wstring& Name );
+    void EndCpuScope( const std::wstring& Name );
+    void AddGpuRange( const std::wstring& Name, uint64_t StartTimeStamp, uint64_t StopTimeStamp );
+
+    // Marks a frame boundary and finishes the capture once enough frames were recorded
+    void NextFrame( uint64_t FrameIndex );
+}
@@ -0,0 +1,52 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Built without the precompiled header so it has no dependency on Windows
+#include "TuningSnapshot.h"
+
+#include <cstring>
+
+uint64_t TuningSnapshot::HashPath( const std::string& Path )
+{
+    // 64-bit FNV-1a
+    uint64_t Hash = 14695981039346656037ull;
+    for (char c : Path)
+        Hash = (Hash ^ (uint8_t)c) * 1099511628211ull;
+    return Hash;
+}
+
+void TuningSnapshot::Write( const Entry* Entries, uint32_t Count, std::vector<uint8_t>& Blob )
+{
+    Blob.resize(sizeof(Header) + Count * sizeof(Entry));
+
+    Header* Head = (Header*)Blob.data();
+    Head->Magic = kMagic;
+    Head->Version = kVersion;
+    Head->Count = Count;
+    Head->Reserved = 0;
+
+    if (Count > 0)
+        memcpy(Head + 1, Entries, Count * sizeof(Entry));
+}
+
+const TuningSnapshot::Entry* TuningSnapshot::Read( const void* Data, size_t Size, uint32_t& Count )
+{
+    Count = 0;
+
+    if (Data == nullptr || Size < sizeof(Header))
+        return nullptr;
+
+    const Header* Head = (const Header*)Data;
+    if (Head->Magic != kMagic || Head->Version != kVersion ||
+        Size != sizeof(Header) + (size_t)Head->Count * sizeof(Entry))
+        return nullptr;
+
+    Count = Head->Count;
+    return (const Entry*)(Head + 1);
+}
@@ -0,0 +1,49 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  The binary layout of EngineTuning snapshots:  a header followed by one entry per
+// variable, keyed by the 64-bit FNV-1a hash of the variable's path.  Kept apart from EngineTuning, which
+// needs the display and input, so the format can be checked without either.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace TuningSnapshot
+{
+    const uint32_t kMagic = 0x53535445;    // "ETSS"
+    const uint32_t kVersion = 1;
+
+    struct Header
+    {
+        uint32_t Magic;
+        uint32_t Version;
+        uint32_t Count;
+        uint32_t Reserved;
+    };
+
+    struct Entry
+    {
+        uint64_t PathHash;
+        uint32_t Value;
+        uint32_t Reserved;
+    };
+
+    uint64_t HashPath( const std::string& Path );
+
+    // Replaces the contents of Blob with a snapshot of Count entries
+    void Write( const Entry* Entries, uint32_t Count, std::vector<uint8_t>& Blob );
+
+    // Returns the entries of a well-formed snapshot, or nullptr if the header doesn't match this version
+    // or the size doesn't match the entry count.  The entries point into Data.
+    const Entry* Read( const void* Data, size_t Size, uint32_t& Count );
+}
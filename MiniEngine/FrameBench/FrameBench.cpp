@@ -0,0 +1,1214 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Runs the CPU side of ModelViewer's frame without a window or a device.  The scene's
+// animation is played back at a fixed time step, so every run sees the same camera path, and each frame
+// goes through the same stages ModelViewer runs:  animation and camera update, scene transform update, sun
+// shadow fitting, light clustering, light shadow scheduling, and recording of the depth, color, and shadow
+// passes into a CommandRecorder.  Extra spinning copies of the scene's first model can be scattered over
+// the floor to measure the cost of many moving instances.  With --occlusion-triangles, the largest meshes are
+// also rasterized into SoftwareOcclusion's depth buffer each frame and the main view draws culled against it.
+// A profiler-sized block of overlay text is also laid out through TextRenderer's glyph
+// path.  Per-stage times, heap allocations, and the recorder's and job scheduler's counters are written
+// as JSON.  With --trace, the measured frames' stages are also recorded through TraceCapture, as the
+// profiler records its scopes.  With --math-bench, only the Math batch microbenchmarks in MathBench.cpp are
+// run, and with --cluster-bench, only the 16k-light cluster build benchmark in LightClusterBench.cpp.
+//
+// Synthetic\synthetic.scn, at the top of the repository, is a small generated city block that needs no
+// downloaded assets, for build machines that don't have Sponza.
+//
+
+#include "pch.h"
+#include "MathBench.h"
+#include "LightClusterBench.h"
+#include "Scene.h"
+#include "ShadowCamera.h"
+#include "SystemTime.h"
+#include "LightClusters.h"
+#include "LightShadowCache.h"
+#include "SoftwareOcclusion.h"
+#include "CommandRecorder.h"
+#include "JobSystem.h"
+#include "TextRenderer.h"
+#include "TraceCapture.h"
+#include "Math/Random.h"
+#include "ART/Animation/AnimationController.h"
+#include "ART/PerfStat/PerfComparison.h"
+
+#include "prettywriter.h"
+#include "stringbuffer.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+
+using namespace Math;
+using namespace ART;
+
+//
+// Heap allocation counting.  operator new[] and delete[] forward to these by default.
+//
+
+static std::atomic<uint64_t> s_AllocCount(0);
+
+void* operator new( size_t Size )
+{
+    ++s_AllocCount;
+    if (void* Ptr = malloc(Size != 0 ? Size : 1))
+        return Ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete( void* Ptr ) noexcept
+{
+    free(Ptr);
+}
+
+// The same defaults as ModelViewer's tuning variables
+NumVar SunOrientation("FrameBench/Sun Orientation", -0.5f, -100.0f, 100.0f, 0.1f);
+NumVar SunInclination("FrameBench/Sun Inclination", 0.75f, 0.0f, 1.0f, 0.01f);
+BoolVar ShowWaveTileCounts("FrameBench/Wave Tile Counts", false);
+
+namespace
+{
+    // Lighting's light buffers hold 128 lights, all that can cast shadows.  Lights beyond those are only
+    // clustered, to measure the cluster build with many more lights than ModelViewer has.
+    enum { kMaxLights = 16384, kMaxShadowedLights = 128, kMaxCascades = 4, kShadowBufferSize = 8192 };
+
+    enum Stage
+    {
+        kAnimation,
+        kSceneTransforms,
+        kSunShadow,
+        kLightClusters,
+        kLightShadowSchedule,
+        kSoftwareOcclusion,
+        kRecordScene,
+        kRecordSunShadow,
+        kRecordLightShadows,
+        kOverlayText,
+        kStageCount
+    };
+
+    const char* kStageNames[kStageCount] =
+    {
+        "Animation",
+        "Scene Transforms",
+        "Sun Shadow",
+        "Light Clusters",
+        "Light Shadow Schedule",
+        "Software Occlusion",
+        "Record Scene",
+        "Record Sun Shadow",
+        "Record Light Shadows",
+        "Overlay Text",
+    };
+
+    // Ids of the objects the passes bind.  Zero means "nothing bound" to the recorder.
+    enum Pipeline { kDepthPSO = 1, kCutoutDepthPSO, kModelPSO, kCutoutModelPSO, kShadowPSO, kCutoutShadowPSO };
+    enum Target { kRootSig = 1, kSceneColor, kSceneDepth, kShadowBuffer, kLightShadowArray };
+
+    // Each model's index buffer is kModelBuffers + 2 * Model, and its vertex buffer the id after that
+    enum { kModelBuffers = 0x3000 };
+
+    // D3D12_RESOURCE_STATES
+    enum { kStateRenderTarget = 0x4, kStateDepthWrite = 0x10, kStatePixelShaderResource = 0x80 };
+
+    enum ObjectFilter { kOpaque = 0x1, kCutout = 0x2, kAll = 0xF };
+
+    struct BenchOptions
+    {
+        std::string ScenePath;
+        std::string OutPath = "framebench.json";
+        uint32_t Frames = 0;            // 0 plays the animation once
+        uint32_t WarmupFrames = 30;
+        float FrameRate = 60.0f;
+        uint32_t Cascades = 4;
+        uint32_t Lights = kMaxShadowedLights;
+        float LightShadowBudget = 0.5f;
+        uint32_t LightShadowMaxUpdates = 4;
+        uint32_t TextLines = 200;       // About what the profiler and tuning overlays draw when open
+        uint32_t Instances = 0;         // Spinning copies of the first model added to the scene
+        uint32_t Threads = 0;           // Job scheduler threads, 0 for one per hardware thread
+        uint32_t OcclusionTriangles = 0;    // Software occluder triangles per frame, 0 for no occlusion culling
+        std::string TracePath;          // Trace of the measured frames, none if empty
+    };
+
+    class FrameBench
+    {
+    public:
+
+        bool Initialize( const BenchOptions& Options );
+        void Run( void );
+        bool WriteReport( void );
+
+    private:
+
+        void RunFrame( bool Record );
+        void UpdateAnimation( void );
+        void UpdateSceneTransforms( void );
+        void UpdateSunShadow( void );
+        void BuildLightClusters( void );
+        void ScheduleLightShadows( void );
+        void UpdateShadowedLights( void );
+        void RenderSoftwareOcclusion( void );
+        void RecordScene( void );
+        void RecordSunShadow( void );
+        void RecordLightShadows( void );
+        void RecordObjects( const Matrix4& ViewProjMat, ObjectFilter Filter, const ShadowCamera* CullCamera = nullptr,
+            bool TestOcclusion = false );
+        void BeginShadowRendering( CommandRecorder::Resource& Target, uint32_t Width, uint32_t Height );
+        void LayoutOverlayText( void );
+        void CreateRandomLights( void );
+        void CreateInstances( void );
+        void CreateSoftwareOccluders( void );
+        void CreateOverlayText( void );
+
+        BenchOptions m_Options;
+        Scene m_Scene;
+        std::unique_ptr<CameraController> m_CameraController;
+        AnimationController_ptr m_AnimationController;
+        std::vector<std::vector<bool>> m_MaterialIsCutout;     // Per model, per material
+        std::vector<SceneGraph::NodeId> m_SpinningNodes;
+        uint32_t m_FrameIndex;
+
+        // Trace scope names, which must outlive the capture
+        std::wstring m_FrameScope;
+        std::wstring m_StageScopes[kStageCount];
+
+        Vector3 m_SunDirection;
+        ShadowCamera m_SunShadow;
+        ShadowCamera m_SunShadowCascades[kMaxCascades];
+        float m_CascadeSplits[kMaxCascades + 1];
+
+        LightClusterBuilder m_ClusterBuilder;
+        std::vector<LightClusterBuilder::Light> m_ClusterLights;
+        Matrix4 m_LightShadowMatrix[kMaxShadowedLights];
+        LightShadowCache m_LightShadowCache;
+        const std::vector<uint32_t>* m_LightShadowUpdates;
+
+        SoftwareOcclusion m_SoftwareOcclusion;
+        Matrix4 m_SoftwareOcclusionViewProj;
+        uint32_t m_OccludedDraws;       // This frame
+
+        CommandRecorder m_Recorder;
+        CommandRecorder::RootLayout m_RootSig;
+        CommandRecorder::Resource m_SceneColor;
+        CommandRecorder::Resource m_SceneDepth;
+        CommandRecorder::Resource m_ShadowBuffer;
+        CommandRecorder::Resource m_LightShadowArray;
+        D3D12_CPU_DESCRIPTOR_HANDLE m_MaterialSRVs[Model::kMaterialTexChannelCount()];
+        D3D12_CPU_DESCRIPTOR_HANDLE m_ExtraTextures[8];
+
+        TextRenderer::GlyphLayout m_TextLayout;
+        std::vector<std::string> m_TextLines;
+        std::vector<TextRenderer::TextVert> m_TextVerts;
+        uint32_t m_TextGlyphs;
+
+        // One sample per recorded frame
+        std::vector<float> m_StageTimes[kStageCount];
+        std::vector<float> m_StageAllocs[kStageCount];
+        std::vector<float> m_FrameTimes;
+        std::vector<float> m_FrameAllocs;
+        std::vector<float> m_Draws;
+        std::vector<float> m_StreamBytes;
+        std::vector<float> m_LightShadowUpdateCounts;
+        std::vector<float> m_TextGlyphCounts;
+        std::vector<float> m_OccluderCounts;
+        std::vector<float> m_OccluderTriangleCounts;
+        std::vector<float> m_OccludedDrawCounts;
+        CommandRecorder::Counters m_RecorderTotals;
+        JobScheduler::WorkerStats m_JobStatsBefore;
+        JobScheduler::WorkerStats m_JobStatsAfter;
+        uint32_t m_FramesRecorded;
+    };
+
+    // Times a stage and counts the allocations it makes
+    class StageTimer
+    {
+    public:
+        StageTimer( std::vector<float>* Times, std::vector<float>* Allocs ) :
+            m_Times(Times), m_Allocs(Allocs), m_AllocCount(s_AllocCount), m_StartTick(SystemTime::GetCurrentTick())
+        {
+        }
+
+        ~StageTimer()
+        {
+            int64_t EndTick = SystemTime::GetCurrentTick();
+            uint64_t AllocCount = s_AllocCount;
+            if (m_Times != nullptr)
+            {
+                m_Times->push_back((float)(SystemTime::TimeBetweenTicks(m_StartTick, EndTick) * 1000000.0));
+                m_Allocs->push_back((float)(AllocCount - m_AllocCount));
+            }
+        }
+
+    private:
+        std::vector<float>* m_Times;
+        std::vector<float>* m_Allocs;
+        uint64_t m_AllocCount;
+        int64_t m_StartTick;
+    };
+}
+
+bool FrameBench::Initialize( const BenchOptions& Options )
+{
+    m_Options = Options;
+    m_FramesRecorded = 0;
+    m_FrameIndex = 0;
+    m_OccludedDraws = 0;
+    memset(&m_RecorderTotals, 0, sizeof(m_RecorderTotals));
+    memset(&m_JobStatsBefore, 0, sizeof(m_JobStatsBefore));
+    memset(&m_JobStatsAfter, 0, sizeof(m_JobStatsAfter));
+
+    // The layout of ModelViewer's root signature:  three CBVs, the material textures, the lighting
+    // buffers, and two root constants
+    m_RootSig.Id = kRootSig;
+    m_RootSig.SetDescriptorTable(3, Model::kMaterialTexChannelCount());
+    m_RootSig.SetDescriptorTable(4, _countof(m_ExtraTextures));
+    m_RootSig.NumParameters = 6;
+
+    m_SceneColor = CommandRecorder::Resource(kSceneColor, kStatePixelShaderResource);
+    m_SceneDepth = CommandRecorder::Resource(kSceneDepth, kStatePixelShaderResource);
+    m_ShadowBuffer = CommandRecorder::Resource(kShadowBuffer, kStatePixelShaderResource);
+    m_LightShadowArray = CommandRecorder::Resource(kLightShadowArray, kStatePixelShaderResource);
+
+    m_FrameScope = L"Frame";
+    for (uint32_t i = 0; i < kStageCount; ++i)
+    {
+        const std::string Name = kStageNames[i];
+        m_StageScopes[i].assign(Name.begin(), Name.end());
+    }
+
+    // Distinct fake handles so every descriptor is a real copy
+    for (uint32_t i = 0; i < _countof(m_MaterialSRVs); ++i)
+        m_MaterialSRVs[i].ptr = 0x1000 + i;
+    for (uint32_t i = 0; i < _countof(m_ExtraTextures); ++i)
+        m_ExtraTextures[i].ptr = 0x2000 + i;
+
+    if (!m_Scene.LoadJson(m_Options.ScenePath.c_str(), false))
+    {
+        std::cerr << "Unable to load scene: " << m_Options.ScenePath << std::endl;
+        return false;
+    }
+
+    m_MaterialIsCutout.resize(m_Scene.GetModelCount());
+    for (uint32_t m = 0; m < m_Scene.GetModelCount(); ++m)
+    {
+        const Model& model = m_Scene.GetModel(m);
+        m_MaterialIsCutout[m].resize(model.m_Header.materialCount);
+        for (uint32_t i = 0; i < model.m_Header.materialCount; ++i)
+            m_MaterialIsCutout[m][i] = model.m_pMaterial[i].hasMask;
+    }
+
+    CreateInstances();
+
+    if (m_Options.OcclusionTriangles > 0)
+        CreateSoftwareOccluders();
+
+    m_CameraController.reset(new CameraController(m_Scene.GetCamera(), Vector3(kYUnitVector)));
+    m_CameraController->SetSpeed(0.25f * m_Scene.GetModelRadius());
+
+    m_AnimationController = std::make_shared<AnimationController>();
+    m_AnimationController->SetSceneAnimation(m_Scene.GetAnimation());
+    m_AnimationController->SetTargetCamera(&m_Scene.GetCamera());
+    m_AnimationController->AnimateFloatVar(&SunOrientation, "SunOrientation");
+    m_AnimationController->AnimateBoolVar(&ShowWaveTileCounts, "ShowWaveTileCounts");
+    m_AnimationController->Play();
+
+    CreateRandomLights();
+    CreateOverlayText();
+
+    if (m_Options.Frames == 0)
+    {
+        float StartTime, EndTime;
+        m_Scene.GetAnimation()->GetTimeSpan(StartTime, EndTime);
+        m_Options.Frames = std::max(1u, (uint32_t)((EndTime - StartTime) * m_Options.FrameRate + 0.5f));
+    }
+
+    for (uint32_t i = 0; i < kStageCount; ++i)
+    {
+        m_StageTimes[i].reserve(m_Options.Frames);
+        m_StageAllocs[i].reserve(m_Options.Frames);
+    }
+    m_FrameTimes.reserve(m_Options.Frames);
+    m_FrameAllocs.reserve(m_Options.Frames);
+    m_Draws.reserve(m_Options.Frames);
+    m_StreamBytes.reserve(m_Options.Frames);
+    m_LightShadowUpdateCounts.reserve(m_Options.Frames);
+    m_TextGlyphCounts.reserve(m_Options.Frames);
+    m_OccluderCounts.reserve(m_Options.Frames);
+    m_OccluderTriangleCounts.reserve(m_Options.Frames);
+    m_OccludedDrawCounts.reserve(m_Options.Frames);
+
+    return true;
+}
+
+// Copies of the first model at a sixteenth of its size, on a square grid over the floor of the scene
+void FrameBench::CreateInstances( void )
+{
+    if (m_Options.Instances == 0)
+        return;
+
+    const Model::BoundingBox& bounds = m_Scene.GetBoundingBox();
+    const uint32_t GridSize = (uint32_t)ceilf(sqrtf((float)m_Options.Instances));
+    const Vector3 Spacing = (bounds.max - bounds.min) / Scalar((float)GridSize);
+
+    m_SpinningNodes.reserve(m_Options.Instances);
+    for (uint32_t i = 0; i < m_Options.Instances; ++i)
+    {
+        Vector3 Position = bounds.min + Spacing * Vector3(i % GridSize + 0.5f, 0.0f, i / GridSize + 0.5f);
+
+        SceneGraph::Transform Local = SceneGraph::Transform::Identity();
+        Local.Translation[0] = Position.GetX();
+        Local.Translation[1] = Position.GetY();
+        Local.Translation[2] = Position.GetZ();
+        Local.Scale[0] = Local.Scale[1] = Local.Scale[2] = 1.0f / 16.0f;
+        m_SpinningNodes.push_back(m_Scene.AddInstance(0, Local));
+    }
+
+    m_Scene.UpdateTransforms();
+}
+
+// ModelViewer::CreateSoftwareOccluders
+void FrameBench::CreateSoftwareOccluders( void )
+{
+    if (!m_Scene.LoadDepthGeometry())
+    {
+        std::cerr << "Unable to read the depth geometry, software occlusion culling is off" << std::endl;
+        return;
+    }
+
+    std::vector<SoftwareOcclusion::MeshDesc> descs;
+    for (uint32_t m = 0; m < m_Scene.GetModelCount(); ++m)
+    {
+        const Model& model = m_Scene.GetModel(m);
+
+        descs.clear();
+        for (uint32_t meshIndex = 0; meshIndex < model.m_Header.meshCount; ++meshIndex)
+        {
+            const Model::Mesh& mesh = model.m_pMesh[meshIndex];
+            if (m_MaterialIsCutout[m][mesh.materialIndex])
+                continue;
+
+            SoftwareOcclusion::MeshDesc desc;
+            desc.Positions = (const float*)(model.m_pVertexDataDepth + mesh.vertexDataByteOffsetDepth + mesh.attribDepth[Model::attrib_position].offset);
+            desc.VertexStride = mesh.vertexStrideDepth;
+            desc.VertexCount = mesh.vertexCountDepth;
+            desc.Indices = (const uint16_t*)(model.m_pIndexDataDepth + mesh.indexDataByteOffset);
+            desc.IndexCount = mesh.indexCount;
+            desc.BoundsMin[0] = mesh.boundingBox.min.GetX();
+            desc.BoundsMin[1] = mesh.boundingBox.min.GetY();
+            desc.BoundsMin[2] = mesh.boundingBox.min.GetZ();
+            desc.BoundsMax[0] = mesh.boundingBox.max.GetX();
+            desc.BoundsMax[1] = mesh.boundingBox.max.GetY();
+            desc.BoundsMax[2] = mesh.boundingBox.max.GetZ();
+            descs.push_back(desc);
+        }
+
+        m_SoftwareOcclusion.AddModel(m, descs.data(), (uint32_t)descs.size());
+    }
+
+    m_Scene.ReleaseDepthGeometry();
+    m_SoftwareOcclusion.SetTriangleBudget(m_Options.OcclusionTriangles);
+}
+
+// The same light set as Lighting::CreateRandomLights, which needs a device to create its buffers, followed
+// by unshadowed point and cone lights spread the same way
+void FrameBench::CreateRandomLights( void )
+{
+    const Model::BoundingBox& bounds = m_Scene.GetBoundingBox();
+    Vector3 posScale = bounds.max - bounds.min;
+    Vector3 posBias = bounds.min;
+
+    float radScale = 0.45f * std::min<float>(posScale.GetX(), std::min<float>(posScale.GetY(), posScale.GetZ()));
+
+    RandomNumberGenerator rng(12645);
+    auto randVecUniform = [&rng]() -> Vector3
+    {
+        float x = rng.NextFloat();
+        float y = rng.NextFloat();
+        float z = rng.NextFloat();
+        return Vector3(x, y, z);
+    };
+    auto randVecGaussian = [&rng]() -> Vector3
+    {
+        float x = rng.NextGaussian();
+        float y = rng.NextGaussian();
+        float z = rng.NextGaussian();
+        return Normalize(Vector3(x, y, z));
+    };
+
+    const float pi = 3.14159265359f;
+    m_ClusterLights.resize(std::max<uint32_t>(m_Options.Lights, kMaxShadowedLights));
+    m_LightShadowCache.Create(kMaxShadowedLights);
+    for (uint32_t n = 0; n < kMaxShadowedLights; n++)
+    {
+        // Draw every value the engine draws so positions and cones match its lights
+        Vector3 pos = randVecUniform() * posScale + posBias;
+        float lightRadius = rng.NextFloat() * radScale + 0.25f * radScale;
+        randVecUniform();
+        rng.NextFloat();
+
+        uint32_t type = n < 32 ? 0 : n < 96 ? 1 : 2;
+
+        Vector3 coneDir = randVecGaussian();
+        float coneInner = (rng.NextFloat() * .2f + .025f) * pi;
+        float coneOuter = coneInner + rng.NextFloat() * .1f * pi;
+
+        Camera shadowCamera;
+        shadowCamera.SetEyeAtUp(pos, pos + coneDir, Vector3(0, 1, 0));
+        shadowCamera.SetPerspectiveMatrix(coneOuter * 2, 1.0f, lightRadius * .05f, lightRadius * 1.0f);
+        shadowCamera.Update();
+        m_LightShadowMatrix[n] = shadowCamera.GetViewProjMatrix();
+
+        m_ClusterLights[n].Position[0] = pos.GetX();
+        m_ClusterLights[n].Position[1] = pos.GetY();
+        m_ClusterLights[n].Position[2] = pos.GetZ();
+        m_ClusterLights[n].Radius = lightRadius;
+        m_ClusterLights[n].Type = type;
+    }
+
+    for (uint32_t n = kMaxShadowedLights; n < m_Options.Lights; n++)
+    {
+        Vector3 pos = randVecUniform() * posScale + posBias;
+        m_ClusterLights[n].Position[0] = pos.GetX();
+        m_ClusterLights[n].Position[1] = pos.GetY();
+        m_ClusterLights[n].Position[2] = pos.GetZ();
+        m_ClusterLights[n].Radius = rng.NextFloat() * radScale + 0.25f * radScale;
+        m_ClusterLights[n].Type = n & 1;
+    }
+
+    m_LightShadowCache.SetBudget(m_Options.LightShadowBudget, m_Options.LightShadowMaxUpdates);
+    UpdateShadowedLights();
+}
+
+// Lighting::UpdateShadowedLights, for the shadowed lights within the benchmark's light count
+void FrameBench::UpdateShadowedLights( void )
+{
+    const uint32_t Count = std::min<uint32_t>(m_Options.Lights, kMaxShadowedLights);
+    for (uint32_t n = 0; n < Count; n++)
+    {
+        if (m_ClusterLights[n].Type != 2)
+            continue;
+
+        const float* pos = m_ClusterLights[n].Position;
+        m_LightShadowCache.UpdateLight(n, BoundingSphere(Vector3(pos[0], pos[1], pos[2]), m_ClusterLights[n].Radius),
+            m_LightShadowMatrix[n]);
+    }
+}
+
+// Rows shaped like the profiler's:  an indented scope name followed by its times and barrier count
+void FrameBench::CreateOverlayText( void )
+{
+    RandomNumberGenerator rng(7);
+
+    size_t TotalChars = 0;
+    m_TextLines.resize(m_Options.TextLines);
+    for (uint32_t i = 0; i < m_Options.TextLines; ++i)
+    {
+        char Line[128];
+        sprintf_s(Line, "%*s- %-24s%6.3f %6.3f %5u\n", 2 * (int)(i % 4), "", kStageNames[i % kStageCount],
+            rng.NextFloat() * 4.0f, rng.NextFloat() * 4.0f, (uint32_t)(rng.NextFloat() * 64.0f));
+        m_TextLines[i] = Line;
+        TotalChars += m_TextLines[i].size();
+    }
+    m_TextVerts.resize(TotalChars);
+
+    // The built-in font, without the texture that would need a device
+    m_TextLayout.Glyphs = &TextRenderer::GetGlyphTable(*TextRenderer::GetOrLoadFont(L"default", false));
+    m_TextGlyphs = 0;
+}
+
+void FrameBench::Run( void )
+{
+    for (uint32_t i = 0; i < m_Options.WarmupFrames; ++i)
+        RunFrame(false);
+
+    m_JobStatsBefore = g_JobScheduler.GetTotalStats();
+
+    // There are no GPU ranges to place, so the calibration is only the capture's start
+    if (!m_Options.TracePath.empty())
+    {
+        TraceCapture::ClockCalibration Clock = { 0, SystemTime::GetCurrentTick(), 0.0 };
+        TraceCapture::Begin(m_Options.TracePath, Clock);
+    }
+
+    for (uint32_t i = 0; i < m_Options.Frames; ++i)
+        RunFrame(true);
+
+    m_JobStatsAfter = g_JobScheduler.GetTotalStats();
+
+    TraceCapture::Flush();
+}
+
+void FrameBench::RunFrame( bool Record )
+{
+    m_Recorder.Reset();
+
+    {
+        StageTimer Frame(Record ? &m_FrameTimes : nullptr, &m_FrameAllocs);
+        TraceCapture::BeginCpuScope(m_FrameScope);
+
+        void (FrameBench::*Stages[kStageCount])( void ) =
+        {
+            &FrameBench::UpdateAnimation,
+            &FrameBench::UpdateSceneTransforms,
+            &FrameBench::UpdateSunShadow,
+            &FrameBench::BuildLightClusters,
+            &FrameBench::ScheduleLightShadows,
+            &FrameBench::RenderSoftwareOcclusion,
+            &FrameBench::RecordScene,
+            &FrameBench::RecordSunShadow,
+            &FrameBench::RecordLightShadows,
+            &FrameBench::LayoutOverlayText,
+        };
+
+        for (uint32_t i = 0; i < kStageCount; ++i)
+        {
+            StageTimer Timer(Record ? &m_StageTimes[i] : nullptr, &m_StageAllocs[i]);
+            TraceCapture::BeginCpuScope(m_StageScopes[i]);
+            (this->*Stages[i])();
+            TraceCapture::EndCpuScope(m_StageScopes[i]);
+        }
+
+        TraceCapture::EndCpuScope(m_FrameScope);
+    }
+
+    TraceCapture::NextFrame(m_FrameIndex);
+
+    if (!Record)
+        return;
+
+    const CommandRecorder::Counters& Counters = m_Recorder.GetCounters();
+    m_RecorderTotals.Commands += Counters.Commands;
+    m_RecorderTotals.Draws += Counters.Draws;
+    m_RecorderTotals.Primitives += Counters.Primitives;
+    m_RecorderTotals.Barriers += Counters.Barriers;
+    m_RecorderTotals.BarrierBatches += Counters.BarrierBatches;
+    m_RecorderTotals.RedundantTransitions += Counters.RedundantTransitions;
+    m_RecorderTotals.MergedTransitions += Counters.MergedTransitions;
+    m_RecorderTotals.DescriptorCopies += Counters.DescriptorCopies;
+    m_RecorderTotals.DescriptorCopyCalls += Counters.DescriptorCopyCalls;
+    m_RecorderTotals.DescriptorHeapChanges += Counters.DescriptorHeapChanges;
+    m_RecorderTotals.RootSignatureChanges += Counters.RootSignatureChanges;
+    m_RecorderTotals.PipelineChanges += Counters.PipelineChanges;
+    m_RecorderTotals.RedundantStateChanges += Counters.RedundantStateChanges;
+    m_RecorderTotals.RootParameterChanges += Counters.RootParameterChanges;
+    m_RecorderTotals.RedundantRootParameters += Counters.RedundantRootParameters;
+    m_RecorderTotals.UploadBytes += Counters.UploadBytes;
+    m_Draws.push_back((float)Counters.Draws);
+    m_StreamBytes.push_back((float)m_Recorder.GetStreamBytes());
+    m_LightShadowUpdateCounts.push_back((float)m_LightShadowUpdates->size());
+    m_TextGlyphCounts.push_back((float)m_TextGlyphs);
+    m_OccluderCounts.push_back((float)m_SoftwareOcclusion.GetStats().Occluders);
+    m_OccluderTriangleCounts.push_back((float)m_SoftwareOcclusion.GetStats().Triangles);
+    m_OccludedDrawCounts.push_back((float)m_OccludedDraws);
+    ++m_FramesRecorded;
+}
+
+// Every added instance turns about its vertical axis, a quarter turn per second, so they are all dirty
+void FrameBench::UpdateSceneTransforms( void )
+{
+    const float HalfAngle = 0.25f * 3.14159265f * (float)++m_FrameIndex / m_Options.FrameRate;
+
+    for (size_t i = 0; i < m_SpinningNodes.size(); ++i)
+    {
+        SceneGraph::Transform Local = m_Scene.GetSceneGraph().GetLocalTransform(m_SpinningNodes[i]);
+        Local.Rotation[1] = sinf(HalfAngle + (float)i);
+        Local.Rotation[3] = cosf(HalfAngle + (float)i);
+        m_Scene.GetSceneGraph().SetLocalTransform(m_SpinningNodes[i], Local);
+    }
+
+    m_Scene.UpdateTransforms();
+}
+
+// ModelViewer::Update without the input handling
+void FrameBench::UpdateAnimation( void )
+{
+    const float DeltaT = 1.0f / m_Options.FrameRate;
+
+    m_AnimationController->Update(DeltaT);
+    if (m_AnimationController->IsDirty())
+    {
+        m_CameraController->Reset();
+        m_CameraController->Update(0);
+        m_AnimationController->SetDirty(false);
+    }
+    else
+        m_CameraController->Update(DeltaT);
+
+    float costheta = cosf(SunOrientation);
+    float sintheta = sinf(SunOrientation);
+    float cosphi = cosf(SunInclination * 3.14159f * 0.5f);
+    float sinphi = sinf(SunInclination * 3.14159f * 0.5f);
+    m_SunDirection = Normalize(Vector3(costheta * cosphi, sinphi, sintheta * cosphi));
+}
+
+// ModelViewer::UpdateSunShadow with the default shadow dimensions
+void FrameBench::UpdateSunShadow( void )
+{
+    if (m_Options.Cascades <= 1)
+    {
+        const Vector3& SceneShadowDim = m_Scene.GetShadowDim();
+        Vector3 ShadowDim(
+            SceneShadowDim.GetX() > 0.0f ? (float)SceneShadowDim.GetX() : 5000.0f,
+            SceneShadowDim.GetY() > 0.0f ? (float)SceneShadowDim.GetY() : 5000.0f,
+            SceneShadowDim.GetZ() > 0.0f ? (float)SceneShadowDim.GetZ() : 3000.0f);
+
+        m_SunShadow.UpdateMatrix(-m_SunDirection, m_Scene.GetCenter() - m_SunDirection * 0.35f * m_Scene.GetModelRadius(),
+            ShadowDim, kShadowBufferSize, kShadowBufferSize, 16);
+        return;
+    }
+
+    const Camera& camera = m_Scene.GetCamera();
+    const Model::BoundingBox& sceneBounds = m_Scene.GetBoundingBox();
+    const Matrix4& ProjMat = camera.GetProjMatrix();
+    const float TanHalfFovX = 1.0f / ProjMat.GetX().GetX();
+    const float TanHalfFovY = 1.0f / ProjMat.GetY().GetY();
+
+    ComputeCascadeSplits(camera.GetNearClip(), std::min(camera.GetFarClip(), 5000.0f),
+        m_Options.Cascades, 0.8f, m_CascadeSplits);
+
+    for (uint32_t i = 0; i < m_Options.Cascades; ++i)
+    {
+        BoundingSphere sliceBounds = ComputeFrustumSliceSphere(camera.GetPosition(), camera.GetForwardVec(),
+            TanHalfFovX, TanHalfFovY, m_CascadeSplits[i], m_CascadeSplits[i + 1]);
+
+        m_SunShadowCascades[i].UpdateCascade(-m_SunDirection, sliceBounds, sceneBounds.min, sceneBounds.max,
+            kShadowBufferSize / 2, kShadowBufferSize / 2, 16);
+    }
+}
+
+void FrameBench::BuildLightClusters( void )
+{
+    const Camera& camera = m_Scene.GetCamera();
+
+    LightClusterBuilder::Frustum frustum;
+    memcpy(frustum.ViewMatrix, &camera.GetViewMatrix(), sizeof(frustum.ViewMatrix));
+    frustum.ProjScaleX = camera.GetProjMatrix().GetX().GetX();
+    frustum.ProjScaleY = camera.GetProjMatrix().GetY().GetY();
+    frustum.NearClip = camera.GetNearClip();
+    frustum.FarClip = camera.GetFarClip();
+
+    m_ClusterBuilder.Build(frustum, m_ClusterLights.data(), m_Options.Lights);
+}
+
+// The spinning instances move every frame, so the lights around them are re-rendered as the budget allows
+void FrameBench::ScheduleLightShadows( void )
+{
+    UpdateShadowedLights();
+    m_LightShadowCache.InvalidateMovedInstances(m_Scene.GetSceneGraph());
+    m_LightShadowUpdates = &m_LightShadowCache.Schedule(m_Scene.GetCamera());
+}
+
+// ModelViewer::RenderSoftwareOcclusion
+void FrameBench::RenderSoftwareOcclusion( void )
+{
+    m_OccludedDraws = 0;
+    if (m_SoftwareOcclusion.GetOccluderCount() == 0)
+        return;
+
+    m_SoftwareOcclusionViewProj = m_Scene.GetCamera().GetViewProjMatrix();
+    m_SoftwareOcclusion.Begin(reinterpret_cast<const float*>(&m_SoftwareOcclusionViewProj));
+    for (uint32_t instance = 0; instance < m_Scene.GetInstanceCount(); ++instance)
+    {
+        const Matrix4 World = m_Scene.GetInstanceMatrix(instance);
+        m_SoftwareOcclusion.AddInstance(m_Scene.GetInstanceModel(instance), reinterpret_cast<const float*>(&World));
+    }
+    m_SoftwareOcclusion.Rasterize();
+}
+
+// The depth prepass and the color pass
+void FrameBench::RecordScene( void )
+{
+    const Matrix4& ViewProjMat = m_Scene.GetCamera().GetViewProjMatrix();
+    const uint32_t Width = 1920, Height = 1080;
+
+    m_Recorder.SetRootSignature(m_RootSig);
+
+    m_Recorder.TransitionResource(m_SceneDepth, kStateDepthWrite, true);
+    m_Recorder.ClearDepth(m_SceneDepth);
+    m_Recorder.SetRenderTargets(0, nullptr, kSceneDepth);
+    m_Recorder.SetViewportAndScissor(0, 0, Width, Height);
+
+    m_Recorder.SetPipelineState(kDepthPSO);
+    RecordObjects(ViewProjMat, kOpaque, nullptr, true);
+    m_Recorder.SetPipelineState(kCutoutDepthPSO);
+    RecordObjects(ViewProjMat, kCutout, nullptr, true);
+
+    m_Recorder.TransitionResource(m_SceneColor, kStateRenderTarget, true);
+    m_Recorder.ClearColor(m_SceneColor);
+    CommandRecorder::ObjectId RTV = kSceneColor;
+    m_Recorder.SetRenderTargets(1, &RTV, kSceneDepth);
+    m_Recorder.SetDynamicDescriptors(4, 0, _countof(m_ExtraTextures), m_ExtraTextures);
+
+    m_Recorder.SetPipelineState(kModelPSO);
+    RecordObjects(ViewProjMat, kOpaque, nullptr, true);
+    m_Recorder.SetPipelineState(kCutoutModelPSO);
+    RecordObjects(ViewProjMat, kCutout, nullptr, true);
+
+    m_Recorder.TransitionResource(m_SceneColor, kStatePixelShaderResource);
+    m_Recorder.TransitionResource(m_SceneDepth, kStatePixelShaderResource);
+}
+
+// ShadowBuffer::BeginRendering
+void FrameBench::BeginShadowRendering( CommandRecorder::Resource& Target, uint32_t Width, uint32_t Height )
+{
+    m_Recorder.TransitionResource(Target, kStateDepthWrite, true);
+    m_Recorder.ClearDepth(Target);
+    m_Recorder.SetRenderTargets(0, nullptr, Target.Id);
+    m_Recorder.SetViewportAndScissor(1, 1, Width - 2, Height - 2);
+}
+
+void FrameBench::RecordSunShadow( void )
+{
+    m_Recorder.SetRootSignature(m_RootSig);
+    BeginShadowRendering(m_ShadowBuffer, kShadowBufferSize, kShadowBufferSize);
+
+    if (m_Options.Cascades <= 1)
+    {
+        m_Recorder.SetPipelineState(kShadowPSO);
+        RecordObjects(m_SunShadow.GetViewProjMatrix(), kOpaque);
+        m_Recorder.SetPipelineState(kCutoutShadowPSO);
+        RecordObjects(m_SunShadow.GetViewProjMatrix(), kCutout);
+    }
+    else
+    {
+        const uint32_t CascadeSize = kShadowBufferSize / 2;
+
+        for (uint32_t i = 0; i < m_Options.Cascades; ++i)
+        {
+            uint32_t Left = (i & 1) * CascadeSize;
+            uint32_t Top = (i >> 1) * CascadeSize;
+            m_Recorder.SetViewport((float)Left, (float)Top, (float)CascadeSize, (float)CascadeSize);
+            m_Recorder.SetScissor(Left + 1, Top + 1, Left + CascadeSize - 2, Top + CascadeSize - 2);
+
+            const ShadowCamera& cascade = m_SunShadowCascades[i];
+            m_Recorder.SetPipelineState(kShadowPSO);
+            RecordObjects(cascade.GetViewProjMatrix(), kOpaque, &cascade);
+            m_Recorder.SetPipelineState(kCutoutShadowPSO);
+            RecordObjects(cascade.GetViewProjMatrix(), kCutout, &cascade);
+        }
+    }
+
+    m_Recorder.TransitionResource(m_ShadowBuffer, kStatePixelShaderResource);
+}
+
+void FrameBench::RecordLightShadows( void )
+{
+    if (m_LightShadowUpdates->empty())
+        return;
+
+    int64_t startTick = SystemTime::GetCurrentTick();
+
+    m_Recorder.SetRootSignature(m_RootSig);
+
+    for (uint32_t LightIndex : *m_LightShadowUpdates)
+    {
+        // Lighting::m_LightShadowArray is 512 x 512 per light
+        BeginShadowRendering(m_LightShadowArray, 512, 512);
+        m_Recorder.SetPipelineState(kShadowPSO);
+        RecordObjects(m_LightShadowMatrix[LightIndex], kOpaque);
+        m_Recorder.SetPipelineState(kCutoutShadowPSO);
+        RecordObjects(m_LightShadowMatrix[LightIndex], kCutout);
+    }
+    m_Recorder.TransitionResource(m_LightShadowArray, kStatePixelShaderResource);
+
+    float elapsedMs = (float)SystemTime::TimeBetweenTicks(startTick, SystemTime::GetCurrentTick()) * 1000.0f;
+    m_LightShadowCache.ReportUpdateTime(elapsedMs, (uint32_t)m_LightShadowUpdates->size());
+}
+
+// What TextContext does for each DrawString between Begin() and End(), minus the draw
+void FrameBench::LayoutOverlayText( void )
+{
+    const uint32_t kWhite = 0xFFFFFFFF;
+    const uint32_t kYellow = 0xFF80FFFF;
+
+    m_TextLayout.TextSize = 20.0f;
+    m_TextLayout.LineHeight = 20.0f;
+    m_TextLayout.LeftMargin = m_TextLayout.TextPosX = 10.0f;
+    m_TextLayout.TextPosY = 40.0f;
+
+    m_TextGlyphs = 0;
+    for (size_t i = 0; i < m_TextLines.size(); ++i)
+    {
+        const std::string& Line = m_TextLines[i];
+        m_TextLayout.Color = (i % 16) == 0 ? kYellow : kWhite;
+        m_TextGlyphs += m_TextLayout.FillVertexBuffer(m_TextVerts.data() + m_TextGlyphs, Line.c_str(), 1, Line.size());
+    }
+}
+
+// ModelViewer::RenderObjects, minus texture residency, which needs the textures
+void FrameBench::RecordObjects( const Matrix4& ViewProjMat, ObjectFilter Filter, const ShadowCamera* CullCamera,
+    bool TestOcclusion )
+{
+    struct VSConstants
+    {
+        Matrix4 modelToProjection;
+        Matrix4 modelToShadow;
+        Matrix4 modelToWorld;
+        XMFLOAT3 viewerPos;
+    } vsConstants;
+
+    XMStoreFloat3(&vsConstants.viewerPos, m_Scene.GetCamera().GetPosition());
+
+    const Matrix4& ShadowMat = m_SunShadow.GetShadowMatrix();
+    uint32_t modelIdx = 0xFFFFFFFFul;
+
+    const bool softwareCull = TestOcclusion && m_SoftwareOcclusion.GetStats().Occluders > 0;
+
+    for (uint32_t instance = 0; instance < m_Scene.GetInstanceCount(); instance++)
+    {
+        const uint32_t instanceModel = m_Scene.GetInstanceModel(instance);
+        const Model& model = m_Scene.GetModel(instanceModel);
+        const std::vector<bool>& isCutout = m_MaterialIsCutout[instanceModel];
+
+        // Counts the occluded draws this pass would have recorded
+        auto CountOccluded = [&]( uint32_t meshIndex )
+        {
+            if ((isCutout[model.m_pMesh[meshIndex].materialIndex] ? kCutout : kOpaque) & Filter)
+                ++m_OccludedDraws;
+        };
+
+        if (CullCamera != nullptr)
+        {
+            Vector3 instanceMin, instanceMax;
+            m_Scene.GetInstanceBounds(instance, instanceMin, instanceMax);
+            if (!CullCamera->IntersectBoundingBox(instanceMin, instanceMax))
+                continue;
+        }
+
+        if (softwareCull)
+        {
+            Vector3 instanceMin, instanceMax;
+            m_Scene.GetInstanceBounds(instance, instanceMin, instanceMax);
+            if (m_SoftwareOcclusion.IsOccluded(reinterpret_cast<const float*>(&m_SoftwareOcclusionViewProj),
+                reinterpret_cast<const float*>(&instanceMin), reinterpret_cast<const float*>(&instanceMax)))
+            {
+                for (uint32_t meshIndex = 0; meshIndex < model.m_Header.meshCount; meshIndex++)
+                    CountOccluded(meshIndex);
+                continue;
+            }
+        }
+
+        const Matrix4 World = m_Scene.GetInstanceMatrix(instance);
+        const Matrix4 modelToSoftwareProjection = softwareCull ? m_SoftwareOcclusionViewProj * World : World;
+
+        if (instanceModel != modelIdx)
+        {
+            modelIdx = instanceModel;
+            CommandRecorder::ObjectId VertexBuffer = kModelBuffers + 2 * modelIdx + 1;
+            m_Recorder.SetIndexBuffer(kModelBuffers + 2 * modelIdx);
+            m_Recorder.SetVertexBuffers(0, 1, &VertexBuffer);
+            m_Recorder.SetDynamicDescriptors(3, Model::kMaterialTexChannelCount() - 1, 1, m_MaterialSRVs);
+        }
+
+        vsConstants.modelToProjection = ViewProjMat * World;
+        vsConstants.modelToShadow = ShadowMat * World;
+        vsConstants.modelToWorld = World;
+        m_Recorder.SetDynamicConstantBufferView(0, sizeof(vsConstants), &vsConstants);
+
+        uint32_t materialIdx = 0xFFFFFFFFul;
+
+        uint32_t VertexStride = model.m_VertexStride;
+
+        for (uint32_t meshIndex = 0; meshIndex < model.m_Header.meshCount; meshIndex++)
+        {
+            const Model::Mesh& mesh = model.m_pMesh[meshIndex];
+
+            if (CullCamera != nullptr)
+            {
+                Vector3 meshMin, meshMax;
+                Scene::TransformBounds(World, mesh.boundingBox, meshMin, meshMax);
+                if (!CullCamera->IntersectBoundingBox(meshMin, meshMax))
+                    continue;
+            }
+
+            if (softwareCull && m_SoftwareOcclusion.IsOccluded(reinterpret_cast<const float*>(&modelToSoftwareProjection),
+                reinterpret_cast<const float*>(&mesh.boundingBox.min), reinterpret_cast<const float*>(&mesh.boundingBox.max)))
+            {
+                CountOccluded(meshIndex);
+                continue;
+            }
+
+            uint32_t indexCount = mesh.indexCount;
+            uint32_t startIndex = mesh.indexDataByteOffset / sizeof(uint16_t);
+            uint32_t baseVertex = mesh.vertexDataByteOffset / VertexStride;
+
+            if (mesh.materialIndex != materialIdx)
+            {
+                if (isCutout[mesh.materialIndex] && !(Filter & kCutout) ||
+                    !isCutout[mesh.materialIndex] && !(Filter & kOpaque))
+                    continue;
+
+                materialIdx = mesh.materialIndex;
+                m_Recorder.SetDynamicDescriptors(3, 0, Model::kMaterialTexChannelCount() - 1, m_MaterialSRVs);
+                __declspec(align(16)) struct {
+                    UINT32 vmaterialIdx;
+                } psMaterialConstants;
+                psMaterialConstants.vmaterialIdx = materialIdx;
+                m_Recorder.SetDynamicConstantBufferView(2, sizeof(psMaterialConstants), &psMaterialConstants);
+            }
+
+            m_Recorder.SetConstants(5, baseVertex, materialIdx);
+
+            m_Recorder.DrawIndexed(indexCount, startIndex, baseVertex);
+        }
+    }
+}
+
+template <typename TWriter>
+static void WriteStats( TWriter& Writer, const char* Name, std::vector<float>& Samples )
+{
+    CounterStats Stats = ComputeCounterStats(Samples);
+
+    Writer.Key(Name);
+    Writer.StartObject();
+    Writer.Key("median"); Writer.Double(Stats.Median);
+    Writer.Key("mean"); Writer.Double(Stats.Mean);
+    Writer.Key("p95"); Writer.Double(Stats.P95);
+    Writer.Key("p99"); Writer.Double(Stats.P99);
+    Writer.Key("min"); Writer.Double(Stats.Min);
+    Writer.Key("max"); Writer.Double(Stats.Max);
+    Writer.EndObject();
+}
+
+bool FrameBench::WriteReport( void )
+{
+    rapidjson::StringBuffer Buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> Writer(Buffer);
+
+    Writer.StartObject();
+    Writer.Key("scene"); Writer.String(m_Options.ScenePath.c_str());
+    Writer.Key("frames"); Writer.Uint(m_FramesRecorded);
+    Writer.Key("warmupFrames"); Writer.Uint(m_Options.WarmupFrames);
+    Writer.Key("frameRate"); Writer.Double(m_Options.FrameRate);
+    Writer.Key("cascades"); Writer.Uint(m_Options.Cascades);
+    Writer.Key("lights"); Writer.Uint(m_Options.Lights);
+    Writer.Key("meshes"); Writer.Uint(m_Scene.GetModel().m_Header.meshCount);
+    Writer.Key("instances"); Writer.Uint(m_Scene.GetInstanceCount());
+
+    // Times are in microseconds, allocations are counts per frame
+    Writer.Key("frame");
+    Writer.StartObject();
+    WriteStats(Writer, "time", m_FrameTimes);
+    WriteStats(Writer, "allocations", m_FrameAllocs);
+    WriteStats(Writer, "draws", m_Draws);
+    WriteStats(Writer, "streamBytes", m_StreamBytes);
+    WriteStats(Writer, "lightShadowUpdates", m_LightShadowUpdateCounts);
+    WriteStats(Writer, "textGlyphs", m_TextGlyphCounts);
+    Writer.EndObject();
+
+    // Per frame, in the depth and color passes
+    Writer.Key("occlusion");
+    Writer.StartObject();
+    Writer.Key("triangleBudget"); Writer.Uint(m_Options.OcclusionTriangles);
+    Writer.Key("occluderMeshes"); Writer.Uint(m_SoftwareOcclusion.GetOccluderCount());
+    WriteStats(Writer, "occluders", m_OccluderCounts);
+    WriteStats(Writer, "triangles", m_OccluderTriangleCounts);
+    WriteStats(Writer, "occludedDraws", m_OccludedDrawCounts);
+    Writer.EndObject();
+
+    Writer.Key("stages");
+    Writer.StartObject();
+    for (uint32_t i = 0; i < kStageCount; ++i)
+    {
+        Writer.Key(kStageNames[i]);
+        Writer.StartObject();
+        WriteStats(Writer, "time", m_StageTimes[i]);
+        WriteStats(Writer, "allocations", m_StageAllocs[i]);
+        Writer.EndObject();
+    }
+    Writer.EndObject();
+
+    // Glyph layout throughput at the median
+    CounterStats TextTime = ComputeCounterStats(m_StageTimes[kOverlayText]);
+    CounterStats TextGlyphs = ComputeCounterStats(m_TextGlyphCounts);
+    Writer.Key("text");
+    Writer.StartObject();
+    Writer.Key("lines"); Writer.Uint(m_Options.TextLines);
+    Writer.Key("glyphsPerSecond"); Writer.Double(TextTime.Median > 0.0f ? TextGlyphs.Median / TextTime.Median * 1000000.0 : 0.0);
+    Writer.EndObject();
+
+    // Totals over all recorded frames
+    Writer.Key("recorder");
+    Writer.StartObject();
+    Writer.Key("commands"); Writer.Uint(m_RecorderTotals.Commands);
+    Writer.Key("draws"); Writer.Uint(m_RecorderTotals.Draws);
+    Writer.Key("primitives"); Writer.Uint64(m_RecorderTotals.Primitives);
+    Writer.Key("barriers"); Writer.Uint(m_RecorderTotals.Barriers);
+    Writer.Key("barrierBatches"); Writer.Uint(m_RecorderTotals.BarrierBatches);
+    Writer.Key("redundantTransitions"); Writer.Uint(m_RecorderTotals.RedundantTransitions);
+    Writer.Key("mergedTransitions"); Writer.Uint(m_RecorderTotals.MergedTransitions);
+    Writer.Key("descriptorCopies"); Writer.Uint(m_RecorderTotals.DescriptorCopies);
+    Writer.Key("descriptorCopyCalls"); Writer.Uint(m_RecorderTotals.DescriptorCopyCalls);
+    Writer.Key("descriptorHeapChanges"); Writer.Uint(m_RecorderTotals.DescriptorHeapChanges);
+    Writer.Key("rootSignatureChanges"); Writer.Uint(m_RecorderTotals.RootSignatureChanges);
+    Writer.Key("pipelineChanges"); Writer.Uint(m_RecorderTotals.PipelineChanges);
+    Writer.Key("redundantStateChanges"); Writer.Uint(m_RecorderTotals.RedundantStateChanges);
+    Writer.Key("rootParameterChanges"); Writer.Uint(m_RecorderTotals.RootParameterChanges);
+    Writer.Key("redundantRootParameters"); Writer.Uint(m_RecorderTotals.RedundantRootParameters);
+    Writer.Key("uploadBytes"); Writer.Uint64(m_RecorderTotals.UploadBytes);
+    Writer.EndObject();
+
+    // Totals over the measured frames
+    Writer.Key("jobs");
+    Writer.StartObject();
+    Writer.Key("threads"); Writer.Uint(g_JobScheduler.GetThreadCount());
+    Writer.Key("jobsRun"); Writer.Uint64(m_JobStatsAfter.JobsRun - m_JobStatsBefore.JobsRun);
+    Writer.Key("jobsStolen"); Writer.Uint64(m_JobStatsAfter.JobsStolen - m_JobStatsBefore.JobsStolen);
+    Writer.Key("failedSteals"); Writer.Uint64(m_JobStatsAfter.FailedSteals - m_JobStatsBefore.FailedSteals);
+    Writer.Key("splits"); Writer.Uint64(m_JobStatsAfter.Splits - m_JobStatsBefore.Splits);
+    Writer.Key("sleeps"); Writer.Uint64(m_JobStatsAfter.Sleeps - m_JobStatsBefore.Sleeps);
+    Writer.Key("busyMs"); Writer.Double((m_JobStatsAfter.BusyNanoseconds - m_JobStatsBefore.BusyNanoseconds) * 1e-6);
+    Writer.Key("peakQueueDepth"); Writer.Uint(m_JobStatsAfter.PeakQueueDepth);
+    Writer.EndObject();
+
+    Writer.EndObject();
+
+    std::ofstream File(m_Options.OutPath.c_str());
+    if (!File)
+    {
+        std::cerr << "Unable to write file: " << m_Options.OutPath << std::endl;
+        return false;
+    }
+
+    File << Buffer.GetString() << std::endl;
+    return true;
+}
+
+static void PrintUsage( void )
+{
+    std::cerr <<
+        "Usage:  FrameBench [options] <scene.scn>\n"
+        "        (Synthetic\\synthetic.scn at the top of the repository needs no downloaded assets)\n"
+        "        FrameBench --math-bench <path>\n"
+        "        FrameBench --cluster-bench <path>\n"
+        "\n"
+        "  --frames <count>         Frames to measure (default: one pass of the animation)\n"
+        "  --warmup <count>         Frames run before measuring (default 30)\n"
+        "  --fps <rate>             Playback rate; each frame advances the animation by 1/rate (default 60)\n"
+        "  --cascades <count>       Sun shadow cascades, 1 to 4 (default 4)\n"
+        "  --lights <count>         Lights, up to 16384; only the first 128 cast shadows (default 128)\n"
+        "  --shadow-budget <ms>     Light shadow update budget (default 0.5)\n"
+        "  --shadow-updates <count> Light shadow updates per frame (default 4)\n"
+        "  --text-lines <count>     Lines of overlay text laid out per frame (default 200)\n"
+        "  --instances <count>      Spinning copies of the first model added to the scene (default 0)\n"
+        "  --threads <count>        Job scheduler threads (default: one per hardware thread)\n"
+        "  --occlusion-triangles <count>\n"
+        "                           Software occluder triangles per frame, 0 for no occlusion culling (default 0)\n"
+        "  --trace <path>           Also write the measured frames' stages as a trace-event timeline\n"
+        "  --out <path>             Report path (default framebench.json)\n";
+}
+
+int main( int argc, char** argv )
+{
+    BenchOptions Options;
+    std::string MathBenchPath;
+    std::string ClusterBenchPath;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* Arg = argv[i];
+
+        if (Arg[0] != '-')
+        {
+            Options.ScenePath = Arg;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            PrintUsage();
+            return 2;
+        }
+
+        const char* Value = argv[++i];
+
+        if (strcmp(Arg, "--frames") == 0)
+            Options.Frames = (uint32_t)atoi(Value);
+        else if (strcmp(Arg, "--warmup") == 0)
+            Options.WarmupFrames = (uint32_t)atoi(Value);
+        else if (strcmp(Arg, "--fps") == 0)
+            Options.FrameRate = (float)atof(Value);
+        else if (strcmp(Arg, "--cascades") == 0)
+            Options.Cascades = (uint32_t)atoi(Value);
+        else if (strcmp(Arg, "--lights") == 0)
+            Options.Lights = (uint32_t)atoi(Value);
+        else if (strcmp(Arg, "--shadow-budget") == 0)
+            Options.LightShadowBudget = (float)atof(Value);
+        else if (strcmp(Arg, "--shadow-updates") == 0)
+            Options.LightShadowMaxUpdates = (uint32_t)atoi(Value);
+        else if (strcmp(Arg, "--text-lines") == 0)
+            Options.TextLines = (uint32_t)atoi(Value);
+        else if (strcmp(Arg, "--instances") == 0)
+            Options.Instances = (uint32_t)atoi(Value);
+        else if (strcmp(Arg, "--threads") == 0)
+            Options.Threads = (uint32_t)atoi(Value);
+        else if (strcmp(Arg, "--occlusion-triangles") == 0)
+            Options.OcclusionTriangles = (uint32_t)atoi(Value);
+        else if (strcmp(Arg, "--trace") == 0)
+            Options.TracePath = Value;
+        else if (strcmp(Arg, "--out") == 0)
+            Options.OutPath = Value;
+        else if (strcmp(Arg, "--math-bench") == 0)
+            MathBenchPath = Value;
+        else if (strcmp(Arg, "--cluster-bench") == 0)
+            ClusterBenchPath = Value;
+        else
+        {
+            std::cerr << "Unknown option " << Arg << std::endl;
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    if (!MathBenchPath.empty())
+    {
+        SystemTime::Initialize();
+        return RunMathBench(MathBenchPath) ? 0 : 2;
+    }
+
+    if (!ClusterBenchPath.empty())
+    {
+        SystemTime::Initialize();
+        g_JobScheduler.Initialize(Options.Threads);
+        bool Written = RunLightClusterBench(ClusterBenchPath);
+        g_JobScheduler.Shutdown();
+        return Written ? 0 : 2;
+    }
+
+    if (Options.ScenePath.empty() || Options.FrameRate <= 0.0f)
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    Options.Cascades = std::max(1u, std::min<uint32_t>(Options.Cascades, kMaxCascades));
+    Options.Lights = std::min<uint32_t>(Options.Lights, kMaxLights);
+
+    SystemTime::Initialize();
+    g_JobScheduler.Initialize(Options.Threads);
+
+    std::unique_ptr<FrameBench> Bench(new FrameBench);
+    if (!Bench->Initialize(Options))
+        return 2;
+
+    Bench->Run();
+
+    bool Written = Bench->WriteReport();
+
+    Bench.reset();
+    g_JobScheduler.Shutdown();
+
+    return Written ? 0 : 2;
+}
@@ -0,0 +1,126 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "LightClusterBench.h"
+#include "LightClusters.h"
+#include "Camera.h"
+#include "SystemTime.h"
+#include "Math/Random.h"
+#include "ART/PerfStat/PerfComparison.h"
+
+#include "prettywriter.h"
+#include "stringbuffer.h"
+
+#include <fstream>
+#include <iostream>
+
+using namespace Math;
+using namespace ART;
+
+namespace
+{
+    enum { kRepeats = 100 };
+
+    const uint32_t kLightCounts[] = { 1024, 4096, 16384 };
+
+    // Street lights and the like:  small radii spread through a 400 x 40 x 400 block, with the camera at
+    // street level looking down its length, so most lights are in view at every depth
+    void CreateLights( std::vector<LightClusterBuilder::Light>& Lights, uint32_t Count )
+    {
+        RandomNumberGenerator rng(16384);
+
+        Lights.resize(Count);
+        for (uint32_t i = 0; i < Count; ++i)
+        {
+            LightClusterBuilder::Light& Light = Lights[i];
+            Light.Position[0] = rng.NextFloat(-200.0f, 200.0f);
+            Light.Position[1] = rng.NextFloat(0.0f, 40.0f);
+            Light.Position[2] = rng.NextFloat(-200.0f, 200.0f);
+            Light.Radius = rng.NextFloat(2.0f, 10.0f);
+            Light.Type = i % LightClusterBuilder::kLightTypeCount;
+        }
+    }
+
+    LightClusterBuilder::Frustum CreateFrustum( void )
+    {
+        Camera ViewCamera;
+        ViewCamera.SetEyeAtUp(Vector3(0.0f, 2.0f, 200.0f), Vector3(0.0f, 2.0f, 0.0f), Vector3(kYUnitVector));
+        ViewCamera.SetPerspectiveMatrix(XM_PIDIV4, 9.0f / 16.0f, 1.0f, 1000.0f);
+        ViewCamera.Update();
+
+        LightClusterBuilder::Frustum Frustum;
+        memcpy(Frustum.ViewMatrix, &ViewCamera.GetViewMatrix(), sizeof(Frustum.ViewMatrix));
+        Frustum.ProjScaleX = ViewCamera.GetProjMatrix().GetX().GetX();
+        Frustum.ProjScaleY = ViewCamera.GetProjMatrix().GetY().GetY();
+        Frustum.NearClip = ViewCamera.GetNearClip();
+        Frustum.FarClip = ViewCamera.GetFarClip();
+        return Frustum;
+    }
+}
+
+bool RunLightClusterBench( const std::string& OutPath )
+{
+    const LightClusterBuilder::Frustum Frustum = CreateFrustum();
+    LightClusterBuilder Builder;
+    std::vector<LightClusterBuilder::Light> Lights;
+
+    rapidjson::StringBuffer Buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> Writer(Buffer);
+
+    Writer.StartObject();
+    Writer.Key("clusters"); Writer.Uint(Builder.GetClusterCount());
+
+    // Times are in milliseconds per build
+    Writer.Key("benchmarks");
+    Writer.StartArray();
+
+    for (uint32_t LightCount : kLightCounts)
+    {
+        CreateLights(Lights, LightCount);
+
+        // Warm the caches and size the builder's arrays
+        Builder.Build(Frustum, Lights.data(), LightCount);
+
+        std::vector<float> Samples;
+        Samples.reserve(kRepeats);
+        for (uint32_t i = 0; i < kRepeats; ++i)
+        {
+            int64_t StartTick = SystemTime::GetCurrentTick();
+            Builder.Build(Frustum, Lights.data(), LightCount);
+            int64_t EndTick = SystemTime::GetCurrentTick();
+            Samples.push_back((float)(SystemTime::TimeBetweenTicks(StartTick, EndTick) * 1000.0));
+        }
+
+        CounterStats Stats = ComputeCounterStats(Samples);
+        std::cout << LightCount << " lights:  " << Stats.Median << " ms per build, "
+            << Builder.GetLightIndices().size() << " light indices" << std::endl;
+
+        Writer.StartObject();
+        Writer.Key("lights"); Writer.Uint(LightCount);
+        Writer.Key("lightIndices"); Writer.Uint((uint32_t)Builder.GetLightIndices().size());
+        Writer.Key("median"); Writer.Double(Stats.Median);
+        Writer.Key("p95"); Writer.Double(Stats.P95);
+        Writer.Key("min"); Writer.Double(Stats.Min);
+        Writer.EndObject();
+    }
+
+    Writer.EndArray();
+    Writer.EndObject();
+
+    std::ofstream File(OutPath.c_str());
+    if (!File)
+    {
+        std::cerr << "Unable to write file: " << OutPath << std::endl;
+        return false;
+    }
+
+    File << Buffer.GetString() << std::endl;
+    return true;
+}
@@ -0,0 +1,18 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Benchmark of LightClusterBuilder::Build() with 1k to 16k lights spread through a
+// synthetic city block, far more than ModelViewer's 128.
+//
+
+#pragma once
+
+#include <string>
+
+// Writes milliseconds per build for each light count, as JSON.  Needs the job scheduler.
+bool RunLightClusterBench( const std::string& OutPath );
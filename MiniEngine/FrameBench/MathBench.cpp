@@ -0,0 +1,290 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "pch.h"
+#include "MathBench.h"
+#include "Camera.h"
+#include "SystemTime.h"
+#include "Math/Random.h"
+#include "Math/VectorBatch.h"
+#include "ART/PerfStat/PerfComparison.h"
+
+#include "prettywriter.h"
+#include "stringbuffer.h"
+
+#include <cfloat>
+#include <fstream>
+#include <iostream>
+
+using namespace Math;
+using namespace ART;
+
+namespace
+{
+    // Enough elements to leave the L1 cache, few enough to stay in L2
+    enum { kElementCount = 16384, kRepeats = 200 };
+
+    // Position, normal and texture coordinate, like a simple vertex format
+    struct Vertex
+    {
+        float Position[3];
+        float Normal[3];
+        float TexCoord[2];
+    };
+
+    struct BenchData
+    {
+        std::vector<Vector3> Points;
+        std::vector<Vector3> BoxMin;
+        std::vector<Vector3> BoxMax;
+        std::vector<Vertex> Vertices;
+        Vector3Stream PointStream;
+        Vector3Stream BoxMinStream;
+        Vector3Stream BoxMaxStream;
+
+        std::vector<Vector3> OutPoints;
+        std::vector<Vector3> OutBoxMin;
+        std::vector<Vector3> OutBoxMax;
+        std::vector<uint8_t> Visible;
+        Vector3Stream OutPointStream;
+        Vector3Stream OutBoxMinStream;
+        Vector3Stream OutBoxMaxStream;
+
+        Matrix4 Xform;
+        Frustum ViewFrustum;
+        Vector3 ResultMin;
+        Vector3 ResultMax;
+        uint32_t ResultCount;
+    };
+
+    // Nanoseconds per element of each run
+    template <typename TBody>
+    std::vector<float> TimeRuns( const TBody& Body )
+    {
+        // Warm the caches and the branch predictors
+        Body();
+
+        std::vector<float> Samples;
+        Samples.reserve(kRepeats);
+        for (uint32_t i = 0; i < kRepeats; ++i)
+        {
+            int64_t StartTick = SystemTime::GetCurrentTick();
+            Body();
+            int64_t EndTick = SystemTime::GetCurrentTick();
+            Samples.push_back((float)(SystemTime::TimeBetweenTicks(StartTick, EndTick) * 1e9 / kElementCount));
+        }
+        return Samples;
+    }
+
+    void CreateData( BenchData& Data )
+    {
+        RandomNumberGenerator rng(4711);
+        auto RandomVector = [&rng]( float Scale ) -> Vector3
+        {
+            float x = rng.NextFloat(-Scale, Scale);
+            float y = rng.NextFloat(-Scale, Scale);
+            float z = rng.NextFloat(-Scale, Scale);
+            return Vector3(x, y, z);
+        };
+
+        Data.Points.resize(kElementCount);
+        Data.BoxMin.resize(kElementCount);
+        Data.BoxMax.resize(kElementCount);
+        Data.Vertices.resize(kElementCount);
+        Data.PointStream.Resize(kElementCount);
+        Data.BoxMinStream.Resize(kElementCount);
+        Data.BoxMaxStream.Resize(kElementCount);
+
+        for (uint32_t i = 0; i < kElementCount; ++i)
+        {
+            Vector3 Point = RandomVector(100.0f);
+            Vector3 Extent = Abs(RandomVector(5.0f));
+
+            Data.Points[i] = Point;
+            Data.BoxMin[i] = Point - Extent;
+            Data.BoxMax[i] = Point + Extent;
+            Data.PointStream.Set(i, Point);
+            Data.BoxMinStream.Set(i, Point - Extent);
+            Data.BoxMaxStream.Set(i, Point + Extent);
+
+            Vertex& v = Data.Vertices[i];
+            v.Position[0] = Point.GetX();
+            v.Position[1] = Point.GetY();
+            v.Position[2] = Point.GetZ();
+            v.Normal[0] = v.Normal[1] = 0.0f;
+            v.Normal[2] = 1.0f;
+            v.TexCoord[0] = v.TexCoord[1] = 0.5f;
+        }
+
+        Data.OutPoints.resize(kElementCount);
+        Data.OutBoxMin.resize(kElementCount);
+        Data.OutBoxMax.resize(kElementCount);
+        Data.Visible.resize(kElementCount);
+
+        Data.Xform = Matrix4(Matrix3::MakeYRotation(0.5f) * Matrix3::MakeScale(1.0f, 2.0f, 0.5f), Vector3(10.0f, -5.0f, 3.0f));
+
+        // Looking into the cloud from its edge, so that about a third of the boxes are visible
+        Camera ViewCamera;
+        ViewCamera.SetEyeAtUp(Vector3(0.0f, 0.0f, 120.0f), Vector3(kZero), Vector3(kYUnitVector));
+        ViewCamera.SetPerspectiveMatrix(XM_PIDIV4, 9.0f / 16.0f, 1.0f, 500.0f);
+        ViewCamera.Update();
+        Data.ViewFrustum = ViewCamera.GetWorldSpaceFrustum();
+    }
+
+    template <typename TWriter>
+    void WriteComparison( TWriter& Writer, const char* Name, std::vector<float>& AoS, std::vector<float>& Wide )
+    {
+        CounterStats AoSStats = ComputeCounterStats(AoS);
+        CounterStats WideStats = ComputeCounterStats(Wide);
+
+        std::cout << Name << ":  " << AoSStats.Median << " ns -> " << WideStats.Median << " ns per element ("
+            << AoSStats.Median / WideStats.Median << "x)" << std::endl;
+
+        Writer.Key(Name);
+        Writer.StartObject();
+        Writer.Key("aos");
+        Writer.StartObject();
+        Writer.Key("median"); Writer.Double(AoSStats.Median);
+        Writer.Key("p95"); Writer.Double(AoSStats.P95);
+        Writer.Key("min"); Writer.Double(AoSStats.Min);
+        Writer.EndObject();
+        Writer.Key("wide");
+        Writer.StartObject();
+        Writer.Key("median"); Writer.Double(WideStats.Median);
+        Writer.Key("p95"); Writer.Double(WideStats.P95);
+        Writer.Key("min"); Writer.Double(WideStats.Min);
+        Writer.EndObject();
+        Writer.Key("speedup"); Writer.Double(AoSStats.Median / WideStats.Median);
+        Writer.EndObject();
+    }
+}
+
+bool RunMathBench( const std::string& OutPath )
+{
+    BenchData Data;
+    CreateData(Data);
+
+    rapidjson::StringBuffer Buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> Writer(Buffer);
+
+    Writer.StartObject();
+    Writer.Key("lanes"); Writer.Uint(FloatXN::kLanes);
+    Writer.Key("elements"); Writer.Uint(kElementCount);
+
+    // Times are in nanoseconds per element
+    Writer.Key("benchmarks");
+    Writer.StartObject();
+
+    {
+        std::vector<float> AoS = TimeRuns([&]()
+        {
+            for (uint32_t i = 0; i < kElementCount; ++i)
+                Data.OutPoints[i] = Vector3(Data.Xform * Data.Points[i]);
+        });
+        std::vector<float> Wide = TimeRuns([&]()
+        {
+            TransformPoints(Data.Xform, Data.PointStream, Data.OutPointStream);
+        });
+        WriteComparison(Writer, "transformPoints", AoS, Wide);
+    }
+
+    {
+        std::vector<float> AoS = TimeRuns([&]()
+        {
+            const Vector3 AxisX = Abs(Vector3(Data.Xform.GetX()));
+            const Vector3 AxisY = Abs(Vector3(Data.Xform.GetY()));
+            const Vector3 AxisZ = Abs(Vector3(Data.Xform.GetZ()));
+            for (uint32_t i = 0; i < kElementCount; ++i)
+            {
+                Vector3 Center = Vector3(Data.Xform * ((Data.BoxMin[i] + Data.BoxMax[i]) * 0.5f));
+                Vector3 Extent = (Data.BoxMax[i] - Data.BoxMin[i]) * 0.5f;
+                Extent = AxisX * Extent.GetX() + AxisY * Extent.GetY() + AxisZ * Extent.GetZ();
+                Data.OutBoxMin[i] = Center - Extent;
+                Data.OutBoxMax[i] = Center + Extent;
+            }
+        });
+        std::vector<float> Wide = TimeRuns([&]()
+        {
+            TransformBounds(Data.Xform, Data.BoxMinStream, Data.BoxMaxStream, Data.OutBoxMinStream, Data.OutBoxMaxStream);
+        });
+        WriteComparison(Writer, "transformBounds", AoS, Wide);
+    }
+
+    {
+        std::vector<float> AoS = TimeRuns([&]()
+        {
+            uint32_t Count = 0;
+            for (uint32_t i = 0; i < kElementCount; ++i)
+            {
+                Data.Visible[i] = Data.ViewFrustum.IntersectBoundingBox(Data.BoxMin[i], Data.BoxMax[i]) ? 1 : 0;
+                Count += Data.Visible[i];
+            }
+            Data.ResultCount = Count;
+        });
+        std::vector<float> Wide = TimeRuns([&]()
+        {
+            Data.ResultCount = IntersectBoundingBoxes(Data.ViewFrustum, Data.BoxMinStream, Data.BoxMaxStream, Data.Visible.data());
+        });
+        WriteComparison(Writer, "frustumTest", AoS, Wide);
+    }
+
+    {
+        // Model::ComputeMeshBoundingBox before it used the wide loop
+        std::vector<float> AoS = TimeRuns([&]()
+        {
+            Vector3 MinBound(FLT_MAX, FLT_MAX, FLT_MAX), MaxBound(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+            for (uint32_t i = 0; i < kElementCount; ++i)
+            {
+                const float* p = Data.Vertices[i].Position;
+                Vector3 Position(p[0], p[1], p[2]);
+                MinBound = Min(MinBound, Position);
+                MaxBound = Max(MaxBound, Position);
+            }
+            Data.ResultMin = MinBound;
+            Data.ResultMax = MaxBound;
+        });
+        std::vector<float> Wide = TimeRuns([&]()
+        {
+            ComputeBounds(Data.Vertices[0].Position, sizeof(Vertex), kElementCount, Data.ResultMin, Data.ResultMax);
+        });
+        WriteComparison(Writer, "vertexBounds", AoS, Wide);
+    }
+
+    {
+        std::vector<float> AoS = TimeRuns([&]()
+        {
+            Vector3 MinBound(FLT_MAX, FLT_MAX, FLT_MAX), MaxBound(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+            for (uint32_t i = 0; i < kElementCount; ++i)
+            {
+                MinBound = Min(MinBound, Data.Points[i]);
+                MaxBound = Max(MaxBound, Data.Points[i]);
+            }
+            Data.ResultMin = MinBound;
+            Data.ResultMax = MaxBound;
+        });
+        std::vector<float> Wide = TimeRuns([&]()
+        {
+            ComputeBounds(Data.PointStream, Data.ResultMin, Data.ResultMax);
+        });
+        WriteComparison(Writer, "pointBounds", AoS, Wide);
+    }
+
+    Writer.EndObject();
+    Writer.EndObject();
+
+    std::ofstream File(OutPath.c_str());
+    if (!File)
+    {
+        std::cerr << "Unable to write file: " << OutPath << std::endl;
+        return false;
+    }
+
+    File << Buffer.GetString() << std::endl;
+    return true;
+}
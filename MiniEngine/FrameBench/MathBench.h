@@ -0,0 +1,18 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Microbenchmarks of the bulk loops in Math/VectorBatch.h against the same work done one
+// Vector3 or Matrix4 at a time.
+//
+
+#pragma once
+
+#include <string>
+
+// Writes nanoseconds per element for both versions of each loop, as JSON
+bool RunMathBench( const std::string& OutPath );
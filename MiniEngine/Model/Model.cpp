@@ -12,6 +12,7 @@
 //
 
 #include "Model.h"
+#include "Math/VectorBatch.h"
 #include <string.h>
 #include <float.h>
 
@@ -23,6 +24,7 @@ Model::Model()
     , m_pVertexDataDepth(nullptr)
     , m_pIndexDataDepth(nullptr)
     , m_SRVs(nullptr)
+    , m_pMaterialTextures(nullptr)
 {
     Clear();
 }
@@ -66,6 +68,14 @@ void Model::Clear()
     m_Header.boundingBox.max = Vector3(0.0f);
 }
 
+void Model::ReleaseDepthGeometry()
+{
+    delete [] m_pVertexDataDepth;
+    delete [] m_pIndexDataDepth;
+    m_pVertexDataDepth = nullptr;
+    m_pIndexDataDepth = nullptr;
+}
+
 // assuming at least 3 floats for position
 void Model::ComputeMeshBoundingBox(unsigned int meshIndex, BoundingBox &bbox) const
 {
@@ -73,22 +83,10 @@ void Model::ComputeMeshBoundingBox(unsigned int meshIndex, BoundingBox &bbox) co
 
     if (mesh->vertexCount > 0)
     {
-        unsigned int vertexStride = mesh->vertexStride;
-
         const float *p = (float*)(m_pVertexData + mesh->vertexDataByteOffset + mesh->attrib[attrib_position].offset);
-        const float *pEnd = (float*)(m_pVertexData + mesh->vertexDataByteOffset + mesh->vertexCount * mesh->vertexStride + mesh->attrib[attrib_position].offset);
-        bbox.min = Scalar(FLT_MAX);
-        bbox.max = Scalar(-FLT_MAX);
 
-        while (p < pEnd)
-        {
-            Vector3 pos(*(p + 0), *(p + 1), *(p + 2));
-
-            bbox.min = Min(bbox.min, pos);
-            bbox.max = Max(bbox.max, pos);
-
-            (*(uint8_t**)&p) += vertexStride;
-        }
+        // Several vertices per iteration, one in each SIMD lane
+        ComputeBounds(p, mesh->vertexStride, mesh->vertexCount, bbox.min, bbox.max);
     }
     else
     {
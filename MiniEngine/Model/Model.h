@@ -213,6 +213,23 @@ public:
 		return LoadH3D(filename);
 	}
 
+	// Reads only the header, mesh, and material tables.  No vertex data, GPU buffers, or textures are
+	// created, so this works without a device.
+	bool LoadTables(const char* filename)
+	{
+		return LoadH3DTables(filename);
+	}
+
+	// Reads the depth-only positions and indices back into m_pVertexDataDepth and m_pIndexDataDepth, which
+	// Load frees once they are on the GPU, for CPU work such as picking software occluders.  The tables must
+	// be loaded already.
+	bool LoadDepthGeometry(const char* filename)
+	{
+		return LoadH3DDepthGeometry(filename);
+	}
+
+	void ReleaseDepthGeometry();
+
 	const BoundingBox& GetBoundingBox() const
 	{
 		return m_Header.boundingBox;
@@ -223,6 +240,17 @@ public:
         return m_SRVs + materialIdx * MaterialTexChannel_Count;
     }
 
+    // Keeps the material's textures resident under the texture memory budget
+    void MarkMaterialUsed( uint32_t materialIdx ) const
+    {
+        const ManagedTexture* const* textures = m_pMaterialTextures + materialIdx * MaterialTexChannel_Count;
+        for (uint32_t n = 0; n < MaterialTexChannel_Count; ++n)
+        {
+            if (textures[n] != nullptr)
+                textures[n]->MarkUsed();
+        }
+    }
+
 	static constexpr uint32_t kMaterialTexChannelCount() {
 		return MaterialTexChannel_Count;
 	}
@@ -230,6 +258,9 @@ public:
 protected:
 
 	bool LoadH3D(const char *filename);
+	bool LoadH3DTables(const char *filename);
+	bool LoadH3DDepthGeometry(const char *filename);
+	bool ReadH3DTables(FILE *file);
 	bool SaveH3D(const char *filename) const;
 
 	void ComputeMeshBoundingBox(unsigned int meshIndex, BoundingBox &bbox) const;
@@ -239,4 +270,5 @@ protected:
     void ReleaseTextures();
     void LoadTextures();
     D3D12_CPU_DESCRIPTOR_HANDLE* m_SRVs;
+    const ManagedTexture** m_pMaterialTextures;
 };
@@ -19,25 +19,90 @@
 #include "CommandContext.h"
 #include <stdio.h>
 
-bool Model::LoadH3D(const char *filename)
+bool Model::ReadH3DTables(FILE *file)
+{
+    if (1 != fread(&m_Header, sizeof(Header), 1, file))
+        return false;
+
+    m_pMesh = new Mesh [m_Header.meshCount];
+    m_pMaterial = new Material [m_Header.materialCount];
+
+    if (m_Header.meshCount > 0)
+        if (1 != fread(m_pMesh, sizeof(Mesh) * m_Header.meshCount, 1, file)) return false;
+    if (m_Header.materialCount > 0)
+        if (1 != fread(m_pMaterial, sizeof(Material) * m_Header.materialCount, 1, file)) return false;
+
+    return true;
+}
+
+bool Model::LoadH3DTables(const char *filename)
+{
+    FILE *file = nullptr;
+    if (0 != fopen_s(&file, filename, "rb"))
+        return false;
+
+    bool ok = ReadH3DTables(file);
+
+    if (ok && m_Header.meshCount > 0)
+    {
+        m_VertexStride = m_pMesh[0].vertexStride;
+        m_VertexStrideDepth = m_pMesh[0].vertexStrideDepth;
+    }
+
+    if (EOF == fclose(file))
+        ok = false;
+
+    return ok;
+}
+
+bool Model::LoadH3DDepthGeometry(const char *filename)
 {
+    ReleaseDepthGeometry();
+
     FILE *file = nullptr;
     if (0 != fopen_s(&file, filename, "rb"))
         return false;
 
     bool ok = false;
 
-    if (1 != fread(&m_Header, sizeof(Header), 1, file)) goto h3d_load_fail;
+    // The depth-only data follows the tables and the full vertex and index data
+    const long offset = (long)(sizeof(Header) + sizeof(Mesh) * m_Header.meshCount + sizeof(Material) * m_Header.materialCount +
+        m_Header.vertexDataByteSize + m_Header.indexDataByteSize);
 
-    m_pMesh = new Mesh [m_Header.meshCount];
-    m_pMaterial = new Material [m_Header.materialCount];
+    m_pVertexDataDepth = new unsigned char[ m_Header.vertexDataByteSizeDepth ];
+    m_pIndexDataDepth = new unsigned char[ m_Header.indexDataByteSize ];
 
-	m_pMaterialConstants = new RenderMaterial[m_Header.materialCount];
+    if (0 != fseek(file, offset, SEEK_SET)) goto h3d_depth_fail;
 
-    if (m_Header.meshCount > 0)
-        if (1 != fread(m_pMesh, sizeof(Mesh) * m_Header.meshCount, 1, file)) goto h3d_load_fail;
-    if (m_Header.materialCount > 0)
-        if (1 != fread(m_pMaterial, sizeof(Material) * m_Header.materialCount, 1, file)) goto h3d_load_fail;
+    if (m_Header.vertexDataByteSizeDepth > 0)
+        if (1 != fread(m_pVertexDataDepth, m_Header.vertexDataByteSizeDepth, 1, file)) goto h3d_depth_fail;
+    if (m_Header.indexDataByteSize > 0)
+        if (1 != fread(m_pIndexDataDepth, m_Header.indexDataByteSize, 1, file)) goto h3d_depth_fail;
+
+    ok = true;
+
+h3d_depth_fail:
+
+    if (EOF == fclose(file))
+        ok = false;
+
+    if (!ok)
+        ReleaseDepthGeometry();
+
+    return ok;
+}
+
+bool Model::LoadH3D(const char *filename)
+{
+    FILE *file = nullptr;
+    if (0 != fopen_s(&file, filename, "rb"))
+        return false;
+
+    bool ok = false;
+
+    if (!ReadH3DTables(file)) goto h3d_load_fail;
+
+	m_pMaterialConstants = new RenderMaterial[m_Header.materialCount];
 
     m_VertexStride = m_pMesh[0].vertexStride;
     m_VertexStrideDepth = m_pMesh[0].vertexStrideDepth;
@@ -162,6 +227,9 @@ void Model::ReleaseTextures()
         delete [] m_Textures;
     }
     */
+
+    delete [] m_pMaterialTextures;
+    m_pMaterialTextures = nullptr;
 }
 
 void Model::LoadTextures(void)
@@ -171,6 +239,7 @@ void Model::LoadTextures(void)
 	const int numTexChannels = MaterialTexChannel_Count;
 
     m_SRVs = new D3D12_CPU_DESCRIPTOR_HANDLE[m_Header.materialCount * numTexChannels];
+    m_pMaterialTextures = new const ManagedTexture*[m_Header.materialCount * numTexChannels]();
 
     const ManagedTexture* MatTextures[numTexChannels] = {};
 
@@ -265,5 +334,10 @@ void Model::LoadTextures(void)
 		m_SRVs[matBaseOffset + MaterialTexChannel_Opacity] = MatTextures[MaterialTexChannel_Opacity]->GetSRV();
 		//m_SRVs[matBaseOffset + MaterialTexChannel_Constants] = m_MaterialConstants.GetSRV();
 
+		m_pMaterialTextures[matBaseOffset + MaterialTexChannel_Diffuse] = MatTextures[MaterialTexChannel_Diffuse];
+		m_pMaterialTextures[matBaseOffset + MaterialTexChannel_Specular] = MatTextures[MaterialTexChannel_Specular];
+		m_pMaterialTextures[matBaseOffset + MaterialTexChannel_Normal] = MatTextures[MaterialTexChannel_Normal];
+		m_pMaterialTextures[matBaseOffset + MaterialTexChannel_Opacity] = MatTextures[MaterialTexChannel_Opacity];
+
 	}
 }
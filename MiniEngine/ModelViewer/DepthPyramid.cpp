@@ -0,0 +1,221 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Built without the precompiled header so it has no dependency on Windows
+#include "DepthPyramid.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+
+using namespace std;
+
+namespace
+{
+    uint32_t FloorPowerOfTwo( uint32_t Value )
+    {
+        uint32_t Result = 1;
+        while (Result * 2 <= Value)
+            Result *= 2;
+        return Result;
+    }
+}
+
+DepthPyramid::DepthPyramid()
+{
+}
+
+void DepthPyramid::GetBaseSize( uint32_t Width, uint32_t Height, uint32_t& BaseWidth, uint32_t& BaseHeight )
+{
+    BaseWidth = min<uint32_t>(FloorPowerOfTwo(Width), kMaxBaseSize);
+    BaseHeight = min<uint32_t>(FloorPowerOfTwo(Height), kMaxBaseSize);
+}
+
+uint32_t DepthPyramid::GetLevelCount( uint32_t BaseWidth, uint32_t BaseHeight )
+{
+    uint32_t LevelCount = 1;
+    while ((BaseWidth | BaseHeight) >> LevelCount)
+        ++LevelCount;
+    return LevelCount;
+}
+
+void DepthPyramid::Reset( uint32_t BaseWidth, uint32_t BaseHeight, uint32_t LevelCount )
+{
+    assert(BaseWidth > 0 && (BaseWidth & (BaseWidth - 1)) == 0 && "Base width must be a power of two");
+    assert(BaseHeight > 0 && (BaseHeight & (BaseHeight - 1)) == 0 && "Base height must be a power of two");
+    assert(LevelCount > 0 && LevelCount <= GetLevelCount(BaseWidth, BaseHeight));
+
+    m_Levels.resize(LevelCount);
+
+    size_t Offset = 0;
+    for (uint32_t i = 0; i < LevelCount; ++i)
+    {
+        LevelDesc& L = m_Levels[i];
+        L.Width = max(BaseWidth >> i, 1u);
+        L.Height = max(BaseHeight >> i, 1u);
+        L.Offset = Offset;
+        Offset += (size_t)L.Width * L.Height;
+    }
+
+    m_Data.resize(Offset);
+}
+
+void DepthPyramid::Clear( void )
+{
+    m_Levels.clear();
+    m_Data.clear();
+}
+
+void DepthPyramid::Build( const float* Depth, uint32_t Width, uint32_t Height, uint32_t RowPitch )
+{
+    uint32_t BaseWidth, BaseHeight;
+    GetBaseSize(Width, Height, BaseWidth, BaseHeight);
+    Reset(BaseWidth, BaseHeight, GetLevelCount(BaseWidth, BaseHeight));
+
+    // Level 0 texel x overlaps depth texels [x * Width / BaseWidth, ((x + 1) * Width - 1) / BaseWidth]
+    float* Base = GetLevelData(0);
+    for (uint32_t y = 0; y < BaseHeight; ++y)
+    {
+        const uint32_t FirstRow = y * Height / BaseHeight;
+        const uint32_t LastRow = ((y + 1) * Height - 1) / BaseHeight;
+
+        for (uint32_t x = 0; x < BaseWidth; ++x)
+        {
+            const uint32_t FirstColumn = x * Width / BaseWidth;
+            const uint32_t LastColumn = ((x + 1) * Width - 1) / BaseWidth;
+
+            float MaxDepth = 0.0f;
+            for (uint32_t Row = FirstRow; Row <= LastRow; ++Row)
+                for (uint32_t Column = FirstColumn; Column <= LastColumn; ++Column)
+                    MaxDepth = max(MaxDepth, Depth[Row * RowPitch + Column]);
+
+            Base[y * BaseWidth + x] = MaxDepth;
+        }
+    }
+
+    // A level of size 1 along an axis has a parent of size 1 or 2 along it
+    for (uint32_t i = 1; i < GetLevelCount(); ++i)
+    {
+        const uint32_t SrcWidth = GetWidth(i - 1);
+        const uint32_t SrcHeight = GetHeight(i - 1);
+        const float* Src = GetLevelData(i - 1);
+        float* Dst = GetLevelData(i);
+
+        for (uint32_t y = 0; y < GetHeight(i); ++y)
+        {
+            const uint32_t y0 = y * 2;
+            const uint32_t y1 = min(y0 + 1, SrcHeight - 1);
+
+            for (uint32_t x = 0; x < GetWidth(i); ++x)
+            {
+                const uint32_t x0 = x * 2;
+                const uint32_t x1 = min(x0 + 1, SrcWidth - 1);
+
+                Dst[y * GetWidth(i) + x] = max(
+                    max(Src[y0 * SrcWidth + x0], Src[y0 * SrcWidth + x1]),
+                    max(Src[y1 * SrcWidth + x0], Src[y1 * SrcWidth + x1]));
+            }
+        }
+    }
+}
+
+bool DepthPyramid::ProjectBounds( const float* M, const float* BoundsMin, const float* BoundsMax, ScreenRect& Rect )
+{
+    Rect.MinU = Rect.MinV = Rect.MinW = FLT_MAX;
+    Rect.MaxU = Rect.MaxV = -FLT_MAX;
+
+    for (uint32_t Corner = 0; Corner < 8; ++Corner)
+    {
+        const float P[3] =
+        {
+            Corner & 1 ? BoundsMax[0] : BoundsMin[0],
+            Corner & 2 ? BoundsMax[1] : BoundsMin[1],
+            Corner & 4 ? BoundsMax[2] : BoundsMin[2]
+        };
+
+        // Row r of the matrix maps an object space point to clip coordinate r
+        float Clip[4];
+        for (int r = 0; r < 4; ++r)
+            Clip[r] = M[r] * P[0] + M[4 + r] * P[1] + M[8 + r] * P[2] + M[12 + r];
+
+        if (Clip[3] <= 0.0f)
+            return false;
+
+        const float U = 0.5f + 0.5f * Clip[0] / Clip[3];
+        const float V = 0.5f - 0.5f * Clip[1] / Clip[3];
+        Rect.MinU = min(Rect.MinU, U);
+        Rect.MaxU = max(Rect.MaxU, U);
+        Rect.MinV = min(Rect.MinV, V);
+        Rect.MaxV = max(Rect.MaxV, V);
+        Rect.MinW = min(Rect.MinW, Clip[3]);
+    }
+
+    return true;
+}
+
+bool DepthPyramid::IsRectOccluded( ScreenRect Rect, float InvFarClip, float DepthBias, float MarginTexels ) const
+{
+    // Off screen boxes are left to frustum culling
+    if (Rect.MaxU < 0.0f || Rect.MinU > 1.0f || Rect.MaxV < 0.0f || Rect.MinV > 1.0f)
+        return false;
+
+    const float BaseWidth = (float)GetWidth(0);
+    const float BaseHeight = (float)GetHeight(0);
+    Rect.MinU = max(Rect.MinU - MarginTexels / BaseWidth, 0.0f);
+    Rect.MaxU = min(Rect.MaxU + MarginTexels / BaseWidth, 1.0f);
+    Rect.MinV = max(Rect.MinV - MarginTexels / BaseHeight, 0.0f);
+    Rect.MaxV = min(Rect.MaxV + MarginTexels / BaseHeight, 1.0f);
+
+    // The first level where the rectangle is at most a texel wide, so it touches at most 2 x 2 texels
+    const float Extent = max((Rect.MaxU - Rect.MinU) * BaseWidth, (Rect.MaxV - Rect.MinV) * BaseHeight);
+    uint32_t LevelIndex = 0;
+    while (LevelIndex + 1 < GetLevelCount() && (float)(1u << LevelIndex) < Extent)
+        ++LevelIndex;
+
+    const uint32_t Width = GetWidth(LevelIndex);
+    const uint32_t Height = GetHeight(LevelIndex);
+    const uint32_t x0 = min((uint32_t)(Rect.MinU * Width), Width - 1);
+    const uint32_t x1 = min((uint32_t)(Rect.MaxU * Width), Width - 1);
+    const uint32_t y0 = min((uint32_t)(Rect.MinV * Height), Height - 1);
+    const uint32_t y1 = min((uint32_t)(Rect.MaxV * Height), Height - 1);
+
+    const float* Data = GetLevelData(LevelIndex);
+    float MaxDepth = 0.0f;
+    for (uint32_t y = y0; y <= y1; ++y)
+        for (uint32_t x = x0; x <= x1; ++x)
+            MaxDepth = max(MaxDepth, Data[y * Width + x]);
+
+    return Rect.MinW * InvFarClip > MaxDepth + DepthBias;
+}
+
+bool DepthPyramid::IsOccluded( const float* M, const float* BoundsMin, const float* BoundsMax,
+    float InvFarClip, float DepthBias ) const
+{
+    ScreenRect Rect;
+    if (IsEmpty() || !ProjectBounds(M, BoundsMin, BoundsMax, Rect))
+        return false;
+
+    // Grown by a texel to absorb jitter
+    return IsRectOccluded(Rect, InvFarClip, DepthBias, 1.0f);
+}
+
+bool DepthPyramid::IsOccludedReprojected( const float* M, const float* CurrentM, const float* BoundsMin, const float* BoundsMax,
+    float InvFarClip, float DepthBias, float MarginTexels ) const
+{
+    ScreenRect Rect, CurrentRect;
+    if (IsEmpty() || !ProjectBounds(M, BoundsMin, BoundsMax, Rect) || !ProjectBounds(CurrentM, BoundsMin, BoundsMax, CurrentRect))
+        return false;
+
+    // Only the screen position is taken from the current projection.  Depth is compared in the pyramid's.
+    Rect.MinU = min(Rect.MinU, CurrentRect.MinU);
+    Rect.MaxU = max(Rect.MaxU, CurrentRect.MaxU);
+    Rect.MinV = min(Rect.MinV, CurrentRect.MinV);
+    Rect.MaxV = max(Rect.MaxV, CurrentRect.MaxV);
+
+    return IsRectOccluded(Rect, InvFarClip, DepthBias, 1.0f + MarginTexels);
+}
@@ -0,0 +1,96 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  CPU version of the hierarchical-Z pyramid used for occlusion culling.  Each texel holds
+// the farthest linear depth (0 at the eye, 1 at the far plane) of the screen area it covers.  Level 0
+// has power-of-two dimensions no larger than the depth image, and each further level halves them, so
+// texel (x, y) of a W x H level covers exactly the UV range [x / W, (x + 1) / W] x [y / H, (y + 1) / H].
+//
+// DepthPyramidInitCS, DepthPyramidDownsampleCS and the occlusion test in IndirectCullCS are the GPU
+// versions of Build and IsOccluded.  ModelViewer also reads back the coarse levels of the GPU pyramid
+// into this class to cull the draws it records on the CPU.  Nothing here touches a device, so the build
+// and the test can be checked against hand-made depth images.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class DepthPyramid
+{
+public:
+
+    // Keeps the pyramid within the 12 mip UAVs of a ColorBuffer
+    enum { kMaxBaseSize = 1024, kMaxLevelCount = 11 };
+
+    DepthPyramid();
+
+    // Level 0 of a pyramid built from a Width x Height depth image
+    static void GetBaseSize( uint32_t Width, uint32_t Height, uint32_t& BaseWidth, uint32_t& BaseHeight );
+
+    // Levels down to 1 x 1
+    static uint32_t GetLevelCount( uint32_t BaseWidth, uint32_t BaseHeight );
+
+    // RowPitch is in floats.  Level 0 texels take the farthest of the depth texels they overlap, and every
+    // further texel the farthest of its 2 x 2 parent texels.
+    void Build( const float* Depth, uint32_t Width, uint32_t Height, uint32_t RowPitch );
+
+    // Sizes the levels without filling them, e.g. to copy in levels read back from the GPU.  BaseWidth
+    // and BaseHeight must be powers of two.
+    void Reset( uint32_t BaseWidth, uint32_t BaseHeight, uint32_t LevelCount );
+    void Clear( void );
+
+    bool IsEmpty( void ) const { return m_Levels.empty(); }
+    uint32_t GetLevelCount( void ) const { return (uint32_t)m_Levels.size(); }
+    uint32_t GetWidth( uint32_t Level ) const { return m_Levels[Level].Width; }
+    uint32_t GetHeight( uint32_t Level ) const { return m_Levels[Level].Height; }
+
+    // Rows are GetWidth(Level) floats apart
+    float* GetLevelData( uint32_t Level ) { return m_Data.data() + m_Levels[Level].Offset; }
+    const float* GetLevelData( uint32_t Level ) const { return m_Data.data() + m_Levels[Level].Offset; }
+
+    // True when the box lies entirely behind the depth in the pyramid.  ModelToProjection (16 floats in
+    // Math::Matrix4 layout) must place the box in the projection the depth was rendered with, and
+    // InvFarClip turns clip w into linear depth.  The box is tested at the level where its screen rectangle,
+    // grown by a texel to absorb jitter, spans at most 2 x 2 texels.  Boxes reaching behind the eye are
+    // never occluded, and neither is anything when the pyramid is empty.
+    bool IsOccluded( const float* ModelToProjection, const float* BoundsMin, const float* BoundsMax,
+        float InvFarClip, float DepthBias = 0.0f ) const;
+
+    // IsOccluded for a pyramid that is a few frames old, as the read back copy is.  The box is still placed
+    // with ModelToProjection, the projection the pyramid was rendered with, but the rectangle tested also
+    // covers where the box is now (ModelToCurrentProjection), and grows by MarginTexels level 0 texels on
+    // every side for occluders that have moved since.  Boxes reaching behind either eye are never occluded.
+    bool IsOccludedReprojected( const float* ModelToProjection, const float* ModelToCurrentProjection,
+        const float* BoundsMin, const float* BoundsMax, float InvFarClip, float DepthBias, float MarginTexels ) const;
+
+private:
+
+    // The UV rectangle of the box's corners and its nearest clip w.  False when a corner is behind the eye.
+    struct ScreenRect
+    {
+        float MinU, MaxU, MinV, MaxV;
+        float MinW;
+    };
+    static bool ProjectBounds( const float* ModelToProjection, const float* BoundsMin, const float* BoundsMax, ScreenRect& Rect );
+
+    // Grows the rectangle by MarginTexels and compares the box's depth with the farthest depth it covers
+    bool IsRectOccluded( ScreenRect Rect, float InvFarClip, float DepthBias, float MarginTexels ) const;
+
+    struct LevelDesc
+    {
+        uint32_t Width;
+        uint32_t Height;
+        size_t Offset;
+    };
+
+    std::vector<LevelDesc> m_Levels;
+    std::vector<float> m_Data;
+};
@@ -18,6 +18,9 @@
 #include "CommandContext.h"
 #include "Camera.h"
 #include "BufferManager.h"
+#include "Math/Random.h"
+#include "LightClusters.h"
+#include "LightShadowCache.h"
 
 #include "CompiledShaders/FillLightGridCS_8.h"
 #include "CompiledShaders/FillLightGridCS_16.h"
@@ -48,6 +51,7 @@ enum { kMinLightGridDim = 8 };
 namespace Lighting
 {
     IntVar LightGridDim("Application/Forward+/Light Grid Dim", 16, kMinLightGridDim, 32, 8 );
+    BoolVar EnableClusteredLighting("Application/Forward+/Clustered Lighting", false);
 
     RootSignature m_FillLightRootSig;
     ComputePSO m_FillLightGridCS_8;
@@ -63,13 +67,19 @@ namespace Lighting
     uint32_t m_FirstConeLight;
     uint32_t m_FirstConeShadowedLight;
 
+    LightClusterBuilder m_ClusterBuilder;
+    LightClusterBuilder::Light m_ClusterLights[MaxLights];
+    ByteAddressBuffer m_ClusterGrid;
+    ByteAddressBuffer m_ClusterLightIndices;
+
     enum {shadowDim = 512};
-    ColorBuffer m_LightShadowArray;
-    ShadowBuffer m_LightShadowTempBuffer;
+    ShadowBuffer m_LightShadowArray;
     Matrix4 m_LightShadowMatrix[MaxLights];
+    LightShadowCache m_LightShadowCache;
 
     void InitializeResources(void);
     void CreateRandomLights(const Vector3 minBound, const Vector3 maxBound);
+    void UpdateShadowedLights(void);
     void FillLightGrid(GraphicsContext& gfxContext, const Camera& camera);
     void Shutdown(void);
 }
@@ -106,54 +116,29 @@ void Lighting::CreateRandomLights( const Vector3 minBound, const Vector3 maxBoun
 
 	float radScale = 0.45f * std::min<float>(posScale.GetX(), std::min<float>(posScale.GetY(), posScale.GetZ()));
 
-    // todo: replace this with MT
-    srand(12645);
-    auto randUint = []() -> uint32_t
-    {
-        return rand(); // [0, RAND_MAX]
-    };
-    auto randFloat = [randUint]() -> float
+    // Fixed seed so every run (and every perf capture) gets the same lights
+    RandomNumberGenerator rng(12645);
+    auto randFloat = [&rng]() -> float
     {
-        return randUint() * (1.0f / RAND_MAX); // convert [0, RAND_MAX] to [0, 1]
+        return rng.NextFloat();
     };
     auto randVecUniform = [randFloat]() -> Vector3
     {
-        return Vector3(randFloat(), randFloat(), randFloat());
-    };
-    auto randGaussian = [randFloat]() -> float
-    {
-        // polar box-muller
-        static bool gaussianPair = true;
-        static float y2;
-
-        if (gaussianPair)
-        {
-            gaussianPair = false;
-
-            float x1, x2, w;
-            do
-            {
-                x1 = 2 * randFloat() - 1;
-                x2 = 2 * randFloat() - 1;
-                w = x1 * x1 + x2 * x2;
-            } while (w >= 1);
-
-            w = sqrt(-2 * log(w) / w);
-            y2 = x2 * w;
-            return x1 * w;
-        }
-        else
-        {
-            gaussianPair = true;
-            return y2;
-        }
+        float x = randFloat();
+        float y = randFloat();
+        float z = randFloat();
+        return Vector3(x, y, z);
     };
-    auto randVecGaussian = [randGaussian]() -> Vector3
+    auto randVecGaussian = [&rng]() -> Vector3
     {
-        return Normalize(Vector3(randGaussian(), randGaussian(), randGaussian()));
+        float x = rng.NextGaussian();
+        float y = rng.NextGaussian();
+        float z = rng.NextGaussian();
+        return Normalize(Vector3(x, y, z));
     };
 
     const float pi = 3.14159265359f;
+    m_LightShadowCache.Create(MaxLights);
     for (uint32_t n = 0; n < MaxLights; n++)
     {
         Vector3 pos = randVecUniform() * posScale + posBias;
@@ -203,6 +188,13 @@ void Lighting::CreateRandomLights( const Vector3 minBound, const Vector3 maxBoun
         m_LightData[n].coneAngles[0] = 1.0f / (cos(coneInner) - cos(coneOuter));
         m_LightData[n].coneAngles[1] = cos(coneOuter);
         std::memcpy(m_LightData[n].shadowTextureMatrix, &shadowTextureMatrix, sizeof(shadowTextureMatrix));
+
+        m_ClusterLights[n].Position[0] = pos.GetX();
+        m_ClusterLights[n].Position[1] = pos.GetY();
+        m_ClusterLights[n].Position[2] = pos.GetZ();
+        m_ClusterLights[n].Radius = lightRadius;
+        m_ClusterLights[n].Type = type;
+
         //*(Matrix4*)(m_LightData[n].shadowTextureMatrix) = shadowTextureMatrix;
     }
     // sort lights by type, needed for efficiency in the BIT_MASK approach
@@ -245,6 +237,7 @@ void Lighting::CreateRandomLights( const Vector3 minBound, const Vector3 maxBoun
         }
     }
     m_LightBuffer.Create(L"m_LightBuffer", MaxLights, sizeof(LightData), m_LightData);
+    UpdateShadowedLights();
 
     // todo: assumes max resolution of 1920x1080
     uint32_t lightGridCells = Math::DivideByMultiple(1920, kMinLightGridDim) * Math::DivideByMultiple(1080, kMinLightGridDim);
@@ -254,8 +247,25 @@ void Lighting::CreateRandomLights( const Vector3 minBound, const Vector3 maxBoun
     uint32_t lightGridBitMaskSizeBytes = lightGridCells * 4 * 4;
     m_LightGridBitMask.Create(L"m_LightGridBitMask", lightGridBitMaskSizeBytes, 1, nullptr);
 
-    m_LightShadowArray.CreateArray(L"m_LightShadowArray", shadowDim, shadowDim, MaxLights, DXGI_FORMAT_R16_UNORM);
-    m_LightShadowTempBuffer.Create(L"m_LightShadowTempBuffer", shadowDim, shadowDim);
+    // Worst case every light lands in every cluster
+    uint32_t clusterCount = m_ClusterBuilder.GetClusterCount();
+    m_ClusterGrid.Create(L"m_ClusterGrid", Math::AlignUp(clusterCount * 2, 4), 4, nullptr);
+    m_ClusterLightIndices.Create(L"m_ClusterLightIndices", clusterCount * MaxLights, 4, nullptr);
+
+    m_LightShadowArray.CreateArray(L"m_LightShadowArray", shadowDim, shadowDim, MaxLights);
+}
+
+void Lighting::UpdateShadowedLights(void)
+{
+    for (uint32_t n = 0; n < MaxLights; n++)
+    {
+        if (m_ClusterLights[n].Type != 2)
+            continue;
+
+        const float* pos = m_ClusterLights[n].Position;
+        m_LightShadowCache.UpdateLight(n, BoundingSphere(Vector3(pos[0], pos[1], pos[2]), m_ClusterLights[n].Radius),
+            m_LightShadowMatrix[n]);
+    }
 }
 
 void Lighting::Shutdown(void)
@@ -263,14 +273,66 @@ void Lighting::Shutdown(void)
     m_LightBuffer.Destroy();
     m_LightGrid.Destroy();
     m_LightGridBitMask.Destroy();
+    m_ClusterGrid.Destroy();
+    m_ClusterLightIndices.Destroy();
     m_LightShadowArray.Destroy();
-    m_LightShadowTempBuffer.Destroy();
+}
+
+static LightClusterBuilder::Frustum MakeClusterFrustum(const Camera& camera)
+{
+    LightClusterBuilder::Frustum frustum;
+    std::memcpy(frustum.ViewMatrix, &camera.GetViewMatrix(), sizeof(frustum.ViewMatrix));
+    frustum.ProjScaleX = camera.GetProjMatrix().GetX().GetX();
+    frustum.ProjScaleY = camera.GetProjMatrix().GetY().GetY();
+    frustum.NearClip = camera.GetNearClip();
+    frustum.FarClip = camera.GetFarClip();
+    return frustum;
+}
+
+void Lighting::GetClusterConstants(const Camera& camera, float ClusterScale[4], uint32_t ClusterCount[4])
+{
+    m_ClusterBuilder.GetSliceScaleBias(MakeClusterFrustum(camera), ClusterScale[2], ClusterScale[3]);
+    ClusterScale[0] = (float)m_ClusterBuilder.GetCountX() / g_pSceneColorBuffer->GetWidth();
+    ClusterScale[1] = (float)m_ClusterBuilder.GetCountY() / g_pSceneColorBuffer->GetHeight();
+    ClusterCount[0] = m_ClusterBuilder.GetCountX();
+    ClusterCount[1] = m_ClusterBuilder.GetCountY();
+    ClusterCount[2] = m_ClusterBuilder.GetCountZ();
+    ClusterCount[3] = EnableClusteredLighting ? 1 : 0;
+}
+
+static void FillLightClusters(GraphicsContext& gfxContext, const Camera& camera)
+{
+    using namespace Lighting;
+
+    {
+        ScopedTimer _prof(L"Build Light Clusters");
+        m_ClusterBuilder.Build(MakeClusterFrustum(camera), m_ClusterLights, MaxLights);
+    }
+
+    const std::vector<uint32_t>& clusterData = m_ClusterBuilder.GetClusterData();
+    const std::vector<uint32_t>& lightIndices = m_ClusterBuilder.GetLightIndices();
+    ASSERT(lightIndices.size() <= m_ClusterLightIndices.GetElementCount());
+
+    gfxContext.TransitionResource(m_ClusterGrid, D3D12_RESOURCE_STATE_COPY_DEST);
+    gfxContext.TransitionResource(m_ClusterLightIndices, D3D12_RESOURCE_STATE_COPY_DEST, true);
+    gfxContext.WriteBuffer(m_ClusterGrid, 0, clusterData.data(), clusterData.size() * sizeof(uint32_t));
+    if (!lightIndices.empty())
+        gfxContext.WriteBuffer(m_ClusterLightIndices, 0, lightIndices.data(), lightIndices.size() * sizeof(uint32_t));
+
+    gfxContext.TransitionResource(m_ClusterGrid, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    gfxContext.TransitionResource(m_ClusterLightIndices, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 }
 
 void Lighting::FillLightGrid(GraphicsContext& gfxContext, const Camera& camera)
 {
     ScopedTimer _prof(L"FillLightGrid", gfxContext);
 
+    if (EnableClusteredLighting)
+    {
+        FillLightClusters(gfxContext, camera);
+        return;
+    }
+
     ComputeContext& Context = gfxContext.GetComputeContext();
 
     Context.SetRootSignature(m_FillLightRootSig);
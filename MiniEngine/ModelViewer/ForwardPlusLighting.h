@@ -20,10 +20,11 @@
 
 class StructuredBuffer;
 class ByteAddressBuffer;
-class ColorBuffer;
 class ShadowBuffer;
 class GraphicsContext;
+class LightShadowCache;
 class IntVar;
+class BoolVar;
 namespace Math
 {
     class Vector3;
@@ -34,6 +35,7 @@ namespace Math
 namespace Lighting
 {
     extern IntVar LightGridDim;
+    extern BoolVar EnableClusteredLighting;
 
     enum { MaxLights = 128 };
 
@@ -45,12 +47,24 @@ namespace Lighting
     extern std::uint32_t m_FirstConeLight;
     extern std::uint32_t m_FirstConeShadowedLight;
 
-    extern ColorBuffer m_LightShadowArray;
-    extern ShadowBuffer m_LightShadowTempBuffer;
+    // Clustered light assignment, built on the CPU when EnableClusteredLighting is set
+    extern ByteAddressBuffer m_ClusterGrid;
+    extern ByteAddressBuffer m_ClusterLightIndices;
+
+    // One slice per light, indexed like the light buffer.  Only shadowed cone lights are rendered.
+    extern ShadowBuffer m_LightShadowArray;
     extern Math::Matrix4 m_LightShadowMatrix[MaxLights];
+    extern LightShadowCache m_LightShadowCache;
 
     void InitializeResources(void);
     void CreateRandomLights(const Math::Vector3 minBound, const Math::Vector3 maxBound);
+
+    // Passes the bounds and shadow matrix of every shadowed light to m_LightShadowCache, which marks the
+    // maps of lights that moved stale.  Called every frame.
+    void UpdateShadowedLights(void);
     void FillLightGrid(GraphicsContext& gfxContext, const Math::Camera& camera);
+
+    // Pixel shader constants for the cluster lookup.  ClusterCount.w is zero when the tiled grid is used.
+    void GetClusterConstants(const Math::Camera& camera, float ClusterScale[4], std::uint32_t ClusterCount[4]);
     void Shutdown(void);
 }
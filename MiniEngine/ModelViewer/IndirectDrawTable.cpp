@@ -0,0 +1,174 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Built without the precompiled header so it has no dependency on Windows
+#include "IndirectDrawTable.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+IndirectDrawTable::IndirectDrawTable() : m_InstanceCount(0)
+{
+}
+
+void IndirectDrawTable::Build( const ModelDesc* Models, uint32_t ModelCount, const uint32_t* InstanceModels, uint32_t InstanceCount )
+{
+    m_InstanceCount = InstanceCount;
+    m_Records.clear();
+    m_Buckets.clear();
+
+    // Give every (model, material) pair that some mesh uses a bucket, in model and then material order
+    vector<uint32_t> FirstBucket(ModelCount + 1, 0);
+    vector<uint32_t> MeshBucket;
+    vector<uint32_t> FirstMesh(ModelCount + 1, 0);
+
+    for (uint32_t m = 0; m < ModelCount; ++m)
+    {
+        const ModelDesc& Model = Models[m];
+        FirstBucket[m] = (uint32_t)m_Buckets.size();
+        FirstMesh[m] = (uint32_t)MeshBucket.size();
+
+        vector<uint32_t> Materials;
+        for (uint32_t i = 0; i < Model.MeshCount; ++i)
+            Materials.push_back(Model.Meshes[i].MaterialIndex);
+        sort(Materials.begin(), Materials.end());
+        Materials.erase(unique(Materials.begin(), Materials.end()), Materials.end());
+
+        for (uint32_t Material : Materials)
+        {
+            Bucket NewBucket = { m, Material, 0, 0, 0 };
+            m_Buckets.push_back(NewBucket);
+        }
+
+        for (uint32_t i = 0; i < Model.MeshCount; ++i)
+        {
+            const MeshDesc& Mesh = Model.Meshes[i];
+            uint32_t b = FirstBucket[m] + (uint32_t)(lower_bound(Materials.begin(), Materials.end(), Mesh.MaterialIndex) - Materials.begin());
+
+            // A material is either cut out or not, so the bucket's flags are those of any of its meshes
+            m_Buckets[b].Flags |= Mesh.Flags;
+            MeshBucket.push_back(b);
+        }
+    }
+    FirstBucket[ModelCount] = (uint32_t)m_Buckets.size();
+    FirstMesh[ModelCount] = (uint32_t)MeshBucket.size();
+
+    // Count the draws of each bucket, then lay the buckets out back to back
+    for (uint32_t i = 0; i < InstanceCount; ++i)
+    {
+        const uint32_t m = InstanceModels[i];
+        assert(m < ModelCount && "Instance of a model that isn't in the table");
+        for (uint32_t j = FirstMesh[m]; j < FirstMesh[m + 1]; ++j)
+            m_Buckets[MeshBucket[j]].Capacity++;
+    }
+
+    uint32_t CommandCount = 0;
+    for (Bucket& b : m_Buckets)
+    {
+        b.FirstCommand = CommandCount;
+        CommandCount += b.Capacity;
+    }
+
+    // Place each record in its bucket's range, in instance and mesh order within the bucket
+    m_Records.resize(CommandCount);
+    vector<uint32_t> Filled(m_Buckets.size(), 0);
+
+    for (uint32_t i = 0; i < InstanceCount; ++i)
+    {
+        const uint32_t m = InstanceModels[i];
+        const ModelDesc& Model = Models[m];
+
+        for (uint32_t j = 0; j < Model.MeshCount; ++j)
+        {
+            const MeshDesc& Mesh = Model.Meshes[j];
+            const uint32_t b = MeshBucket[FirstMesh[m] + j];
+
+            DrawRecord& Record = m_Records[m_Buckets[b].FirstCommand + Filled[b]++];
+            for (int k = 0; k < 3; ++k)
+            {
+                Record.BoundsMin[k] = Mesh.BoundsMin[k];
+                Record.BoundsMax[k] = Mesh.BoundsMax[k];
+            }
+            Record.InstanceIndex = i;
+            Record.BucketIndex = b;
+            Record.FirstCommand = m_Buckets[b].FirstCommand;
+            Record.Flags = Mesh.Flags;
+            Record.IndexCount = Mesh.IndexCount;
+            Record.StartIndex = Mesh.StartIndex;
+            Record.BaseVertex = Mesh.BaseVertex;
+            Record.MaterialIndex = Mesh.MaterialIndex;
+            Record.Padding[0] = Record.Padding[1] = 0;
+        }
+    }
+}
+
+bool IndirectDrawTable::IntersectFrustum( const float* M, const float* BoundsMin, const float* BoundsMax )
+{
+    // Row r of the matrix maps an object space point to clip coordinate r.  A point is inside when
+    // -w <= x <= w, -w <= y <= w and 0 <= z <= w.
+    float Rows[4][4];
+    for (int r = 0; r < 4; ++r)
+        for (int c = 0; c < 4; ++c)
+            Rows[r][c] = M[c * 4 + r];
+
+    float Planes[6][4];
+    for (int c = 0; c < 4; ++c)
+    {
+        Planes[0][c] = Rows[3][c] + Rows[0][c];
+        Planes[1][c] = Rows[3][c] - Rows[0][c];
+        Planes[2][c] = Rows[3][c] + Rows[1][c];
+        Planes[3][c] = Rows[3][c] - Rows[1][c];
+        Planes[4][c] = Rows[2][c];
+        Planes[5][c] = Rows[3][c] - Rows[2][c];
+    }
+
+    // The box is outside a plane when its corner farthest along the plane's normal is
+    for (int p = 0; p < 6; ++p)
+    {
+        const float* Plane = Planes[p];
+        float Distance = Plane[3];
+        for (int k = 0; k < 3; ++k)
+            Distance += Plane[k] * (Plane[k] > 0.0f ? BoundsMax[k] : BoundsMin[k]);
+        if (Distance < 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
+uint32_t IndirectDrawTable::Cull( const float* ModelToProjection, uint32_t FilterFlags, uint64_t ConstantsAddress,
+    uint32_t ConstantsStride, DrawCommand* Commands, uint32_t* Counts ) const
+{
+    fill(Counts, Counts + m_Buckets.size(), 0u);
+
+    uint32_t NumVisible = 0;
+    for (const DrawRecord& Record : m_Records)
+    {
+        if ((Record.Flags & FilterFlags) == 0)
+            continue;
+
+        if (!IntersectFrustum(ModelToProjection + Record.InstanceIndex * 16, Record.BoundsMin, Record.BoundsMax))
+            continue;
+
+        DrawCommand& Command = Commands[Record.FirstCommand + Counts[Record.BucketIndex]++];
+        Command.VSConstants = ConstantsAddress + (uint64_t)Record.InstanceIndex * ConstantsStride;
+        Command.BaseVertex = (uint32_t)Record.BaseVertex;
+        Command.MaterialIndex = Record.MaterialIndex;
+        Command.IndexCountPerInstance = Record.IndexCount;
+        Command.InstanceCount = 1;
+        Command.StartIndexLocation = Record.StartIndex;
+        Command.BaseVertexLocation = Record.BaseVertex;
+        Command.StartInstanceLocation = 0;
+        Command.Padding = 0;
+        ++NumVisible;
+    }
+
+    return NumVisible;
+}
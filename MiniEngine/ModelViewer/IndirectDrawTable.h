@@ -0,0 +1,121 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  CPU builder for the draw table of the ExecuteIndirect path.  Every mesh of every instance
+// becomes one draw record holding its object space bounds and its DrawIndexed arguments.  The table is
+// built and uploaded once, after the scene is loaded; each pass, IndirectCullCS culls the records and
+// compacts the survivors into a buffer of draw commands.
+//
+// ExecuteIndirect can't change descriptor tables, so draws are grouped into buckets that share a model
+// (vertex and index buffers) and a material (textures).  Each bucket owns a fixed range of the command
+// buffer, large enough for all of its draws, and one count.  Issuing a pass takes one ExecuteIndirect per
+// bucket.  Only plain mesh descriptions go in, so the table, the command layout and the culling can be
+// checked without a device.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class IndirectDrawTable
+{
+public:
+
+    // Match ModelViewer's object filter
+    enum { kFlagOpaque = 0x1, kFlagCutout = 0x2 };
+
+    struct MeshDesc
+    {
+        float BoundsMin[3];     // Object space
+        float BoundsMax[3];
+        uint32_t IndexCount;
+        uint32_t StartIndex;
+        int32_t BaseVertex;
+        uint32_t MaterialIndex;
+        uint32_t Flags;
+    };
+
+    struct ModelDesc
+    {
+        const MeshDesc* Meshes;
+        uint32_t MeshCount;
+    };
+
+    // must keep in sync with IndirectCullCS.hlsl
+    struct DrawRecord
+    {
+        float BoundsMin[3];
+        uint32_t InstanceIndex;
+        float BoundsMax[3];
+        uint32_t BucketIndex;
+        uint32_t FirstCommand;  // Of the bucket
+        uint32_t Flags;
+        uint32_t IndexCount;
+        uint32_t StartIndex;
+        int32_t BaseVertex;
+        uint32_t MaterialIndex;
+        uint32_t Padding[2];
+    };
+
+    // One command of the draw command signature:  the vertex shader constants of the instance (root CBV 0),
+    // the two root constants of parameter 5, and D3D12_DRAW_INDEXED_ARGUMENTS.  The padding keeps the
+    // constant buffer address of every command 8-byte aligned.  Must keep in sync with IndirectCullCS.hlsl.
+    struct DrawCommand
+    {
+        uint64_t VSConstants;
+        uint32_t BaseVertex;
+        uint32_t MaterialIndex;
+        uint32_t IndexCountPerInstance;
+        uint32_t InstanceCount;
+        uint32_t StartIndexLocation;
+        int32_t BaseVertexLocation;
+        uint32_t StartInstanceLocation;
+        uint32_t Padding;
+    };
+
+    struct Bucket
+    {
+        uint32_t ModelIndex;
+        uint32_t MaterialIndex;
+        uint32_t Flags;
+        uint32_t FirstCommand;
+        uint32_t Capacity;      // Draws in the bucket, so the most that can survive culling
+    };
+
+    IndirectDrawTable();
+
+    // InstanceModels[i] is the model index of instance i.  Buckets are ordered by model, then by material,
+    // so consecutive buckets usually share vertex and index buffers.
+    void Build( const ModelDesc* Models, uint32_t ModelCount, const uint32_t* InstanceModels, uint32_t InstanceCount );
+
+    uint32_t GetInstanceCount( void ) const { return m_InstanceCount; }
+
+    // Records are grouped by bucket.  The command buffer needs GetCommandCapacity() commands and the count
+    // buffer one word per bucket.
+    const std::vector<DrawRecord>& GetRecords( void ) const { return m_Records; }
+    const std::vector<Bucket>& GetBuckets( void ) const { return m_Buckets; }
+    uint32_t GetCommandCapacity( void ) const { return (uint32_t)m_Records.size(); }
+
+    // What IndirectCullCS computes, in record order instead of in whatever order the GPU's atomics land.
+    // ModelToProjection holds 16 floats per instance in Math::Matrix4 layout (four basis vectors), and
+    // instance i's vertex shader constants are at ConstantsAddress + i * ConstantsStride.  Commands must
+    // hold GetCommandCapacity() entries and Counts one per bucket.  Returns the number of surviving draws.
+    uint32_t Cull( const float* ModelToProjection, uint32_t FilterFlags, uint64_t ConstantsAddress,
+        uint32_t ConstantsStride, DrawCommand* Commands, uint32_t* Counts ) const;
+
+    // The test IndirectCullCS applies:  false when the box lies entirely outside one of the clip planes
+    // derived from the matrix
+    static bool IntersectFrustum( const float* ModelToProjection, const float* BoundsMin, const float* BoundsMax );
+
+private:
+
+    uint32_t m_InstanceCount;
+    std::vector<DrawRecord> m_Records;
+    std::vector<Bucket> m_Buckets;
+};
@@ -0,0 +1,295 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Built without the precompiled header so it has no dependency on Windows
+#include "LightClusters.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <immintrin.h>
+
+using namespace std;
+
+namespace
+{
+    // Lights are binned in chunks of this many when computing bounds in parallel
+    const uint32_t kBoundsChunkSize = 256;
+
+    // Depth slice boundaries are widened by this fraction so GPU log2() rounding can never place a
+    // pixel in a slice the light was not binned into
+    const float kSliceMargin = 0.001f;
+
+    // Distances from the planes through the eye that separate tile columns (or rows).  Boundary i sits
+    // at NDC coordinate -1 + 2i/Count, and positive distances lie on the +x (or +y) side.
+    struct BoundaryPlanes
+    {
+        float A[256];   // Scale for the view space x (or y) coordinate
+        float B[256];   // Scale for the view depth
+    };
+
+    void ComputeBoundaryPlanes( BoundaryPlanes& Planes, uint32_t Count, float ProjScale )
+    {
+        for (uint32_t i = 0; i <= Count; ++i)
+        {
+            float t = -1.0f + 2.0f * i / Count;
+            float InvLength = 1.0f / sqrtf(ProjScale * ProjScale + t * t);
+            Planes.A[i] = ProjScale * InvLength;
+            Planes.B[i] = -t * InvLength;
+        }
+    }
+
+    // Returns the range of tiles overlapped by four spheres, and clears Visible for spheres entirely
+    // outside the outer boundaries.
+    inline void TileRange( const BoundaryPlanes& Planes, uint32_t Count, __m128 Coord, __m128 Depth,
+        __m128 Radius, __m128& Visible, __m128i& MinTile, __m128i& MaxTile )
+    {
+        __m128 NegRadius = _mm_sub_ps(_mm_setzero_ps(), Radius);
+
+        __m128 DistMin = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(Planes.A[0]), Coord), _mm_mul_ps(_mm_set1_ps(Planes.B[0]), Depth));
+        __m128 DistMax = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(Planes.A[Count]), Coord), _mm_mul_ps(_mm_set1_ps(Planes.B[Count]), Depth));
+        Visible = _mm_and_ps(Visible, _mm_and_ps(_mm_cmpgt_ps(DistMin, NegRadius), _mm_cmplt_ps(DistMax, Radius)));
+
+        // Boundaries are ordered, so the ones a sphere lies fully beyond form a prefix (or suffix)
+        __m128i FullyAbove = _mm_setzero_si128();
+        __m128i FullyBelow = _mm_setzero_si128();
+        for (uint32_t i = 1; i < Count; ++i)
+        {
+            __m128 Dist = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(Planes.A[i]), Coord), _mm_mul_ps(_mm_set1_ps(Planes.B[i]), Depth));
+            FullyAbove = _mm_sub_epi32(FullyAbove, _mm_castps_si128(_mm_cmpge_ps(Dist, Radius)));
+            FullyBelow = _mm_sub_epi32(FullyBelow, _mm_castps_si128(_mm_cmple_ps(Dist, NegRadius)));
+        }
+
+        MinTile = FullyAbove;
+        MaxTile = _mm_sub_epi32(_mm_set1_epi32((int)Count - 1), FullyBelow);
+    }
+}
+
+LightClusterBuilder::LightClusterBuilder()
+{
+    SetGridSize(16, 8, 24);
+}
+
+void LightClusterBuilder::SetGridSize( uint32_t CountX, uint32_t CountY, uint32_t CountZ )
+{
+    // Bounds are stored in bytes and the boundary tables hold 256 entries
+    assert(CountX > 0 && CountX < 256 && CountY > 0 && CountY < 256 && CountZ > 0 && CountZ < 256 && "Unsupported grid size");
+    m_CountX = CountX;
+    m_CountY = CountY;
+    m_CountZ = CountZ;
+}
+
+void LightClusterBuilder::GetSliceScaleBias( const Frustum& View, float& Scale, float& Bias ) const
+{
+    Scale = m_CountZ / log2f(View.FarClip / View.NearClip);
+    Bias = -log2f(View.NearClip) * Scale;
+}
+
+void LightClusterBuilder::ComputeBounds( const Frustum& View, const Light* Lights, uint32_t LightCount )
+{
+    BoundaryPlanes ColumnPlanes, RowPlanes;
+    ComputeBoundaryPlanes(ColumnPlanes, m_CountX, View.ProjScaleX);
+    ComputeBoundaryPlanes(RowPlanes, m_CountY, View.ProjScaleY);
+
+    // Depth of every inner slice boundary:  Near * (Far / Near)^(k / CountZ)
+    float SliceDepth[256];
+    for (uint32_t k = 1; k < m_CountZ; ++k)
+        SliceDepth[k] = View.NearClip * powf(View.FarClip / View.NearClip, (float)k / m_CountZ);
+
+    m_Bounds.resize(LightCount);
+
+    const float* M = View.ViewMatrix;
+    const uint32_t NumChunks = (LightCount + kBoundsChunkSize - 1) / kBoundsChunkSize;
+
+    g_JobScheduler.ParallelFor(0u, NumChunks, [&]( uint32_t Chunk )
+    {
+        const uint32_t First = Chunk * kBoundsChunkSize;
+        const uint32_t Last = min(First + kBoundsChunkSize, LightCount);
+
+        for (uint32_t Base = First; Base < Last; Base += 4)
+        {
+            // Gather four lights in SoA form.  Missing lanes get a negative radius so they are culled.
+            alignas(16) float PX[4], PY[4], PZ[4], PR[4];
+            for (uint32_t Lane = 0; Lane < 4; ++Lane)
+            {
+                if (Base + Lane < Last)
+                {
+                    const Light& L = Lights[m_SortedLights[Base + Lane]];
+                    PX[Lane] = L.Position[0];
+                    PY[Lane] = L.Position[1];
+                    PZ[Lane] = L.Position[2];
+                    PR[Lane] = L.Radius;
+                }
+                else
+                {
+                    PX[Lane] = PY[Lane] = PZ[Lane] = 0.0f;
+                    PR[Lane] = -1.0f;
+                }
+            }
+
+            __m128 X = _mm_load_ps(PX), Y = _mm_load_ps(PY), Z = _mm_load_ps(PZ), R = _mm_load_ps(PR);
+
+            // To view space.  The camera looks down -z, so depth is the negated z coordinate.
+            __m128 VX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(M[0]), X), _mm_mul_ps(_mm_set1_ps(M[4]), Y)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(M[8]), Z), _mm_set1_ps(M[12])));
+            __m128 VY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(M[1]), X), _mm_mul_ps(_mm_set1_ps(M[5]), Y)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(M[9]), Z), _mm_set1_ps(M[13])));
+            __m128 VZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(M[2]), X), _mm_mul_ps(_mm_set1_ps(M[6]), Y)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(M[10]), Z), _mm_set1_ps(M[14])));
+            __m128 Depth = _mm_sub_ps(_mm_setzero_ps(), VZ);
+
+            __m128 NearDepth = _mm_sub_ps(Depth, R);
+            __m128 FarDepth = _mm_add_ps(Depth, R);
+            __m128 Visible = _mm_and_ps(_mm_cmpgt_ps(R, _mm_setzero_ps()),
+                _mm_and_ps(_mm_cmpgt_ps(FarDepth, _mm_set1_ps(View.NearClip)), _mm_cmplt_ps(NearDepth, _mm_set1_ps(View.FarClip))));
+
+            __m128i MinX, MaxX, MinY, MaxY;
+            TileRange(ColumnPlanes, m_CountX, VX, Depth, R, Visible, MinX, MaxX);
+            TileRange(RowPlanes, m_CountY, VY, Depth, R, Visible, MinY, MaxY);
+
+            // Slice range by counting the slice boundaries in front of each end of the sphere
+            NearDepth = _mm_mul_ps(NearDepth, _mm_set1_ps(1.0f - kSliceMargin));
+            FarDepth = _mm_mul_ps(FarDepth, _mm_set1_ps(1.0f + kSliceMargin));
+            __m128i MinZ = _mm_setzero_si128();
+            __m128i MaxZ = _mm_setzero_si128();
+            for (uint32_t k = 1; k < m_CountZ; ++k)
+            {
+                __m128 Boundary = _mm_set1_ps(SliceDepth[k]);
+                MinZ = _mm_sub_epi32(MinZ, _mm_castps_si128(_mm_cmple_ps(Boundary, NearDepth)));
+                MaxZ = _mm_sub_epi32(MaxZ, _mm_castps_si128(_mm_cmplt_ps(Boundary, FarDepth)));
+            }
+
+            alignas(16) int32_t Out[7][4];
+            _mm_store_si128((__m128i*)Out[0], MinX);
+            _mm_store_si128((__m128i*)Out[1], MaxX);
+            _mm_store_si128((__m128i*)Out[2], MinY);
+            _mm_store_si128((__m128i*)Out[3], MaxY);
+            _mm_store_si128((__m128i*)Out[4], MinZ);
+            _mm_store_si128((__m128i*)Out[5], MaxZ);
+            _mm_store_si128((__m128i*)Out[6], _mm_castps_si128(Visible));
+
+            for (uint32_t Lane = 0; Lane < 4 && Base + Lane < Last; ++Lane)
+            {
+                // Rows were counted bottom up in NDC; clusters are stored top row first
+                LightBounds& B = m_Bounds[Base + Lane];
+                B.MinX = (uint8_t)Out[0][Lane];
+                B.MaxX = (uint8_t)Out[1][Lane];
+                B.MinY = (uint8_t)(m_CountY - 1 - Out[3][Lane]);
+                B.MaxY = (uint8_t)(m_CountY - 1 - Out[2][Lane]);
+                B.MinZ = (uint8_t)Out[4][Lane];
+                B.MaxZ = (uint8_t)Out[5][Lane];
+                B.Visible = Out[6][Lane] != 0 && B.MinX <= B.MaxX && B.MinY <= B.MaxY;
+            }
+        }
+    });
+}
+
+void LightClusterBuilder::Build( const Frustum& View, const Light* Lights, uint32_t LightCount )
+{
+    // Counting sort by type so each cluster's list comes out grouped by type
+    uint32_t TypeCount[kLightTypeCount] = {};
+    for (uint32_t i = 0; i < LightCount; ++i)
+    {
+        assert(Lights[i].Type < kLightTypeCount && "Unknown light type");
+        ++TypeCount[Lights[i].Type];
+    }
+
+    m_TypeStart[0] = 0;
+    for (uint32_t t = 0; t < kLightTypeCount; ++t)
+        m_TypeStart[t + 1] = m_TypeStart[t] + TypeCount[t];
+
+    uint32_t TypeCursor[kLightTypeCount];
+    for (uint32_t t = 0; t < kLightTypeCount; ++t)
+        TypeCursor[t] = m_TypeStart[t];
+
+    m_SortedLights.resize(LightCount);
+    for (uint32_t i = 0; i < LightCount; ++i)
+        m_SortedLights[TypeCursor[Lights[i].Type]++] = i;
+
+    ComputeBounds(View, Lights, LightCount);
+
+    const uint32_t SliceSize = m_CountX * m_CountY;
+    const uint32_t ClusterCount = GetClusterCount();
+
+    // Count the lights of each type per cluster.  Each slice is owned by one task.
+    m_Counts.assign(ClusterCount * kLightTypeCount, 0);
+    g_JobScheduler.ParallelFor(0u, m_CountZ, [&]( uint32_t Slice )
+    {
+        uint32_t* SliceCounts = &m_Counts[Slice * SliceSize * kLightTypeCount];
+        for (uint32_t t = 0; t < kLightTypeCount; ++t)
+        {
+            for (uint32_t i = m_TypeStart[t]; i < m_TypeStart[t + 1]; ++i)
+            {
+                const LightBounds& B = m_Bounds[i];
+                if (!B.Visible || Slice < B.MinZ || Slice > B.MaxZ)
+                    continue;
+
+                for (uint32_t y = B.MinY; y <= B.MaxY; ++y)
+                    for (uint32_t x = B.MinX; x <= B.MaxX; ++x)
+                        ++SliceCounts[(y * m_CountX + x) * kLightTypeCount + t];
+            }
+        }
+    });
+
+    // Assign list offsets
+    m_ClusterData.assign((ClusterCount * 2 + 3) & ~3, 0);
+    uint32_t TotalIndices = 0;
+    for (uint32_t c = 0; c < ClusterCount; ++c)
+    {
+        uint32_t* Counts = &m_Counts[c * kLightTypeCount];
+        uint32_t Packed = 0;
+        m_ClusterData[c * 2] = TotalIndices;
+        for (uint32_t t = 0; t < kLightTypeCount; ++t)
+        {
+            Counts[t] = min<uint32_t>(Counts[t], kMaxLightsPerType);
+            Packed |= Counts[t] << (t * 10);
+            TotalIndices += Counts[t];
+        }
+        m_ClusterData[c * 2 + 1] = Packed;
+    }
+
+    // Fill the lists, again one task per slice.  Both outputs are padded to whole 16-byte blocks.
+    m_LightIndices.resize((TotalIndices + 3) & ~3, 0);
+    g_JobScheduler.ParallelFor(0u, m_CountZ, [&]( uint32_t Slice )
+    {
+        const uint32_t FirstCluster = Slice * SliceSize;
+        vector<uint32_t> Cursor(SliceSize);
+        vector<uint32_t> End(SliceSize);
+
+        for (uint32_t c = 0; c < SliceSize; ++c)
+            End[c] = m_ClusterData[(FirstCluster + c) * 2];
+
+        for (uint32_t t = 0; t < kLightTypeCount; ++t)
+        {
+            // This type's range follows the previous type's range in every cluster
+            for (uint32_t c = 0; c < SliceSize; ++c)
+            {
+                Cursor[c] = End[c];
+                End[c] += m_Counts[(FirstCluster + c) * kLightTypeCount + t];
+            }
+
+            for (uint32_t i = m_TypeStart[t]; i < m_TypeStart[t + 1]; ++i)
+            {
+                const LightBounds& B = m_Bounds[i];
+                if (!B.Visible || Slice < B.MinZ || Slice > B.MaxZ)
+                    continue;
+
+                for (uint32_t y = B.MinY; y <= B.MaxY; ++y)
+                {
+                    for (uint32_t x = B.MinX; x <= B.MaxX; ++x)
+                    {
+                        const uint32_t c = y * m_CountX + x;
+                        if (Cursor[c] < End[c])
+                            m_LightIndices[Cursor[c]++] = m_SortedLights[i];
+                    }
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,91 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  CPU builder for clustered light assignment.  The view frustum is divided into a grid of
+// screen tiles by exponentially spaced depth slices, and every light's bounding sphere is binned into
+// the clusters it touches.  Only the camera and the lights are needed, so the builder runs without a
+// device.  Light bounds are computed four lights at a time with SSE, and depth slices are filled in
+// parallel.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class LightClusterBuilder
+{
+public:
+
+    // Light types match LightData::type:  point, cone, and shadowed cone
+    enum { kLightTypeCount = 3 };
+
+    // Each cluster stores at most this many lights of each type
+    enum { kMaxLightsPerType = 1023 };
+
+    struct Light
+    {
+        float Position[3];      // World space
+        float Radius;
+        uint32_t Type;
+    };
+
+    struct Frustum
+    {
+        float ViewMatrix[16];   // World to view transform in Math::Matrix4 layout (four basis vectors)
+        float ProjScaleX;       // Projection matrix [0][0] and [1][1]
+        float ProjScaleY;
+        float NearClip;
+        float FarClip;
+    };
+
+    LightClusterBuilder();
+
+    void SetGridSize( uint32_t CountX, uint32_t CountY, uint32_t CountZ );
+    uint32_t GetCountX( void ) const { return m_CountX; }
+    uint32_t GetCountY( void ) const { return m_CountY; }
+    uint32_t GetCountZ( void ) const { return m_CountZ; }
+    uint32_t GetClusterCount( void ) const { return m_CountX * m_CountY * m_CountZ; }
+
+    // Maps a linear view depth to its slice:  Slice = floor(log2(Depth) * Scale + Bias)
+    void GetSliceScaleBias( const Frustum& View, float& Scale, float& Bias ) const;
+
+    void Build( const Frustum& View, const Light* Lights, uint32_t LightCount );
+
+    // Two words per cluster, ordered by x, then y (top row first), then depth slice:  the offset of the
+    // cluster's first entry in the light index list, and its light counts packed as
+    // (Point | Cone << 10 | ShadowedCone << 20).  Each cluster's indices are grouped by type in that order.
+    // Both arrays are zero padded to a multiple of four entries so they can be uploaded in 16-byte blocks.
+    const std::vector<uint32_t>& GetClusterData( void ) const { return m_ClusterData; }
+    const std::vector<uint32_t>& GetLightIndices( void ) const { return m_LightIndices; }
+
+private:
+
+    struct LightBounds
+    {
+        uint8_t MinX, MaxX;
+        uint8_t MinY, MaxY;
+        uint8_t MinZ, MaxZ;
+        bool Visible;
+    };
+
+    void ComputeBounds( const Frustum& View, const Light* Lights, uint32_t LightCount );
+
+    uint32_t m_CountX;
+    uint32_t m_CountY;
+    uint32_t m_CountZ;
+
+    // Lights in type order, their view space bounds, and where each type starts in m_SortedLights
+    std::vector<uint32_t> m_SortedLights;
+    std::vector<LightBounds> m_Bounds;
+    uint32_t m_TypeStart[kLightTypeCount + 1];
+
+    std::vector<uint32_t> m_Counts;     // kLightTypeCount per cluster
+    std::vector<uint32_t> m_ClusterData;
+    std::vector<uint32_t> m_LightIndices;
+};
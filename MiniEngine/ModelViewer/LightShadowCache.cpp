@@ -0,0 +1,153 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+#include "LightShadowCache.h"
+#include "SceneGraph.h"
+#include "Camera.h"
+#include "Utility.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace Math;
+
+LightShadowCache::LightShadowCache()
+    : m_BudgetMs(0.5f), m_MaxUpdatesPerFrame(4), m_UpdateCostMs(0.1f)
+{
+}
+
+void LightShadowCache::Create( uint32_t LightCount )
+{
+    m_Lights.resize(LightCount);
+    for (LightState& Light : m_Lights)
+    {
+        Light.Tracked = false;
+        Light.Stale = true;
+    }
+}
+
+void LightShadowCache::UpdateLight( uint32_t Index, const BoundingSphere& Bounds, const Matrix4& ShadowMatrix )
+{
+    LightState& Light = m_Lights[Index];
+    Light.Bounds = Bounds;
+
+    if (!Light.Tracked || std::memcmp(&Light.ShadowMatrix, &ShadowMatrix, sizeof(Matrix4)) != 0)
+        Light.Stale = true;
+
+    Light.ShadowMatrix = ShadowMatrix;
+    Light.Tracked = true;
+}
+
+void LightShadowCache::Invalidate( uint32_t Index )
+{
+    m_Lights[Index].Stale = true;
+}
+
+void LightShadowCache::InvalidateAll( void )
+{
+    for (LightState& Light : m_Lights)
+        Light.Stale = true;
+}
+
+void LightShadowCache::InvalidateBox( Vector3 MinBound, Vector3 MaxBound )
+{
+    for (LightState& Light : m_Lights)
+    {
+        if (!Light.Tracked || Light.Stale)
+            continue;
+
+        // Distance from the sphere center to the nearest point of the box
+        Vector3 Center = Light.Bounds.GetCenter();
+        Vector3 Nearest = Min(Max(Center, MinBound), MaxBound);
+        Scalar Radius = Light.Bounds.GetRadius();
+        if (LengthSquare(Nearest - Center) <= (float)(Radius * Radius))
+            Light.Stale = true;
+    }
+}
+
+void LightShadowCache::InvalidateMovedInstances( const SceneGraph& Graph )
+{
+    for (uint32_t i = 0; i < Graph.GetMovedInstanceCount(); ++i)
+    {
+        // A caster leaving a light's bounds changes its map as much as one entering them
+        const SceneGraph::Bounds* Boxes[2] = { &Graph.GetPreviousBounds(i), &Graph.GetInstanceBounds(Graph.GetMovedInstance(i)) };
+        for (const SceneGraph::Bounds* Box : Boxes)
+        {
+            if (Box->Min[0] <= Box->Max[0])
+                InvalidateBox(Vector3(Box->Min[0], Box->Min[1], Box->Min[2]), Vector3(Box->Max[0], Box->Max[1], Box->Max[2]));
+        }
+    }
+}
+
+void LightShadowCache::SetBudget( float BudgetMs, uint32_t MaxUpdatesPerFrame )
+{
+    m_BudgetMs = BudgetMs;
+    m_MaxUpdatesPerFrame = MaxUpdatesPerFrame;
+}
+
+const std::vector<uint32_t>& LightShadowCache::Schedule( const Camera& Camera )
+{
+    m_Scheduled.clear();
+    m_Candidates.clear();
+
+    const Frustum& ViewFrustum = Camera.GetWorldSpaceFrustum();
+    const Vector3 ViewerPos = Camera.GetPosition();
+    const float ProjScale = Camera.GetProjMatrix().GetY().GetY();
+
+    for (uint32_t i = 0; i < (uint32_t)m_Lights.size(); ++i)
+    {
+        const LightState& Light = m_Lights[i];
+        if (!Light.Tracked || !Light.Stale || !ViewFrustum.IntersectSphere(Light.Bounds))
+            continue;
+
+        // Fraction of the screen height the light's bounds span, squared.  Lights surrounding the
+        // viewer cover everything.
+        float Radius = Light.Bounds.GetRadius();
+        float Distance = Length(Light.Bounds.GetCenter() - ViewerPos);
+        float Coverage = Distance > Radius ? Radius * ProjScale / Distance : 1.0f;
+        m_Candidates.push_back(std::make_pair(Min(Coverage * Coverage, 1.0f), i));
+    }
+
+    std::sort(m_Candidates.begin(), m_Candidates.end(),
+        []( const std::pair<float, uint32_t>& A, const std::pair<float, uint32_t>& B )
+        {
+            return A.first > B.first || A.first == B.first && A.second < B.second;
+        });
+
+    float Spent = 0.0f;
+    for (auto& Candidate : m_Candidates)
+    {
+        if (m_Scheduled.size() >= m_MaxUpdatesPerFrame)
+            break;
+        if (!m_Scheduled.empty() && Spent + m_UpdateCostMs > m_BudgetMs)
+            break;
+
+        Spent += m_UpdateCostMs;
+        m_Scheduled.push_back(Candidate.second);
+        m_Lights[Candidate.second].Stale = false;
+    }
+
+    return m_Scheduled;
+}
+
+void LightShadowCache::ReportUpdateTime( float Milliseconds, uint32_t UpdateCount )
+{
+    if (UpdateCount == 0)
+        return;
+
+    // Smooth over a few frames so one hitch doesn't starve the following frames
+    m_UpdateCostMs += (Milliseconds / UpdateCount - m_UpdateCostMs) * 0.25f;
+}
+
+uint32_t LightShadowCache::GetStaleCount( void ) const
+{
+    uint32_t Count = 0;
+    for (const LightState& Light : m_Lights)
+        Count += Light.Tracked && Light.Stale ? 1 : 0;
+    return Count;
+}
@@ -0,0 +1,81 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Decides which spot light shadow maps to re-render each frame.  A light's cached map
+// becomes stale when its shadow matrix changes or when casters inside its bounds change.  Stale maps
+// of lights the camera can see are re-rendered largest screen coverage first, for as long as the
+// per-frame time budget allows.  Lights that are out of view keep their stale maps until they matter.
+// The class never touches a device; the caller renders the scheduled slices and reports the time spent.
+//
+
+#pragma once
+
+#include "VectorMath.h"
+#include "Math/BoundingSphere.h"
+#include <vector>
+
+namespace Math
+{
+    class Camera;
+}
+
+class SceneGraph;
+
+class LightShadowCache
+{
+public:
+
+    LightShadowCache();
+
+    // Every light starts out untracked.  Untracked lights are never scheduled.
+    void Create( uint32_t LightCount );
+
+    // Tracks a light and marks its map stale if the shadow matrix differs from the one last rendered
+    void UpdateLight( uint32_t Index, const Math::BoundingSphere& Bounds, const Math::Matrix4& ShadowMatrix );
+
+    void Invalidate( uint32_t Index );
+    void InvalidateAll( void );
+
+    // Marks every light whose bounds touch the box, e.g. after a caster inside it moved
+    void InvalidateBox( Math::Vector3 MinBound, Math::Vector3 MaxBound );
+
+    // Calls InvalidateBox() with the old and new bounds of every instance the graph's last update moved
+    void InvalidateMovedInstances( const SceneGraph& Graph );
+
+    // At least one visible stale light is updated per frame, even if it alone exceeds the budget
+    void SetBudget( float BudgetMs, uint32_t MaxUpdatesPerFrame );
+
+    // Chooses the lights to re-render this frame and marks them current.  The returned list is valid
+    // until the next call.
+    const std::vector<uint32_t>& Schedule( const Math::Camera& Camera );
+
+    // Feeds the measured cost of the last scheduled batch into the per-update estimate
+    void ReportUpdateTime( float Milliseconds, uint32_t UpdateCount );
+
+    bool IsStale( uint32_t Index ) const { return m_Lights[Index].Stale; }
+    uint32_t GetStaleCount( void ) const;
+    float GetEstimatedUpdateCost( void ) const { return m_UpdateCostMs; }
+
+private:
+
+    struct LightState
+    {
+        Math::BoundingSphere Bounds;
+        Math::Matrix4 ShadowMatrix;
+        bool Tracked;
+        bool Stale;
+    };
+
+    std::vector<LightState> m_Lights;
+    std::vector<std::pair<float, uint32_t>> m_Candidates;
+    std::vector<uint32_t> m_Scheduled;
+
+    float m_BudgetMs;
+    uint32_t m_MaxUpdatesPerFrame;
+    float m_UpdateCostMs;
+};
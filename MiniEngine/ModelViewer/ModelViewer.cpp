@@ -32,10 +32,16 @@
 #include "SSAO.h"
 #include "FXAA.h"
 #include "SystemTime.h"
+#include "JobSystem.h"
 #include "TextRenderer.h"
 #include "ShadowCamera.h"
+#include "LightShadowCache.h"
 #include "ParticleEffectManager.h"
 #include "GameInput.h"
+#include "IndirectDrawTable.h"
+#include "DepthPyramid.h"
+#include "SoftwareOcclusion.h"
+#include "ReadbackBuffer.h"
 #include "./ForwardPlusLighting.h"
 
 #include "ART/Animation/AnimatedValue.inl"
@@ -74,6 +80,9 @@
 #include "CompiledShaders/ModelViewerPS_CBR_PP.h"
 
 #include "CompiledShaders/DepthViewerPS_CBR.h"
+#include "CompiledShaders/IndirectCullCS.h"
+#include "CompiledShaders/DepthPyramidInitCS.h"
+#include "CompiledShaders/DepthPyramidDownsampleCS.h"
 
 #include <shellapi.h>
 
@@ -107,7 +116,25 @@ private:
     void RenderLightShadows(GraphicsContext& gfxContext);
 
     enum eObjectFilter { kOpaque = 0x1, kCutout = 0x2, kTransparent = 0x4, kAll = 0xF, kNone = 0x0 };
-    void RenderObjects(GraphicsContext& Context, const Matrix4& ViewProjMat, eObjectFilter Filter = kAll);
+    // TestOcclusion culls against the depth pyramid and the software occluders, so it is only for passes rendered
+    // from the main camera
+    void RenderObjects(GraphicsContext& Context, const Matrix4& ViewProjMat, eObjectFilter Filter = kAll, const ShadowCamera* CullCamera = nullptr,
+        bool TestOcclusion = false);
+    // Records the draws numbered [FirstDraw, EndDraw), counting every mesh of every instance in order
+    void RecordObjects(GraphicsContext& Context, const Matrix4& ViewProjMat, eObjectFilter Filter, const ShadowCamera* CullCamera,
+        bool TestOcclusion, uint32_t FirstDraw, uint32_t EndDraw);
+    // Culls the draw table on the GPU and issues one ExecuteIndirect per bucket
+    void RenderObjectsIndirect(GraphicsContext& Context, const Matrix4& ViewProjMat, eObjectFilter Filter, bool TestOcclusion);
+    void CreateIndirectDrawTable(void);
+    // Builds the depth pyramid from the last frame's linear depth and picks up the newest CPU copy of it
+    void UpdateDepthPyramid(GraphicsContext& Context);
+    void CreateDepthPyramid(uint32_t BaseWidth, uint32_t BaseHeight);
+    // Picks the software occluders from the depth-only geometry of every model
+    void CreateSoftwareOccluders(void);
+    // Rasterizes the software occluders seen from this frame's camera
+    void RenderSoftwareOcclusion(void);
+    void UpdateSunShadow(void);
+    void RenderSunShadow(GraphicsContext& gfxContext);
     void CreateParticleEffects();
     void UpdatePlacedResources(GraphicsContext& context);
     float RecalculateResolutionScale();
@@ -154,14 +181,90 @@ private:
     D3D12_CPU_DESCRIPTOR_HANDLE m_DefaultSampler;
     D3D12_CPU_DESCRIPTOR_HANDLE m_ShadowSampler;
 
-    D3D12_CPU_DESCRIPTOR_HANDLE m_ExtraTextures[6];
-    std::vector<bool> m_pMaterialIsCutout;
+    D3D12_CPU_DESCRIPTOR_HANDLE m_ExtraTextures[8];
+    std::vector<std::vector<bool>> m_pMaterialIsCutout;    // Per model, per material
+
+    // Vertex shader constants of an instance, padded to the constant buffer alignment so the indirect draw
+    // commands can address each instance's constants
+    struct IndirectInstanceConstants
+    {
+        Matrix4 modelToProjection;
+        Matrix4 modelToShadow;
+        Matrix4 modelToWorld;
+        XMFLOAT3 viewerPos;
+        float padding[13];
+    };
+
+    // GPU-driven draws:  the draw table is uploaded once, and each pass culls it into m_IndirectCommands
+    IndirectDrawTable m_IndirectTable;
+    StructuredBuffer m_IndirectRecords;
+    IndirectArgsBuffer m_IndirectCommands;
+    IndirectArgsBuffer m_IndirectCounts;
+    std::vector<IndirectInstanceConstants> m_IndirectInstances;
+    RootSignature m_IndirectCullRootSig;
+    ComputePSO m_IndirectCullPSO;
+    CommandSignature m_IndirectDrawSignature;
+    std::vector<Matrix4> m_IndirectOcclusionMatrices;  // Per instance, into the pyramid's projection
+
+    // Hierarchical-Z occlusion culling.  Main view passes are culled against a pyramid built from the last
+    // frame's linear depth:  on the GPU by the indirect path, and on the CPU against a read back copy of
+    // the coarse levels, which is a few frames older.
+    struct DepthHistory
+    {
+        Matrix4 ViewProj;
+        float FarClip;
+        uint32_t Width;             // Of the scene, which covers the top left of the linear depth buffer
+        uint32_t Height;
+        ColorBuffer* LinearDepth;
+        bool Valid;
+    };
+
+    enum { kPyramidReadbackCount = 3, kMaxPyramidReadbackSize = 128 };
+
+    struct PyramidReadback
+    {
+        ReadbackBuffer Buffer;
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT Footprints[DepthPyramid::kMaxLevelCount];
+        Matrix4 ViewProj;
+        float InvFarClip;
+        uint64_t FrameIndex;
+        uint64_t Fence;             // Of the frame that issued the copy
+        bool Pending;
+    };
+
+    DepthHistory m_DepthHistory;
+    ColorBuffer m_DepthPyramid;
+    uint32_t m_PyramidWidth;        // Of level 0
+    uint32_t m_PyramidHeight;
+    uint32_t m_PyramidLevelCount;
+    uint32_t m_PyramidReadbackLevel;    // The first level copied for the CPU
+    bool m_PyramidReady;            // Built this frame
+    Matrix4 m_PyramidViewProj;
+    float m_PyramidInvFarClip;
+    RootSignature m_DepthPyramidRootSig;
+    ComputePSO m_DepthPyramidInitPSO;
+    ComputePSO m_DepthPyramidDownsamplePSO;
+    PyramidReadback m_PyramidReadbacks[kPyramidReadbackCount];
+    int m_IssuedReadback;           // Waiting for this frame's fence, or -1
+    DepthPyramid m_CpuPyramid;
+    Matrix4 m_CpuPyramidViewProj;
+    float m_CpuPyramidInvFarClip;
+    uint64_t m_CpuPyramidFrame;     // When the depth in the CPU copy was rendered
+
+    SoftwareOcclusion m_SoftwareOcclusion;
+    Matrix4 m_SoftwareOcclusionViewProj;
 
     Scene m_Scene;
 
     Vector3 m_SunDirection;
     ShadowCamera m_SunShadow;
 
+    // Cascades share g_ShadowBuffer, one quadrant each
+    enum { kMaxShadowCascades = 4 };
+    ShadowCamera m_SunShadowCascades[kMaxShadowCascades];
+    uint32_t m_NumShadowCascades;
+    float m_CascadeSplits[kMaxShadowCascades + 1];
+
     SceneAnimation_ptr		m_SceneAnimation;
     AnimationController_ptr	m_AnimationController;
     FrameSequencer			m_Sequencer;
@@ -180,9 +283,37 @@ NumVar m_SunInclination("Application/Lighting/Sun Inclination", 0.75f, 0.0f, 1.0
 NumVar ShadowDimX("Application/Lighting/Shadow Dim X", 5000, 10, 15000, 50);
 NumVar ShadowDimY("Application/Lighting/Shadow Dim Y", 5000, 10, 15000, 50);
 NumVar ShadowDimZ("Application/Lighting/Shadow Dim Z", 3000, 10, 10000, 50);
+NumVar LightShadowBudget("Application/Lighting/Light Shadow Budget (ms)", 0.5f, 0.0f, 10.0f, 0.1f);
+IntVar LightShadowMaxUpdates("Application/Lighting/Light Shadow Updates Per Frame", 4, 1, 32);
+IntVar ShadowCascadeCount("Application/Lighting/Shadow Cascades", 1, 1, 4);
+NumVar ShadowCascadeLambda("Application/Lighting/Cascade Split Lambda", 0.8f, 0.0f, 1.0f, 0.05f);
+NumVar ShadowCascadeDistance("Application/Lighting/Cascade Distance", 5000, 100, 20000, 100);
 
 BoolVar ShowWaveTileCounts("Application/Forward+/Show Wave Tile Counts", false);
 
+// Splits each RenderObjects() call across worker command lists recorded by the job system.  Off by default
+// because the color pass statistics query and the scene color split barrier both need a single command list.
+BoolVar ParallelRecording("Application/Parallel Recording/Enable", false);
+IntVar RecordingWorkers("Application/Parallel Recording/Max Workers", 4, 1, CommandContext::kMaxWorkerContexts);
+IntVar MinDrawsPerWorker("Application/Parallel Recording/Min Draws Per Worker", 128, 1, 4096, 16);
+
+// Culls and compacts draws in a compute pass and submits them with ExecuteIndirect instead of recording them
+BoolVar IndirectDraws("Application/GPU Driven Draws/Enable", false);
+
+// Skips main view draws hidden behind the last frame's depth.  The bias is in linear depth (1 is the far plane)
+// and hides the error of the 16-bit depth and of objects that moved since the depth was rendered.
+BoolVar OcclusionCulling("Application/Occlusion Culling/Enable", false);
+NumVar OcclusionDepthBias("Application/Occlusion Culling/Depth Bias", 0.001f, 0.0f, 0.05f, 0.0005f);
+
+// The CPU copy of the pyramid is read back a few frames late.  Each box is tested where it was and where it is
+// now, grown by this many pyramid texels for every frame of age to cover occluders that moved in between.
+NumVar OcclusionReprojectionMargin("Application/Occlusion Culling/Readback Margin (texels per frame)", 1.0f, 0.0f, 8.0f, 0.25f);
+
+// Also skips them behind the largest meshes, rasterized on the CPU from this frame's camera.  Unlike the pyramid
+// this works on the first frame and after camera cuts, and it does not need OcclusionCulling.
+BoolVar SoftwareOcclusionCulling("Application/Occlusion Culling/Software Rasterizer", false);
+IntVar SoftwareOcclusionTriangles("Application/Occlusion Culling/Software Triangle Budget", 32768, 1024, 262144, 1024);
+
 // MSAA options
 BoolVar MsaaEnabled("Application/MSAA/MSAA Enable", false);
 const char* MsaaModeLabels[] = { "2x", "4x", "8x" };
@@ -263,7 +394,7 @@ void ModelViewer::Startup(void)
     m_RootSig[1].InitAsConstantBuffer(0, D3D12_SHADER_VISIBILITY_PIXEL);
     m_RootSig[2].InitAsConstantBuffer(1, D3D12_SHADER_VISIBILITY_PIXEL);
     m_RootSig[3].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, Model::kMaterialTexChannelCount(), D3D12_SHADER_VISIBILITY_PIXEL);
-    m_RootSig[4].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 64, 6, D3D12_SHADER_VISIBILITY_PIXEL);
+    m_RootSig[4].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 64, 8, D3D12_SHADER_VISIBILITY_PIXEL);
     m_RootSig[5].InitAsConstants(1, 2, D3D12_SHADER_VISIBILITY_VERTEX);
     m_RootSig.Finalize(L"ModelViewer", D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
@@ -285,6 +416,29 @@ void ModelViewer::Startup(void)
     m_CheckerboardResolveRootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
     m_CheckerboardResolveRootSig.Finalize(L"CheckerboardResolveRS");
 
+    m_IndirectCullRootSig.Reset(5, 0);
+    m_IndirectCullRootSig[0].InitAsConstantBuffer(0);
+    m_IndirectCullRootSig[1].InitAsBufferSRV(0);
+    m_IndirectCullRootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 2);
+    m_IndirectCullRootSig[3].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 2);
+    m_IndirectCullRootSig[4].InitAsBufferSRV(3);
+    m_IndirectCullRootSig.Finalize(L"IndirectCullRS");
+
+    m_DepthPyramidRootSig.Reset(4, 0);
+    m_DepthPyramidRootSig[0].InitAsConstants(0, 4);
+    m_DepthPyramidRootSig[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1);
+    m_DepthPyramidRootSig[2].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 0, 1);
+    m_DepthPyramidRootSig[3].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 1);
+    m_DepthPyramidRootSig.Finalize(L"DepthPyramidRS");
+
+    // Each command sets the instance's vertex shader constants and the root constants RecordObjects sets
+    // with SetConstants, then draws
+    m_IndirectDrawSignature.Reset(3);
+    m_IndirectDrawSignature[0].ConstantBufferView(0);
+    m_IndirectDrawSignature[1].Constant(5, 0, 2);
+    m_IndirectDrawSignature[2].DrawIndexed();
+    m_IndirectDrawSignature.Finalize(&m_RootSig, sizeof(IndirectDrawTable::DrawCommand));
+
     DXGI_FORMAT ColorFormat = g_pSceneColorBuffer->GetFormat();
     DXGI_FORMAT DepthFormat = g_pSceneDepthBuffer->GetFormat();
     DXGI_FORMAT ShadowFormat = g_ShadowBuffer.GetFormat();
@@ -401,6 +555,32 @@ void ModelViewer::Startup(void)
     m_CheckerboardDepthResolvePSO.SetComputeShader(g_pCheckerboardDepthResolveCS, sizeof(g_pCheckerboardDepthResolveCS));
     m_CheckerboardDepthResolvePSO.Finalize();
 
+    m_IndirectCullPSO.SetRootSignature(m_IndirectCullRootSig);
+    m_IndirectCullPSO.SetComputeShader(g_pIndirectCullCS, sizeof(g_pIndirectCullCS));
+    m_IndirectCullPSO.Finalize();
+
+    // Compute PSOs for the hierarchical-Z pyramid
+    m_DepthPyramidInitPSO.SetRootSignature(m_DepthPyramidRootSig);
+    m_DepthPyramidInitPSO.SetComputeShader(g_pDepthPyramidInitCS, sizeof(g_pDepthPyramidInitCS));
+    m_DepthPyramidInitPSO.Finalize();
+
+    m_DepthPyramidDownsamplePSO.SetRootSignature(m_DepthPyramidRootSig);
+    m_DepthPyramidDownsamplePSO.SetComputeShader(g_pDepthPyramidDownsampleCS, sizeof(g_pDepthPyramidDownsampleCS));
+    m_DepthPyramidDownsamplePSO.Finalize();
+
+    // The indirect culling pass binds the pyramid even when it is stale, so it always exists
+    m_DepthHistory.Valid = false;
+    m_PyramidReady = false;
+    m_PyramidViewProj = Matrix4(kIdentity);
+    m_PyramidInvFarClip = 0.0f;
+    m_CpuPyramidViewProj = Matrix4(kIdentity);
+    m_CpuPyramidInvFarClip = 0.0f;
+    m_CpuPyramidFrame = 0;
+    m_IssuedReadback = -1;
+    uint32_t pyramidWidth, pyramidHeight;
+    DepthPyramid::GetBaseSize(g_LinearDepth[0].GetWidth(), g_LinearDepth[0].GetHeight(), pyramidWidth, pyramidHeight);
+    CreateDepthPyramid(pyramidWidth, pyramidHeight);
+
     Lighting::InitializeResources();
 
     m_ExtraTextures[0] = g_SSAOFullScreen.GetSRV();
@@ -437,23 +617,32 @@ void ModelViewer::Startup(void)
     LocalFree(argList);
 
     ASSERT(m_Scene.LoadJson(scenepath.c_str()));
-    auto& model = m_Scene.GetModel();
 
     // The caller of this function can override which materials are considered cutouts
-    m_pMaterialIsCutout.resize(model.m_Header.materialCount);
-    for (uint32_t i = 0; i < model.m_Header.materialCount; ++i)
+    m_pMaterialIsCutout.resize(m_Scene.GetModelCount());
+    for (uint32_t modelIdx = 0; modelIdx < m_Scene.GetModelCount(); ++modelIdx)
     {
-        const Model::Material& mat = model.m_pMaterial[i];
-        if (mat.hasMask)
-        {
-            m_pMaterialIsCutout[i] = true;
-        }
-        else
+        const Model& model = m_Scene.GetModel(modelIdx);
+        std::vector<bool>& isCutout = m_pMaterialIsCutout[modelIdx];
+
+        isCutout.resize(model.m_Header.materialCount);
+        for (uint32_t i = 0; i < model.m_Header.materialCount; ++i)
         {
-            m_pMaterialIsCutout[i] = false;
+            const Model::Material& mat = model.m_pMaterial[i];
+            if (mat.hasMask)
+            {
+                isCutout[i] = true;
+            }
+            else
+            {
+                isCutout[i] = false;
+            }
         }
     }
 
+    CreateIndirectDrawTable();
+    CreateSoftwareOccluders();
+
     //CreateParticleEffects();
 
     float modelRadius = m_Scene.GetModelRadius();
@@ -477,12 +666,14 @@ void ModelViewer::Startup(void)
     // initialize DownSized Factors
     m_DownSizedFactor.x = 1.f; m_DownSizedFactor.y = 1.f;
 
-    Lighting::CreateRandomLights(model.GetBoundingBox().min, model.GetBoundingBox().max);
+    Lighting::CreateRandomLights(m_Scene.GetBoundingBox().min, m_Scene.GetBoundingBox().max);
 
     m_ExtraTextures[2] = Lighting::m_LightBuffer.GetSRV();
     m_ExtraTextures[3] = Lighting::m_LightShadowArray.GetSRV();
     m_ExtraTextures[4] = Lighting::m_LightGrid.GetSRV();
     m_ExtraTextures[5] = Lighting::m_LightGridBitMask.GetSRV();
+    m_ExtraTextures[6] = Lighting::m_ClusterGrid.GetSRV();
+    m_ExtraTextures[7] = Lighting::m_ClusterLightIndices.GetSRV();
 
     m_AnimationController = std::make_shared<AnimationController>();
     m_AnimationController->SetSceneAnimation(m_Scene.GetAnimation());
@@ -515,6 +706,15 @@ void ModelViewer::Cleanup(void)
         m_Scene.SaveAnimation();
         m_Scene.Cleanup();
 
+        m_IndirectRecords.Destroy();
+        m_IndirectCommands.Destroy();
+        m_IndirectCounts.Destroy();
+        m_IndirectDrawSignature.Destroy();
+
+        m_DepthPyramid.Destroy();
+        for (PyramidReadback& readback : m_PyramidReadbacks)
+            readback.Buffer.Destroy();
+
         Lighting::Shutdown();
     }
 }
@@ -557,10 +757,20 @@ void ModelViewer::Update(float deltaT)
         m_CameraController->Reset();
         m_CameraController->Update(0);
         m_AnimationController->SetDirty(false);
+
+        // A camera cut makes the last frame's depth useless for occlusion culling
+        m_DepthHistory.Valid = false;
     }
     else
         m_CameraController->Update(deltaT);
 
+    // Only nodes moved since the last frame are recomputed
+    m_Scene.UpdateTransforms();
+
+    // Lights that moved, and lights whose bounds a moved instance entered or left, need new shadow maps
+    Lighting::UpdateShadowedLights();
+    Lighting::m_LightShadowCache.InvalidateMovedInstances(m_Scene.GetSceneGraph());
+
     auto& camera = m_Scene.GetCamera();
 
     m_ViewProjMatrix = camera.GetViewProjMatrix();
@@ -572,84 +782,658 @@ void ModelViewer::Update(float deltaT)
     m_SunDirection = Normalize(Vector3(costheta * cosphi, sinphi, sintheta * cosphi));
 }
 
-void ModelViewer::RenderObjects(GraphicsContext& gfxContext, const Matrix4& ViewProjMat, eObjectFilter Filter)
+void ModelViewer::RenderObjects(GraphicsContext& gfxContext, const Matrix4& ViewProjMat, eObjectFilter Filter, const ShadowCamera* CullCamera,
+    bool TestOcclusion)
+{
+    // The table is built at load time and covers every instance that existed then
+    if (IndirectDraws && m_IndirectTable.GetCommandCapacity() > 0 &&
+        m_IndirectTable.GetInstanceCount() == m_Scene.GetInstanceCount())
+    {
+        RenderObjectsIndirect(gfxContext, ViewProjMat, Filter, TestOcclusion);
+        return;
+    }
+
+    uint32_t NumDraws = 0;
+    for (uint32_t instance = 0; instance < m_Scene.GetInstanceCount(); instance++)
+        NumDraws += m_Scene.GetModel(m_Scene.GetInstanceModel(instance)).m_Header.meshCount;
+
+    // Each worker costs a command list and a submission, so only fork when every worker has enough to record
+    uint32_t NumWorkers = 1;
+    if (ParallelRecording)
+    {
+        NumWorkers = std::min<uint32_t>((uint32_t)RecordingWorkers, g_JobScheduler.GetThreadCount());
+        NumWorkers = std::min<uint32_t>(NumWorkers, NumDraws / (uint32_t)MinDrawsPerWorker);
+    }
+
+    if (NumWorkers < 2)
+    {
+        RecordObjects(gfxContext, ViewProjMat, Filter, CullCamera, TestOcclusion, 0, NumDraws);
+        return;
+    }
+
+    // Worker i records the i-th slice of the draws, and the join submits the slices in order, so the GPU draws
+    // in the same order as when recording serially
+    GraphicsContext* Workers[CommandContext::kMaxWorkerContexts];
+    gfxContext.ForkWorkers(NumWorkers, Workers);
+
+    g_JobScheduler.ParallelFor(0, NumWorkers, [&](uint32_t i)
+    {
+        RecordObjects(*Workers[i], ViewProjMat, Filter, CullCamera, TestOcclusion,
+            (uint32_t)((uint64_t)NumDraws * i / NumWorkers), (uint32_t)((uint64_t)NumDraws * (i + 1) / NumWorkers));
+    });
+
+    gfxContext.JoinWorkers();
+}
+
+void ModelViewer::RecordObjects(GraphicsContext& gfxContext, const Matrix4& ViewProjMat, eObjectFilter Filter, const ShadowCamera* CullCamera,
+    bool TestOcclusion, uint32_t FirstDraw, uint32_t EndDraw)
 {
     struct VSConstants
     {
         Matrix4 modelToProjection;
         Matrix4 modelToShadow;
+        Matrix4 modelToWorld;
         XMFLOAT3 viewerPos;
     } vsConstants;
 
-    vsConstants.modelToProjection = ViewProjMat;
-    vsConstants.modelToShadow = m_SunShadow.GetShadowMatrix();
     XMStoreFloat3(&vsConstants.viewerPos, m_Scene.GetCamera().GetPosition());
-    gfxContext.SetDynamicConstantBufferView(0, sizeof(vsConstants), &vsConstants);
 
-    uint32_t materialIdx = 0xFFFFFFFFul;
+    const Matrix4& ShadowMat = m_SunShadow.GetShadowMatrix();
+    uint32_t modelIdx = 0xFFFFFFFFul;
+    uint32_t instanceFirstDraw = 0;
+
+    // Marking touches every texture of the material, and the textures are shared by all workers, so mark
+    // each material once per call rather than on every material change
+    std::vector<bool> materialMarked;
 
-    auto& model = m_Scene.GetModel();
+    // The pyramid is empty until the first read back copy arrives and after resets
+    const bool occlusionCull = TestOcclusion && OcclusionCulling && !m_CpuPyramid.IsEmpty();
+    const float depthBias = OcclusionDepthBias;
+    const float occlusionMargin = OcclusionReprojectionMargin * (float)(Graphics::GetFrameCount() - m_CpuPyramidFrame);
+    const bool softwareCull = TestOcclusion && SoftwareOcclusionCulling && m_SoftwareOcclusion.GetStats().Occluders > 0;
+
+    for (uint32_t instance = 0; instance < m_Scene.GetInstanceCount() && instanceFirstDraw < EndDraw; instance++)
+    {
+        const uint32_t instanceModel = m_Scene.GetInstanceModel(instance);
+        auto& model = m_Scene.GetModel(instanceModel);
 
-    uint32_t VertexStride = model.m_VertexStride;
+        const uint32_t meshBegin = FirstDraw > instanceFirstDraw ? FirstDraw - instanceFirstDraw : 0;
+        const uint32_t meshEnd = std::min<uint32_t>(model.m_Header.meshCount, EndDraw - instanceFirstDraw);
+        instanceFirstDraw += model.m_Header.meshCount;
+        if (meshBegin >= meshEnd)
+            continue;
 
-    gfxContext.SetDynamicDescriptors(3, Model::kMaterialTexChannelCount() - 1, 1, &model.m_MaterialConstants.GetSRV());
+        if (CullCamera != nullptr)
+        {
+            Vector3 instanceMin, instanceMax;
+            m_Scene.GetInstanceBounds(instance, instanceMin, instanceMax);
+            if (!CullCamera->IntersectBoundingBox(instanceMin, instanceMax))
+                continue;
+        }
 
-    for (uint32_t meshIndex = 0; meshIndex < model.m_Header.meshCount; meshIndex++)
+        if (occlusionCull)
+        {
+            Vector3 instanceMin, instanceMax;
+            m_Scene.GetInstanceBounds(instance, instanceMin, instanceMax);
+            if (m_CpuPyramid.IsOccludedReprojected(reinterpret_cast<const float*>(&m_CpuPyramidViewProj), reinterpret_cast<const float*>(&ViewProjMat),
+                reinterpret_cast<const float*>(&instanceMin), reinterpret_cast<const float*>(&instanceMax), m_CpuPyramidInvFarClip,
+                depthBias, occlusionMargin))
+                continue;
+        }
+
+        if (softwareCull)
+        {
+            Vector3 instanceMin, instanceMax;
+            m_Scene.GetInstanceBounds(instance, instanceMin, instanceMax);
+            if (m_SoftwareOcclusion.IsOccluded(reinterpret_cast<const float*>(&m_SoftwareOcclusionViewProj),
+                reinterpret_cast<const float*>(&instanceMin), reinterpret_cast<const float*>(&instanceMax)))
+                continue;
+        }
+
+        const Matrix4 World = m_Scene.GetInstanceMatrix(instance);
+        const Matrix4 modelToPrevProjection = occlusionCull ? m_CpuPyramidViewProj * World : World;
+        const Matrix4 modelToProjection = ViewProjMat * World;
+        const Matrix4 modelToSoftwareProjection = softwareCull ? m_SoftwareOcclusionViewProj * World : World;
+        const std::vector<bool>& isCutout = m_pMaterialIsCutout[instanceModel];
+
+        // Instances of the same model are usually placed together, so rebinding is rare
+        if (instanceModel != modelIdx)
+        {
+            modelIdx = instanceModel;
+            materialMarked.assign(model.m_Header.materialCount, false);
+            gfxContext.SetIndexBuffer(model.m_IndexBuffer.IndexBufferView());
+            gfxContext.SetVertexBuffer(0, model.m_VertexBuffer.VertexBufferView());
+            gfxContext.SetDynamicDescriptors(3, Model::kMaterialTexChannelCount() - 1, 1, &model.m_MaterialConstants.GetSRV());
+        }
+
+        vsConstants.modelToProjection = modelToProjection;
+        vsConstants.modelToShadow = ShadowMat * World;
+        vsConstants.modelToWorld = World;
+        gfxContext.SetDynamicConstantBufferView(0, sizeof(vsConstants), &vsConstants);
+
+        uint32_t materialIdx = 0xFFFFFFFFul;
+
+        uint32_t VertexStride = model.m_VertexStride;
+
+        for (uint32_t meshIndex = meshBegin; meshIndex < meshEnd; meshIndex++)
+        {
+            const Model::Mesh& mesh = model.m_pMesh[meshIndex];
+
+            if (CullCamera != nullptr)
+            {
+                Vector3 meshMin, meshMax;
+                Scene::TransformBounds(World, mesh.boundingBox, meshMin, meshMax);
+                if (!CullCamera->IntersectBoundingBox(meshMin, meshMax))
+                    continue;
+            }
+
+            if (occlusionCull && m_CpuPyramid.IsOccludedReprojected(reinterpret_cast<const float*>(&modelToPrevProjection),
+                reinterpret_cast<const float*>(&modelToProjection), reinterpret_cast<const float*>(&mesh.boundingBox.min),
+                reinterpret_cast<const float*>(&mesh.boundingBox.max), m_CpuPyramidInvFarClip, depthBias, occlusionMargin))
+                continue;
+
+            if (softwareCull && m_SoftwareOcclusion.IsOccluded(reinterpret_cast<const float*>(&modelToSoftwareProjection),
+                reinterpret_cast<const float*>(&mesh.boundingBox.min), reinterpret_cast<const float*>(&mesh.boundingBox.max)))
+                continue;
+
+            uint32_t indexCount = mesh.indexCount;
+            uint32_t startIndex = mesh.indexDataByteOffset / sizeof(uint16_t);
+            uint32_t baseVertex = mesh.vertexDataByteOffset / VertexStride;
+
+            if (mesh.materialIndex != materialIdx)
+            {
+                if (isCutout[mesh.materialIndex] && !(Filter & kCutout) ||
+                    !isCutout[mesh.materialIndex] && !(Filter & kOpaque))
+                    continue;
+
+                materialIdx = mesh.materialIndex;
+                if (!materialMarked[materialIdx])
+                {
+                    materialMarked[materialIdx] = true;
+                    model.MarkMaterialUsed(materialIdx);
+                }
+                gfxContext.SetDynamicDescriptors(3, 0, Model::kMaterialTexChannelCount() - 1, model.GetSRVs(materialIdx));
+                __declspec(align(16)) struct {
+                    UINT32 vmaterialIdx;
+                } psMaterialConstants;
+                psMaterialConstants.vmaterialIdx = materialIdx;
+                gfxContext.SetDynamicConstantBufferView(2, sizeof(psMaterialConstants), &psMaterialConstants);
+            }
+
+            gfxContext.SetConstants(5, baseVertex, materialIdx);
+
+            gfxContext.DrawIndexed(indexCount, startIndex, baseVertex);
+        }
+    }
+}
+
+void ModelViewer::CreateIndirectDrawTable(void)
+{
+    const uint32_t modelCount = m_Scene.GetModelCount();
+    std::vector<std::vector<IndirectDrawTable::MeshDesc>> meshDescs(modelCount);
+    std::vector<IndirectDrawTable::ModelDesc> modelDescs(modelCount);
+
+    for (uint32_t modelIdx = 0; modelIdx < modelCount; ++modelIdx)
     {
-        const Model::Mesh& mesh = model.m_pMesh[meshIndex];
+        const Model& model = m_Scene.GetModel(modelIdx);
+        std::vector<IndirectDrawTable::MeshDesc>& descs = meshDescs[modelIdx];
 
-        uint32_t indexCount = mesh.indexCount;
-        uint32_t startIndex = mesh.indexDataByteOffset / sizeof(uint16_t);
-        uint32_t baseVertex = mesh.vertexDataByteOffset / VertexStride;
+        descs.resize(model.m_Header.meshCount);
+        for (uint32_t meshIndex = 0; meshIndex < model.m_Header.meshCount; ++meshIndex)
+        {
+            const Model::Mesh& mesh = model.m_pMesh[meshIndex];
+            IndirectDrawTable::MeshDesc& desc = descs[meshIndex];
+
+            desc.BoundsMin[0] = mesh.boundingBox.min.GetX();
+            desc.BoundsMin[1] = mesh.boundingBox.min.GetY();
+            desc.BoundsMin[2] = mesh.boundingBox.min.GetZ();
+            desc.BoundsMax[0] = mesh.boundingBox.max.GetX();
+            desc.BoundsMax[1] = mesh.boundingBox.max.GetY();
+            desc.BoundsMax[2] = mesh.boundingBox.max.GetZ();
+            desc.IndexCount = mesh.indexCount;
+            desc.StartIndex = mesh.indexDataByteOffset / sizeof(uint16_t);
+            desc.BaseVertex = mesh.vertexDataByteOffset / model.m_VertexStride;
+            desc.MaterialIndex = mesh.materialIndex;
+            desc.Flags = m_pMaterialIsCutout[modelIdx][mesh.materialIndex] ? IndirectDrawTable::kFlagCutout : IndirectDrawTable::kFlagOpaque;
+        }
+
+        modelDescs[modelIdx].Meshes = descs.data();
+        modelDescs[modelIdx].MeshCount = (uint32_t)descs.size();
+    }
 
-        if (mesh.materialIndex != materialIdx)
+    std::vector<uint32_t> instanceModels(m_Scene.GetInstanceCount());
+    for (uint32_t instance = 0; instance < m_Scene.GetInstanceCount(); ++instance)
+        instanceModels[instance] = m_Scene.GetInstanceModel(instance);
+
+    m_IndirectTable.Build(modelDescs.data(), modelCount, instanceModels.data(), (uint32_t)instanceModels.size());
+
+    const uint32_t capacity = m_IndirectTable.GetCommandCapacity();
+    if (capacity == 0)
+        return;
+
+    m_IndirectRecords.Create(L"Indirect Draw Records", capacity, sizeof(IndirectDrawTable::DrawRecord), m_IndirectTable.GetRecords().data());
+    m_IndirectCommands.Create(L"Indirect Draw Commands", capacity, sizeof(IndirectDrawTable::DrawCommand));
+    m_IndirectCounts.Create(L"Indirect Draw Counts", (uint32_t)m_IndirectTable.GetBuckets().size(), sizeof(uint32_t));
+}
+
+void ModelViewer::CreateSoftwareOccluders(void)
+{
+    m_SoftwareOcclusion.Clear();
+
+    // The depth-only geometry is freed once it is uploaded, so read it again just for this
+    if (!m_Scene.LoadDepthGeometry())
+    {
+        Utility::Print("Unable to read the depth geometry, software occlusion culling is off\n");
+        return;
+    }
+
+    std::vector<SoftwareOcclusion::MeshDesc> descs;
+    for (uint32_t modelIdx = 0; modelIdx < m_Scene.GetModelCount(); ++modelIdx)
+    {
+        const Model& model = m_Scene.GetModel(modelIdx);
+
+        // Cutouts have holes, so only solid meshes can hide anything
+        descs.clear();
+        for (uint32_t meshIndex = 0; meshIndex < model.m_Header.meshCount; ++meshIndex)
         {
-            if (m_pMaterialIsCutout[mesh.materialIndex] && !(Filter & kCutout) ||
-                !m_pMaterialIsCutout[mesh.materialIndex] && !(Filter & kOpaque))
+            const Model::Mesh& mesh = model.m_pMesh[meshIndex];
+            if (m_pMaterialIsCutout[modelIdx][mesh.materialIndex])
                 continue;
 
-            materialIdx = mesh.materialIndex;
-            gfxContext.SetDynamicDescriptors(3, 0, Model::kMaterialTexChannelCount() - 1, model.GetSRVs(materialIdx));
-            __declspec(align(16)) struct {
-                UINT32 vmaterialIdx;
-            } psMaterialConstants;
-            psMaterialConstants.vmaterialIdx = materialIdx;
-            gfxContext.SetDynamicConstantBufferView(2, sizeof(psMaterialConstants), &psMaterialConstants);
+            SoftwareOcclusion::MeshDesc desc;
+            desc.Positions = (const float*)(model.m_pVertexDataDepth + mesh.vertexDataByteOffsetDepth + mesh.attribDepth[Model::attrib_position].offset);
+            desc.VertexStride = mesh.vertexStrideDepth;
+            desc.VertexCount = mesh.vertexCountDepth;
+            desc.Indices = (const uint16_t*)(model.m_pIndexDataDepth + mesh.indexDataByteOffset);
+            desc.IndexCount = mesh.indexCount;
+            desc.BoundsMin[0] = mesh.boundingBox.min.GetX();
+            desc.BoundsMin[1] = mesh.boundingBox.min.GetY();
+            desc.BoundsMin[2] = mesh.boundingBox.min.GetZ();
+            desc.BoundsMax[0] = mesh.boundingBox.max.GetX();
+            desc.BoundsMax[1] = mesh.boundingBox.max.GetY();
+            desc.BoundsMax[2] = mesh.boundingBox.max.GetZ();
+            descs.push_back(desc);
         }
 
-        gfxContext.SetConstants(5, baseVertex, materialIdx);
+        m_SoftwareOcclusion.AddModel(modelIdx, descs.data(), (uint32_t)descs.size());
+    }
+
+    m_Scene.ReleaseDepthGeometry();
+}
 
-        gfxContext.DrawIndexed(indexCount, startIndex, baseVertex);
+void ModelViewer::RenderSoftwareOcclusion(void)
+{
+    if (!SoftwareOcclusionCulling || m_SoftwareOcclusion.GetOccluderCount() == 0)
+        return;
+
+    ScopedTimer _prof(L"Software Occlusion");
+
+    m_SoftwareOcclusionViewProj = m_ViewProjMatrix;
+    m_SoftwareOcclusion.SetTriangleBudget((uint32_t)SoftwareOcclusionTriangles);
+    m_SoftwareOcclusion.Begin(reinterpret_cast<const float*>(&m_SoftwareOcclusionViewProj));
+    for (uint32_t instance = 0; instance < m_Scene.GetInstanceCount(); ++instance)
+    {
+        const Matrix4 World = m_Scene.GetInstanceMatrix(instance);
+        m_SoftwareOcclusion.AddInstance(m_Scene.GetInstanceModel(instance), reinterpret_cast<const float*>(&World));
+    }
+    m_SoftwareOcclusion.Rasterize();
+}
+
+void ModelViewer::RenderObjectsIndirect(GraphicsContext& gfxContext, const Matrix4& ViewProjMat, eObjectFilter Filter, bool TestOcclusion)
+{
+    static_assert(sizeof(IndirectInstanceConstants) == D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT,
+        "Each instance's constants must start on a constant buffer boundary");
+
+    const uint32_t instanceCount = m_Scene.GetInstanceCount();
+    const Matrix4& ShadowMat = m_SunShadow.GetShadowMatrix();
+    const bool occlusionCull = TestOcclusion && OcclusionCulling && m_PyramidReady;
+
+    m_IndirectInstances.resize(instanceCount);
+    m_IndirectOcclusionMatrices.resize(occlusionCull ? instanceCount : 0);
+    for (uint32_t instance = 0; instance < instanceCount; ++instance)
+    {
+        const Matrix4 World = m_Scene.GetInstanceMatrix(instance);
+        IndirectInstanceConstants& constants = m_IndirectInstances[instance];
+        constants.modelToProjection = ViewProjMat * World;
+        constants.modelToShadow = ShadowMat * World;
+        constants.modelToWorld = World;
+        XMStoreFloat3(&constants.viewerPos, m_Scene.GetCamera().GetPosition());
+
+        if (occlusionCull)
+            m_IndirectOcclusionMatrices[instance] = m_PyramidViewProj * World;
+    }
+
+    // The draws and the culling pass both read the constants from upload memory
+    const size_t constantsSize = instanceCount * sizeof(IndirectInstanceConstants);
+    DynAlloc instanceConstants = gfxContext.ReserveUploadMemory(constantsSize);
+    memcpy(instanceConstants.DataPtr, m_IndirectInstances.data(), constantsSize);
+
+    {
+        ComputeContext& Context = gfxContext.GetComputeContext();
+        ScopedTimer _prof(L"Cull Draws", Context);
+
+        Context.SetRootSignature(m_IndirectCullRootSig);
+        Context.SetPipelineState(m_IndirectCullPSO);
+
+        Context.TransitionResource(m_IndirectRecords, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(m_DepthPyramid, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        Context.TransitionResource(m_IndirectCommands, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        Context.TransitionResource(m_IndirectCounts, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        Context.ClearUAV(m_IndirectCounts);
+        Context.InsertUAVBarrier(m_IndirectCounts);
+
+        struct
+        {
+            uint32_t RecordCount;
+            uint32_t FilterFlags;
+            uint64_t ConstantsAddress;
+            uint32_t ConstantsStride;
+            uint32_t OcclusionEnable;
+            float InvFarClip;
+            float DepthBias;
+            uint32_t PyramidSize[2];
+            uint32_t PyramidLevels;
+        } csConstants;
+        csConstants.RecordCount = m_IndirectTable.GetCommandCapacity();
+        csConstants.FilterFlags = Filter;
+        csConstants.ConstantsAddress = instanceConstants.GpuAddress;
+        csConstants.ConstantsStride = sizeof(IndirectInstanceConstants);
+        csConstants.OcclusionEnable = occlusionCull ? 1 : 0;
+        csConstants.InvFarClip = m_PyramidInvFarClip;
+        csConstants.DepthBias = OcclusionDepthBias;
+        csConstants.PyramidSize[0] = m_PyramidWidth;
+        csConstants.PyramidSize[1] = m_PyramidHeight;
+        csConstants.PyramidLevels = m_PyramidLevelCount;
+        Context.SetDynamicConstantBufferView(0, sizeof(csConstants), &csConstants);
+        Context.SetShaderResourceView(1, instanceConstants.GpuAddress);
+        Context.SetDynamicDescriptor(2, 0, m_IndirectRecords.GetSRV());
+        Context.SetDynamicDescriptor(2, 1, m_DepthPyramid.GetSRV());
+        // Without occlusion culling the shader never reads the matrices, but the root SRV needs an address
+        if (occlusionCull)
+            Context.SetDynamicSRV(4, instanceCount * sizeof(Matrix4), m_IndirectOcclusionMatrices.data());
+        else
+            Context.SetBufferSRV(4, m_IndirectRecords);
+        Context.SetDynamicDescriptor(3, 0, m_IndirectCommands.GetUAV());
+        Context.SetDynamicDescriptor(3, 1, m_IndirectCounts.GetUAV());
+        Context.Dispatch1D(csConstants.RecordCount, 64);
+
+        Context.TransitionResource(m_IndirectCommands, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+        Context.TransitionResource(m_IndirectCounts, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+    }
+
+    gfxContext.RestorePipelineState();
+
+    const std::vector<IndirectDrawTable::Bucket>& buckets = m_IndirectTable.GetBuckets();
+    uint32_t modelIdx = 0xFFFFFFFFul;
+
+    for (uint32_t bucketIndex = 0; bucketIndex < (uint32_t)buckets.size(); ++bucketIndex)
+    {
+        const IndirectDrawTable::Bucket& bucket = buckets[bucketIndex];
+        if ((bucket.Flags & Filter) == 0)
+            continue;
+
+        auto& model = m_Scene.GetModel(bucket.ModelIndex);
+
+        if (bucket.ModelIndex != modelIdx)
+        {
+            modelIdx = bucket.ModelIndex;
+            gfxContext.SetIndexBuffer(model.m_IndexBuffer.IndexBufferView());
+            gfxContext.SetVertexBuffer(0, model.m_VertexBuffer.VertexBufferView());
+            gfxContext.SetDynamicDescriptors(3, Model::kMaterialTexChannelCount() - 1, 1, &model.m_MaterialConstants.GetSRV());
+        }
+
+        // Whether any of the bucket's draws survive is only known on the GPU, so the textures are kept resident
+        // for all of them
+        model.MarkMaterialUsed(bucket.MaterialIndex);
+        gfxContext.SetDynamicDescriptors(3, 0, Model::kMaterialTexChannelCount() - 1, model.GetSRVs(bucket.MaterialIndex));
+        __declspec(align(16)) struct {
+            UINT32 vmaterialIdx;
+        } psMaterialConstants;
+        psMaterialConstants.vmaterialIdx = bucket.MaterialIndex;
+        gfxContext.SetDynamicConstantBufferView(2, sizeof(psMaterialConstants), &psMaterialConstants);
+
+        gfxContext.ExecuteIndirect(m_IndirectDrawSignature, m_IndirectCommands,
+            bucket.FirstCommand * sizeof(IndirectDrawTable::DrawCommand), bucket.Capacity,
+            &m_IndirectCounts, bucketIndex * sizeof(uint32_t));
+    }
+}
+
+void ModelViewer::CreateDepthPyramid(uint32_t BaseWidth, uint32_t BaseHeight)
+{
+    // Frames in flight may still build the pyramid or copy it into the readback buffers
+    g_CommandManager.IdleGPU();
+
+    m_PyramidWidth = BaseWidth;
+    m_PyramidHeight = BaseHeight;
+    m_PyramidLevelCount = DepthPyramid::GetLevelCount(BaseWidth, BaseHeight);
+    m_DepthPyramid.Create(L"Depth Pyramid", BaseWidth, BaseHeight, m_PyramidLevelCount, DXGI_FORMAT_R32_FLOAT);
+
+    // The CPU only gets the levels it can test against cheaply
+    m_PyramidReadbackLevel = 0;
+    while (std::max(BaseWidth, BaseHeight) >> m_PyramidReadbackLevel > (uint32_t)kMaxPyramidReadbackSize)
+        ++m_PyramidReadbackLevel;
+
+    const D3D12_RESOURCE_DESC pyramidDesc = m_DepthPyramid.GetResource()->GetDesc();
+    for (PyramidReadback& readback : m_PyramidReadbacks)
+    {
+        UINT64 totalBytes = 0;
+        g_Device->GetCopyableFootprints(&pyramidDesc, m_PyramidReadbackLevel, m_PyramidLevelCount - m_PyramidReadbackLevel, 0,
+            readback.Footprints, nullptr, nullptr, &totalBytes);
+        readback.Buffer.Create(L"Depth Pyramid Readback", (uint32_t)totalBytes, 1);
+        readback.Pending = false;
+    }
+
+    m_IssuedReadback = -1;
+    m_CpuPyramid.Clear();
+}
+
+void ModelViewer::UpdateDepthPyramid(GraphicsContext& gfxContext)
+{
+    // Resolution changes and camera cuts leave no depth to cull against
+    const bool usable = OcclusionCulling && m_DepthHistory.Valid && !TemporalEffects::TriggerReset;
+    m_DepthHistory.Valid = false;
+    m_PyramidReady = false;
+
+    if (!usable)
+    {
+        for (PyramidReadback& readback : m_PyramidReadbacks)
+            readback.Pending = false;
+        m_CpuPyramid.Clear();
+        return;
+    }
+
+    ColorBuffer& linearDepth = *m_DepthHistory.LinearDepth;
+    const uint32_t srcWidth = std::min<uint32_t>(m_DepthHistory.Width, linearDepth.GetWidth());
+    const uint32_t srcHeight = std::min<uint32_t>(m_DepthHistory.Height, linearDepth.GetHeight());
+
+    uint32_t baseWidth, baseHeight;
+    DepthPyramid::GetBaseSize(srcWidth, srcHeight, baseWidth, baseHeight);
+    if (baseWidth != m_PyramidWidth || baseHeight != m_PyramidHeight)
+        CreateDepthPyramid(baseWidth, baseHeight);
+
+    // The GPU finishes frames in order, so the newest completed copy supersedes the older ones
+    PyramidReadback* newest = nullptr;
+    for (PyramidReadback& readback : m_PyramidReadbacks)
+    {
+        if (readback.Pending && g_CommandManager.IsFenceComplete(readback.Fence) &&
+            (newest == nullptr || readback.FrameIndex > newest->FrameIndex))
+            newest = &readback;
+    }
+
+    if (newest != nullptr)
+    {
+        const uint32_t levelCount = m_PyramidLevelCount - m_PyramidReadbackLevel;
+        m_CpuPyramid.Reset(newest->Footprints[0].Footprint.Width, newest->Footprints[0].Footprint.Height, levelCount);
+
+        const uint8_t* data = (const uint8_t*)newest->Buffer.Map();
+        for (uint32_t level = 0; level < levelCount; ++level)
+        {
+            const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint = newest->Footprints[level];
+            const uint32_t width = m_CpuPyramid.GetWidth(level);
+            for (uint32_t y = 0; y < m_CpuPyramid.GetHeight(level); ++y)
+            {
+                memcpy(m_CpuPyramid.GetLevelData(level) + y * width,
+                    data + footprint.Offset + y * footprint.Footprint.RowPitch, width * sizeof(float));
+            }
+        }
+        newest->Buffer.Unmap();
+
+        m_CpuPyramidViewProj = newest->ViewProj;
+        m_CpuPyramidInvFarClip = newest->InvFarClip;
+        m_CpuPyramidFrame = newest->FrameIndex;
+
+        const uint64_t newestFrame = newest->FrameIndex;
+        for (PyramidReadback& readback : m_PyramidReadbacks)
+        {
+            if (readback.FrameIndex <= newestFrame)
+                readback.Pending = false;
+        }
+    }
+
+    ComputeContext& Context = gfxContext.GetComputeContext();
+    ScopedTimer _prof(L"Build Depth Pyramid", Context);
+
+    Context.SetRootSignature(m_DepthPyramidRootSig);
+    Context.TransitionResource(linearDepth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    Context.TransitionResource(m_DepthPyramid, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    Context.SetPipelineState(m_DepthPyramidInitPSO);
+    Context.SetConstants(0, srcWidth, srcHeight, baseWidth, baseHeight);
+    Context.SetDynamicDescriptor(1, 0, linearDepth.GetSRV());
+    Context.SetDynamicDescriptor(2, 0, m_DepthPyramid.GetMipUAV(0));
+    Context.Dispatch2D(baseWidth, baseHeight);
+
+    Context.SetPipelineState(m_DepthPyramidDownsamplePSO);
+    for (uint32_t level = 1; level < m_PyramidLevelCount; ++level)
+    {
+        const uint32_t dstWidth = std::max(baseWidth >> level, 1u);
+        const uint32_t dstHeight = std::max(baseHeight >> level, 1u);
+
+        Context.InsertUAVBarrier(m_DepthPyramid);
+        Context.SetConstants(0, std::max(baseWidth >> (level - 1), 1u), std::max(baseHeight >> (level - 1), 1u), dstWidth, dstHeight);
+        Context.SetDynamicDescriptor(2, 0, m_DepthPyramid.GetMipUAV(level));
+        Context.SetDynamicDescriptor(3, 0, m_DepthPyramid.GetMipUAV(level - 1));
+        Context.Dispatch2D(dstWidth, dstHeight);
+    }
+
+    // Copy the coarse levels for the CPU.  RenderScene fills in the fence when it submits the frame.
+    const uint32_t readbackIndex = (uint32_t)(Graphics::GetFrameCount() % kPyramidReadbackCount);
+    PyramidReadback& readback = m_PyramidReadbacks[readbackIndex];
+
+    Context.TransitionResource(m_DepthPyramid, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    for (uint32_t level = m_PyramidReadbackLevel; level < m_PyramidLevelCount; ++level)
+        Context.CopySubresourceToBuffer(readback.Buffer, readback.Footprints[level - m_PyramidReadbackLevel], m_DepthPyramid, level);
+
+    readback.ViewProj = m_DepthHistory.ViewProj;
+    readback.InvFarClip = 1.0f / m_DepthHistory.FarClip;
+    readback.FrameIndex = Graphics::GetFrameCount();
+    readback.Fence = 0;
+    readback.Pending = true;
+    m_IssuedReadback = (int)readbackIndex;
+
+    m_PyramidViewProj = m_DepthHistory.ViewProj;
+    m_PyramidInvFarClip = 1.0f / m_DepthHistory.FarClip;
+    m_PyramidReady = true;
+}
+
+void ModelViewer::UpdateSunShadow(void)
+{
+    const uint32_t ShadowWidth = (uint32_t)g_ShadowBuffer.GetWidth();
+    const uint32_t ShadowHeight = (uint32_t)g_ShadowBuffer.GetHeight();
+
+    m_NumShadowCascades = ShadowCascadeCount;
+    if (m_NumShadowCascades <= 1)
+    {
+        m_SunShadow.UpdateMatrix(-m_SunDirection, m_Scene.GetCenter() - m_SunDirection * 0.35f *m_Scene.GetModelRadius(), Vector3(ShadowDimX, ShadowDimY, ShadowDimZ),
+            ShadowWidth, ShadowHeight, 16);
+        //m_SunShadow.UpdateMatrix(-m_SunDirection, Vector3(0, -500.0f, 0), Vector3(ShadowDimX, ShadowDimY, ShadowDimZ),
+        //	(uint32_t)g_ShadowBuffer.GetWidth(), (uint32_t)g_ShadowBuffer.GetHeight(), 16);
+        return;
+    }
+
+    const Camera& camera = m_Scene.GetCamera();
+    const Model::BoundingBox& sceneBounds = m_Scene.GetBoundingBox();
+    const Matrix4& ProjMat = camera.GetProjMatrix();
+    const float TanHalfFovX = 1.0f / ProjMat.GetX().GetX();
+    const float TanHalfFovY = 1.0f / ProjMat.GetY().GetY();
+
+    ComputeCascadeSplits(camera.GetNearClip(), Min(camera.GetFarClip(), (float)ShadowCascadeDistance),
+        m_NumShadowCascades, ShadowCascadeLambda, m_CascadeSplits);
+
+    for (uint32_t i = 0; i < m_NumShadowCascades; ++i)
+    {
+        BoundingSphere sliceBounds = ComputeFrustumSliceSphere(camera.GetPosition(), camera.GetForwardVec(),
+            TanHalfFovX, TanHalfFovY, m_CascadeSplits[i], m_CascadeSplits[i + 1]);
+
+        m_SunShadowCascades[i].UpdateCascade(-m_SunDirection, sliceBounds, sceneBounds.min, sceneBounds.max,
+            ShadowWidth / 2, ShadowHeight / 2, 16);
     }
 }
 
+void ModelViewer::RenderSunShadow(GraphicsContext& gfxContext)
+{
+    ScopedTimer _prof(L"Render Shadow Map", gfxContext);
+
+    g_ShadowBuffer.BeginRendering(gfxContext);
+
+    if (m_NumShadowCascades <= 1)
+    {
+        gfxContext.SetPipelineState(m_ShadowPSO);
+        RenderObjects(gfxContext, m_SunShadow.GetViewProjMatrix(), kOpaque);
+        gfxContext.SetPipelineState(m_CutoutShadowPSO);
+        RenderObjects(gfxContext, m_SunShadow.GetViewProjMatrix(), kCutout);
+    }
+    else
+    {
+        const uint32_t CascadeWidth = (uint32_t)g_ShadowBuffer.GetWidth() / 2;
+        const uint32_t CascadeHeight = (uint32_t)g_ShadowBuffer.GetHeight() / 2;
+
+        for (uint32_t i = 0; i < m_NumShadowCascades; ++i)
+        {
+            // Leave a one texel border around each quadrant, as the full buffer does, so filtering at the
+            // edge of a cascade never reads its neighbor's depths
+            uint32_t Left = (i & 1) * CascadeWidth;
+            uint32_t Top = (i >> 1) * CascadeHeight;
+            gfxContext.SetViewport((float)Left, (float)Top, (float)CascadeWidth, (float)CascadeHeight);
+            gfxContext.SetScissor(Left + 1, Top + 1, Left + CascadeWidth - 2, Top + CascadeHeight - 2);
+
+            const ShadowCamera& cascade = m_SunShadowCascades[i];
+            gfxContext.SetPipelineState(m_ShadowPSO);
+            RenderObjects(gfxContext, cascade.GetViewProjMatrix(), kOpaque, &cascade);
+            gfxContext.SetPipelineState(m_CutoutShadowPSO);
+            RenderObjects(gfxContext, cascade.GetViewProjMatrix(), kCutout, &cascade);
+        }
+    }
+
+    g_ShadowBuffer.EndRendering(gfxContext);
+}
+
 void ModelViewer::RenderLightShadows(GraphicsContext& gfxContext)
 {
     using namespace Lighting;
 
     ScopedTimer _prof(L"RenderLightShadows", gfxContext);
 
-    static uint32_t LightIndex = 0;
-    if (LightIndex >= MaxLights)
+    m_LightShadowCache.SetBudget(LightShadowBudget, LightShadowMaxUpdates);
+    const std::vector<uint32_t>& updates = m_LightShadowCache.Schedule(m_Scene.GetCamera());
+    if (updates.empty())
         return;
 
-    m_LightShadowTempBuffer.BeginRendering(gfxContext);
+    // The cost estimate tracks CPU recording time, which dominates with one draw per mesh
+    int64_t startTick = SystemTime::GetCurrentTick();
+
+    for (uint32_t LightIndex : updates)
     {
+        m_LightShadowArray.BeginRendering(gfxContext, LightIndex);
         gfxContext.SetPipelineState(m_ShadowPSO);
         RenderObjects(gfxContext, m_LightShadowMatrix[LightIndex], kOpaque);
         gfxContext.SetPipelineState(m_CutoutShadowPSO);
         RenderObjects(gfxContext, m_LightShadowMatrix[LightIndex], kCutout);
     }
-    m_LightShadowTempBuffer.EndRendering(gfxContext);
-
-    gfxContext.TransitionResource(m_LightShadowTempBuffer, D3D12_RESOURCE_STATE_GENERIC_READ);
-    gfxContext.TransitionResource(m_LightShadowArray, D3D12_RESOURCE_STATE_COPY_DEST);
-
-    gfxContext.CopySubresource(m_LightShadowArray, LightIndex, m_LightShadowTempBuffer, 0);
-
-    gfxContext.TransitionResource(m_LightShadowArray, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    m_LightShadowArray.EndRendering(gfxContext);
 
-    ++LightIndex;
+    float elapsedMs = (float)SystemTime::TimeBetweenTicks(startTick, SystemTime::GetCurrentTick()) * 1000.0f;
+    m_LightShadowCache.ReportUpdateTime(elapsedMs, (uint32_t)updates.size());
 }
 
 void ModelViewer::RenderScene(void)
@@ -657,6 +1441,8 @@ void ModelViewer::RenderScene(void)
     GraphicsContext& gfxContext = GraphicsContext::Begin(L"Scene Render");
 
     UpdatePlacedResources( gfxContext );
+    UpdateDepthPyramid( gfxContext );
+    RenderSoftwareOcclusion();
 
 
     // We use viewport offsets to jitter sample positions from frame to frame (for TAA.)
@@ -739,6 +1525,11 @@ void ModelViewer::RenderScene(void)
         uint32_t TileCount[4];
         uint32_t FirstLightIndex[4];
         float DownSizedFactors[4];
+        float ClusterScale[4];
+        uint32_t ClusterCount[4];
+        Matrix4 CascadeShadowMatrix[4];
+        float CascadeSplits[4];
+        uint32_t CascadeCount[4];
 
     } psConstants;
 
@@ -764,16 +1555,27 @@ void ModelViewer::RenderScene(void)
     psConstants.DownSizedFactors[1] = m_DownSizedFactor.y;
     psConstants.DownSizedFactors[2] = *(float *) (int *) &flags;
 
-    auto& model = m_Scene.GetModel();
     auto& camera = m_Scene.GetCamera();
 
+    Lighting::GetClusterConstants(camera, psConstants.ClusterScale, psConstants.ClusterCount);
+
+    UpdateSunShadow();
+    psConstants.CascadeCount[0] = m_NumShadowCascades > 1 ? m_NumShadowCascades : 0;
+    for (uint32_t i = 0; i < m_NumShadowCascades && m_NumShadowCascades > 1; ++i)
+    {
+        // Map each cascade's texture space into its quadrant of the shadow buffer
+        Matrix4 toQuadrant = Matrix4(AffineTransform(Matrix3::MakeScale(0.5f, 0.5f, 1.0f),
+            Vector3(0.5f * (i & 1), 0.5f * (i >> 1), 0.0f)));
+        psConstants.CascadeShadowMatrix[i] = toQuadrant * m_SunShadowCascades[i].GetShadowMatrix();
+        psConstants.CascadeSplits[i] = m_CascadeSplits[i + 1];
+    }
+
     // Set the default state for command lists
     auto& pfnSetupGraphicsState = [&](void)
     {
         gfxContext.SetRootSignature(m_RootSig);
         gfxContext.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        gfxContext.SetIndexBuffer(model.m_IndexBuffer.IndexBufferView());
-        gfxContext.SetVertexBuffer(0, model.m_VertexBuffer.VertexBufferView());
+        // RenderObjects binds each model's vertex and index buffers
     };
 
     pfnSetupGraphicsState();
@@ -799,13 +1601,13 @@ void ModelViewer::RenderScene(void)
                     gfxContext.SetDepthStencilTarget(g_pSceneDepthBuffer->GetDSV());
 
                     gfxContext.SetViewportAndScissor(m_MainViewport, m_MainScissor);
-                    RenderObjects(gfxContext, m_ViewProjMatrix, kOpaque);
+                    RenderObjects(gfxContext, m_ViewProjMatrix, kOpaque, nullptr, true);
                 }
 
                 {
                     ScopedTimer _prof(L"Cutout", gfxContext);
                     gfxContext.SetPipelineState(m_CutoutDepthPSO);
-                    RenderObjects(gfxContext, m_ViewProjMatrix, kCutout);
+                    RenderObjects(gfxContext, m_ViewProjMatrix, kCutout, nullptr, true);
                 }
             }
 
@@ -824,13 +1626,13 @@ void ModelViewer::RenderScene(void)
                 gfxContext.SetDepthStencilTarget((*g_pMsaaDepth).GetDSV());
 
                 gfxContext.SetViewportAndScissor(m_MainViewport, m_MainScissor);
-                RenderObjects(gfxContext, m_ViewProjMatrix, kOpaque);
+                RenderObjects(gfxContext, m_ViewProjMatrix, kOpaque, nullptr, true);
                 {
                     ScopedTimer _prof(L"CutoutMSAA", gfxContext);
                     m_CutoutDepthMsaaPSO.SetMsaaCount((UINT) std::pow((UINT) 2, (UINT) MsaaMode));
                     m_CutoutDepthMsaaPSO.Finalize();
                     gfxContext.SetPipelineState(m_CutoutDepthMsaaPSO);
-                    RenderObjects(gfxContext, m_ViewProjMatrix, kCutout);
+                    RenderObjects(gfxContext, m_ViewProjMatrix, kCutout, nullptr, true);
                 }
             }
 
@@ -878,7 +1680,7 @@ void ModelViewer::RenderScene(void)
 #endif
                 gfxContext.SetDepthStencilTarget((*g_pCheckerboardDepths[m_FrameOffset]).GetDSV());
                 gfxContext.SetViewportAndScissor(m_DownSizedViewport, m_DownSizedScissor);
-                RenderObjects(gfxContext, m_ViewProjMatrix, kOpaque);
+                RenderObjects(gfxContext, m_ViewProjMatrix, kOpaque, nullptr, true);
 
                 {
                     ScopedTimer _prof(L"Cutout Checkerboard", gfxContext);
@@ -886,7 +1688,7 @@ void ModelViewer::RenderScene(void)
                     m_CutoutDepthMsaaPSO.Finalize();
                     gfxContext.SetPipelineState(m_CutoutDepthMsaaPSO);
 
-                    RenderObjects(gfxContext, m_ViewProjMatrix, kCutout);
+                    RenderObjects(gfxContext, m_ViewProjMatrix, kCutout, nullptr, true);
                 }
 
                 {
@@ -934,6 +1736,14 @@ void ModelViewer::RenderScene(void)
 
     SSAO::Render(gfxContext, camera);
 
+    // The checkerboard and MSAA resolves linearized the depth above; otherwise SSAO did
+    m_DepthHistory.ViewProj = m_ViewProjMatrix;
+    m_DepthHistory.FarClip = camera.GetFarClip();
+    m_DepthHistory.Width = (uint32_t)m_MainViewport.Width;
+    m_DepthHistory.Height = (uint32_t)m_MainViewport.Height;
+    m_DepthHistory.LinearDepth = &g_LinearDepth[CbrEnabled || MsaaEnabled ? Graphics::GetFrameCount() % 2 : TemporalEffects::GetFrameIndexMod2()];
+    m_DepthHistory.Valid = true;
+
     Lighting::FillLightGrid(gfxContext, camera);
 
     // -- Primary shading pass Normal, Upsampling,CBR
@@ -947,21 +1757,7 @@ void ModelViewer::RenderScene(void)
 
             pfnSetupGraphicsState();
 
-            {
-                ScopedTimer _prof(L"Render Shadow Map", gfxContext);
-
-                m_SunShadow.UpdateMatrix(-m_SunDirection, m_Scene.GetCenter() - m_SunDirection * 0.35f *m_Scene.GetModelRadius(), Vector3(ShadowDimX, ShadowDimY, ShadowDimZ),
-                    (uint32_t) g_ShadowBuffer.GetWidth(), (uint32_t) g_ShadowBuffer.GetHeight(), 16);
-                //m_SunShadow.UpdateMatrix(-m_SunDirection, Vector3(0, -500.0f, 0), Vector3(ShadowDimX, ShadowDimY, ShadowDimZ),
-                //	(uint32_t)g_ShadowBuffer.GetWidth(), (uint32_t)g_ShadowBuffer.GetHeight(), 16);
-
-                g_ShadowBuffer.BeginRendering(gfxContext);
-                gfxContext.SetPipelineState(m_ShadowPSO);
-                RenderObjects(gfxContext, m_SunShadow.GetViewProjMatrix(), kOpaque);
-                gfxContext.SetPipelineState(m_CutoutShadowPSO);
-                RenderObjects(gfxContext, m_SunShadow.GetViewProjMatrix(), kCutout);
-                g_ShadowBuffer.EndRendering(gfxContext);
-            }
+            RenderSunShadow(gfxContext);
 
             if (SSAO::AsyncCompute)
             {
@@ -972,9 +1768,24 @@ void ModelViewer::RenderScene(void)
                 g_CommandManager.GetGraphicsQueue().StallForProducer(g_CommandManager.GetComputeQueue());
             }
 
+            // With MSAA or checkerboard rendering the scene color buffer is only written again by the resolve,
+            // so begin moving it to the resolve's state now and let the color pass hide the transition.  The
+            // begin and end must be on the same command list, so when the color pass may be forked across
+            // worker lists the resolve makes an ordinary transition instead.
+            const bool SingleColorList = !ParallelRecording;
+            if (SingleColorList && CbrEnabled)
+                gfxContext.BeginResourceTransition(*g_pSceneColorBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+            else if (SingleColorList && MsaaEnabled)
+                gfxContext.BeginResourceTransition(*g_pSceneColorBuffer, MsaaResolver == 1 ? D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE :
+                    MsaaMode > 0 ? D3D12_RESOURCE_STATE_RESOLVE_DEST : D3D12_RESOURCE_STATE_COPY_DEST);
+
             {
                 ScopedTimer _prof(L"Render Color", gfxContext);
-                ScopedPipelineQuery _colorQuery(L"ColorStats", gfxContext);
+                // A pipeline statistics query cannot span command lists, so the color pass is only measured when
+                // all of its draws are recorded here
+                std::unique_ptr<ScopedPipelineQuery> _colorQuery;
+                if (SingleColorList)
+                    _colorQuery.reset(new ScopedPipelineQuery(L"ColorStats", gfxContext));
 
                 gfxContext.TransitionResource(g_SSAOFullScreen, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
@@ -1030,7 +1841,7 @@ void ModelViewer::RenderScene(void)
                     gfxContext.SetViewportAndScissor(m_DownSizedViewport, m_DownSizedScissor);
                 }
                 // Shade the scene with color
-                RenderObjects(gfxContext, m_ViewProjMatrix, kOpaque);
+                RenderObjects(gfxContext, m_ViewProjMatrix, kOpaque, nullptr, true);
 
                 if (!ShowWaveTileCounts)	// shade cutout of scene with color
                 {
@@ -1053,7 +1864,7 @@ void ModelViewer::RenderScene(void)
                         m_CutoutModelMsaaPSO.Finalize();
                         gfxContext.SetPipelineState(m_CutoutModelMsaaPSO);
                     }
-                    RenderObjects(gfxContext, m_ViewProjMatrix, kCutout);
+                    RenderObjects(gfxContext, m_ViewProjMatrix, kCutout, nullptr, true);
                 }
 
                 // Resolve color to output frame
@@ -1173,7 +1984,12 @@ void ModelViewer::RenderScene(void)
     else
         MotionBlur::RenderObjectBlur(gfxContext, g_VelocityBuffer);
 
-    gfxContext.Finish();
+    const uint64_t frameFence = gfxContext.Finish();
+    if (m_IssuedReadback >= 0)
+    {
+        m_PyramidReadbacks[m_IssuedReadback].Fence = frameFence;
+        m_IssuedReadback = -1;
+    }
 
     m_Sequencer.FinishFrame();
 
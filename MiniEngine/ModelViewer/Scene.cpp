@@ -31,7 +31,69 @@ using namespace std::experimental;
 
 #define STRMATCH(x, y) (strcmp(x, y) == 0)
 
-bool Scene::LoadJson(const char* path) {
+static void ReadFloats(rapidjson::Value& val, float* out, uint32_t count, const char* error) {
+	if (!val.IsArray() || val.Size() != count)
+		throw SerializationException(error);
+	for (uint32_t i = 0; i < count; i++) {
+		if (!val[i].IsNumber())
+			throw SerializationException(error);
+		out[i] = (float)val[i].GetDouble();
+	}
+}
+
+void Scene::ParseNode(rapidjson::Value& node, SceneGraph::NodeId parent) {
+
+	if (!node.IsObject())
+		throw SerializationException("'Nodes' : expected array of JSON objects");
+
+	SceneGraph::Transform local = SceneGraph::Transform::Identity();
+	uint32_t modelIndex = SceneGraph::kNoModel;
+	rapidjson::Value* children = nullptr;
+
+	for (rapidjson::Value::MemberIterator it = node.MemberBegin(); it != node.MemberEnd(); it++) {
+
+		const char* name = it->name.GetString();
+		rapidjson::Value& val = it->value;
+
+		if (STRMATCH(name, "Model")) {
+			if (!val.IsUint() || val.GetUint() >= m_Models.size())
+				throw SerializationException("'Model' : expected index of a model");
+			modelIndex = val.GetUint();
+		}
+		else if (STRMATCH(name, "Translation")) {
+			ReadFloats(val, local.Translation, 3, "'Translation' : expected array of 3 floats");
+		}
+		else if (STRMATCH(name, "Rotation")) {
+			ReadFloats(val, local.Rotation, 4, "'Rotation' : expected quaternion as array of 4 floats");
+			float length = sqrtf(local.Rotation[0] * local.Rotation[0] + local.Rotation[1] * local.Rotation[1] +
+				local.Rotation[2] * local.Rotation[2] + local.Rotation[3] * local.Rotation[3]);
+			if (length < 1e-6f)
+				throw SerializationException("'Rotation' : quaternion has zero length");
+			for (int i = 0; i < 4; i++)
+				local.Rotation[i] /= length;
+		}
+		else if (STRMATCH(name, "Scale")) {
+			if (val.IsNumber())
+				local.Scale[0] = local.Scale[1] = local.Scale[2] = (float)val.GetDouble();
+			else
+				ReadFloats(val, local.Scale, 3, "'Scale' : expected float or array of 3 floats");
+		}
+		else if (STRMATCH(name, "Children")) {
+			if (!val.IsArray())
+				throw SerializationException("'Children' : expected array of JSON objects");
+			children = &val;
+		}
+	}
+
+	SceneGraph::NodeId id = m_SceneGraph.AddNode(parent, local, modelIndex);
+
+	if (children != nullptr) {
+		for (rapidjson::SizeType i = 0; i < children->Size(); i++)
+			ParseNode((*children)[i], id);
+	}
+}
+
+bool Scene::LoadJson(const char* path, bool loadGpuResources) {
 
 	std::ifstream file;
 	file.open(path, std::ios::binary);
@@ -53,6 +115,8 @@ bool Scene::LoadJson(const char* path) {
 	//std::cout << "Scene root dir: " << sceneRootDir;
 
 	filesystem::path modelPath;
+	std::vector<filesystem::path> modelPaths;
+	rapidjson::Value* nodes = nullptr;
 	filesystem::path animPath;
 	filesystem::path textureRootPath = sceneRootDir / filesystem::path("Textures");
 
@@ -81,6 +145,25 @@ bool Scene::LoadJson(const char* path) {
 					modelPath = sceneRootDir / modelPath;
 				}
 			}
+			else if (STRMATCH(name, "Models")) {
+				if (!val.IsArray())
+					throw SerializationException("'Models' : expected array of strings");
+				for (rapidjson::SizeType i = 0; i < val.Size(); i++) {
+					if (!val[i].IsString())
+						throw SerializationException("'Models' : expected array of strings");
+					filesystem::path extraPath = val[i].GetString();
+					if (extraPath.is_relative()) {
+						extraPath = sceneRootDir / extraPath;
+					}
+					modelPaths.push_back(extraPath);
+				}
+			}
+			else if (STRMATCH(name, "Nodes")) {
+				if (!val.IsArray())
+					throw SerializationException("'Nodes' : expected array of JSON objects");
+				// Parsed once the models are loaded, so that model indices can be checked
+				nodes = &val;
+			}
 			else if (STRMATCH(name, "Animation")) {
 				if (!val.IsString())
 					throw SerializationException("'Animation' : expected string");
@@ -127,18 +210,60 @@ bool Scene::LoadJson(const char* path) {
 	std::cout << "Model path: " << modelPath.generic_string() << std::endl;
 	std::cout << "Texture root: " << textureRootPath << std::endl;
 
-	TextureManager::Initialize(textureRootPath.wstring() + L"/");
+	if (loadGpuResources) {
+		TextureManager::Initialize(textureRootPath.wstring() + L"/");
+	}
+
+	modelPaths.insert(modelPaths.begin(), modelPath);
+
+	bool success = true;
+	for (size_t i = 0; i < modelPaths.size() && success; i++) {
+		if (i > 0)
+			std::cout << "Model path: " << modelPaths[i].generic_string() << std::endl;
+
+		m_Models.push_back(std::make_unique<Model>());
+		m_ModelPaths.push_back(modelPaths[i].generic_string());
+		Model& model = *m_Models.back();
+		if (loadGpuResources) {
+			success = model.Load(modelPaths[i].generic_string().c_str());
+		}
+		else {
+			success = model.LoadTables(modelPaths[i].generic_string().c_str());
+		}
+		ASSERT(success, "Failed to load model");
+		ASSERT(model.m_Header.meshCount > 0, "Model contains no meshes");
 
-	bool success = m_Model.Load(modelPath.generic_string().c_str());
-	ASSERT(success, "Failed to load model");
-	ASSERT(m_Model.m_Header.meshCount > 0, "Model contains no meshes");
+		SceneGraph::Bounds bounds;
+		XMStoreFloat3((XMFLOAT3*)bounds.Min, model.m_Header.boundingBox.min);
+		XMStoreFloat3((XMFLOAT3*)bounds.Max, model.m_Header.boundingBox.max);
+		m_SceneGraph.SetModelBounds((uint32_t)i, bounds);
+	}
+	if (!success)
+		return false;
 
-	auto box = m_Model.m_Header.boundingBox.max - m_Model.m_Header.boundingBox.min;
+	if (nodes != nullptr) {
+		try {
+			for (rapidjson::SizeType i = 0; i < nodes->Size(); i++)
+				ParseNode((*nodes)[i], SceneGraph::kInvalidNode);
+		}
+		catch (SerializationException ex) {
+			std::stringstream msg;
+			msg << "Error parsing scene: " << ex.Message;
+			Utility::Print(msg.str().c_str());
+			return false;
+		}
+	}
+	else {
+		m_SceneGraph.AddNode(SceneGraph::kInvalidNode, SceneGraph::Transform::Identity(), 0);
+	}
+
+	UpdateTransforms();
+	std::cout << "Instances: " << GetInstanceCount() << std::endl;
+
+	auto box = m_Bounds.max - m_Bounds.min;
 	std::cout << "BBox size: [" << box.GetX() << ", " << box.GetY() << ", " << box.GetZ() << "]" << std::endl;
 
-	m_ModelRadius = Length(m_Model.m_Header.boundingBox.max - m_Model.m_Header.boundingBox.min) * .5f;
-	m_Center = (m_Model.m_Header.boundingBox.min + m_Model.m_Header.boundingBox.max) * .5f;
-	const Vector3 eye = (m_Model.m_Header.boundingBox.min + m_Model.m_Header.boundingBox.max) * .5f + Vector3(m_ModelRadius * .5f, 0.0f, 0.0f);
+	const Vector3 eye = m_Center + Vector3(m_ModelRadius * .5f, 0.0f, 0.0f);
 	m_Camera.SetEyeAtUp(eye, Vector3(kZero), Vector3(kYUnitVector));
 	m_Camera.SetZRange(0.0001f * m_ModelRadius, 10.0f * m_ModelRadius);
 
@@ -170,7 +295,66 @@ void Scene::SaveAnimation() {
 	m_SceneAnimation->SaveJson(m_AnimationPath.c_str());
 }
 
+SceneGraph::NodeId Scene::AddInstance(uint32_t modelIndex, const SceneGraph::Transform& local, SceneGraph::NodeId parent) {
+	ASSERT(modelIndex < m_Models.size());
+	return m_SceneGraph.AddNode(parent, local, modelIndex);
+}
+
+void Scene::UpdateTransforms() {
+	m_SceneGraph.Update();
+
+	const SceneGraph::Bounds& bounds = m_SceneGraph.GetSceneBounds();
+	if (bounds.Min[0] > bounds.Max[0]) {
+		m_Bounds.min = Vector3(kZero);
+		m_Bounds.max = Vector3(kZero);
+	}
+	else {
+		m_Bounds.min = Vector3(*(const XMFLOAT3*)bounds.Min);
+		m_Bounds.max = Vector3(*(const XMFLOAT3*)bounds.Max);
+	}
+
+	m_ModelRadius = Length(m_Bounds.max - m_Bounds.min) * .5f;
+	m_Center = (m_Bounds.min + m_Bounds.max) * .5f;
+}
+
+Matrix4 Scene::GetInstanceMatrix(uint32_t instance) const {
+	const SceneGraph::Matrix& world = m_SceneGraph.GetWorldMatrix(m_SceneGraph.GetInstanceNode(instance));
+	return Matrix4(XMLoadFloat4x4((const XMFLOAT4X4*)world.m));
+}
+
+void Scene::GetInstanceBounds(uint32_t instance, Vector3& minBound, Vector3& maxBound) const {
+	const SceneGraph::Bounds& bounds = m_SceneGraph.GetInstanceBounds(instance);
+	minBound = Vector3(*(const XMFLOAT3*)bounds.Min);
+	maxBound = Vector3(*(const XMFLOAT3*)bounds.Max);
+}
+
+void Scene::TransformBounds(const Matrix4& world, const Model::BoundingBox& box, Vector3& minBound, Vector3& maxBound) {
+	Vector3 center = Vector3(world * ((box.min + box.max) * 0.5f));
+	Vector3 extent = (box.max - box.min) * 0.5f;
+	extent = Abs(Vector3(world.GetX())) * extent.GetX() + Abs(Vector3(world.GetY())) * extent.GetY() +
+		Abs(Vector3(world.GetZ())) * extent.GetZ();
+	minBound = center - extent;
+	maxBound = center + extent;
+}
+
+bool Scene::LoadDepthGeometry() {
+	for (size_t i = 0; i < m_Models.size(); i++) {
+		if (!m_Models[i]->LoadDepthGeometry(m_ModelPaths[i].c_str())) {
+			ReleaseDepthGeometry();
+			return false;
+		}
+	}
+	return true;
+}
+
+void Scene::ReleaseDepthGeometry() {
+	for (auto& model : m_Models)
+		model->ReleaseDepthGeometry();
+}
+
 void Scene::Cleanup() {
-	m_Model.Clear();
+	m_Models.clear();
+	m_ModelPaths.clear();
+	m_SceneGraph.Clear();
 	m_SceneAnimation = nullptr;
 }
@@ -18,10 +18,17 @@
 #include "Camera.h"
 #include "CameraController.h"
 #include "Model.h"
+#include "SceneGraph.h"
 
 #include "Art/Animation/SceneAnimation.h"
 
 // Simple scene class to encapsulate animation and asset paths
+//
+// Besides "ModelPath", a scene file may list further models under "Models" and place them with "Nodes",
+// an array of node objects.  Each node has an optional "Model" (an index into ModelPath followed by
+// Models), "Translation", "Rotation" (quaternion x, y, z, w), "Scale" (a number or three) and "Children",
+// whose transforms are relative to it.  Without "Nodes" the scene holds one instance of ModelPath at the
+// origin.
 
 class Scene {
 
@@ -29,10 +36,16 @@ public:
 
 	Scene() {};
 
-	bool LoadJson(const char* path);
+	// Without GPU resources only the mesh and material tables of the model are read, which is all the
+	// CPU side of a frame needs
+	bool LoadJson(const char* path, bool loadGpuResources = true);
 
 	void Cleanup();
 
+	// Reads the depth-only geometry of every model back into memory, e.g. to pick software occluders
+	bool LoadDepthGeometry();
+	void ReleaseDepthGeometry();
+
 	// reloads the animation file
 	bool UpdateAnimation();
 	
@@ -43,7 +56,33 @@ public:
 		return m_Name;
 	}
 
-	Model& GetModel() { return m_Model; }
+	// Model 0 comes from "ModelPath", the rest from "Models"
+	Model& GetModel(uint32_t index = 0) { return *m_Models[index]; }
+	uint32_t GetModelCount() const { return (uint32_t)m_Models.size(); }
+
+	SceneGraph& GetSceneGraph() { return m_SceneGraph; }
+
+	// Places a model; the transform is relative to the parent node
+	SceneGraph::NodeId AddInstance(uint32_t modelIndex, const SceneGraph::Transform& local,
+		SceneGraph::NodeId parent = SceneGraph::kInvalidNode);
+
+	// Brings world matrices and bounds up to date after nodes were added or moved
+	void UpdateTransforms();
+
+	uint32_t GetInstanceCount() const { return m_SceneGraph.GetInstanceCount(); }
+	uint32_t GetInstanceModel(uint32_t instance) const {
+		return m_SceneGraph.GetModelIndex(m_SceneGraph.GetInstanceNode(instance));
+	}
+	Math::Matrix4 GetInstanceMatrix(uint32_t instance) const;
+	void GetInstanceBounds(uint32_t instance, Math::Vector3& minBound, Math::Vector3& maxBound) const;
+
+	// World space bounds of every instance
+	const Model::BoundingBox& GetBoundingBox() const { return m_Bounds; }
+
+	// Box enclosing an object space box after transformation, e.g. a mesh of an instance
+	static void TransformBounds(const Math::Matrix4& world, const Model::BoundingBox& box,
+		Math::Vector3& minBound, Math::Vector3& maxBound);
+
 	ART::SceneAnimation_ptr& GetAnimation() { return m_SceneAnimation; }
 	Math::Camera& GetCamera() { return m_Camera; };
 
@@ -66,7 +105,12 @@ protected:
 	std::string					m_TextureRoot;
 	std::string					m_Root;
 
-	Model						m_Model;
+	void ParseNode(rapidjson::Value& node, SceneGraph::NodeId parent);
+
+	std::vector<std::unique_ptr<Model>>	m_Models;
+	std::vector<std::string>	m_ModelPaths;
+	SceneGraph					m_SceneGraph;
+	Model::BoundingBox			m_Bounds;
 	float						m_ModelRadius;
 	Math::Vector3				m_Center;
 	Math::Vector3				m_ShadowDim;
@@ -0,0 +1,304 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Built without the precompiled header so it has no dependency on Windows
+#include "SceneGraph.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+using namespace std;
+
+namespace
+{
+    // Nodes handed to a worker at a time.  Composing a matrix is cheap, so chunks must be large enough
+    // to cover the cost of scheduling them.
+    const uint32_t kUpdateChunkSize = 256;
+
+    void EmptyBounds( SceneGraph::Bounds& Box )
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            Box.Min[i] = FLT_MAX;
+            Box.Max[i] = -FLT_MAX;
+        }
+    }
+
+    // Runs Body(First, Last) over [0, Count) in chunks, inline when there is only one chunk
+    template <typename TBody>
+    void ForEachChunk( uint32_t Count, const TBody& Body )
+    {
+        const uint32_t NumChunks = (Count + kUpdateChunkSize - 1) / kUpdateChunkSize;
+        if (NumChunks <= 1)
+        {
+            Body(0u, Count);
+            return;
+        }
+
+        g_JobScheduler.ParallelFor(0u, NumChunks, [&]( uint32_t Chunk )
+        {
+            const uint32_t First = Chunk * kUpdateChunkSize;
+            Body(First, min(First + kUpdateChunkSize, Count));
+        });
+    }
+}
+
+SceneGraph::Transform SceneGraph::Transform::Identity( void )
+{
+    Transform Result = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f } };
+    return Result;
+}
+
+SceneGraph::SceneGraph()
+{
+    Clear();
+}
+
+void SceneGraph::Clear( void )
+{
+    m_Parent.clear();
+    m_Level.clear();
+    m_ModelIndex.clear();
+    m_InstanceIndex.clear();
+    m_Local.clear();
+    m_World.clear();
+    m_Dirty.clear();
+    m_Instances.clear();
+    m_InstanceBounds.clear();
+    m_ModelBounds.clear();
+    m_DirtyLevels.clear();
+    m_DirtyInstances.clear();
+    m_PreviousBounds.clear();
+
+    EmptyBounds(m_SceneBounds);
+    m_LastUpdateCount = 0;
+    m_AnyDirty = false;
+}
+
+SceneGraph::NodeId SceneGraph::AddNode( NodeId Parent, const Transform& Local, uint32_t ModelIndex )
+{
+    assert((Parent == kInvalidNode || Parent < GetNodeCount()) && "Parent nodes must be added before their children");
+
+    const NodeId Node = GetNodeCount();
+
+    m_Parent.push_back(Parent);
+    m_Level.push_back(Parent == kInvalidNode ? 0 : m_Level[Parent] + 1);
+    m_ModelIndex.push_back(ModelIndex);
+    m_Local.push_back(Local);
+    m_World.push_back(Matrix());
+    m_Dirty.push_back(1);
+
+    if (ModelIndex != kNoModel)
+    {
+        Bounds Box;
+        EmptyBounds(Box);
+        m_InstanceIndex.push_back((uint32_t)m_Instances.size());
+        m_Instances.push_back(Node);
+        m_InstanceBounds.push_back(Box);
+    }
+    else
+        m_InstanceIndex.push_back(kInvalidNode);
+
+    m_AnyDirty = true;
+    return Node;
+}
+
+void SceneGraph::SetLocalTransform( NodeId Node, const Transform& Local )
+{
+    m_Local[Node] = Local;
+    m_Dirty[Node] = 1;
+    m_AnyDirty = true;
+}
+
+void SceneGraph::SetModelBounds( uint32_t ModelIndex, const Bounds& ObjectBounds )
+{
+    if (ModelIndex >= m_ModelBounds.size())
+    {
+        Bounds Box;
+        EmptyBounds(Box);
+        m_ModelBounds.resize(ModelIndex + 1, Box);
+    }
+    m_ModelBounds[ModelIndex] = ObjectBounds;
+
+    // Refit every instance of the model
+    for (size_t i = 0; i < m_Instances.size(); ++i)
+    {
+        if (m_ModelIndex[m_Instances[i]] == ModelIndex)
+        {
+            m_Dirty[m_Instances[i]] = 1;
+            m_AnyDirty = true;
+        }
+    }
+}
+
+void SceneGraph::ComposeLocal( const Transform& Local, Matrix& Result )
+{
+    const float x = Local.Rotation[0], y = Local.Rotation[1], z = Local.Rotation[2], w = Local.Rotation[3];
+    const float* S = Local.Scale;
+    float* M = Result.m;
+
+    M[0] = (1.0f - 2.0f * (y * y + z * z)) * S[0];
+    M[1] = (2.0f * (x * y + w * z)) * S[0];
+    M[2] = (2.0f * (x * z - w * y)) * S[0];
+    M[3] = 0.0f;
+
+    M[4] = (2.0f * (x * y - w * z)) * S[1];
+    M[5] = (1.0f - 2.0f * (x * x + z * z)) * S[1];
+    M[6] = (2.0f * (y * z + w * x)) * S[1];
+    M[7] = 0.0f;
+
+    M[8] = (2.0f * (x * z + w * y)) * S[2];
+    M[9] = (2.0f * (y * z - w * x)) * S[2];
+    M[10] = (1.0f - 2.0f * (x * x + y * y)) * S[2];
+    M[11] = 0.0f;
+
+    M[12] = Local.Translation[0];
+    M[13] = Local.Translation[1];
+    M[14] = Local.Translation[2];
+    M[15] = 1.0f;
+}
+
+void SceneGraph::Multiply( const Matrix& Parent, const Matrix& Local, Matrix& Result )
+{
+    const float* P = Parent.m;
+    const float* L = Local.m;
+
+    // Each basis vector of Local, expressed in the parent's space
+    for (int Row = 0; Row < 4; ++Row)
+    {
+        const float* V = L + Row * 4;
+        for (int i = 0; i < 4; ++i)
+            Result.m[Row * 4 + i] = V[0] * P[i] + V[1] * P[4 + i] + V[2] * P[8 + i] + V[3] * P[12 + i];
+    }
+}
+
+void SceneGraph::TransformBounds( const Matrix& World, const Bounds& ObjectBounds, Bounds& Result )
+{
+    if (ObjectBounds.Min[0] > ObjectBounds.Max[0])
+    {
+        EmptyBounds(Result);
+        return;
+    }
+
+    const float* M = World.m;
+
+    float Center[3], Extent[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        Center[i] = (ObjectBounds.Min[i] + ObjectBounds.Max[i]) * 0.5f;
+        Extent[i] = (ObjectBounds.Max[i] - ObjectBounds.Min[i]) * 0.5f;
+    }
+
+    for (int i = 0; i < 3; ++i)
+    {
+        float WorldCenter = Center[0] * M[i] + Center[1] * M[4 + i] + Center[2] * M[8 + i] + M[12 + i];
+        float WorldExtent = Extent[0] * fabsf(M[i]) + Extent[1] * fabsf(M[4 + i]) + Extent[2] * fabsf(M[8 + i]);
+        Result.Min[i] = WorldCenter - WorldExtent;
+        Result.Max[i] = WorldCenter + WorldExtent;
+    }
+}
+
+void SceneGraph::Update( void )
+{
+    m_LastUpdateCount = 0;
+    m_DirtyInstances.clear();
+    m_PreviousBounds.clear();
+    if (!m_AnyDirty)
+        return;
+
+    for (size_t i = 0; i < m_DirtyLevels.size(); ++i)
+        m_DirtyLevels[i].clear();
+
+    // Parents precede their children, so a single pass reaches every descendant of a dirty node.  The
+    // dirty nodes are bucketed by level so that each level only reads matrices the previous one wrote.
+    const uint32_t NodeCount = GetNodeCount();
+    for (NodeId Node = 0; Node < NodeCount; ++Node)
+    {
+        const NodeId Parent = m_Parent[Node];
+        if (Parent != kInvalidNode && m_Dirty[Parent])
+            m_Dirty[Node] = 1;
+
+        if (!m_Dirty[Node])
+            continue;
+
+        const uint32_t Level = m_Level[Node];
+        if (Level >= m_DirtyLevels.size())
+            m_DirtyLevels.resize(Level + 1);
+        m_DirtyLevels[Level].push_back(Node);
+
+        if (m_InstanceIndex[Node] != kInvalidNode)
+        {
+            m_DirtyInstances.push_back(m_InstanceIndex[Node]);
+            m_PreviousBounds.push_back(m_InstanceBounds[m_InstanceIndex[Node]]);
+        }
+    }
+
+    for (size_t Level = 0; Level < m_DirtyLevels.size(); ++Level)
+    {
+        const vector<NodeId>& Nodes = m_DirtyLevels[Level];
+        m_LastUpdateCount += (uint32_t)Nodes.size();
+
+        ForEachChunk((uint32_t)Nodes.size(), [&]( uint32_t First, uint32_t Last )
+        {
+            for (uint32_t i = First; i < Last; ++i)
+            {
+                const NodeId Node = Nodes[i];
+                const NodeId Parent = m_Parent[Node];
+
+                if (Parent == kInvalidNode)
+                    ComposeLocal(m_Local[Node], m_World[Node]);
+                else
+                {
+                    Matrix Local;
+                    ComposeLocal(m_Local[Node], Local);
+                    Multiply(m_World[Parent], Local, m_World[Node]);
+                }
+            }
+        });
+    }
+
+    ForEachChunk((uint32_t)m_DirtyInstances.size(), [&]( uint32_t First, uint32_t Last )
+    {
+        for (uint32_t i = First; i < Last; ++i)
+        {
+            const uint32_t Instance = m_DirtyInstances[i];
+            const NodeId Node = m_Instances[Instance];
+            const uint32_t ModelIndex = m_ModelIndex[Node];
+
+            if (ModelIndex < m_ModelBounds.size())
+                TransformBounds(m_World[Node], m_ModelBounds[ModelIndex], m_InstanceBounds[Instance]);
+            else
+                EmptyBounds(m_InstanceBounds[Instance]);
+        }
+    });
+
+    if (!m_DirtyInstances.empty())
+    {
+        EmptyBounds(m_SceneBounds);
+        for (size_t i = 0; i < m_InstanceBounds.size(); ++i)
+        {
+            const Bounds& Box = m_InstanceBounds[i];
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                m_SceneBounds.Min[Axis] = min(m_SceneBounds.Min[Axis], Box.Min[Axis]);
+                m_SceneBounds.Max[Axis] = max(m_SceneBounds.Max[Axis], Box.Max[Axis]);
+            }
+        }
+    }
+
+    for (size_t Level = 0; Level < m_DirtyLevels.size(); ++Level)
+    {
+        const vector<NodeId>& Nodes = m_DirtyLevels[Level];
+        for (size_t i = 0; i < Nodes.size(); ++i)
+            m_Dirty[Nodes[i]] = 0;
+    }
+    m_AnyDirty = false;
+}
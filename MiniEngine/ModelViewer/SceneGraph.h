@@ -0,0 +1,125 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Transform hierarchy for placing model instances.  Nodes are stored structure-of-arrays
+// (parents, local transforms, world matrices, world bounds and dirty flags each live in their own array),
+// and every node is stored after its parent, so one forward pass pushes dirty flags down the hierarchy.
+// World matrices are then rebuilt one hierarchy level at a time, and the world bounds of dirty instances
+// are refit, with the nodes of each level spread over worker threads.  Only plain floats are involved,
+// so the graph works without a device.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class SceneGraph
+{
+public:
+
+    typedef uint32_t NodeId;
+
+    enum : uint32_t { kInvalidNode = 0xFFFFFFFF, kNoModel = 0xFFFFFFFF };
+
+    struct Transform
+    {
+        float Translation[3];
+        float Rotation[4];      // Unit quaternion (x, y, z, w)
+        float Scale[3];
+
+        static Transform Identity( void );
+    };
+
+    // Four basis vectors (X, Y, Z, translation) of four floats each, the layout of Math::Matrix4
+    struct Matrix
+    {
+        float m[16];
+    };
+
+    struct Bounds
+    {
+        float Min[3];
+        float Max[3];
+    };
+
+    SceneGraph();
+
+    void Clear( void );
+
+    // The parent must already exist, which keeps every node after its parent.  Nodes without a model only
+    // group their children.
+    NodeId AddNode( NodeId Parent, const Transform& Local, uint32_t ModelIndex = kNoModel );
+
+    void SetLocalTransform( NodeId Node, const Transform& Local );
+    const Transform& GetLocalTransform( NodeId Node ) const { return m_Local[Node]; }
+
+    // Object space bounds shared by every instance of a model
+    void SetModelBounds( uint32_t ModelIndex, const Bounds& ObjectBounds );
+
+    // Recomputes the world matrix of every node that changed since the last update, or whose ancestor did,
+    // and the world bounds of the instances among them.
+    void Update( void );
+
+    uint32_t GetNodeCount( void ) const { return (uint32_t)m_Parent.size(); }
+    NodeId GetParent( NodeId Node ) const { return m_Parent[Node]; }
+    uint32_t GetModelIndex( NodeId Node ) const { return m_ModelIndex[Node]; }
+    const Matrix& GetWorldMatrix( NodeId Node ) const { return m_World[Node]; }
+
+    // Nodes that place a model, in the order they were added
+    uint32_t GetInstanceCount( void ) const { return (uint32_t)m_Instances.size(); }
+    NodeId GetInstanceNode( uint32_t Instance ) const { return m_Instances[Instance]; }
+    const Bounds& GetInstanceBounds( uint32_t Instance ) const { return m_InstanceBounds[Instance]; }
+
+    // Union of all instance bounds.  Empty (min > max) when there are no instances.
+    const Bounds& GetSceneBounds( void ) const { return m_SceneBounds; }
+
+    // Nodes whose world matrix the last update recomputed
+    uint32_t GetLastUpdateCount( void ) const { return m_LastUpdateCount; }
+
+    // Instances whose bounds the last update refit, with the bounds they had before it.  Both are empty
+    // (min > max) for an instance's first update.
+    uint32_t GetMovedInstanceCount( void ) const { return (uint32_t)m_DirtyInstances.size(); }
+    uint32_t GetMovedInstance( uint32_t i ) const { return m_DirtyInstances[i]; }
+    const Bounds& GetPreviousBounds( uint32_t i ) const { return m_PreviousBounds[i]; }
+
+    static void ComposeLocal( const Transform& Local, Matrix& Result );
+
+    // Result = Parent * Local, so that Local is applied first
+    static void Multiply( const Matrix& Parent, const Matrix& Local, Matrix& Result );
+
+    // Box enclosing the transformed box, fit around its center and extents
+    static void TransformBounds( const Matrix& World, const Bounds& ObjectBounds, Bounds& Result );
+
+private:
+
+    // Per node
+    std::vector<NodeId> m_Parent;
+    std::vector<uint32_t> m_Level;
+    std::vector<uint32_t> m_ModelIndex;
+    std::vector<uint32_t> m_InstanceIndex;
+    std::vector<Transform> m_Local;
+    std::vector<Matrix> m_World;
+    std::vector<uint8_t> m_Dirty;
+
+    // Per instance
+    std::vector<NodeId> m_Instances;
+    std::vector<Bounds> m_InstanceBounds;
+
+    // Per model
+    std::vector<Bounds> m_ModelBounds;
+
+    // Scratch for Update(), kept to avoid reallocating every frame
+    std::vector<std::vector<NodeId>> m_DirtyLevels;
+    std::vector<uint32_t> m_DirtyInstances;
+    std::vector<Bounds> m_PreviousBounds;
+
+    Bounds m_SceneBounds;
+    uint32_t m_LastUpdateCount;
+    bool m_AnyDirty;
+};
@@ -0,0 +1,31 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Builds one level of the hierarchical-Z pyramid from the level above it.  Each texel takes the farthest
+// of its 2 x 2 parent texels; once an axis has shrunk to one texel, the parent row or column is repeated.
+//
+
+#include "DepthPyramidRS.hlsli"
+
+RWTexture2D<float> DstLevel : register(u0);
+RWTexture2D<float> SrcLevel : register(u1);
+
+[RootSignature(DepthPyramid_RootSig)]
+[numthreads(8, 8, 1)]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    if (any(DTid.xy >= DstSize))
+        return;
+
+    uint2 First = DTid.xy * 2;
+    uint2 Last = min(First + 1, SrcSize - 1);
+
+    DstLevel[DTid.xy] = max(
+        max(SrcLevel[First], SrcLevel[uint2(Last.x, First.y)]),
+        max(SrcLevel[uint2(First.x, Last.y)], SrcLevel[Last]));
+}
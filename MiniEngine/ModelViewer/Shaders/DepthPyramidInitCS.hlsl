@@ -0,0 +1,38 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Builds level 0 of the hierarchical-Z pyramid from the linear depth of the last frame.  The scene covers
+// the top left SrcSize texels of the depth buffer, and level 0 is the next power of two down, so each
+// texel takes the farthest depth of the few source texels it overlaps.  DepthPyramid::Build is the CPU
+// version of this shader.
+//
+
+#include "DepthPyramidRS.hlsli"
+
+Texture2D<float> LinearDepth : register(t0);
+RWTexture2D<float> DstLevel : register(u0);
+
+[RootSignature(DepthPyramid_RootSig)]
+[numthreads(8, 8, 1)]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    if (any(DTid.xy >= DstSize))
+        return;
+
+    uint2 First = DTid.xy * SrcSize / DstSize;
+    uint2 Last = ((DTid.xy + 1) * SrcSize - 1) / DstSize;
+
+    float MaxDepth = 0.0;
+    for (uint y = First.y; y <= Last.y; ++y)
+    {
+        for (uint x = First.x; x <= Last.x; ++x)
+            MaxDepth = max(MaxDepth, LinearDepth[uint2(x, y)]);
+    }
+
+    DstLevel[DTid.xy] = MaxDepth;
+}
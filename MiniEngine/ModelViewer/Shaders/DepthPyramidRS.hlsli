@@ -0,0 +1,24 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Shared by the passes that build the hierarchical-Z pyramid.  The first pass reads the linear depth
+// through t0; the others read the previous level through u1.  Both write the level they build to u0.
+//
+
+#define DepthPyramid_RootSig \
+    "RootFlags(0), " \
+    "RootConstants(b0, num32BitConstants = 4), " \
+    "DescriptorTable(SRV(t0, numDescriptors = 1))," \
+    "DescriptorTable(UAV(u0, numDescriptors = 1))," \
+    "DescriptorTable(UAV(u1, numDescriptors = 1))"
+
+cbuffer CB0 : register(b0)
+{
+    uint2 SrcSize;      // Texels of the source that are read
+    uint2 DstSize;
+};
@@ -0,0 +1,182 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Culls the draw records of IndirectDrawTable against the view frustum of one pass and compacts the
+// survivors into the command buffer consumed by ExecuteIndirect.  Each bucket's draws are appended to
+// the bucket's range of the command buffer, and its count is the bucket's word in the count buffer.
+// IndirectDrawTable::Cull is the CPU version of this shader.
+//
+// Main view passes also cull against the hierarchical-Z pyramid of the last frame's depth.  The bounds
+// are projected with the last frame's view projection, so they land where the depth was rendered, and
+// DepthPyramid::IsOccluded is the CPU version of that test.
+//
+
+#define IndirectCull_RootSig \
+    "RootFlags(0), " \
+    "CBV(b0), " \
+    "SRV(t0), " \
+    "DescriptorTable(SRV(t1, numDescriptors = 2))," \
+    "DescriptorTable(UAV(u0, numDescriptors = 2))," \
+    "SRV(t3)"
+
+// must keep in sync with the vertex shader constants written by ModelViewer
+struct InstanceConstants
+{
+    float4x4 ModelToProjection;
+    float4x4 ModelToShadow;
+    float4x4 ModelToWorld;
+    float4 ViewerPos;
+    float4 Padding[3];
+};
+
+// must keep in sync with IndirectDrawTable::DrawRecord
+struct DrawRecord
+{
+    float3 BoundsMin;
+    uint InstanceIndex;
+    float3 BoundsMax;
+    uint BucketIndex;
+    uint FirstCommand;
+    uint Flags;
+    uint IndexCount;
+    uint StartIndex;
+    int BaseVertex;
+    uint MaterialIndex;
+    uint2 Padding;
+};
+
+// Size of IndirectDrawTable::DrawCommand
+#define DRAW_COMMAND_STRIDE 40
+
+cbuffer CSConstants : register(b0)
+{
+    uint RecordCount;
+    uint FilterFlags;
+    uint2 ConstantsAddress;     // Of instance 0's constants, low word first
+    uint ConstantsStride;
+    uint OcclusionEnable;
+    float InvFarClip;           // Of the frame the pyramid was built from
+    float DepthBias;
+    uint2 PyramidSize;          // Of level 0
+    uint PyramidLevels;
+};
+
+StructuredBuffer<InstanceConstants> Instances : register(t0);
+StructuredBuffer<DrawRecord> Records : register(t1);
+Texture2D<float> DepthPyramid : register(t2);
+StructuredBuffer<float4x4> ModelToPrevProjection : register(t3);   // Per instance
+RWByteAddressBuffer Commands : register(u0);
+RWByteAddressBuffer Counts : register(u1);
+
+// Row r of the matrix maps an object space point to clip coordinate r.  The box is culled when its
+// corner farthest along the normal of one of the six clip planes lies outside that plane.
+bool IntersectFrustum( float4x4 M, float3 BoundsMin, float3 BoundsMax )
+{
+    float4 Planes[6] =
+    {
+        M[3] + M[0],
+        M[3] - M[0],
+        M[3] + M[1],
+        M[3] - M[1],
+        M[2],
+        M[3] - M[2]
+    };
+
+    [unroll]
+    for (uint i = 0; i < 6; ++i)
+    {
+        float3 FarCorner = Planes[i].xyz > 0.0 ? BoundsMax : BoundsMin;
+        if (dot(Planes[i].xyz, FarCorner) + Planes[i].w < 0.0)
+            return false;
+    }
+
+    return true;
+}
+
+// Projects the box into the last frame and compares its nearest depth with the farthest depth of the
+// pyramid texels under it, at the level where its rectangle, grown by a texel, spans at most 2 x 2 texels
+bool IsOccluded( float4x4 M, float3 BoundsMin, float3 BoundsMax )
+{
+    float2 MinUV = 1e30;
+    float2 MaxUV = -1e30;
+    float MinW = 1e30;
+
+    [unroll]
+    for (uint Corner = 0; Corner < 8; ++Corner)
+    {
+        float3 P = float3(
+            Corner & 1 ? BoundsMax.x : BoundsMin.x,
+            Corner & 2 ? BoundsMax.y : BoundsMin.y,
+            Corner & 4 ? BoundsMax.z : BoundsMin.z);
+
+        float4 Clip = mul(M, float4(P, 1.0));
+        if (Clip.w <= 0.0)
+            return false;
+
+        float2 UV = float2(0.5, -0.5) * Clip.xy / Clip.w + 0.5;
+        MinUV = min(MinUV, UV);
+        MaxUV = max(MaxUV, UV);
+        MinW = min(MinW, Clip.w);
+    }
+
+    // Off screen boxes are left to frustum culling
+    if (any(MaxUV < 0.0) || any(MinUV > 1.0))
+        return false;
+
+    float2 BaseSize = float2(PyramidSize);
+    MinUV = saturate(MinUV - 1.0 / BaseSize);
+    MaxUV = saturate(MaxUV + 1.0 / BaseSize);
+
+    float2 Extent = (MaxUV - MinUV) * BaseSize;
+    uint Level = 0;
+    while (Level + 1 < PyramidLevels && (float)(1u << Level) < max(Extent.x, Extent.y))
+        ++Level;
+
+    uint2 LevelSize = max(PyramidSize >> Level, 1);
+    uint2 First = min(uint2(MinUV * LevelSize), LevelSize - 1);
+    uint2 Last = min(uint2(MaxUV * LevelSize), LevelSize - 1);
+
+    float MaxDepth = max(
+        max(DepthPyramid.Load(int3(First, Level)), DepthPyramid.Load(int3(Last.x, First.y, Level))),
+        max(DepthPyramid.Load(int3(First.x, Last.y, Level)), DepthPyramid.Load(int3(Last, Level))));
+
+    return MinW * InvFarClip > MaxDepth + DepthBias;
+}
+
+[RootSignature(IndirectCull_RootSig)]
+[numthreads(64, 1, 1)]
+void main( uint3 DTid : SV_DispatchThreadID )
+{
+    if (DTid.x >= RecordCount)
+        return;
+
+    DrawRecord Record = Records[DTid.x];
+
+    if ((Record.Flags & FilterFlags) == 0)
+        return;
+
+    if (!IntersectFrustum(Instances[Record.InstanceIndex].ModelToProjection, Record.BoundsMin, Record.BoundsMax))
+        return;
+
+    if (OcclusionEnable != 0 &&
+        IsOccluded(ModelToPrevProjection[Record.InstanceIndex], Record.BoundsMin, Record.BoundsMax))
+        return;
+
+    uint Slot;
+    Counts.InterlockedAdd(Record.BucketIndex * 4, 1, Slot);
+
+    // 64-bit addition of the instance's offset to the constants address
+    uint Offset = Record.InstanceIndex * ConstantsStride;
+    uint AddressLow = ConstantsAddress.x + Offset;
+    uint AddressHigh = ConstantsAddress.y + (AddressLow < Offset ? 1 : 0);
+
+    uint CommandOffset = (Record.FirstCommand + Slot) * DRAW_COMMAND_STRIDE;
+    Commands.Store4(CommandOffset, uint4(AddressLow, AddressHigh, asuint(Record.BaseVertex), Record.MaterialIndex));
+    Commands.Store4(CommandOffset + 16, uint4(Record.IndexCount, 1, Record.StartIndex, asuint(Record.BaseVertex)));
+    Commands.Store2(CommandOffset + 32, uint2(0, 0));
+}
@@ -41,3 +41,12 @@ uint GetTileOffset(uint tileIndex)
 {
     return tileIndex * TILE_SIZE;
 }
+
+// Clusters are ordered by x, then y, then depth slice, with slices spaced exponentially in view depth.
+// See LightClusterBuilder.
+uint GetClusterIndex(float2 pos, float viewDepth, float4 clusterScale, uint3 clusterCount)
+{
+    uint2 tilePos = min(uint2(pos * clusterScale.xy), clusterCount.xy - 1);
+    uint slice = (uint)clamp(floor(log2(viewDepth) * clusterScale.z + clusterScale.w), 0.0, clusterCount.z - 1.0);
+    return (slice * clusterCount.y + tilePos.y) * clusterCount.x + tilePos.x;
+}
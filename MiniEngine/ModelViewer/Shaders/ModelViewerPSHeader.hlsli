@@ -92,6 +92,8 @@ StructuredBuffer<LightData> lightBuffer : register(t66);
 Texture2DArray<float> lightShadowArrayTex : register(t67);
 ByteAddressBuffer lightGrid : register(t68);
 ByteAddressBuffer lightGridBitMask : register(t69);
+ByteAddressBuffer clusterGrid : register(t70);
+ByteAddressBuffer clusterLightIndices : register(t71);
 
 cbuffer PSConstants : register(b0)
 {
@@ -105,6 +107,11 @@ cbuffer PSConstants : register(b0)
 	float3 DownSizedFactors;	// the factors to compensate resolution upsampling
 								// in color shading PS, if we downsample the viewport by x, the screenPosition must be compensated for fetching full screen like SSAO and lightCull indices
 								// the third parameter is the frame offset for odd or even pixel look up in the ssao and light grids
+	float4 ClusterScale;		// xy: clusters per pixel, zw: depth slice scale and bias applied to log2(depth)
+	uint4 ClusterCount;			// xyz: cluster grid dimensions, w: non-zero when clustered lighting is enabled
+	float4x4 CascadeShadowMatrix[4];	// World to shadow texture space, already mapped to each cascade's quadrant
+	float4 CascadeSplits;		// Far view depth of each cascade
+	uint4 CascadeCount;			// x: number of cascades, 0 when the single shadow map is used
 }
 
 SamplerState sampler0 : register(s0);
@@ -164,6 +171,18 @@ float GetShadow(float3 ShadowCoord)
 	return result * result;
 }
 
+// Picks the first cascade that reaches the pixel's view depth.  Pixels beyond the last cascade get a depth
+// that passes every comparison, so they are lit.
+float3 GetCascadeShadowCoord(float3 worldPos, float viewDepth)
+{
+	uint cascade = 0;
+	for (uint i = 0; i < CascadeCount.x - 1; ++i)
+		cascade += viewDepth > CascadeSplits[i] ? 1 : 0;
+
+	float3 shadowCoord = mul(CascadeShadowMatrix[cascade], float4(worldPos, 1.0)).xyz;
+	return viewDepth > CascadeSplits[CascadeCount.x - 1] ? float3(shadowCoord.xy, 1.0) : shadowCoord;
+}
+
 float GetShadowConeLight(uint lightIndex, float3 shadowCoord)
 {
 	float result = lightShadowArrayTex.SampleCmpLevelZero(
@@ -440,6 +459,8 @@ float3 main(VSOutput vsOutput) : SV_Target0
 	float3 viewDir = normalize(vsOutput.viewDir);
 
 	float3 shadowCoord = vsOutput.shadowCoord;
+	if (CascadeCount.x > 0)
+		shadowCoord = GetCascadeShadowCoord(vsOutput.worldPos, vsOutput.position.w);
 	colorSum += ApplyDirectionalLight(diffuseAlbedo, specularAlbedo, specularMask, gloss, normal, viewDir, SunDirection, SunColor, shadowCoord);
 
 #ifdef ENABLE_LIGHT_GRID
@@ -485,6 +506,43 @@ float3 main(VSOutput vsOutput) : SV_Target0
     lightData.shadowTextureMatrix, \
     lightIndex
 
+	// Clustered light assignment (tile x depth slice), built on the CPU
+	if (ClusterCount.w != 0)
+	{
+		uint clusterIndex = GetClusterIndex(pixelPos, vsOutput.position.w, ClusterScale, ClusterCount.xyz);
+		uint2 cluster = clusterGrid.Load2(clusterIndex * 8);
+		uint clusterLoadOffset = cluster.x * 4;
+		uint clusterLightCountSphere = (cluster.y >> 0) & 0x3ff;
+		uint clusterLightCountCone = (cluster.y >> 10) & 0x3ff;
+		uint clusterLightCountConeShadowed = (cluster.y >> 20) & 0x3ff;
+
+		// sphere
+		for (uint n = 0; n < clusterLightCountSphere; n++, clusterLoadOffset += 4)
+		{
+			uint lightIndex = clusterLightIndices.Load(clusterLoadOffset);
+			LightData lightData = lightBuffer[lightIndex];
+			colorSum += ApplyPointLight(POINT_LIGHT_ARGS);
+		}
+
+		// cone
+		for (uint n = 0; n < clusterLightCountCone; n++, clusterLoadOffset += 4)
+		{
+			uint lightIndex = clusterLightIndices.Load(clusterLoadOffset);
+			LightData lightData = lightBuffer[lightIndex];
+			colorSum += ApplyConeLight(CONE_LIGHT_ARGS);
+		}
+
+		// cone w/ shadow map
+		for (uint n = 0; n < clusterLightCountConeShadowed; n++, clusterLoadOffset += 4)
+		{
+			uint lightIndex = clusterLightIndices.Load(clusterLoadOffset);
+			LightData lightData = lightBuffer[lightIndex];
+			colorSum += ApplyConeShadowedLight(SHADOWED_LIGHT_ARGS);
+		}
+
+		return colorSum;
+	}
+
 #if defined(BIT_MASK)
 	uint64_t threadMask = Ballot64(tileIndex != ~0); // attempt to get starting exec mask
 
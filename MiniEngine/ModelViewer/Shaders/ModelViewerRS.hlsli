@@ -17,7 +17,7 @@
     "CBV(b0, visibility = SHADER_VISIBILITY_PIXEL), " \
     "CBV(b1, visibility = SHADER_VISIBILITY_PIXEL), " \
     "DescriptorTable(SRV(t0, numDescriptors = 8), visibility = SHADER_VISIBILITY_PIXEL)," \
-    "DescriptorTable(SRV(t64, numDescriptors = 6), visibility = SHADER_VISIBILITY_PIXEL)," \
+    "DescriptorTable(SRV(t64, numDescriptors = 8), visibility = SHADER_VISIBILITY_PIXEL)," \
     "RootConstants(b1, num32BitConstants = 2, visibility = SHADER_VISIBILITY_VERTEX), " \
     "StaticSampler(s0, maxAnisotropy = 8, visibility = SHADER_VISIBILITY_PIXEL)," \
     "StaticSampler(s1, visibility = SHADER_VISIBILITY_PIXEL," \
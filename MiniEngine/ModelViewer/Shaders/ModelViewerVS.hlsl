@@ -18,6 +18,7 @@ cbuffer VSConstants : register(b0)
 {
     float4x4 modelToProjection;
     float4x4 modelToShadow;
+    float4x4 modelToWorld;
     float3 ViewerPos;
 };
 
@@ -47,15 +48,25 @@ VSOutput main(VSInput vsInput)
 {
     VSOutput vsOutput;
 
+    float3 worldPos = mul(modelToWorld, float4(vsInput.position, 1.0)).xyz;
+
     vsOutput.position = mul(modelToProjection, float4(vsInput.position, 1.0));
-    vsOutput.worldPos = vsInput.position;
+    vsOutput.worldPos = worldPos;
     vsOutput.texCoord = vsInput.texcoord0;
-    vsOutput.viewDir = vsInput.position - ViewerPos;
+    vsOutput.viewDir = worldPos - ViewerPos;
     vsOutput.shadowCoord = mul(modelToShadow, float4(vsInput.position, 1.0)).xyz;
 
-    vsOutput.normal = vsInput.normal;
-    vsOutput.tangent = vsInput.tangent;
-    vsOutput.bitangent = vsInput.bitangent;
+    // Normals take the cofactor matrix so that non-uniform scale keeps them perpendicular to the surface.
+    // The pixel shader renormalizes all three vectors.
+    float3x3 basis = (float3x3)modelToWorld;
+    float3 axisX = float3(basis._11, basis._21, basis._31);
+    float3 axisY = float3(basis._12, basis._22, basis._32);
+    float3 axisZ = float3(basis._13, basis._23, basis._33);
+    float3x3 cofactor = float3x3(cross(axisY, axisZ), cross(axisZ, axisX), cross(axisX, axisY));
+
+    vsOutput.normal = mul(vsInput.normal, cofactor);
+    vsOutput.tangent = mul(basis, vsInput.tangent);
+    vsOutput.bitangent = mul(basis, vsInput.bitangent);
 
     return vsOutput;
 }
@@ -0,0 +1,650 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+
+// Built without the precompiled header so it has no dependency on Windows
+#include "SoftwareOcclusion.h"
+#include "Math/FloatWide.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+using namespace Math;
+using namespace std;
+
+namespace
+{
+    // Occluders smaller than an 8 x 8 block of pixels hide too little to be worth drawing
+    const float kMinOccluderArea = 64.0f;
+
+    // Keeps a mesh from culling itself when its bounding box touches its own surface and rounding puts the
+    // rasterized depth a hair nearer
+    const float kDepthTolerance = 1.0f / 1024.0f;
+
+    // Below this, in square pixels, a triangle covers at most a pixel center along a line
+    const float kMinTriangleArea = 1.0f / 256.0f;
+
+    const float kLaneOffsets[8] = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f };
+
+    float LargestFace( const float* BoundsMin, const float* BoundsMax )
+    {
+        const float x = BoundsMax[0] - BoundsMin[0];
+        const float y = BoundsMax[1] - BoundsMin[1];
+        const float z = BoundsMax[2] - BoundsMin[2];
+        return max(max(x * y, x * z), y * z);
+    }
+
+    // Matrices in Math::Matrix4 layout, where element (r, c) is M[c * 4 + r]
+    void MultiplyMatrices( const float* A, const float* B, float* Result )
+    {
+        for (int c = 0; c < 4; ++c)
+            for (int r = 0; r < 4; ++r)
+                Result[c * 4 + r] = A[r] * B[c * 4] + A[4 + r] * B[c * 4 + 1] + A[8 + r] * B[c * 4 + 2] + A[12 + r] * B[c * 4 + 3];
+    }
+}
+
+SoftwareOcclusion::SoftwareOcclusion() : m_TriangleBudget(32768), m_DrawCount(0)
+{
+    memset(m_ViewProjection, 0, sizeof(m_ViewProjection));
+    memset(m_TileMinDepth, 0, sizeof(m_TileMinDepth));
+    memset(&m_Stats, 0, sizeof(m_Stats));
+    m_Depth.resize(kWidth * kHeight, 0.0f);
+}
+
+uint32_t SoftwareOcclusion::AddModel( uint32_t ModelIndex, const MeshDesc* Meshes, uint32_t MeshCount,
+    float MinRelativeSize, uint32_t MaxMeshTriangles )
+{
+    if (ModelIndex >= m_ModelOccluders.size())
+    {
+        ModelOccluders None = { 0, 0 };
+        m_ModelOccluders.resize(ModelIndex + 1, None);
+    }
+    assert(m_ModelOccluders[ModelIndex].Count == 0 && "Model added twice");
+
+    float ModelMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float ModelMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (uint32_t i = 0; i < MeshCount; ++i)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            ModelMin[k] = min(ModelMin[k], Meshes[i].BoundsMin[k]);
+            ModelMax[k] = max(ModelMax[k], Meshes[i].BoundsMax[k]);
+        }
+    }
+    const float MinSize = MeshCount > 0 ? MinRelativeSize * LargestFace(ModelMin, ModelMax) : 0.0f;
+
+    ModelOccluders& Range = m_ModelOccluders[ModelIndex];
+    Range.First = (uint32_t)m_Occluders.size();
+
+    for (uint32_t i = 0; i < MeshCount; ++i)
+    {
+        const MeshDesc& Mesh = Meshes[i];
+        const uint32_t TriangleCount = Mesh.IndexCount / 3;
+        if (TriangleCount == 0 || TriangleCount > MaxMeshTriangles || LargestFace(Mesh.BoundsMin, Mesh.BoundsMax) < MinSize)
+            continue;
+
+        Occluder NewOccluder;
+        NewOccluder.FirstVertex = (uint32_t)m_X.size();
+        NewOccluder.VertexCount = Mesh.VertexCount;
+        NewOccluder.FirstIndex = (uint32_t)m_Indices.size();
+        NewOccluder.TriangleCount = TriangleCount;
+        for (int k = 0; k < 3; ++k)
+        {
+            NewOccluder.BoundsMin[k] = Mesh.BoundsMin[k];
+            NewOccluder.BoundsMax[k] = Mesh.BoundsMax[k];
+        }
+
+        // Pad so that whole registers can be loaded past the last vertex
+        const uint32_t PaddedCount = (Mesh.VertexCount + kVertexAlignment - 1) / kVertexAlignment * kVertexAlignment;
+        m_X.resize(NewOccluder.FirstVertex + PaddedCount, 0.0f);
+        m_Y.resize(NewOccluder.FirstVertex + PaddedCount, 0.0f);
+        m_Z.resize(NewOccluder.FirstVertex + PaddedCount, 0.0f);
+
+        for (uint32_t v = 0; v < Mesh.VertexCount; ++v)
+        {
+            const float* Position = (const float*)((const char*)Mesh.Positions + (size_t)v * Mesh.VertexStride);
+            m_X[NewOccluder.FirstVertex + v] = Position[0];
+            m_Y[NewOccluder.FirstVertex + v] = Position[1];
+            m_Z[NewOccluder.FirstVertex + v] = Position[2];
+        }
+
+        for (uint32_t j = 0; j < TriangleCount * 3; ++j)
+            assert(Mesh.Indices[j] < Mesh.VertexCount);
+        m_Indices.insert(m_Indices.end(), Mesh.Indices, Mesh.Indices + TriangleCount * 3);
+
+        m_Occluders.push_back(NewOccluder);
+    }
+
+    Range.Count = (uint32_t)m_Occluders.size() - Range.First;
+    return Range.Count;
+}
+
+void SoftwareOcclusion::Clear( void )
+{
+    m_Occluders.clear();
+    m_ModelOccluders.clear();
+    m_X.clear();
+    m_Y.clear();
+    m_Z.clear();
+    m_Indices.clear();
+    m_Transforms.clear();
+    m_Candidates.clear();
+    m_DrawCount = 0;
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+void SoftwareOcclusion::Begin( const float* ViewProjection )
+{
+    memcpy(m_ViewProjection, ViewProjection, sizeof(m_ViewProjection));
+    m_Transforms.clear();
+    m_Candidates.clear();
+    m_DrawCount = 0;
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+bool SoftwareOcclusion::GetScreenArea( const float* M, const float* BoundsMin, const float* BoundsMax, float& Area )
+{
+    float MinX = FLT_MAX, MaxX = -FLT_MAX;
+    float MinY = FLT_MAX, MaxY = -FLT_MAX;
+    uint32_t OutsideAll = 0x1F;
+    bool BehindEye = false;
+
+    for (uint32_t Corner = 0; Corner < 8; ++Corner)
+    {
+        const float P[3] =
+        {
+            Corner & 1 ? BoundsMax[0] : BoundsMin[0],
+            Corner & 2 ? BoundsMax[1] : BoundsMin[1],
+            Corner & 4 ? BoundsMax[2] : BoundsMin[2]
+        };
+
+        float Clip[4];
+        for (int r = 0; r < 4; ++r)
+            Clip[r] = M[r] * P[0] + M[4 + r] * P[1] + M[8 + r] * P[2] + M[12 + r];
+
+        // The box is off screen when all of its corners are outside the same side
+        uint32_t Outside = 0;
+        if (Clip[0] < -Clip[3]) Outside |= 0x1;
+        if (Clip[0] > Clip[3]) Outside |= 0x2;
+        if (Clip[1] < -Clip[3]) Outside |= 0x4;
+        if (Clip[1] > Clip[3]) Outside |= 0x8;
+        if (Clip[3] <= 0.0f) Outside |= 0x10;
+        OutsideAll &= Outside;
+
+        if (Clip[3] <= 0.0f)
+        {
+            BehindEye = true;
+            continue;
+        }
+
+        const float X = (0.5f + 0.5f * Clip[0] / Clip[3]) * kWidth;
+        const float Y = (0.5f - 0.5f * Clip[1] / Clip[3]) * kHeight;
+        MinX = min(MinX, X);
+        MaxX = max(MaxX, X);
+        MinY = min(MinY, Y);
+        MaxY = max(MaxY, Y);
+    }
+
+    if (OutsideAll != 0)
+        return false;
+
+    // Straddling the eye plane means the box is around the camera, so it could cover anything
+    if (BehindEye)
+    {
+        Area = (float)(kWidth * kHeight);
+        return true;
+    }
+
+    Area = (min(MaxX, (float)kWidth) - max(MinX, 0.0f)) * (min(MaxY, (float)kHeight) - max(MinY, 0.0f));
+    return true;
+}
+
+void SoftwareOcclusion::AddInstance( uint32_t ModelIndex, const float* ModelToWorld )
+{
+    if (ModelIndex >= m_ModelOccluders.size() || m_ModelOccluders[ModelIndex].Count == 0)
+        return;
+
+    const uint32_t Transform = (uint32_t)(m_Transforms.size() / 16);
+    m_Transforms.resize(m_Transforms.size() + 16);
+    float* ModelToProjection = m_Transforms.data() + Transform * 16;
+    MultiplyMatrices(m_ViewProjection, ModelToWorld, ModelToProjection);
+
+    const ModelOccluders& Range = m_ModelOccluders[ModelIndex];
+    for (uint32_t i = Range.First; i < Range.First + Range.Count; ++i)
+    {
+        Candidate NewCandidate;
+        if (!GetScreenArea(ModelToProjection, m_Occluders[i].BoundsMin, m_Occluders[i].BoundsMax, NewCandidate.ScreenArea) ||
+            NewCandidate.ScreenArea < kMinOccluderArea)
+            continue;
+
+        NewCandidate.Occluder = i;
+        NewCandidate.Transform = Transform;
+        NewCandidate.FirstVertex = 0;
+        NewCandidate.FirstTriangle = 0;
+        m_Candidates.push_back(NewCandidate);
+    }
+}
+
+void SoftwareOcclusion::Rasterize( void )
+{
+    // The biggest occluders on screen first, skipping any that would overrun the budget
+    sort(m_Candidates.begin(), m_Candidates.end(),
+        []( const Candidate& a, const Candidate& b ) { return a.ScreenArea > b.ScreenArea; });
+
+    uint32_t VertexCount = 0;
+    uint32_t TriangleCount = 0;
+    m_DrawCount = 0;
+
+    for (uint32_t i = 0; i < (uint32_t)m_Candidates.size(); ++i)
+    {
+        const Occluder& Occ = m_Occluders[m_Candidates[i].Occluder];
+        if (TriangleCount + Occ.TriangleCount > m_TriangleBudget)
+            continue;
+
+        Candidate& Draw = m_Candidates[m_DrawCount++];
+        Draw = m_Candidates[i];
+        Draw.FirstVertex = VertexCount;
+        Draw.FirstTriangle = TriangleCount;
+        VertexCount += (Occ.VertexCount + kVertexAlignment - 1) / kVertexAlignment * kVertexAlignment;
+        TriangleCount += Occ.TriangleCount;
+    }
+
+    m_Stats.Occluders = m_DrawCount;
+    m_Stats.Triangles = TriangleCount;
+    m_Stats.BinnedTriangles = 0;
+
+    if (m_DrawCount == 0)
+        return;
+
+    m_ScreenX.resize(VertexCount);
+    m_ScreenY.resize(VertexCount);
+    m_ScreenInvW.resize(VertexCount);
+    m_Triangles.resize(TriangleCount);
+
+    g_JobScheduler.ParallelFor(0, m_DrawCount, [this]( uint32_t i )
+    {
+        TransformVertices(m_Candidates[i]);
+        SetupTriangles(m_Candidates[i]);
+    });
+
+    BinTriangles();
+
+    g_JobScheduler.ParallelFor(0, kTileCount, [this]( uint32_t Tile )
+    {
+        RasterizeTile(Tile);
+    });
+}
+
+void SoftwareOcclusion::TransformVertices( const Candidate& Draw )
+{
+    const Occluder& Occ = m_Occluders[Draw.Occluder];
+    const float* M = m_Transforms.data() + Draw.Transform * 16;
+
+    const FloatXN M0(M[0]), M1(M[1]), M2(M[2]), M3(M[3]);
+    const FloatXN M4(M[4]), M5(M[5]), M6(M[6]), M7(M[7]);
+    const FloatXN M8(M[8]), M9(M[9]), M10(M[10]), M11(M[11]);
+    const FloatXN M12(M[12]), M13(M[13]), M14(M[14]), M15(M[15]);
+    const FloatXN HalfWidth(0.5f * kWidth), HalfHeight(0.5f * kHeight);
+    const FloatXN Zero(0.0f), One(1.0f), Outside(-1.0f);
+
+    for (uint32_t i = 0; i < Occ.VertexCount; i += FloatXN::kLanes)
+    {
+        const FloatXN X = FloatXN::Load(&m_X[Occ.FirstVertex + i]);
+        const FloatXN Y = FloatXN::Load(&m_Y[Occ.FirstVertex + i]);
+        const FloatXN Z = FloatXN::Load(&m_Z[Occ.FirstVertex + i]);
+
+        const FloatXN ClipX = M0 * X + M4 * Y + M8 * Z + M12;
+        const FloatXN ClipY = M1 * X + M5 * Y + M9 * Z + M13;
+        const FloatXN ClipZ = M2 * X + M6 * Y + M10 * Z + M14;
+        const FloatXN ClipW = M3 * X + M7 * Y + M11 * Z + M15;
+
+        // Between the near and far planes, 0 <= z <= w, whichever of them is at z = 0
+        const FloatXN Inside = (ClipW > Zero) & (ClipZ >= Zero) & (ClipZ <= ClipW);
+        const FloatXN InvW = One / Select(One, ClipW, Inside);
+
+        (HalfWidth + HalfWidth * ClipX * InvW).Store(&m_ScreenX[Draw.FirstVertex + i]);
+        (HalfHeight - HalfHeight * ClipY * InvW).Store(&m_ScreenY[Draw.FirstVertex + i]);
+        Select(Outside, InvW, Inside).Store(&m_ScreenInvW[Draw.FirstVertex + i]);
+    }
+}
+
+void SoftwareOcclusion::SetupTriangles( const Candidate& Draw )
+{
+    const uint32_t kLanes = FloatXN::kLanes;
+
+    const Occluder& Occ = m_Occluders[Draw.Occluder];
+    const uint16_t* Indices = m_Indices.data() + Occ.FirstIndex;
+    const float* ScreenX = m_ScreenX.data() + Draw.FirstVertex;
+    const float* ScreenY = m_ScreenY.data() + Draw.FirstVertex;
+    const float* ScreenInvW = m_ScreenInvW.data() + Draw.FirstVertex;
+    Triangle* Triangles = m_Triangles.data() + Draw.FirstTriangle;
+
+    const FloatXN Zero(0.0f), One(1.0f), MinusOne(-1.0f), Half(0.5f), MinArea(kMinTriangleArea);
+
+    for (uint32_t First = 0; First < Occ.TriangleCount; First += kLanes)
+    {
+        const uint32_t Count = min(kLanes, Occ.TriangleCount - First);
+
+        // The corners of a triangle per lane.  Unused lanes get corners outside the depth range.
+        float Corners[9][kLanes];
+        for (uint32_t Lane = 0; Lane < kLanes; ++Lane)
+        {
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                if (Lane < Count)
+                {
+                    const uint32_t Vertex = Indices[(First + Lane) * 3 + k];
+                    Corners[k * 3][Lane] = ScreenX[Vertex];
+                    Corners[k * 3 + 1][Lane] = ScreenY[Vertex];
+                    Corners[k * 3 + 2][Lane] = ScreenInvW[Vertex];
+                }
+                else
+                {
+                    Corners[k * 3][Lane] = Corners[k * 3 + 1][Lane] = 0.0f;
+                    Corners[k * 3 + 2][Lane] = -1.0f;
+                }
+            }
+        }
+
+        const FloatXN X0 = FloatXN::Load(Corners[0]), Y0 = FloatXN::Load(Corners[1]), W0 = FloatXN::Load(Corners[2]);
+        const FloatXN X1 = FloatXN::Load(Corners[3]), Y1 = FloatXN::Load(Corners[4]), W1 = FloatXN::Load(Corners[5]);
+        const FloatXN X2 = FloatXN::Load(Corners[6]), Y2 = FloatXN::Load(Corners[7]), W2 = FloatXN::Load(Corners[8]);
+
+        // Either winding is drawn; the edges are flipped so that the inside is positive
+        const FloatXN Area = (X1 - X0) * (Y2 - Y0) - (X2 - X0) * (Y1 - Y0);
+        const FloatXN Valid = (W0 > Zero) & (W1 > Zero) & (W2 > Zero) & (Abs(Area) > MinArea);
+        const uint32_t ValidMask = Valid.GetMask();
+
+        if (ValidMask == 0)
+        {
+            for (uint32_t Lane = 0; Lane < Count; ++Lane)
+            {
+                Triangles[First + Lane].MinX = 1;
+                Triangles[First + Lane].MaxX = 0;
+            }
+            continue;
+        }
+
+        const FloatXN Sign = Select(One, MinusOne, Area < Zero);
+        const FloatXN InvArea = One / Select(One, Area, Valid);
+
+        // Edge k runs from corner k to corner k + 1.  Moving C to the pixel center lets the rasterizer step
+        // in whole pixels.
+        FloatXN EdgeA[3], EdgeB[3], EdgeC[3];
+        EdgeA[0] = (Y0 - Y1) * Sign;
+        EdgeB[0] = (X1 - X0) * Sign;
+        EdgeC[0] = (X0 * Y1 - X1 * Y0) * Sign;
+        EdgeA[1] = (Y1 - Y2) * Sign;
+        EdgeB[1] = (X2 - X1) * Sign;
+        EdgeC[1] = (X1 * Y2 - X2 * Y1) * Sign;
+        EdgeA[2] = (Y2 - Y0) * Sign;
+        EdgeB[2] = (X0 - X2) * Sign;
+        EdgeC[2] = (X2 * Y0 - X0 * Y2) * Sign;
+        for (int k = 0; k < 3; ++k)
+            EdgeC[k] = EdgeC[k] + (EdgeA[k] + EdgeB[k]) * Half;
+
+        // The plane through the three values of 1 / w, lowered from the pixel center to its farthest corner
+        const FloatXN DepthA = ((W1 - W0) * (Y2 - Y0) - (W2 - W0) * (Y1 - Y0)) * InvArea;
+        const FloatXN DepthB = ((X1 - X0) * (W2 - W0) - (X2 - X0) * (W1 - W0)) * InvArea;
+        const FloatXN DepthC = W0 - DepthA * X0 - DepthB * Y0 + (DepthA + DepthB - Abs(DepthA) - Abs(DepthB)) * Half;
+
+        // Bounds of the pixel centers covered, kept within a pixel of the buffer so they convert to integers
+        const FloatXN Low(-1.0f), HighX((float)kWidth), HighY((float)kHeight);
+        const FloatXN MinX = Min(Max(Min(Min(X0, X1), X2) - Half, Low), HighX);
+        const FloatXN MaxX = Min(Max(Max(Max(X0, X1), X2) - Half, Low), HighX);
+        const FloatXN MinY = Min(Max(Min(Min(Y0, Y1), Y2) - Half, Low), HighY);
+        const FloatXN MaxY = Min(Max(Max(Max(Y0, Y1), Y2) - Half, Low), HighY);
+
+        float Values[16][kLanes];
+        for (int k = 0; k < 3; ++k)
+        {
+            EdgeA[k].Store(Values[k]);
+            EdgeB[k].Store(Values[3 + k]);
+            EdgeC[k].Store(Values[6 + k]);
+        }
+        DepthA.Store(Values[9]);
+        DepthB.Store(Values[10]);
+        DepthC.Store(Values[11]);
+        MinX.Store(Values[12]);
+        MaxX.Store(Values[13]);
+        MinY.Store(Values[14]);
+        MaxY.Store(Values[15]);
+
+        for (uint32_t Lane = 0; Lane < Count; ++Lane)
+        {
+            Triangle& Tri = Triangles[First + Lane];
+
+            if ((ValidMask & (1u << Lane)) == 0)
+            {
+                Tri.MinX = 1;
+                Tri.MaxX = 0;
+                continue;
+            }
+
+            for (int k = 0; k < 3; ++k)
+            {
+                Tri.EdgeA[k] = Values[k][Lane];
+                Tri.EdgeB[k] = Values[3 + k][Lane];
+                Tri.EdgeC[k] = Values[6 + k][Lane];
+            }
+            Tri.DepthA = Values[9][Lane];
+            Tri.DepthB = Values[10][Lane];
+            Tri.DepthC = Values[11][Lane];
+
+            Tri.MinX = max((int32_t)ceilf(Values[12][Lane]), 0);
+            Tri.MaxX = min((int32_t)floorf(Values[13][Lane]), (int32_t)kWidth - 1);
+            Tri.MinY = max((int32_t)ceilf(Values[14][Lane]), 0);
+            Tri.MaxY = min((int32_t)floorf(Values[15][Lane]), (int32_t)kHeight - 1);
+
+            if (Tri.MinY > Tri.MaxY)
+                Tri.MaxX = Tri.MinX - 1;
+        }
+    }
+}
+
+void SoftwareOcclusion::BinTriangles( void )
+{
+    for (uint32_t Tile = 0; Tile < kTileCount; ++Tile)
+        m_Bins[Tile].clear();
+
+    uint32_t Binned = 0;
+    for (uint32_t i = 0; i < (uint32_t)m_Triangles.size(); ++i)
+    {
+        const Triangle& Tri = m_Triangles[i];
+        if (Tri.MinX > Tri.MaxX)
+            continue;
+
+        for (int32_t ty = Tri.MinY / kTileHeight; ty <= Tri.MaxY / kTileHeight; ++ty)
+        {
+            for (int32_t tx = Tri.MinX / kTileWidth; tx <= Tri.MaxX / kTileWidth; ++tx)
+            {
+                m_Bins[ty * kTilesX + tx].push_back(i);
+                ++Binned;
+            }
+        }
+    }
+
+    m_Stats.BinnedTriangles = Binned;
+}
+
+void SoftwareOcclusion::RasterizeTile( uint32_t Tile )
+{
+    const int32_t kLanes = FloatXN::kLanes;
+    const int32_t TileX = (int32_t)(Tile % kTilesX) * kTileWidth;
+    const int32_t TileY = (int32_t)(Tile / kTilesX) * kTileHeight;
+
+    float* Depth = m_Depth.data() + Tile * kTileWidth * kTileHeight;
+    fill(Depth, Depth + kTileWidth * kTileHeight, 0.0f);
+
+    const FloatXN Zero(0.0f);
+    const FloatXN LaneOffsets = FloatXN::Load(kLaneOffsets);
+
+    // Pixels on the edge of the screen are covered only where they lie wholly inside a triangle; see
+    // IsOccluded.  These are the registers and lanes holding the border columns.
+    const bool TopTile = TileY == 0, BottomTile = TileY + kTileHeight == kHeight;
+    const int32_t LeftBorder = TileX == 0 ? 0 : -kLanes;
+    const int32_t RightBorder = TileX + kTileWidth == kWidth ? kWidth - kLanes : -kLanes;
+    const FloatXN LeftLane = LaneOffsets < FloatXN(0.5f);
+    const FloatXN RightLane = LaneOffsets > FloatXN(kLanes - 1.5f);
+
+    for (uint32_t TriangleIndex : m_Bins[Tile])
+    {
+        const Triangle& Tri = m_Triangles[TriangleIndex];
+
+        // How far each edge function falls from a pixel's center to its corner farthest outside the edge
+        const FloatXN Inset0(0.5f * (fabsf(Tri.EdgeA[0]) + fabsf(Tri.EdgeB[0])));
+        const FloatXN Inset1(0.5f * (fabsf(Tri.EdgeA[1]) + fabsf(Tri.EdgeB[1])));
+        const FloatXN Inset2(0.5f * (fabsf(Tri.EdgeA[2]) + fabsf(Tri.EdgeB[2])));
+
+        // Tiles start on a register boundary, so rounding down keeps every store within the tile
+        const int32_t x0 = max(Tri.MinX, TileX) & ~(kLanes - 1);
+        const int32_t x1 = min(Tri.MaxX, TileX + kTileWidth - 1);
+        const int32_t y0 = max(Tri.MinY, TileY);
+        const int32_t y1 = min(Tri.MaxY, TileY + kTileHeight - 1);
+
+        const FloatXN A0(Tri.EdgeA[0]), A1(Tri.EdgeA[1]), A2(Tri.EdgeA[2]);
+        const FloatXN DepthA(Tri.DepthA);
+
+        for (int32_t y = y0; y <= y1; ++y)
+        {
+            const float fy = (float)y;
+            const FloatXN Row0(Tri.EdgeB[0] * fy + Tri.EdgeC[0]);
+            const FloatXN Row1(Tri.EdgeB[1] * fy + Tri.EdgeC[1]);
+            const FloatXN Row2(Tri.EdgeB[2] * fy + Tri.EdgeC[2]);
+            const FloatXN RowDepth(Tri.DepthB * fy + Tri.DepthC);
+
+            float* DepthRow = Depth + (y - TileY) * kTileWidth - TileX;
+            const bool BorderRow = (TopTile && y == 0) || (BottomTile && y == kHeight - 1);
+
+            for (int32_t x = x0; x <= x1; x += kLanes)
+            {
+                const FloatXN fx = FloatXN((float)x) + LaneOffsets;
+                FloatXN Inside = (A0 * fx + Row0 >= Zero) & (A1 * fx + Row1 >= Zero) & (A2 * fx + Row2 >= Zero);
+                if (Inside.GetMask() == 0)
+                    continue;
+
+                if (BorderRow || x == LeftBorder || x == RightBorder)
+                {
+                    const FloatXN Whole = (A0 * fx + Row0 >= Inset0) & (A1 * fx + Row1 >= Inset1) & (A2 * fx + Row2 >= Inset2);
+                    Inside = BorderRow ? Whole : Select(Inside, Whole, x == LeftBorder ? LeftLane : RightLane);
+                }
+
+                const FloatXN Old = FloatXN::Load(DepthRow + x);
+                Select(Old, Max(Old, DepthA * fx + RowDepth), Inside).Store(DepthRow + x);
+            }
+        }
+    }
+
+    FloatXN MinDepth(FLT_MAX);
+    for (int32_t i = 0; i < kTileWidth * kTileHeight; i += kLanes)
+        MinDepth = Min(MinDepth, FloatXN::Load(Depth + i));
+    m_TileMinDepth[Tile] = MinDepth.ReduceMin();
+}
+
+bool SoftwareOcclusion::IsOccluded( const float* M, const float* BoundsMin, const float* BoundsMax ) const
+{
+    if (m_Stats.Occluders == 0)
+        return false;
+
+    // The eight corners, four at a time:  x and y vary across the lanes and z between the two halves
+    const float CornerX[4] = { BoundsMin[0], BoundsMax[0], BoundsMin[0], BoundsMax[0] };
+    const float CornerY[4] = { BoundsMin[1], BoundsMin[1], BoundsMax[1], BoundsMax[1] };
+    const FloatX4 PX = FloatX4::Load(CornerX);
+    const FloatX4 PY = FloatX4::Load(CornerY);
+    const FloatX4 Zero(0.0f), One(1.0f), HalfWidth(0.5f * kWidth), HalfHeight(0.5f * kHeight);
+
+    FloatX4 MinX(FLT_MAX), MaxX(-FLT_MAX), MinY(FLT_MAX), MaxY(-FLT_MAX), MinW(FLT_MAX);
+
+    for (int Half = 0; Half < 2; ++Half)
+    {
+        const FloatX4 PZ(Half ? BoundsMax[2] : BoundsMin[2]);
+
+        const FloatX4 ClipW = FloatX4(M[3]) * PX + FloatX4(M[7]) * PY + FloatX4(M[11]) * PZ + FloatX4(M[15]);
+        if ((ClipW <= Zero).GetMask() != 0)
+            return false;
+
+        const FloatX4 ClipX = FloatX4(M[0]) * PX + FloatX4(M[4]) * PY + FloatX4(M[8]) * PZ + FloatX4(M[12]);
+        const FloatX4 ClipY = FloatX4(M[1]) * PX + FloatX4(M[5]) * PY + FloatX4(M[9]) * PZ + FloatX4(M[13]);
+        const FloatX4 InvW = One / ClipW;
+        const FloatX4 X = HalfWidth + HalfWidth * ClipX * InvW;
+        const FloatX4 Y = HalfHeight - HalfHeight * ClipY * InvW;
+
+        MinX = Min(MinX, X);
+        MaxX = Max(MaxX, X);
+        MinY = Min(MinY, Y);
+        MaxY = Max(MaxY, Y);
+        MinW = Min(MinW, ClipW);
+    }
+
+    const float Left = MinX.ReduceMin(), Right = MaxX.ReduceMax();
+    const float Top = MinY.ReduceMin(), Bottom = MaxY.ReduceMax();
+
+    // Off screen boxes are left to frustum culling
+    if (Right < 0.0f || Left > (float)kWidth || Bottom < 0.0f || Top > (float)kHeight)
+        return false;
+
+    // Every pixel the rectangle touches and the pixels around them.  An occluder covering a pixel's center
+    // may leave open the part of the pixel the box is behind, but then the occluder's edge runs between the
+    // two, and a neighboring pixel on the box's side of the edge has its center uncovered.  Border pixels
+    // have no neighbors beyond the screen, so the rasterizer covers them only where they are wholly inside.
+    // Separate occluders less than a pixel apart can still cover every center around such a gap.
+    const int32_t x0 = max((int32_t)floorf(max(Left, 0.0f)) - 1, 0);
+    const int32_t x1 = min((int32_t)floorf(min(Right, (float)kWidth)) + 1, (int32_t)kWidth - 1);
+    const int32_t y0 = max((int32_t)floorf(max(Top, 0.0f)) - 1, 0);
+    const int32_t y1 = min((int32_t)floorf(min(Bottom, (float)kHeight)) + 1, (int32_t)kHeight - 1);
+
+    // The nearest point of the box, as 1 / w
+    const float BoxDepth = (1.0f + kDepthTolerance) / MinW.ReduceMin();
+
+    const int32_t kLanes = FloatXN::kLanes;
+    const FloatXN Box(BoxDepth);
+    const FloatXN LaneOffsets = FloatXN::Load(kLaneOffsets);
+
+    for (int32_t ty = y0 / kTileHeight; ty <= y1 / kTileHeight; ++ty)
+    {
+        for (int32_t tx = x0 / kTileWidth; tx <= x1 / kTileWidth; ++tx)
+        {
+            const uint32_t Tile = ty * kTilesX + tx;
+            if (m_TileMinDepth[Tile] > BoxDepth)
+                continue;
+
+            const int32_t TileX = tx * kTileWidth;
+            const int32_t TileY = ty * kTileHeight;
+            const int32_t ScanLeft = max(x0, TileX), ScanRight = min(x1, TileX + kTileWidth - 1);
+            const int32_t ScanTop = max(y0, TileY), ScanBottom = min(y1, TileY + kTileHeight - 1);
+            const FloatXN First((float)ScanLeft), Last((float)ScanRight);
+
+            const float* Depth = m_Depth.data() + Tile * kTileWidth * kTileHeight;
+
+            for (int32_t y = ScanTop; y <= ScanBottom; ++y)
+            {
+                const float* DepthRow = Depth + (y - TileY) * kTileWidth - TileX;
+
+                for (int32_t x = ScanLeft & ~(kLanes - 1); x <= ScanRight; x += kLanes)
+                {
+                    const FloatXN fx = FloatXN((float)x) + LaneOffsets;
+                    const FloatXN Visible = (FloatXN::Load(DepthRow + x) <= Box) & (fx >= First) & (fx <= Last);
+                    if (Visible.GetMask() != 0)
+                        return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+float SoftwareOcclusion::GetDepth( uint32_t x, uint32_t y ) const
+{
+    assert(x < kWidth && y < kHeight);
+    const uint32_t Tile = (y / kTileHeight) * kTilesX + x / kTileWidth;
+    return m_Depth[Tile * kTileWidth * kTileHeight + (y % kTileHeight) * kTileWidth + x % kTileWidth];
+}
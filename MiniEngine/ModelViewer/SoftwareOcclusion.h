@@ -0,0 +1,162 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Occlusion culling against a small depth buffer rasterized on the CPU.  A few large meshes
+// of each model are kept as occluders when the scene loads.  Every frame the occluders covering the most
+// of the screen, up to a triangle budget, are drawn into a 256 x 128 buffer of 1 / w (0 where nothing was
+// drawn, the nearest surface winning), and draws whose bounding box lies behind everything in the buffer
+// under it are skipped.  Unlike DepthPyramid this uses the current frame's camera, so it works on the first
+// frame and after camera cuts, and it needs neither a device nor a readback.
+//
+// Triangle setup handles a SIMD register's worth of triangles at a time (Math/FloatWide.h), and the
+// buffer is split into 32 x 32 tiles that are rasterized in parallel on the job scheduler, a register's
+// worth of pixels at a time.  Occluders cover the pixels whose centers they contain, at the depth of the
+// farthest point of the pixel.  A box is tested against the pixels under it and one pixel around them,
+// which finds the uncovered part of any pixel an occluder's edge crosses.  Triangles with a corner in front
+// of the near plane are dropped, which loses occlusion but never hides anything.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class SoftwareOcclusion
+{
+public:
+
+    enum { kWidth = 256, kHeight = 128, kTileWidth = 32, kTileHeight = 32 };
+    enum { kTilesX = kWidth / kTileWidth, kTilesY = kHeight / kTileHeight, kTileCount = kTilesX * kTilesY };
+
+    // Position-only geometry of one mesh, with indices relative to its first vertex
+    struct MeshDesc
+    {
+        const float* Positions;
+        uint32_t VertexStride;          // In bytes
+        uint32_t VertexCount;
+        const uint16_t* Indices;
+        uint32_t IndexCount;
+        float BoundsMin[3];
+        float BoundsMax[3];
+    };
+
+    // Of the last frame
+    struct Stats
+    {
+        uint32_t Occluders;             // Meshes rasterized
+        uint32_t Triangles;             // Of those meshes
+        uint32_t BinnedTriangles;       // Triangles that survived setup, once per tile they touch
+    };
+
+    SoftwareOcclusion();
+
+    // Copies the meshes of a model that make good occluders:  those with at most MaxMeshTriangles triangles
+    // whose bounding box's largest face is at least MinRelativeSize of the largest face of the model's.  Only
+    // pass meshes that are drawn solid, not cut out.  Returns the number of meshes kept.
+    uint32_t AddModel( uint32_t ModelIndex, const MeshDesc* Meshes, uint32_t MeshCount,
+        float MinRelativeSize = 1.0f / 256.0f, uint32_t MaxMeshTriangles = 4096 );
+    void Clear( void );
+
+    uint32_t GetOccluderCount( void ) const { return (uint32_t)m_Occluders.size(); }
+
+    // Triangles rasterized per frame
+    void SetTriangleBudget( uint32_t MaxTriangles ) { m_TriangleBudget = MaxTriangles; }
+
+    // One frame:  Begin starts a view, AddInstance offers the occluders of each placed model, and Rasterize
+    // draws the biggest of them on screen.  Matrices are 16 floats in Math::Matrix4 layout.
+    void Begin( const float* ViewProjection );
+    void AddInstance( uint32_t ModelIndex, const float* ModelToWorld );
+    void Rasterize( void );
+
+    // True when the box lies entirely behind the occluders.  ModelToProjection must place the box in the
+    // projection passed to Begin.  Boxes reaching behind the eye or off screen are never occluded, nor are
+    // boxes within a pixel of anything nearer in the buffer.
+    bool IsOccluded( const float* ModelToProjection, const float* BoundsMin, const float* BoundsMax ) const;
+
+    // 1 / w at a pixel, 0 where nothing was drawn
+    float GetDepth( uint32_t x, uint32_t y ) const;
+
+    const Stats& GetStats( void ) const { return m_Stats; }
+
+private:
+
+    struct Occluder
+    {
+        uint32_t FirstVertex;           // Into m_X, m_Y and m_Z, a multiple of kVertexAlignment
+        uint32_t VertexCount;
+        uint32_t FirstIndex;            // Into m_Indices
+        uint32_t TriangleCount;
+        float BoundsMin[3];
+        float BoundsMax[3];
+    };
+
+    struct ModelOccluders
+    {
+        uint32_t First;
+        uint32_t Count;
+    };
+
+    // An occluder placed by AddInstance
+    struct Candidate
+    {
+        float ScreenArea;               // In pixels
+        uint32_t Occluder;
+        uint32_t Transform;             // Into m_Transforms, in matrices
+        uint32_t FirstVertex;           // Into the screen space vertices, once chosen
+        uint32_t FirstTriangle;         // Into m_Triangles, once chosen
+    };
+
+    // Evaluated at integer pixel coordinates, the edge functions A x + B y + C are nonnegative where the
+    // pixel's center is inside, and the depth plane gives 1 / w at the pixel's farthest point
+    struct Triangle
+    {
+        float EdgeA[3];
+        float EdgeB[3];
+        float EdgeC[3];
+        float DepthA;
+        float DepthB;
+        float DepthC;
+        int32_t MinX, MinY;             // Pixels whose centers the triangle may cover; none when MinX > MaxX
+        int32_t MaxX, MaxY;
+    };
+
+    enum { kVertexAlignment = 8 };
+
+    static bool GetScreenArea( const float* ModelToProjection, const float* BoundsMin, const float* BoundsMax, float& Area );
+
+    void TransformVertices( const Candidate& Draw );
+    void SetupTriangles( const Candidate& Draw );
+    void BinTriangles( void );
+    void RasterizeTile( uint32_t Tile );
+
+    std::vector<Occluder> m_Occluders;
+    std::vector<ModelOccluders> m_ModelOccluders;   // Per model index
+    std::vector<float> m_X;             // Object space positions of every occluder
+    std::vector<float> m_Y;
+    std::vector<float> m_Z;
+    std::vector<uint16_t> m_Indices;
+    uint32_t m_TriangleBudget;
+
+    float m_ViewProjection[16];
+    std::vector<float> m_Transforms;    // Model to projection of each instance, 16 floats apiece
+    std::vector<Candidate> m_Candidates;
+    uint32_t m_DrawCount;               // The chosen candidates, which come first
+
+    std::vector<float> m_ScreenX;       // In pixels
+    std::vector<float> m_ScreenY;
+    std::vector<float> m_ScreenInvW;    // Negative for vertices outside the depth range
+    std::vector<Triangle> m_Triangles;
+    std::vector<uint32_t> m_Bins[kTileCount];
+
+    // kTileWidth x kTileHeight per tile, tiles in rows and rows within each tile in order
+    std::vector<float> m_Depth;
+    float m_TileMinDepth[kTileCount];   // The farthest depth in each tile
+
+    Stats m_Stats;
+};
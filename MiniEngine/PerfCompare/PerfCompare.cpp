@@ -0,0 +1,206 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Compares the perf counters of two sets of captures and flags regressions.  Each side
+// can be any mix of perfreport.csv files, *_profile.json dumps, and capture folders holding either.
+// Runs on the same side are pooled.  The exit code is 0 if nothing regressed, 1 if something did, and
+// 2 if the inputs couldn't be read, so CI can gate on it directly.
+//
+
+#include "ART/PerfStat/PerfComparison.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+using namespace ART;
+using namespace std;
+using namespace std::experimental;
+
+static void PrintUsage( void )
+{
+    cerr <<
+        "Usage:  PerfCompare [options] <baseline> <candidate>\n"
+        "        PerfCompare [options] -b <baseline> [-b ...] -c <candidate> [-c ...]\n"
+        "\n"
+        "Captures are perfreport.csv files, *_profile.json files, or folders holding either.\n"
+        "\n"
+        "  -b <path>                  Add a baseline capture\n"
+        "  -c <path>                  Add a candidate capture\n"
+        "  --skip <frames>            Frames dropped from the start of each report (default 60)\n"
+        "  --threshold <percent>      Smallest change of the median to flag (default 5)\n"
+        "  --min-delta <value>        Smallest change of the median to flag, in counter units (default 0.01)\n"
+        "  --alpha <p>                Significance level of the Mann-Whitney test (default 0.001)\n"
+        "  --min-samples <count>      Fewer samples are reported as inconclusive (default 8)\n"
+        "  --higher-is-better <name>  Counter that regresses when it decreases (repeatable)\n"
+        "  --counter <substring>      Only compare matching counters (repeatable)\n"
+        "  --format <text|csv|json>   Output format (default text)\n"
+        "  --out <path>               Write the output to a file instead of stdout\n";
+}
+
+static bool LoadCapture( PerfCapture& Capture, const string& Path, uint32_t SkipFrames )
+{
+    string Error;
+    filesystem::path FsPath(Path);
+
+    if (!filesystem::is_directory(FsPath))
+    {
+        if (Capture.Load(Path.c_str(), SkipFrames, Error))
+            return true;
+
+        cerr << Error << endl;
+        return false;
+    }
+
+    // A sequence folder has a report; a folder of single frame dumps has profiles
+    filesystem::path Report = FsPath / "perfreport.csv";
+    if (filesystem::exists(Report))
+        return LoadCapture(Capture, Report.generic_string(), SkipFrames);
+
+    bool FoundAny = false;
+    for (auto& Entry : filesystem::directory_iterator(FsPath))
+    {
+        string FileName = Entry.path().filename().generic_string();
+        const char* Suffix = "_profile.json";
+        if (FileName.size() < strlen(Suffix) || FileName.compare(FileName.size() - strlen(Suffix), string::npos, Suffix) != 0)
+            continue;
+
+        if (!Capture.LoadProfileJson(Entry.path().generic_string().c_str(), Error))
+        {
+            cerr << Error << endl;
+            return false;
+        }
+        FoundAny = true;
+    }
+
+    if (!FoundAny)
+        cerr << "No perfreport.csv or *_profile.json in " << Path << endl;
+
+    return FoundAny;
+}
+
+int main( int argc, char** argv )
+{
+    PerfCompareOptions Options;
+    vector<string> BaselinePaths, CandidatePaths, Positional;
+    uint32_t SkipFrames = 60;
+    string Format = "text";
+    string OutPath;
+    bool UserHigherIsBetter = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* Arg = argv[i];
+        bool HasValue = i + 1 < argc;
+
+        if (Arg[0] != '-')
+        {
+            Positional.push_back(Arg);
+            continue;
+        }
+
+        if (!HasValue)
+        {
+            PrintUsage();
+            return 2;
+        }
+
+        const char* Value = argv[++i];
+
+        if (STRMATCH(Arg, "-b"))
+            BaselinePaths.push_back(Value);
+        else if (STRMATCH(Arg, "-c"))
+            CandidatePaths.push_back(Value);
+        else if (STRMATCH(Arg, "--skip"))
+            SkipFrames = (uint32_t)atoi(Value);
+        else if (STRMATCH(Arg, "--threshold"))
+            Options.RelativeThreshold = (float)atof(Value) / 100.0f;
+        else if (STRMATCH(Arg, "--min-delta"))
+            Options.AbsoluteThreshold = (float)atof(Value);
+        else if (STRMATCH(Arg, "--alpha"))
+            Options.Alpha = atof(Value);
+        else if (STRMATCH(Arg, "--min-samples"))
+            Options.MinSamples = (uint32_t)atoi(Value);
+        else if (STRMATCH(Arg, "--higher-is-better"))
+        {
+            // the first one given replaces the default list
+            if (!UserHigherIsBetter)
+                Options.HigherIsBetter.clear();
+            UserHigherIsBetter = true;
+            Options.HigherIsBetter.push_back(Value);
+        }
+        else if (STRMATCH(Arg, "--counter"))
+            Options.Filter.push_back(Value);
+        else if (STRMATCH(Arg, "--format"))
+            Format = Value;
+        else if (STRMATCH(Arg, "--out"))
+            OutPath = Value;
+        else
+        {
+            cerr << "Unknown option " << Arg << endl;
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    if (Positional.size() == 2 && BaselinePaths.empty() && CandidatePaths.empty())
+    {
+        BaselinePaths.push_back(Positional[0]);
+        CandidatePaths.push_back(Positional[1]);
+    }
+    else if (!Positional.empty() || BaselinePaths.empty() || CandidatePaths.empty())
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    if (Format != "text" && Format != "csv" && Format != "json")
+    {
+        cerr << "Unknown format " << Format << endl;
+        return 2;
+    }
+
+    PerfCapture Baseline, Candidate;
+    for (auto& Path : BaselinePaths)
+    {
+        if (!LoadCapture(Baseline, Path, SkipFrames))
+            return 2;
+    }
+    for (auto& Path : CandidatePaths)
+    {
+        if (!LoadCapture(Candidate, Path, SkipFrames))
+            return 2;
+    }
+
+    PerfComparison Comparison;
+    Comparison.Compare(Baseline, Candidate, Options);
+
+    ofstream OutFile;
+    if (!OutPath.empty())
+    {
+        OutFile.open(OutPath.c_str());
+        if (!OutFile)
+        {
+            cerr << "Unable to write file: " << OutPath << endl;
+            return 2;
+        }
+    }
+    ostream& Out = OutPath.empty() ? cout : OutFile;
+
+    if (Format == "json")
+        Comparison.WriteJson(Out);
+    else if (Format == "csv")
+        Comparison.WriteCsv(Out);
+    else
+        Comparison.WriteText(Out);
+
+    return Comparison.GetCount(PerfVerdict::Regressed) > 0 ? 1 : 0;
+}
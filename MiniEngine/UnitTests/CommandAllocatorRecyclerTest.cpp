@@ -0,0 +1,268 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of the command allocator recycling behind CommandAllocatorPool, with stub allocators:
+// that any allocator whose fence has completed is reused, that the pool stays bounded when allocators are
+// discarded out of order, that a thread's cached allocators go back to the pool when it exits, and that a
+// Shutdown racing a thread's exit never lets a released allocator back in.
+//
+
+#include "UnitTest.h"
+#include "CommandAllocatorRecycler.h"
+
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    struct StubAllocator
+    {
+        size_t Index;
+        bool Released;
+    };
+
+    // Owns the stubs a recycler creates, and checks that none is handed out after it was released
+    class StubDevice
+    {
+    public:
+        StubDevice() : m_HandedOutReleased(false) {}
+
+        template <typename TRecycler>
+        StubAllocator* Request( TRecycler& Recycler, uint64_t CompletedFenceValue )
+        {
+            bool Reused;
+            StubAllocator* Allocator = Recycler.Request(CompletedFenceValue, Reused, [this]( size_t Index )
+            {
+                m_Allocators.push_back(unique_ptr<StubAllocator>(new StubAllocator{ Index, false }));
+                return m_Allocators.back().get();
+            });
+            m_HandedOutReleased = m_HandedOutReleased || Allocator->Released;
+            return Allocator;
+        }
+
+        template <typename TRecycler>
+        void Shutdown( TRecycler& Recycler )
+        {
+            Recycler.Shutdown([]( StubAllocator* Allocator ) { Allocator->Released = true; });
+        }
+
+        size_t GetCreatedCount( void ) const { return m_Allocators.size(); }
+        bool HandedOutReleased( void ) const { return m_HandedOutReleased; }
+
+        bool AllReleased( void ) const
+        {
+            for (const unique_ptr<StubAllocator>& Allocator : m_Allocators)
+            {
+                if (!Allocator->Released)
+                    return false;
+            }
+            return true;
+        }
+
+    private:
+        vector<unique_ptr<StubAllocator>> m_Allocators;
+        bool m_HandedOutReleased;
+    };
+
+    typedef CommandAllocatorRecycler<StubAllocator> Recycler;
+
+    // A later-discarded allocator whose fence has completed is reused while an earlier one is still in flight,
+    // both from the thread cache and from the locked pool
+    void TestReusesAnyCompleted( void )
+    {
+        for (uint32_t CacheSlot : { 0u, (uint32_t)Recycler::kNoCacheSlot })
+        {
+            Recycler Pool(CacheSlot);
+            StubDevice Device;
+
+            StubAllocator* Slow = Device.Request(Pool, 0);
+            StubAllocator* Fast = Device.Request(Pool, 0);
+            CHECK_EQUAL(Device.GetCreatedCount(), 2u);
+
+            Pool.Discard(10, Slow);
+            Pool.Discard(2, Fast);
+
+            // Only the second is done
+            CHECK_EQUAL(Device.Request(Pool, 5), Fast);
+            CHECK_EQUAL(Device.GetCreatedCount(), 2u);
+
+            // Nothing else is, so a new one is made
+            StubAllocator* Third = Device.Request(Pool, 5);
+            CHECK(Third != Slow && Third != Fast);
+            CHECK_EQUAL(Device.GetCreatedCount(), 3u);
+
+            CHECK_EQUAL(Device.Request(Pool, 10), Slow);
+
+            Recycler::Stats Stats = Pool.GetStats();
+            CHECK_EQUAL(Stats.PoolSize, 3u);
+            CHECK_EQUAL(Stats.Created, 3u);
+            CHECK_EQUAL(Stats.Reused, 2u);
+            CHECK_EQUAL(Stats.ThreadCacheHits, CacheSlot == 0 ? 2u : 0u);
+
+            Device.Shutdown(Pool);
+            CHECK(Device.AllReleased());
+            CHECK_EQUAL(Pool.Size(), 0u);
+        }
+    }
+
+    // Contexts on several queues finish out of order, so allocators are discarded with fence values out of
+    // order.  The pool only grows to what is in flight at once.
+    void TestBoundedOutOfOrder( void )
+    {
+        const uint32_t kInFlight = 12;
+
+        for (uint32_t CacheSlot : { 1u, (uint32_t)Recycler::kNoCacheSlot })
+        {
+            Recycler Pool(CacheSlot);
+            StubDevice Device;
+
+            srand(7);
+            uint64_t NextFence = 1;
+            uint64_t CompletedFence = 0;
+
+            vector<StubAllocator*> Recording;
+            for (uint32_t Frame = 0; Frame < 2000; ++Frame)
+            {
+                // Start contexts until kInFlight are recording or waiting on the GPU
+                while (Recording.size() < kInFlight)
+                    Recording.push_back(Device.Request(Pool, CompletedFence));
+
+                // Finish a random one, handing its allocator back under a fence that is later than some still
+                // to be discarded
+                size_t Finished = (size_t)rand() % Recording.size();
+                Pool.Discard(NextFence + (uint64_t)(rand() % 8), Recording[Finished]);
+                Recording.erase(Recording.begin() + Finished);
+                ++NextFence;
+
+                // The GPU keeps up to eight fences behind
+                if (NextFence > CompletedFence + 8)
+                    CompletedFence = NextFence - 8;
+            }
+
+            // In flight, plus those waiting on the GPU's last eight fences and the ones they were discarded past
+            CHECK(Device.GetCreatedCount() <= kInFlight + 16);
+            CHECK(Pool.GetStats().Reused > 1900);
+            printf("    %s: %zu allocators for %u in flight\n", CacheSlot == 1 ? "cached" : "uncached",
+                Device.GetCreatedCount(), kInFlight);
+
+            Device.Shutdown(Pool);
+            CHECK(!Device.HandedOutReleased());
+        }
+    }
+
+    // A thread's cached allocators go back to the pool when it exits, for any thread to reuse
+    void TestThreadExitReturns( void )
+    {
+        Recycler Pool(2);
+        StubDevice Device;
+        StubAllocator* Allocators[2] = {};
+
+        thread Worker([&]()
+        {
+            Allocators[0] = Device.Request(Pool, 0);
+            Allocators[1] = Device.Request(Pool, 0);
+            Pool.Discard(1, Allocators[0]);
+            Pool.Discard(1, Allocators[1]);
+        });
+        Worker.join();
+        CHECK_EQUAL(Device.GetCreatedCount(), 2u);
+
+        // This thread's cache is empty, so both come from the pool
+        StubAllocator* First = Device.Request(Pool, 1);
+        StubAllocator* Second = Device.Request(Pool, 1);
+        CHECK(First != Second);
+        CHECK(First == Allocators[0] || First == Allocators[1]);
+        CHECK(Second == Allocators[0] || Second == Allocators[1]);
+        CHECK_EQUAL(Device.GetCreatedCount(), 2u);
+        CHECK_EQUAL(Pool.GetStats().ThreadCacheHits, 0u);
+
+        Device.Shutdown(Pool);
+
+        // A thread that exits after Shutdown drops what it held
+        thread Late([&]()
+        {
+            StubAllocator* Allocator = Device.Request(Pool, 0);
+            Pool.Discard(1, Allocator);
+            Device.Shutdown(Pool);
+        });
+        Late.join();
+        CHECK_EQUAL(Pool.Size(), 0u);
+        CHECK(Device.Request(Pool, 1)->Index == 0);
+        CHECK(!Device.HandedOutReleased());
+        Device.Shutdown(Pool);
+    }
+
+    // A mutex that runs a hook the first time it is locked after the hook is set
+    struct HookedMutex
+    {
+        static function<void()> BeforeLock;
+
+        void lock( void )
+        {
+            if (BeforeLock)
+            {
+                function<void()> Hook = move(BeforeLock);
+                BeforeLock = nullptr;
+                Hook();
+            }
+            m_Mutex.lock();
+        }
+
+        void unlock( void ) { m_Mutex.unlock(); }
+
+        mutex m_Mutex;
+    };
+
+    function<void()> HookedMutex::BeforeLock;
+
+    // A thread exits, finds its cache current and goes for the pool's lock, but Shutdown gets there first.
+    // The released allocators must not go back into the pool.
+    void TestShutdownDuringThreadExit( void )
+    {
+        typedef CommandAllocatorRecycler<StubAllocator, HookedMutex> HookedRecycler;
+        HookedRecycler Pool(0);
+        StubDevice Device;
+
+        thread Worker([&]()
+        {
+            Pool.Discard(1, Device.Request(Pool, 0));
+            Pool.Discard(1, Device.Request(Pool, 0));
+
+            // The only lock left on this thread is the one taken when its cache is returned
+            HookedMutex::BeforeLock = [&]() { Device.Shutdown(Pool); };
+        });
+        Worker.join();
+        CHECK(!HookedMutex::BeforeLock);
+        CHECK(Device.AllReleased());
+
+        // Had the cache gone back, these would be the released allocators
+        StubAllocator* First = Device.Request(Pool, 1);
+        StubAllocator* Second = Device.Request(Pool, 1);
+        CHECK(!Device.HandedOutReleased());
+        CHECK_EQUAL(Device.GetCreatedCount(), 4u);
+        CHECK(!First->Released && !Second->Released);
+        CHECK_EQUAL(Pool.GetStats().Reused, 0u);
+
+        Device.Shutdown(Pool);
+    }
+}
+
+int main( void )
+{
+    RUN_TEST(TestReusesAnyCompleted);
+    RUN_TEST(TestBoundedOutOfOrder);
+    RUN_TEST(TestThreadExitReturns);
+    RUN_TEST(TestShutdownDuringThreadExit);
+    return UnitTest::Report();
+}
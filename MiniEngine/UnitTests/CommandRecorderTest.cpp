@@ -0,0 +1,556 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of CommandRecorder's bookkeeping, which is the same ResourceBarrierQueue and
+// DescriptorHandleCache that CommandContext and DynamicDescriptorHeap use:  how queued transitions merge,
+// how many descriptors staged tables copy, and that a pass split across forked workers draws exactly what
+// it draws when recorded serially.
+//
+
+#include "UnitTest.h"
+#include "CommandRecorder.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <map>
+
+using namespace std;
+
+namespace
+{
+    // D3D12_RESOURCE_STATES
+    const uint32_t kRenderTarget = 0x4;
+    const uint32_t kDepthWrite = 0x10;
+    const uint32_t kPixelShaderResource = 0x80;
+    const uint32_t kCopySource = 0x800;
+
+    struct RecordedBarrier
+    {
+        uint32_t Type;
+        uint32_t Flags;
+        uint64_t Id;
+        uint32_t Before;
+        uint32_t After;
+    };
+
+    // The barriers of every ResourceBarrier command, in order
+    vector<RecordedBarrier> GetBarriers( const CommandRecorder& Recorder )
+    {
+        vector<RecordedBarrier> Barriers;
+        CommandRecorder::Reader Stream(Recorder);
+        CommandRecorder::Command Cmd;
+        while (Stream.Next(Cmd))
+        {
+            if (Cmd.Op != CommandRecorder::kResourceBarrier)
+                continue;
+
+            const uint32_t* Args = Cmd.Args + 1;
+            for (uint32_t i = 0; i < Cmd.Args[0]; ++i, Args += 5)
+            {
+                RecordedBarrier B = { Args[0] & 0xFF, Args[0] >> 8, Args[1] | (uint64_t)Args[2] << 32, Args[3], Args[4] };
+                Barriers.push_back(B);
+            }
+        }
+        return Barriers;
+    }
+
+    void TestRedundantTransition( void )
+    {
+        CommandRecorder Recorder;
+        CommandRecorder::Resource Target(1, kRenderTarget);
+        Recorder.TransitionResource(Target, kRenderTarget, true);
+
+        CHECK_EQUAL(Recorder.GetCounters().RedundantTransitions, 1u);
+        CHECK_EQUAL(Recorder.GetCounters().Barriers, 0u);
+
+        // A UAV kept in the UAV state still needs a barrier between writes
+        CommandRecorder::Resource Buffer(2, CommandRecorder::kStateUnorderedAccess);
+        Recorder.TransitionResource(Buffer, CommandRecorder::kStateUnorderedAccess, true);
+        vector<RecordedBarrier> Barriers = GetBarriers(Recorder);
+        CHECK_EQUAL(Barriers.size(), 1u);
+        CHECK(Barriers.size() == 1 && Barriers[0].Type == 2 && Barriers[0].Id == 2);
+    }
+
+    // A->B then B->C before a flush is one A->C, and A->B->A is nothing
+    void TestMergedTransitions( void )
+    {
+        CommandRecorder Recorder;
+        CommandRecorder::Resource Tex(1, kRenderTarget), Other(2, kRenderTarget);
+
+        Recorder.TransitionResource(Tex, kPixelShaderResource);
+        Recorder.TransitionResource(Tex, kCopySource);
+        Recorder.TransitionResource(Other, kPixelShaderResource);
+        Recorder.TransitionResource(Other, kRenderTarget);
+        Recorder.FlushResourceBarriers();
+
+        vector<RecordedBarrier> Barriers = GetBarriers(Recorder);
+        CHECK_EQUAL(Barriers.size(), 1u);
+        CHECK(Barriers.size() == 1 && Barriers[0].Before == kRenderTarget && Barriers[0].After == kCopySource);
+        CHECK_EQUAL(Recorder.GetCounters().MergedTransitions, 2u);
+        CHECK_EQUAL(Tex.UsageState, kCopySource);
+        CHECK_EQUAL(Other.UsageState, kRenderTarget);
+    }
+
+    // A UAV barrier on the resource orders work against the queued transition, so it isn't rewritten
+    void TestUAVBarrierBlocksMerge( void )
+    {
+        CommandRecorder Recorder;
+        CommandRecorder::Resource Buffer(1, kPixelShaderResource);
+
+        Recorder.TransitionResource(Buffer, CommandRecorder::kStateUnorderedAccess);
+        Recorder.InsertUAVBarrier(Buffer);
+        Recorder.TransitionResource(Buffer, kPixelShaderResource, true);
+
+        vector<RecordedBarrier> Barriers = GetBarriers(Recorder);
+        CHECK_EQUAL(Barriers.size(), 3u);
+        CHECK_EQUAL(Recorder.GetCounters().MergedTransitions, 0u);
+    }
+
+    void TestSplitTransitions( void )
+    {
+        // Begun and ended in the same batch:  one ordinary transition
+        {
+            CommandRecorder Recorder;
+            CommandRecorder::Resource Tex(1, kRenderTarget);
+            Recorder.BeginResourceTransition(Tex, kPixelShaderResource);
+            Recorder.TransitionResource(Tex, kPixelShaderResource, true);
+
+            vector<RecordedBarrier> Barriers = GetBarriers(Recorder);
+            CHECK_EQUAL(Barriers.size(), 1u);
+            CHECK(Barriers.size() == 1 && Barriers[0].Flags == 0 && Barriers[0].After == kPixelShaderResource);
+            CHECK_EQUAL(Tex.TransitioningState, (uint32_t)CommandRecorder::kStateInvalid);
+        }
+
+        // Begun, flushed, then ended:  a begin-only and an end-only barrier
+        {
+            CommandRecorder Recorder;
+            CommandRecorder::Resource Tex(1, kRenderTarget);
+            Recorder.BeginResourceTransition(Tex, kPixelShaderResource, true);
+            CHECK_EQUAL(Tex.UsageState, kRenderTarget);
+            CHECK_EQUAL(Tex.TransitioningState, kPixelShaderResource);
+            Recorder.TransitionResource(Tex, kDepthWrite, true);
+
+            vector<RecordedBarrier> Barriers = GetBarriers(Recorder);
+            CHECK_EQUAL(Barriers.size(), 3u);
+            if (Barriers.size() == 3)
+            {
+                CHECK_EQUAL(Barriers[0].Flags, 1u);
+                CHECK_EQUAL(Barriers[1].Flags, 2u);
+                CHECK_EQUAL(Barriers[1].After, kPixelShaderResource);
+                CHECK_EQUAL(Barriers[2].Before, kPixelShaderResource);
+                CHECK_EQUAL(Barriers[2].After, kDepthWrite);
+            }
+            CHECK_EQUAL(Tex.UsageState, kDepthWrite);
+        }
+    }
+
+    // A resource sent back to the state its split transition began from still has the split closed
+    void TestSplitTransitionBack( void )
+    {
+        // Begun and sent back in the same batch:  the begin is cancelled
+        {
+            CommandRecorder Recorder;
+            CommandRecorder::Resource Tex(1, kRenderTarget);
+            Recorder.BeginResourceTransition(Tex, kPixelShaderResource);
+            Recorder.TransitionResource(Tex, kRenderTarget, true);
+
+            CHECK_EQUAL(GetBarriers(Recorder).size(), 0u);
+            CHECK_EQUAL(Tex.UsageState, kRenderTarget);
+            CHECK_EQUAL(Tex.TransitioningState, (uint32_t)CommandRecorder::kStateInvalid);
+            CHECK_EQUAL(Recorder.GetCounters().RedundantTransitions, 0u);
+        }
+
+        // Begun, flushed, then sent back:  the end-only barrier, then the transition back
+        {
+            CommandRecorder Recorder;
+            CommandRecorder::Resource Tex(1, kRenderTarget);
+            Recorder.BeginResourceTransition(Tex, kPixelShaderResource, true);
+            Recorder.TransitionResource(Tex, kRenderTarget, true);
+
+            vector<RecordedBarrier> Barriers = GetBarriers(Recorder);
+            CHECK_EQUAL(Barriers.size(), 3u);
+            if (Barriers.size() == 3)
+            {
+                CHECK_EQUAL(Barriers[0].Flags, 1u);
+                CHECK_EQUAL(Barriers[1].Flags, 2u);
+                CHECK_EQUAL(Barriers[1].Before, kRenderTarget);
+                CHECK_EQUAL(Barriers[1].After, kPixelShaderResource);
+                CHECK_EQUAL(Barriers[2].Flags, 0u);
+                CHECK_EQUAL(Barriers[2].Before, kPixelShaderResource);
+                CHECK_EQUAL(Barriers[2].After, kRenderTarget);
+            }
+            CHECK_EQUAL(Tex.UsageState, kRenderTarget);
+            CHECK_EQUAL(Tex.TransitioningState, (uint32_t)CommandRecorder::kStateInvalid);
+            CHECK_EQUAL(Recorder.GetCounters().RedundantTransitions, 0u);
+
+            // Nothing is left open, so a new split can begin
+            Recorder.BeginResourceTransition(Tex, kCopySource, true);
+            Recorder.TransitionResource(Tex, kCopySource, true);
+            Barriers = GetBarriers(Recorder);
+            CHECK_EQUAL(Barriers.size(), 5u);
+            CHECK_EQUAL(Tex.UsageState, kCopySource);
+        }
+    }
+
+    // Only the stale tables are copied, up to their last assigned handle
+    void TestDescriptorTables( void )
+    {
+        CommandRecorder Recorder;
+        CommandRecorder::RootLayout Layout;
+        Layout.Id = 1;
+        Layout.SetDescriptorTable(1, 8);
+        Layout.SetDescriptorTable(2, 4);
+        Recorder.SetRootSignature(Layout);
+        Recorder.SetRootSignature(Layout);
+        CHECK_EQUAL(Recorder.GetCounters().RootSignatureChanges, 1u);
+        CHECK_EQUAL(Recorder.GetCounters().RedundantStateChanges, 1u);
+
+        const CommandRecorder::ObjectId Handles[3] = { 10, 11, 12 };
+        Recorder.SetDynamicDescriptors(1, 0, 3, Handles);
+        Recorder.SetDynamicDescriptor(2, 2, 13);
+        Recorder.Draw(3);
+
+        const CommandRecorder::Counters& Counters = Recorder.GetCounters();
+        CHECK_EQUAL(Counters.DescriptorHeapChanges, 1u);
+        CHECK_EQUAL(Counters.DescriptorCopies, 4u);
+        CHECK_EQUAL(Counters.RootParameterChanges, 2u);
+
+        // Nothing changed, so the next draw commits nothing
+        Recorder.Draw(3);
+        CHECK_EQUAL(Recorder.GetCounters().DescriptorCopies, 4u);
+
+        Recorder.SetDynamicDescriptor(2, 0, 14);
+        Recorder.Draw(3);
+        CHECK_EQUAL(Recorder.GetCounters().DescriptorCopies, 6u);
+        CHECK_EQUAL(Recorder.GetCounters().RootParameterChanges, 3u);
+        CHECK_EQUAL(Recorder.GetCounters().Draws, 3u);
+    }
+
+    // Running out of heap space binds a new heap and copies every bound table again
+    void TestDescriptorHeapRollover( void )
+    {
+        CommandRecorder Recorder;
+        CommandRecorder::RootLayout Layout;
+        Layout.Id = 1;
+        Layout.SetDescriptorTable(0, 32);
+        Layout.SetDescriptorTable(1, 1);
+        Recorder.SetRootSignature(Layout);
+
+        Recorder.SetDynamicDescriptor(1, 0, 99);
+        CommandRecorder::ObjectId Handles[32];
+        for (uint32_t i = 0; i < 32; ++i)
+            Handles[i] = 100 + i;
+
+        // 1 + 32 descriptors, then 32 per draw:  the 1024 descriptor heap fills on the 33rd draw
+        for (uint32_t i = 0; i < 33; ++i)
+        {
+            Recorder.SetDynamicDescriptors(0, 0, 32, Handles);
+            Recorder.Draw(3);
+        }
+
+        CHECK_EQUAL(Recorder.GetCounters().DescriptorHeapChanges, 2u);
+        CHECK_EQUAL(Recorder.GetCounters().DescriptorCopies, 33u * 32u + 2u);
+    }
+
+    // Reset clears the stream, counters, and bound state
+    void TestReset( void )
+    {
+        CommandRecorder Recorder;
+        CommandRecorder::Resource Tex(1, kRenderTarget);
+        Recorder.SetPipelineState(5);
+        Recorder.TransitionResource(Tex, kPixelShaderResource);
+        Recorder.TransitionResource(Tex, kCopySource);
+        Recorder.Reset();
+
+        CHECK_EQUAL(Recorder.GetStreamBytes(), 0u);
+        CHECK_EQUAL(Recorder.GetCounters().MergedTransitions, 0u);
+        Recorder.FlushResourceBarriers();
+        CHECK_EQUAL(Recorder.GetCounters().Barriers, 0u);
+
+        Recorder.SetPipelineState(5);
+        CHECK_EQUAL(Recorder.GetCounters().PipelineChanges, 1u);
+    }
+
+    //
+    // Parallel recording
+    //
+
+    // Root parameters of the model pass, as ModelViewer lays them out
+    enum { kRootMeshCBV, kRootPassCBV, kRootMaterialCBV, kRootMaterialSRVs, kRootExtraSRVs, kRootDrawConstants, kRootCount };
+    const uint32_t kMaterialTableSize = 6;
+    const uint32_t kExtraTableSize = 2;
+    const size_t kCBVSize[kRootCount] = { 64, 32, 4, 0, 0, 0 };
+
+    const uint32_t kNumModels = 3;
+    const uint32_t kNumInstances = 24;
+
+    uint32_t InstanceModel( uint32_t Instance ) { return Instance / 4 % kNumModels; }
+    uint32_t MeshCount( uint32_t Model ) { return 4 + Model; }
+    uint32_t MeshMaterial( uint32_t Model, uint32_t Mesh ) { return Model * 8 + Mesh / 2; }
+
+    CommandRecorder::RootLayout MakeModelRootLayout( void )
+    {
+        CommandRecorder::RootLayout Layout;
+        Layout.Id = 1;
+        Layout.SetDescriptorTable(kRootMaterialSRVs, kMaterialTableSize);
+        Layout.SetDescriptorTable(kRootExtraSRVs, kExtraTableSize);
+        Layout.NumParameters = kRootCount;
+        return Layout;
+    }
+
+    // What the pass records before its draws:  a transition, then the state every draw shares
+    void BeginModelPass( CommandRecorder& Recorder, const CommandRecorder::RootLayout& Layout, CommandRecorder::Resource& Target )
+    {
+        Recorder.TransitionResource(Target, kRenderTarget);
+        Recorder.SetRootSignature(Layout);
+        Recorder.SetPipelineState(7);
+
+        const CommandRecorder::ObjectId Extra[kExtraTableSize] = { 500, 501 };
+        Recorder.SetDynamicDescriptors(kRootExtraSRVs, 0, kExtraTableSize, Extra);
+        float PassConstants[8] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f };
+        Recorder.SetDynamicConstantBufferView(kRootPassCBV, sizeof(PassConstants), PassConstants);
+
+        const CommandRecorder::ObjectId RTV = Target.Id;
+        Recorder.SetRenderTargets(1, &RTV, 20);
+        Recorder.SetViewportAndScissor(0, 0, 1280, 720);
+        Recorder.SetPrimitiveTopology(4);
+    }
+
+    // Records draws [FirstDraw, EndDraw) of the pass the way ModelViewer::RecordObjects does
+    void RecordModelSlice( CommandRecorder& Recorder, uint32_t FirstDraw, uint32_t EndDraw )
+    {
+        uint32_t ModelIdx = ~0u;
+        uint32_t InstanceFirstDraw = 0;
+
+        for (uint32_t Instance = 0; Instance < kNumInstances && InstanceFirstDraw < EndDraw; ++Instance)
+        {
+            const uint32_t Model = InstanceModel(Instance);
+            const uint32_t MeshBegin = FirstDraw > InstanceFirstDraw ? FirstDraw - InstanceFirstDraw : 0;
+            const uint32_t MeshEnd = min(MeshCount(Model), EndDraw - InstanceFirstDraw);
+            InstanceFirstDraw += MeshCount(Model);
+            if (MeshBegin >= MeshEnd)
+                continue;
+
+            if (Model != ModelIdx)
+            {
+                ModelIdx = Model;
+                Recorder.SetIndexBuffer(100 + Model);
+                const CommandRecorder::ObjectId VertexBuffer = 200 + Model;
+                Recorder.SetVertexBuffers(0, 1, &VertexBuffer);
+                Recorder.SetDynamicDescriptor(kRootMaterialSRVs, kMaterialTableSize - 1, 300 + Model);
+            }
+
+            float MeshConstants[16];
+            for (uint32_t i = 0; i < 16; ++i)
+                MeshConstants[i] = (float)(Instance * 16 + i);
+            Recorder.SetDynamicConstantBufferView(kRootMeshCBV, sizeof(MeshConstants), MeshConstants);
+
+            uint32_t MaterialIdx = ~0u;
+            for (uint32_t Mesh = MeshBegin; Mesh < MeshEnd; ++Mesh)
+            {
+                if (MeshMaterial(Model, Mesh) != MaterialIdx)
+                {
+                    MaterialIdx = MeshMaterial(Model, Mesh);
+                    CommandRecorder::ObjectId Textures[kMaterialTableSize - 1];
+                    for (uint32_t i = 0; i < kMaterialTableSize - 1; ++i)
+                        Textures[i] = 1000 + MaterialIdx * 8 + i;
+                    Recorder.SetDynamicDescriptors(kRootMaterialSRVs, 0, kMaterialTableSize - 1, Textures);
+                    Recorder.SetDynamicConstantBufferView(kRootMaterialCBV, sizeof(MaterialIdx), &MaterialIdx);
+                }
+
+                Recorder.SetConstants(kRootDrawConstants, Mesh * 10, MaterialIdx);
+                Recorder.DrawIndexed(30 + Mesh, Mesh * 100, (int32_t)Mesh * 50);
+            }
+        }
+    }
+
+    uint32_t CountModelDraws( void )
+    {
+        uint32_t NumDraws = 0;
+        for (uint32_t Instance = 0; Instance < kNumInstances; ++Instance)
+            NumDraws += MeshCount(InstanceModel(Instance));
+        return NumDraws;
+    }
+
+    // A draw's arguments followed by everything bound when it executes.  Descriptor tables are resolved to
+    // the descriptors copied into them and CBVs to their constants, so draws that render the same thing
+    // compare equal wherever they were recorded.
+    typedef vector<uint64_t> DrawWords;
+
+    // What is bound on one command list.  Each command list starts with nothing bound.
+    struct BoundState
+    {
+        map< uint32_t, vector<uint64_t> > Words;
+        vector<uint64_t> RootParams[kRootCount];
+    };
+
+    void Replay( const CommandRecorder& Recorder, vector<DrawWords>& Draws, vector<RecordedBarrier>& Barriers )
+    {
+        BoundState State;
+        CommandRecorder::Reader Stream(Recorder);
+        CommandRecorder::Command Cmd;
+        while (Stream.Next(Cmd))
+        {
+            const uint32_t* Args = Cmd.Args;
+            switch (Cmd.Op)
+            {
+            case CommandRecorder::kSetGraphicsRootSignature:
+                for (uint32_t i = 0; i < kRootCount; ++i)
+                    State.RootParams[i].clear();
+                State.Words[Cmd.Op].assign(Args, Args + Cmd.NumArgs);
+                break;
+
+            case CommandRecorder::kSetGraphicsRootConstants:
+                State.RootParams[Args[0]].assign(Args + 1, Args + Cmd.NumArgs);
+                break;
+
+            case CommandRecorder::kSetGraphicsRootCBV:
+            {
+                const uint8_t* Data = (const uint8_t*)CommandRecorder::GetUploadData(Args[1] | (uint64_t)Args[2] << 32);
+                State.RootParams[Args[0]].assign(Data, Data + kCBVSize[Args[0]]);
+                break;
+            }
+
+            case CommandRecorder::kSetGraphicsRootDescriptorTable:
+            {
+                vector<uint64_t>& Table = State.RootParams[Args[0]];
+                Table.clear();
+                const uint32_t TableSize = Args[0] == kRootMaterialSRVs ? kMaterialTableSize : kExtraTableSize;
+                for (uint32_t i = 0; i < TableSize; ++i)
+                    Table.push_back(Recorder.GetHeapDescriptor(Args[1] + i));
+                break;
+            }
+
+            case CommandRecorder::kResourceBarrier:
+                for (uint32_t i = 0; i < Args[0]; ++i)
+                {
+                    const uint32_t* B = Args + 1 + i * 5;
+                    RecordedBarrier Barrier = { B[0] & 0xFF, B[0] >> 8, B[1] | (uint64_t)B[2] << 32, B[3], B[4] };
+                    Barriers.push_back(Barrier);
+                }
+                break;
+
+            case CommandRecorder::kDrawIndexedInstanced:
+            {
+                DrawWords Draw(Args, Args + Cmd.NumArgs);
+                for (const auto& Words : State.Words)
+                {
+                    Draw.push_back(Words.first);
+                    Draw.insert(Draw.end(), Words.second.begin(), Words.second.end());
+                }
+                for (uint32_t i = 0; i < kRootCount; ++i)
+                {
+                    Draw.push_back(~0ull);
+                    Draw.insert(Draw.end(), State.RootParams[i].begin(), State.RootParams[i].end());
+                }
+                Draws.push_back(Draw);
+                break;
+            }
+
+            case CommandRecorder::kSetDescriptorHeap:
+                break;
+
+            default:
+                // The pipeline, render targets, viewport, scissor, topology, and buffers are bound by value
+                State.Words[Cmd.Op].assign(Args, Args + Cmd.NumArgs);
+                break;
+            }
+        }
+    }
+
+    // The pass recorded on one recorder, and on forked workers replayed in submission order, draws the same
+    // things with the same bound state after the same barriers
+    void TestParallelRecordingMatchesSerial( void )
+    {
+        const CommandRecorder::RootLayout Layout = MakeModelRootLayout();
+        const uint32_t NumDraws = CountModelDraws();
+
+        CommandRecorder Serial;
+        CommandRecorder::Resource SerialTarget(10, kPixelShaderResource);
+        BeginModelPass(Serial, Layout, SerialTarget);
+        RecordModelSlice(Serial, 0, NumDraws);
+
+        vector<DrawWords> SerialDraws;
+        vector<RecordedBarrier> SerialBarriers;
+        Replay(Serial, SerialDraws, SerialBarriers);
+        CHECK_EQUAL(SerialDraws.size(), (size_t)NumDraws);
+        CHECK_EQUAL(SerialBarriers.size(), 1u);
+        // Every table must still be in the first heap for the replay to read it back
+        CHECK_EQUAL(Serial.GetCounters().DescriptorHeapChanges, 1u);
+
+        g_JobScheduler.Initialize(4);
+
+        const uint32_t kMaxWorkers = 5;
+        for (uint32_t NumWorkers = 1; NumWorkers <= kMaxWorkers; ++NumWorkers)
+        {
+            CommandRecorder Parent;
+            CommandRecorder::Resource Target(10, kPixelShaderResource);
+            BeginModelPass(Parent, Layout, Target);
+
+            CommandRecorder WorkerRecorders[kMaxWorkers];
+            CommandRecorder* Workers[kMaxWorkers];
+            for (uint32_t i = 0; i < NumWorkers; ++i)
+                Workers[i] = &WorkerRecorders[i];
+            Parent.ForkWorkers(NumWorkers, Workers);
+
+            // Slices split instances part way through, as they do in ModelViewer::RenderObjects
+            g_JobScheduler.ParallelFor(0, NumWorkers, [&](uint32_t i)
+            {
+                RecordModelSlice(*Workers[i], (uint32_t)((uint64_t)NumDraws * i / NumWorkers),
+                    (uint32_t)((uint64_t)NumDraws * (i + 1) / NumWorkers));
+            });
+
+            vector<DrawWords> ParallelDraws;
+            vector<RecordedBarrier> ParallelBarriers;
+            Replay(Parent, ParallelDraws, ParallelBarriers);
+            CHECK(ParallelDraws.empty());
+            CHECK_EQUAL(ParallelBarriers.size(), 1u);
+
+            for (uint32_t i = 0; i < NumWorkers; ++i)
+            {
+                Replay(*Workers[i], ParallelDraws, ParallelBarriers);
+                CHECK_EQUAL(Workers[i]->GetCounters().DescriptorHeapChanges, 1u);
+                CHECK_EQUAL(Workers[i]->GetCounters().Barriers, 0u);
+            }
+
+            CHECK_EQUAL(ParallelDraws.size(), SerialDraws.size());
+            CHECK(ParallelDraws == SerialDraws);
+            CHECK(ParallelBarriers.size() == 1 && ParallelBarriers[0].After == SerialBarriers[0].After);
+            CHECK_EQUAL(Target.UsageState, kRenderTarget);
+        }
+
+        g_JobScheduler.Shutdown();
+    }
+
+    // A worker forked from a recorder with nothing bound starts empty, whatever it recorded before
+    void TestForkEmptyState( void )
+    {
+        CommandRecorder Parent, Worker;
+        CommandRecorder* Workers[1] = { &Worker };
+        Worker.SetPipelineState(3);
+        Parent.ForkWorkers(1, Workers);
+
+        CHECK_EQUAL(Worker.GetStreamBytes(), 0u);
+        CHECK_EQUAL(Worker.GetCounters().Commands, 0u);
+    }
+}
+
+int main( void )
+{
+    RUN_TEST(TestRedundantTransition);
+    RUN_TEST(TestMergedTransitions);
+    RUN_TEST(TestUAVBarrierBlocksMerge);
+    RUN_TEST(TestSplitTransitions);
+    RUN_TEST(TestSplitTransitionBack);
+    RUN_TEST(TestDescriptorTables);
+    RUN_TEST(TestDescriptorHeapRollover);
+    RUN_TEST(TestReset);
+    RUN_TEST(TestParallelRecordingMatchesSerial);
+    RUN_TEST(TestForkEmptyState);
+    return UnitTest::Report();
+}
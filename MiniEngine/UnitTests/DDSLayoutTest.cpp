@@ -0,0 +1,245 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  ParseDDSLayout and the mip skipping built on it, checked against DDS images assembled in
+// memory with hand-computed subresource sizes.
+//
+
+#include "UnitTest.h"
+#include "DDSLayout.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+    const size_t kHeaderSize = sizeof(uint32_t) + sizeof(DDS_HEADER);
+    const size_t kHeaderSizeDX10 = kHeaderSize + sizeof(DDS_HEADER_DXT10);
+
+    // The magic number and headers followed by DataSize bytes of texels.  Pass a DX10 header to use the
+    // DX10 extension, otherwise PixelFormat describes a legacy format.
+    std::vector<uint8_t> MakeDDS( uint32_t Width, uint32_t Height, uint32_t Depth, uint32_t MipCount,
+        const DDS_PIXELFORMAT& PixelFormat, const DDS_HEADER_DXT10* DX10, size_t DataSize )
+    {
+        DDS_HEADER Header;
+        memset(&Header, 0, sizeof(Header));
+        Header.size = sizeof(DDS_HEADER);
+        Header.flags = DDS_HEADER_FLAGS_TEXTURE | (MipCount > 1 ? DDS_HEADER_FLAGS_MIPMAP : 0) |
+            (Depth > 1 ? DDS_HEADER_FLAGS_VOLUME : 0);
+        Header.width = Width;
+        Header.height = Height;
+        Header.depth = Depth;
+        Header.mipMapCount = MipCount;
+        Header.ddspf = PixelFormat;
+        Header.caps = DDS_SURFACE_FLAGS_TEXTURE;
+
+        std::vector<uint8_t> Image(kHeaderSize + (DX10 != nullptr ? sizeof(DDS_HEADER_DXT10) : 0) + DataSize, 0);
+        memcpy(Image.data(), &DDS_MAGIC, sizeof(uint32_t));
+        memcpy(Image.data() + sizeof(uint32_t), &Header, sizeof(Header));
+        if (DX10 != nullptr)
+            memcpy(Image.data() + kHeaderSize, DX10, sizeof(DDS_HEADER_DXT10));
+        return Image;
+    }
+
+    DDS_HEADER_DXT10 MakeDX10( DXGI_FORMAT Format, uint32_t Dimension, uint32_t ArraySize, uint32_t MiscFlag = 0,
+        uint32_t MiscFlags2 = 0 )
+    {
+        DDS_HEADER_DXT10 DX10 = { Format, Dimension, MiscFlag, ArraySize, MiscFlags2 };
+        return DX10;
+    }
+
+    DDS_HEADER* GetHeader( std::vector<uint8_t>& Image )
+    {
+        return reinterpret_cast<DDS_HEADER*>(Image.data() + sizeof(uint32_t));
+    }
+}
+
+// 256 x 128 BC1 with a full chain:  8 bytes per 4 x 4 block, and at least one block per mip
+static void TestBlockCompressedMipChain( void )
+{
+    const uint32_t kMipBytes[9] = { 16384, 4096, 1024, 256, 64, 16, 8, 8, 8 };
+    const uint32_t kMipRowPitch[9] = { 512, 256, 128, 64, 32, 16, 8, 8, 8 };
+    size_t TotalBytes = 0;
+    for (uint32_t Bytes : kMipBytes)
+        TotalBytes += Bytes;
+
+    std::vector<uint8_t> Image = MakeDDS(256, 128, 1, 9, DDSPF_DXT1, nullptr, TotalBytes);
+
+    DDSTextureLayout Layout;
+    CHECK_EQUAL(ParseDDSLayout(Image.data(), Image.size(), Layout), S_OK);
+    CHECK_EQUAL(Layout.Dimension, D3D12_RESOURCE_DIMENSION_TEXTURE2D);
+    CHECK_EQUAL(Layout.Format, DXGI_FORMAT_BC1_UNORM);
+    CHECK_EQUAL(Layout.MipCount, 9u);
+    CHECK_EQUAL(Layout.ArraySize, 1u);
+    CHECK(!Layout.IsCubeMap);
+    CHECK_EQUAL(Layout.Subresources.size(), (size_t)9);
+
+    uint32_t Offset = (uint32_t)kHeaderSize;
+    for (uint32_t Mip = 0; Mip < 9; ++Mip)
+    {
+        const DDSSubresourceLayout& Sub = Layout.GetSubresource(0, Mip);
+        CHECK_EQUAL(Sub.Offset, Offset);
+        CHECK_EQUAL(Sub.SlicePitch, kMipBytes[Mip]);
+        CHECK_EQUAL(Sub.RowPitch, kMipRowPitch[Mip]);
+        CHECK_EQUAL(Sub.Width, std::max(256u >> Mip, 1u));
+        CHECK_EQUAL(Sub.Height, std::max(128u >> Mip, 1u));
+        CHECK_EQUAL(Sub.Depth, 1u);
+        Offset += kMipBytes[Mip];
+    }
+
+    CHECK_EQUAL(Layout.GetDataSize(), TotalBytes);
+    CHECK_EQUAL(Layout.GetDataSize(2), TotalBytes - 16384 - 4096);
+}
+
+static void TestComputeSkipMips( void )
+{
+    std::vector<uint8_t> Image = MakeDDS(256, 128, 1, 9, DDSPF_DXT1, nullptr, 21864);
+
+    DDSTextureLayout Layout;
+    CHECK_EQUAL(ParseDDSLayout(Image.data(), Image.size(), Layout), S_OK);
+    CHECK_EQUAL(Layout.ComputeSkipMips(0), 0u);         // No limit
+    CHECK_EQUAL(Layout.ComputeSkipMips(4096), 0u);
+    CHECK_EQUAL(Layout.ComputeSkipMips(256), 0u);
+    CHECK_EQUAL(Layout.ComputeSkipMips(255), 1u);
+    CHECK_EQUAL(Layout.ComputeSkipMips(64), 2u);        // Either dimension over the limit counts
+    CHECK_EQUAL(Layout.ComputeSkipMips(1), 8u);
+
+    // A single mip is never skipped
+    std::vector<uint8_t> Single = MakeDDS(256, 128, 1, 1, DDSPF_DXT1, nullptr, 16384);
+    CHECK_EQUAL(ParseDDSLayout(Single.data(), Single.size(), Layout), S_OK);
+    CHECK_EQUAL(Layout.ComputeSkipMips(64), 0u);
+}
+
+// Subresources are ordered by array item, then mip
+static void TestCubeMapOrder( void )
+{
+    const uint32_t kItemBytes = 16 * 16 * 4 + 8 * 8 * 4;
+    DDS_HEADER_DXT10 DX10 = MakeDX10(DXGI_FORMAT_R8G8B8A8_UNORM, DDS_DIMENSION_TEXTURE2D, 1, DDS_RESOURCE_MISC_TEXTURECUBE);
+    std::vector<uint8_t> Image = MakeDDS(16, 16, 1, 2, DDSPF_DX10, &DX10, 6 * kItemBytes);
+
+    DDSTextureLayout Layout;
+    CHECK_EQUAL(ParseDDSLayout(Image.data(), Image.size(), Layout), S_OK);
+    CHECK(Layout.IsCubeMap);
+    CHECK_EQUAL(Layout.ArraySize, 6u);
+    CHECK_EQUAL(Layout.MipCount, 2u);
+    CHECK_EQUAL(Layout.Subresources.size(), (size_t)12);
+
+    for (uint32_t Item = 0; Item < 6; ++Item)
+    {
+        CHECK_EQUAL(Layout.GetSubresource(Item, 0).Offset, kHeaderSizeDX10 + Item * kItemBytes);
+        CHECK_EQUAL(Layout.GetSubresource(Item, 1).Offset, kHeaderSizeDX10 + Item * kItemBytes + 16 * 16 * 4);
+        CHECK_EQUAL(Layout.GetSubresource(Item, 1).RowPitch, 8u * 4u);
+    }
+
+    // Dropping the top mip keeps one subresource per face, each pointing into the image
+    D3D12_SUBRESOURCE_DATA InitData[6];
+    FillDDSSubresourceData(Layout, Image.data(), 1, InitData);
+    for (uint32_t Item = 0; Item < 6; ++Item)
+    {
+        CHECK(InitData[Item].pData == Image.data() + Layout.GetSubresource(Item, 1).Offset);
+        CHECK_EQUAL(InitData[Item].SlicePitch, 8 * 8 * 4);
+    }
+    CHECK_EQUAL(Layout.GetDataSize(1), (size_t)6 * 8 * 8 * 4);
+}
+
+// Every mip of a volume holds all of its slices
+static void TestVolume( void )
+{
+    std::vector<uint8_t> Image = MakeDDS(8, 8, 4, 2, DDSPF_A8R8G8B8, nullptr, 8 * 8 * 4 * 4 + 4 * 4 * 4 * 2);
+
+    DDSTextureLayout Layout;
+    CHECK_EQUAL(ParseDDSLayout(Image.data(), Image.size(), Layout), S_OK);
+    CHECK_EQUAL(Layout.Dimension, D3D12_RESOURCE_DIMENSION_TEXTURE3D);
+    CHECK_EQUAL(Layout.Format, DXGI_FORMAT_B8G8R8A8_UNORM);
+    CHECK_EQUAL(Layout.Depth, 4u);
+
+    const DDSSubresourceLayout& Mip1 = Layout.GetSubresource(0, 1);
+    CHECK_EQUAL(Mip1.Offset, kHeaderSize + 8 * 8 * 4 * 4);
+    CHECK_EQUAL(Mip1.SlicePitch, 4u * 4u * 4u);
+    CHECK_EQUAL(Mip1.Depth, 2u);
+    CHECK_EQUAL(Layout.GetDataSize(), Image.size() - kHeaderSize);
+}
+
+static void TestAlphaMode( void )
+{
+    DDS_HEADER_DXT10 DX10 = MakeDX10(DXGI_FORMAT_BC3_UNORM, DDS_DIMENSION_TEXTURE2D, 1, 0, DDS_ALPHA_MODE_PREMULTIPLIED);
+    std::vector<uint8_t> Image = MakeDDS(4, 4, 1, 1, DDSPF_DX10, &DX10, 16);
+
+    DDSTextureLayout Layout;
+    CHECK_EQUAL(ParseDDSLayout(Image.data(), Image.size(), Layout), S_OK);
+    CHECK_EQUAL(Layout.AlphaMode, DDS_ALPHA_MODE_PREMULTIPLIED);
+
+    std::vector<uint8_t> Legacy = MakeDDS(4, 4, 1, 1, DDSPF_DXT2, nullptr, 16);
+    CHECK_EQUAL(ParseDDSLayout(Legacy.data(), Legacy.size(), Layout), S_OK);
+    CHECK_EQUAL(Layout.AlphaMode, DDS_ALPHA_MODE_PREMULTIPLIED);
+
+    std::vector<uint8_t> Straight = MakeDDS(4, 4, 1, 1, DDSPF_DXT5, nullptr, 16);
+    CHECK_EQUAL(ParseDDSLayout(Straight.data(), Straight.size(), Layout), S_OK);
+    CHECK_EQUAL(Layout.AlphaMode, DDS_ALPHA_MODE_UNKNOWN);
+}
+
+static void TestRejectsBadImages( void )
+{
+    DDSTextureLayout Layout;
+
+    // Too short for the last mip
+    std::vector<uint8_t> Truncated = MakeDDS(256, 128, 1, 9, DDSPF_DXT1, nullptr, 21863);
+    CHECK_EQUAL(ParseDDSLayout(Truncated.data(), Truncated.size(), Layout), HRESULT_FROM_WIN32(ERROR_HANDLE_EOF));
+    CHECK(Layout.Subresources.empty());
+
+    // Too short for the headers
+    std::vector<uint8_t> Image = MakeDDS(4, 4, 1, 1, DDSPF_DXT1, nullptr, 8);
+    CHECK_EQUAL(ParseDDSLayout(Image.data(), kHeaderSize - 1, Layout), E_FAIL);
+    CHECK_EQUAL(ParseDDSLayout(nullptr, Image.size(), Layout), E_INVALIDARG);
+
+    std::vector<uint8_t> BadMagic = Image;
+    BadMagic[0] = 'X';
+    CHECK_EQUAL(ParseDDSLayout(BadMagic.data(), BadMagic.size(), Layout), E_FAIL);
+
+    std::vector<uint8_t> BadSize = Image;
+    GetHeader(BadSize)->size = 120;
+    CHECK_EQUAL(ParseDDSLayout(BadSize.data(), BadSize.size(), Layout), E_FAIL);
+
+    std::vector<uint8_t> TooManyMips = Image;
+    GetHeader(TooManyMips)->mipMapCount = D3D12_REQ_MIP_LEVELS + 1;
+    CHECK_EQUAL(ParseDDSLayout(TooManyMips.data(), TooManyMips.size(), Layout), HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED));
+
+    // A DX10 header that is cut off
+    DDS_HEADER_DXT10 DX10 = MakeDX10(DXGI_FORMAT_R8G8B8A8_UNORM, DDS_DIMENSION_TEXTURE2D, 1);
+    std::vector<uint8_t> ShortDX10 = MakeDDS(1, 1, 1, 1, DDSPF_DX10, &DX10, 0);
+    CHECK_EQUAL(ParseDDSLayout(ShortDX10.data(), kHeaderSize + 4, Layout), E_FAIL);
+
+    DDS_HEADER_DXT10 NoItems = MakeDX10(DXGI_FORMAT_R8G8B8A8_UNORM, DDS_DIMENSION_TEXTURE2D, 0);
+    std::vector<uint8_t> EmptyArray = MakeDDS(1, 1, 1, 1, DDSPF_DX10, &NoItems, 4);
+    CHECK_EQUAL(ParseDDSLayout(EmptyArray.data(), EmptyArray.size(), Layout), HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+
+    DDS_HEADER_DXT10 Palette = MakeDX10(DXGI_FORMAT_P8, DDS_DIMENSION_TEXTURE2D, 1);
+    std::vector<uint8_t> Paletted = MakeDDS(1, 1, 1, 1, DDSPF_DX10, &Palette, 4);
+    CHECK_EQUAL(ParseDDSLayout(Paletted.data(), Paletted.size(), Layout), HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED));
+
+    // Volumes must say so in the header flags
+    DDS_HEADER_DXT10 Volume = MakeDX10(DXGI_FORMAT_R8G8B8A8_UNORM, DDS_DIMENSION_TEXTURE3D, 1);
+    std::vector<uint8_t> FlatVolume = MakeDDS(1, 1, 1, 1, DDSPF_DX10, &Volume, 4);
+    CHECK_EQUAL(ParseDDSLayout(FlatVolume.data(), FlatVolume.size(), Layout), HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+
+    std::vector<uint8_t> TooWide = MakeDDS(D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION * 2, 4, 1, 1, DDSPF_DXT1, nullptr, 0);
+    CHECK_EQUAL(ParseDDSLayout(TooWide.data(), TooWide.size(), Layout), HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED));
+}
+
+int main( void )
+{
+    RUN_TEST(TestBlockCompressedMipChain);
+    RUN_TEST(TestComputeSkipMips);
+    RUN_TEST(TestCubeMapOrder);
+    RUN_TEST(TestVolume);
+    RUN_TEST(TestAlphaMode);
+    RUN_TEST(TestRejectsBadImages);
+    return UnitTest::Report();
+}
@@ -0,0 +1,309 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of the CPU depth pyramid:  every level against a brute-force maximum over the depth
+// image, the occlusion test against a hand-made wall and against the depth image itself, levels copied in
+// as they are from the GPU read back, and the widened test for a read back that is a few frames old.
+//
+
+#include "UnitTest.h"
+#include "DepthPyramid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Math::Matrix4 layout.  The view looks down +z and clip w is the view depth.
+    void MakePerspective( float* M, float FovY, float Aspect, float NearClip, float FarClip )
+    {
+        memset(M, 0, 16 * sizeof(float));
+        const float ScaleY = 1.0f / tanf(FovY * 0.5f);
+        M[0] = ScaleY / Aspect;
+        M[5] = ScaleY;
+        M[10] = NearClip / (FarClip - NearClip);
+        M[11] = 1.0f;
+        M[14] = NearClip * FarClip / (FarClip - NearClip);
+    }
+
+    // The view moved by X along the x axis
+    void MakeTranslatedPerspective( float* M, float X )
+    {
+        MakePerspective(M, 1.0f, 2.0f, 1.0f, 100.0f);
+        for (int r = 0; r < 4; ++r)
+            M[12 + r] -= M[r] * X;
+    }
+
+    const float kInvFarClip = 0.01f;
+
+    void TestBuild( void )
+    {
+        const uint32_t W = 200, H = 120;
+        vector<float> Depth(W * H);
+        srand(49);
+        for (float& D : Depth)
+            D = (float)rand() / (float)RAND_MAX;
+
+        DepthPyramid P;
+        P.Build(Depth.data(), W, H, W);
+        CHECK_EQUAL(P.GetWidth(0), 128u);
+        CHECK_EQUAL(P.GetHeight(0), 64u);
+        CHECK_EQUAL(P.GetLevelCount(), 8u);
+        CHECK(P.GetWidth(7) == 1 && P.GetHeight(7) == 1);
+
+        // Every texel is the farthest depth texel overlapping its UV range
+        uint32_t Mismatches = 0;
+        for (uint32_t L = 0; L < P.GetLevelCount(); ++L)
+        {
+            for (uint32_t y = 0; y < P.GetHeight(L); ++y)
+            {
+                for (uint32_t x = 0; x < P.GetWidth(L); ++x)
+                {
+                    const float U0 = x / (float)P.GetWidth(L), U1 = (x + 1) / (float)P.GetWidth(L);
+                    const float V0 = y / (float)P.GetHeight(L), V1 = (y + 1) / (float)P.GetHeight(L);
+
+                    float Expected = 0.0f;
+                    for (uint32_t Row = 0; Row < H; ++Row)
+                    {
+                        for (uint32_t Column = 0; Column < W; ++Column)
+                        {
+                            const float CU0 = Column / (float)W, CU1 = (Column + 1) / (float)W;
+                            const float CV0 = Row / (float)H, CV1 = (Row + 1) / (float)H;
+                            if (CU1 > U0 + 1e-7f && CU0 < U1 - 1e-7f && CV1 > V0 + 1e-7f && CV0 < V1 - 1e-7f)
+                                Expected = max(Expected, Depth[Row * W + Column]);
+                        }
+                    }
+                    if (Expected != P.GetLevelData(L)[y * P.GetWidth(L) + x])
+                        ++Mismatches;
+                }
+            }
+        }
+        CHECK_EQUAL(Mismatches, 0u);
+    }
+
+    void TestSizes( void )
+    {
+        CHECK_EQUAL(DepthPyramid::GetLevelCount(1024, 512), 11u);
+        CHECK_EQUAL(DepthPyramid::GetLevelCount(1, 1), 1u);
+
+        uint32_t BaseWidth, BaseHeight;
+        DepthPyramid::GetBaseSize(3840, 2160, BaseWidth, BaseHeight);
+        CHECK(BaseWidth == 1024 && BaseHeight == 1024);
+        DepthPyramid::GetBaseSize(1280, 720, BaseWidth, BaseHeight);
+        CHECK(BaseWidth == 1024 && BaseHeight == 512);
+    }
+
+    // A wall at depth 10 covering the left half of a 256 x 128 screen, with the far plane behind the right
+    void BuildWall( DepthPyramid& P )
+    {
+        const uint32_t W = 256, H = 128;
+        vector<float> Scene(W * H);
+        for (uint32_t Row = 0; Row < H; ++Row)
+            for (uint32_t Column = 0; Column < W; ++Column)
+                Scene[Row * W + Column] = Column < W / 2 ? 0.1f : 1.0f;
+        P.Build(Scene.data(), W, H, W);
+    }
+
+    void TestOcclusion( void )
+    {
+        DepthPyramid P;
+        BuildWall(P);
+        float M[16];
+        MakePerspective(M, 1.0f, 2.0f, 1.0f, 100.0f);
+
+        const float Behind[2][3] = { { -8.0f, -1.0f, 20.0f }, { -4.0f, 1.0f, 22.0f } };
+        CHECK(P.IsOccluded(M, Behind[0], Behind[1], kInvFarClip));
+
+        const float InFront[2][3] = { { -2.0f, -1.0f, 5.0f }, { -1.0f, 1.0f, 6.0f } };
+        CHECK(!P.IsOccluded(M, InFront[0], InFront[1], kInvFarClip));
+
+        const float Straddling[2][3] = { { -8.0f, -1.0f, 20.0f }, { 4.0f, 1.0f, 22.0f } };
+        CHECK(!P.IsOccluded(M, Straddling[0], Straddling[1], kInvFarClip));
+
+        const float Open[2][3] = { { 4.0f, -1.0f, 20.0f }, { 8.0f, 1.0f, 22.0f } };
+        CHECK(!P.IsOccluded(M, Open[0], Open[1], kInvFarClip));
+
+        const float BehindEye[2][3] = { { -8.0f, -1.0f, -5.0f }, { -4.0f, 1.0f, 22.0f } };
+        CHECK(!P.IsOccluded(M, BehindEye[0], BehindEye[1], kInvFarClip));
+
+        // Covers the whole wall, so it is tested at a coarse level
+        const float Large[2][3] = { { -400.0f, -150.0f, 60.0f }, { -2.0f, 150.0f, 70.0f } };
+        CHECK(P.IsOccluded(M, Large[0], Large[1], kInvFarClip));
+
+        // Just behind the wall, so only occluded without a bias
+        const float Close[2][3] = { { -8.0f, -1.0f, 10.5f }, { -4.0f, 1.0f, 12.0f } };
+        CHECK(P.IsOccluded(M, Close[0], Close[1], kInvFarClip));
+        CHECK(!P.IsOccluded(M, Close[0], Close[1], kInvFarClip, 0.01f));
+
+        DepthPyramid Empty;
+        CHECK(!Empty.IsOccluded(M, Behind[0], Behind[1], kInvFarClip));
+    }
+
+    // The read back only holds the coarse levels
+    void TestReadbackLevels( void )
+    {
+        DepthPyramid P;
+        BuildWall(P);
+
+        DepthPyramid Q;
+        Q.Reset(P.GetWidth(3), P.GetHeight(3), P.GetLevelCount() - 3);
+        CHECK_EQUAL(Q.GetLevelCount(), P.GetLevelCount() - 3);
+        for (uint32_t L = 0; L < Q.GetLevelCount(); ++L)
+            memcpy(Q.GetLevelData(L), P.GetLevelData(L + 3), Q.GetWidth(L) * Q.GetHeight(L) * sizeof(float));
+
+        float M[16];
+        MakePerspective(M, 1.0f, 2.0f, 1.0f, 100.0f);
+        const float Behind[2][3] = { { -8.0f, -1.0f, 20.0f }, { -4.0f, 1.0f, 22.0f } };
+        const float Straddling[2][3] = { { -8.0f, -1.0f, 20.0f }, { 4.0f, 1.0f, 22.0f } };
+        CHECK(Q.IsOccluded(M, Behind[0], Behind[1], kInvFarClip));
+        CHECK(!Q.IsOccluded(M, Straddling[0], Straddling[1], kInvFarClip));
+
+        Q.Clear();
+        CHECK(Q.IsEmpty());
+        CHECK(!Q.IsOccluded(M, Behind[0], Behind[1], kInvFarClip));
+    }
+
+    // Whatever IsOccluded culls is behind every depth texel under its screen rectangle
+    void TestOcclusionIsConservative( void )
+    {
+        const uint32_t W = 256, H = 128;
+        vector<float> Depth(W * H);
+        srand(7);
+
+        // A few random rectangles of near depth over the far plane
+        fill(Depth.begin(), Depth.end(), 1.0f);
+        for (int i = 0; i < 12; ++i)
+        {
+            const uint32_t X0 = rand() % W, Y0 = rand() % H;
+            const uint32_t X1 = min(W, X0 + 8 + rand() % 96), Y1 = min(H, Y0 + 8 + rand() % 64);
+            const float D = 0.05f + 0.3f * (float)rand() / (float)RAND_MAX;
+            for (uint32_t y = Y0; y < Y1; ++y)
+                for (uint32_t x = X0; x < X1; ++x)
+                    Depth[y * W + x] = min(Depth[y * W + x], D);
+        }
+
+        DepthPyramid P;
+        P.Build(Depth.data(), W, H, W);
+        float M[16];
+        MakePerspective(M, 1.0f, 2.0f, 1.0f, 100.0f);
+
+        uint32_t Occluded = 0, Wrong = 0;
+        for (int i = 0; i < 4000; ++i)
+        {
+            const float Z = 5.0f + 90.0f * (float)rand() / (float)RAND_MAX;
+            float BoxMin[3] = { Z * (-1.0f + 2.0f * (float)rand() / (float)RAND_MAX), Z * (-0.5f + (float)rand() / (float)RAND_MAX), Z };
+            const float Size = 0.02f * Z * (1.0f + 10.0f * (float)rand() / (float)RAND_MAX);
+            float BoxMax[3] = { BoxMin[0] + Size, BoxMin[1] + Size, Z + Size };
+
+            if (!P.IsOccluded(M, BoxMin, BoxMax, kInvFarClip))
+                continue;
+            ++Occluded;
+
+            // The box's rectangle on the depth image, from its corners
+            float MinU = 1.0f, MaxU = 0.0f, MinV = 1.0f, MaxV = 0.0f;
+            for (int Corner = 0; Corner < 8; ++Corner)
+            {
+                const float X = Corner & 1 ? BoxMax[0] : BoxMin[0];
+                const float Y = Corner & 2 ? BoxMax[1] : BoxMin[1];
+                const float Wc = Corner & 4 ? BoxMax[2] : BoxMin[2];
+                const float U = 0.5f + 0.5f * X * M[0] / Wc, V = 0.5f - 0.5f * Y * M[5] / Wc;
+                MinU = min(MinU, U); MaxU = max(MaxU, U);
+                MinV = min(MinV, V); MaxV = max(MaxV, V);
+            }
+
+            const uint32_t X0 = (uint32_t)max(0.0f, MinU * W), X1 = (uint32_t)min((float)W - 1.0f, MaxU * W);
+            const uint32_t Y0 = (uint32_t)max(0.0f, MinV * H), Y1 = (uint32_t)min((float)H - 1.0f, MaxV * H);
+            for (uint32_t y = Y0; y <= Y1; ++y)
+                for (uint32_t x = X0; x <= X1; ++x)
+                    Wrong += Depth[y * W + x] >= Z * kInvFarClip ? 1 : 0;
+        }
+
+        CHECK(Occluded > 0);
+        CHECK_EQUAL(Wrong, 0u);
+    }
+
+    void TestReprojected( void )
+    {
+        DepthPyramid P;
+        BuildWall(P);
+        float Then[16], Now[16];
+        MakePerspective(Then, 1.0f, 2.0f, 1.0f, 100.0f);
+
+        // With an unmoved camera and no margin it is the plain test
+        const float Behind[2][3] = { { -8.0f, -1.0f, 20.0f }, { -4.0f, 1.0f, 22.0f } };
+        const float Close[2][3] = { { -3.0f, -1.0f, 20.0f }, { -2.0f, 1.0f, 22.0f } };
+        CHECK(P.IsOccludedReprojected(Then, Then, Behind[0], Behind[1], kInvFarClip, 0.0f, 0.0f));
+        CHECK(P.IsOccludedReprojected(Then, Then, Close[0], Close[1], kInvFarClip, 0.0f, 0.0f));
+
+        // The box near the wall's edge is uncovered by a margin, the one far from it is not
+        CHECK(!P.IsOccludedReprojected(Then, Then, Close[0], Close[1], kInvFarClip, 0.0f, 16.0f));
+        CHECK(P.IsOccludedReprojected(Then, Then, Behind[0], Behind[1], kInvFarClip, 0.0f, 16.0f));
+
+        // The camera has since moved left, so the box is now on screen where the wall's old depth no longer
+        // covers:  the plain test against the old depth still culls it
+        MakeTranslatedPerspective(Now, -30.0f);
+        CHECK(P.IsOccluded(Then, Behind[0], Behind[1], kInvFarClip));
+        CHECK(!P.IsOccludedReprojected(Then, Now, Behind[0], Behind[1], kInvFarClip, 0.0f, 0.0f));
+
+        // A box behind the new eye is never culled
+        MakeTranslatedPerspective(Now, 0.0f);
+        for (int r = 0; r < 4; ++r)
+            Now[8 + r] = -Now[8 + r];
+        CHECK(!P.IsOccludedReprojected(Then, Now, Behind[0], Behind[1], kInvFarClip, 0.0f, 0.0f));
+
+        DepthPyramid Empty;
+        CHECK(!Empty.IsOccludedReprojected(Then, Then, Behind[0], Behind[1], kInvFarClip, 0.0f, 0.0f));
+    }
+
+    // Widening only ever turns occluded boxes into visible ones
+    void TestReprojectedIsWider( void )
+    {
+        DepthPyramid P;
+        BuildWall(P);
+        float Then[16], Now[16];
+        MakePerspective(Then, 1.0f, 2.0f, 1.0f, 100.0f);
+        MakeTranslatedPerspective(Now, 2.0f);
+
+        srand(11);
+        uint32_t Plain = 0, Reprojected = 0, Widened = 0;
+        for (int i = 0; i < 2000; ++i)
+        {
+            const float Z = 12.0f + 80.0f * (float)rand() / (float)RAND_MAX;
+            const float BoxMin[3] = { Z * (-1.0f + 1.2f * (float)rand() / (float)RAND_MAX), -1.0f, Z };
+            const float BoxMax[3] = { BoxMin[0] + 1.0f, 1.0f, Z + 1.0f };
+
+            const bool A = P.IsOccluded(Then, BoxMin, BoxMax, kInvFarClip);
+            const bool B = P.IsOccludedReprojected(Then, Now, BoxMin, BoxMax, kInvFarClip, 0.0f, 0.0f);
+            const bool C = P.IsOccludedReprojected(Then, Now, BoxMin, BoxMax, kInvFarClip, 0.0f, 4.0f);
+            Plain += A;
+            Reprojected += B;
+            Widened += C;
+            CHECK(!B || A);
+            CHECK(!C || B);
+        }
+        CHECK(Widened > 0);
+        CHECK(Widened < Reprojected || Reprojected < Plain);
+    }
+}
+
+int main( void )
+{
+    RUN_TEST(TestBuild);
+    RUN_TEST(TestSizes);
+    RUN_TEST(TestOcclusion);
+    RUN_TEST(TestReadbackLevels);
+    RUN_TEST(TestOcclusionIsConservative);
+    RUN_TEST(TestReprojected);
+    RUN_TEST(TestReprojectedIsWider);
+    return UnitTest::Report();
+}
@@ -0,0 +1,234 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of the descriptor range recycling behind DescriptorAllocator, with fake heaps:  ranges
+// never overlap, retired ranges wait for their fence, split ranges merge back with their buddies, and the
+// tail of a heap is not lost when the next one is added.
+//
+
+#include "UnitTest.h"
+#include "DescriptorFreeList.h"
+
+#include <cstdlib>
+#include <set>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    const uint32_t kDescriptorSize = 32;
+    const uint32_t kHeapSize = 256;
+
+    // Fake heaps are far enough apart that a range running past its heap would show up as an overlap
+    uint64_t HeapBase( uint32_t Index )
+    {
+        return 0x10000 + Index * 0x100000ull;
+    }
+
+    struct Allocator
+    {
+        DescriptorFreeList FreeList;
+        uint32_t NumHeaps;
+
+        Allocator() : NumHeaps(0) { FreeList.SetDescriptorSize(kDescriptorSize); }
+
+        // As DescriptorAllocator does, adds a heap when the free list cannot satisfy the request
+        uint64_t Allocate( uint32_t Count )
+        {
+            uint64_t Handle = FreeList.Allocate(Count);
+            if (Handle == DescriptorFreeList::kInvalidHandle)
+            {
+                FreeList.AddHeap(HeapBase(NumHeaps++), kHeapSize);
+                Handle = FreeList.Allocate(Count);
+            }
+            return Handle;
+        }
+    };
+
+    uint32_t RoundedCount( uint32_t Count )
+    {
+        return DescriptorFreeList::ClassCount(DescriptorFreeList::SizeClass(Count));
+    }
+
+    void TestSizeClasses( void )
+    {
+        CHECK_EQUAL(DescriptorFreeList::SizeClass(1), 0u);
+        CHECK_EQUAL(DescriptorFreeList::SizeClass(2), 1u);
+        CHECK_EQUAL(DescriptorFreeList::SizeClass(3), 2u);
+        CHECK_EQUAL(DescriptorFreeList::SizeClass(9), 4u);
+        CHECK_EQUAL(DescriptorFreeList::SizeClass(256), 8u);
+    }
+
+    // Random sizes allocated and freed in rounds:  no descriptor is ever handed out twice, every range
+    // stays inside its heap, and once everything is freed the heaps have merged back into whole ranges
+    void TestNoOverlap( void )
+    {
+        Allocator Alloc;
+        set<uint64_t> Live;
+        bool Overlap = false, OutOfHeap = false;
+
+        srand(1234);
+        for (uint32_t Round = 0; Round < 200; ++Round)
+        {
+            vector< pair<uint64_t, uint32_t> > Ranges;
+            for (uint32_t i = 0; i < 100; ++i)
+            {
+                uint32_t Count = 1 + rand() % 40;
+                uint64_t Handle = Alloc.Allocate(Count);
+
+                uint32_t Heap = (uint32_t)((Handle - HeapBase(0)) / 0x100000);
+                uint64_t Offset = (Handle - HeapBase(Heap)) / kDescriptorSize;
+                OutOfHeap |= Heap >= Alloc.NumHeaps || Offset + RoundedCount(Count) > kHeapSize;
+
+                for (uint32_t k = 0; k < RoundedCount(Count); ++k)
+                    Overlap |= !Live.insert(Handle + k * kDescriptorSize).second;
+                Ranges.push_back(make_pair(Handle, Count));
+            }
+
+            for (size_t i = 0; i < Ranges.size(); ++i)
+            {
+                for (uint32_t k = 0; k < RoundedCount(Ranges[i].second); ++k)
+                    Live.erase(Ranges[i].first + k * kDescriptorSize);
+                Alloc.FreeList.Free(Ranges[i].first, Ranges[i].second, Round + 1);
+            }
+            Alloc.FreeList.ReclaimRetired(Round + 1);
+        }
+
+        CHECK(!Overlap);
+        CHECK(!OutOfHeap);
+        CHECK_EQUAL(Alloc.FreeList.GetLiveDescriptors(), 0u);
+
+        // Every full heap is a single free range again.  Only the part of the current heap that was carved
+        // into aligned pieces can still be split, and that leaves at most one range per smaller class.
+        CHECK(Alloc.FreeList.GetFreeRangeCount(DescriptorFreeList::kNumSizeClasses - 1) >= Alloc.NumHeaps - 1);
+        for (uint32_t Class = 0; Class < DescriptorFreeList::kNumSizeClasses - 1; ++Class)
+            CHECK(Alloc.FreeList.GetFreeRangeCount(Class) <= 1);
+    }
+
+    // A retired range is not reused until its fence completes
+    void TestRetiredRanges( void )
+    {
+        Allocator Alloc;
+        uint64_t First = Alloc.Allocate(4);
+        Alloc.FreeList.Free(First, 4, 10);
+
+        CHECK(Alloc.FreeList.HasRetired());
+        CHECK_EQUAL(Alloc.FreeList.GetOldestRetiredFence(), 10u);
+        CHECK_EQUAL(Alloc.FreeList.GetRetiredDescriptors(), 4u);
+        CHECK(Alloc.Allocate(4) != First);
+
+        Alloc.FreeList.ReclaimRetired(9);
+        CHECK(Alloc.FreeList.HasRetired());
+
+        Alloc.FreeList.ReclaimRetired(10);
+        CHECK(!Alloc.FreeList.HasRetired());
+        CHECK_EQUAL(Alloc.FreeList.GetRetiredDescriptors(), 0u);
+        CHECK_EQUAL(Alloc.Allocate(4), First);
+    }
+
+    // A small allocation from an empty class splits a larger free range, and freeing it merges the halves
+    // back into the range it came from
+    void TestSplitAndCoalesce( void )
+    {
+        Allocator Alloc;
+        uint64_t Whole = Alloc.Allocate(256);
+        CHECK_EQUAL(Whole, HeapBase(0));
+        Alloc.FreeList.Free(Whole, 256, 0);
+        CHECK_EQUAL(Alloc.FreeList.GetFreeRangeCount(8), 1u);
+
+        uint64_t One = Alloc.Allocate(1);
+        CHECK_EQUAL(One, Whole);
+        for (uint32_t Class = 0; Class < 8; ++Class)
+            CHECK_EQUAL(Alloc.FreeList.GetFreeRangeCount(Class), 1u);
+        CHECK_EQUAL(Alloc.FreeList.GetFreeRangeCount(8), 0u);
+        CHECK_EQUAL(Alloc.FreeList.GetFreeDescriptors(), 255u);
+
+        Alloc.FreeList.Free(One, 1, 0);
+        for (uint32_t Class = 0; Class < 8; ++Class)
+            CHECK_EQUAL(Alloc.FreeList.GetFreeRangeCount(Class), 0u);
+        CHECK_EQUAL(Alloc.FreeList.GetFreeRangeCount(8), 1u);
+        CHECK_EQUAL(Alloc.Allocate(256), Whole);
+        CHECK_EQUAL(Alloc.NumHeaps, 1u);
+    }
+
+    // Ranges that are neighbours but not buddies stay apart
+    void TestNoMergeAcrossBuddies( void )
+    {
+        Allocator Alloc;
+        uint64_t A = Alloc.Allocate(1);
+        uint64_t B = Alloc.Allocate(1);
+        uint64_t C = Alloc.Allocate(1);
+        uint64_t D = Alloc.Allocate(1);
+        CHECK_EQUAL(B, A + kDescriptorSize);
+
+        // B and C are adjacent, but B's buddy is A and C's is D
+        Alloc.FreeList.Free(B, 1, 0);
+        Alloc.FreeList.Free(C, 1, 0);
+        CHECK_EQUAL(Alloc.FreeList.GetFreeRangeCount(0), 2u);
+        CHECK_EQUAL(Alloc.FreeList.GetFreeRangeCount(1), 0u);
+
+        Alloc.FreeList.Free(A, 1, 0);
+        CHECK_EQUAL(Alloc.FreeList.GetFreeRangeCount(0), 1u);
+        CHECK_EQUAL(Alloc.FreeList.GetFreeRangeCount(1), 1u);
+
+        Alloc.FreeList.Free(D, 1, 0);
+        CHECK_EQUAL(Alloc.FreeList.GetFreeRangeCount(0), 0u);
+        CHECK_EQUAL(Alloc.FreeList.GetFreeRangeCount(1), 0u);
+        CHECK_EQUAL(Alloc.FreeList.GetFreeRangeCount(2), 1u);
+    }
+
+    // Allocations are aligned to their size, and the padding and the old heap's tail are reused
+    void TestHeapTail( void )
+    {
+        Allocator Alloc;
+        uint64_t One = Alloc.Allocate(1);
+        uint64_t Four = Alloc.Allocate(4);
+        CHECK_EQUAL(One, HeapBase(0));
+        CHECK_EQUAL(Four, HeapBase(0) + 4 * kDescriptorSize);
+
+        // The padding between them is reusable
+        CHECK_EQUAL(Alloc.FreeList.GetFreeDescriptors(), 3u);
+        CHECK_EQUAL(Alloc.Allocate(2), HeapBase(0) + 2 * kDescriptorSize);
+        CHECK_EQUAL(Alloc.Allocate(1), HeapBase(0) + 1 * kDescriptorSize);
+
+        // 8 used, so a whole heap needs a new one and the other 248 go to the free lists
+        uint64_t Whole = Alloc.Allocate(256);
+        CHECK_EQUAL(Whole, HeapBase(1));
+        CHECK_EQUAL(Alloc.FreeList.GetHeapCount(), 2u);
+        CHECK_EQUAL(Alloc.FreeList.GetFreeDescriptors(), 248u);
+        CHECK_EQUAL(Alloc.Allocate(128), HeapBase(0) + 128 * kDescriptorSize);
+        CHECK_EQUAL(Alloc.NumHeaps, 2u);
+    }
+
+    void TestReset( void )
+    {
+        Allocator Alloc;
+        Alloc.Allocate(8);
+        Alloc.FreeList.Free(Alloc.Allocate(8), 8, 5);
+        Alloc.FreeList.Reset();
+
+        CHECK_EQUAL(Alloc.FreeList.GetHeapCount(), 0u);
+        CHECK_EQUAL(Alloc.FreeList.GetLiveDescriptors(), 0u);
+        CHECK_EQUAL(Alloc.FreeList.GetFreeDescriptors(), 0u);
+        CHECK(!Alloc.FreeList.HasRetired());
+        CHECK_EQUAL(Alloc.FreeList.Allocate(1), DescriptorFreeList::kInvalidHandle);
+    }
+}
+
+int main( void )
+{
+    RUN_TEST(TestSizeClasses);
+    RUN_TEST(TestNoOverlap);
+    RUN_TEST(TestRetiredRanges);
+    RUN_TEST(TestSplitAndCoalesce);
+    RUN_TEST(TestNoMergeAcrossBuddies);
+    RUN_TEST(TestHeapTail);
+    RUN_TEST(TestReset);
+    return UnitTest::Report();
+}
@@ -0,0 +1,231 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of FramePacer driven by a fake clock:  the limiter's frame times and adaptive sleep
+// margin, timestep smoothing and drift, hitches, and the pacing statistics.
+//
+
+#include "UnitTest.h"
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace
+{
+    // One tick is a microsecond, and reading the clock takes 10 of them, like a busy spin does
+    class FakeClock : public FramePacer::Clock
+    {
+    public:
+        FakeClock() : Now(1), Oversleep(0), Sleeps(0) {}
+
+        virtual int64_t GetCurrentTick( void ) override { return Now += 10; }
+        virtual double GetSecondsPerTick( void ) override { return 1e-6; }
+        virtual void Sleep( double Seconds ) override
+        {
+            Now += (int64_t)(Seconds * 1e6) + Oversleep;
+            ++Sleeps;
+        }
+
+        void Advance( double Milliseconds ) { Now += (int64_t)(Milliseconds * 1000.0); }
+
+        int64_t Now;
+        int64_t Oversleep;      // How late every sleep wakes up, in ticks
+        uint32_t Sleeps;
+    };
+
+    const float kTarget = 1.0f / 60.0f;
+
+    // Work times between 5 and 11 ms, the same sequence every run
+    double WorkTime( uint32_t Frame )
+    {
+        return 5.0 + (Frame * 7919 % 601) / 100.0;
+    }
+
+    void TestFirstFrame( void )
+    {
+        FakeClock Clock;
+        FramePacer Pacer(Clock);
+        Pacer.SetTargetFrameTime(kTarget);
+        Pacer.BeginFrame();
+
+        // Nothing to wait for or measure yet
+        CHECK_EQUAL(Clock.Sleeps, 0u);
+        CHECK_NEAR(Pacer.GetTimestep(), 1.0f / 60.0f, 1e-6);
+        CHECK_EQUAL(Pacer.ComputeStats().NumFrames, 0u);
+    }
+
+    // Frames that finish early are held to the target, and the timestep is exactly the target
+    void TestLimiter( void )
+    {
+        FakeClock Clock;
+        Clock.Oversleep = 1000;
+        FramePacer Pacer(Clock);
+        Pacer.SetTargetFrameTime(kTarget);
+
+        float MinFrameTime = 1.0f, MaxFrameTime = 0.0f;
+        for (uint32_t Frame = 0; Frame < 300; ++Frame)
+        {
+            Pacer.BeginFrame();
+            if (Frame > 1)
+            {
+                MinFrameTime = min(MinFrameTime, Pacer.GetLastFrame().FrameTime);
+                MaxFrameTime = max(MaxFrameTime, Pacer.GetLastFrame().FrameTime);
+                CHECK_NEAR(Pacer.GetTimestep(), kTarget, 1e-4);
+            }
+            Clock.Advance(WorkTime(Frame));
+            Pacer.MarkPresent();
+            Clock.Advance(0.3);
+        }
+
+        // Never early, and late by no more than a few clock reads
+        CHECK(MinFrameTime >= kTarget - 1e-6f);
+        CHECK(MaxFrameTime <= kTarget + 50e-6f);
+        CHECK(Clock.Sleeps > 250);
+
+        FramePacer::PacingStats Stats = Pacer.ComputeStats();
+        CHECK_NEAR(Stats.AvgFrameTime, kTarget, 50e-6);
+        CHECK(Stats.AvgLimiterWait > 0.005f);
+        CHECK(Stats.AvgLatency > 0.005f && Stats.MaxLatency < 0.0115f);
+        CHECK_EQUAL(Stats.Stutters, 0u);
+    }
+
+    // The margin grows to cover a late OS and decays again once it is punctual
+    void TestSleepMargin( void )
+    {
+        FakeClock Clock;
+        FramePacer Pacer(Clock);
+        Pacer.SetTargetFrameTime(kTarget);
+
+        Clock.Oversleep = 4000;
+        for (uint32_t Frame = 0; Frame < 10; ++Frame)
+        {
+            Pacer.BeginFrame();
+            Clock.Advance(2.0);
+        }
+        const float LateMargin = Pacer.GetSleepMargin();
+        CHECK(LateMargin >= 0.004f);
+        CHECK(LateMargin <= 0.020f);
+        CHECK(Pacer.GetLastFrame().FrameTime <= kTarget + 50e-6f);
+
+        Clock.Oversleep = 0;
+        for (uint32_t Frame = 0; Frame < 300; ++Frame)
+        {
+            Pacer.BeginFrame();
+            Clock.Advance(2.0);
+        }
+        CHECK(Pacer.GetSleepMargin() < LateMargin * 0.5f);
+        CHECK(Pacer.GetSleepMargin() >= 0.0005f);
+    }
+
+    // Without the limiter, nothing sleeps and alternating frame times are smoothed without drifting
+    // away from wall-clock time
+    void TestSmoothing( void )
+    {
+        FakeClock Clock;
+        FramePacer Pacer(Clock);
+
+        double SimulatedTime = 0.0, MaxStepChange = 0.0;
+        float PrevStep = 0.0f;
+        int64_t StartTick = 0;
+        for (uint32_t Frame = 0; Frame < 400; ++Frame)
+        {
+            Pacer.BeginFrame();
+            if (Frame == 1)
+                StartTick = Clock.Now;
+            if (Frame > 1)
+            {
+                SimulatedTime += Pacer.GetTimestep();
+                if (Frame > 50)
+                    MaxStepChange = max(MaxStepChange, (double)fabs(Pacer.GetTimestep() - PrevStep));
+            }
+            PrevStep = Pacer.GetTimestep();
+            Clock.Advance(Frame % 2 ? 14.0 : 8.0);
+        }
+        Pacer.BeginFrame();
+        SimulatedTime += Pacer.GetTimestep();
+
+        CHECK_EQUAL(Clock.Sleeps, 0u);
+
+        // Frame times swing by 6 ms; the timestep by much less
+        CHECK(MaxStepChange < 0.0015);
+
+        double WallTime = (Clock.Now - StartTick) * 1e-6;
+        CHECK_NEAR(SimulatedTime, WallTime, 0.02);
+
+        // With smoothing off the timestep is the raw frame time
+        Pacer.EnableSmoothing(false);
+        Clock.Advance(8.0);
+        Pacer.BeginFrame();
+        CHECK_NEAR(Pacer.GetTimestep(), 0.008f, 1e-4);
+    }
+
+    // A hitch is clamped to the max timestep and not paid back over the following frames
+    void TestHitch( void )
+    {
+        FakeClock Clock;
+        FramePacer Pacer(Clock);
+        Pacer.SetMaxTimestep(0.1f);
+
+        for (uint32_t Frame = 0; Frame < 60; ++Frame)
+        {
+            Pacer.BeginFrame();
+            Clock.Advance(10.0);
+        }
+        Clock.Advance(300.0);
+        Pacer.BeginFrame();
+        CHECK_NEAR(Pacer.GetTimestep(), 0.1f, 1e-6);
+
+        // The frames after it step at their own pace straight away
+        for (uint32_t Frame = 0; Frame < 10; ++Frame)
+        {
+            Clock.Advance(10.0);
+            Pacer.BeginFrame();
+            CHECK_NEAR(Pacer.GetTimestep(), 0.010f, 1e-4);
+        }
+    }
+
+    // Steady 10 ms frames with one 30 ms frame.  Reading the fake clock adds a few ticks to each.
+    void TestStats( void )
+    {
+        FakeClock Clock;
+        FramePacer Pacer(Clock);
+
+        for (uint32_t Frame = 0; Frame <= 200; ++Frame)
+        {
+            Pacer.BeginFrame();
+            Clock.Advance(Frame == 150 ? 30.0 : 10.0);
+            Pacer.MarkPresent();
+        }
+        Pacer.BeginFrame();
+
+        FramePacer::PacingStats Stats = Pacer.ComputeStats();
+        CHECK_EQUAL(Stats.NumFrames, (uint32_t)FramePacer::kHistorySize);
+        CHECK_NEAR(Stats.MaxFrameTime, 0.030f, 1e-4);
+        CHECK_EQUAL(Stats.Stutters, 1u);
+        CHECK_NEAR(Stats.AvgFrameTime, (0.010f * (FramePacer::kHistorySize - 1) + 0.030f) / FramePacer::kHistorySize, 1e-4);
+
+        // Two jumps of 20 ms among the consecutive differences
+        CHECK_NEAR(Stats.AvgJitter, 0.040f / (FramePacer::kHistorySize - 1), 1e-5);
+        CHECK_NEAR(Stats.AvgLimiterWait, 0.0f, 1e-5);
+        CHECK_NEAR(Stats.AvgLatency, 0.010f, 5e-4);
+    }
+}
+
+int main( void )
+{
+    RUN_TEST(TestFirstFrame);
+    RUN_TEST(TestLimiter);
+    RUN_TEST(TestSleepMargin);
+    RUN_TEST(TestSmoothing);
+    RUN_TEST(TestHitch);
+    RUN_TEST(TestStats);
+    return UnitTest::Report();
+}
@@ -0,0 +1,193 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of the glyph lookup behind TextRenderer:  characters in the dense table, characters
+// past it found through the sparse table, and missing characters, both looked up directly and laid out
+// by GlyphLayout.
+//
+
+#include "UnitTest.h"
+#include "GlyphTable.h"
+
+#include <cstring>
+
+using namespace std;
+using TextRenderer::GlyphTable;
+
+namespace
+{
+    // 12.4 fixed point, so one texel is 16 units
+    const uint16_t kFontHeight = 16 * 16;
+
+    // 'A' and 'B' are dense, U+00E9 is near the end of the dense range, U+3042 and U+FF21 are sparse.
+    // The file order is not sorted.
+    const uint16_t kCharacters[] = { 0xFF21, 'B', 0x3042, 'A', 0x00E9, ' ' };
+    const GlyphTable::Glyph kGlyphs[] =
+    {
+        { 100, 0, 16, 0, 16 * 16 },
+        { 20, 0, 10, 2 * 16, 12 * 16 },
+        { 60, 0, 16, 0, 16 * 16 },
+        { 0, 0, 10, 1 * 16, 11 * 16 },
+        { 40, 20, 9, 1 * 16, 10 * 16 },
+        { 80, 0, 1, 0, 8 * 16 },
+    };
+    const uint16_t kNumGlyphs = sizeof(kCharacters) / sizeof(kCharacters[0]);
+
+    void BuildTable( GlyphTable& Table )
+    {
+        Table.Build(kCharacters, kGlyphs, kNumGlyphs, kFontHeight);
+    }
+
+    void TestDenseLookup( void )
+    {
+        GlyphTable Table;
+        BuildTable(Table);
+
+        CHECK_EQUAL(Table.GetNumGlyphs(), (uint32_t)kNumGlyphs);
+        CHECK_EQUAL(Table.GetHeight(), kFontHeight);
+
+        // Sized to the highest dense character, not the whole dense range
+        CHECK_EQUAL(Table.GetDenseTableSize(), 0xE9u + 1u);
+
+        const GlyphTable::Glyph* A = Table.GetGlyph('A');
+        CHECK(A == nullptr ? false : A->x == 0 && A->advance == 11 * 16);
+        const GlyphTable::Glyph* B = Table.GetGlyph('B');
+        CHECK(B == nullptr ? false : B->x == 20 && B->bearing == 2 * 16);
+        const GlyphTable::Glyph* E = Table.GetGlyph(0xE9);
+        CHECK(E == nullptr ? false : E->x == 40 && E->y == 20);
+    }
+
+    void TestSparseLookup( void )
+    {
+        GlyphTable Table;
+        BuildTable(Table);
+
+        CHECK_EQUAL(Table.GetSparseTableSize(), 2u);
+
+        const GlyphTable::Glyph* Hiragana = Table.GetGlyph(0x3042);
+        CHECK(Hiragana == nullptr ? false : Hiragana->x == 60);
+        const GlyphTable::Glyph* Fullwidth = Table.GetGlyph(0xFF21);
+        CHECK(Fullwidth == nullptr ? false : Fullwidth->x == 100);
+    }
+
+    // Missing characters below the dense table's end, between it and the sparse range, in the sparse
+    // range, and past UTF-16
+    void TestMissingLookup( void )
+    {
+        GlyphTable Table;
+        BuildTable(Table);
+
+        CHECK(Table.GetGlyph('C') == nullptr);
+        CHECK(Table.GetGlyph(0) == nullptr);
+        CHECK(Table.GetGlyph(0x0400) == nullptr);
+        CHECK(Table.GetGlyph(GlyphTable::kDenseGlyphRange - 1) == nullptr);
+        CHECK(Table.GetGlyph(GlyphTable::kDenseGlyphRange) == nullptr);
+        CHECK(Table.GetGlyph(0x3043) == nullptr);
+        CHECK(Table.GetGlyph(0xFFFF) == nullptr);
+        CHECK(Table.GetGlyph(0x1FF21) == nullptr);
+
+        // An empty font has no glyphs at all
+        GlyphTable Empty;
+        Empty.Build(nullptr, nullptr, 0, kFontHeight);
+        CHECK(Empty.GetGlyph('A') == nullptr);
+        CHECK(Empty.GetGlyph(0x3042) == nullptr);
+    }
+
+    TextRenderer::GlyphLayout MakeLayout( const GlyphTable& Table )
+    {
+        TextRenderer::GlyphLayout Layout;
+        Layout.Glyphs = &Table;
+        Layout.TextSize = 32.0f;    // Two pixels per texel
+        Layout.LeftMargin = 10.0f;
+        Layout.TextPosX = 10.0f;
+        Layout.TextPosY = 5.0f;
+        Layout.LineHeight = 40.0f;
+        Layout.Color = 0xFF00FF00;
+        return Layout;
+    }
+
+    // Dense and missing characters in a char string, with a newline
+    void TestLayoutDenseAndMissing( void )
+    {
+        GlyphTable Table;
+        BuildTable(Table);
+        TextRenderer::GlyphLayout Layout = MakeLayout(Table);
+
+        const char* Text = "AC\nB";
+        TextRenderer::TextVert Verts[4];
+        memset(Verts, 0, sizeof(Verts));
+        uint32_t Count = Layout.FillVertexBuffer(Verts, Text, 1, strlen(Text));
+
+        // 'C' is skipped and doesn't move the cursor
+        CHECK_EQUAL(Count, 2u);
+        CHECK_NEAR(Verts[0].X, 10.0f + 1.0f * 2.0f, 1e-5);
+        CHECK_NEAR(Verts[0].Y, 5.0f, 1e-5);
+        CHECK_EQUAL(Verts[0].U, 0u);
+        CHECK_EQUAL(Verts[0].W, 10u);
+        CHECK_EQUAL(Verts[0].H, kFontHeight);
+        CHECK_NEAR(Verts[0].Size, 32.0f, 1e-5);
+        CHECK_EQUAL(Verts[0].Color, 0xFF00FF00u);
+
+        // The newline returns to the left margin
+        CHECK_NEAR(Verts[1].X, 10.0f + 2.0f * 2.0f, 1e-5);
+        CHECK_NEAR(Verts[1].Y, 45.0f, 1e-5);
+        CHECK_EQUAL(Verts[1].U, 20u);
+
+        CHECK_NEAR(Layout.TextPosX, 10.0f + 12.0f * 2.0f, 1e-5);
+        CHECK_NEAR(Layout.TextPosY, 45.0f, 1e-5);
+    }
+
+    // Sparse and missing characters in a UTF-16 string, and a null that ends the string early
+    void TestLayoutSparse( void )
+    {
+        GlyphTable Table;
+        BuildTable(Table);
+        TextRenderer::GlyphLayout Layout = MakeLayout(Table);
+
+        const uint16_t Text[] = { 0x3042, 0x3043, 0xE9, 0xFF21, 0, 'A' };
+        TextRenderer::TextVert Verts[6];
+        uint32_t Count = Layout.FillVertexBuffer(Verts, (const char*)Text, 2, 6);
+
+        CHECK_EQUAL(Count, 3u);
+        CHECK_EQUAL(Verts[0].U, 60u);
+        CHECK_EQUAL(Verts[1].U, 40u);
+        CHECK_EQUAL(Verts[2].U, 100u);
+        CHECK_NEAR(Verts[1].X, 10.0f + 16.0f * 2.0f + 1.0f * 2.0f, 1e-5);
+        CHECK_NEAR(Layout.TextPosX, 10.0f + (16.0f + 10.0f + 16.0f) * 2.0f, 1e-5);
+
+        // UTF-32 strings, as wchar_t is outside Windows, lay out the same way
+        const uint32_t Wide[] = { 0x3042, 0x3043, 0xE9, 0xFF21 };
+        Layout = MakeLayout(Table);
+        CHECK_EQUAL(Layout.FillVertexBuffer(Verts, (const char*)Wide, 4, 4), 3u);
+        CHECK_EQUAL(Verts[2].U, 100u);
+    }
+
+    // Characters above 0x7F in a char string are Latin-1, not negative
+    void TestLayoutLatin1( void )
+    {
+        GlyphTable Table;
+        BuildTable(Table);
+        TextRenderer::GlyphLayout Layout = MakeLayout(Table);
+
+        const char Text[] = { 'A', (char)0xE9, 0 };
+        TextRenderer::TextVert Verts[2];
+        CHECK_EQUAL(Layout.FillVertexBuffer(Verts, Text, 1, 2), 2u);
+        CHECK_EQUAL(Verts[1].U, 40u);
+    }
+}
+
+int main( void )
+{
+    RUN_TEST(TestDenseLookup);
+    RUN_TEST(TestSparseLookup);
+    RUN_TEST(TestMissingLookup);
+    RUN_TEST(TestLayoutDenseAndMissing);
+    RUN_TEST(TestLayoutSparse);
+    RUN_TEST(TestLayoutLatin1);
+    return UnitTest::Report();
+}
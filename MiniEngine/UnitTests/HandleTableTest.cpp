@@ -0,0 +1,193 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of HandleTable:  stale handles are rejected after their slot is reused, the dense
+// array is kept packed by swapping the last value into each hole, and the generation wraps.
+//
+
+#include "UnitTest.h"
+#include "HandleTable.h"
+
+#include <memory>
+#include <random>
+
+using namespace std;
+
+namespace
+{
+    typedef HandleTable<int> IntTable;
+
+    const uint32_t kGenerationCount = 1 << (32 - IntTable::kIndexBits);
+
+    uint32_t SlotOf( IntTable::Handle H )
+    {
+        return H & IntTable::kMaxSlots;
+    }
+
+    void TestInsertGet( void )
+    {
+        IntTable Table;
+        IntTable::Handle A = Table.Insert(1);
+        IntTable::Handle B = Table.Insert(2);
+
+        CHECK(A != B);
+        CHECK(A != IntTable::kInvalidHandle);
+        CHECK_EQUAL(Table.GetCount(), 2u);
+        CHECK_EQUAL(*Table.Get(A), 1);
+        CHECK_EQUAL(*Table.Get(B), 2);
+        CHECK(!Table.IsValid(IntTable::kInvalidHandle));
+        CHECK(Table.Get(IntTable::kInvalidHandle) == nullptr);
+    }
+
+    // A removed value's handle stays invalid after another value takes its slot
+    void TestStaleHandleRejected( void )
+    {
+        IntTable Table;
+        IntTable::Handle Old = Table.Insert(1);
+        CHECK(Table.Remove(Old));
+        CHECK(!Table.IsValid(Old));
+        CHECK(Table.Get(Old) == nullptr);
+        CHECK(!Table.Remove(Old));
+
+        IntTable::Handle New = Table.Insert(2);
+        CHECK_EQUAL(SlotOf(New), SlotOf(Old));
+        CHECK(New != Old);
+        CHECK(!Table.IsValid(Old));
+        CHECK(Table.Get(Old) == nullptr);
+        CHECK(!Table.Remove(Old));
+        CHECK_EQUAL(*Table.Get(New), 2);
+        CHECK_EQUAL(Table.GetCount(), 1u);
+    }
+
+    // Removal moves the last value into the hole and keeps every handle pointing at its own value
+    void TestSwapAndPopOrder( void )
+    {
+        IntTable Table;
+        IntTable::Handle Handles[5];
+        for (int i = 0; i < 5; ++i)
+            Handles[i] = Table.Insert(10 + i);
+
+        CHECK(Table.Remove(Handles[1]));
+        CHECK_EQUAL(Table.GetCount(), 4u);
+        CHECK_EQUAL(Table[0], 10);
+        CHECK_EQUAL(Table[1], 14);
+        CHECK_EQUAL(Table[2], 12);
+        CHECK_EQUAL(Table[3], 13);
+
+        // Removing the last value moves nothing
+        CHECK(Table.Remove(Handles[3]));
+        CHECK_EQUAL(Table.GetCount(), 3u);
+        CHECK_EQUAL(Table[0], 10);
+        CHECK_EQUAL(Table[1], 14);
+        CHECK_EQUAL(Table[2], 12);
+
+        for (uint32_t i = 0; i < Table.GetCount(); ++i)
+            CHECK_EQUAL(Table.Get(Table.GetHandle(i)), &Table[i]);
+        CHECK_EQUAL(*Table.Get(Handles[0]), 10);
+        CHECK_EQUAL(*Table.Get(Handles[2]), 12);
+        CHECK_EQUAL(*Table.Get(Handles[4]), 14);
+    }
+
+    // The 12-bit generation of a slot wraps after 4096 reuses, when the first handle to it aliases again
+    void TestGenerationWrap( void )
+    {
+        IntTable Table;
+        IntTable::Handle First = Table.Insert(0);
+        IntTable::Handle Previous = First;
+        CHECK(Table.Remove(First));
+
+        for (uint32_t i = 1; i < kGenerationCount; ++i)
+        {
+            IntTable::Handle H = Table.Insert((int)i);
+            CHECK_EQUAL(SlotOf(H), SlotOf(First));
+            CHECK(H != Previous);
+            CHECK(H != First);
+            CHECK(H != IntTable::kInvalidHandle);
+            CHECK(!Table.IsValid(Previous));
+            CHECK(Table.Remove(H));
+            Previous = H;
+        }
+
+        IntTable::Handle Wrapped = Table.Insert(-1);
+        CHECK_EQUAL(Wrapped, First);
+        CHECK_EQUAL(*Table.Get(First), -1);
+    }
+
+    void TestClear( void )
+    {
+        IntTable Table;
+        IntTable::Handle A = Table.Insert(1);
+        IntTable::Handle B = Table.Insert(2);
+        Table.Clear();
+
+        CHECK_EQUAL(Table.GetCount(), 0u);
+        CHECK(!Table.IsValid(A));
+        CHECK(!Table.IsValid(B));
+
+        // Cleared slots are reused with new generations
+        IntTable::Handle C = Table.Insert(3);
+        CHECK(C != A && C != B);
+        CHECK_EQUAL(*Table.Get(C), 3);
+    }
+
+    // Values that can only be moved, as the particle effects are held
+    void TestMoveOnlyValues( void )
+    {
+        HandleTable< unique_ptr<int> > Table;
+        auto A = Table.Insert(unique_ptr<int>(new int(1)));
+        auto B = Table.Insert(unique_ptr<int>(new int(2)));
+        CHECK(Table.Remove(A));
+        CHECK_EQUAL(**Table.Get(B), 2);
+        CHECK_EQUAL(*Table[0], 2);
+    }
+
+    // Random inserts and removes, checked against a list of the live handles
+    void TestRandomInsertRemove( void )
+    {
+        IntTable Table;
+        vector< pair<IntTable::Handle, int> > Live;
+        vector<IntTable::Handle> Removed;
+        mt19937 Rng(1);
+
+        for (int i = 0; i < 100000; ++i)
+        {
+            if (Live.empty() || Rng() % 3 != 0)
+            {
+                Live.push_back(make_pair(Table.Insert((int)i), i));
+            }
+            else
+            {
+                size_t k = Rng() % Live.size();
+                CHECK(Table.Remove(Live[k].first));
+                Removed.push_back(Live[k].first);
+                Live[k] = Live.back();
+                Live.pop_back();
+            }
+        }
+
+        CHECK_EQUAL(Table.GetCount(), (uint32_t)Live.size());
+        for (auto& Entry : Live)
+            CHECK(Table.Get(Entry.first) != nullptr && *Table.Get(Entry.first) == Entry.second);
+
+        // No slot was reused anywhere near 4096 times, so no removed handle aliases a live one
+        for (IntTable::Handle H : Removed)
+            CHECK(!Table.IsValid(H));
+    }
+}
+
+int main( void )
+{
+    RUN_TEST(TestInsertGet);
+    RUN_TEST(TestStaleHandleRejected);
+    RUN_TEST(TestSwapAndPopOrder);
+    RUN_TEST(TestGenerationWrap);
+    RUN_TEST(TestClear);
+    RUN_TEST(TestMoveOnlyValues);
+    RUN_TEST(TestRandomInsertRemove);
+    return UnitTest::Report();
+}
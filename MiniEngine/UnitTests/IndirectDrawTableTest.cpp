@@ -0,0 +1,303 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of the ExecuteIndirect draw table:  the layouts IndirectCullCS.hlsl depends on, how
+// Build() groups draws into (model, material) buckets, and Cull() against a brute-force test of each
+// transformed box corner.
+//
+
+#include "UnitTest.h"
+#include "IndirectDrawTable.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    typedef IndirectDrawTable Table;
+
+    // The shader reads records and writes commands with these strides and offsets
+    static_assert(sizeof(Table::DrawRecord) == 64, "DrawRecord must match IndirectCullCS.hlsl");
+    static_assert(sizeof(Table::DrawCommand) == 40, "DrawCommand must match the command signature");
+    static_assert(offsetof(Table::DrawCommand, BaseVertex) == 8, "Root constants follow the CBV address");
+    static_assert(offsetof(Table::DrawCommand, IndexCountPerInstance) == 16, "Draw arguments follow the root constants");
+
+    // Math::Matrix4 layout with a translation along x
+    void MakeTranslation( float* M, float X )
+    {
+        memset(M, 0, 16 * sizeof(float));
+        M[0] = M[5] = M[10] = M[15] = 1.0f;
+        M[12] = X;
+    }
+
+    // Model 0 has two meshes of material 2 and a cut out mesh of material 1 that is off screen.  Model 1 has
+    // one mesh.
+    const Table::MeshDesc kModel0[3] =
+    {
+        { { -0.1f, -0.1f, 0.2f }, { 0.1f, 0.1f, 0.3f }, 30, 0, 0, 2, Table::kFlagOpaque },
+        { { 5.0f, 5.0f, 0.5f }, { 6.0f, 6.0f, 0.6f }, 60, 30, 10, 1, Table::kFlagCutout },
+        { { -0.2f, -0.2f, 0.4f }, { 0.2f, 0.2f, 0.5f }, 90, 90, 20, 2, Table::kFlagOpaque },
+    };
+    const Table::MeshDesc kModel1[1] =
+    {
+        { { -0.5f, -0.5f, 0.1f }, { 0.5f, 0.5f, 0.9f }, 12, 0, 0, 0, Table::kFlagOpaque },
+    };
+    const Table::ModelDesc kModels[2] = { { kModel0, 3 }, { kModel1, 1 } };
+    const uint32_t kInstanceModels[3] = { 0, 1, 0 };
+
+    void TestBuckets( void )
+    {
+        Table T;
+        T.Build(kModels, 2, kInstanceModels, 3);
+
+        const vector<Table::Bucket>& Buckets = T.GetBuckets();
+        CHECK_EQUAL(T.GetInstanceCount(), 3u);
+        CHECK_EQUAL(Buckets.size(), 3u);
+        CHECK_EQUAL(T.GetCommandCapacity(), 7u);
+        if (Buckets.size() != 3)
+            return;
+
+        // Model order, then material order, each sized for every instance's draws
+        CHECK(Buckets[0].ModelIndex == 0 && Buckets[0].MaterialIndex == 1 && Buckets[0].Flags == Table::kFlagCutout);
+        CHECK(Buckets[0].FirstCommand == 0 && Buckets[0].Capacity == 2);
+        CHECK(Buckets[1].ModelIndex == 0 && Buckets[1].MaterialIndex == 2 && Buckets[1].Flags == Table::kFlagOpaque);
+        CHECK(Buckets[1].FirstCommand == 2 && Buckets[1].Capacity == 4);
+        CHECK(Buckets[2].ModelIndex == 1 && Buckets[2].MaterialIndex == 0);
+        CHECK(Buckets[2].FirstCommand == 6 && Buckets[2].Capacity == 1);
+
+        // Every record lies in its bucket's range, in instance then mesh order
+        const vector<Table::DrawRecord>& Records = T.GetRecords();
+        for (uint32_t i = 0; i < Records.size(); ++i)
+        {
+            const Table::Bucket& B = Buckets[Records[i].BucketIndex];
+            CHECK(i >= B.FirstCommand && i < B.FirstCommand + B.Capacity);
+            CHECK_EQUAL(Records[i].FirstCommand, B.FirstCommand);
+            CHECK_EQUAL(Records[i].MaterialIndex, B.MaterialIndex);
+        }
+        CHECK(Records[2].InstanceIndex == 0 && Records[2].StartIndex == 0);
+        CHECK(Records[3].InstanceIndex == 0 && Records[3].StartIndex == 90);
+        CHECK(Records[4].InstanceIndex == 2 && Records[5].InstanceIndex == 2);
+    }
+
+    // Building again replaces the previous table
+    void TestRebuild( void )
+    {
+        Table T;
+        T.Build(kModels, 2, kInstanceModels, 3);
+        const uint32_t OneInstance = 1;
+        T.Build(kModels, 2, &OneInstance, 1);
+
+        CHECK_EQUAL(T.GetInstanceCount(), 1u);
+        CHECK_EQUAL(T.GetCommandCapacity(), 1u);
+        // Buckets exist for every material of every model, used or not
+        CHECK_EQUAL(T.GetBuckets().size(), 3u);
+        CHECK_EQUAL(T.GetBuckets()[0].Capacity, 0u);
+
+        T.Build(kModels, 2, nullptr, 0);
+        CHECK_EQUAL(T.GetCommandCapacity(), 0u);
+    }
+
+    void TestCull( void )
+    {
+        Table T;
+        T.Build(kModels, 2, kInstanceModels, 3);
+
+        // Instance 2 is moved off the right of the screen
+        float Matrices[48];
+        MakeTranslation(Matrices, 0.0f);
+        MakeTranslation(Matrices + 16, 0.0f);
+        MakeTranslation(Matrices + 32, 10.0f);
+
+        Table::DrawCommand Commands[7];
+        uint32_t Counts[3];
+        const uint64_t kConstants = 0x100000000ull;
+
+        CHECK_EQUAL(T.Cull(Matrices, Table::kFlagOpaque, kConstants, 256, Commands, Counts), 3u);
+        CHECK(Counts[0] == 0 && Counts[1] == 2 && Counts[2] == 1);
+
+        // Survivors are packed at the start of their bucket's range
+        CHECK_EQUAL(Commands[2].VSConstants, kConstants);
+        CHECK_EQUAL(Commands[2].IndexCountPerInstance, 30u);
+        CHECK_EQUAL(Commands[2].MaterialIndex, 2u);
+        CHECK_EQUAL(Commands[3].StartIndexLocation, 90u);
+        CHECK_EQUAL(Commands[3].BaseVertexLocation, 20);
+        CHECK_EQUAL(Commands[3].BaseVertex, 20u);
+        CHECK_EQUAL(Commands[3].InstanceCount, 1u);
+        CHECK_EQUAL(Commands[3].StartInstanceLocation, 0u);
+        CHECK_EQUAL(Commands[6].VSConstants, kConstants + 256);
+
+        // The only cut out mesh is off screen, and the filter is a mask
+        CHECK_EQUAL(T.Cull(Matrices, Table::kFlagCutout, kConstants, 256, Commands, Counts), 0u);
+        CHECK(Counts[0] == 0 && Counts[1] == 0 && Counts[2] == 0);
+        CHECK_EQUAL(T.Cull(Matrices, Table::kFlagOpaque | Table::kFlagCutout, kConstants, 256, Commands, Counts), 3u);
+    }
+
+    // Boxes outside each clip plane, straddling one, and behind the near plane
+    void TestIntersectFrustum( void )
+    {
+        float M[16];
+        MakeTranslation(M, 0.0f);
+
+        const float Inside[2][3] = { { -0.5f, -0.5f, 0.2f }, { 0.5f, 0.5f, 0.8f } };
+        CHECK(Table::IntersectFrustum(M, Inside[0], Inside[1]));
+
+        const float Straddle[2][3] = { { 0.9f, -0.5f, -0.5f }, { 1.5f, 0.5f, 0.5f } };
+        CHECK(Table::IntersectFrustum(M, Straddle[0], Straddle[1]));
+
+        const float Outside[6][2][3] =
+        {
+            { { -3.0f, 0.0f, 0.5f }, { -2.0f, 0.1f, 0.6f } },
+            { { 2.0f, 0.0f, 0.5f }, { 3.0f, 0.1f, 0.6f } },
+            { { 0.0f, -3.0f, 0.5f }, { 0.1f, -2.0f, 0.6f } },
+            { { 0.0f, 2.0f, 0.5f }, { 0.1f, 3.0f, 0.6f } },
+            { { 0.0f, 0.0f, -2.0f }, { 0.1f, 0.1f, -1.0f } },
+            { { 0.0f, 0.0f, 2.0f }, { 0.1f, 0.1f, 3.0f } },
+        };
+        for (int p = 0; p < 6; ++p)
+            CHECK(!Table::IntersectFrustum(M, Outside[p][0], Outside[p][1]));
+    }
+
+    float Random( float Lo, float Hi )
+    {
+        return Lo + (Hi - Lo) * (float)rand() / (float)RAND_MAX;
+    }
+
+    // Culled when all eight corners of the box fall outside the same clip plane
+    bool BruteForceVisible( const float* M, const float* BoundsMin, const float* BoundsMax )
+    {
+        uint32_t OutsideAll = 0x3F;
+        for (int Corner = 0; Corner < 8; ++Corner)
+        {
+            const float P[3] =
+            {
+                (Corner & 1) ? BoundsMax[0] : BoundsMin[0],
+                (Corner & 2) ? BoundsMax[1] : BoundsMin[1],
+                (Corner & 4) ? BoundsMax[2] : BoundsMin[2],
+            };
+            float Clip[4];
+            for (int r = 0; r < 4; ++r)
+                Clip[r] = M[r] * P[0] + M[4 + r] * P[1] + M[8 + r] * P[2] + M[12 + r];
+
+            uint32_t Outside = 0;
+            Outside |= Clip[0] < -Clip[3] ? 0x01 : 0;
+            Outside |= Clip[0] > Clip[3] ? 0x02 : 0;
+            Outside |= Clip[1] < -Clip[3] ? 0x04 : 0;
+            Outside |= Clip[1] > Clip[3] ? 0x08 : 0;
+            Outside |= Clip[2] < 0.0f ? 0x10 : 0;
+            Outside |= Clip[2] > Clip[3] ? 0x20 : 0;
+            OutsideAll &= Outside;
+        }
+        return OutsideAll == 0;
+    }
+
+    // Random models, instances and perspective-ish matrices culled both ways
+    void TestCullMatchesBruteForce( void )
+    {
+        srand(48);
+
+        const uint32_t kNumModels = 5;
+        vector<Table::MeshDesc> Meshes[kNumModels];
+        Table::ModelDesc Models[kNumModels];
+        for (uint32_t m = 0; m < kNumModels; ++m)
+        {
+            const uint32_t NumMeshes = 1 + rand() % 8;
+            for (uint32_t i = 0; i < NumMeshes; ++i)
+            {
+                Table::MeshDesc Mesh;
+                for (int k = 0; k < 3; ++k)
+                {
+                    Mesh.BoundsMin[k] = Random(-2.0f, 2.0f);
+                    Mesh.BoundsMax[k] = Mesh.BoundsMin[k] + Random(0.01f, 1.0f);
+                }
+                Mesh.IndexCount = 3 * (1 + i);
+                Mesh.StartIndex = 100 * i;
+                Mesh.BaseVertex = (int32_t)(10 * i);
+                Mesh.MaterialIndex = (uint32_t)rand() % 4;
+                Mesh.Flags = (Mesh.MaterialIndex & 1) ? Table::kFlagCutout : Table::kFlagOpaque;
+                Meshes[m].push_back(Mesh);
+            }
+            Models[m].Meshes = Meshes[m].data();
+            Models[m].MeshCount = NumMeshes;
+        }
+
+        const uint32_t kNumInstances = 200;
+        vector<uint32_t> InstanceModels(kNumInstances);
+        vector<float> Matrices(kNumInstances * 16);
+        for (uint32_t i = 0; i < kNumInstances; ++i)
+        {
+            InstanceModels[i] = (uint32_t)rand() % kNumModels;
+            float* M = &Matrices[i * 16];
+            for (int k = 0; k < 16; ++k)
+                M[k] = Random(-1.0f, 1.0f);
+            // w grows with depth, as with a perspective projection
+            M[3] = M[7] = 0.0f;
+            M[11] = 1.0f;
+            M[15] = Random(0.0f, 2.0f);
+        }
+
+        Table T;
+        T.Build(Models, kNumModels, InstanceModels.data(), kNumInstances);
+
+        vector<Table::DrawCommand> Commands(T.GetCommandCapacity());
+        vector<uint32_t> Counts(T.GetBuckets().size());
+        const uint32_t Filter = Table::kFlagOpaque;
+        const uint32_t NumVisible = T.Cull(Matrices.data(), Filter, 0, 256, Commands.data(), Counts.data());
+
+        // Expected survivors of each bucket, in instance and mesh order
+        vector< vector<Table::DrawCommand> > Expected(T.GetBuckets().size());
+        uint32_t ExpectedVisible = 0;
+        for (const Table::DrawRecord& Record : T.GetRecords())
+        {
+            if ((Record.Flags & Filter) == 0 ||
+                !BruteForceVisible(&Matrices[Record.InstanceIndex * 16], Record.BoundsMin, Record.BoundsMax))
+                continue;
+
+            Table::DrawCommand Command;
+            memset(&Command, 0, sizeof(Command));
+            Command.VSConstants = (uint64_t)Record.InstanceIndex * 256;
+            Command.IndexCountPerInstance = Record.IndexCount;
+            Command.StartIndexLocation = Record.StartIndex;
+            Command.BaseVertexLocation = Record.BaseVertex;
+            Expected[Record.BucketIndex].push_back(Command);
+            ++ExpectedVisible;
+        }
+
+        CHECK_EQUAL(NumVisible, ExpectedVisible);
+        CHECK(ExpectedVisible > 0 && ExpectedVisible < T.GetCommandCapacity());
+
+        for (uint32_t b = 0; b < Expected.size(); ++b)
+        {
+            CHECK_EQUAL(Counts[b], (uint32_t)Expected[b].size());
+            if (Counts[b] != Expected[b].size())
+                continue;
+
+            const Table::DrawCommand* Culled = &Commands[T.GetBuckets()[b].FirstCommand];
+            for (uint32_t i = 0; i < Counts[b]; ++i)
+            {
+                CHECK_EQUAL(Culled[i].VSConstants, Expected[b][i].VSConstants);
+                CHECK_EQUAL(Culled[i].IndexCountPerInstance, Expected[b][i].IndexCountPerInstance);
+                CHECK_EQUAL(Culled[i].StartIndexLocation, Expected[b][i].StartIndexLocation);
+                CHECK_EQUAL(Culled[i].BaseVertexLocation, Expected[b][i].BaseVertexLocation);
+            }
+        }
+    }
+}
+
+int main( void )
+{
+    RUN_TEST(TestBuckets);
+    RUN_TEST(TestRebuild);
+    RUN_TEST(TestCull);
+    RUN_TEST(TestIntersectFrustum);
+    RUN_TEST(TestCullMatchesBruteForce);
+    return UnitTest::Report();
+}
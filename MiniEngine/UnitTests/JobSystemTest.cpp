@@ -0,0 +1,265 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Stress tests of the work-stealing JobScheduler:  every index of a ParallelFor runs exactly
+// once at any grain and thread count, jobs can wait on jobs they submit, tens of thousands of jobs from
+// threads outside the scheduler all run, idle threads steal, and sleeping workers wake for new work.
+//
+
+#include "UnitTest.h"
+#include "JobSystem.h"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // One flag per index, so a missed or repeated index shows up as a count other than one
+    class RunCounts
+    {
+    public:
+        explicit RunCounts( uint32_t Count ) : m_Counts(new atomic<uint32_t>[Count]), m_Size(Count)
+        {
+            for (uint32_t i = 0; i < Count; ++i)
+                m_Counts[i] = 0;
+        }
+
+        void Hit( uint32_t Index ) { m_Counts[Index].fetch_add(1, memory_order_relaxed); }
+
+        bool AllOnce( void ) const
+        {
+            for (uint32_t i = 0; i < m_Size; ++i)
+            {
+                if (m_Counts[i].load() != 1)
+                    return false;
+            }
+            return true;
+        }
+
+    private:
+        unique_ptr<atomic<uint32_t>[]> m_Counts;
+        uint32_t m_Size;
+    };
+
+    // Before Initialize, jobs run on the submitting thread
+    void TestInline( void )
+    {
+        JobScheduler Scheduler;
+        RunCounts Counts(100);
+        Scheduler.ParallelFor(0, 100, [&]( uint32_t i ) { Counts.Hit(i); });
+        CHECK(Counts.AllOnce());
+        CHECK_EQUAL(Scheduler.GetThreadCount(), 0u);
+    }
+
+    void TestParallelFor( void )
+    {
+        const uint32_t ThreadCounts[] = { 1, 2, 4, 8 };
+        for (uint32_t t = 0; t < 4; ++t)
+        {
+            JobScheduler Scheduler;
+            Scheduler.Initialize(ThreadCounts[t]);
+            CHECK_EQUAL(Scheduler.GetThreadCount(), ThreadCounts[t]);
+
+            bool AllOnce = true;
+            for (uint32_t Grain = 1; Grain <= 64; Grain *= 4)
+            {
+                RunCounts Counts(10007);
+                Scheduler.ParallelFor(0, 10007, Grain, [&]( uint32_t i ) { Counts.Hit(i); });
+                AllOnce &= Counts.AllOnce();
+            }
+            CHECK(AllOnce);
+
+            // A range that doesn't start at zero, and an empty one
+            RunCounts Counts(200);
+            Scheduler.ParallelFor(100, 300, [&]( uint32_t i ) { Counts.Hit(i - 100); });
+            Scheduler.ParallelFor(5, 5, [&]( uint32_t ) { Counts.Hit(0); });
+            CHECK(Counts.AllOnce());
+
+            Scheduler.Shutdown();
+        }
+    }
+
+    // Jobs that wait on the jobs they submit, deeper than one level
+    void TestNestedWaits( void )
+    {
+        JobScheduler Scheduler;
+        Scheduler.Initialize(4);
+
+        atomic<uint64_t> Sum(0);
+        Scheduler.ParallelFor(0, 16, [&]( uint32_t )
+        {
+            Scheduler.ParallelFor(0, 16, [&]( uint32_t )
+            {
+                Scheduler.ParallelFor(0, 1000, 32, [&]( uint32_t k ) { Sum.fetch_add(k, memory_order_relaxed); });
+            });
+        });
+        CHECK_EQUAL(Sum.load(), 16ull * 16ull * 999ull * 1000ull / 2ull);
+
+        Scheduler.Shutdown();
+    }
+
+    // A job that submits more jobs than its deque holds runs the overflow itself
+    void TestDequeOverflow( void )
+    {
+        JobScheduler Scheduler;
+        Scheduler.Initialize(2);
+
+        const uint32_t Count = JobScheduler::kQueueCapacity * 2;
+        RunCounts Counts(Count);
+        atomic<uint32_t> Next(0);
+        auto Job = [&]() { Counts.Hit(Next.fetch_add(1)); };
+
+        JobCounter Outer;
+        auto Submitter = [&]()
+        {
+            JobCounter Inner;
+            for (uint32_t i = 0; i < Count; ++i)
+                Scheduler.Submit(Inner, Job);
+            Scheduler.Wait(Inner);
+        };
+        Scheduler.Submit(Outer, Submitter);
+        Scheduler.Wait(Outer);
+        CHECK(Counts.AllOnce());
+
+        // The per-frame peak starts over when read; the all-time peak does not
+        uint32_t AllTimePeak = Scheduler.GetTotalStats().PeakQueueDepth;
+        CHECK(AllTimePeak > 1000);
+        CHECK_EQUAL(Scheduler.ResetFramePeakQueueDepth(), AllTimePeak);
+        CHECK_EQUAL(Scheduler.ResetFramePeakQueueDepth(), 0u);
+
+        Scheduler.ParallelFor(0, 8, [&]( uint32_t ) {});
+        uint32_t FramePeak = Scheduler.ResetFramePeakQueueDepth();
+        CHECK(FramePeak > 0 && FramePeak < AllTimePeak);
+        CHECK_EQUAL(Scheduler.GetTotalStats().PeakQueueDepth, AllTimePeak);
+
+        Scheduler.Shutdown();
+    }
+
+    // 50000 jobs submitted from four threads that don't belong to the scheduler, each waiting on its own
+    // counter, while the scheduler's own thread runs a ParallelFor of its own
+    void TestExternalSubmission( void )
+    {
+        JobScheduler Scheduler;
+        Scheduler.Initialize(4);
+
+        const uint32_t kExternalThreads = 4;
+        const uint32_t kJobsPerThread = 12500;
+        RunCounts Counts(kExternalThreads * kJobsPerThread);
+
+        struct IndexedJob
+        {
+            RunCounts* Counts;
+            uint32_t Index;
+            void operator()() { Counts->Hit(Index); }
+        };
+
+        atomic<uint32_t> ThreadsDone(0);
+        vector<thread> Threads;
+        for (uint32_t t = 0; t < kExternalThreads; ++t)
+        {
+            Threads.push_back(thread([&, t]()
+            {
+                vector<IndexedJob> Jobs(kJobsPerThread);
+                JobCounter Counter;
+                for (uint32_t i = 0; i < kJobsPerThread; ++i)
+                {
+                    Jobs[i].Counts = &Counts;
+                    Jobs[i].Index = t * kJobsPerThread + i;
+                    Scheduler.Submit(Counter, Jobs[i]);
+                }
+                Scheduler.Wait(Counter);
+                ThreadsDone.fetch_add(1);
+            }));
+        }
+
+        RunCounts Local(20000);
+        Scheduler.ParallelFor(0, 20000, 16, [&]( uint32_t i ) { Local.Hit(i); });
+
+        for (size_t t = 0; t < Threads.size(); ++t)
+            Threads[t].join();
+
+        CHECK_EQUAL(ThreadsDone.load(), kExternalThreads);
+        CHECK(Counts.AllOnce());
+        CHECK(Local.AllOnce());
+        CHECK(Scheduler.GetTotalStats().JobsRun >= kExternalThreads * kJobsPerThread);
+
+        Scheduler.Shutdown();
+    }
+
+    // Slow jobs pushed onto thread 0's deque are taken by the other threads, which can only get them by
+    // stealing.  The jobs sleep rather than spin so that this holds even on a single core.
+    void TestStealing( void )
+    {
+        JobScheduler Scheduler;
+        Scheduler.Initialize(4);
+
+        RunCounts Counts(64);
+        Scheduler.ParallelFor(0, 64, [&]( uint32_t i )
+        {
+            this_thread::sleep_for(chrono::microseconds(500));
+            Counts.Hit(i);
+        });
+        CHECK(Counts.AllOnce());
+
+        JobScheduler::WorkerStats Total = Scheduler.GetTotalStats();
+        CHECK(Total.JobsStolen > 0);
+        CHECK(Total.Splits > 0);
+
+        uint32_t WorkersThatRan = 0;
+        for (uint32_t i = 1; i < Scheduler.GetThreadCount(); ++i)
+        {
+            JobScheduler::WorkerStats Stats = Scheduler.GetWorkerStats(i);
+            if (Stats.JobsRun > 0)
+            {
+                ++WorkersThatRan;
+                CHECK(Stats.JobsStolen > 0);
+            }
+        }
+        CHECK(WorkersThatRan > 0);
+
+        Scheduler.Shutdown();
+    }
+
+    // Idle workers go to sleep, and new work wakes them.  A sleep is counted when the worker wakes.
+    void TestSleepAndWake( void )
+    {
+        JobScheduler Scheduler;
+        Scheduler.Initialize(4);
+
+        this_thread::sleep_for(chrono::milliseconds(50));
+        for (uint32_t Round = 0; Round < 20; ++Round)
+        {
+            RunCounts Counts(5000);
+            Scheduler.ParallelFor(0, 5000, 64, [&]( uint32_t i ) { Counts.Hit(i); });
+            CHECK(Counts.AllOnce());
+            this_thread::sleep_for(chrono::milliseconds(2));
+        }
+
+        for (uint32_t Poll = 0; Poll < 100 && Scheduler.GetTotalStats().Sleeps == 0; ++Poll)
+            this_thread::sleep_for(chrono::milliseconds(10));
+        CHECK(Scheduler.GetTotalStats().Sleeps > 0);
+
+        Scheduler.Shutdown();
+    }
+}
+
+int main( void )
+{
+    RUN_TEST(TestInline);
+    RUN_TEST(TestParallelFor);
+    RUN_TEST(TestNestedWaits);
+    RUN_TEST(TestDequeOverflow);
+    RUN_TEST(TestExternalSubmission);
+    RUN_TEST(TestStealing);
+    RUN_TEST(TestSleepAndWake);
+    return UnitTest::Report();
+}
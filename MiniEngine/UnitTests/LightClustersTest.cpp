@@ -0,0 +1,379 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of the clustered light assignment against a brute-force one that tests every light's
+// sphere against every cluster's view space bounding box:  no cluster the sphere reaches is missed, no
+// cluster far from it is filled, the lists are grouped by type, and full clusters are clamped.
+//
+
+#include "UnitTest.h"
+#include "LightClusters.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <set>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    typedef LightClusterBuilder::Light Light;
+    typedef LightClusterBuilder::Frustum Frustum;
+
+    float Random( float Low, float High )
+    {
+        return Low + (High - Low) * (float)rand() / (float)RAND_MAX;
+    }
+
+    // A camera at Eye turned Yaw radians to the left, with a 60 degree vertical field of view
+    Frustum MakeFrustum( const float Eye[3], float Yaw, float Aspect, float NearClip, float FarClip )
+    {
+        // Rows of the view rotation:  right, up and back in world space
+        const float Basis[3][3] =
+        {
+            { cosf(Yaw), 0.0f, -sinf(Yaw) },
+            { 0.0f, 1.0f, 0.0f },
+            { sinf(Yaw), 0.0f, cosf(Yaw) },
+        };
+
+        Frustum View;
+        for (int Row = 0; Row < 3; ++Row)
+        {
+            for (int Col = 0; Col < 3; ++Col)
+                View.ViewMatrix[Col * 4 + Row] = Basis[Row][Col];
+            View.ViewMatrix[12 + Row] = -(Basis[Row][0] * Eye[0] + Basis[Row][1] * Eye[1] + Basis[Row][2] * Eye[2]);
+            View.ViewMatrix[Row * 4 + 3] = 0.0f;
+        }
+        View.ViewMatrix[15] = 1.0f;
+
+        View.ProjScaleY = 1.0f / tanf(3.14159265f / 6.0f);
+        View.ProjScaleX = View.ProjScaleY / Aspect;
+        View.NearClip = NearClip;
+        View.FarClip = FarClip;
+        return View;
+    }
+
+    // View space x, y and depth (the negated z) of a world position
+    void ToView( const Frustum& View, const float Position[3], double Out[3] )
+    {
+        const float* M = View.ViewMatrix;
+        for (int Row = 0; Row < 3; ++Row)
+            Out[Row] = (double)M[Row] * Position[0] + (double)M[4 + Row] * Position[1] + (double)M[8 + Row] * Position[2] + M[12 + Row];
+        Out[2] = -Out[2];
+    }
+
+    // One cluster as the brute force sees it:  NDC ranges of its tile, its depth range, and the view space
+    // box around its eight corners
+    struct Cluster
+    {
+        double NdcX[2], NdcY[2], Depth[2];
+        double BoxMin[3], BoxMax[3];
+    };
+
+    vector<Cluster> MakeClusters( const LightClusterBuilder& Builder, const Frustum& View )
+    {
+        const uint32_t CountX = Builder.GetCountX(), CountY = Builder.GetCountY(), CountZ = Builder.GetCountZ();
+        vector<Cluster> Clusters(Builder.GetClusterCount());
+
+        for (uint32_t z = 0; z < CountZ; ++z)
+        {
+            for (uint32_t y = 0; y < CountY; ++y)
+            {
+                for (uint32_t x = 0; x < CountX; ++x)
+                {
+                    // Rows are stored top row first
+                    Cluster& C = Clusters[(z * CountY + y) * CountX + x];
+                    C.NdcX[0] = -1.0 + 2.0 * x / CountX;
+                    C.NdcX[1] = -1.0 + 2.0 * (x + 1) / CountX;
+                    C.NdcY[0] = 1.0 - 2.0 * (y + 1) / CountY;
+                    C.NdcY[1] = 1.0 - 2.0 * y / CountY;
+                    C.Depth[0] = View.NearClip * pow((double)View.FarClip / View.NearClip, (double)z / CountZ);
+                    C.Depth[1] = View.NearClip * pow((double)View.FarClip / View.NearClip, (double)(z + 1) / CountZ);
+
+                    for (int i = 0; i < 3; ++i)
+                    {
+                        C.BoxMin[i] = 1e30;
+                        C.BoxMax[i] = -1e30;
+                    }
+                    for (int Corner = 0; Corner < 8; ++Corner)
+                    {
+                        double Depth = C.Depth[Corner & 1];
+                        double P[3] = { C.NdcX[(Corner >> 1) & 1] * Depth / View.ProjScaleX, C.NdcY[Corner >> 2] * Depth / View.ProjScaleY, Depth };
+                        for (int i = 0; i < 3; ++i)
+                        {
+                            C.BoxMin[i] = min(C.BoxMin[i], P[i]);
+                            C.BoxMax[i] = max(C.BoxMax[i], P[i]);
+                        }
+                    }
+                }
+            }
+        }
+        return Clusters;
+    }
+
+    double DistanceToBox( const Cluster& C, const double Center[3], double Closest[3] )
+    {
+        double Dist2 = 0.0;
+        for (int i = 0; i < 3; ++i)
+        {
+            Closest[i] = min(max(Center[i], C.BoxMin[i]), C.BoxMax[i]);
+            Dist2 += (Center[i] - Closest[i]) * (Center[i] - Closest[i]);
+        }
+        return sqrt(Dist2);
+    }
+
+    // Whether a view space point is inside the cluster, and not within Margin of its sides
+    bool InsideCluster( const Cluster& C, const Frustum& View, const double P[3], double Margin )
+    {
+        if (P[2] < C.Depth[0] * (1.0 + Margin) || P[2] > C.Depth[1] * (1.0 - Margin))
+            return false;
+        double NdcX = View.ProjScaleX * P[0] / P[2];
+        double NdcY = View.ProjScaleY * P[1] / P[2];
+        return NdcX > C.NdcX[0] + Margin && NdcX < C.NdcX[1] - Margin && NdcY > C.NdcY[0] + Margin && NdcY < C.NdcY[1] - Margin;
+    }
+
+    // Whether the sphere lies clearly beyond one of the cluster's sides.  Each side is tested on its own:
+    // the tile's four planes through the eye and the slice's two depths, the latter widened by the 0.1%
+    // margin Build() adds.
+    bool OutsideCluster( const Cluster& C, const Frustum& View, const double Center[3], double Radius )
+    {
+        const double Slack = Radius * 1e-3 + 1e-4;
+        if (Center[2] + Radius < C.Depth[0] * 0.998 - Slack || Center[2] - Radius > C.Depth[1] * 1.002 + Slack)
+            return true;
+
+        for (int Axis = 0; Axis < 2; ++Axis)
+        {
+            const double Scale = Axis == 0 ? View.ProjScaleX : View.ProjScaleY;
+            const double* Ndc = Axis == 0 ? C.NdcX : C.NdcY;
+
+            // Signed distances to the planes at the tile's lower and upper NDC coordinates
+            double Lower = (Scale * Center[Axis] - Ndc[0] * Center[2]) / sqrt(Scale * Scale + Ndc[0] * Ndc[0]);
+            double Upper = (Scale * Center[Axis] - Ndc[1] * Center[2]) / sqrt(Scale * Scale + Ndc[1] * Ndc[1]);
+            if (Lower < -Radius - Slack || Upper > Radius + Slack)
+                return true;
+        }
+        return false;
+    }
+
+    // The lights of each cluster, read back from the packed output.  Checks the offsets, the type grouping
+    // and that no cluster lists a light twice.
+    vector<vector<uint32_t>> ReadClusters( const LightClusterBuilder& Builder, const vector<Light>& Lights )
+    {
+        const vector<uint32_t>& Data = Builder.GetClusterData();
+        const vector<uint32_t>& Indices = Builder.GetLightIndices();
+        const uint32_t ClusterCount = Builder.GetClusterCount();
+
+        CHECK_EQUAL(Data.size() % 4, 0u);
+        CHECK_EQUAL(Indices.size() % 4, 0u);
+        CHECK(Data.size() >= ClusterCount * 2);
+
+        vector<vector<uint32_t>> Lists(ClusterCount);
+        uint32_t Offset = 0;
+        bool OffsetsMatch = true, TypesMatch = true, Unique = true;
+        for (uint32_t c = 0; c < ClusterCount; ++c)
+        {
+            OffsetsMatch = OffsetsMatch && Data[c * 2] == Offset;
+            for (uint32_t t = 0; t < LightClusterBuilder::kLightTypeCount; ++t)
+            {
+                uint32_t Count = (Data[c * 2 + 1] >> (t * 10)) & 0x3FF;
+                for (uint32_t i = 0; i < Count && Offset < Indices.size(); ++i, ++Offset)
+                {
+                    uint32_t Index = Indices[Offset];
+                    TypesMatch = TypesMatch && Index < Lights.size() && Lights[Index].Type == t;
+                    Lists[c].push_back(Index);
+                }
+            }
+            Unique = Unique && set<uint32_t>(Lists[c].begin(), Lists[c].end()).size() == Lists[c].size();
+        }
+        CHECK(OffsetsMatch);
+        CHECK(TypesMatch);
+        CHECK(Unique);
+        CHECK(Offset <= Indices.size() && Indices.size() - Offset < 4);
+        return Lists;
+    }
+
+    // Compares Build() with the brute force for every light and cluster.  A cluster must list the light when
+    // the sphere reaches a point inside it:  the point of the cluster's box nearest to the center, or one of
+    // a spread of points in the sphere.  A cluster must not list the light when the sphere misses the box,
+    // unless Build's side-by-side plane test takes it in past a corner, which is conservative by design.
+    // Those extra clusters are counted.
+    void CheckAgainstBruteForce( const LightClusterBuilder& Builder, const Frustum& View, const vector<Light>& Lights,
+        uint32_t& Misses, uint32_t& Strays, uint32_t& SureHits, uint32_t& CornerHits )
+    {
+        vector<Cluster> Clusters = MakeClusters(Builder, View);
+        vector<vector<uint32_t>> Lists = ReadClusters(Builder, Lights);
+
+        vector<set<uint32_t>> Listed(Clusters.size());
+        for (size_t c = 0; c < Clusters.size(); ++c)
+            Listed[c].insert(Lists[c].begin(), Lists[c].end());
+
+        const double kMargin = 1e-4;
+
+        for (uint32_t i = 0; i < (uint32_t)Lights.size(); ++i)
+        {
+            double Center[3];
+            ToView(View, Lights[i].Position, Center);
+            const double Radius = Lights[i].Radius;
+
+            // Points spread through the sphere:  the center and 26 points just inside its surface
+            vector<double> Samples(Center, Center + 3);
+            for (int dx = -1; dx <= 1; ++dx)
+            {
+                for (int dy = -1; dy <= 1; ++dy)
+                {
+                    for (int dz = -1; dz <= 1; ++dz)
+                    {
+                        double Length = sqrt((double)(dx * dx + dy * dy + dz * dz));
+                        if (Length == 0.0)
+                            continue;
+                        double Scale = Radius * 0.999 / Length;
+                        Samples.push_back(Center[0] + dx * Scale);
+                        Samples.push_back(Center[1] + dy * Scale);
+                        Samples.push_back(Center[2] + dz * Scale);
+                    }
+                }
+            }
+
+            for (size_t c = 0; c < Clusters.size(); ++c)
+            {
+                double Closest[3];
+                double Distance = DistanceToBox(Clusters[c], Center, Closest);
+                bool Reaches = Distance < Radius * (1.0 - kMargin) && InsideCluster(Clusters[c], View, Closest, kMargin);
+                for (size_t s = 0; s < Samples.size() && !Reaches; s += 3)
+                    Reaches = InsideCluster(Clusters[c], View, &Samples[s], kMargin);
+
+                bool IsListed = Listed[c].count(i) != 0;
+                if (Reaches)
+                {
+                    ++SureHits;
+                    Misses += IsListed ? 0 : 1;
+                }
+
+                if (IsListed && Distance > Radius)
+                {
+                    if (OutsideCluster(Clusters[c], View, Center, Radius))
+                        ++Strays;
+                    else
+                        ++CornerHits;
+                }
+            }
+        }
+    }
+
+    // Random point, cone and shadowed cone lights in and around the view, some straddling the near plane,
+    // some behind it or behind the camera
+    void TestRandomLights( void )
+    {
+        srand(1);
+        const float Eye[3] = { 3.0f, 2.0f, -4.0f };
+        const float kYaw = 0.6f;
+        Frustum View = MakeFrustum(Eye, kYaw, 16.0f / 9.0f, 0.5f, 60.0f);
+
+        // Places a light at a view space position
+        auto PlaceLight = [&]( float X, float Y, float Depth, float Radius )
+        {
+            Light L;
+            float Back = -Depth;
+            L.Position[0] = Eye[0] + X * cosf(kYaw) + Back * sinf(kYaw);
+            L.Position[1] = Eye[1] + Y;
+            L.Position[2] = Eye[2] - X * sinf(kYaw) + Back * cosf(kYaw);
+            L.Radius = Radius;
+            L.Type = (uint32_t)(rand() % LightClusterBuilder::kLightTypeCount);
+            return L;
+        };
+
+        vector<Light> Lights;
+        for (uint32_t i = 0; i < 600; ++i)
+        {
+            float Depth = Random(-5.0f, 70.0f);
+            float Spread = max(Depth, 1.0f);
+            Lights.push_back(PlaceLight(Random(-Spread, Spread), Random(-0.7f * Spread, 0.7f * Spread), Depth, Random(0.1f, 6.0f)));
+        }
+
+        // Across the near plane, with the center on either side of it
+        for (uint32_t i = 0; i < 60; ++i)
+            Lights.push_back(PlaceLight(Random(-0.5f, 0.5f), Random(-0.3f, 0.3f), Random(0.0f, 1.0f), Random(0.6f, 1.5f)));
+
+        // Entirely in front of the near plane, or behind the far plane
+        const uint32_t FirstHidden = (uint32_t)Lights.size();
+        Lights.push_back(PlaceLight(0.0f, 0.0f, 0.2f, 0.25f));
+        Lights.push_back(PlaceLight(0.0f, 0.0f, -3.0f, 2.0f));
+        Lights.push_back(PlaceLight(1.0f, 0.0f, 65.0f, 4.0f));
+
+        for (uint32_t CountZ : { 24u, 7u })
+        {
+            LightClusterBuilder Builder;
+            Builder.SetGridSize(16, 8, CountZ);
+            Builder.Build(View, Lights.data(), (uint32_t)Lights.size());
+
+            uint32_t Misses = 0, Strays = 0, SureHits = 0, CornerHits = 0;
+            CheckAgainstBruteForce(Builder, View, Lights, Misses, Strays, SureHits, CornerHits);
+            CHECK_EQUAL(Misses, 0u);
+            CHECK_EQUAL(Strays, 0u);
+            CHECK(SureHits > 1000);
+            printf("    %u slices:  %u clusters reached, %u more listed by the plane test\n", CountZ, SureHits, CornerHits);
+
+            // The hidden lights are in no cluster
+            vector<vector<uint32_t>> Lists = ReadClusters(Builder, Lights);
+            bool HiddenListed = false;
+            for (const vector<uint32_t>& List : Lists)
+                for (uint32_t Index : List)
+                    HiddenListed = HiddenListed || Index >= FirstHidden;
+            CHECK(!HiddenListed);
+        }
+    }
+
+    // More than kMaxLightsPerType lights of one type in a cluster are clamped, and the other types still fit
+    void TestClusterOverflow( void )
+    {
+        const float Eye[3] = { 0.0f, 0.0f, 0.0f };
+        Frustum View = MakeFrustum(Eye, 0.0f, 1.0f, 1.0f, 100.0f);
+
+        const uint32_t kPointLights = LightClusterBuilder::kMaxLightsPerType + 77;
+        vector<Light> Lights;
+        for (uint32_t i = 0; i < kPointLights + 5; ++i)
+        {
+            // All in one spot 12 units ahead, small enough to stay within one cluster
+            Light L = { { 0.3f, 0.2f, -12.0f }, 0.01f, i < kPointLights ? 0u : 1u };
+            Lights.push_back(L);
+        }
+
+        LightClusterBuilder Builder;
+        Builder.Build(View, Lights.data(), (uint32_t)Lights.size());
+        vector<vector<uint32_t>> Lists = ReadClusters(Builder, Lights);
+
+        uint32_t Filled = 0;
+        for (size_t c = 0; c < Lists.size(); ++c)
+        {
+            if (Lists[c].empty())
+                continue;
+
+            ++Filled;
+            uint32_t Packed = Builder.GetClusterData()[c * 2 + 1];
+            CHECK_EQUAL(Packed & 0x3FF, (uint32_t)LightClusterBuilder::kMaxLightsPerType);
+            CHECK_EQUAL((Packed >> 10) & 0x3FF, 5u);
+            CHECK_EQUAL(Packed >> 20, 0u);
+            CHECK_EQUAL(Lists[c].size(), LightClusterBuilder::kMaxLightsPerType + 5u);
+        }
+        CHECK_EQUAL(Filled, 1u);
+    }
+}
+
+int main( void )
+{
+    g_JobScheduler.Initialize(4);
+
+    RUN_TEST(TestRandomLights);
+    RUN_TEST(TestClusterOverflow);
+
+    g_JobScheduler.Shutdown();
+    return UnitTest::Report();
+}
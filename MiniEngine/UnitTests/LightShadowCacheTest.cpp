@@ -0,0 +1,183 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of which spot light shadow maps LightShadowCache marks stale when the lights or the
+// scene graph instances around them move.
+//
+
+#include "UnitTest.h"
+#include "pch.h"
+#include "LightShadowCache.h"
+#include "SceneGraph.h"
+#include "Camera.h"
+
+using namespace Math;
+
+namespace
+{
+    // Three lights in a row along X, far enough apart that their bounds don't overlap
+    const uint32_t kLightCount = 3;
+    const float kLightSpacing = 50.0f;
+    const float kLightRadius = 10.0f;
+
+    Vector3 LightPosition( uint32_t Index )
+    {
+        return Vector3(Index * kLightSpacing, 0.0f, 0.0f);
+    }
+
+    Matrix4 LightShadowMatrix( Vector3 Position )
+    {
+        return Matrix4(AffineTransform::MakeTranslation(-Position));
+    }
+
+    void TrackLights( LightShadowCache& Cache )
+    {
+        for (uint32_t i = 0; i < kLightCount; ++i)
+            Cache.UpdateLight(i, BoundingSphere(LightPosition(i), kLightRadius), LightShadowMatrix(LightPosition(i)));
+    }
+
+    // Renders every stale light:  the camera sees all of them and the budget has room for all of them
+    void RenderStaleLights( LightShadowCache& Cache )
+    {
+        Camera ViewCamera;
+        ViewCamera.SetEyeAtUp(Vector3(kLightSpacing, 0.0f, 200.0f), Vector3(kLightSpacing, 0.0f, 0.0f), Vector3(kYUnitVector));
+        ViewCamera.SetPerspectiveMatrix(XM_PIDIV2, 1.0f, 1.0f, 1000.0f);
+        ViewCamera.Update();
+
+        Cache.SetBudget(1000.0f, kLightCount);
+        Cache.Schedule(ViewCamera);
+    }
+
+    SceneGraph::Transform Translation( float X )
+    {
+        SceneGraph::Transform Local = SceneGraph::Transform::Identity();
+        Local.Translation[0] = X;
+        return Local;
+    }
+
+    // A two unit cube, with every light current
+    struct OccluderScene
+    {
+        LightShadowCache Cache;
+        SceneGraph Graph;
+        SceneGraph::NodeId Group;
+        SceneGraph::NodeId Occluder;
+
+        OccluderScene()
+        {
+            SceneGraph::Bounds Cube = { { -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f } };
+            Graph.SetModelBounds(0, Cube);
+            Group = Graph.AddNode(SceneGraph::kInvalidNode, SceneGraph::Transform::Identity());
+            Occluder = Graph.AddNode(Group, Translation(0.0f), 0);
+            Graph.Update();
+
+            Cache.Create(kLightCount);
+            TrackLights(Cache);
+            Cache.InvalidateMovedInstances(Graph);
+            RenderStaleLights(Cache);
+        }
+    };
+
+    void TestMovedLightIsStale( void )
+    {
+        LightShadowCache Cache;
+        Cache.Create(kLightCount);
+        CHECK_EQUAL(Cache.GetStaleCount(), 0u);
+
+        TrackLights(Cache);
+        CHECK_EQUAL(Cache.GetStaleCount(), kLightCount);
+        RenderStaleLights(Cache);
+        CHECK_EQUAL(Cache.GetStaleCount(), 0u);
+
+        // Lights that stay put keep their maps
+        TrackLights(Cache);
+        CHECK_EQUAL(Cache.GetStaleCount(), 0u);
+
+        Vector3 Moved = LightPosition(1) + Vector3(0.0f, 1.0f, 0.0f);
+        Cache.UpdateLight(1, BoundingSphere(Moved, kLightRadius), LightShadowMatrix(Moved));
+        CHECK(!Cache.IsStale(0));
+        CHECK(Cache.IsStale(1));
+        CHECK(!Cache.IsStale(2));
+    }
+
+    // Moving the cube from the first light to the second changes both maps, but not the third
+    void TestMovedOccluderInvalidatesOverlappingLights( void )
+    {
+        OccluderScene Scene;
+        CHECK_EQUAL(Scene.Cache.GetStaleCount(), 0u);
+
+        Scene.Graph.SetLocalTransform(Scene.Occluder, Translation(kLightSpacing));
+        Scene.Graph.Update();
+        CHECK_EQUAL(Scene.Graph.GetMovedInstanceCount(), 1u);
+        TrackLights(Scene.Cache);
+        Scene.Cache.InvalidateMovedInstances(Scene.Graph);
+        CHECK(Scene.Cache.IsStale(0));
+        CHECK(Scene.Cache.IsStale(1));
+        CHECK(!Scene.Cache.IsStale(2));
+        RenderStaleLights(Scene.Cache);
+
+        // Moving it within the second light's bounds leaves the first alone
+        Scene.Graph.SetLocalTransform(Scene.Occluder, Translation(kLightSpacing + 2.0f));
+        Scene.Graph.Update();
+        Scene.Cache.InvalidateMovedInstances(Scene.Graph);
+        CHECK(!Scene.Cache.IsStale(0));
+        CHECK(Scene.Cache.IsStale(1));
+        CHECK(!Scene.Cache.IsStale(2));
+    }
+
+    // The instance moves with its parent
+    void TestMovedParentInvalidatesLights( void )
+    {
+        OccluderScene Scene;
+
+        Scene.Graph.SetLocalTransform(Scene.Group, Translation(2.0f * kLightSpacing));
+        Scene.Graph.Update();
+        Scene.Cache.InvalidateMovedInstances(Scene.Graph);
+        CHECK(Scene.Cache.IsStale(0));
+        CHECK(!Scene.Cache.IsStale(1));
+        CHECK(Scene.Cache.IsStale(2));
+    }
+
+    // A frame where nothing moved reports no moved instances, so nothing is re-rendered
+    void TestStillSceneKeepsMaps( void )
+    {
+        OccluderScene Scene;
+
+        Scene.Graph.Update();
+        CHECK_EQUAL(Scene.Graph.GetMovedInstanceCount(), 0u);
+        TrackLights(Scene.Cache);
+        Scene.Cache.InvalidateMovedInstances(Scene.Graph);
+        CHECK_EQUAL(Scene.Cache.GetStaleCount(), 0u);
+    }
+
+    // An instance moving between two lights without touching either changes neither map
+    void TestOccluderBetweenLights( void )
+    {
+        OccluderScene Scene;
+
+        Scene.Graph.SetLocalTransform(Scene.Occluder, Translation(kLightSpacing * 0.5f));
+        Scene.Graph.Update();
+        Scene.Cache.InvalidateMovedInstances(Scene.Graph);
+        RenderStaleLights(Scene.Cache);
+
+        Scene.Graph.SetLocalTransform(Scene.Occluder, Translation(kLightSpacing * 0.5f + 5.0f));
+        Scene.Graph.Update();
+        Scene.Cache.InvalidateMovedInstances(Scene.Graph);
+        CHECK_EQUAL(Scene.Cache.GetStaleCount(), 0u);
+    }
+}
+
+int main( void )
+{
+    RUN_TEST(TestMovedLightIsStale);
+    RUN_TEST(TestMovedOccluderInvalidatesOverlappingLights);
+    RUN_TEST(TestMovedParentInvalidatesLights);
+    RUN_TEST(TestStillSceneKeepsMaps);
+    RUN_TEST(TestOccluderBetweenLights);
+    return UnitTest::Report();
+}
@@ -0,0 +1,219 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of the statistics behind PerfCompare:  the counter summaries, the Mann-Whitney U
+// test checked against reference values, the verdicts of a comparison, and loading perfreport.csv.
+//
+
+#include "UnitTest.h"
+#include "ART/PerfStat/PerfComparison.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+using namespace ART;
+using namespace std;
+
+namespace
+{
+    vector<float> Sorted( vector<float> Samples )
+    {
+        sort(Samples.begin(), Samples.end());
+        return Samples;
+    }
+
+    // Frame times around Center with a deterministic spread of +-Spread
+    void AddSeries( PerfCapture& Capture, const char* Counter, float Center, float Spread, uint32_t Count )
+    {
+        for (uint32_t i = 0; i < Count; ++i)
+            Capture.AddSample(Counter, Center + Spread * ((float)(i * 7 % 11) / 5.0f - 1.0f));
+    }
+
+    const CounterComparison* Find( const PerfComparison& Comparison, const char* Name )
+    {
+        for (const CounterComparison& Result : Comparison.GetResults())
+        {
+            if (Result.Name == Name)
+                return &Result;
+        }
+        return nullptr;
+    }
+
+    void TestCounterStats( void )
+    {
+        vector<float> Samples = { 5.0f, 1.0f, 4.0f, 2.0f, 3.0f, 100.0f };
+        CounterStats Stats = ComputeCounterStats(Samples);
+
+        CHECK_EQUAL(Stats.Count, 6u);
+        CHECK_NEAR(Stats.Mean, 115.0f / 6.0f, 1e-4f);
+        CHECK_NEAR(Stats.Median, 3.5f, 1e-6f);
+        CHECK_NEAR(Stats.Min, 1.0f, 0.0f);
+        CHECK_NEAR(Stats.Max, 100.0f, 0.0f);
+
+        // Deviations from 3.5 are 0.5, 0.5, 1.5, 1.5, 2.5 and 96.5
+        CHECK_NEAR(Stats.MAD, 1.5f, 1e-6f);
+
+        // Linear interpolation between the closest ranks:  position 0.95 * 5 = 4.75
+        CHECK_NEAR(Stats.P95, 5.0f + 0.75f * 95.0f, 1e-4f);
+        CHECK_NEAR(Stats.P5, 1.25f, 1e-6f);
+        CHECK_EQUAL(Samples.front(), 1.0f);
+
+        vector<float> Empty;
+        CHECK_EQUAL(ComputeCounterStats(Empty).Count, 0u);
+    }
+
+    // The example of R's wilcox.test documentation.  wilcox.test(x, y, exact = FALSE) gives W = 35 and
+    // p = 0.2446.
+    void TestMannWhitneyReference( void )
+    {
+        vector<float> X = Sorted({ 0.80f, 0.83f, 1.89f, 1.04f, 1.45f, 1.38f, 1.91f, 1.64f, 0.73f, 1.46f });
+        vector<float> Y = Sorted({ 1.15f, 0.88f, 0.90f, 0.74f, 1.21f });
+
+        MannWhitneyResult Result = MannWhitneyTest(X, Y);
+        CHECK_NEAR(Result.U, 35.0, 1e-9);
+        CHECK_NEAR(Result.Z, 1.16351, 1e-4);
+        CHECK_NEAR(Result.PValue, 0.24462, 1e-4);
+        CHECK_NEAR(Result.Superiority, 0.3, 1e-9);
+
+        // Swapping the samples gives the complementary U and the same p-value
+        MannWhitneyResult Swapped = MannWhitneyTest(Y, X);
+        CHECK_NEAR(Swapped.U, 15.0, 1e-9);
+        CHECK_NEAR(Swapped.Z, -Result.Z, 1e-9);
+        CHECK_NEAR(Swapped.PValue, Result.PValue, 1e-9);
+    }
+
+    // Ties share their average rank and shrink the variance.  U counts each tie as half a win; the
+    // reference values follow from the tie corrected normal approximation with continuity correction.
+    void TestMannWhitneyTies( void )
+    {
+        vector<float> A = { 1.0f, 2.0f, 2.0f, 3.0f, 5.0f };
+        vector<float> B = { 2.0f, 3.0f, 3.0f, 4.0f, 6.0f, 7.0f };
+
+        MannWhitneyResult Result = MannWhitneyTest(A, B);
+        CHECK_NEAR(Result.U, 7.0, 1e-9);
+        CHECK_NEAR(Result.Z, -1.39490, 1e-4);
+        CHECK_NEAR(Result.PValue, 0.16305, 1e-4);
+        CHECK_NEAR(Result.Superiority, 23.0 / 30.0, 1e-9);
+    }
+
+    void TestMannWhitneyDegenerate( void )
+    {
+        // Every value equal:  no variance, so nothing can be concluded
+        vector<float> Same(10, 4.0f);
+        MannWhitneyResult Result = MannWhitneyTest(Same, Same);
+        CHECK_NEAR(Result.U, 50.0, 1e-9);
+        CHECK_NEAR(Result.PValue, 1.0, 0.0);
+
+        vector<float> Empty;
+        CHECK_NEAR(MannWhitneyTest(Empty, Same).PValue, 1.0, 0.0);
+
+        // Complete separation of 20 against 20 frames
+        vector<float> Low, High;
+        for (int i = 0; i < 20; ++i)
+        {
+            Low.push_back((float)i);
+            High.push_back(100.0f + i);
+        }
+        Result = MannWhitneyTest(Low, High);
+        CHECK_NEAR(Result.U, 0.0, 0.0);
+        CHECK_NEAR(Result.Superiority, 1.0, 0.0);
+        CHECK(Result.PValue < 1e-6);
+    }
+
+    void TestVerdicts( void )
+    {
+        PerfCapture Baseline, Candidate;
+
+        AddSeries(Baseline, "Frame", 10.0f, 0.2f, 200);
+        AddSeries(Candidate, "Frame", 11.0f, 0.2f, 200);
+
+        AddSeries(Baseline, "Shadows", 2.0f, 0.05f, 200);
+        AddSeries(Candidate, "Shadows", 1.5f, 0.05f, 200);
+
+        // Significant with this many frames, but far below both thresholds
+        AddSeries(Baseline, "Text", 1.0f, 0.01f, 200);
+        AddSeries(Candidate, "Text", 1.002f, 0.01f, 200);
+
+        AddSeries(Baseline, "Resolution Scale", 1.0f, 0.01f, 200);
+        AddSeries(Candidate, "Resolution Scale", 0.8f, 0.01f, 200);
+
+        AddSeries(Baseline, "Sparse", 1.0f, 0.01f, 4);
+        AddSeries(Candidate, "Sparse", 9.0f, 0.01f, 4);
+
+        AddSeries(Baseline, "Old Pass", 1.0f, 0.0f, 20);
+        AddSeries(Candidate, "New Pass", 1.0f, 0.0f, 20);
+
+        PerfComparison Comparison;
+        Comparison.Compare(Baseline, Candidate, PerfCompareOptions());
+
+        CHECK(Find(Comparison, "Frame") != nullptr && Find(Comparison, "Frame")->Verdict == PerfVerdict::Regressed);
+        CHECK(Find(Comparison, "Shadows") != nullptr && Find(Comparison, "Shadows")->Verdict == PerfVerdict::Improved);
+        CHECK(Find(Comparison, "Text") != nullptr && Find(Comparison, "Text")->Verdict == PerfVerdict::Unchanged);
+        CHECK(Find(Comparison, "Resolution Scale") != nullptr &&
+            Find(Comparison, "Resolution Scale")->Verdict == PerfVerdict::Regressed);
+        CHECK(Find(Comparison, "Sparse") != nullptr && Find(Comparison, "Sparse")->Verdict == PerfVerdict::Inconclusive);
+        CHECK(Find(Comparison, "Old Pass") != nullptr && Find(Comparison, "Old Pass")->Verdict == PerfVerdict::Removed);
+        CHECK(Find(Comparison, "New Pass") != nullptr && Find(Comparison, "New Pass")->Verdict == PerfVerdict::Added);
+
+        CHECK_EQUAL(Comparison.GetCount(PerfVerdict::Regressed), 2u);
+        CHECK_NEAR(Find(Comparison, "Frame")->MedianDelta, 1.0f, 1e-4f);
+        CHECK_NEAR(Find(Comparison, "Frame")->RelativeDelta, 0.1f, 1e-4f);
+
+        // A filter keeps only the counters it names
+        PerfCompareOptions Options;
+        Options.Filter.push_back("Shadow");
+        Comparison.Compare(Baseline, Candidate, Options);
+        CHECK_EQUAL(Comparison.GetResults().size(), (size_t)1);
+    }
+
+    // perfreport.csv holds one row per counter, every value followed by a comma; -1 marks frames before
+    // the counter appeared
+    void TestLoadReportCsv( void )
+    {
+        const char* Path = "PerfComparisonTest.csv";
+        {
+            ofstream File(Path);
+            File << "Frame,9.0,10.0,11.0,12.0,\n";
+            File << "Late,-1,-1,3.5,4.5,\n";
+            File << "\n";
+        }
+
+        PerfCapture Capture;
+        string Error;
+        CHECK(Capture.Load(Path, 1, Error));
+        CHECK(Error.empty());
+        CHECK_EQUAL(Capture.GetSources().size(), (size_t)1);
+
+        const auto& Counters = Capture.GetCounters();
+        CHECK_EQUAL(Counters.size(), (size_t)2);
+        CHECK(Counters.at("Frame") == vector<float>({ 10.0f, 11.0f, 12.0f }));
+        CHECK(Counters.at("Late") == vector<float>({ 3.5f, 4.5f }));
+
+        {
+            ofstream File(Path);
+            File << "Frame,9.0,oops,\n";
+        }
+        PerfCapture Bad;
+        CHECK(!Bad.Load(Path, 0, Error));
+        CHECK(!Error.empty());
+
+        remove(Path);
+    }
+}
+
+int main( void )
+{
+    RUN_TEST(TestCounterStats);
+    RUN_TEST(TestMannWhitneyReference);
+    RUN_TEST(TestMannWhitneyTies);
+    RUN_TEST(TestMannWhitneyDegenerate);
+    RUN_TEST(TestVerdicts);
+    RUN_TEST(TestLoadReportCsv);
+    return UnitTest::Report();
+}
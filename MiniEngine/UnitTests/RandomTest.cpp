@@ -0,0 +1,240 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of the Philox random number generator:  the known-answer vectors of the Philox4x32-10
+// reference, that Seek and the bulk fills produce exactly the sequence of NextUint and NextFloat, and that
+// the integer ranges hold.
+//
+
+#include "UnitTest.h"
+#include "Math/Random.h"
+
+#include <climits>
+#include <vector>
+
+using namespace std;
+using Math::RandomNumberGenerator;
+
+namespace
+{
+    // Philox4x32-10 as written in the reference paper, one round at a time
+    void ReferencePhilox( const uint32_t Counter[4], const uint32_t Key[2], uint32_t Out[4] )
+    {
+        uint32_t C[4] = { Counter[0], Counter[1], Counter[2], Counter[3] };
+        uint32_t K[2] = { Key[0], Key[1] };
+
+        for (uint32_t Round = 0; Round < 10; ++Round)
+        {
+            uint64_t P0 = (uint64_t)0xD2511F53 * C[0];
+            uint64_t P1 = (uint64_t)0xCD9E8D57 * C[2];
+            uint32_t Next[4] = { (uint32_t)(P1 >> 32) ^ C[1] ^ K[0], (uint32_t)P1, (uint32_t)(P0 >> 32) ^ C[3] ^ K[1], (uint32_t)P0 };
+            for (uint32_t i = 0; i < 4; ++i)
+                C[i] = Next[i];
+            K[0] += 0x9E3779B9;
+            K[1] += 0xBB67AE85;
+        }
+
+        for (uint32_t i = 0; i < 4; ++i)
+            Out[i] = C[i];
+    }
+
+    // The Nth value of a seed and stream, from the reference
+    uint32_t ReferenceValue( uint64_t Seed, uint64_t Stream, uint64_t Position )
+    {
+        uint64_t Block = Position / 4;
+        uint32_t Counter[4] = { (uint32_t)Block, (uint32_t)(Block >> 32), (uint32_t)Stream, (uint32_t)(Stream >> 32) };
+        uint32_t Key[2] = { (uint32_t)Seed, (uint32_t)(Seed >> 32) };
+        uint32_t Out[4];
+        ReferencePhilox(Counter, Key, Out);
+        return Out[Position % 4];
+    }
+
+    void TestKnownAnswers( void )
+    {
+        // The known-answer vectors published with the Philox reference implementation
+        struct Vector
+        {
+            uint32_t Counter[4];
+            uint32_t Key[2];
+            uint32_t Expected[4];
+        };
+        const Vector kVectors[] =
+        {
+            { { 0x00000000, 0x00000000, 0x00000000, 0x00000000 }, { 0x00000000, 0x00000000 },
+                { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 } },
+            { { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff }, { 0xffffffff, 0xffffffff },
+                { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd } },
+            { { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 }, { 0xa4093822, 0x299f31d0 },
+                { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } },
+        };
+
+        for (const Vector& V : kVectors)
+        {
+            uint32_t Out[4];
+            ReferencePhilox(V.Counter, V.Key, Out);
+            for (uint32_t i = 0; i < 4; ++i)
+                CHECK_EQUAL(Out[i], V.Expected[i]);
+        }
+
+        // Counter 0 and key 0 are the first block of seed 0, stream 0
+        RandomNumberGenerator Rng(0, 0);
+        for (uint32_t i = 0; i < 4; ++i)
+            CHECK_EQUAL(Rng.NextUint(), kVectors[0].Expected[i]);
+
+        // The stream fills the high half of the counter and the seed is the key
+        RandomNumberGenerator Keyed(0x299f31d0a4093822ull, 0x0370734413198a2eull);
+        for (uint64_t i = 0; i < 64; ++i)
+            CHECK_EQUAL(Keyed.NextUint(), ReferenceValue(0x299f31d0a4093822ull, 0x0370734413198a2eull, i));
+    }
+
+    // Seek lands on the same value sequential generation reaches, at any offset within a block
+    void TestSeek( void )
+    {
+        const uint64_t kSeed = 0x0123456789ABCDEFull;
+        const uint64_t kPositions[] = { 0, 1, 3, 4, 7, 1001, 4ull * 0xFFFFFFFFull + 1 };
+
+        RandomNumberGenerator Rng(kSeed, 7);
+        for (uint64_t Position : kPositions)
+        {
+            Rng.Seek(Position);
+            for (uint64_t i = 0; i < 9; ++i)
+                CHECK_EQUAL(Rng.NextUint(), ReferenceValue(kSeed, 7, Position + i));
+        }
+
+        // SetSeed starts the stream over
+        Rng.SetSeed(kSeed, 7);
+        CHECK_EQUAL(Rng.NextUint(), ReferenceValue(kSeed, 7, 0));
+    }
+
+    // Fill(uint32_t*) is NextUint() called Count times:  partial blocks on either side, the four-counter
+    // SIMD path, and a counter that carries into its high word within one SIMD batch
+    void TestFillUint( void )
+    {
+        const uint64_t kStarts[] = { 0, 1, 2, 3, 5, 4ull * 0xFFFFFFFEull + 3 };
+        const size_t kCounts[] = { 0, 1, 3, 5, 15, 16, 17, 33, 63, 1001 };
+
+        for (uint64_t Start : kStarts)
+        {
+            for (size_t Count : kCounts)
+            {
+                RandomNumberGenerator Bulk(42, 3), Single(42, 3);
+                Bulk.Seek(Start);
+                Single.Seek(Start);
+
+                vector<uint32_t> Values(Count + 1, 0xDEADBEEF);
+                Bulk.Fill(Values.data(), Count);
+
+                bool Match = true;
+                for (size_t i = 0; i < Count; ++i)
+                    Match = Match && Values[i] == Single.NextUint();
+                CHECK(Match);
+                CHECK_EQUAL(Values[Count], 0xDEADBEEFu);
+
+                // Both continue from the same place
+                CHECK_EQUAL(Bulk.NextUint(), Single.NextUint());
+            }
+        }
+    }
+
+    // Fill(float*) is NextFloat(MinVal, MaxVal) called Count times, bit for bit
+    void TestFillFloat( void )
+    {
+        struct Range { float MinVal, MaxVal; };
+        const Range kRanges[] = { { 0.0f, 1.0f }, { -1.0f, 1.0f }, { 10.0f, 10.5f }, { 3.0f, -7.25f } };
+        const uint64_t kStarts[] = { 0, 1, 3, 6 };
+        const size_t kCounts[] = { 1, 2, 7, 18, 37, 255 };
+
+        for (const Range& R : kRanges)
+        {
+            for (uint64_t Start : kStarts)
+            {
+                for (size_t Count : kCounts)
+                {
+                    RandomNumberGenerator Bulk(9, 1), Single(9, 1);
+                    Bulk.Seek(Start);
+                    Single.Seek(Start);
+
+                    vector<float> Values(Count);
+                    Bulk.Fill(Values.data(), Count, R.MinVal, R.MaxVal);
+
+                    bool Match = true, InRange = true;
+                    for (size_t i = 0; i < Count; ++i)
+                    {
+                        float Expected = Single.NextFloat(R.MinVal, R.MaxVal);
+                        Match = Match && Values[i] == Expected;
+                        float Lo = R.MinVal < R.MaxVal ? R.MinVal : R.MaxVal;
+                        float Hi = R.MinVal < R.MaxVal ? R.MaxVal : R.MinVal;
+                        InRange = InRange && Values[i] >= Lo && Values[i] <= Hi;
+                    }
+                    CHECK(Match);
+                    CHECK(InRange);
+                    CHECK_EQUAL(Bulk.NextUint(), Single.NextUint());
+                }
+            }
+        }
+
+        // The default range is [0, 1)
+        RandomNumberGenerator Bulk(5), Single(5);
+        float Values[21];
+        Bulk.Fill(Values, 21);
+        for (float Value : Values)
+        {
+            CHECK_EQUAL(Value, Single.NextFloat());
+            CHECK(Value >= 0.0f && Value < 1.0f);
+        }
+    }
+
+    // NextInt(MaxVal) is in [0, MaxVal] and NextInt(MinVal, MaxVal) is in [MinVal, MaxVal], ends included
+    void TestIntRanges( void )
+    {
+        RandomNumberGenerator Rng(77);
+
+        for (int32_t MaxVal : { 0, 1, 2, 5, 100, INT_MAX })
+        {
+            int32_t Lowest = INT_MAX, Highest = INT_MIN;
+            for (uint32_t i = 0; i < 2000; ++i)
+            {
+                int32_t Value = Rng.NextInt(MaxVal);
+                CHECK(Value >= 0 && Value <= MaxVal);
+                Lowest = Value < Lowest ? Value : Lowest;
+                Highest = Value > Highest ? Value : Highest;
+            }
+
+            // Small ranges are covered end to end
+            if (MaxVal <= 100)
+            {
+                CHECK_EQUAL(Lowest, 0);
+                CHECK_EQUAL(Highest, MaxVal);
+            }
+        }
+
+        for (uint32_t i = 0; i < 2000; ++i)
+        {
+            int32_t Value = Rng.NextInt(-3, 3);
+            CHECK(Value >= -3 && Value <= 3);
+            Value = Rng.NextInt(INT_MIN, INT_MAX);
+            CHECK(Value >= INT_MIN && Value <= INT_MAX);
+            CHECK_EQUAL(Rng.NextInt(-8, -8), -8);
+        }
+
+        // A full-range draw keeps every bit
+        RandomNumberGenerator A(12), B(12);
+        for (uint32_t i = 0; i < 16; ++i)
+            CHECK_EQUAL((uint32_t)A.NextInt(INT_MIN, INT_MAX), B.NextUint() ^ 0x80000000u);
+    }
+}
+
+int main( void )
+{
+    RUN_TEST(TestKnownAnswers);
+    RUN_TEST(TestSeek);
+    RUN_TEST(TestFillUint);
+    RUN_TEST(TestFillFloat);
+    RUN_TEST(TestIntRanges);
+    return UnitTest::Report();
+}
@@ -0,0 +1,275 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of SceneGraph against a brute-force walk up each node's ancestors:  world matrices
+// and bounds after the first update and after random moves, and which nodes each update touches.
+//
+
+#include "UnitTest.h"
+#include "SceneGraph.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    typedef SceneGraph::Transform Transform;
+    typedef SceneGraph::Matrix Matrix;
+    typedef SceneGraph::Bounds Bounds;
+
+    float Random( float Low, float High )
+    {
+        return Low + (High - Low) * (float)rand() / (float)RAND_MAX;
+    }
+
+    Transform RandomTransform( void )
+    {
+        Transform Local;
+        for (int i = 0; i < 3; ++i)
+        {
+            Local.Translation[i] = Random(-10.0f, 10.0f);
+            Local.Scale[i] = Random(0.5f, 1.5f);
+        }
+
+        float Length = 0.0f;
+        for (int i = 0; i < 4; ++i)
+        {
+            Local.Rotation[i] = Random(-1.0f, 1.0f);
+            Length += Local.Rotation[i] * Local.Rotation[i];
+        }
+        for (int i = 0; i < 4; ++i)
+            Local.Rotation[i] /= sqrtf(Length);
+
+        return Local;
+    }
+
+    // The world matrix by composing every ancestor, independent of the graph's update order
+    Matrix BruteForceWorld( const SceneGraph& Graph, SceneGraph::NodeId Node )
+    {
+        Matrix World;
+        SceneGraph::ComposeLocal(Graph.GetLocalTransform(Node), World);
+        for (SceneGraph::NodeId Parent = Graph.GetParent(Node); Parent != SceneGraph::kInvalidNode; Parent = Graph.GetParent(Parent))
+        {
+            Matrix Local, Result;
+            SceneGraph::ComposeLocal(Graph.GetLocalTransform(Parent), Local);
+            SceneGraph::Multiply(Local, World, Result);
+            World = Result;
+        }
+        return World;
+    }
+
+    // Relative to the size of the matrix, which grows with the depth of the hierarchy
+    bool MatricesMatch( const Matrix& A, const Matrix& B )
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            if (fabsf(A.m[i] - B.m[i]) > 1e-4f * max(1.0f, fabsf(B.m[i])))
+                return false;
+        }
+        return true;
+    }
+
+    // Every world matrix and instance bound agrees with the brute-force result, and the scene bounds
+    // enclose exactly the instance bounds
+    uint32_t CountMismatches( const SceneGraph& Graph, const Bounds& ModelBounds )
+    {
+        uint32_t Mismatches = 0;
+        for (SceneGraph::NodeId Node = 0; Node < Graph.GetNodeCount(); ++Node)
+        {
+            if (!MatricesMatch(Graph.GetWorldMatrix(Node), BruteForceWorld(Graph, Node)))
+                ++Mismatches;
+        }
+
+        Bounds Scene = { { 1e30f, 1e30f, 1e30f }, { -1e30f, -1e30f, -1e30f } };
+        for (uint32_t Instance = 0; Instance < Graph.GetInstanceCount(); ++Instance)
+        {
+            Bounds Expected;
+            SceneGraph::TransformBounds(BruteForceWorld(Graph, Graph.GetInstanceNode(Instance)), ModelBounds, Expected);
+            const Bounds& Actual = Graph.GetInstanceBounds(Instance);
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                if (fabsf(Actual.Min[Axis] - Expected.Min[Axis]) > 1e-2f || fabsf(Actual.Max[Axis] - Expected.Max[Axis]) > 1e-2f)
+                {
+                    ++Mismatches;
+                    break;
+                }
+            }
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                Scene.Min[Axis] = min(Scene.Min[Axis], Actual.Min[Axis]);
+                Scene.Max[Axis] = max(Scene.Max[Axis], Actual.Max[Axis]);
+            }
+        }
+
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            if (Scene.Min[Axis] != Graph.GetSceneBounds().Min[Axis] || Scene.Max[Axis] != Graph.GetSceneBounds().Max[Axis])
+                ++Mismatches;
+        }
+        return Mismatches;
+    }
+
+    // A random forest several levels deep, with more nodes per level than one update chunk so that the
+    // levels are spread over the workers
+    void BuildRandomGraph( SceneGraph& Graph, uint32_t NodeCount )
+    {
+        for (SceneGraph::NodeId Node = 0; Node < NodeCount; ++Node)
+        {
+            SceneGraph::NodeId Parent = Node < 4 ? SceneGraph::kInvalidNode : (SceneGraph::NodeId)(Node / 2 + rand() % (Node / 2));
+            Graph.AddNode(Parent, RandomTransform(), rand() % 3 == 0 ? SceneGraph::kNoModel : 0);
+        }
+    }
+
+    const Bounds kModelBounds = { { -1.0f, -2.0f, -0.5f }, { 1.0f, 2.0f, 0.5f } };
+
+    // A known rotation, translation and scale
+    void TestKnownHierarchy( void )
+    {
+        SceneGraph Graph;
+        Graph.SetModelBounds(0, kModelBounds);
+
+        // 90 degrees about Y takes X to -Z
+        Transform Root = Transform::Identity();
+        Root.Translation[0] = 10.0f;
+        Root.Rotation[1] = sqrtf(0.5f);
+        Root.Rotation[3] = sqrtf(0.5f);
+        SceneGraph::NodeId RootNode = Graph.AddNode(SceneGraph::kInvalidNode, Root);
+
+        Transform Child = Transform::Identity();
+        Child.Translation[0] = 1.0f;
+        Child.Scale[0] = Child.Scale[1] = Child.Scale[2] = 2.0f;
+        SceneGraph::NodeId ChildNode = Graph.AddNode(RootNode, Child, 0);
+        Graph.Update();
+
+        const float* M = Graph.GetWorldMatrix(ChildNode).m;
+        CHECK_NEAR(M[12], 10.0f, 1e-5);
+        CHECK_NEAR(M[13], 0.0f, 1e-5);
+        CHECK_NEAR(M[14], -1.0f, 1e-5);
+        CHECK_NEAR(M[0], 0.0f, 1e-5);
+        CHECK_NEAR(M[2], -2.0f, 1e-5);
+
+        // The box's Z extent now lies along X, doubled
+        const Bounds& Box = Graph.GetInstanceBounds(0);
+        CHECK_NEAR(Box.Min[0], 9.0f, 1e-5);
+        CHECK_NEAR(Box.Max[0], 11.0f, 1e-5);
+        CHECK_NEAR(Box.Min[1], -4.0f, 1e-5);
+        CHECK_NEAR(Box.Min[2], -3.0f, 1e-5);
+        CHECK_NEAR(Box.Max[2], 1.0f, 1e-5);
+        CHECK_EQUAL(Graph.GetInstanceCount(), 1u);
+        CHECK_EQUAL(CountMismatches(Graph, kModelBounds), 0u);
+    }
+
+    void TestRandomHierarchy( void )
+    {
+        srand(42);
+        SceneGraph Graph;
+        Graph.SetModelBounds(0, kModelBounds);
+        BuildRandomGraph(Graph, 5000);
+
+        Graph.Update();
+        CHECK_EQUAL(Graph.GetLastUpdateCount(), 5000u);
+        CHECK_EQUAL(Graph.GetMovedInstanceCount(), Graph.GetInstanceCount());
+        CHECK_EQUAL(CountMismatches(Graph, kModelBounds), 0u);
+
+        // Move random nodes, some of them roots of large subtrees, and check everything again
+        for (uint32_t Round = 0; Round < 5; ++Round)
+        {
+            for (uint32_t i = 0; i < 50; ++i)
+                Graph.SetLocalTransform(rand() % Graph.GetNodeCount(), RandomTransform());
+            Graph.Update();
+            CHECK_EQUAL(CountMismatches(Graph, kModelBounds), 0u);
+        }
+    }
+
+    // Only the moved node and its descendants are recomputed, and moved instances report their old bounds
+    void TestIncrementalUpdate( void )
+    {
+        srand(7);
+        SceneGraph Graph;
+        Graph.SetModelBounds(0, kModelBounds);
+        BuildRandomGraph(Graph, 2000);
+        Graph.Update();
+
+        Graph.Update();
+        CHECK_EQUAL(Graph.GetLastUpdateCount(), 0u);
+        CHECK_EQUAL(Graph.GetMovedInstanceCount(), 0u);
+
+        const SceneGraph::NodeId Moved = 700;
+        uint32_t Descendants = 0, DescendantInstances = 0;
+        for (SceneGraph::NodeId Node = 0; Node < Graph.GetNodeCount(); ++Node)
+        {
+            for (SceneGraph::NodeId Ancestor = Node; Ancestor != SceneGraph::kInvalidNode; Ancestor = Graph.GetParent(Ancestor))
+            {
+                if (Ancestor == Moved)
+                {
+                    ++Descendants;
+                    if (Graph.GetModelIndex(Node) != SceneGraph::kNoModel)
+                        ++DescendantInstances;
+                    break;
+                }
+            }
+        }
+
+        vector<Bounds> Before;
+        for (uint32_t Instance = 0; Instance < Graph.GetInstanceCount(); ++Instance)
+            Before.push_back(Graph.GetInstanceBounds(Instance));
+
+        Graph.SetLocalTransform(Moved, RandomTransform());
+        Graph.Update();
+        CHECK_EQUAL(Graph.GetLastUpdateCount(), Descendants);
+        CHECK_EQUAL(Graph.GetMovedInstanceCount(), DescendantInstances);
+        CHECK_EQUAL(CountMismatches(Graph, kModelBounds), 0u);
+
+        bool PreviousMatches = true;
+        for (uint32_t i = 0; i < Graph.GetMovedInstanceCount(); ++i)
+        {
+            const Bounds& Previous = Graph.GetPreviousBounds(i);
+            const Bounds& Expected = Before[Graph.GetMovedInstance(i)];
+            for (int Axis = 0; Axis < 3; ++Axis)
+                PreviousMatches &= Previous.Min[Axis] == Expected.Min[Axis] && Previous.Max[Axis] == Expected.Max[Axis];
+        }
+        CHECK(PreviousMatches);
+    }
+
+    // Changing a model's bounds refits its instances without moving any matrix
+    void TestModelBounds( void )
+    {
+        SceneGraph Graph;
+        SceneGraph::NodeId Root = Graph.AddNode(SceneGraph::kInvalidNode, Transform::Identity());
+        Graph.AddNode(Root, Transform::Identity(), 0);
+        Graph.AddNode(Root, Transform::Identity(), 1);
+        Graph.Update();
+
+        // No bounds for the model yet
+        CHECK(Graph.GetInstanceBounds(0).Min[0] > Graph.GetInstanceBounds(0).Max[0]);
+
+        Graph.SetModelBounds(0, kModelBounds);
+        Graph.Update();
+        CHECK_EQUAL(Graph.GetMovedInstanceCount(), 1u);
+        CHECK_NEAR(Graph.GetInstanceBounds(0).Max[1], 2.0f, 1e-6);
+        CHECK_NEAR(Graph.GetSceneBounds().Min[1], -2.0f, 1e-6);
+    }
+}
+
+int main( void )
+{
+    g_JobScheduler.Initialize(4);
+
+    RUN_TEST(TestKnownHierarchy);
+    RUN_TEST(TestRandomHierarchy);
+    RUN_TEST(TestIncrementalUpdate);
+    RUN_TEST(TestModelBounds);
+
+    g_JobScheduler.Shutdown();
+    return UnitTest::Report();
+}
@@ -0,0 +1,252 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of the sun shadow cascade fitting in ShadowCamera:  the split distances, the slice
+// bounding spheres, the bounds of each cascade's shadow volume, and the texel snapping that keeps shadow
+// edges from shimmering as the camera moves and turns.
+//
+
+#include "UnitTest.h"
+#include "pch.h"
+#include "ShadowCamera.h"
+
+using namespace Math;
+using namespace GameCore;
+
+namespace
+{
+    const uint32_t kBufferSize = 2048;
+
+    // ModelViewer's default view:  45 degree vertical field of view at 16:9
+    const float kTanHalfFovY = 0.41421356f;
+    const float kTanHalfFovX = kTanHalfFovY * 16.0f / 9.0f;
+
+    const Vector3 kCasterMin(-500.0f, -50.0f, -500.0f);
+    const Vector3 kCasterMax(500.0f, 150.0f, 500.0f);
+
+    Vector3 LightDirection( void )
+    {
+        return Normalize(Vector3(0.3f, -1.0f, 0.45f));
+    }
+
+    // The eight corners of the frustum slice between two view distances
+    void GetSliceCorners( Vector3 Position, Vector3 Forward, Vector3 Right, Vector3 Up, float NearDist, float FarDist,
+        Vector3* Corners )
+    {
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            float Dist = (i & 4) ? FarDist : NearDist;
+            float X = (i & 1) ? kTanHalfFovX : -kTanHalfFovX;
+            float Y = (i & 2) ? kTanHalfFovY : -kTanHalfFovY;
+            Corners[i] = Position + (Forward + Right * X + Up * Y) * Dist;
+        }
+    }
+
+    // Shadow texture coordinates, x and y in texels
+    Vector3 ToShadowTexels( const ShadowCamera& Shadow, Vector3 Point )
+    {
+        Vector4 Coord = Shadow.GetShadowMatrix() * Point;
+        return Vector3((float)Coord.GetX() * kBufferSize, (float)Coord.GetY() * kBufferSize, Coord.GetZ());
+    }
+
+    float Frac( float x )
+    {
+        return x - floorf(x);
+    }
+
+    // Distance between two fractions on the unit circle, so 0.999 and 0.001 are close
+    float FracDistance( float a, float b )
+    {
+        float d = fabsf(Frac(a) - Frac(b));
+        return d < 0.5f ? d : 1.0f - d;
+    }
+
+    void TestCascadeSplits( void )
+    {
+        float Splits[5];
+
+        ComputeCascadeSplits(1.0f, 1000.0f, 4, 0.0f, Splits);
+        CHECK_NEAR(Splits[0], 1.0f, 1e-5);
+        CHECK_NEAR(Splits[1], 250.75f, 1e-3);
+        CHECK_NEAR(Splits[2], 500.5f, 1e-3);
+        CHECK_NEAR(Splits[4], 1000.0f, 1e-5);
+
+        ComputeCascadeSplits(1.0f, 1000.0f, 3, 1.0f, Splits);
+        CHECK_NEAR(Splits[1], 10.0f, 1e-3);
+        CHECK_NEAR(Splits[2], 100.0f, 1e-2);
+        CHECK_NEAR(Splits[3], 1000.0f, 1e-5);
+
+        ComputeCascadeSplits(0.5f, 2000.0f, 4, 0.8f, Splits);
+        for (uint32_t i = 0; i < 4; ++i)
+            CHECK(Splits[i] < Splits[i + 1]);
+
+        ComputeCascadeSplits(1.0f, 100.0f, 1, 0.5f, Splits);
+        CHECK_NEAR(Splits[0], 1.0f, 1e-5);
+        CHECK_NEAR(Splits[1], 100.0f, 1e-5);
+    }
+
+    // Every corner of the slice is inside the sphere, and the farthest one is on it
+    void TestSliceSphereEnclosesSlice( void )
+    {
+        const Vector3 Position(10.0f, 2.0f, -7.0f);
+        const Vector3 Forward = Normalize(Vector3(1.0f, -0.2f, 0.5f));
+        const Vector3 Right = Normalize(Cross(Forward, Vector3(kYUnitVector)));
+        const Vector3 Up = Cross(Right, Forward);
+
+        // Narrow slices have their center between the planes; the last two are wide enough to clamp it
+        const float Ranges[][2] = { { 1.0f, 2.0f }, { 20.0f, 60.0f }, { 300.0f, 1000.0f }, { 1.0f, 100.0f }, { 0.1f, 1000.0f } };
+        for (const float* Range : Ranges)
+        {
+            BoundingSphere Sphere = ComputeFrustumSliceSphere(Position, Forward, kTanHalfFovX, kTanHalfFovY, Range[0], Range[1]);
+            const float Radius = Sphere.GetRadius();
+
+            Vector3 Corners[8];
+            GetSliceCorners(Position, Forward, Right, Up, Range[0], Range[1], Corners);
+
+            float Farthest = 0.0f;
+            for (const Vector3& Corner : Corners)
+                Farthest = std::max(Farthest, (float)Length(Corner - Sphere.GetCenter()));
+
+            CHECK(Farthest <= Radius * 1.0001f);
+            CHECK(Farthest >= Radius * 0.9999f);
+
+            // The center stays on the view axis and never passes the far plane
+            const float CenterDist = Dot(Sphere.GetCenter() - Position, Forward);
+            CHECK_NEAR(Length(Sphere.GetCenter() - Position), CenterDist, 1e-3 * Range[1]);
+            CHECK(CenterDist <= Range[1] * 1.0001f);
+        }
+    }
+
+    // Turning the camera moves the sphere but never changes its radius, so the texel size stays fixed
+    void TestSliceSphereRadiusIgnoresOrientation( void )
+    {
+        const Vector3 Position(0.0f, 5.0f, 0.0f);
+        const float Reference = ComputeFrustumSliceSphere(Position, Vector3(kZUnitVector), kTanHalfFovX, kTanHalfFovY, 10.0f, 80.0f).GetRadius();
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            float Yaw = i * 0.39f, Pitch = -0.6f + i * 0.07f;
+            Vector3 Forward(cosf(Pitch) * sinf(Yaw), sinf(Pitch), cosf(Pitch) * cosf(Yaw));
+            float Radius = ComputeFrustumSliceSphere(Position, Forward, kTanHalfFovX, kTanHalfFovY, 10.0f, 80.0f).GetRadius();
+            CHECK_NEAR(Radius, Reference, 1e-4 * Reference);
+        }
+    }
+
+    // Receivers land inside the shadow map, and casters toward the light are not clipped by the near plane
+    void TestCascadeBoundsFit( void )
+    {
+        const Vector3 Position(40.0f, 10.0f, -25.0f);
+        const Vector3 Forward = Normalize(Vector3(-0.4f, -0.1f, 1.0f));
+        const Vector3 Right = Normalize(Cross(Forward, Vector3(kYUnitVector)));
+        const Vector3 Up = Cross(Right, Forward);
+
+        float Splits[5];
+        ComputeCascadeSplits(1.0f, 300.0f, 4, 0.8f, Splits);
+
+        for (uint32_t Cascade = 0; Cascade < 4; ++Cascade)
+        {
+            BoundingSphere Receivers = ComputeFrustumSliceSphere(Position, Forward, kTanHalfFovX, kTanHalfFovY,
+                Splits[Cascade], Splits[Cascade + 1]);
+
+            ShadowCamera Shadow;
+            Shadow.UpdateCascade(LightDirection(), Receivers, kCasterMin, kCasterMax, kBufferSize, kBufferSize, 16);
+
+            Vector3 Corners[8];
+            GetSliceCorners(Position, Forward, Right, Up, Splits[Cascade], Splits[Cascade + 1], Corners);
+            for (const Vector3& Corner : Corners)
+            {
+                Vector4 Coord = Shadow.GetShadowMatrix() * Corner;
+                CHECK(Coord.GetX() >= 0.0f && Coord.GetX() <= 1.0f);
+                CHECK(Coord.GetY() >= 0.0f && Coord.GetY() <= 1.0f);
+                CHECK(Coord.GetZ() >= 0.0f && Coord.GetZ() <= 1.0f);
+            }
+
+            // A caster at the top of the caster box, directly between the light and the slice's center
+            const Vector3 Center = Receivers.GetCenter();
+            const float Lift = ((float)kCasterMax.GetY() - (float)Center.GetY()) / -(float)LightDirection().GetY();
+            const Vector3 Caster = Center - LightDirection() * Lift;
+            Vector4 CasterCoord = Shadow.GetShadowMatrix() * Caster;
+            CHECK(CasterCoord.GetZ() >= -1e-4f && CasterCoord.GetZ() <= 1.0f);
+
+            // Casters beside the cascade's footprint are culled, ones inside it are kept
+            CHECK(Shadow.IntersectBoundingBox(Caster - Vector3(1.0f, 1.0f, 1.0f), Caster + Vector3(1.0f, 1.0f, 1.0f)));
+            const Vector3 Aside = Center + Shadow.GetRightVec() * (3.0f * Receivers.GetRadius());
+            CHECK(!Shadow.IntersectBoundingBox(Aside - Vector3(1.0f, 1.0f, 1.0f), Aside + Vector3(1.0f, 1.0f, 1.0f)));
+        }
+    }
+
+    // Moving the camera by fractions of a texel shifts the shadow map by whole texels only:  a fixed world
+    // point keeps the same position within its texel
+    void TestTexelSnappingOnMove( void )
+    {
+        const Vector3 Forward = Normalize(Vector3(0.2f, -0.3f, 1.0f));
+        const Vector3 Probe(31.7f, 0.0f, 64.2f);
+
+        ShadowCamera Reference;
+        Reference.UpdateCascade(LightDirection(), ComputeFrustumSliceSphere(Vector3(20.0f, 8.0f, 30.0f), Forward,
+            kTanHalfFovX, kTanHalfFovY, 5.0f, 60.0f), kCasterMin, kCasterMax, kBufferSize, kBufferSize, 16);
+        const Vector3 ReferenceTexels = ToShadowTexels(Reference, Probe);
+
+        for (uint32_t Step = 1; Step <= 40; ++Step)
+        {
+            // Steps of a few hundredths of a unit, far smaller than a texel at this range
+            const Vector3 Position(20.0f + Step * 0.037f, 8.0f + Step * 0.011f, 30.0f - Step * 0.023f);
+
+            ShadowCamera Moved;
+            Moved.UpdateCascade(LightDirection(), ComputeFrustumSliceSphere(Position, Forward,
+                kTanHalfFovX, kTanHalfFovY, 5.0f, 60.0f), kCasterMin, kCasterMax, kBufferSize, kBufferSize, 16);
+            const Vector3 Texels = ToShadowTexels(Moved, Probe);
+
+            CHECK(FracDistance(Texels.GetX(), ReferenceTexels.GetX()) < 0.01f);
+            CHECK(FracDistance(Texels.GetY(), ReferenceTexels.GetY()) < 0.01f);
+        }
+    }
+
+    // Turning the camera keeps the texel size, so texels stay aligned to the same world grid
+    void TestTexelSnappingOnTurn( void )
+    {
+        const Vector3 Position(-12.0f, 6.0f, 3.0f);
+        const Vector3 ProbeA(-5.0f, 0.0f, 20.0f);
+        const Vector3 ProbeB(-4.0f, 0.0f, 20.0f);
+
+        float ReferenceSpacing = 0.0f;
+        Vector3 ReferenceTexels;
+        for (uint32_t i = 0; i < 12; ++i)
+        {
+            const float Yaw = -0.3f + i * 0.05f;
+            const Vector3 Forward(sinf(Yaw), -0.2f, cosf(Yaw));
+
+            ShadowCamera Shadow;
+            Shadow.UpdateCascade(LightDirection(), ComputeFrustumSliceSphere(Position, Normalize(Forward),
+                kTanHalfFovX, kTanHalfFovY, 5.0f, 60.0f), kCasterMin, kCasterMax, kBufferSize, kBufferSize, 16);
+
+            const Vector3 TexelsA = ToShadowTexels(Shadow, ProbeA);
+            const float Spacing = Length(ToShadowTexels(Shadow, ProbeB) - TexelsA);
+            if (i == 0)
+            {
+                ReferenceSpacing = Spacing;
+                ReferenceTexels = TexelsA;
+                continue;
+            }
+
+            CHECK_NEAR(Spacing, ReferenceSpacing, 1e-3);
+            CHECK(FracDistance(TexelsA.GetX(), ReferenceTexels.GetX()) < 0.01f);
+            CHECK(FracDistance(TexelsA.GetY(), ReferenceTexels.GetY()) < 0.01f);
+        }
+    }
+}
+
+int main( void )
+{
+    RUN_TEST(TestCascadeSplits);
+    RUN_TEST(TestSliceSphereEnclosesSlice);
+    RUN_TEST(TestSliceSphereRadiusIgnoresOrientation);
+    RUN_TEST(TestCascadeBoundsFit);
+    RUN_TEST(TestTexelSnappingOnMove);
+    RUN_TEST(TestTexelSnappingOnTurn);
+    return UnitTest::Report();
+}
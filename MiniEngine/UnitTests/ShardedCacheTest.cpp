@@ -0,0 +1,206 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of the texture cache's sharded map, and a benchmark of lookups from many threads
+// with 32 shards against a single shard (one lock, as the cache was before sharding).
+//
+
+#include "UnitTest.h"
+#include "ShardedCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    const uint32_t kThreads = 8;
+
+    // Names like the texture paths of a scene, which differ only in their last characters
+    vector<wstring> MakePaths( uint32_t Count )
+    {
+        vector<wstring> Paths;
+        for (uint32_t i = 0; i < Count; ++i)
+            Paths.push_back(L"Textures/sponza/material_" + to_wstring(i) + L".dds");
+        return Paths;
+    }
+
+    template <typename Cache>
+    pair<int*, bool> Find( Cache& C, const wstring& Path, atomic<uint32_t>* CreateCount = nullptr )
+    {
+        return C.FindOrCreate(Path, Cache::HashKey(Path), [&]()
+        {
+            if (CreateCount != nullptr)
+                ++*CreateCount;
+            return new int(0);
+        });
+    }
+
+    void TestFindOrCreate( void )
+    {
+        ShardedCache<int> Cache;
+
+        auto First = Find(Cache, L"a.dds");
+        auto Again = Find(Cache, L"a.dds");
+        auto Other = Find(Cache, L"a.tga");
+
+        CHECK(First.second);
+        CHECK(!Again.second);
+        CHECK_EQUAL(Again.first, First.first);
+        CHECK(Other.second);
+        CHECK(Other.first != First.first);
+    }
+
+    void TestErase( void )
+    {
+        ShardedCache<int> Cache;
+
+        int* A = Find(Cache, L"a.dds").first;
+        int* B = Find(Cache, L"b.dds").first;
+        Cache.Erase(A, Cache.HashKey(L"a.dds"));
+
+        CHECK(Find(Cache, L"a.dds").second);
+        auto FoundB = Find(Cache, L"b.dds");
+        CHECK(!FoundB.second);
+        CHECK_EQUAL(FoundB.first, B);
+    }
+
+    // Entries that collide on the hash are still told apart by their key
+    void TestHashCollision( void )
+    {
+        ShardedCache<int> Cache;
+
+        int* A = Cache.FindOrCreate(L"a", 7, []() { return new int(1); }).first;
+        int* B = Cache.FindOrCreate(L"b", 7, []() { return new int(2); }).first;
+        CHECK(A != B);
+        CHECK_EQUAL(Cache.FindOrCreate(L"a", 7, []() { return new int(3); }).first, A);
+        CHECK_EQUAL(Cache.FindOrCreate(L"b", 7, []() { return new int(3); }).first, B);
+
+        Cache.Erase(A, 7);
+        CHECK_EQUAL(Cache.FindOrCreate(L"b", 7, []() { return new int(3); }).first, B);
+    }
+
+    void TestFnv1a( void )
+    {
+        // Reference values of 64-bit FNV-1a
+        CHECK_EQUAL((uint64_t)ShardedCache<int>::HashKey(L""), 0xcbf29ce484222325ull);
+        CHECK_EQUAL((uint64_t)ShardedCache<int>::HashKey(L"a"), 0xaf63dc4c8601ec8cull);
+        CHECK_EQUAL((uint64_t)ShardedCache<int>::HashKey(L"foobar"), 0x85944171f73967e8ull);
+    }
+
+    // Paths that differ only in their last characters spread over every shard
+    void TestShardBalance( void )
+    {
+        ShardedCache<int> Cache;
+        const vector<wstring> Paths = MakePaths(1024);
+        for (const wstring& Path : Paths)
+            Find(Cache, Path);
+
+        // 32 per shard on average
+        size_t MinSize = Paths.size(), MaxSize = 0;
+        for (size_t i = 0; i < 32; ++i)
+        {
+            MinSize = min(MinSize, Cache.GetShardSize(i));
+            MaxSize = max(MaxSize, Cache.GetShardSize(i));
+        }
+        CHECK(MinSize >= 16);
+        CHECK(MaxSize <= 48);
+    }
+
+    // Every thread requests every path at once:  each is created once and all threads see the same entry
+    void TestConcurrentCreate( void )
+    {
+        ShardedCache<int> Cache;
+        const vector<wstring> Paths = MakePaths(512);
+        atomic<uint32_t> CreateCount(0);
+        vector< vector<int*> > Found(kThreads);
+
+        vector<thread> Threads;
+        for (uint32_t t = 0; t < kThreads; ++t)
+        {
+            Threads.emplace_back([&, t]()
+            {
+                for (size_t i = 0; i < Paths.size(); ++i)
+                    Found[t].push_back(Find(Cache, Paths[(i + t * 61) % Paths.size()], &CreateCount).first);
+            });
+        }
+        for (thread& T : Threads)
+            T.join();
+
+        CHECK_EQUAL(CreateCount.load(), (uint32_t)Paths.size());
+        for (uint32_t t = 1; t < kThreads; ++t)
+        {
+            for (size_t i = 0; i < Paths.size(); ++i)
+                CHECK_EQUAL(Found[t][(i + Paths.size() - (t * 61) % Paths.size()) % Paths.size()], Found[0][i]);
+        }
+    }
+
+    // Nanoseconds per lookup with every thread looking up cached paths
+    template <typename Cache>
+    double TimeLookups( uint32_t ThreadCount, uint32_t LookupsPerThread )
+    {
+        Cache C;
+        const vector<wstring> Paths = MakePaths(256);
+        for (const wstring& Path : Paths)
+            Find(C, Path);
+
+        atomic<uint32_t> Ready(0);
+        atomic<bool> Start(false);
+        vector<thread> Threads;
+        for (uint32_t t = 0; t < ThreadCount; ++t)
+        {
+            Threads.emplace_back([&, t]()
+            {
+                ++Ready;
+                while (!Start.load())
+                    this_thread::yield();
+                for (uint32_t i = 0; i < LookupsPerThread; ++i)
+                    Find(C, Paths[(i * 7 + t * 31) % Paths.size()]);
+            });
+        }
+
+        while (Ready.load() != ThreadCount)
+            this_thread::yield();
+        auto Begin = chrono::steady_clock::now();
+        Start = true;
+        for (thread& T : Threads)
+            T.join();
+        auto End = chrono::steady_clock::now();
+
+        return chrono::duration<double, nano>(End - Begin).count() / LookupsPerThread;
+    }
+
+    // Reported rather than checked, since build machines are too noisy to time reliably
+    void BenchmarkContention( void )
+    {
+        const uint32_t kLookups = 100000;
+        printf("%-8s %18s %18s\n", "Threads", "1 shard (ns/op)", "32 shards (ns/op)");
+        for (uint32_t ThreadCount = 1; ThreadCount <= kThreads; ThreadCount *= 2)
+        {
+            double Single = TimeLookups< ShardedCache<int, 1> >(ThreadCount, kLookups);
+            double Sharded = TimeLookups< ShardedCache<int, 32> >(ThreadCount, kLookups);
+            printf("%-8u %18.1f %18.1f\n", ThreadCount, Single, Sharded);
+        }
+    }
+}
+
+int main( void )
+{
+    RUN_TEST(TestFindOrCreate);
+    RUN_TEST(TestErase);
+    RUN_TEST(TestHashCollision);
+    RUN_TEST(TestFnv1a);
+    RUN_TEST(TestShardBalance);
+    RUN_TEST(TestConcurrentCreate);
+    RUN_TEST(BenchmarkContention);
+    return UnitTest::Report();
+}
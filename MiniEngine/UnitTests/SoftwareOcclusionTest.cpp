@@ -0,0 +1,550 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of the CPU occlusion rasterizer:  a wall against boxes around it, the buffer of random
+// triangles against a brute-force rasterizer, and culled boxes against the triangles themselves, so that no
+// visible box is ever culled.  Also the occluder selection and triangle budget, and a benchmark.
+//
+
+#include "UnitTest.h"
+#include "SoftwareOcclusion.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Math::Matrix4 layout.  The view looks down +z and clip w is the view depth.
+    void MakePerspective( float* M, float FovY, float Aspect, float NearClip, float FarClip )
+    {
+        memset(M, 0, 16 * sizeof(float));
+        const float ScaleY = 1.0f / tanf(FovY * 0.5f);
+        M[0] = ScaleY / Aspect;
+        M[5] = ScaleY;
+        M[10] = FarClip / (FarClip - NearClip);
+        M[11] = 1.0f;
+        M[14] = -NearClip * FarClip / (FarClip - NearClip);
+    }
+
+    void MakeTranslation( float* M, float X, float Y, float Z )
+    {
+        memset(M, 0, 16 * sizeof(float));
+        M[0] = M[5] = M[10] = M[15] = 1.0f;
+        M[12] = X;
+        M[13] = Y;
+        M[14] = Z;
+    }
+
+    void Multiply( const float* A, const float* B, float* Result )
+    {
+        for (int c = 0; c < 4; ++c)
+            for (int r = 0; r < 4; ++r)
+                Result[c * 4 + r] = A[r] * B[c * 4] + A[4 + r] * B[c * 4 + 1] + A[8 + r] * B[c * 4 + 2] + A[12 + r] * B[c * 4 + 3];
+    }
+
+    float Random( float Low, float High )
+    {
+        return Low + (High - Low) * ((float)rand() / (float)RAND_MAX);
+    }
+
+    float g_ViewProjection[16];
+    float g_Identity[16];
+
+    // A point in pixels and its 1 / w
+    struct ScreenPoint
+    {
+        float X, Y, InvW;
+    };
+
+    ScreenPoint Project( const float* M, const float* P )
+    {
+        const float ClipX = M[0] * P[0] + M[4] * P[1] + M[8] * P[2] + M[12];
+        const float ClipY = M[1] * P[0] + M[5] * P[1] + M[9] * P[2] + M[13];
+        const float ClipW = M[3] * P[0] + M[7] * P[1] + M[11] * P[2] + M[15];
+        ScreenPoint Result = { (0.5f + 0.5f * ClipX / ClipW) * SoftwareOcclusion::kWidth,
+            (0.5f - 0.5f * ClipY / ClipW) * SoftwareOcclusion::kHeight, 1.0f / ClipW };
+        return Result;
+    }
+
+    // The point in world space that lands on pixel coordinates X, Y at view depth Z
+    void Unproject( float X, float Y, float Z, float* P )
+    {
+        P[0] = (2.0f * X / SoftwareOcclusion::kWidth - 1.0f) * Z / g_ViewProjection[0];
+        P[1] = (1.0f - 2.0f * Y / SoftwareOcclusion::kHeight) * Z / g_ViewProjection[5];
+        P[2] = Z;
+    }
+
+    // A screen space triangle of the reference rasterizer
+    struct ReferenceTriangle
+    {
+        ScreenPoint Corners[3];
+
+        // In pixels, positive inside, whichever the winding
+        float EdgeDistance( int k, float X, float Y ) const
+        {
+            const ScreenPoint& A = Corners[k];
+            const ScreenPoint& B = Corners[(k + 1) % 3];
+            const ScreenPoint& C = Corners[(k + 2) % 3];
+            const float Length = sqrtf((B.X - A.X) * (B.X - A.X) + (B.Y - A.Y) * (B.Y - A.Y));
+            const float Side = (B.X - A.X) * (C.Y - A.Y) - (B.Y - A.Y) * (C.X - A.X);
+            const float Distance = ((B.X - A.X) * (Y - A.Y) - (B.Y - A.Y) * (X - A.X)) / Length;
+            return Side < 0.0f ? -Distance : Distance;
+        }
+
+        bool Contains( float X, float Y, float Tolerance ) const
+        {
+            return EdgeDistance(0, X, Y) >= Tolerance && EdgeDistance(1, X, Y) >= Tolerance && EdgeDistance(2, X, Y) >= Tolerance;
+        }
+
+        float InvW( float X, float Y ) const
+        {
+            const ScreenPoint& A = Corners[0];
+            const ScreenPoint& B = Corners[1];
+            const ScreenPoint& C = Corners[2];
+            const float Area = (B.X - A.X) * (C.Y - A.Y) - (C.X - A.X) * (B.Y - A.Y);
+            const float U = ((C.X - B.X) * (Y - B.Y) - (C.Y - B.Y) * (X - B.X)) / Area;
+            const float V = ((A.X - C.X) * (Y - C.Y) - (A.Y - C.Y) * (X - C.X)) / Area;
+            return U * A.InvW + V * B.InvW + (1.0f - U - V) * C.InvW;
+        }
+    };
+
+    // A wall 8 wide and 4 tall at a depth of 10
+    const float kWallPositions[] = { -4.0f, -2.0f, 10.0f, 4.0f, -2.0f, 10.0f, 4.0f, 2.0f, 10.0f, -4.0f, 2.0f, 10.0f };
+    const uint16_t kWallIndices[] = { 0, 1, 2, 0, 2, 3 };
+    const SoftwareOcclusion::MeshDesc kWall = { kWallPositions, 12, 4, kWallIndices, 6, { -4.0f, -2.0f, 10.0f }, { 4.0f, 2.0f, 10.0f } };
+
+    void TestWall( void )
+    {
+        SoftwareOcclusion Occlusion;
+        CHECK_EQUAL(Occlusion.AddModel(0, &kWall, 1), 1u);
+
+        // Nothing is occluded before a frame is drawn
+        const float Behind[2][3] = { { -1.0f, -1.0f, 20.0f }, { 1.0f, 1.0f, 21.0f } };
+        CHECK(!Occlusion.IsOccluded(g_ViewProjection, Behind[0], Behind[1]));
+
+        Occlusion.Begin(g_ViewProjection);
+        Occlusion.AddInstance(0, g_Identity);
+        Occlusion.Rasterize();
+        CHECK_EQUAL(Occlusion.GetStats().Occluders, 1u);
+        CHECK_EQUAL(Occlusion.GetStats().Triangles, 2u);
+
+        // Never nearer than the wall
+        const float Center = Occlusion.GetDepth(128, 64);
+        CHECK(Center <= 0.1f && Center > 0.0999f);
+        CHECK_EQUAL(Occlusion.GetDepth(0, 0), 0.0f);
+
+        CHECK(Occlusion.IsOccluded(g_ViewProjection, Behind[0], Behind[1]));
+
+        const float InFront[2][3] = { { -1.0f, -1.0f, 5.0f }, { 1.0f, 1.0f, 6.0f } };
+        CHECK(!Occlusion.IsOccluded(g_ViewProjection, InFront[0], InFront[1]));
+
+        const float Straddling[2][3] = { { -1.0f, -1.0f, 9.0f }, { 1.0f, 1.0f, 21.0f } };
+        CHECK(!Occlusion.IsOccluded(g_ViewProjection, Straddling[0], Straddling[1]));
+
+        const float Overhanging[2][3] = { { 3.0f, -1.0f, 20.0f }, { 20.0f, 1.0f, 21.0f } };
+        CHECK(!Occlusion.IsOccluded(g_ViewProjection, Overhanging[0], Overhanging[1]));
+
+        // The wall does not cull itself
+        CHECK(!Occlusion.IsOccluded(g_ViewProjection, kWall.BoundsMin, kWall.BoundsMax));
+
+        const float AroundEye[2][3] = { { -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 21.0f } };
+        CHECK(!Occlusion.IsOccluded(g_ViewProjection, AroundEye[0], AroundEye[1]));
+
+        const float OffScreen[2][3] = { { -1000.0f, -1.0f, 20.0f }, { -900.0f, 1.0f, 21.0f } };
+        CHECK(!Occlusion.IsOccluded(g_ViewProjection, OffScreen[0], OffScreen[1]));
+
+        // Through a model matrix
+        const float UnitBox[2][3] = { { -1.0f, -1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } };
+        float Translation[16], ModelToProjection[16];
+        MakeTranslation(Translation, 0.0f, 0.0f, 30.0f);
+        Multiply(g_ViewProjection, Translation, ModelToProjection);
+        CHECK(Occlusion.IsOccluded(ModelToProjection, UnitBox[0], UnitBox[1]));
+        MakeTranslation(Translation, 0.0f, 0.0f, 3.0f);
+        Multiply(g_ViewProjection, Translation, ModelToProjection);
+        CHECK(!Occlusion.IsOccluded(ModelToProjection, UnitBox[0], UnitBox[1]));
+
+        // An instance behind the eye draws nothing
+        MakeTranslation(Translation, 0.0f, 0.0f, -50.0f);
+        Occlusion.Begin(g_ViewProjection);
+        Occlusion.AddInstance(0, Translation);
+        Occlusion.Rasterize();
+        CHECK_EQUAL(Occlusion.GetStats().Occluders, 0u);
+        CHECK(!Occlusion.IsOccluded(g_ViewProjection, Behind[0], Behind[1]));
+    }
+
+    // A wall whose edge crosses a pixel past its center covers the pixel's center but not all of it.  A box
+    // behind the uncovered part of the pixel is visible, through the pixel beyond the edge.
+    void TestPartialPixel( void )
+    {
+        const float kEdgeX = 100.7f;
+        float Positions[4][3];
+        Unproject(-200.0f, -200.0f, 10.0f, Positions[0]);
+        Unproject(kEdgeX, -200.0f, 10.0f, Positions[1]);
+        Unproject(kEdgeX, 300.0f, 10.0f, Positions[2]);
+        Unproject(-200.0f, 300.0f, 10.0f, Positions[3]);
+        SoftwareOcclusion::MeshDesc Wall = { Positions[0], 12, 4, kWallIndices, 6, {}, {} };
+        for (int k = 0; k < 3; ++k)
+        {
+            Wall.BoundsMin[k] = min(Positions[0][k], Positions[2][k]);
+            Wall.BoundsMax[k] = max(Positions[0][k], Positions[2][k]);
+        }
+
+        SoftwareOcclusion Occlusion;
+        CHECK_EQUAL(Occlusion.AddModel(0, &Wall, 1), 1u);
+        Occlusion.Begin(g_ViewProjection);
+        Occlusion.AddInstance(0, g_Identity);
+        Occlusion.Rasterize();
+
+        CHECK(Occlusion.GetDepth(100, 60) > 0.0f);
+        CHECK_EQUAL(Occlusion.GetDepth(101, 60), 0.0f);
+
+        // Thin boxes at a depth of 20, within pixel 99 and within the open part of pixel 100
+        float Covered[2][3], Uncovered[2][3];
+        Unproject(99.2f, 60.2f, 20.0f, Covered[0]);
+        Unproject(99.8f, 60.8f, 20.0f, Covered[1]);
+        Unproject(100.75f, 60.2f, 20.0f, Uncovered[0]);
+        Unproject(100.9f, 60.8f, 20.0f, Uncovered[1]);
+        Covered[1][2] = Uncovered[1][2] = 20.01f;
+        swap(Covered[0][1], Covered[1][1]);
+        swap(Uncovered[0][1], Uncovered[1][1]);
+
+        CHECK(Occlusion.IsOccluded(g_ViewProjection, Covered[0], Covered[1]));
+        CHECK(!Occlusion.IsOccluded(g_ViewProjection, Uncovered[0], Uncovered[1]));
+    }
+
+    // Random triangles, and the same triangles in screen space for the reference
+    void MakeRandomScene( uint32_t TriangleCount, vector<float>& Positions, vector<uint16_t>& Indices,
+        vector<ReferenceTriangle>& Reference )
+    {
+        for (uint32_t t = 0; t < TriangleCount; ++t)
+        {
+            const float CenterX = Random(-8.0f, 8.0f), CenterY = Random(-4.0f, 4.0f), CenterZ = Random(4.0f, 40.0f);
+            ReferenceTriangle Tri;
+            for (int k = 0; k < 3; ++k)
+            {
+                const float P[3] = { CenterX + Random(-3.0f, 3.0f), CenterY + Random(-3.0f, 3.0f), CenterZ + Random(-2.0f, 2.0f) };
+                Positions.insert(Positions.end(), P, P + 3);
+                Indices.push_back((uint16_t)(t * 3 + k));
+                Tri.Corners[k] = Project(g_ViewProjection, P);
+            }
+            Reference.push_back(Tri);
+        }
+    }
+
+    // One mesh over a jittered grid of screen positions at random depths, reaching past the screen, with some
+    // cells left out.  Its triangles meet along shared edges, so there are no gaps narrower than a pixel.
+    void MakeGridScene( vector<float>& Positions, vector<uint16_t>& Indices, vector<ReferenceTriangle>& Reference )
+    {
+        const int kColumns = 37, kRows = 19;
+        const float kSpacing = 8.0f;
+        for (int Row = 0; Row <= kRows; ++Row)
+        {
+            for (int Column = 0; Column <= kColumns; ++Column)
+            {
+                float P[3];
+                Unproject(Column * kSpacing - 20.0f + Random(-2.0f, 2.0f), Row * kSpacing - 12.0f + Random(-2.0f, 2.0f),
+                    Random(10.0f, 30.0f), P);
+                Positions.insert(Positions.end(), P, P + 3);
+            }
+        }
+
+        for (int Row = 0; Row < kRows; ++Row)
+        {
+            for (int Column = 0; Column < kColumns; ++Column)
+            {
+                if (rand() % 4 == 0)
+                    continue;
+
+                const uint16_t Corner = (uint16_t)(Row * (kColumns + 1) + Column);
+                const uint16_t Cell[6] = { Corner, (uint16_t)(Corner + 1), (uint16_t)(Corner + kColumns + 2),
+                    Corner, (uint16_t)(Corner + kColumns + 2), (uint16_t)(Corner + kColumns + 1) };
+                Indices.insert(Indices.end(), Cell, Cell + 6);
+                for (int t = 0; t < 2; ++t)
+                {
+                    ReferenceTriangle Tri;
+                    for (int k = 0; k < 3; ++k)
+                        Tri.Corners[k] = Project(g_ViewProjection, &Positions[Cell[t * 3 + k] * 3]);
+                    Reference.push_back(Tri);
+                }
+            }
+        }
+    }
+
+    // Every written pixel has its center within a triangle no nearer anywhere in the pixel than the buffer
+    // says, and every pixel whose center is well within a triangle is written.  On the border of the screen
+    // the whole pixel must be within the triangle.
+    void TestRasterizeMatchesReference( void )
+    {
+        srand(50);
+        const uint32_t kTriangles = 200;
+        vector<float> Positions;
+        vector<uint16_t> Indices;
+        vector<ReferenceTriangle> Reference;
+        MakeRandomScene(kTriangles, Positions, Indices, Reference);
+
+        SoftwareOcclusion Occlusion;
+        const SoftwareOcclusion::MeshDesc Mesh = { Positions.data(), 12, kTriangles * 3, Indices.data(), kTriangles * 3,
+            { -100.0f, -100.0f, 0.0f }, { 100.0f, 100.0f, 100.0f } };
+        CHECK_EQUAL(Occlusion.AddModel(0, &Mesh, 1, 0.0f, 100000), 1u);
+        Occlusion.Begin(g_ViewProjection);
+        Occlusion.AddInstance(0, g_Identity);
+        Occlusion.Rasterize();
+        CHECK_EQUAL(Occlusion.GetStats().Triangles, kTriangles);
+
+        uint32_t Written = 0, TooNear = 0, Missed = 0;
+        for (uint32_t y = 0; y < SoftwareOcclusion::kHeight; ++y)
+        {
+            for (uint32_t x = 0; x < SoftwareOcclusion::kWidth; ++x)
+            {
+                const bool Border = x == 0 || y == 0 || x == SoftwareOcclusion::kWidth - 1 || y == SoftwareOcclusion::kHeight - 1;
+
+                // The farthest 1 / w over the pixel's corners of the nearest triangle containing the pixel,
+                // within a hair and well within
+                float Loose = 0.0f, Strict = 0.0f;
+                for (const ReferenceTriangle& Tri : Reference)
+                {
+                    float Farthest = 1.0f;
+                    bool LooseInside = Border || Tri.Contains(x + 0.5f, y + 0.5f, -1e-3f);
+                    bool StrictInside = Border || Tri.Contains(x + 0.5f, y + 0.5f, 1e-2f);
+                    for (int Corner = 0; Corner < 4; ++Corner)
+                    {
+                        const float X = (float)(x + (Corner & 1)), Y = (float)(y + (Corner >> 1));
+                        LooseInside = LooseInside && (!Border || Tri.Contains(X, Y, -1e-3f));
+                        StrictInside = StrictInside && (!Border || Tri.Contains(X, Y, 1e-2f));
+                        Farthest = min(Farthest, Tri.InvW(X, Y));
+                    }
+                    if (LooseInside)
+                        Loose = max(Loose, Farthest);
+                    if (StrictInside)
+                        Strict = max(Strict, Farthest);
+                }
+
+                const float Depth = Occlusion.GetDepth(x, y);
+                Written += Depth > 0.0f ? 1 : 0;
+                TooNear += Depth > Loose * 1.0001f ? 1 : 0;
+                Missed += Depth < Strict * 0.999f ? 1 : 0;
+            }
+        }
+        CHECK(Written > 1000);
+        CHECK_EQUAL(TooNear, 0u);
+        CHECK_EQUAL(Missed, 0u);
+    }
+
+    // Points throughout every culled box are behind some triangle, and IsOccluded agrees with a scan of the
+    // buffer under the box
+    void TestOcclusionIsConservative( void )
+    {
+        srand(51);
+        uint32_t Occluded = 0, Visible = 0, WrongPoints = 0, Mismatches = 0;
+        for (int Scene = 0; Scene < 10; ++Scene)
+        {
+            vector<float> Positions;
+            vector<uint16_t> Indices;
+            vector<ReferenceTriangle> Reference;
+            MakeGridScene(Positions, Indices, Reference);
+
+            SoftwareOcclusion Occlusion;
+            const SoftwareOcclusion::MeshDesc Mesh = { Positions.data(), 12, (uint32_t)Positions.size() / 3, Indices.data(),
+                (uint32_t)Indices.size(), { -100.0f, -100.0f, 0.0f }, { 100.0f, 100.0f, 100.0f } };
+            Occlusion.AddModel(0, &Mesh, 1, 0.0f, 100000);
+            Occlusion.Begin(g_ViewProjection);
+            Occlusion.AddInstance(0, g_Identity);
+            Occlusion.Rasterize();
+
+            for (int Box = 0; Box < 300; ++Box)
+            {
+                const float X = Random(-10.0f, 10.0f), Y = Random(-5.0f, 5.0f), Z = Random(3.0f, 60.0f), Size = Random(0.05f, 3.0f);
+                const float BoundsMin[3] = { X - Size, Y - Size, Z };
+                const float BoundsMax[3] = { X + Size, Y + Size, Z + Size };
+
+                const bool IsOccluded = Occlusion.IsOccluded(g_ViewProjection, BoundsMin, BoundsMax);
+                Occluded += IsOccluded ? 1 : 0;
+                Visible += IsOccluded ? 0 : 1;
+
+                // The rectangle of pixels under the box, grown by a pixel, and its nearest 1 / w
+                float Left = 1e30f, Right = -1e30f, Top = 1e30f, Bottom = -1e30f, Nearest = 0.0f;
+                for (int Corner = 0; Corner < 8; ++Corner)
+                {
+                    const float P[3] = { Corner & 1 ? BoundsMax[0] : BoundsMin[0], Corner & 2 ? BoundsMax[1] : BoundsMin[1],
+                        Corner & 4 ? BoundsMax[2] : BoundsMin[2] };
+                    const ScreenPoint S = Project(g_ViewProjection, P);
+                    Left = min(Left, S.X);
+                    Right = max(Right, S.X);
+                    Top = min(Top, S.Y);
+                    Bottom = max(Bottom, S.Y);
+                    Nearest = max(Nearest, S.InvW);
+                }
+                bool Expected = !(Right < 0.0f || Left > SoftwareOcclusion::kWidth || Bottom < 0.0f || Top > SoftwareOcclusion::kHeight);
+                const int x0 = max(0, (int)floorf(Left) - 1), x1 = min((int)SoftwareOcclusion::kWidth - 1, (int)floorf(Right) + 1);
+                const int y0 = max(0, (int)floorf(Top) - 1), y1 = min((int)SoftwareOcclusion::kHeight - 1, (int)floorf(Bottom) + 1);
+                for (int y = y0; y <= y1 && Expected; ++y)
+                    for (int x = x0; x <= x1 && Expected; ++x)
+                        Expected = Occlusion.GetDepth(x, y) > Nearest * (1.0f + 1.0f / 1024.0f);
+                Mismatches += Expected != IsOccluded ? 1 : 0;
+
+                if (!IsOccluded)
+                    continue;
+
+                // Corners, edges, faces and the inside of the box
+                for (int i = 0; i < 125; ++i)
+                {
+                    const float P[3] = { BoundsMin[0] + (BoundsMax[0] - BoundsMin[0]) * (i % 5) * 0.25f,
+                        BoundsMin[1] + (BoundsMax[1] - BoundsMin[1]) * (i / 5 % 5) * 0.25f,
+                        BoundsMin[2] + (BoundsMax[2] - BoundsMin[2]) * (i / 25) * 0.25f };
+                    const ScreenPoint S = Project(g_ViewProjection, P);
+                    if (S.X < 0.0f || S.X > SoftwareOcclusion::kWidth || S.Y < 0.0f || S.Y > SoftwareOcclusion::kHeight)
+                        continue;
+
+                    bool Hidden = false;
+                    for (const ReferenceTriangle& Tri : Reference)
+                    {
+                        if (Tri.Contains(S.X, S.Y, -1e-3f) && Tri.InvW(S.X, S.Y) >= S.InvW)
+                        {
+                            Hidden = true;
+                            break;
+                        }
+                    }
+                    WrongPoints += Hidden ? 0 : 1;
+                }
+            }
+        }
+
+        CHECK(Occluded > 100);
+        CHECK(Visible > 100);
+        CHECK_EQUAL(Mismatches, 0u);
+        CHECK_EQUAL(WrongPoints, 0u);
+    }
+
+    // Only the biggest occluders within the budget are drawn
+    void TestTriangleBudget( void )
+    {
+        SoftwareOcclusion Occlusion;
+        Occlusion.AddModel(0, &kWall, 1);
+        Occlusion.SetTriangleBudget(6);
+        Occlusion.Begin(g_ViewProjection);
+        for (int i = 0; i < 10; ++i)
+        {
+            float Translation[16];
+            MakeTranslation(Translation, 0.0f, 0.0f, (float)i * 5.0f);
+            Occlusion.AddInstance(0, Translation);
+        }
+        Occlusion.Rasterize();
+        CHECK_EQUAL(Occlusion.GetStats().Occluders, 3u);
+        CHECK_EQUAL(Occlusion.GetStats().Triangles, 6u);
+
+        // The nearest wall is the largest on screen
+        CHECK_NEAR(Occlusion.GetDepth(128, 64), 0.1f, 1e-3);
+    }
+
+    // Meshes small for their model are not kept
+    void TestOccluderSelection( void )
+    {
+        const float SmallPositions[] = { 0.0f, 0.0f, 0.0f, 0.1f, 0.0f, 0.0f, 0.0f, 0.1f, 0.0f };
+        const uint16_t SmallIndices[] = { 0, 1, 2 };
+        const SoftwareOcclusion::MeshDesc Meshes[2] =
+        {
+            kWall,
+            { SmallPositions, 12, 3, SmallIndices, 3, { 0.0f, 0.0f, 0.0f }, { 0.1f, 0.1f, 0.0f } },
+        };
+
+        SoftwareOcclusion Occlusion;
+        CHECK_EQUAL(Occlusion.AddModel(1, Meshes, 2), 1u);
+        CHECK_EQUAL(Occlusion.GetOccluderCount(), 1u);
+
+        // Nor meshes over the triangle limit
+        SoftwareOcclusion Limited;
+        CHECK_EQUAL(Limited.AddModel(0, &kWall, 1, 0.0f, 1), 0u);
+    }
+
+    // Reported rather than checked, since build machines are too noisy to time reliably
+    void BenchmarkRasterize( void )
+    {
+        srand(52);
+        const uint32_t kMeshes = 10, kTrianglesPerMesh = 3000, kBoxes = 10000;
+        vector<float> Positions[kMeshes];
+        vector<uint16_t> Indices[kMeshes];
+        SoftwareOcclusion::MeshDesc Meshes[kMeshes];
+        for (uint32_t m = 0; m < kMeshes; ++m)
+        {
+            for (uint32_t t = 0; t < kTrianglesPerMesh; ++t)
+            {
+                const float CenterX = Random(-8.0f, 8.0f), CenterY = Random(-4.0f, 4.0f), CenterZ = Random(4.0f, 40.0f);
+                for (int k = 0; k < 3; ++k)
+                {
+                    Positions[m].push_back(CenterX + Random(-1.0f, 1.0f));
+                    Positions[m].push_back(CenterY + Random(-1.0f, 1.0f));
+                    Positions[m].push_back(CenterZ + Random(-0.5f, 0.5f));
+                    Indices[m].push_back((uint16_t)(t * 3 + k));
+                }
+            }
+            const SoftwareOcclusion::MeshDesc Mesh = { Positions[m].data(), 12, kTrianglesPerMesh * 3, Indices[m].data(),
+                kTrianglesPerMesh * 3, { -100.0f, -100.0f, 0.0f }, { 100.0f, 100.0f, 100.0f } };
+            Meshes[m] = Mesh;
+        }
+
+        vector<float> Boxes;
+        for (uint32_t b = 0; b < kBoxes; ++b)
+        {
+            const float X = Random(-10.0f, 10.0f), Y = Random(-5.0f, 5.0f), Z = Random(3.0f, 60.0f), Size = Random(0.1f, 1.0f);
+            const float Box[6] = { X - Size, Y - Size, Z, X + Size, Y + Size, Z + Size };
+            Boxes.insert(Boxes.end(), Box, Box + 6);
+        }
+
+        SoftwareOcclusion Occlusion;
+        Occlusion.AddModel(0, Meshes, kMeshes, 0.0f, 100000);
+        Occlusion.SetTriangleBudget(1 << 20);
+
+        const uint32_t kRepeats = 5;
+        double RasterizeTime = 0.0, TestTime = 0.0;
+        uint32_t Occluded = 0;
+        for (uint32_t Repeat = 0; Repeat < kRepeats; ++Repeat)
+        {
+            auto Begin = chrono::steady_clock::now();
+            Occlusion.Begin(g_ViewProjection);
+            Occlusion.AddInstance(0, g_Identity);
+            Occlusion.Rasterize();
+            auto Rasterized = chrono::steady_clock::now();
+            Occluded = 0;
+            for (uint32_t b = 0; b < kBoxes; ++b)
+                Occluded += Occlusion.IsOccluded(g_ViewProjection, &Boxes[b * 6], &Boxes[b * 6 + 3]) ? 1 : 0;
+            auto Tested = chrono::steady_clock::now();
+
+            RasterizeTime += chrono::duration<double, milli>(Rasterized - Begin).count();
+            TestTime += chrono::duration<double, milli>(Tested - Rasterized).count();
+        }
+
+        printf("%u triangles (%u binned):  rasterize %.3f ms, %u box tests %.3f ms, %u occluded\n",
+            Occlusion.GetStats().Triangles, Occlusion.GetStats().BinnedTriangles, RasterizeTime / kRepeats, kBoxes,
+            TestTime / kRepeats, Occluded);
+    }
+}
+
+int main( void )
+{
+    g_JobScheduler.Initialize(4);
+    MakePerspective(g_ViewProjection, 1.0f, 2.0f, 0.5f, 1000.0f);
+    MakeTranslation(g_Identity, 0.0f, 0.0f, 0.0f);
+
+    RUN_TEST(TestWall);
+    RUN_TEST(TestPartialPixel);
+    RUN_TEST(TestRasterizeMatchesReference);
+    RUN_TEST(TestOcclusionIsConservative);
+    RUN_TEST(TestTriangleBudget);
+    RUN_TEST(TestOccluderSelection);
+    RUN_TEST(BenchmarkRasterize);
+
+    g_JobScheduler.Shutdown();
+    return UnitTest::Report();
+}
@@ -0,0 +1,245 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of TextureBudget's residency decisions:  which textures drop and restore mips and in
+// what order, how many change per frame, and that the byte totals follow registration and every change.
+//
+
+#include "UnitTest.h"
+#include "TextureBudget.h"
+
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // A 4-mip chain of 64 + 16 + 4 + 1 bytes
+    const uint64_t kMipBytes[4] = { 64, 16, 4, 1 };
+    const uint64_t kFullBytes = 85;
+
+    TextureBudget::Handle RegisterUsed( TextureBudget& Budget, uint64_t Frame )
+    {
+        TextureBudget::Handle Texture = Budget.Register(kMipBytes, 4);
+        Budget.MarkUsed(Texture, Frame);
+        return Texture;
+    }
+
+    // Sums the textures' resident bytes for comparison with the running total
+    uint64_t SumResident( const TextureBudget& Budget, const vector<TextureBudget::Handle>& Textures )
+    {
+        uint64_t Total = 0;
+        for (TextureBudget::Handle Texture : Textures)
+            Total += Budget.GetResidentBytes(Texture);
+        return Total;
+    }
+
+    // Over budget, the stalest textures lose their mips first.  Under budget again, the freshest get theirs
+    // back first.
+    void TestLeastRecentlyUsedOrder( void )
+    {
+        TextureBudget Budget;
+        TextureBudget::Handle Fresh = RegisterUsed(Budget, 30);
+        TextureBudget::Handle Stale = RegisterUsed(Budget, 10);
+        TextureBudget::Handle Middle = RegisterUsed(Budget, 20);
+        vector<TextureBudget::Handle> Textures = { Fresh, Stale, Middle };
+        CHECK_EQUAL(Budget.GetTotalResidentBytes(), 3 * kFullBytes);
+
+        // 60 bytes over:  dropping the stalest texture's top mip is enough
+        Budget.SetBudget(3 * kFullBytes - 60);
+        vector<TextureBudget::Change> Changes;
+        Budget.Update(Changes);
+        CHECK_EQUAL(Changes.size(), 1u);
+        CHECK(Changes.size() == 1 && Changes[0].Texture == Stale && Changes[0].SkipMips == 1);
+        CHECK_EQUAL(Budget.GetSkipMips(Stale), 1u);
+        CHECK_EQUAL(Budget.GetSkipMips(Middle), 0u);
+        CHECK_EQUAL(Budget.GetSkipMips(Fresh), 0u);
+
+        // Down to 63 bytes:  the stalest two go to their mip tail before the freshest is touched
+        Budget.SetBudget(63);
+        Changes.clear();
+        Budget.Update(Changes);
+        CHECK_EQUAL(Changes.size(), 3u);
+        if (Changes.size() == 3)
+        {
+            CHECK_EQUAL(Changes[0].Texture, Stale);
+            CHECK_EQUAL(Changes[1].Texture, Middle);
+            CHECK_EQUAL(Changes[2].Texture, Fresh);
+        }
+        CHECK_EQUAL(Budget.GetSkipMips(Stale), 3u);
+        CHECK_EQUAL(Budget.GetSkipMips(Middle), 3u);
+        CHECK_EQUAL(Budget.GetSkipMips(Fresh), 1u);
+        CHECK_EQUAL(Budget.GetTotalResidentBytes(), 1u + 1u + 21u);
+        CHECK_EQUAL(Budget.GetTotalResidentBytes(), SumResident(Budget, Textures));
+
+        // Room for 64 more bytes goes to the freshest texture, and what is left is too little for the next
+        Budget.SetBudget(23 + 64 + 3);
+        Changes.clear();
+        Budget.Update(Changes);
+        CHECK_EQUAL(Changes.size(), 1u);
+        CHECK(Changes.size() == 1 && Changes[0].Texture == Fresh && Changes[0].SkipMips == 0);
+        CHECK_EQUAL(Budget.GetSkipMips(Middle), 3u);
+        CHECK_EQUAL(Budget.GetTotalResidentBytes(), 23u + 64u);
+
+        // Using the stale texture again moves it ahead of the middle one
+        Budget.MarkUsed(Stale, 40);
+        Budget.SetBudget(23 + 64 + 4);
+        Changes.clear();
+        Budget.Update(Changes);
+        CHECK_EQUAL(Changes.size(), 1u);
+        CHECK(Changes.size() == 1 && Changes[0].Texture == Stale && Changes[0].SkipMips == 2);
+        CHECK_EQUAL(Budget.GetSkipMips(Middle), 3u);
+        CHECK_EQUAL(Budget.GetTotalResidentBytes(), SumResident(Budget, Textures));
+
+        // MarkUsed never moves a texture back in time, so the stale texture still drops after the fresh one
+        Budget.MarkUsed(Stale, 5);
+        Budget.SetBudget(1);
+        Changes.clear();
+        Budget.Update(Changes);
+        CHECK_EQUAL(Changes.size(), 2u);
+        CHECK(Changes.size() == 2 && Changes[0].Texture == Fresh && Changes[1].Texture == Stale);
+    }
+
+    // No more than the limit change per Update, and the rest follow on later frames
+    void TestMaxChangesPerFrame( void )
+    {
+        TextureBudget Budget;
+        vector<TextureBudget::Handle> Textures;
+        for (uint32_t i = 0; i < 5; ++i)
+            Textures.push_back(RegisterUsed(Budget, i + 1));
+
+        Budget.SetMaxChangesPerFrame(2);
+        Budget.SetBudget(5);
+
+        vector<TextureBudget::Change> Changes;
+        uint32_t Frames = 0;
+        do
+        {
+            Changes.clear();
+            Budget.Update(Changes);
+            CHECK(Changes.size() <= 2);
+            ++Frames;
+        }
+        while (!Changes.empty() && Frames < 10);
+
+        // Two, two and one textures changed, then nothing was left to do
+        CHECK_EQUAL(Frames, 4u);
+        for (TextureBudget::Handle Texture : Textures)
+            CHECK_EQUAL(Budget.GetSkipMips(Texture), 3u);
+        CHECK_EQUAL(Budget.GetTotalResidentBytes(), 5u);
+
+        // Restoring is throttled the same way
+        Budget.SetMaxChangesPerFrame(1);
+        Budget.SetBudget(0);
+        Changes.clear();
+        Budget.Update(Changes);
+        CHECK_EQUAL(Changes.size(), 1u);
+        CHECK(Changes.size() == 1 && Changes[0].Texture == Textures[4]);
+
+        // 0 lifts the limit
+        Budget.SetMaxChangesPerFrame(0);
+        Changes.clear();
+        Budget.Update(Changes);
+        CHECK_EQUAL(Changes.size(), 4u);
+        CHECK_EQUAL(Budget.GetTotalResidentBytes(), 5 * kFullBytes);
+    }
+
+    // A budget of 0 is unlimited:  nothing is dropped, and whatever was dropped comes back
+    void TestUnlimitedBudget( void )
+    {
+        TextureBudget Budget;
+        TextureBudget::Handle A = RegisterUsed(Budget, 1);
+        TextureBudget::Handle B = RegisterUsed(Budget, 2);
+
+        vector<TextureBudget::Change> Changes;
+        Budget.Update(Changes);
+        CHECK(Changes.empty());
+        CHECK_EQUAL(Budget.GetTotalResidentBytes(), 2 * kFullBytes);
+
+        Budget.SetBudget(2);
+        Budget.Update(Changes);
+        CHECK_EQUAL(Budget.GetSkipMips(A), 3u);
+        CHECK_EQUAL(Budget.GetSkipMips(B), 3u);
+
+        Budget.SetBudget(0);
+        Changes.clear();
+        Budget.Update(Changes);
+        CHECK_EQUAL(Changes.size(), 2u);
+        CHECK_EQUAL(Budget.GetSkipMips(A), 0u);
+        CHECK_EQUAL(Budget.GetSkipMips(B), 0u);
+        CHECK_EQUAL(Budget.GetTotalResidentBytes(), Budget.GetTotalFullBytes());
+    }
+
+    // A texture with nothing above its mip tail is never changed, however tight the budget
+    void TestSingleMip( void )
+    {
+        TextureBudget Budget;
+        const uint64_t OneMip[1] = { 4096 };
+        TextureBudget::Handle Single = Budget.Register(OneMip, 1);
+        TextureBudget::Handle Tail = Budget.Register(kMipBytes, 4, 4);
+        Budget.MarkUsed(Single, 1);
+        Budget.MarkUsed(Tail, 1);
+
+        Budget.SetBudget(1);
+        vector<TextureBudget::Change> Changes;
+        Budget.Update(Changes);
+        CHECK(Changes.empty());
+        CHECK_EQUAL(Budget.GetSkipMips(Single), 0u);
+        CHECK_EQUAL(Budget.GetSkipMips(Tail), 0u);
+        CHECK_EQUAL(Budget.GetTotalResidentBytes(), 4096u + kFullBytes);
+
+        Budget.SetBudget(0);
+        Budget.Update(Changes);
+        CHECK(Changes.empty());
+    }
+
+    // Unregistering takes the texture's resident and full bytes out of the totals, and its slot is reused
+    void TestUnregister( void )
+    {
+        TextureBudget Budget;
+        TextureBudget::Handle A = RegisterUsed(Budget, 1);
+        TextureBudget::Handle B = RegisterUsed(Budget, 2);
+        CHECK_EQUAL(Budget.GetTextureCount(), 2u);
+
+        // Drop A's top mip so its resident and full sizes differ
+        Budget.SetBudget(2 * kFullBytes - 64);
+        vector<TextureBudget::Change> Changes;
+        Budget.Update(Changes);
+        CHECK_EQUAL(Budget.GetSkipMips(A), 1u);
+
+        Budget.Unregister(A);
+        CHECK_EQUAL(Budget.GetTextureCount(), 1u);
+        CHECK_EQUAL(Budget.GetTotalResidentBytes(), kFullBytes);
+        CHECK_EQUAL(Budget.GetTotalFullBytes(), kFullBytes);
+
+        Budget.Unregister(TextureBudget::kInvalidHandle);
+        CHECK_EQUAL(Budget.GetTextureCount(), 1u);
+
+        // The freed slot comes back at full resolution
+        TextureBudget::Handle C = RegisterUsed(Budget, 3);
+        CHECK_EQUAL(C, A);
+        CHECK_EQUAL(Budget.GetSkipMips(C), 0u);
+        CHECK_EQUAL(Budget.GetTotalFullBytes(), 2 * kFullBytes);
+
+        Budget.Unregister(B);
+        Budget.Unregister(C);
+        CHECK_EQUAL(Budget.GetTextureCount(), 0u);
+        CHECK_EQUAL(Budget.GetTotalResidentBytes(), 0u);
+        CHECK_EQUAL(Budget.GetTotalFullBytes(), 0u);
+    }
+}
+
+int main( void )
+{
+    RUN_TEST(TestLeastRecentlyUsedOrder);
+    RUN_TEST(TestMaxChangesPerFrame);
+    RUN_TEST(TestUnlimitedBudget);
+    RUN_TEST(TestSingleMip);
+    RUN_TEST(TestUnregister);
+    return UnitTest::Report();
+}
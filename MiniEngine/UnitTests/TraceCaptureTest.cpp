@@ -0,0 +1,239 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of the trace files TraceCapture writes:  which frames and scopes they hold, how
+// long a capture stays open for late GPU ranges, and where GPU ranges land on the CPU time line.
+//
+
+#include "UnitTest.h"
+#include "pch.h"
+#include "TraceCapture.h"
+#include "SystemTime.h"
+
+#include "document.h"
+
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+namespace
+{
+    // Scope names must outlive the capture
+    const wstring kOuterScope = L"Outer";
+    const wstring kInnerScope = L"Inner";
+    const wstring kGpuScope = L"Gpu Pass";
+
+    const char* kTracePath = "TraceCaptureTest.json";
+    const char* kOtherTracePath = "TraceCaptureTest2.json";
+
+    // The timer readback lags the CPU by this many frames
+    const uint32_t kGpuLatencyFrames = 3;
+
+    // A GPU clock running at 1 MHz, calibrated now
+    TraceCapture::ClockCalibration MakeClock( uint64_t GpuTimeStamp = 1000000 )
+    {
+        TraceCapture::ClockCalibration Clock = { GpuTimeStamp, SystemTime::GetCurrentTick(), 1e-6 };
+        return Clock;
+    }
+
+    void RecordFrame( uint64_t FrameIndex )
+    {
+        TraceCapture::BeginCpuScope(kOuterScope);
+        TraceCapture::BeginCpuScope(kInnerScope);
+        TraceCapture::EndCpuScope(kInnerScope);
+        TraceCapture::EndCpuScope(kOuterScope);
+        TraceCapture::NextFrame(FrameIndex);
+    }
+
+    struct TraceFile
+    {
+        bool Loaded = false;
+        uint32_t Frames = 0;
+        bool Truncated = false;
+        uint32_t CpuBegins = 0;
+        uint32_t CpuEnds = 0;
+        uint32_t FrameMarkers = 0;
+        uint32_t GpuRanges = 0;
+        bool HasGpuTrack = false;
+        double GpuStart = 0.0;      // Of the last GPU range
+        double GpuDuration = 0.0;
+
+        explicit TraceFile( const char* Path )
+        {
+            ifstream File(Path);
+            if (!File)
+                return;
+            stringstream Contents;
+            Contents << File.rdbuf();
+            File.close();
+            remove(Path);
+
+            rapidjson::Document Doc;
+            if (Doc.Parse(Contents.str().c_str()).HasParseError() || !Doc.IsObject())
+                return;
+
+            const rapidjson::Value& Events = Doc["traceEvents"];
+            for (rapidjson::SizeType i = 0; i < Events.Size(); ++i)
+            {
+                const rapidjson::Value& E = Events[i];
+                const string Phase = E["ph"].GetString();
+                const string Name = E["name"].GetString();
+                if (Phase == "B")
+                    ++CpuBegins;
+                else if (Phase == "E")
+                    ++CpuEnds;
+                else if (Phase == "i")
+                    ++FrameMarkers;
+                else if (Phase == "X")
+                {
+                    ++GpuRanges;
+                    GpuStart = E["ts"].GetDouble();
+                    GpuDuration = E["dur"].GetDouble();
+                }
+                else if (Phase == "M" && Name == "thread_name")
+                    HasGpuTrack = string(E["args"]["name"].GetString()) == "GPU";
+            }
+
+            Frames = Doc["otherData"]["frames"].GetUint();
+            Truncated = Doc["otherData"]["truncated"].GetBool();
+            Loaded = true;
+        }
+    };
+
+    bool FileExists( const char* Path )
+    {
+        return ifstream(Path).good();
+    }
+
+    // The hooks do nothing, and nothing is written, without a capture
+    void TestIdleHooks( void )
+    {
+        CHECK(!TraceCapture::IsCapturing());
+        RecordFrame(0);
+        TraceCapture::AddGpuRange(kGpuScope, 1000, 2000);
+        TraceCapture::End();
+        TraceCapture::Flush();
+        CHECK(!TraceCapture::IsCapturing());
+    }
+
+    // A capture of two frames records their CPU scopes, then takes only GPU ranges until the last
+    // frames' timers could have been read back
+    void TestFrameCountCapture( void )
+    {
+        TraceCapture::Begin(kTracePath, MakeClock(), 2);
+        RecordFrame(0);
+        RecordFrame(1);
+        CHECK(TraceCapture::IsCapturing());
+
+        for (uint32_t i = 0; i < kGpuLatencyFrames; ++i)
+        {
+            CHECK(TraceCapture::IsCapturing());
+            CHECK(!FileExists(kTracePath));
+            TraceCapture::AddGpuRange(kGpuScope, 1001000 + 100 * i, 1001000 + 100 * i + 50);
+            RecordFrame(2 + i);
+        }
+        CHECK(!TraceCapture::IsCapturing());
+
+        TraceFile Trace(kTracePath);
+        CHECK(Trace.Loaded);
+        CHECK_EQUAL(Trace.Frames, 2u);
+        CHECK_EQUAL(Trace.FrameMarkers, 2u);
+        CHECK_EQUAL(Trace.CpuBegins, 4u);
+        CHECK_EQUAL(Trace.CpuEnds, 4u);
+        CHECK_EQUAL(Trace.GpuRanges, kGpuLatencyFrames);
+        CHECK(Trace.HasGpuTrack);
+        CHECK(!Trace.Truncated);
+    }
+
+    // An open-ended capture stops recording the CPU at End() and is written once the GPU latency passed
+    void TestEndWaitsForGpuRanges( void )
+    {
+        TraceCapture::Begin(kTracePath, MakeClock());
+        for (uint32_t i = 0; i < 5; ++i)
+            RecordFrame(i);
+        TraceCapture::End();
+        CHECK(TraceCapture::IsCapturing());
+
+        TraceCapture::AddGpuRange(kGpuScope, 1001000, 1001100);
+        for (uint32_t i = 0; i < kGpuLatencyFrames - 1; ++i)
+            RecordFrame(5 + i);
+        CHECK(TraceCapture::IsCapturing());
+        CHECK(!FileExists(kTracePath));
+
+        RecordFrame(5 + kGpuLatencyFrames);
+        CHECK(!TraceCapture::IsCapturing());
+
+        TraceFile Trace(kTracePath);
+        CHECK(Trace.Loaded);
+        CHECK_EQUAL(Trace.Frames, 5u);
+        CHECK_EQUAL(Trace.CpuBegins, 10u);
+        CHECK_EQUAL(Trace.GpuRanges, 1u);
+    }
+
+    // GPU ranges are placed through the clock calibration, ranges submitted before the capture are
+    // dropped, and a timer that didn't run again is not logged twice
+    void TestGpuRangePlacement( void )
+    {
+        const uint64_t BaseTimeStamp = 1000000;
+        TraceCapture::Begin(kTracePath, MakeClock(BaseTimeStamp));
+
+        TraceCapture::AddGpuRange(kOuterScope, BaseTimeStamp - 5000, BaseTimeStamp - 4000);
+        TraceCapture::AddGpuRange(kGpuScope, BaseTimeStamp + 2000, BaseTimeStamp + 2500);
+        TraceCapture::AddGpuRange(kGpuScope, BaseTimeStamp + 2000, BaseTimeStamp + 2500);
+
+        // Shutdown writes at once
+        TraceCapture::Flush();
+        CHECK(!TraceCapture::IsCapturing());
+
+        TraceFile Trace(kTracePath);
+        CHECK(Trace.Loaded);
+        CHECK_EQUAL(Trace.GpuRanges, 1u);
+
+        // Microseconds.  The calibration was read just before the capture started.
+        CHECK_NEAR(Trace.GpuStart, 2000.0, 100.0);
+        CHECK_NEAR(Trace.GpuDuration, 500.0, 1e-6);
+    }
+
+    // Starting a capture writes the one in progress
+    void TestBeginWritesPrevious( void )
+    {
+        TraceCapture::Begin(kOtherTracePath, MakeClock());
+        RecordFrame(0);
+
+        TraceCapture::Begin(kTracePath, MakeClock());
+        CHECK(TraceCapture::IsCapturing());
+        {
+            TraceFile Previous(kOtherTracePath);
+            CHECK(Previous.Loaded);
+            CHECK_EQUAL(Previous.Frames, 1u);
+            CHECK_EQUAL(Previous.CpuBegins, 2u);
+        }
+
+        RecordFrame(1);
+        RecordFrame(2);
+        TraceCapture::Flush();
+
+        TraceFile Trace(kTracePath);
+        CHECK(Trace.Loaded);
+        CHECK_EQUAL(Trace.Frames, 2u);
+        CHECK_EQUAL(Trace.CpuBegins, 4u);
+    }
+}
+
+int main( void )
+{
+    SystemTime::Initialize();
+
+    RUN_TEST(TestIdleHooks);
+    RUN_TEST(TestFrameCountCapture);
+    RUN_TEST(TestEndWaitsForGpuRanges);
+    RUN_TEST(TestGpuRangePlacement);
+    RUN_TEST(TestBeginWritesPrevious);
+    return UnitTest::Report();
+}
@@ -0,0 +1,137 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of the EngineTuning snapshot format:  path hashes match the FNV-1a reference
+// values, snapshots read back what was written, and malformed blobs are rejected.
+//
+
+#include "UnitTest.h"
+#include "TuningSnapshot.h"
+
+#include <cstring>
+
+using namespace std;
+
+namespace
+{
+    // From the FNV reference test vectors
+    void TestHashPathReference( void )
+    {
+        CHECK_EQUAL(TuningSnapshot::HashPath(""), 0xcbf29ce484222325ull);
+        CHECK_EQUAL(TuningSnapshot::HashPath("a"), 0xaf63dc4c8601ec8cull);
+        CHECK_EQUAL(TuningSnapshot::HashPath("foobar"), 0x85944171f73967e8ull);
+
+        // Paths that differ only in case or by a group separator don't collide
+        CHECK(TuningSnapshot::HashPath("Graphics/Display/Enable") != TuningSnapshot::HashPath("Graphics/Display/enable"));
+        CHECK(TuningSnapshot::HashPath("Graphics/DisplayEnable") != TuningSnapshot::HashPath("Graphics/Display/Enable"));
+    }
+
+    void TestRoundTrip( void )
+    {
+        TuningSnapshot::Entry Entries[3] =
+        {
+            { TuningSnapshot::HashPath("Graphics/Bloom/Enable"), 1, 0 },
+            { TuningSnapshot::HashPath("Graphics/Bloom/Intensity"), 0x3F800000, 0 },
+            { TuningSnapshot::HashPath("Timing/VSync"), 0, 0 },
+        };
+
+        vector<uint8_t> Blob;
+        TuningSnapshot::Write(Entries, 3, Blob);
+        CHECK_EQUAL(Blob.size(), sizeof(TuningSnapshot::Header) + 3 * sizeof(TuningSnapshot::Entry));
+
+        uint32_t Count;
+        const TuningSnapshot::Entry* Read = TuningSnapshot::Read(Blob.data(), Blob.size(), Count);
+        CHECK(Read != nullptr);
+        CHECK_EQUAL(Count, 3u);
+        for (uint32_t i = 0; Read != nullptr && i < Count; ++i)
+        {
+            CHECK_EQUAL(Read[i].PathHash, Entries[i].PathHash);
+            CHECK_EQUAL(Read[i].Value, Entries[i].Value);
+        }
+
+        // Writing again replaces the old contents
+        TuningSnapshot::Write(Entries, 1, Blob);
+        CHECK(TuningSnapshot::Read(Blob.data(), Blob.size(), Count) != nullptr);
+        CHECK_EQUAL(Count, 1u);
+    }
+
+    // A build without stateful variables still writes a valid snapshot
+    void TestEmptySnapshot( void )
+    {
+        vector<uint8_t> Blob;
+        TuningSnapshot::Write(nullptr, 0, Blob);
+        CHECK_EQUAL(Blob.size(), sizeof(TuningSnapshot::Header));
+
+        uint32_t Count = 1;
+        CHECK(TuningSnapshot::Read(Blob.data(), Blob.size(), Count) != nullptr);
+        CHECK_EQUAL(Count, 0u);
+    }
+
+    void TestMalformedRejected( void )
+    {
+        TuningSnapshot::Entry Entries[2] = { { 1, 2, 0 }, { 3, 4, 0 } };
+        vector<uint8_t> Good;
+        TuningSnapshot::Write(Entries, 2, Good);
+
+        uint32_t Count = 1;
+        CHECK(TuningSnapshot::Read(nullptr, Good.size(), Count) == nullptr);
+        CHECK_EQUAL(Count, 0u);
+        CHECK(TuningSnapshot::Read(Good.data(), sizeof(TuningSnapshot::Header) - 1, Count) == nullptr);
+
+        // Truncated, and with trailing bytes
+        CHECK(TuningSnapshot::Read(Good.data(), Good.size() - 1, Count) == nullptr);
+        vector<uint8_t> Long = Good;
+        Long.resize(Long.size() + sizeof(TuningSnapshot::Entry));
+        CHECK(TuningSnapshot::Read(Long.data(), Long.size(), Count) == nullptr);
+
+        vector<uint8_t> Bad = Good;
+        ((TuningSnapshot::Header*)Bad.data())->Magic ^= 1;
+        CHECK(TuningSnapshot::Read(Bad.data(), Bad.size(), Count) == nullptr);
+
+        Bad = Good;
+        ((TuningSnapshot::Header*)Bad.data())->Version = TuningSnapshot::kVersion + 1;
+        CHECK(TuningSnapshot::Read(Bad.data(), Bad.size(), Count) == nullptr);
+
+        // A count that would overflow a 32-bit size computation
+        Bad = Good;
+        ((TuningSnapshot::Header*)Bad.data())->Count = 0xFFFFFFFF;
+        CHECK(TuningSnapshot::Read(Bad.data(), Bad.size(), Count) == nullptr);
+
+        CHECK(TuningSnapshot::Read(Good.data(), Good.size(), Count) != nullptr);
+        CHECK_EQUAL(Count, 2u);
+    }
+
+    // The layout is persisted, so it must not change without a version bump
+    void TestLayout( void )
+    {
+        CHECK_EQUAL(sizeof(TuningSnapshot::Header), 16u);
+        CHECK_EQUAL(sizeof(TuningSnapshot::Entry), 16u);
+
+        TuningSnapshot::Entry Entry = { 0x0123456789ABCDEFull, 0xCAFEF00D, 0 };
+        vector<uint8_t> Blob;
+        TuningSnapshot::Write(&Entry, 1, Blob);
+
+        const uint8_t Expected[32] =
+        {
+            0x45, 0x54, 0x53, 0x53, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0xEF, 0xCD, 0xAB, 0x89, 0x67, 0x45, 0x23, 0x01, 0x0D, 0xF0, 0xFE, 0xCA, 0x00, 0x00, 0x00, 0x00,
+        };
+        CHECK_EQUAL(Blob.size(), sizeof(Expected));
+        CHECK(Blob.size() == sizeof(Expected) && memcmp(Blob.data(), Expected, sizeof(Expected)) == 0);
+    }
+}
+
+int main( void )
+{
+    RUN_TEST(TestHashPathReference);
+    RUN_TEST(TestRoundTrip);
+    RUN_TEST(TestEmptySnapshot);
+    RUN_TEST(TestMalformedRejected);
+    RUN_TEST(TestLayout);
+    return UnitTest::Report();
+}
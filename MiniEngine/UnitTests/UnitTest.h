@@ -0,0 +1,60 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  The checks shared by the CPU unit tests.  Every test is its own executable:  main() runs
+// the test's cases through RUN_TEST and returns UnitTest::Report(), so CTest lists and runs them one by
+// one.  A failed check prints where it failed and the test carries on, so one run shows every failure.
+//
+
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+
+namespace UnitTest
+{
+    inline int& FailureCount( void )
+    {
+        static int s_FailureCount = 0;
+        return s_FailureCount;
+    }
+
+    inline void Fail( const char* File, int Line, const char* Check )
+    {
+        fprintf(stderr, "%s(%d): check failed: %s\n", File, Line, Check);
+        ++FailureCount();
+    }
+
+    inline void Run( const char* Name, void (*Test)( void ) )
+    {
+        int FailuresBefore = FailureCount();
+        Test();
+        printf("%-48s %s\n", Name, FailureCount() == FailuresBefore ? "passed" : "FAILED");
+        fflush(stdout);
+    }
+
+    // The exit code of the test
+    inline int Report( void )
+    {
+        if (FailureCount() != 0)
+            fprintf(stderr, "%d checks failed\n", FailureCount());
+        return FailureCount() == 0 ? 0 : 1;
+    }
+}
+
+#define CHECK( Condition ) \
+    ((Condition) ? (void)0 : UnitTest::Fail(__FILE__, __LINE__, #Condition))
+
+#define CHECK_EQUAL( Actual, Expected ) \
+    CHECK((Actual) == (Expected))
+
+#define CHECK_NEAR( Actual, Expected, Tolerance ) \
+    CHECK(std::fabs((double)(Actual) - (double)(Expected)) <= (double)(Tolerance))
+
+#define RUN_TEST( Test ) \
+    UnitTest::Run(#Test, Test)
@@ -0,0 +1,344 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+// Description:  Tests of the wide SIMD math types and the VectorBatch loops against plain scalar code.
+// The project builds this file twice:  once with four SSE lanes, and once with /arch:AVX, where FloatXN is
+// eight lanes wide and FloatX8 is tested as well.
+//
+
+#include "UnitTest.h"
+#include "pch.h"
+#include "VectorBatch.h"
+#include "Camera.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+
+using namespace Math;
+using namespace std;
+
+namespace
+{
+    // Not a multiple of any lane count, so the batches end in a partial run
+    const uint32_t kCount = 1003;
+
+    float Random( float Low, float High )
+    {
+        return Low + (High - Low) * (float)rand() / (float)RAND_MAX;
+    }
+
+    bool Near( float A, float B, float Tolerance = 1e-4f )
+    {
+        return fabsf(A - B) <= Tolerance * max(1.0f, fabsf(B));
+    }
+
+    bool Equal( Vector3 A, Vector3 B )
+    {
+        return (float)A.GetX() == (float)B.GetX() && (float)A.GetY() == (float)B.GetY() && (float)A.GetZ() == (float)B.GetZ();
+    }
+
+    // Every lane of every operation against the same operation on each float
+    template <typename TFloat>
+    void TestFloatOps( void )
+    {
+        const int N = TFloat::kLanes;
+        bool ArithmeticOK = true, CompareOK = true, SelectOK = true, ReduceOK = true;
+
+        for (uint32_t Iteration = 0; Iteration < 1000; ++Iteration)
+        {
+            float A[8], B[8], R[8];
+            for (int i = 0; i < N; ++i)
+            {
+                A[i] = Random(-100.0f, 100.0f);
+                B[i] = Iteration % 4 == 0 ? A[i] : Random(-100.0f, 100.0f);
+            }
+
+            TFloat a = TFloat::Load(A), b = TFloat::Load(B);
+
+            (a + b).Store(R);
+            for (int i = 0; i < N; ++i) ArithmeticOK &= R[i] == A[i] + B[i];
+            (a - b).Store(R);
+            for (int i = 0; i < N; ++i) ArithmeticOK &= R[i] == A[i] - B[i];
+            (a * b).Store(R);
+            for (int i = 0; i < N; ++i) ArithmeticOK &= R[i] == A[i] * B[i];
+            (a / b).Store(R);
+            for (int i = 0; i < N; ++i) ArithmeticOK &= R[i] == A[i] / B[i];
+            (-a).Store(R);
+            for (int i = 0; i < N; ++i) ArithmeticOK &= R[i] == -A[i];
+            Abs(a).Store(R);
+            for (int i = 0; i < N; ++i) ArithmeticOK &= R[i] == fabsf(A[i]);
+            Min(a, b).Store(R);
+            for (int i = 0; i < N; ++i) ArithmeticOK &= R[i] == min(A[i], B[i]);
+            Max(a, b).Store(R);
+            for (int i = 0; i < N; ++i) ArithmeticOK &= R[i] == max(A[i], B[i]);
+
+            uint32_t Less = 0, LessEqual = 0, Greater = 0, GreaterEqual = 0;
+            for (int i = 0; i < N; ++i)
+            {
+                Less |= (A[i] < B[i]) << i;
+                LessEqual |= (A[i] <= B[i]) << i;
+                Greater |= (A[i] > B[i]) << i;
+                GreaterEqual |= (A[i] >= B[i]) << i;
+            }
+            CompareOK &= (a < b).GetMask() == Less && (a <= b).GetMask() == LessEqual;
+            CompareOK &= (a > b).GetMask() == Greater && (a >= b).GetMask() == GreaterEqual;
+            CompareOK &= ((a < b) | (a > b)).GetMask() == (Less | Greater);
+            CompareOK &= ((a <= b) & (a >= b)).GetMask() == (LessEqual & GreaterEqual);
+
+            Select(a, b, a < b).Store(R);
+            for (int i = 0; i < N; ++i) SelectOK &= R[i] == (A[i] < B[i] ? B[i] : A[i]);
+
+            float Lowest = FLT_MAX, Highest = -FLT_MAX;
+            for (int i = 0; i < N; ++i)
+            {
+                Lowest = min(Lowest, A[i]);
+                Highest = max(Highest, A[i]);
+            }
+            ReduceOK &= a.ReduceMin() == Lowest && a.ReduceMax() == Highest;
+        }
+
+        CHECK(ArithmeticOK);
+        CHECK(CompareOK);
+        CHECK(SelectOK);
+        CHECK(ReduceOK);
+
+        // Gather from an interleaved array
+        float Interleaved[8 * 5];
+        for (int i = 0; i < 8 * 5; ++i)
+            Interleaved[i] = (float)i;
+        float Gathered[8];
+        TFloat::Gather(Interleaved + 2, 5 * sizeof(float)).Store(Gathered);
+        bool GatherOK = true;
+        for (int i = 0; i < N; ++i)
+            GatherOK &= Gathered[i] == (float)(i * 5 + 2);
+        CHECK(GatherOK);
+    }
+
+    Matrix4 TestTransform( void )
+    {
+        return Matrix4(Vector3(0.5f, 0.2f, 0.0f), Vector3(-0.3f, 1.0f, 0.1f), Vector3(0.0f, 0.4f, 2.0f), Vector3(5.0f, -3.0f, 1.0f));
+    }
+
+    // Matrix4Wide and PlaneWide against Matrix4 and BoundingPlane, one lane at a time
+    template <typename TFloat>
+    void TestWideMath( void )
+    {
+        const int N = TFloat::kLanes;
+        const Matrix4 Xform = TestTransform();
+        const Matrix4Wide<TFloat> WideXform(Xform);
+        const BoundingPlane Plane(Vector3(0.6f, -0.8f, 0.0f), 1.5f);
+        const PlaneWide<TFloat> WidePlane(Plane);
+
+        bool PointsOK = true, DirectionsOK = true, DotOK = true, DistanceOK = true, OutsideOK = true;
+        for (uint32_t Iteration = 0; Iteration < 200; ++Iteration)
+        {
+            float X[8], Y[8], Z[8], E[8], Out[3][8];
+            for (int i = 0; i < N; ++i)
+            {
+                X[i] = Random(-10.0f, 10.0f);
+                Y[i] = Random(-10.0f, 10.0f);
+                Z[i] = Random(-10.0f, 10.0f);
+                E[i] = Random(0.0f, 3.0f);
+            }
+            Vector3Wide<TFloat> P = Vector3Wide<TFloat>::Load(X, Y, Z);
+
+            WideXform.TransformPoint(P).Store(Out[0], Out[1], Out[2]);
+            for (int i = 0; i < N; ++i)
+            {
+                Vector3 Expected = Vector3(Xform * Vector3(X[i], Y[i], Z[i]));
+                PointsOK &= Near(Out[0][i], Expected.GetX()) && Near(Out[1][i], Expected.GetY()) && Near(Out[2][i], Expected.GetZ());
+            }
+
+            WideXform.TransformDirection(P).Store(Out[0], Out[1], Out[2]);
+            for (int i = 0; i < N; ++i)
+            {
+                Vector3 Expected = Vector3(Xform * Vector4(X[i], Y[i], Z[i], 0.0f));
+                DirectionsOK &= Near(Out[0][i], Expected.GetX()) && Near(Out[1][i], Expected.GetY()) && Near(Out[2][i], Expected.GetZ());
+            }
+
+            Dot(P, P).Store(Out[0]);
+            WidePlane.DistanceFromPoint(P).Store(Out[1]);
+            for (int i = 0; i < N; ++i)
+            {
+                Vector3 v(X[i], Y[i], Z[i]);
+                DotOK &= Near(Out[0][i], Dot(v, v));
+                DistanceOK &= Near(Out[1][i], Plane.DistanceFromPoint(v));
+            }
+
+            // Boxes of half extent E around the points
+            TFloat Extent = TFloat::Load(E);
+            Vector3Wide<TFloat> BoxMin(P.x - Extent, P.y - Extent, P.z - Extent), BoxMax(P.x + Extent, P.y + Extent, P.z + Extent);
+            uint32_t Outside = WidePlane.BoxOutside(BoxMin, BoxMax).GetMask();
+            for (int i = 0; i < N; ++i)
+            {
+                bool AllOutside = true;
+                for (int Corner = 0; Corner < 8; ++Corner)
+                {
+                    Vector3 c(Corner & 1 ? X[i] + E[i] : X[i] - E[i], Corner & 2 ? Y[i] + E[i] : Y[i] - E[i], Corner & 4 ? Z[i] + E[i] : Z[i] - E[i]);
+                    AllOutside &= Plane.DistanceFromPoint(c) < 0.0f;
+                }
+                OutsideOK &= ((Outside >> i) & 1) == (uint32_t)AllOutside;
+            }
+        }
+
+        CHECK(PointsOK);
+        CHECK(DirectionsOK);
+        CHECK(DotOK);
+        CHECK(DistanceOK);
+        CHECK(OutsideOK);
+    }
+
+    void FillRandomBoxes( Vector3Stream& MinBound, Vector3Stream& MaxBound )
+    {
+        MinBound.Resize(kCount);
+        MaxBound.Resize(kCount);
+        for (uint32_t i = 0; i < kCount; ++i)
+        {
+            Vector3 Center(Random(-60.0f, 60.0f), Random(-60.0f, 60.0f), Random(-120.0f, 10.0f));
+            Vector3 Extent(Random(0.0f, 4.0f), Random(0.0f, 4.0f), Random(0.0f, 4.0f));
+            MinBound.Set(i, Center - Extent);
+            MaxBound.Set(i, Center + Extent);
+        }
+    }
+
+    void TestTransformPoints( void )
+    {
+        Vector3Stream In(kCount), Out;
+        for (uint32_t i = 0; i < kCount; ++i)
+            In.Set(i, Vector3(Random(-10.0f, 10.0f), Random(-10.0f, 10.0f), Random(-10.0f, 10.0f)));
+
+        const Matrix4 Xform = TestTransform();
+        TransformPoints(Xform, In, Out);
+        CHECK_EQUAL(Out.Size(), kCount);
+
+        bool Match = true;
+        for (uint32_t i = 0; i < kCount; ++i)
+        {
+            Vector3 Expected = Vector3(Xform * In.Get(i)), Actual = Out.Get(i);
+            Match &= Near(Actual.GetX(), Expected.GetX()) && Near(Actual.GetY(), Expected.GetY()) && Near(Actual.GetZ(), Expected.GetZ());
+        }
+        CHECK(Match);
+
+        // In place
+        TransformPoints(Xform, In, In);
+        CHECK(Near(In.Get(kCount - 1).GetX(), Out.Get(kCount - 1).GetX(), 0.0f));
+    }
+
+    // Each refit box holds all eight transformed corners and touches them on every face
+    void TestTransformBounds( void )
+    {
+        Vector3Stream MinIn, MaxIn, MinOut, MaxOut;
+        FillRandomBoxes(MinIn, MaxIn);
+
+        const Matrix4 Xform = TestTransform();
+        TransformBounds(Xform, MinIn, MaxIn, MinOut, MaxOut);
+
+        bool Tight = true;
+        for (uint32_t i = 0; i < kCount; ++i)
+        {
+            Vector3 Lo(FLT_MAX, FLT_MAX, FLT_MAX), Hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+            for (int Corner = 0; Corner < 8; ++Corner)
+            {
+                Vector3 c((Corner & 1 ? MaxIn : MinIn).X()[i], (Corner & 2 ? MaxIn : MinIn).Y()[i], (Corner & 4 ? MaxIn : MinIn).Z()[i]);
+                Vector3 p = Vector3(Xform * c);
+                Lo = Min(Lo, p);
+                Hi = Max(Hi, p);
+            }
+            Vector3 OutMin = MinOut.Get(i), OutMax = MaxOut.Get(i);
+            Tight &= Near(OutMin.GetX(), Lo.GetX(), 1e-3f) && Near(OutMin.GetY(), Lo.GetY(), 1e-3f) && Near(OutMin.GetZ(), Lo.GetZ(), 1e-3f);
+            Tight &= Near(OutMax.GetX(), Hi.GetX(), 1e-3f) && Near(OutMax.GetY(), Hi.GetY(), 1e-3f) && Near(OutMax.GetZ(), Hi.GetZ(), 1e-3f);
+        }
+        CHECK(Tight);
+    }
+
+    // The batch cull agrees with Frustum::IntersectBoundingBox on every box
+    void TestIntersectBoundingBoxes( void )
+    {
+        Camera Cam;
+        Cam.SetEyeAtUp(Vector3(0.0f, 0.0f, 0.0f), Vector3(0.0f, 0.0f, -1.0f), Vector3(0.0f, 1.0f, 0.0f));
+        Cam.SetPerspectiveMatrix(0.8f, 9.0f / 16.0f, 1.0f, 100.0f);
+        Cam.Update();
+        const Frustum& ViewFrustum = Cam.GetWorldSpaceFrustum();
+
+        Vector3Stream MinBound, MaxBound;
+        FillRandomBoxes(MinBound, MaxBound);
+
+        vector<uint8_t> Visible(kCount, 0xFF);
+        uint32_t NumVisible = IntersectBoundingBoxes(ViewFrustum, MinBound, MaxBound, Visible.data());
+
+        uint32_t Expected = 0, Mismatches = 0;
+        for (uint32_t i = 0; i < kCount; ++i)
+        {
+            bool Inside = ViewFrustum.IntersectBoundingBox(MinBound.Get(i), MaxBound.Get(i));
+            Expected += Inside;
+            Mismatches += Visible[i] != (uint8_t)Inside;
+        }
+        CHECK_EQUAL(Mismatches, 0u);
+        CHECK_EQUAL(NumVisible, Expected);
+
+        // The random boxes straddle the frustum, so both outcomes are covered
+        CHECK(Expected > 0 && Expected < kCount);
+    }
+
+    void TestComputeBounds( void )
+    {
+        Vector3Stream Points(kCount);
+        vector<float> Vertices(kCount * 8);
+        Vector3 Lo(FLT_MAX, FLT_MAX, FLT_MAX), Hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        for (uint32_t i = 0; i < kCount; ++i)
+        {
+            Vector3 p(Random(-10.0f, 10.0f), Random(-5.0f, 20.0f), Random(-30.0f, -1.0f));
+            Points.Set(i, p);
+            Lo = Min(Lo, p);
+            Hi = Max(Hi, p);
+
+            // Positions interleaved with other attributes that must not leak into the bounds
+            Vertices[i * 8 + 0] = p.GetX();
+            Vertices[i * 8 + 1] = p.GetY();
+            Vertices[i * 8 + 2] = p.GetZ();
+            for (int k = 3; k < 8; ++k)
+                Vertices[i * 8 + k] = 1e6f;
+        }
+
+        Vector3 MinBound, MaxBound;
+        ComputeBounds(Points, MinBound, MaxBound);
+        CHECK(Equal(MinBound, Lo));
+        CHECK(Equal(MaxBound, Hi));
+
+        ComputeBounds(Vertices.data(), 8 * sizeof(float), kCount, MinBound, MaxBound);
+        CHECK(Equal(MinBound, Lo));
+        CHECK(Equal(MaxBound, Hi));
+
+        // Fewer points than one batch
+        ComputeBounds(Vertices.data(), 8 * sizeof(float), 3, MinBound, MaxBound);
+        CHECK_EQUAL((float)MinBound.GetX(), min(min(Vertices[0], Vertices[8]), Vertices[16]));
+
+        Vector3Stream Empty;
+        ComputeBounds(Empty, MinBound, MaxBound);
+        CHECK(Equal(MinBound, Vector3(kZero)) && Equal(MaxBound, Vector3(kZero)));
+    }
+}
+
+int main( void )
+{
+    srand(2018);
+    printf("FloatXN has %d lanes\n", (int)FloatXN::kLanes);
+
+    RUN_TEST(TestFloatOps<FloatX4>);
+    RUN_TEST(TestWideMath<FloatX4>);
+#ifdef MATH_WIDE_AVX
+    RUN_TEST(TestFloatOps<FloatX8>);
+    RUN_TEST(TestWideMath<FloatX8>);
+#endif
+    RUN_TEST(TestTransformPoints);
+    RUN_TEST(TestTransformBounds);
+    RUN_TEST(TestIntersectBoundingBoxes);
+    RUN_TEST(TestComputeBounds);
+    return UnitTest::Report();
+}
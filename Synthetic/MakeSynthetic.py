@@ -0,0 +1,163 @@
+#
+# Copyright (c) Microsoft. All rights reserved.
+# This code is licensed under the MIT License (MIT).
+# THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+# ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+# IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+# PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+#
+# Writes synthetic.h3d, a small city block of boxes for running FrameBench without the Sponza model:  a
+# ground slab, a grid of buildings of varying height, and a few alpha tested fences.  The output is
+# deterministic, so the committed file can be regenerated and compared.
+#
+# The layout matches Model::Header, Model::Mesh and Model::Material as compiled for x64, where Vector3 is
+# 16 bytes and 16 byte aligned.
+#
+# Usage:  python MakeSynthetic.py [output.h3d]
+#
+
+import struct
+import sys
+
+ATTRIB_FORMAT_FLOAT = 5
+MAX_ATTRIBS = 16
+MAX_TEX_PATH = 128
+TEX_COUNT = 7
+MAX_MATERIAL_NAME = 128
+
+HEADER_SIZE = 64
+MESH_SIZE = 336
+MATERIAL_SIZE = 1120
+
+VERTEX_STRIDE = 56          # position, texcoord0, normal, tangent, bitangent
+VERTEX_STRIDE_DEPTH = 12    # position
+
+# name, diffuse, hasMask
+MATERIALS = [
+    ("ground", (0.35, 0.35, 0.32), False),
+    ("brick", (0.55, 0.27, 0.20), False),
+    ("concrete", (0.60, 0.60, 0.58), False),
+    ("fence", (0.30, 0.30, 0.30), True),
+]
+
+def vector3(v):
+    return struct.pack("<4f", v[0], v[1], v[2], 0.0)
+
+def bounding_box(lo, hi):
+    return vector3(lo) + vector3(hi)
+
+def box_faces(lo, hi):
+    """Yields (normal, tangent, corners) for the six faces of a box, wound clockwise seen from outside."""
+    x0, y0, z0 = lo
+    x1, y1, z1 = hi
+    yield ((1, 0, 0), (0, 0, 1), [(x1, y0, z0), (x1, y1, z0), (x1, y1, z1), (x1, y0, z1)])
+    yield ((-1, 0, 0), (0, 0, -1), [(x0, y0, z1), (x0, y1, z1), (x0, y1, z0), (x0, y0, z0)])
+    yield ((0, 1, 0), (1, 0, 0), [(x0, y1, z0), (x0, y1, z1), (x1, y1, z1), (x1, y1, z0)])
+    yield ((0, -1, 0), (1, 0, 0), [(x0, y0, z1), (x0, y0, z0), (x1, y0, z0), (x1, y0, z1)])
+    yield ((0, 0, 1), (-1, 0, 0), [(x1, y0, z1), (x1, y1, z1), (x0, y1, z1), (x0, y0, z1)])
+    yield ((0, 0, -1), (1, 0, 0), [(x0, y0, z0), (x0, y1, z0), (x1, y1, z0), (x1, y0, z0)])
+
+def cross(a, b):
+    return (a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0])
+
+def box_geometry(lo, hi):
+    """Returns the full vertices, depth vertices, and mesh-local 16-bit indices of a box."""
+    vertices = b""
+    depth = b""
+    indices = []
+    uvs = [(0.0, 1.0), (0.0, 0.0), (1.0, 0.0), (1.0, 1.0)]
+    for normal, tangent, corners in box_faces(lo, hi):
+        bitangent = cross(normal, tangent)
+        base = len(indices) // 6 * 4
+        for corner, uv in zip(corners, uvs):
+            vertices += struct.pack("<14f", *(corner + uv + normal + tangent + bitangent))
+            depth += struct.pack("<3f", *corner)
+        indices += [base, base + 1, base + 2, base, base + 2, base + 3]
+    return vertices, depth, indices
+
+def attrib_table(attribs):
+    table = b""
+    for i in range(MAX_ATTRIBS):
+        offset, components = attribs[i] if i < len(attribs) else (0, 0)
+        format = ATTRIB_FORMAT_FLOAT if components > 0 else 0
+        table += struct.pack("<4H", offset, 0, components, format)
+    return table
+
+def city_block():
+    """Returns a list of (material index, min, max) boxes."""
+    boxes = [(0, (-120.0, -2.0, -120.0), (120.0, 0.0, 120.0))]
+
+    # A 5 x 5 grid of buildings with a plaza in the middle
+    for row in range(5):
+        for col in range(5):
+            if row == 2 and col == 2:
+                continue
+            x = -100.0 + col * 50.0
+            z = -100.0 + row * 50.0
+            height = 20.0 + ((row * 7 + col * 13) % 9) * 10.0
+            material = 1 + (row + col) % 2
+            boxes.append((material, (x - 15.0, 0.0, z - 15.0), (x + 15.0, height, z + 15.0)))
+
+    # Thin fences around the plaza
+    boxes.append((3, (-20.0, 0.0, -20.5), (20.0, 4.0, -19.5)))
+    boxes.append((3, (-20.0, 0.0, 19.5), (20.0, 4.0, 20.5)))
+    boxes.append((3, (-20.5, 0.0, -20.0), (-19.5, 4.0, 20.0)))
+    boxes.append((3, (19.5, 0.0, -20.0), (20.5, 4.0, 20.0)))
+    return boxes
+
+def material_record(name, diffuse, has_mask):
+    record = vector3(diffuse)
+    record += vector3((0.2, 0.2, 0.2))      # specular
+    record += vector3((0.0, 0.0, 0.0))      # ambient
+    record += vector3((0.0, 0.0, 0.0))      # emissive
+    record += vector3((0.0, 0.0, 0.0))      # transparent
+    record += struct.pack("<3f?", 1.0, 16.0, 1.0, has_mask)
+    record += b"\0" * (MAX_TEX_PATH * TEX_COUNT)
+    record += name.encode("ascii").ljust(MAX_MATERIAL_NAME, b"\0")
+    assert len(record) <= MATERIAL_SIZE
+    return record.ljust(MATERIAL_SIZE, b"\0")
+
+def main():
+    output = sys.argv[1] if len(sys.argv) > 1 else "synthetic.h3d"
+
+    meshes = b""
+    vertex_data = b""
+    depth_data = b""
+    index_data = b""
+    scene_lo = [float("inf")] * 3
+    scene_hi = [float("-inf")] * 3
+
+    full_attribs = [(0, 3), (12, 2), (20, 3), (32, 3), (44, 3)]
+    depth_attribs = [(0, 3)]
+
+    for material, lo, hi in city_block():
+        vertices, depth, indices = box_geometry(lo, hi)
+
+        mesh = bounding_box(lo, hi)
+        mesh += struct.pack("<5I", material, 0x1F, 0x1, VERTEX_STRIDE, VERTEX_STRIDE_DEPTH)
+        mesh += attrib_table(full_attribs)
+        mesh += attrib_table(depth_attribs)
+        mesh += struct.pack("<6I", len(vertex_data), len(vertices) // VERTEX_STRIDE,
+            len(index_data), len(indices), len(depth_data), len(depth) // VERTEX_STRIDE_DEPTH)
+        meshes += mesh.ljust(MESH_SIZE, b"\0")
+
+        vertex_data += vertices
+        depth_data += depth
+        index_data += struct.pack("<%dH" % len(indices), *indices)
+
+        for i in range(3):
+            scene_lo[i] = min(scene_lo[i], lo[i])
+            scene_hi[i] = max(scene_hi[i], hi[i])
+
+    header = struct.pack("<5I", len(meshes) // MESH_SIZE, len(MATERIALS), len(vertex_data), len(index_data), len(depth_data))
+    header = header.ljust(32, b"\0") + bounding_box(scene_lo, scene_hi)
+    assert len(header) == HEADER_SIZE
+
+    materials = b"".join(material_record(*m) for m in MATERIALS)
+
+    # The full and depth-only vertices share one index buffer, which the loader reads twice
+    with open(output, "wb") as f:
+        f.write(header + meshes + materials + vertex_data + index_data + depth_data + index_data)
+
+if __name__ == "__main__":
+    main()